@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+namespace anima
+{
+
+/**
+ * @brief Base class for benchmarks of the animaBenchmarks suite. Initialize generates synthetic data and does
+ * everything that should not be timed, Run is the timed part, called once per repetition and number of threads.
+ * Runs should not depend on each other so that repetitions are comparable.
+ */
+class BaseBenchmark
+{
+public:
+    BaseBenchmark() {}
+    virtual ~BaseBenchmark() {}
+
+    //! Name used in results and for filtering, lower case with underscores
+    virtual std::string GetName() = 0;
+
+    //! Benchmarks not threaded are run once instead of for each number of threads of the sweep
+    virtual bool GetThreaded() {return true;}
+
+    virtual void Initialize() = 0;
+    virtual void Run(unsigned int numThreads) = 0;
+};
+
+} // end namespace anima
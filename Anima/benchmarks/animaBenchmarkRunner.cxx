@@ -0,0 +1,242 @@
+#include "animaBenchmarkRunner.h"
+
+#include <itkMacro.h>
+#include <itkMultiThreaderBase.h>
+#include <itkTimeProbe.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace anima
+{
+
+BenchmarkRunner::BenchmarkRunner()
+{
+    m_NumberOfRepetitions = 5;
+    m_Verbose = true;
+
+    unsigned int maxThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    for (unsigned int i = 1;i < maxThreads;i *= 2)
+        m_ThreadCounts.push_back(i);
+
+    m_ThreadCounts.push_back(maxThreads);
+}
+
+void BenchmarkRunner::AddBenchmark(BaseBenchmark *benchmark)
+{
+    m_Benchmarks.push_back(std::unique_ptr <BaseBenchmark> (benchmark));
+}
+
+std::vector <std::string> BenchmarkRunner::GetBenchmarkNames()
+{
+    std::vector <std::string> names(m_Benchmarks.size());
+    for (unsigned int i = 0;i < m_Benchmarks.size();++i)
+        names[i] = m_Benchmarks[i]->GetName();
+
+    return names;
+}
+
+void BenchmarkRunner::Update()
+{
+    if ((m_ThreadCounts.size() == 0) || (m_NumberOfRepetitions == 0))
+        throw itk::ExceptionObject(__FILE__, __LINE__, "No thread count or repetition to run benchmarks", ITK_LOCATION);
+
+    m_Results.clear();
+    for (unsigned int i = 0;i < m_Benchmarks.size();++i)
+    {
+        BaseBenchmark *benchmark = m_Benchmarks[i].get();
+        std::string name = benchmark->GetName();
+        if ((m_NameFilter != "") && (name.find(m_NameFilter) == std::string::npos))
+            continue;
+
+        if (m_Verbose)
+            std::cout << "Benchmark " << name << std::endl;
+
+        itk::TimeProbe initTimer;
+        initTimer.Start();
+        benchmark->Initialize();
+        initTimer.Stop();
+
+        // Warm up run, not recorded: first touch of buffers, lazy tables
+        benchmark->Run(m_ThreadCounts.back());
+
+        unsigned int numSweeps = benchmark->GetThreaded() ? m_ThreadCounts.size() : 1;
+        double referenceMedian = 0;
+        for (unsigned int j = 0;j < numSweeps;++j)
+        {
+            unsigned int numThreads = benchmark->GetThreaded() ? m_ThreadCounts[j] : 1;
+
+            std::vector <double> timings(m_NumberOfRepetitions);
+            for (unsigned int k = 0;k < m_NumberOfRepetitions;++k)
+            {
+                itk::TimeProbe timer;
+                timer.Start();
+                benchmark->Run(numThreads);
+                timer.Stop();
+
+                timings[k] = timer.GetTotal();
+            }
+
+            std::sort(timings.begin(),timings.end());
+
+            BenchmarkResult result;
+            result.Name = name;
+            result.NumberOfThreads = numThreads;
+            result.InitializationTime = initTimer.GetTotal();
+            result.Minimum = timings[0];
+
+            unsigned int halfSize = m_NumberOfRepetitions / 2;
+            if (m_NumberOfRepetitions % 2 == 0)
+                result.Median = (timings[halfSize - 1] + timings[halfSize]) / 2.0;
+            else
+                result.Median = timings[halfSize];
+
+            result.Mean = 0;
+            for (unsigned int k = 0;k < m_NumberOfRepetitions;++k)
+                result.Mean += timings[k];
+            result.Mean /= m_NumberOfRepetitions;
+
+            if (j == 0)
+                referenceMedian = result.Median;
+
+            result.Speedup = (result.Median > 0) ? referenceMedian / result.Median : 1.0;
+            result.BaselineMedian = -1;
+
+            if (m_Verbose)
+                std::cout << "    " << numThreads << " thread(s): median " << result.Median << " s, min "
+                          << result.Minimum << " s, speedup " << result.Speedup << std::endl;
+
+            m_Results.push_back(result);
+        }
+    }
+}
+
+void BenchmarkRunner::WriteResults(const std::string &fileName)
+{
+    std::ofstream outputFile(fileName.c_str());
+    if (!outputFile.is_open())
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Unable to write file: " + fileName, ITK_LOCATION);
+
+    outputFile << std::setprecision(9);
+    outputFile << "{" << std::endl;
+    outputFile << "  \"version\": \"" << ANIMA_VERSION << "\"," << std::endl;
+    outputFile << "  \"repetitions\": " << m_NumberOfRepetitions << "," << std::endl;
+    outputFile << "  \"results\": [" << std::endl;
+
+    // One result object per line, read back by CompareToBaseline
+    for (unsigned int i = 0;i < m_Results.size();++i)
+    {
+        const BenchmarkResult &result = m_Results[i];
+        outputFile << "    {\"name\": \"" << result.Name << "\", \"threads\": " << result.NumberOfThreads
+                   << ", \"initialization\": " << result.InitializationTime
+                   << ", \"min\": " << result.Minimum << ", \"median\": " << result.Median
+                   << ", \"mean\": " << result.Mean << ", \"speedup\": " << result.Speedup;
+
+        if (result.BaselineMedian >= 0)
+        {
+            outputFile << ", \"baseline_median\": " << result.BaselineMedian
+                       << ", \"ratio\": " << result.Median / result.BaselineMedian;
+        }
+
+        outputFile << "}";
+        if (i != m_Results.size() - 1)
+            outputFile << ",";
+        outputFile << std::endl;
+    }
+
+    outputFile << "  ]" << std::endl;
+    outputFile << "}" << std::endl;
+}
+
+bool BenchmarkRunner::ExtractValue(const std::string &objectString, const std::string &key, std::string &value)
+{
+    std::string searchedKey = "\"" + key + "\":";
+    std::size_t position = objectString.find(searchedKey);
+    if (position == std::string::npos)
+        return false;
+
+    position = objectString.find_first_not_of(" \t",position + searchedKey.size());
+    if (position == std::string::npos)
+        return false;
+
+    std::size_t endPosition;
+    if (objectString[position] == '"')
+    {
+        ++position;
+        endPosition = objectString.find('"',position);
+    }
+    else
+        endPosition = objectString.find_first_of(",} \t",position);
+
+    if (endPosition == std::string::npos)
+        endPosition = objectString.size();
+
+    value = objectString.substr(position,endPosition - position);
+    return (value != "");
+}
+
+unsigned int BenchmarkRunner::CompareToBaseline(const std::string &fileName, double threshold)
+{
+    std::ifstream baselineFile(fileName.c_str());
+    if (!baselineFile.is_open())
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Unable to read baseline file: " + fileName, ITK_LOCATION);
+
+    std::stringstream baselineStream;
+    baselineStream << baselineFile.rdbuf();
+    std::string baselineString = baselineStream.str();
+
+    unsigned int numRegressions = 0;
+    std::size_t position = baselineString.find("{\"name\"");
+    while (position != std::string::npos)
+    {
+        std::size_t endPosition = baselineString.find('}',position);
+        std::string objectString = baselineString.substr(position,endPosition - position);
+        position = baselineString.find("{\"name\"",endPosition);
+
+        std::string name, threadsString, medianString;
+        if (!ExtractValue(objectString,"name",name) || !ExtractValue(objectString,"threads",threadsString) ||
+                !ExtractValue(objectString,"median",medianString))
+            continue;
+
+        unsigned int numThreads;
+        double baselineMedian;
+        try
+        {
+            numThreads = std::stoi(threadsString);
+            baselineMedian = std::stod(medianString);
+        }
+        catch (std::invalid_argument &)
+        {
+            std::cerr << "Warning: skipping baseline entry " << name << " with invalid threads or median value" << std::endl;
+            continue;
+        }
+        catch (std::out_of_range &)
+        {
+            std::cerr << "Warning: skipping baseline entry " << name << " with out of range threads or median value" << std::endl;
+            continue;
+        }
+
+        for (unsigned int i = 0;i < m_Results.size();++i)
+        {
+            BenchmarkResult &result = m_Results[i];
+            if ((result.Name != name) || (result.NumberOfThreads != numThreads) || (baselineMedian <= 0))
+                continue;
+
+            result.BaselineMedian = baselineMedian;
+            if (result.Median > (1.0 + threshold) * baselineMedian)
+            {
+                ++numRegressions;
+                std::cerr << "Regression: " << name << " with " << numThreads << " thread(s) runs in " << result.Median
+                          << " s, baseline " << baselineMedian << " s" << std::endl;
+            }
+        }
+    }
+
+    return numRegressions;
+}
+
+} // end namespace anima
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <animaBaseBenchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace anima
+{
+
+/**
+ * @brief Runs benchmarks over a sweep of numbers of threads, writes results as JSON and compares them to baseline
+ * results from an earlier run. Timings are in seconds, the median over repetitions is the compared value.
+ */
+class BenchmarkRunner
+{
+public:
+    BenchmarkRunner();
+    virtual ~BenchmarkRunner() {}
+
+    struct BenchmarkResult
+    {
+        std::string Name;
+        unsigned int NumberOfThreads;
+        double InitializationTime;
+        double Minimum, Median, Mean;
+        //! Median time of the first number of threads of the sweep over median time
+        double Speedup;
+        //! Median time from the baseline, negative if not compared
+        double BaselineMedian;
+    };
+
+    //! Takes ownership of the benchmark
+    void AddBenchmark(BaseBenchmark *benchmark);
+    std::vector <std::string> GetBenchmarkNames();
+
+    void SetThreadCounts(const std::vector <unsigned int> &val) {m_ThreadCounts = val;}
+    void SetNumberOfRepetitions(unsigned int val) {m_NumberOfRepetitions = val;}
+
+    //! Only benchmarks whose name contains the filter are run
+    void SetNameFilter(const std::string &val) {m_NameFilter = val;}
+    void SetVerbose(bool val) {m_Verbose = val;}
+
+    void Update();
+
+    const std::vector <BenchmarkResult> &GetResults() {return m_Results;}
+    void WriteResults(const std::string &fileName);
+
+    /**
+     * Reads results written by WriteResults and compares medians to those with the same name and number of threads.
+     * Returns the number of results slower than (1 + threshold) times their baseline.
+     */
+    unsigned int CompareToBaseline(const std::string &fileName, double threshold);
+
+protected:
+    //! Extracts a numeric or string value of a key from one result object of a results file
+    static bool ExtractValue(const std::string &objectString, const std::string &key, std::string &value);
+
+private:
+    std::vector < std::unique_ptr <BaseBenchmark> > m_Benchmarks;
+    std::vector <BenchmarkResult> m_Results;
+
+    std::vector <unsigned int> m_ThreadCounts;
+    unsigned int m_NumberOfRepetitions;
+    std::string m_NameFilter;
+    bool m_Verbose;
+};
+
+} // end namespace anima
@@ -0,0 +1,131 @@
+#include <animaBenchmarkRunner.h>
+#include <animaDiffusionBenchmarks.h>
+#include <animaFilteringBenchmarks.h>
+#include <animaInstrumentationBenchmark.h>
+#include <animaQuantitativeMRIBenchmarks.h>
+#include <animaRegistrationBenchmarks.h>
+#include <animaSegmentationBenchmarks.h>
+
+#ifdef ANIMA_BENCHMARK_TRACTOGRAPHY
+#include <animaTractographyBenchmark.h>
+#endif
+
+#include <itkMultiThreaderBase.h>
+
+#include <tclap/CmdLine.h>
+#include <animaInstrumentationArguments.h>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+int main(int argc, char **argv)
+{
+    TCLAP::CmdLine cmd("Runs performance benchmarks of core Anima filters on synthetic phantoms and writes timings as JSON. "
+                       "Optionally compares them to a baseline results file, failing if some benchmark is slower than the threshold.\n"
+                       "INRIA / IRISA - VisAGeS/Empenn Team",' ',ANIMA_VERSION);
+
+    TCLAP::ValueArg<std::string> outArg("o","output","Output JSON results file (default: anima_benchmarks.json)",false,"anima_benchmarks.json","output results",cmd);
+    TCLAP::ValueArg<std::string> baselineArg("b","baseline","Baseline JSON results file to compare to",false,"","baseline results",cmd);
+    TCLAP::ValueArg<double> thresholdArg("","threshold","Relative slowdown of the median time flagged as regression (default: 0.15)",false,0.15,"regression threshold",cmd);
+
+    TCLAP::ValueArg<std::string> threadsArg("t","threads","Comma separated numbers of threads (default: powers of two up to all cores)",false,"","numbers of threads",cmd);
+    TCLAP::ValueArg<unsigned int> repetitionsArg("r","repetitions","Number of timed runs per number of threads (default: 5)",false,5,"number of repetitions",cmd);
+    TCLAP::ValueArg<std::string> filterArg("f","filter","Only run benchmarks whose name contains this string",false,"","name filter",cmd);
+    TCLAP::ValueArg<unsigned int> sizeArg("s","size","Size of synthetic phantoms in voxels along each axis (default: 64)",false,64,"phantom size",cmd);
+
+    TCLAP::SwitchArg listArg("l","list","List benchmarks and exit",cmd,false);
+
+    anima::InstrumentationArguments instrumentationArgs(cmd);
+
+    try
+    {
+        cmd.parse(argc,argv);
+    }
+    catch (TCLAP::ArgException& e)
+    {
+        std::cerr << "Error: " << e.error() << "for argument " << e.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    instrumentationArgs.Setup();
+
+    unsigned int size = std::max(sizeArg.getValue(),16U);
+
+    anima::BenchmarkRunner runner;
+    runner.AddBenchmark(new anima::BlockMatchingBenchmark(size));
+    runner.AddBenchmark(new anima::SVFExponentialBenchmark(size));
+    runner.AddBenchmark(new anima::ScalarDenseResamplingBenchmark(size));
+    runner.AddBenchmark(new anima::TensorAffineResamplingBenchmark <anima::PhantomVectorImageType> (size,"resampling_tensor_affine"));
+    runner.AddBenchmark(new anima::TensorAffineResamplingBenchmark <anima::PhantomTensorImageType> (size,"resampling_tensor_affine_fixed"));
+    runner.AddBenchmark(new anima::MCMPredictedSignalBenchmark(200000));
+    // Voxelwise estimation is much slower than other filters, small phantom
+    runner.AddBenchmark(new anima::MCMEstimationBenchmark(std::max(6U, size / 8)));
+#ifdef ANIMA_BENCHMARK_TRACTOGRAPHY
+    runner.AddBenchmark(new anima::DTITractographyBenchmark(size));
+#endif
+    runner.AddBenchmark(new anima::EPGSignalSimulationBenchmark(20000));
+    runner.AddBenchmark(new anima::NonLocalMeansBenchmark(size));
+    runner.AddBenchmark(new anima::GraphCutBenchmark(size));
+    runner.AddBenchmark(new anima::InstrumentationOverheadBenchmark(1000000));
+
+    if (listArg.isSet())
+    {
+        std::vector <std::string> names = runner.GetBenchmarkNames();
+        for (unsigned int i = 0;i < names.size();++i)
+            std::cout << names[i] << std::endl;
+
+        return EXIT_SUCCESS;
+    }
+
+    if (threadsArg.getValue() != "")
+    {
+        std::vector <unsigned int> threadCounts;
+        std::istringstream threadsStream(threadsArg.getValue());
+        std::string threadString;
+        while (std::getline(threadsStream,threadString,','))
+        {
+            if (threadString == "")
+                continue;
+
+            try
+            {
+                threadCounts.push_back(std::max(std::stoi(threadString),1));
+            }
+            catch (std::logic_error &)
+            {
+                std::cerr << "Error: invalid number of threads " << threadString << " in " << threadsArg.getValue() << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        runner.SetThreadCounts(threadCounts);
+    }
+
+    runner.SetNumberOfRepetitions(std::max(repetitionsArg.getValue(),1U));
+    runner.SetNameFilter(filterArg.getValue());
+
+    unsigned int numRegressions = 0;
+    try
+    {
+        runner.Update();
+
+        if (baselineArg.getValue() != "")
+            numRegressions = runner.CompareToBaseline(baselineArg.getValue(),thresholdArg.getValue());
+
+        runner.WriteResults(outArg.getValue());
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        std::cerr << e << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (numRegressions != 0)
+    {
+        std::cerr << numRegressions << " performance regression(s) against " << baselineArg.getValue() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
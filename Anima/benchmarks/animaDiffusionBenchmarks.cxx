@@ -0,0 +1,131 @@
+#include "animaDiffusionBenchmarks.h"
+
+#include <animaMCMConstants.h>
+#include <animaMultiCompartmentModelCreator.h>
+
+#include <cmath>
+#include <iostream>
+
+namespace anima
+{
+
+void MCMPredictedSignalBenchmark::Initialize()
+{
+    anima::MultiCompartmentModelCreator mcmCreator;
+    mcmCreator.SetCompartmentType(anima::Zeppelin);
+    mcmCreator.SetNumberOfCompartments(1);
+    mcmCreator.SetModelWithFreeWaterComponent(true);
+    mcmCreator.SetModelWithStationaryWaterComponent(false);
+    mcmCreator.SetModelWithRestrictedWaterComponent(false);
+    mcmCreator.SetModelWithStaniszComponent(false);
+
+    m_Model = mcmCreator.GetNewMultiCompartmentModel();
+    m_Model->GetCompartment(1)->SetAxialDiffusivity(1.7e-3);
+    m_Model->GetCompartment(1)->SetRadialDiffusivity1(0.3e-3);
+
+    anima::MultiCompartmentModel::ListType weights(2);
+    weights[0] = 0.3;
+    weights[1] = 0.7;
+    m_Model->SetCompartmentWeights(weights);
+
+    const double bValues[3] = {1000, 2000, 3000};
+    std::vector <PhantomGradientType> directions = generateGradientDirections(30);
+    m_Gradients.clear();
+    m_GradientStrengths.clear();
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        double gradientStrength = anima::GetGradientStrengthFromBValue(bValues[i], anima::DiffusionSmallDelta,
+                                                                       anima::DiffusionBigDelta);
+        for (unsigned int j = 0;j < directions.size();++j)
+        {
+            m_Gradients.push_back(directions[j]);
+            m_GradientStrengths.push_back(gradientStrength);
+        }
+    }
+
+    m_Orientations = generateGradientDirections(97);
+}
+
+void MCMPredictedSignalBenchmark::Run(unsigned int numThreads)
+{
+    anima::BaseCompartment *zeppelinCompartment = m_Model->GetCompartment(1);
+    unsigned int numGradients = m_Gradients.size();
+    unsigned int numOrientations = m_Orientations.size();
+
+    // Orientation changes between evaluations, as when an optimizer updates the model
+    double signalSum = 0;
+    for (unsigned int i = 0;i < m_NumberOfEvaluations;++i)
+    {
+        const PhantomGradientType &orientation = m_Orientations[i % numOrientations];
+        zeppelinCompartment->SetOrientationTheta(std::acos(orientation[2]));
+        zeppelinCompartment->SetOrientationPhi(std::atan2(orientation[1],orientation[0]));
+
+        unsigned int gradientIndex = i % numGradients;
+        signalSum += m_Model->GetPredictedSignal(anima::DiffusionSmallDelta, anima::DiffusionBigDelta,
+                                                 m_GradientStrengths[gradientIndex], m_Gradients[gradientIndex]);
+    }
+
+    // Keeps the loop from being optimized out
+    if (std::isnan(signalSum))
+        std::cerr << "Invalid predicted signal" << std::endl;
+}
+
+void MCMEstimationBenchmark::Initialize()
+{
+    std::vector <double> bValues(2);
+    bValues[0] = 1000;
+    bValues[1] = 2000;
+    MultiShellDWIPhantom phantom = generateMultiShellDWIPhantom(m_Size, bValues, 16, 10.0, 41);
+
+    m_EstimationFilter = EstimationFilterType::New();
+    std::vector <double> gradientStrengths(phantom.Gradients.size());
+    for (unsigned int i = 0;i < phantom.Images.size();++i)
+    {
+        m_EstimationFilter->SetInput(i, phantom.Images[i]);
+        m_EstimationFilter->AddGradientDirection(i, phantom.Gradients[i]);
+        gradientStrengths[i] = anima::GetGradientStrengthFromBValue(phantom.BValues[i], anima::DiffusionSmallDelta,
+                                                                    anima::DiffusionBigDelta);
+    }
+
+    m_EstimationFilter->SetGradientStrengths(gradientStrengths);
+    m_EstimationFilter->SetSmallDelta(anima::DiffusionSmallDelta);
+    m_EstimationFilter->SetBigDelta(anima::DiffusionBigDelta);
+    m_EstimationFilter->SetB0Threshold(10.0);
+
+    m_EstimationFilter->SetModelWithFreeWaterComponent(true);
+    m_EstimationFilter->SetModelWithStationaryWaterComponent(false);
+    m_EstimationFilter->SetModelWithRestrictedWaterComponent(false);
+    m_EstimationFilter->SetModelWithStaniszComponent(false);
+    m_EstimationFilter->SetCompartmentType(anima::Zeppelin);
+    m_EstimationFilter->SetNumberOfCompartments(1);
+    m_EstimationFilter->SetFindOptimalNumberOfCompartments(false);
+
+    std::string optimizer = "bobyqa";
+    m_EstimationFilter->SetOptimizer(optimizer);
+    m_EstimationFilter->SetAbsoluteCostChange(0.01);
+    m_EstimationFilter->SetNoiseType(EstimationFilterType::Gaussian);
+    m_EstimationFilter->SetMLEstimationStrategy(EstimationFilterType::Profile);
+    m_EstimationFilter->SetXTolerance(0);
+    m_EstimationFilter->SetFTolerance(0);
+    m_EstimationFilter->SetMaxEval(0);
+
+    m_EstimationFilter->SetUseConstrainedDiffusivity(false);
+    m_EstimationFilter->SetUseConstrainedFreeWaterDiffusivity(true);
+    m_EstimationFilter->SetUseConstrainedIRWDiffusivity(true);
+    m_EstimationFilter->SetUseConstrainedStaniszDiffusivity(true);
+    m_EstimationFilter->SetUseConstrainedStaniszRadius(true);
+    m_EstimationFilter->SetUseConstrainedOrientationConcentration(false);
+    m_EstimationFilter->SetUseConstrainedExtraAxonalFraction(false);
+    m_EstimationFilter->SetUseCommonDiffusivities(false);
+    m_EstimationFilter->SetUseCommonConcentrations(false);
+    m_EstimationFilter->SetUseCommonExtraAxonalFractions(false);
+}
+
+void MCMEstimationBenchmark::Run(unsigned int numThreads)
+{
+    m_EstimationFilter->SetNumberOfWorkUnits(numThreads);
+    m_EstimationFilter->Modified();
+    m_EstimationFilter->Update();
+}
+
+} // end namespace anima
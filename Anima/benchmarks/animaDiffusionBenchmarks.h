@@ -0,0 +1,48 @@
+#pragma once
+
+#include <animaBaseBenchmark.h>
+#include <animaSyntheticPhantoms.h>
+
+#include <animaMCMEstimatorImageFilter.h>
+#include <animaMultiCompartmentModel.h>
+
+namespace anima
+{
+
+//! Predicted signals of a free water and zeppelin model over a multi-shell scheme and varying orientations
+class MCMPredictedSignalBenchmark : public BaseBenchmark
+{
+public:
+    MCMPredictedSignalBenchmark(unsigned int numEvaluations) {m_NumberOfEvaluations = numEvaluations;}
+
+    std::string GetName() ITK_OVERRIDE {return "mcm_predicted_signal";}
+    bool GetThreaded() ITK_OVERRIDE {return false;}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+private:
+    unsigned int m_NumberOfEvaluations;
+    anima::MultiCompartmentModel::Pointer m_Model;
+
+    std::vector <PhantomGradientType> m_Gradients, m_Orientations;
+    std::vector <double> m_GradientStrengths;
+};
+
+//! Voxelwise estimation of a free water and zeppelin model on a small multi-shell phantom
+class MCMEstimationBenchmark : public BaseBenchmark
+{
+public:
+    MCMEstimationBenchmark(unsigned int size) {m_Size = size;}
+
+    std::string GetName() ITK_OVERRIDE {return "mcm_estimation";}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+    typedef anima::MCMEstimatorImageFilter <double,double> EstimationFilterType;
+
+private:
+    unsigned int m_Size;
+    EstimationFilterType::Pointer m_EstimationFilter;
+};
+
+} // end namespace anima
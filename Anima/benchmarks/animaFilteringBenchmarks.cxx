@@ -0,0 +1,43 @@
+#include "animaFilteringBenchmarks.h"
+
+#include <itkImageRegionIterator.h>
+
+#include <random>
+
+namespace anima
+{
+
+void NonLocalMeansBenchmark::Initialize()
+{
+    PhantomImageType::Pointer noisyImage = generateAnatomicalPhantom(m_Size);
+
+    std::mt19937 generator(53);
+    std::normal_distribution <double> noiseDistribution(0, 30.0);
+
+    itk::ImageRegionIterator <PhantomImageType> imageItr(noisyImage, noisyImage->GetLargestPossibleRegion());
+    while (!imageItr.IsAtEnd())
+    {
+        imageItr.Set(imageItr.Get() + noiseDistribution(generator));
+        ++imageItr;
+    }
+
+    m_Filter = FilterType::New();
+    m_Filter->SetInput(noisyImage);
+    m_Filter->SetWeightThreshold(0.0);
+    m_Filter->SetPatchHalfSize(1);
+    m_Filter->SetSearchStepSize(1);
+    m_Filter->SetSearchNeighborhood(5);
+    m_Filter->SetBetaParameter(1.0);
+    m_Filter->SetMeanMinThreshold(0.95);
+    m_Filter->SetVarMinThreshold(0.5);
+    m_Filter->SetWeightMethod(FilterType::EXP);
+}
+
+void NonLocalMeansBenchmark::Run(unsigned int numThreads)
+{
+    m_Filter->SetNumberOfWorkUnits(numThreads);
+    m_Filter->Modified();
+    m_Filter->Update();
+}
+
+} // end namespace anima
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <animaBaseBenchmark.h>
+#include <animaSyntheticPhantoms.h>
+
+#include <animaNonLocalMeansImageFilter.h>
+
+namespace anima
+{
+
+//! Non local means denoising of the noisy phantom, default parameters of animaNLMeans
+class NonLocalMeansBenchmark : public BaseBenchmark
+{
+public:
+    NonLocalMeansBenchmark(unsigned int size) {m_Size = size;}
+
+    std::string GetName() ITK_OVERRIDE {return "nl_means";}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+    typedef anima::NonLocalMeansImageFilter <PhantomImageType> FilterType;
+
+private:
+    unsigned int m_Size;
+    FilterType::Pointer m_Filter;
+};
+
+} // end namespace anima
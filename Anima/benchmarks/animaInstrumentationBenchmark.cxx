@@ -0,0 +1,31 @@
+#include "animaInstrumentationBenchmark.h"
+
+#include <animaInstrumentation.h>
+
+#include <cmath>
+
+namespace anima
+{
+
+void InstrumentationOverheadBenchmark::Run(unsigned int numThreads)
+{
+    ANIMA_INSTRUMENT_SCOPE("instrumentation_overhead");
+
+    double result = 0;
+    for (unsigned int i = 0;i < m_NumberOfIterations;++i)
+    {
+        ANIMA_INSTRUMENT_SCOPE("outer_point");
+        {
+            ANIMA_INSTRUMENT_SCOPE("inner_point");
+            result += std::sqrt(static_cast <double> (i));
+        }
+
+        ANIMA_INSTRUMENT_COUNT("overhead_points",1);
+        ANIMA_INSTRUMENT_HISTOGRAM("overhead_values",i);
+    }
+
+    // Kept so that the workload is not optimized out
+    m_Result = result;
+}
+
+} // end namespace anima
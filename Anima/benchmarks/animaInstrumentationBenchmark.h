@@ -0,0 +1,30 @@
+#pragma once
+
+#include <animaBaseBenchmark.h>
+
+#include <itkMacro.h>
+
+namespace anima
+{
+
+/**
+ * @brief Cost of instrumentation points: nested scopes, a counter and a histogram around a tiny workload, repeated.
+ * Compared between builds with and without USE_INSTRUMENTATION (and with or without --instrumentation output),
+ * it gives the overhead instrumented hot paths pay.
+ */
+class InstrumentationOverheadBenchmark : public BaseBenchmark
+{
+public:
+    InstrumentationOverheadBenchmark(unsigned int numIterations) {m_NumberOfIterations = numIterations;}
+
+    std::string GetName() ITK_OVERRIDE {return "instrumentation_overhead";}
+    bool GetThreaded() ITK_OVERRIDE {return false;}
+    void Initialize() ITK_OVERRIDE {}
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+private:
+    unsigned int m_NumberOfIterations;
+    double m_Result;
+};
+
+} // end namespace anima
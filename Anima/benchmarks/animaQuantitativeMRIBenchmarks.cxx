@@ -0,0 +1,35 @@
+#include "animaQuantitativeMRIBenchmarks.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace anima
+{
+
+void EPGSignalSimulationBenchmark::Initialize()
+{
+    m_Simulator.SetNumberOfEchoes(32);
+    m_Simulator.SetEchoSpacing(9);
+    m_Simulator.SetExcitationFlipAngle(M_PI / 2.0);
+}
+
+void EPGSignalSimulationBenchmark::Run(unsigned int numThreads)
+{
+    const unsigned int numT2Values = 100;
+    double signalSum = 0;
+    for (unsigned int i = 0;i < m_NumberOfSimulations;++i)
+    {
+        // T2 from 10 to 1000 ms, B1 from 0.7 to 1.3
+        double t2Value = 10.0 + 990.0 * (i % numT2Values) / (numT2Values - 1.0);
+        double b1Value = 0.7 + 0.6 * (i / numT2Values % 61) / 60.0;
+
+        anima::EPGSignalSimulator::RealVectorType &echoValues = m_Simulator.GetValue(1000.0, t2Value, b1Value * M_PI, 1.0);
+        signalSum += echoValues[0];
+    }
+
+    // Keeps the loop from being optimized out
+    if (std::isnan(signalSum))
+        std::cerr << "Invalid EPG signal" << std::endl;
+}
+
+} // end namespace anima
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <animaBaseBenchmark.h>
+
+#include <animaEPGSignalSimulator.h>
+
+namespace anima
+{
+
+//! EPG simulation of multi-echo T2 signals over a grid of T2 and B1 values, as done by T2 relaxometry estimators
+class EPGSignalSimulationBenchmark : public BaseBenchmark
+{
+public:
+    EPGSignalSimulationBenchmark(unsigned int numSimulations) {m_NumberOfSimulations = numSimulations;}
+
+    std::string GetName() ITK_OVERRIDE {return "epg_signal_simulation";}
+    bool GetThreaded() ITK_OVERRIDE {return false;}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+private:
+    unsigned int m_NumberOfSimulations;
+    anima::EPGSignalSimulator m_Simulator;
+};
+
+} // end namespace anima
@@ -0,0 +1,174 @@
+#include "animaRegistrationBenchmarks.h"
+
+#include <animaLogTensorImageFilter.h>
+#include <animaVectorModelLinearInterpolateImageFunction.h>
+#include <rpiDisplacementFieldTransform.h>
+
+#include <itkAffineTransform.h>
+#include <itkLinearInterpolateImageFunction.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace anima
+{
+
+typedef rpi::DisplacementFieldTransform <double,3> BenchmarkFieldTransformType;
+
+//! Phantom warped by a smooth displacement field of 2mm maximal amplitude
+PhantomImageType::Pointer generateWarpedAnatomicalPhantom(unsigned int size)
+{
+    PhantomImageType::Pointer referenceImage = generateAnatomicalPhantom(size);
+
+    BenchmarkFieldTransformType::Pointer fieldTransform = BenchmarkFieldTransformType::New();
+    PhantomFieldImageType::Pointer field = generateSmoothField(size, 2.0, 17);
+    fieldTransform->SetParametersAsVectorField(field.GetPointer());
+
+    typedef anima::ResampleImageFilter <PhantomImageType,PhantomImageType,double> ResampleFilterType;
+    ResampleFilterType::Pointer resampler = ResampleFilterType::New();
+    resampler->SetTransform(fieldTransform);
+    resampler->SetInterpolator(itk::LinearInterpolateImageFunction <PhantomImageType,double>::New());
+    resampler->SetOutputParametersFromImage(referenceImage);
+    resampler->SetInput(referenceImage);
+    resampler->Update();
+
+    PhantomImageType::Pointer warpedImage = resampler->GetOutput();
+    warpedImage->DisconnectPipeline();
+
+    return warpedImage;
+}
+
+void BlockMatchingBenchmark::Initialize()
+{
+    m_BlockMatcher.reset(new BlockMatcherType);
+    m_BlockMatcher->SetReferenceImage(generateAnatomicalPhantom(m_Size));
+    m_BlockMatcher->SetMovingImage(generateWarpedAnatomicalPhantom(m_Size));
+    m_BlockMatcher->SetBlockGenerationMask(generateForegroundMask(m_Size));
+
+    m_BlockMatcher->SetBlockSize(5);
+    m_BlockMatcher->SetBlockSpacing(3);
+    m_BlockMatcher->SetBlockVarianceThreshold(5);
+    m_BlockMatcher->SetBlockPercentageKept(0.8);
+    m_BlockMatcher->SetSearchRadius(2);
+    m_BlockMatcher->SetFinalRadius(0.001);
+    m_BlockMatcher->SetStepSize(1);
+    m_BlockMatcher->SetOptimizerMaximumIterations(100);
+    m_BlockMatcher->SetOptimizerType(BlockMatcherType::Bobyqa);
+    m_BlockMatcher->SetSimilarityType(BlockMatcherType::Correlation);
+    m_BlockMatcher->SetBlockTransformType(BlockMatcherType::Translation);
+    m_BlockMatcher->SetVerbose(false);
+
+    // Block generation and fixed block values are not part of the timed matching
+    m_BlockMatcher->InitializeBlocks();
+
+    unsigned int numBlocks = m_BlockMatcher->GetBlockTransformPointers().size();
+    m_InitialParameters.resize(numBlocks);
+    for (unsigned int i = 0;i < numBlocks;++i)
+        m_InitialParameters[i] = m_BlockMatcher->GetBlockTransformPointer(i)->GetParameters();
+}
+
+void BlockMatchingBenchmark::Run(unsigned int numThreads)
+{
+    for (unsigned int i = 0;i < m_InitialParameters.size();++i)
+        m_BlockMatcher->GetBlockTransformPointer(i)->SetParameters(m_InitialParameters[i]);
+
+    m_BlockMatcher->SetNumberOfWorkUnits(numThreads);
+    m_BlockMatcher->Update();
+}
+
+void SVFExponentialBenchmark::Initialize()
+{
+    m_ExponentialFilter = ExponentialFilterType::New();
+    m_ExponentialFilter->SetInput(generateSmoothField(m_Size, 5.0, 23));
+    m_ExponentialFilter->SetExponentiationOrder(0);
+    m_ExponentialFilter->SetMaximalDisplacementAmplitude(0.25);
+}
+
+void SVFExponentialBenchmark::Run(unsigned int numThreads)
+{
+    m_ExponentialFilter->SetNumberOfWorkUnits(numThreads);
+    m_ExponentialFilter->Modified();
+    m_ExponentialFilter->Update();
+}
+
+void ScalarDenseResamplingBenchmark::Initialize()
+{
+    PhantomImageType::Pointer referenceImage = generateAnatomicalPhantom(m_Size);
+
+    BenchmarkFieldTransformType::Pointer fieldTransform = BenchmarkFieldTransformType::New();
+    PhantomFieldImageType::Pointer field = generateSmoothField(m_Size, 4.0, 31);
+    fieldTransform->SetParametersAsVectorField(field.GetPointer());
+
+    m_Resampler = ResampleFilterType::New();
+    m_Resampler->SetTransform(fieldTransform);
+    m_Resampler->SetInterpolator(itk::LinearInterpolateImageFunction <PhantomImageType,double>::New());
+    m_Resampler->SetOutputParametersFromImage(referenceImage);
+    m_Resampler->SetInput(referenceImage);
+}
+
+void ScalarDenseResamplingBenchmark::Run(unsigned int numThreads)
+{
+    m_Resampler->SetNumberOfWorkUnits(numThreads);
+    m_Resampler->Modified();
+    m_Resampler->Update();
+}
+
+template <class TImageType>
+void TensorAffineResamplingBenchmark <TImageType>::Initialize()
+{
+    typedef anima::LogTensorImageFilter <double,3> LogTensorFilterType;
+    LogTensorFilterType::Pointer tensorLogger = LogTensorFilterType::New();
+    tensorLogger->SetInput(generateDTIPhantom(m_Size));
+    tensorLogger->SetScaleNonDiagonal(true);
+    tensorLogger->Update();
+
+    // Fixed length tensor pixels have the same buffer layout as the vector image
+    PhantomVectorImageType *vectorLogTensorImage = tensorLogger->GetOutput();
+    typename TImageType::Pointer logTensorImage = TImageType::New();
+    logTensorImage->CopyInformation(vectorLogTensorImage);
+    logTensorImage->SetRegions(vectorLogTensorImage->GetLargestPossibleRegion());
+    logTensorImage->Allocate();
+
+    unsigned int bufferSize = vectorLogTensorImage->GetLargestPossibleRegion().GetNumberOfPixels() *
+            vectorLogTensorImage->GetNumberOfComponentsPerPixel();
+    std::copy(vectorLogTensorImage->GetBufferPointer(),vectorLogTensorImage->GetBufferPointer() + bufferSize,
+              reinterpret_cast <double *> (logTensorImage->GetBufferPointer()));
+
+    // Rotation of 10 degrees around z and a small shear, centered on the image
+    typedef itk::AffineTransform <double,3> AffineTransformType;
+    AffineTransformType::Pointer affineTransform = AffineTransformType::New();
+    AffineTransformType::InputPointType center;
+    for (unsigned int i = 0;i < 3;++i)
+        center[i] = (m_Size - 1.0) / 2.0;
+
+    AffineTransformType::OutputVectorType zAxis;
+    zAxis.Fill(0);
+    zAxis[2] = 1;
+
+    affineTransform->SetCenter(center);
+    affineTransform->Rotate3D(zAxis, 10.0 * M_PI / 180.0);
+    affineTransform->Shear(0, 2, 0.05);
+
+    m_Resampler = ResampleFilterType::New();
+    m_Resampler->SetTransform(affineTransform);
+    m_Resampler->SetFiniteStrainReorientation(true);
+    m_Resampler->SetInterpolator(anima::VectorModelLinearInterpolateImageFunction <TImageType>::New().GetPointer());
+    m_Resampler->SetOutputLargestPossibleRegion(logTensorImage->GetLargestPossibleRegion());
+    m_Resampler->SetOutputOrigin(logTensorImage->GetOrigin());
+    m_Resampler->SetOutputSpacing(logTensorImage->GetSpacing());
+    m_Resampler->SetOutputDirection(logTensorImage->GetDirection());
+    m_Resampler->SetInput(logTensorImage);
+}
+
+template <class TImageType>
+void TensorAffineResamplingBenchmark <TImageType>::Run(unsigned int numThreads)
+{
+    m_Resampler->SetNumberOfWorkUnits(numThreads);
+    m_Resampler->Modified();
+    m_Resampler->Update();
+}
+
+template class TensorAffineResamplingBenchmark <PhantomVectorImageType>;
+template class TensorAffineResamplingBenchmark <PhantomTensorImageType>;
+
+} // end namespace anima
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <animaBaseBenchmark.h>
+#include <animaSyntheticPhantoms.h>
+
+#include <animaAnatomicalBlockMatcher.h>
+#include <animaResampleImageFilter.h>
+#include <animaSVFExponentialImageFilter.h>
+#include <animaTensorResampleImageFilter.h>
+
+#include <memory>
+
+namespace anima
+{
+
+//! One iteration of block matching (translations, correlation, Bobyqa) between the phantom and a warped copy
+class BlockMatchingBenchmark : public BaseBenchmark
+{
+public:
+    BlockMatchingBenchmark(unsigned int size) {m_Size = size;}
+
+    std::string GetName() ITK_OVERRIDE {return "block_matching";}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+    typedef anima::AnatomicalBlockMatcher <PhantomImageType> BlockMatcherType;
+
+private:
+    unsigned int m_Size;
+    std::unique_ptr <BlockMatcherType> m_BlockMatcher;
+
+    //! Block transforms are reset before each run, otherwise runs would start from the previous optimum
+    std::vector <BlockMatcherType::BaseInputTransformType::ParametersType> m_InitialParameters;
+};
+
+//! Exponentiation of a smooth stationary velocity field (scaling and squaring)
+class SVFExponentialBenchmark : public BaseBenchmark
+{
+public:
+    SVFExponentialBenchmark(unsigned int size) {m_Size = size;}
+
+    std::string GetName() ITK_OVERRIDE {return "svf_exponential";}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+    typedef anima::SVFExponentialImageFilter <double,3> ExponentialFilterType;
+
+private:
+    unsigned int m_Size;
+    ExponentialFilterType::Pointer m_ExponentialFilter;
+};
+
+//! Linear resampling of the scalar phantom through a dense displacement field
+class ScalarDenseResamplingBenchmark : public BaseBenchmark
+{
+public:
+    ScalarDenseResamplingBenchmark(unsigned int size) {m_Size = size;}
+
+    std::string GetName() ITK_OVERRIDE {return "resampling_scalar_dense";}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+    typedef anima::ResampleImageFilter <PhantomImageType,PhantomImageType,double> ResampleFilterType;
+
+private:
+    unsigned int m_Size;
+    ResampleFilterType::Pointer m_Resampler;
+};
+
+/**
+ * Linear resampling of log tensors through an affine transform with finite strain reorientation, on a vector image
+ * (PhantomVectorImageType) or on fixed length tensor pixels (PhantomTensorImageType)
+ */
+template <class TImageType>
+class TensorAffineResamplingBenchmark : public BaseBenchmark
+{
+public:
+    TensorAffineResamplingBenchmark(unsigned int size, const std::string &name)
+    {
+        m_Size = size;
+        m_Name = name;
+    }
+
+    std::string GetName() ITK_OVERRIDE {return m_Name;}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+    typedef anima::TensorResampleImageFilter <TImageType,double> ResampleFilterType;
+
+private:
+    unsigned int m_Size;
+    std::string m_Name;
+    typename ResampleFilterType::Pointer m_Resampler;
+};
+
+} // end namespace anima
@@ -0,0 +1,69 @@
+#include "animaSegmentationBenchmarks.h"
+
+#include <itkImageRegionIterator.h>
+
+#include <cmath>
+#include <random>
+
+namespace anima
+{
+
+void GraphCutBenchmark::Initialize()
+{
+    PhantomImageType::Pointer anatomicalImage = generateAnatomicalPhantom(m_Size);
+    PhantomMaskImageType::Pointer lesionMask = generateLesionMask(m_Size, 12, 61);
+
+    PhantomDoubleImageType::Pointer image = createPhantomImage <PhantomDoubleImageType> (m_Size);
+    image->Allocate();
+    PhantomDoubleImageType::Pointer sourcesImage = createPhantomImage <PhantomDoubleImageType> (m_Size);
+    sourcesImage->Allocate();
+    PhantomDoubleImageType::Pointer sinksImage = createPhantomImage <PhantomDoubleImageType> (m_Size);
+    sinksImage->Allocate();
+
+    std::mt19937 generator(67);
+    std::normal_distribution <double> noiseDistribution(0, 30.0);
+
+    // Bright noisy lesions, t-links from a sigmoid of the intensity
+    itk::ImageRegionIterator <PhantomImageType> anatomicalItr(anatomicalImage, anatomicalImage->GetLargestPossibleRegion());
+    itk::ImageRegionIterator <PhantomDoubleImageType> imageItr(image, image->GetLargestPossibleRegion());
+    itk::ImageRegionIterator <PhantomMaskImageType> lesionItr(lesionMask, lesionMask->GetLargestPossibleRegion());
+    itk::ImageRegionIterator <PhantomDoubleImageType> sourcesItr(sourcesImage, sourcesImage->GetLargestPossibleRegion());
+    itk::ImageRegionIterator <PhantomDoubleImageType> sinksItr(sinksImage, sinksImage->GetLargestPossibleRegion());
+    while (!imageItr.IsAtEnd())
+    {
+        double value = anatomicalItr.Get();
+        if (lesionItr.Get() != 0)
+            value = 1000.0;
+
+        value += noiseDistribution(generator);
+        imageItr.Set(value);
+
+        double sourceProbability = 1.0 / (1.0 + std::exp(- (value - 900.0) / 40.0));
+        sourcesItr.Set(sourceProbability);
+        sinksItr.Set(1.0 - sourceProbability);
+
+        ++anatomicalItr;
+        ++imageItr;
+        ++lesionItr;
+        ++sourcesItr;
+        ++sinksItr;
+    }
+
+    m_GraphFilter = GraphFilterType::New();
+    m_GraphFilter->SetInputImage(0, image);
+    m_GraphFilter->SetMask(generateForegroundMask(m_Size));
+    m_GraphFilter->SetInputSeedProbaSources(sourcesImage);
+    m_GraphFilter->SetInputSeedProbaSinks(sinksImage);
+    m_GraphFilter->SetSigma(0.6);
+    m_GraphFilter->SetUseSpectralGradient(false);
+    m_GraphFilter->SetVerbose(false);
+}
+
+void GraphCutBenchmark::Run(unsigned int numThreads)
+{
+    m_GraphFilter->SetNumberOfWorkUnits(numThreads);
+    m_GraphFilter->Modified();
+    m_GraphFilter->Update();
+}
+
+} // end namespace anima
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <animaBaseBenchmark.h>
+#include <animaSyntheticPhantoms.h>
+
+#include <animaGraph3DFilter.h>
+
+namespace anima
+{
+
+//! Graph cut of phantom lesions from intensity based t-links, without spectral gradient
+class GraphCutBenchmark : public BaseBenchmark
+{
+public:
+    GraphCutBenchmark(unsigned int size) {m_Size = size;}
+
+    std::string GetName() ITK_OVERRIDE {return "graph_cut";}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+    typedef anima::Graph3DFilter <PhantomDoubleImageType, PhantomMaskImageType> GraphFilterType;
+
+private:
+    unsigned int m_Size;
+    GraphFilterType::Pointer m_GraphFilter;
+};
+
+} // end namespace anima
@@ -0,0 +1,415 @@
+#include "animaSyntheticPhantoms.h"
+
+#include <animaBaseTensorTools.h>
+#include <animaEPGSignalSimulator.h>
+#include <animaMCMConstants.h>
+#include <animaMultiCompartmentModelCreator.h>
+
+#include <itkImageRegionIteratorWithIndex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace anima
+{
+
+//! Tissue classes of the phantom head: 0 background, 1 CSF, 2 grey matter, 3 white matter
+unsigned int getPhantomTissue(const itk::Index <3> &index, unsigned int size)
+{
+    const double axes[3] = {0.85, 0.95, 0.8};
+    double radius = 0;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        double coordinate = (2.0 * index[i] / (size - 1.0) - 1.0) / axes[i];
+        radius += coordinate * coordinate;
+    }
+
+    radius = std::sqrt(radius);
+    if (radius < 0.6)
+        return 3;
+    else if (radius < 0.8)
+        return 2;
+    else if (radius < 1.0)
+        return 1;
+
+    return 0;
+}
+
+//! Orientation of the circular bundle around the z axis, returns false outside of the bundle
+bool getPhantomBundleOrientation(const itk::Index <3> &index, unsigned int size, PhantomGradientType &orientation)
+{
+    double center = (size - 1.0) / 2.0;
+    double x = index[0] - center;
+    double y = index[1] - center;
+    double z = index[2] - center;
+
+    double rho = std::sqrt(x * x + y * y);
+    if ((std::abs(rho - 0.3 * size) > 0.08 * size) || (std::abs(z) > 0.15 * size) || (rho == 0))
+    {
+        orientation[0] = 0;
+        orientation[1] = 0;
+        orientation[2] = 1;
+        return false;
+    }
+
+    orientation[0] = - y / rho;
+    orientation[1] = x / rho;
+    orientation[2] = 0;
+    return true;
+}
+
+PhantomImageType::Pointer generateAnatomicalPhantom(unsigned int size)
+{
+    PhantomImageType::Pointer image = createPhantomImage <PhantomImageType> (size);
+    image->Allocate();
+
+    const double tissueValues[4] = {0, 300, 600, 800};
+    double frequency = 2.0 * M_PI * 3.0 / size;
+
+    typedef itk::ImageRegionIteratorWithIndex <PhantomImageType> IteratorType;
+    IteratorType imageItr(image, image->GetLargestPossibleRegion());
+    while (!imageItr.IsAtEnd())
+    {
+        PhantomImageType::IndexType index = imageItr.GetIndex();
+        unsigned int tissue = getPhantomTissue(index,size);
+
+        double value = tissueValues[tissue];
+        if (tissue != 0)
+            value += 20.0 * std::sin(frequency * index[0]) * std::sin(frequency * index[1]) * std::cos(frequency * index[2]);
+
+        imageItr.Set(value);
+        ++imageItr;
+    }
+
+    return image;
+}
+
+PhantomMaskImageType::Pointer generateForegroundMask(unsigned int size)
+{
+    PhantomMaskImageType::Pointer mask = createPhantomImage <PhantomMaskImageType> (size);
+    mask->Allocate();
+
+    typedef itk::ImageRegionIteratorWithIndex <PhantomMaskImageType> IteratorType;
+    IteratorType maskItr(mask, mask->GetLargestPossibleRegion());
+    while (!maskItr.IsAtEnd())
+    {
+        maskItr.Set(getPhantomTissue(maskItr.GetIndex(),size) != 0);
+        ++maskItr;
+    }
+
+    return mask;
+}
+
+PhantomMaskImageType::Pointer generateLesionMask(unsigned int size, unsigned int numLesions, unsigned int seed)
+{
+    PhantomMaskImageType::Pointer mask = createPhantomImage <PhantomMaskImageType> (size);
+    mask->Allocate();
+    mask->FillBuffer(0);
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution <double> positionDistribution(0.35 * size, 0.65 * size);
+    std::uniform_real_distribution <double> radiusDistribution(0.02 * size, 0.05 * size);
+
+    std::vector <double> centers(3 * numLesions);
+    std::vector <double> radii(numLesions);
+    for (unsigned int i = 0;i < numLesions;++i)
+    {
+        for (unsigned int j = 0;j < 3;++j)
+            centers[3 * i + j] = positionDistribution(generator);
+
+        radii[i] = radiusDistribution(generator);
+    }
+
+    typedef itk::ImageRegionIteratorWithIndex <PhantomMaskImageType> IteratorType;
+    IteratorType maskItr(mask, mask->GetLargestPossibleRegion());
+    while (!maskItr.IsAtEnd())
+    {
+        PhantomMaskImageType::IndexType index = maskItr.GetIndex();
+        if (getPhantomTissue(index,size) != 3)
+        {
+            ++maskItr;
+            continue;
+        }
+
+        for (unsigned int i = 0;i < numLesions;++i)
+        {
+            double distance = 0;
+            for (unsigned int j = 0;j < 3;++j)
+                distance += (index[j] - centers[3 * i + j]) * (index[j] - centers[3 * i + j]);
+
+            if (distance < radii[i] * radii[i])
+            {
+                maskItr.Set(1);
+                break;
+            }
+        }
+
+        ++maskItr;
+    }
+
+    return mask;
+}
+
+PhantomFieldImageType::Pointer generateSmoothField(unsigned int size, double amplitude, unsigned int seed)
+{
+    PhantomFieldImageType::Pointer field = createPhantomImage <PhantomFieldImageType> (size);
+    field->Allocate();
+
+    const unsigned int numTerms = 3;
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution <double> phaseDistribution(0, 2.0 * M_PI);
+
+    double phases[3][numTerms][2];
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        for (unsigned int j = 0;j < numTerms;++j)
+        {
+            phases[i][j][0] = phaseDistribution(generator);
+            phases[i][j][1] = phaseDistribution(generator);
+        }
+    }
+
+    // Each component is bounded by amplitude / sqrt(3)
+    double componentAmplitude = amplitude / (std::sqrt(3.0) * numTerms);
+    double baseFrequency = 2.0 * M_PI / size;
+
+    typedef itk::ImageRegionIteratorWithIndex <PhantomFieldImageType> IteratorType;
+    IteratorType fieldItr(field, field->GetLargestPossibleRegion());
+    PhantomFieldImageType::PixelType displacement;
+    while (!fieldItr.IsAtEnd())
+    {
+        PhantomFieldImageType::IndexType index = fieldItr.GetIndex();
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            double firstCoordinate = baseFrequency * index[(i + 1) % 3];
+            double secondCoordinate = baseFrequency * index[(i + 2) % 3];
+
+            displacement[i] = 0;
+            for (unsigned int j = 0;j < numTerms;++j)
+                displacement[i] += std::sin((j + 1) * firstCoordinate + phases[i][j][0]) *
+                        std::cos((j + 1) * secondCoordinate + phases[i][j][1]);
+
+            displacement[i] *= componentAmplitude;
+        }
+
+        fieldItr.Set(displacement);
+        ++fieldItr;
+    }
+
+    return field;
+}
+
+PhantomVectorImageType::Pointer generateDTIPhantom(unsigned int size)
+{
+    PhantomVectorImageType::Pointer image = createPhantomImage <PhantomVectorImageType> (size);
+    image->SetNumberOfComponentsPerPixel(6);
+    image->Allocate();
+
+    const double axialDiffusivity = 1.7e-3;
+    const double radialDiffusivity = 0.3e-3;
+    const double isotropicDiffusivity = 0.9e-3;
+
+    vnl_matrix <double> tensor(3,3);
+    PhantomVectorImageType::PixelType tensorVector(6);
+    PhantomGradientType orientation;
+
+    typedef itk::ImageRegionIteratorWithIndex <PhantomVectorImageType> IteratorType;
+    IteratorType imageItr(image, image->GetLargestPossibleRegion());
+    while (!imageItr.IsAtEnd())
+    {
+        PhantomVectorImageType::IndexType index = imageItr.GetIndex();
+
+        tensor.fill(0);
+        if (getPhantomBundleOrientation(index,size,orientation))
+        {
+            for (unsigned int i = 0;i < 3;++i)
+            {
+                tensor(i,i) = radialDiffusivity;
+                for (unsigned int j = 0;j < 3;++j)
+                    tensor(i,j) += (axialDiffusivity - radialDiffusivity) * orientation[i] * orientation[j];
+            }
+        }
+        else if (getPhantomTissue(index,size) != 0)
+        {
+            for (unsigned int i = 0;i < 3;++i)
+                tensor(i,i) = isotropicDiffusivity;
+        }
+
+        anima::GetVectorRepresentation(tensor,tensorVector,6);
+        imageItr.Set(tensorVector);
+        ++imageItr;
+    }
+
+    return image;
+}
+
+std::vector <PhantomGradientType> generateGradientDirections(unsigned int numDirections)
+{
+    // Fibonacci lattice on the upper half sphere
+    std::vector <PhantomGradientType> directions(numDirections);
+    double goldenAngle = M_PI * (3.0 - std::sqrt(5.0));
+    for (unsigned int i = 0;i < numDirections;++i)
+    {
+        double z = 1.0 - (i + 0.5) / numDirections;
+        double radius = std::sqrt(1.0 - z * z);
+        double angle = goldenAngle * i;
+
+        directions[i][0] = radius * std::cos(angle);
+        directions[i][1] = radius * std::sin(angle);
+        directions[i][2] = z;
+    }
+
+    return directions;
+}
+
+MultiShellDWIPhantom generateMultiShellDWIPhantom(unsigned int size, const std::vector <double> &bValues,
+                                                  unsigned int numDirectionsPerShell, double noiseSigma, unsigned int seed)
+{
+    MultiShellDWIPhantom phantom;
+
+    PhantomGradientType zeroGradient(0.0);
+    phantom.Gradients.push_back(zeroGradient);
+    phantom.BValues.push_back(0);
+
+    std::vector <PhantomGradientType> directions = generateGradientDirections(numDirectionsPerShell);
+    for (unsigned int i = 0;i < bValues.size();++i)
+    {
+        for (unsigned int j = 0;j < numDirectionsPerShell;++j)
+        {
+            phantom.Gradients.push_back(directions[j]);
+            phantom.BValues.push_back(bValues[i]);
+        }
+    }
+
+    unsigned int numGradients = phantom.Gradients.size();
+    std::vector <double> gradientStrengths(numGradients);
+    for (unsigned int i = 0;i < numGradients;++i)
+    {
+        gradientStrengths[i] = anima::GetGradientStrengthFromBValue(phantom.BValues[i], anima::DiffusionSmallDelta,
+                                                                    anima::DiffusionBigDelta);
+    }
+
+    phantom.Images.resize(numGradients);
+    for (unsigned int i = 0;i < numGradients;++i)
+    {
+        phantom.Images[i] = createPhantomImage <PhantomDoubleImageType> (size);
+        phantom.Images[i]->Allocate();
+    }
+
+    anima::MultiCompartmentModelCreator mcmCreator;
+    mcmCreator.SetCompartmentType(anima::Zeppelin);
+    mcmCreator.SetNumberOfCompartments(1);
+    mcmCreator.SetModelWithFreeWaterComponent(true);
+    mcmCreator.SetModelWithStationaryWaterComponent(false);
+    mcmCreator.SetModelWithRestrictedWaterComponent(false);
+    mcmCreator.SetModelWithStaniszComponent(false);
+
+    anima::MultiCompartmentModel::Pointer model = mcmCreator.GetNewMultiCompartmentModel();
+    anima::BaseCompartment *zeppelinCompartment = model->GetCompartment(1);
+    zeppelinCompartment->SetAxialDiffusivity(1.7e-3);
+    zeppelinCompartment->SetRadialDiffusivity1(0.3e-3);
+
+    const double b0Signal = 1000;
+    anima::MultiCompartmentModel::ListType bundleWeights(2), backgroundWeights(2);
+    bundleWeights[0] = 0.2;
+    bundleWeights[1] = 0.8;
+    backgroundWeights[0] = 0.7;
+    backgroundWeights[1] = 0.3;
+
+    std::mt19937 generator(seed);
+    std::normal_distribution <double> noiseDistribution(0, noiseSigma);
+
+    PhantomGradientType orientation;
+    std::vector <double> signals(numGradients);
+
+    typedef itk::ImageRegionIteratorWithIndex <PhantomDoubleImageType> IteratorType;
+    IteratorType indexItr(phantom.Images[0], phantom.Images[0]->GetLargestPossibleRegion());
+    while (!indexItr.IsAtEnd())
+    {
+        PhantomDoubleImageType::IndexType index = indexItr.GetIndex();
+        bool inBundle = getPhantomBundleOrientation(index,size,orientation);
+
+        if (getPhantomTissue(index,size) == 0)
+            std::fill(signals.begin(),signals.end(),0.0);
+        else
+        {
+            zeppelinCompartment->SetOrientationTheta(std::acos(orientation[2]));
+            zeppelinCompartment->SetOrientationPhi(std::atan2(orientation[1],orientation[0]));
+            model->SetCompartmentWeights(inBundle ? bundleWeights : backgroundWeights);
+
+            for (unsigned int i = 0;i < numGradients;++i)
+                signals[i] = b0Signal * model->GetPredictedSignal(anima::DiffusionSmallDelta, anima::DiffusionBigDelta,
+                                                                  gradientStrengths[i], phantom.Gradients[i]);
+        }
+
+        // Rician noise
+        for (unsigned int i = 0;i < numGradients;++i)
+        {
+            double realPart = signals[i] + noiseDistribution(generator);
+            double imaginaryPart = noiseDistribution(generator);
+            phantom.Images[i]->SetPixel(index, std::sqrt(realPart * realPart + imaginaryPart * imaginaryPart));
+        }
+
+        ++indexItr;
+    }
+
+    return phantom;
+}
+
+std::vector <PhantomDoubleImageType::Pointer> generateMultiEchoT2Phantom(unsigned int size, unsigned int numEchoes,
+                                                                         double echoSpacing, double noiseSigma,
+                                                                         unsigned int seed)
+{
+    std::vector <PhantomDoubleImageType::Pointer> echoImages(numEchoes);
+    for (unsigned int i = 0;i < numEchoes;++i)
+    {
+        echoImages[i] = createPhantomImage <PhantomDoubleImageType> (size);
+        echoImages[i]->Allocate();
+    }
+
+    anima::EPGSignalSimulator epgSimulator;
+    epgSimulator.SetNumberOfEchoes(numEchoes);
+    epgSimulator.SetEchoSpacing(echoSpacing);
+    epgSimulator.SetExcitationFlipAngle(M_PI / 2.0);
+
+    // T2 values (ms) by tissue, T1 is fixed
+    const double t1Value = 1000;
+    const double t2Values[4] = {0, 1000, 100, 80};
+    const double m0Values[4] = {0, 1000, 900, 800};
+
+    std::mt19937 generator(seed);
+    std::normal_distribution <double> noiseDistribution(0, noiseSigma);
+    double frequency = 2.0 * M_PI / size;
+    std::vector <double> echoSignals(numEchoes);
+
+    typedef itk::ImageRegionIteratorWithIndex <PhantomDoubleImageType> IteratorType;
+    IteratorType indexItr(echoImages[0], echoImages[0]->GetLargestPossibleRegion());
+    while (!indexItr.IsAtEnd())
+    {
+        PhantomDoubleImageType::IndexType index = indexItr.GetIndex();
+        unsigned int tissue = getPhantomTissue(index,size);
+
+        std::fill(echoSignals.begin(),echoSignals.end(),0.0);
+        if (tissue != 0)
+        {
+            // Smooth B1 inhomogeneity of +/- 15 %
+            double b1Value = 1.0 + 0.15 * std::sin(frequency * index[0]) * std::cos(frequency * index[2]);
+            echoSignals = epgSimulator.GetValue(t1Value, t2Values[tissue], b1Value * M_PI, m0Values[tissue]);
+        }
+
+        // Rician noise
+        for (unsigned int i = 0;i < numEchoes;++i)
+        {
+            double realPart = echoSignals[i] + noiseDistribution(generator);
+            double imaginaryPart = noiseDistribution(generator);
+            echoImages[i]->SetPixel(index, std::sqrt(realPart * realPart + imaginaryPart * imaginaryPart));
+        }
+
+        ++indexItr;
+    }
+
+    return echoImages;
+}
+
+} // end namespace anima
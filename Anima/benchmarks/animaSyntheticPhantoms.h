@@ -0,0 +1,80 @@
+#pragma once
+
+#include <itkImage.h>
+#include <itkVector.h>
+#include <itkVectorImage.h>
+
+#include <vnl/vnl_vector_fixed.h>
+
+#include <vector>
+
+namespace anima
+{
+
+/**
+ * Deterministic synthetic data for benchmarks: no input file is needed and the same size always gives the same
+ * data, so that timings of two runs are comparable. Images are cubes of size voxels, 1mm isotropic.
+ */
+
+typedef itk::Image <float,3> PhantomImageType;
+typedef itk::Image <double,3> PhantomDoubleImageType;
+typedef itk::Image <unsigned char,3> PhantomMaskImageType;
+typedef itk::Image <itk::Vector <double,3>,3> PhantomFieldImageType;
+typedef itk::VectorImage <double,3> PhantomVectorImageType;
+typedef itk::Image <itk::Vector <double,6>,3> PhantomTensorImageType;
+typedef vnl_vector_fixed <double,3> PhantomGradientType;
+
+template <class ImageType>
+typename ImageType::Pointer
+createPhantomImage(unsigned int size)
+{
+    typename ImageType::RegionType region;
+    region.SetIndex(0,0);
+    region.SetIndex(1,0);
+    region.SetIndex(2,0);
+    region.SetSize(0,size);
+    region.SetSize(1,size);
+    region.SetSize(2,size);
+
+    typename ImageType::Pointer image = ImageType::New();
+    image->SetRegions(region);
+
+    return image;
+}
+
+//! Ellipsoidal head: white matter core, grey matter shell and CSF border, with a smooth texture
+PhantomImageType::Pointer generateAnatomicalPhantom(unsigned int size);
+
+//! Inside of the phantom head
+PhantomMaskImageType::Pointer generateForegroundMask(unsigned int size);
+
+//! Spherical lesions of random radii in the white matter
+PhantomMaskImageType::Pointer generateLesionMask(unsigned int size, unsigned int numLesions, unsigned int seed);
+
+//! Smooth displacement field (in mm) made of low frequency sines of random phases, maximal norm about amplitude
+PhantomFieldImageType::Pointer generateSmoothField(unsigned int size, double amplitude, unsigned int seed);
+
+//! Tensor image (6 components, lower triangular) of a circular bundle around the z axis, isotropic elsewhere
+PhantomVectorImageType::Pointer generateDTIPhantom(unsigned int size);
+
+//! Evenly spread directions on the half sphere
+std::vector <PhantomGradientType> generateGradientDirections(unsigned int numDirections);
+
+struct MultiShellDWIPhantom
+{
+    //! One image per gradient, b0 image first
+    std::vector <PhantomDoubleImageType::Pointer> Images;
+    std::vector <PhantomGradientType> Gradients;
+    std::vector <double> BValues;
+};
+
+//! Multi-shell DWI simulated from a free water and zeppelin model following the bundle of generateDTIPhantom
+MultiShellDWIPhantom generateMultiShellDWIPhantom(unsigned int size, const std::vector <double> &bValues,
+                                                  unsigned int numDirectionsPerShell, double noiseSigma, unsigned int seed);
+
+//! Multi-echo T2 images simulated with EPG, T2 values by tissue and a smooth B1 inhomogeneity
+std::vector <PhantomDoubleImageType::Pointer> generateMultiEchoT2Phantom(unsigned int size, unsigned int numEchoes,
+                                                                         double echoSpacing, double noiseSigma,
+                                                                         unsigned int seed);
+
+} // end namespace anima
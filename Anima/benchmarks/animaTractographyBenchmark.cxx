@@ -0,0 +1,60 @@
+#include "animaTractographyBenchmark.h"
+
+#include <animaLogTensorImageFilter.h>
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+
+namespace anima
+{
+
+void DTITractographyBenchmark::Initialize()
+{
+    PhantomVectorImageType::Pointer dtiImage = generateDTIPhantom(m_Size);
+
+    // Seeds in the bundle: lowest zz diffusivity (last component of the lower triangular representation)
+    typedef TractographyFilterType::MaskImageType SeedMaskType;
+    SeedMaskType::Pointer seedMask = createPhantomImage <SeedMaskType> (m_Size);
+    seedMask->Allocate();
+
+    itk::ImageRegionConstIterator <PhantomVectorImageType> dtiItr(dtiImage, dtiImage->GetLargestPossibleRegion());
+    itk::ImageRegionIterator <SeedMaskType> seedItr(seedMask, seedMask->GetLargestPossibleRegion());
+    while (!dtiItr.IsAtEnd())
+    {
+        double zzValue = dtiItr.Get()[5];
+        seedItr.Set((zzValue > 0) && (zzValue < 0.5e-3));
+
+        ++dtiItr;
+        ++seedItr;
+    }
+
+    typedef anima::LogTensorImageFilter <double,3> LogTensorFilterType;
+    LogTensorFilterType::Pointer tensorLogger = LogTensorFilterType::New();
+    tensorLogger->SetInput(dtiImage);
+    tensorLogger->SetScaleNonDiagonal(false);
+    tensorLogger->Update();
+
+    PhantomVectorImageType::Pointer logTensorImage = tensorLogger->GetOutput();
+    logTensorImage->DisconnectPipeline();
+
+    m_Tracker = TractographyFilterType::New();
+    m_Tracker->SetInputImage(logTensorImage);
+    m_Tracker->SetSeedingMask(seedMask);
+    m_Tracker->SetNumberOfFibersPerPixel(1);
+    m_Tracker->SetStepProgression(0.5);
+    m_Tracker->SetStopFAThreshold(0.1);
+    m_Tracker->SetStopADCThreshold(2.0e-3);
+    m_Tracker->SetPunctureWeight(0.2);
+    m_Tracker->SetMaxFiberAngle(60.0);
+    m_Tracker->SetMinLengthFiber(10.0);
+    m_Tracker->SetMaxLengthFiber(200.0);
+    m_Tracker->SetComputeLocalColors(false);
+}
+
+void DTITractographyBenchmark::Run(unsigned int numThreads)
+{
+    m_Tracker->SetNumberOfWorkUnits(numThreads);
+    m_Tracker->Update();
+}
+
+} // end namespace anima
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <animaBaseBenchmark.h>
+#include <animaSyntheticPhantoms.h>
+
+#include <animaDTITractographyImageFilter.h>
+
+namespace anima
+{
+
+//! Deterministic DTI tractography seeded in the circular bundle of the DTI phantom (requires VTK)
+class DTITractographyBenchmark : public BaseBenchmark
+{
+public:
+    DTITractographyBenchmark(unsigned int size) {m_Size = size;}
+
+    std::string GetName() ITK_OVERRIDE {return "dti_tractography";}
+    void Initialize() ITK_OVERRIDE;
+    void Run(unsigned int numThreads) ITK_OVERRIDE;
+
+    typedef anima::dtiTractographyImageFilter TractographyFilterType;
+
+private:
+    unsigned int m_Size;
+    TractographyFilterType::Pointer m_Tracker;
+};
+
+} // end namespace anima
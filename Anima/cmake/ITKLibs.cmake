@@ -23,6 +23,7 @@ set(ITKIO_LIBRARIES
   ITKIOTIFF
   ITKIOVTK
   ITKIOMRC
+  ${ITKZLIB_LIBRARIES}
 )
 
 set(ITK_TRANSFORM_LIBRARIES
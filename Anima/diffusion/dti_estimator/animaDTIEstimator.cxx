@@ -6,6 +6,7 @@
 #include <fstream>
 
 #include <animaReadWriteFunctions.h>
+#include <animaImageWriteArguments.h>
 #include <animaReorientation.h>
 
 //Update progression of the process
@@ -34,6 +35,8 @@ int main(int argc,  char **argv)
     TCLAP::ValueArg<std::string> reorientArg("r","reorient","dwi_reoriented",false,"","Reorient DWI given as input",cmd);
     TCLAP::ValueArg<std::string> reorientGradArg("R","reorient-G","gradient reoriented output",false,"","Reorient gradients so that they are in MrTrix format (in image coordinates)",cmd);
 
+    anima::ImageWriteArguments imageWriteArgs(cmd);
+
     try
     {
         cmd.parse(argc,argv);
@@ -44,6 +47,8 @@ int main(int argc,  char **argv)
         return EXIT_FAILURE;
     }
 
+    imageWriteArgs.Setup();
+
     typedef anima::DTIEstimationImageFilter <double, double> FilterType;
     typedef FilterType::MaskImageType MaskImageType;
     typedef FilterType::InputImageType InputImageType;
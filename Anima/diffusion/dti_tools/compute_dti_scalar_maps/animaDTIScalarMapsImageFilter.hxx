@@ -10,9 +10,8 @@
 #include <itkOffset.h>
 #include <itkProgressReporter.h>
 #include <itkMatrix.h>
-#include <itkSymmetricEigenAnalysis.h>
 
-#include <animaBaseTensorTools.h>
+#include <animaSymmetricEigen3D.h>
 
 namespace anima
 {
@@ -74,26 +73,18 @@ DTIScalarMapsImageFilter< ImageDimension >
     radialIterator = itk::ImageRegionIterator<OutputImageType>(radialImage, outputRegionForThread);
     radialIterator.GoToBegin();
 
-    typedef vnl_matrix<double> TensorSymMatrixType;
-    typedef itk::Vector<double, 3> EigenVectorType;
-
-    EigenVectorType eigenValue;
-    TensorSymMatrixType tensorSymMatrix(3,3);
-
-    itk::SymmetricEigenAnalysis<TensorSymMatrixType, EigenVectorType> eigenAnalysis;
-    eigenAnalysis.SetDimension(3);
+    double eigenValue[3];
+    TensorVectorType tensor;
 
     while (!tensorIterator.IsAtEnd())
     {
-        TensorVectorType tensor = tensorIterator.Get();
+        tensor = tensorIterator.Get();
         double a(tensor[0]), c(tensor[2]), f(tensor[5]), ADC(0);
         ADC = (a+c+f) / 3.0;
 
         adcIterator.Set(ADC);
 
-        anima::GetTensorFromVectorRepresentation(tensor, tensorSymMatrix,3,false);
-
-        eigenAnalysis.ComputeEigenValues(tensorSymMatrix, eigenValue);
+        anima::ComputeTensorEigenValues3D(tensor.GetDataPointer(), eigenValue);
 
         double l1(eigenValue[2]), l2(eigenValue[1]), l3(eigenValue[0]), fa(1);
         double num = std::sqrt ((l1 -l2) * (l1 -l2) + (l2 -l3) * (l2 -l3) + (l3 - l1) * (l3 - l1));
@@ -2,11 +2,13 @@
 #include <itkTimeProbe.h>
 
 #include <tclap/CmdLine.h>
+#include <animaInstrumentationArguments.h>
 
 #include <animaMCMEstimatorImageFilter.h>
 #include <animaGradientFileReader.h>
 #include <animaVectorOperations.h>
 #include <animaReadWriteFunctions.h>
+#include <animaImageWriteArguments.h>
 
 //Update progression of the process
 void eventCallback (itk::Object* caller, const itk::EventObject& event, void* clientData)
@@ -78,6 +80,9 @@ int main(int argc,  char **argv)
 
     TCLAP::ValueArg<unsigned int> nbThreadsArg("T", "nb-threads", "Number of threads to run on (default: all cores)", false, itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), "number of threads", cmd);
 
+    anima::InstrumentationArguments instrumentationArgs(cmd);
+    anima::ImageWriteArguments imageWriteArgs(cmd);
+
     try
     {
         cmd.parse(argc,argv);
@@ -88,6 +93,9 @@ int main(int argc,  char **argv)
         return EXIT_FAILURE;
     }
 
+    instrumentationArgs.Setup();
+    imageWriteArgs.Setup();
+
     typedef anima::MCMEstimatorImageFilter <double, double> FilterType;
     typedef FilterType::InputImageType InputImageType;
     typedef FilterType::MaskImageType MaskImageType;
@@ -21,6 +21,7 @@
 
 #include <animaBaseTensorTools.h>
 #include <animaMCMFileWriter.h>
+#include <animaInstrumentation.h>
 
 #include <limits>
 
@@ -483,9 +484,12 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
             ++sigmaIterator;
             ++moseIterator;
 
+            ANIMA_INSTRUMENT_COUNT("mcm_skipped_voxels",1);
             continue;
         }
 
+        ANIMA_INSTRUMENT_SCOPE("mcm_voxel");
+
         // Load DWI
         for (unsigned int i = 0;i < m_NumberOfImages;++i)
             observedSignals[i] = inIterators[i].Get();
@@ -572,6 +576,7 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
         for (unsigned int i = 0;i < m_NumberOfImages;++i)
             ++inIterators[i];
 
+        ANIMA_INSTRUMENT_COUNT("mcm_voxels",1);
         this->IncrementNumberOfProcessedPoints();
         ++outIterator;
         ++maskItr;
@@ -584,6 +589,16 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
     this->SafeReleaseThreadId(threadId);
 }
 
+template <class InputPixelType, class OutputPixelType>
+void
+MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
+::AfterThreadedGenerateData()
+{
+    Superclass::AfterThreadedGenerateData();
+
+    ANIMA_INSTRUMENT_MERGE();
+}
+
 template <class InputPixelType, class OutputPixelType>
 void
 MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
@@ -591,6 +606,8 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
                                    std::vector <double> &observedSignals, itk::ThreadIdType threadId,
                                    double &aiccValue, double &b0Value, double &sigmaSqValue)
 {
+    ANIMA_INSTRUMENT_SCOPE("non_isotropic_estimation");
+
     b0Value = 0;
     sigmaSqValue = 1;
     aiccValue = -1;
@@ -625,6 +642,8 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
 ::EstimateFreeWaterModel(MCMPointer &mcmValue, std::vector <double> &observedSignals, itk::ThreadIdType threadId,
                          double &aiccValue, double &b0Value, double &sigmaSqValue)
 {
+    ANIMA_INSTRUMENT_SCOPE("free_water_estimation");
+
     // Declarations for optimization
     MCMCreatorType *mcmCreator = m_MCMCreators[threadId];
     mcmCreator->SetModelWithFreeWaterComponent(m_ModelWithFreeWaterComponent);
@@ -780,6 +799,8 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
                                 std::vector <double> &observedSignals, itk::ThreadIdType threadId,
                                 double &aiccValue, double &b0Value, double &sigmaSqValue)
 {
+    ANIMA_INSTRUMENT_SCOPE("initial_orientations");
+
     b0Value = 0;
     sigmaSqValue = 1;
     aiccValue = -1;
@@ -849,6 +870,8 @@ MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
 ::ModelEstimation(MCMPointer &mcmValue, bool authorizedNegativeB0Value, std::vector <double> &observedSignals, itk::ThreadIdType threadId,
                   double &aiccValue, double &b0Value, double &sigmaSqValue)
 {
+    ANIMA_INSTRUMENT_SCOPE("model_estimation");
+
     unsigned int optimalNumberOfCompartments = mcmValue->GetNumberOfCompartments() - mcmValue->GetNumberOfIsotropicCompartments();
 
     //Already done in initial orientations estimation
@@ -1238,6 +1261,9 @@ double
 MCMEstimatorImageFilter<InputPixelType, OutputPixelType>
 ::PerformSingleOptimization(ParametersType &p, CostFunctionBasePointer &cost, itk::Array<double> &lowerBounds, itk::Array<double> &upperBounds)
 {
+    ANIMA_INSTRUMENT_SCOPE("optimization");
+    ANIMA_INSTRUMENT_COUNT("mcm_optimizations",1);
+
     double costValue = this->GetCostValue(cost,p);
 
     OptimizerPointer optimizer = this->CreateOptimizer(cost,lowerBounds,upperBounds);
@@ -13,6 +13,8 @@
 #include <vector>
 #include <random>
 
+#include <animaCounterBasedRandomGenerator.h>
+
 namespace anima
 {
 
@@ -65,10 +67,13 @@ public:
     typedef std::vector <FiberType> FiberProcessVectorType;
     typedef std::vector <unsigned int> MembershipType;
 
+    //! Random generator, one stream per seed point so that results do not depend on the number of threads
+    typedef anima::CounterBasedRandomGenerator RandomGeneratorType;
+
     typedef struct {
         BaseProbabilisticTractographyImageFilter *trackerPtr;
-        std::vector <FiberProcessVectorType> resultFibersFromThreads;
-        std::vector <ListType> resultWeightsFromThreads;
+        std::vector <FiberProcessVectorType> resultFibersFromChunks;
+        std::vector <ListType> resultWeightsFromChunks;
     } trackerArguments;
 
     struct pair_comparator
@@ -119,6 +124,17 @@ public:
         std::vector <bool> stoppedParticles;
     };
 
+    //! Mean fiber of a particle class, with its bounding box and its points sorted along the largest box extent
+    struct ClassFiberSummaryType
+    {
+        bool activeClass;
+        FiberType classFiber;
+        PointType lowerBound, upperBound;
+        unsigned int sortAxis;
+        ListType sortedCoordinates;
+        MembershipType sortedIndexes;
+    };
+
     void SetInitialColinearityDirection(const ColinearityDirectionType &colDir) {m_InitialColinearityDirection = colDir;}
     void SetInitialDirectionMode(const InitialDirectionModeType &dir) {m_InitialDirectionMode = dir;}
     itkGetMacro(InitialDirectionMode,InitialDirectionModeType)
@@ -162,6 +178,9 @@ public:
     itkSetMacro(ModelDimension, unsigned int)
     itkGetMacro(ModelDimension, unsigned int)
 
+    itkSetMacro(Seed, unsigned int)
+    itkGetMacro(Seed, unsigned int)
+
     void Update() ITK_OVERRIDE;
 
     void createVTKOutput(FiberProcessVectorType &filteredFibers, ListType &filteredWeights);
@@ -174,8 +193,9 @@ protected:
     //! Multithread util function
     static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadTracker(void *arg);
 
-    //! Doing the thread work dispatch
-    void ThreadTrack(unsigned int numThread, FiberProcessVectorType &resultFibers, ListType &resultWeights);
+    //! Doing the thread work dispatch, results are stored per chunk of seeds to keep a deterministic output order
+    void ThreadTrack(unsigned int numThread, std::vector <FiberProcessVectorType> &resultFibers,
+                     std::vector <ListType> &resultWeights);
 
     //! Doing the real tracking by calling ComputeFiber and merging its results
     void ThreadedTrackComputer(unsigned int numThread, FiberProcessVectorType &resultFibers,
@@ -184,26 +204,39 @@ protected:
 
     //! This little guy is the one handling probabilistic tracking
     FiberProcessVectorType ComputeFiber(FiberType &fiber, InterpolatorPointer &modelInterpolator,
-                                        unsigned int numThread, ListType &resultWeights);
+                                        RandomGeneratorType &random_generator, unsigned int numThread,
+                                        ListType &resultWeights);
 
     //! Generate seed points (can be re-implemented but this one has to be called)
     virtual void PrepareTractography();
 
     //! This ugly guy is the heart of multi-modal probabilistic tractography, making decisions on split and merges of particles
-    unsigned int UpdateClassesMemberships(FiberWorkType &fiberData, DirectionVectorType &directions, std::mt19937 &random_generator);
+    unsigned int UpdateClassesMemberships(FiberWorkType &fiberData, DirectionVectorType &directions, RandomGeneratorType &random_generator);
 
     //! This guy takes the result of computefiber and merges the classes, each one becomes one fiber
     // Returns in outputMerged several fibers, as of now if there are active particles it returns only the merge of those, and returns true.
     // Otherwise, returns false and a merge per stopped fiber lengths
     bool MergeParticleClassFibers(FiberWorkType &fiberData, FiberProcessVectorType &outputMerged, unsigned int classNumber);
 
+    //! Computes the mean fiber of a class and its search structures, used for class merging decisions
+    void BuildClassFiberSummary(FiberWorkType &fiberData, unsigned int classNumber, ClassFiberSummaryType &summary);
+
+    /**
+     * @brief Distance between two class mean fibers as set by ClusterDistance. Pairs are rejected early: the returned value
+     * is then only guaranteed to be above the fuse threshold (bounding box distance or partial computation)
+     */
+    double ComputeClassFibersDistance(const ClassFiberSummaryType &firstSummary, const ClassFiberSummaryType &secondSummary);
+
+    //! Point to class fiber distance by a sweep over sorted points, exact if below cutoff, above cutoff otherwise
+    double ComputePointToClassFiberDistance(const PointType &point, const ClassFiberSummaryType &summary, double cutoff);
+
     //! Filter output fibers by ROIs and compute local colors
     FiberProcessVectorType FilterOutputFibers(FiberProcessVectorType &fibers, ListType &weights);
 
     //! Propose new direction for a particle, given the old direction, and a model (model dependent, not implemented here)
     virtual Vector3DType ProposeNewDirection(Vector3DType &oldDirection, VectorType &modelValue,
                                              Vector3DType &sampling_direction, double &log_prior, double &log_proposal,
-                                             std::mt19937 &random_generator, unsigned int threadId) = 0;
+                                             RandomGeneratorType &random_generator, unsigned int threadId) = 0;
 
     //! Update particle weight based on an underlying model and the chosen direction (model dependent, not implemented here)
     virtual double ComputeLogWeightUpdate(double b0Value, double noiseValue, Vector3DType &newDirection, VectorType &modelValue,
@@ -252,7 +285,7 @@ private:
     ScalarImagePointer m_B0Image, m_NoiseImage;
     ScalarInterpolatorPointer m_B0Interpolator, m_NoiseInterpolator;
 
-    std::vector <std::mt19937> m_Generators;
+    unsigned int m_Seed;
 
     ColinearityDirectionType m_InitialColinearityDirection;
     InitialDirectionModeType m_InitialDirectionMode;
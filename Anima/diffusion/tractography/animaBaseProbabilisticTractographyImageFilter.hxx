@@ -10,6 +10,7 @@
 
 #include <animaVectorOperations.h>
 #include <animaLogarithmFunctions.h>
+#include <animaInstrumentation.h>
 
 #include <vnl/algo/vnl_matrix_inverse.h>
 
@@ -20,6 +21,8 @@
 #include <animaKMeansFilter.h>
 
 #include <ctime>
+#include <algorithm>
+#include <limits>
 
 namespace anima
 {
@@ -54,7 +57,7 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     m_InitialColinearityDirection = Center;
     m_InitialDirectionMode = Weight;
 
-    m_Generators.clear();
+    m_Seed = time(0);
 
     m_HighestProcessedSeed = 0;
     m_ProgressReport = 0;
@@ -94,23 +97,23 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 
     trackerArguments tmpStr;
     tmpStr.trackerPtr = this;
-    tmpStr.resultFibersFromThreads.resize(this->GetNumberOfWorkUnits());
-    tmpStr.resultWeightsFromThreads.resize(this->GetNumberOfWorkUnits());
+    tmpStr.resultFibersFromChunks.resize(numSteps);
+    tmpStr.resultWeightsFromChunks.resize(numSteps);
 
-    for (unsigned int i = 0;i < this->GetNumberOfWorkUnits();++i)
     {
-        tmpStr.resultFibersFromThreads[i] = resultFibers;
-        tmpStr.resultWeightsFromThreads[i] = resultWeights;
+        ANIMA_INSTRUMENT_SCOPE("probabilistic_tracking");
+        this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+        this->GetMultiThreader()->SetSingleMethod(this->ThreadTracker,&tmpStr);
+        this->GetMultiThreader()->SingleMethodExecute();
     }
 
-    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
-    this->GetMultiThreader()->SetSingleMethod(this->ThreadTracker,&tmpStr);
-    this->GetMultiThreader()->SingleMethodExecute();
+    ANIMA_INSTRUMENT_MERGE();
 
-    for (unsigned int j = 0;j < this->GetNumberOfWorkUnits();++j)
+    // Gather in seed order, independently of which thread processed which chunk
+    for (unsigned int j = 0;j < numSteps;++j)
     {
-        resultFibers.insert(resultFibers.end(),tmpStr.resultFibersFromThreads[j].begin(),tmpStr.resultFibersFromThreads[j].end());
-        resultWeights.insert(resultWeights.end(),tmpStr.resultWeightsFromThreads[j].begin(),tmpStr.resultWeightsFromThreads[j].end());
+        resultFibers.insert(resultFibers.end(),tmpStr.resultFibersFromChunks[j].begin(),tmpStr.resultFibersFromChunks[j].end());
+        resultWeights.insert(resultWeights.end(),tmpStr.resultWeightsFromChunks[j].begin(),tmpStr.resultWeightsFromChunks[j].end());
     }
 
     std::cout << "\nKept " << resultFibers.size() << " fibers after filtering" << std::endl;
@@ -134,14 +137,6 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     m_NoiseInterpolator = ScalarInterpolatorType::New();
     m_NoiseInterpolator->SetInputImage(m_NoiseImage);
 
-    // Initialize random generator
-    m_Generators.resize(this->GetNumberOfWorkUnits());
-
-    std::mt19937 motherGenerator(time(0));
-
-    for (unsigned int i = 0;i < this->GetNumberOfWorkUnits();++i)
-        m_Generators[i] = std::mt19937(motherGenerator());
-
     bool is2d = m_InputModelImage->GetLargestPossibleRegion().GetSize()[2] == 1;
     if (is2d && (m_InitialColinearityDirection == Top))
         m_InitialColinearityDirection = Front;
@@ -272,7 +267,7 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     unsigned int nbThread = threadArgs->WorkUnitID;
 
     trackerArguments *tmpArg = (trackerArguments *)threadArgs->UserData;
-    tmpArg->trackerPtr->ThreadTrack(nbThread,tmpArg->resultFibersFromThreads[nbThread],tmpArg->resultWeightsFromThreads[nbThread]);
+    tmpArg->trackerPtr->ThreadTrack(nbThread,tmpArg->resultFibersFromChunks,tmpArg->resultWeightsFromChunks);
 
     return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
@@ -280,8 +275,8 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 template <class TInputModelImageType>
 void
 BaseProbabilisticTractographyImageFilter <TInputModelImageType>
-::ThreadTrack(unsigned int numThread, FiberProcessVectorType &resultFibers,
-              ListType &resultWeights)
+::ThreadTrack(unsigned int numThread, std::vector <FiberProcessVectorType> &resultFibers,
+              std::vector <ListType> &resultWeights)
 {
     bool continueLoop = true;
     unsigned int highestToleratedSeedIndex = m_PointsToProcess.size();
@@ -310,7 +305,8 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 
         m_LockHighestProcessedSeed.unlock();
 
-        this->ThreadedTrackComputer(numThread,resultFibers,resultWeights,startPoint,endPoint);
+        unsigned int chunkIndex = startPoint / stepData;
+        this->ThreadedTrackComputer(numThread,resultFibers[chunkIndex],resultWeights[chunkIndex],startPoint,endPoint);
 
         m_LockHighestProcessedSeed.lock();
         m_ProgressReport->CompletedPixel();
@@ -329,12 +325,15 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     FiberProcessVectorType tmpFibers;
     ListType tmpWeights;
     ContinuousIndexType startIndex;
+    RandomGeneratorType generator;
 
     for (unsigned int i = startSeedIndex;i < endSeedIndex;++i)
     {
         m_SeedMask->TransformPhysicalPointToContinuousIndex(m_PointsToProcess[i][0],startIndex);
 
-        tmpFibers = this->ComputeFiber(m_PointsToProcess[i], modelInterpolator, numThread, tmpWeights);
+        generator.SetKey(m_Seed,i);
+        ANIMA_INSTRUMENT_COUNT("seeds",1);
+        tmpFibers = this->ComputeFiber(m_PointsToProcess[i], modelInterpolator, generator, numThread, tmpWeights);
 
         tmpFibers = this->FilterOutputFibers(tmpFibers, tmpWeights);
 
@@ -466,8 +465,11 @@ template <class TInputModelImageType>
 typename BaseProbabilisticTractographyImageFilter <TInputModelImageType>::FiberProcessVectorType
 BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 ::ComputeFiber(FiberType &fiber, InterpolatorPointer &modelInterpolator,
-               unsigned int numThread, ListType &resultWeights)
+               RandomGeneratorType &random_generator, unsigned int numThread,
+               ListType &resultWeights)
 {
+    ANIMA_INSTRUMENT_SCOPE("fiber");
+
     unsigned int numberOfClasses = 1;
 
     FiberWorkType fiberComputationData;
@@ -616,7 +618,7 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
             // Propose a new direction based on the previous one and the diffusion information at current position
             double log_prior = 0, log_proposal = 0;
             newDirection = this->ProposeNewDirection(previousDirections[i], modelValue, sampling_direction, log_prior,
-                                                     log_proposal, m_Generators[numThread], numThread);
+                                                     log_proposal, random_generator, numThread);
 
             // Update the position of the particle
             for (unsigned int j = 0;j < InputModelImageType::ImageDimension;++j)
@@ -749,6 +751,7 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
             // Actual class resampling
             if (effectiveNumberOfParticles[m] < m_ResamplingThreshold * fiberComputationData.classSizes[m])
             {
+                ANIMA_INSTRUMENT_COUNT("particle_resamplings",1);
                 weightSpecificClassValues.resize(fiberComputationData.classSizes[m]);
                 previousDirectionsCopy.resize(fiberComputationData.classSizes[m]);
                 fiberParticlesCopy.resize(fiberComputationData.classSizes[m]);
@@ -767,7 +770,7 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 
                 for (unsigned int i = 0;i < fiberComputationData.classSizes[m];++i)
                 {
-                    unsigned int z = dist(m_Generators[numThread]);
+                    unsigned int z = dist(random_generator);
                     unsigned int iReal = fiberComputationData.reverseClassMemberships[m][i];
                     previousDirections[iReal] = previousDirectionsCopy[z];
                     fiberComputationData.fiberParticles[iReal] = fiberParticlesCopy[z];
@@ -809,7 +812,7 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
         if (numIter > m_MaxLengthFiber / m_StepProgression)
             stopLoop = true;
 
-        numberOfClasses = this->UpdateClassesMemberships(fiberComputationData,previousDirections,m_Generators[numThread]);
+        numberOfClasses = this->UpdateClassesMemberships(fiberComputationData,previousDirections,random_generator);
 
         for (unsigned int i = 0;i < fiberComputationData.particleWeights.size();++i)
         {
@@ -818,6 +821,8 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
         }
     }
 
+    ANIMA_INSTRUMENT_HISTOGRAM("fiber_steps",numIter);
+
     // Now that we're done, if we don't keep individual particles, merge them cluster by cluster
     if (m_MAPMergeFibers)
     {
@@ -842,14 +847,13 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
 template <class TInputModelImageType>
 unsigned int
 BaseProbabilisticTractographyImageFilter <TInputModelImageType>
-::UpdateClassesMemberships(FiberWorkType &fiberData, DirectionVectorType &directions, std::mt19937 &random_generator)
+::UpdateClassesMemberships(FiberWorkType &fiberData, DirectionVectorType &directions, RandomGeneratorType &random_generator)
 {
     const unsigned int p = PointType::PointDimension;
     typedef anima::KMeansFilter <PointType,p> KMeansFilterType;
     unsigned int numClasses = fiberData.classSizes.size();
 
     // Deciding on cluster merges
-    FiberProcessVectorType mapMergedFibersRef, mapMergedFibersFlo;
     unsigned int newNumClasses = numClasses;
 
     MembershipType classesFusion(numClasses);
@@ -860,12 +864,15 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     // This is based on a range of possible criterions specified by the user
     if (numClasses > 1)
     {
+        // Fuse test is done on average cluster fiber, if it is an active cluster,
+        // i.e. at least one of its particle is still moving. Those are computed once per class, not once per pair
+        std::vector <ClassFiberSummaryType> classSummaries(numClasses);
+        for (unsigned int i = 0;i < numClasses;++i)
+            this->BuildClassFiberSummary(fiberData,i,classSummaries[i]);
+
         for (unsigned int i = 0;i < numClasses;++i)
         {
-            // Fuse test is done on average cluster fiber, if it is an active cluster,
-            // i.e. at least one of its particle is still moving
-            bool activeClass = this->MergeParticleClassFibers(fiberData,mapMergedFibersRef,i);
-            if (!activeClass)
+            if (!classSummaries[i].activeClass)
                 continue;
 
             for (unsigned int j = i+1;j < numClasses;++j)
@@ -873,78 +880,11 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
                 if (classesFusion[j] != j)
                     continue;
 
-                double maxVal = 0;
-                bool activeSubClass = this->MergeParticleClassFibers(fiberData,mapMergedFibersFlo,j);
-                if (!activeSubClass)
+                if (!classSummaries[j].activeClass)
                     continue;
 
                 // Compute a distance between the two clusters, based on user input
-                switch (m_ClusterDistance)
-                {
-                    case 0:
-                    {
-                        // Former method (quickest)
-                        unsigned int minSizeFiber = std::min(mapMergedFibersRef[0].size(),mapMergedFibersFlo[0].size());
-
-                        for (unsigned int l = 0;l < minSizeFiber;++l)
-                        {
-                            double positionDist = anima::ComputeEuclideanDistance(mapMergedFibersRef[0][l], mapMergedFibersFlo[0][l]);
-
-                            if (positionDist > maxVal)
-                                maxVal = positionDist;
-
-                            if (maxVal > m_PositionDistanceFuseThreshold)
-                                break;
-                        }
-
-                        break;
-                    }
-
-                    case 1:
-                    {
-                        // Hausdorff distance
-                        for (unsigned int l = 0;l < mapMergedFibersRef[0].size();++l)
-                        {
-                            double tmpVal = anima::ComputePointToSetDistance(mapMergedFibersRef[0][l], mapMergedFibersFlo[0]);
-
-                            if (tmpVal > maxVal)
-                                maxVal = tmpVal;
-
-                            if (maxVal > m_PositionDistanceFuseThreshold)
-                                break;
-                        }
-
-                        if (maxVal <= m_PositionDistanceFuseThreshold)
-                        {
-                            for (unsigned int l = 0;l < mapMergedFibersFlo[0].size();++l)
-                            {
-                                double tmpVal = anima::ComputePointToSetDistance(mapMergedFibersFlo[0][l], mapMergedFibersRef[0]);
-
-                                if (tmpVal > maxVal)
-                                    maxVal = tmpVal;
-
-                                if (maxVal > m_PositionDistanceFuseThreshold)
-                                    break;
-                            }
-                        }
-
-                        break;
-                    }
-
-                    case 2:
-                    {
-                        // Modified Hausdorff distance
-                        maxVal = anima::ComputeModifiedDirectedHausdorffDistance(mapMergedFibersRef[0], mapMergedFibersFlo[0]);
-
-                        if (maxVal <= m_PositionDistanceFuseThreshold)
-                            maxVal = std::max(maxVal, anima::ComputeModifiedDirectedHausdorffDistance(mapMergedFibersFlo[0], mapMergedFibersRef[0]));
-
-                        break;
-                    }
-
-                    default:
-                        break;
-                }
+                double maxVal = this->ComputeClassFibersDistance(classSummaries[i],classSummaries[j]);
 
                 // If computed distance is smaller than a threshold, we fuse
                 // To do so, an index table (classesFusion) is updated, each of its cells tells
@@ -1208,6 +1148,220 @@ BaseProbabilisticTractographyImageFilter <TInputModelImageType>
     return finalNumClasses;
 }
 
+template <class TInputModelImageType>
+void
+BaseProbabilisticTractographyImageFilter <TInputModelImageType>
+::BuildClassFiberSummary(FiberWorkType &fiberData, unsigned int classNumber, ClassFiberSummaryType &summary)
+{
+    FiberProcessVectorType mergedFibers;
+    summary.activeClass = this->MergeParticleClassFibers(fiberData,mergedFibers,classNumber);
+    summary.classFiber.clear();
+    summary.sortedCoordinates.clear();
+    summary.sortedIndexes.clear();
+
+    if (!summary.activeClass)
+        return;
+
+    summary.classFiber = mergedFibers[0];
+    unsigned int numPoints = summary.classFiber.size();
+    if (numPoints == 0)
+        return;
+
+    const unsigned int p = PointType::PointDimension;
+    summary.lowerBound = summary.classFiber[0];
+    summary.upperBound = summary.classFiber[0];
+    for (unsigned int i = 1;i < numPoints;++i)
+    {
+        for (unsigned int j = 0;j < p;++j)
+        {
+            summary.lowerBound[j] = std::min(summary.lowerBound[j],summary.classFiber[i][j]);
+            summary.upperBound[j] = std::max(summary.upperBound[j],summary.classFiber[i][j]);
+        }
+    }
+
+    // Fibers are curves: sorting along their largest extent keeps sweeps short
+    summary.sortAxis = 0;
+    for (unsigned int j = 1;j < p;++j)
+    {
+        if (summary.upperBound[j] - summary.lowerBound[j] > summary.upperBound[summary.sortAxis] - summary.lowerBound[summary.sortAxis])
+            summary.sortAxis = j;
+    }
+
+    summary.sortedIndexes.resize(numPoints);
+    for (unsigned int i = 0;i < numPoints;++i)
+        summary.sortedIndexes[i] = i;
+
+    unsigned int sortAxis = summary.sortAxis;
+    const FiberType &classFiber = summary.classFiber;
+    std::sort(summary.sortedIndexes.begin(),summary.sortedIndexes.end(),[&classFiber,sortAxis](unsigned int a, unsigned int b)
+    {
+        return classFiber[a][sortAxis] < classFiber[b][sortAxis];
+    });
+
+    summary.sortedCoordinates.resize(numPoints);
+    for (unsigned int i = 0;i < numPoints;++i)
+        summary.sortedCoordinates[i] = classFiber[summary.sortedIndexes[i]][sortAxis];
+}
+
+template <class TInputModelImageType>
+double
+BaseProbabilisticTractographyImageFilter <TInputModelImageType>
+::ComputePointToClassFiberDistance(const PointType &point, const ClassFiberSummaryType &summary, double cutoff)
+{
+    const unsigned int p = PointType::PointDimension;
+    unsigned int numPoints = summary.sortedCoordinates.size();
+    double queryCoordinate = point[summary.sortAxis];
+
+    double bestSquaredDistance = cutoff * cutoff;
+    bool pointFound = false;
+
+    unsigned int startIndex = std::lower_bound(summary.sortedCoordinates.begin(),summary.sortedCoordinates.end(),queryCoordinate) -
+            summary.sortedCoordinates.begin();
+
+    // Sweep upwards then downwards, stopping when the sort axis gap alone exceeds the best distance
+    for (unsigned int i = startIndex;i < numPoints;++i)
+    {
+        double axisGap = summary.sortedCoordinates[i] - queryCoordinate;
+        if (axisGap * axisGap > bestSquaredDistance)
+            break;
+
+        const PointType &setPoint = summary.classFiber[summary.sortedIndexes[i]];
+        double squaredDistance = 0;
+        for (unsigned int j = 0;j < p;++j)
+            squaredDistance += (point[j] - setPoint[j]) * (point[j] - setPoint[j]);
+
+        if (squaredDistance <= bestSquaredDistance)
+        {
+            bestSquaredDistance = squaredDistance;
+            pointFound = true;
+        }
+    }
+
+    for (unsigned int i = startIndex;i > 0;--i)
+    {
+        double axisGap = queryCoordinate - summary.sortedCoordinates[i - 1];
+        if (axisGap * axisGap > bestSquaredDistance)
+            break;
+
+        const PointType &setPoint = summary.classFiber[summary.sortedIndexes[i - 1]];
+        double squaredDistance = 0;
+        for (unsigned int j = 0;j < p;++j)
+            squaredDistance += (point[j] - setPoint[j]) * (point[j] - setPoint[j]);
+
+        if (squaredDistance <= bestSquaredDistance)
+        {
+            bestSquaredDistance = squaredDistance;
+            pointFound = true;
+        }
+    }
+
+    if (!pointFound)
+        return std::numeric_limits <double>::max();
+
+    return std::sqrt(bestSquaredDistance);
+}
+
+template <class TInputModelImageType>
+double
+BaseProbabilisticTractographyImageFilter <TInputModelImageType>
+::ComputeClassFibersDistance(const ClassFiberSummaryType &firstSummary, const ClassFiberSummaryType &secondSummary)
+{
+    const unsigned int p = PointType::PointDimension;
+    const FiberType &firstFiber = firstSummary.classFiber;
+    const FiberType &secondFiber = secondSummary.classFiber;
+
+    if ((firstFiber.size() == 0) || (secondFiber.size() == 0))
+        return 0;
+
+    // Any point to point distance is above the bounding boxes distance, hence all three cluster distances too
+    double boxSquaredDistance = 0;
+    for (unsigned int j = 0;j < p;++j)
+    {
+        double axisGap = std::max(firstSummary.lowerBound[j] - secondSummary.upperBound[j],
+                                  secondSummary.lowerBound[j] - firstSummary.upperBound[j]);
+        if (axisGap > 0)
+            boxSquaredDistance += axisGap * axisGap;
+    }
+
+    if (boxSquaredDistance > m_PositionDistanceFuseThreshold * m_PositionDistanceFuseThreshold)
+        return std::sqrt(boxSquaredDistance);
+
+    double maxVal = 0;
+    switch (m_ClusterDistance)
+    {
+        case 0:
+        {
+            // Former method (quickest)
+            unsigned int minSizeFiber = std::min(firstFiber.size(),secondFiber.size());
+
+            for (unsigned int l = 0;l < minSizeFiber;++l)
+            {
+                double positionDist = anima::ComputeEuclideanDistance(firstFiber[l], secondFiber[l]);
+
+                if (positionDist > maxVal)
+                    maxVal = positionDist;
+
+                if (maxVal > m_PositionDistanceFuseThreshold)
+                    break;
+            }
+
+            break;
+        }
+
+        case 1:
+        {
+            // Hausdorff distance, only values below threshold need to be exact
+            for (unsigned int l = 0;l < firstFiber.size();++l)
+            {
+                double tmpVal = this->ComputePointToClassFiberDistance(firstFiber[l], secondSummary, m_PositionDistanceFuseThreshold);
+                if (tmpVal > maxVal)
+                    maxVal = tmpVal;
+
+                if (maxVal > m_PositionDistanceFuseThreshold)
+                    return maxVal;
+            }
+
+            for (unsigned int l = 0;l < secondFiber.size();++l)
+            {
+                double tmpVal = this->ComputePointToClassFiberDistance(secondFiber[l], firstSummary, m_PositionDistanceFuseThreshold);
+                if (tmpVal > maxVal)
+                    maxVal = tmpVal;
+
+                if (maxVal > m_PositionDistanceFuseThreshold)
+                    return maxVal;
+            }
+
+            break;
+        }
+
+        case 2:
+        {
+            // Modified Hausdorff distance, partial sums already above threshold stop the computation
+            double maxSum = m_PositionDistanceFuseThreshold * firstFiber.size();
+            double distanceSum = 0;
+            for (unsigned int l = 0;(l < firstFiber.size()) && (distanceSum <= maxSum);++l)
+                distanceSum += this->ComputePointToClassFiberDistance(firstFiber[l], secondSummary, std::numeric_limits <double>::max());
+
+            maxVal = distanceSum / firstFiber.size();
+            if (maxVal > m_PositionDistanceFuseThreshold)
+                return maxVal;
+
+            maxSum = m_PositionDistanceFuseThreshold * secondFiber.size();
+            distanceSum = 0;
+            for (unsigned int l = 0;(l < secondFiber.size()) && (distanceSum <= maxSum);++l)
+                distanceSum += this->ComputePointToClassFiberDistance(secondFiber[l], firstSummary, std::numeric_limits <double>::max());
+
+            maxVal = std::max(maxVal, distanceSum / secondFiber.size());
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return maxVal;
+}
+
 template <class TInputModelImageType>
 bool
 BaseProbabilisticTractographyImageFilter <TInputModelImageType>
@@ -5,10 +5,11 @@
 #include <animaDistributionSampling.h>
 #include <animaVMFDistribution.h>
 #include <animaWatsonDistribution.h>
+#include <animaWatsonDistributionSampler.h>
 #include <animaLogarithmFunctions.h>
 #include <animaBaseTensorTools.h>
 
-#include <itkSymmetricEigenAnalysis.h>
+#include <animaSymmetricEigen3D.h>
 
 #include <vtkPointData.h>
 #include <vtkDoubleArray.h>
@@ -32,7 +33,7 @@ DTIProbabilisticTractographyImageFilter::~DTIProbabilisticTractographyImageFilte
 DTIProbabilisticTractographyImageFilter::Vector3DType
 DTIProbabilisticTractographyImageFilter::ProposeNewDirection(Vector3DType &oldDirection, VectorType &modelValue,
                                                              Vector3DType &sampling_direction, double &log_prior,
-                                                             double &log_proposal, std::mt19937 &random_generator,
+                                                             double &log_proposal, RandomGeneratorType &random_generator,
                                                              unsigned int threadId)
 {
     Vector3DType resVec(0.0);
@@ -64,7 +65,8 @@ DTIProbabilisticTractographyImageFilter::ProposeNewDirection(Vector3DType &oldDi
 //    else
 //        anima::SampleFromVMFDistribution(concentrationParameter,sampling_direction,resVec,random_generator);
 
-    anima::SampleFromWatsonDistribution(concentrationParameter,sampling_direction,resVec,3,random_generator);
+    anima::WatsonDistributionSampler watsonSampler(concentrationParameter,sampling_direction);
+    watsonSampler.Sample(random_generator,resVec);
     
     if (is2d)
     {
@@ -94,9 +96,6 @@ InitializeFirstIterationFromModel(Vector3DType &colinearDir, VectorType &modelVa
     Vector3DType resVec, tmpVec;
     bool is2d = (this->GetInputModelImage()->GetLargestPossibleRegion().GetSize()[2] == 1);
 	
-    itk::SymmetricEigenAnalysis <Matrix3DType,Vector3DType,Matrix3DType> EigenAnalysis(InputModelImageType::ImageDimension);
-    EigenAnalysis.SetOrderEigenValues(true);
-
     Matrix3DType dtiTensor, eigVecs;
     Vector3DType eigVals;
 
@@ -110,7 +109,7 @@ InitializeFirstIterationFromModel(Vector3DType &colinearDir, VectorType &modelVa
             ++pos;
         }
 
-    EigenAnalysis.ComputeEigenValuesAndVectors(dtiTensor,eigVals,eigVecs);
+    anima::ComputeSymmetricEigenSystem3D(dtiTensor,eigVals,eigVecs);
 
     switch(this->GetInitialDirectionMode())
     {
@@ -236,9 +235,6 @@ double DTIProbabilisticTractographyImageFilter::GetKappaFromFA(double FA)
 
 void DTIProbabilisticTractographyImageFilter::GetDTIPrincipalDirection(const VectorType &modelValue, Vector3DType &resVec, bool is2d)
 {
-    itk::SymmetricEigenAnalysis <Matrix3DType,Vector3DType,Matrix3DType> EigenAnalysis(InputModelImageType::ImageDimension);
-    EigenAnalysis.SetOrderEigenValues(true);
-    
     Matrix3DType dtiTensor, eigVecs;
     Vector3DType eigVals;
     
@@ -252,7 +248,7 @@ void DTIProbabilisticTractographyImageFilter::GetDTIPrincipalDirection(const Vec
             ++pos;
         }
     
-    EigenAnalysis.ComputeEigenValuesAndVectors(dtiTensor,eigVals,eigVecs);
+    anima::ComputeSymmetricEigenSystem3D(dtiTensor,eigVals,eigVecs);
     
     for (unsigned int i = 0;i < 3;++i)
     	resVec[i] = eigVecs(2,i);
@@ -266,9 +262,6 @@ void DTIProbabilisticTractographyImageFilter::GetDTIPrincipalDirection(const Vec
  
 void DTIProbabilisticTractographyImageFilter::GetDTIMinorDirection(VectorType &modelValue, Vector3DType &resVec)
 {
-    itk::SymmetricEigenAnalysis <Matrix3DType,Vector3DType,Matrix3DType> EigenAnalysis(InputModelImageType::ImageDimension);
-    EigenAnalysis.SetOrderEigenValues(true);
-    
     Matrix3DType dtiTensor, eigVecs;
     Vector3DType eigVals;
     
@@ -282,7 +275,7 @@ void DTIProbabilisticTractographyImageFilter::GetDTIMinorDirection(VectorType &m
             ++pos;
         }
     
-    EigenAnalysis.ComputeEigenValuesAndVectors(dtiTensor,eigVals,eigVecs);
+    anima::ComputeSymmetricEigenSystem3D(dtiTensor,eigVals,eigVecs);
     
     for (unsigned int i = 0;i < 3;++i)
     	resVec[i] = eigVecs(0,i);
@@ -297,22 +290,11 @@ void DTIProbabilisticTractographyImageFilter::ComputeModelValue(InterpolatorPoin
     if (modelInterpolator->IsInsideBuffer(index))
         modelValue = modelInterpolator->EvaluateAtContinuousIndex(index);
 
-    using LECalculatorType = anima::LogEuclideanTensorCalculator <double>;
-    using LECalculatorPointer = LECalculatorType::Pointer;
-
-    LECalculatorPointer leCalculator = LECalculatorType::New();
-
-    vnl_matrix <double> tmpTensor(3,3);
-    anima::GetTensorFromVectorRepresentation(modelValue,tmpTensor);
-    leCalculator->GetTensorExponential(tmpTensor,tmpTensor);
-    anima::GetVectorRepresentation(tmpTensor,modelValue);
+    anima::GetTensorExponential3D(modelValue.GetDataPointer(),modelValue.GetDataPointer(),1);
 }
 
 double DTIProbabilisticTractographyImageFilter::GetLinearCoefficient(VectorType &modelValue)
 {
-    itk::SymmetricEigenAnalysis <Matrix3DType,Vector3DType,Matrix3DType> EigenAnalysis(InputModelImageType::ImageDimension);
-    EigenAnalysis.SetOrderEigenValues(true);
-    
     Matrix3DType dtiTensor;
     Vector3DType eigVals;
     
@@ -326,7 +308,7 @@ double DTIProbabilisticTractographyImageFilter::GetLinearCoefficient(VectorType
             ++pos;
         }
     
-    EigenAnalysis.ComputeEigenValues(dtiTensor,eigVals);
+    anima::ComputeSymmetricEigenValues3D(dtiTensor,eigVals);
     
     double denom = 0;
     for (unsigned int i = 0;i < 3;++i)
@@ -337,9 +319,6 @@ double DTIProbabilisticTractographyImageFilter::GetLinearCoefficient(VectorType
 
 double DTIProbabilisticTractographyImageFilter::GetFractionalAnisotropy(VectorType &modelValue)
 {
-    itk::SymmetricEigenAnalysis <Matrix3DType,Vector3DType,Matrix3DType> EigenAnalysis(InputModelImageType::ImageDimension);
-    EigenAnalysis.SetOrderEigenValues(true);
-    
     Matrix3DType dtiTensor;
     Vector3DType eigVals;
     
@@ -353,7 +332,7 @@ double DTIProbabilisticTractographyImageFilter::GetFractionalAnisotropy(VectorTy
             ++pos;
         }
     
-    EigenAnalysis.ComputeEigenValues(dtiTensor,eigVals);
+    anima::ComputeSymmetricEigenValues3D(dtiTensor,eigVals);
     
     double meanLambda = 0;
     for (unsigned int i = 0;i < 3;++i)
@@ -375,9 +354,6 @@ double DTIProbabilisticTractographyImageFilter::GetFractionalAnisotropy(VectorTy
 
 void DTIProbabilisticTractographyImageFilter::GetEigenValueCombinations(VectorType &modelValue, double &meanLambda, double &perpLambda)
 {
-    itk::SymmetricEigenAnalysis <Matrix3DType,Vector3DType,Matrix3DType> EigenAnalysis(InputModelImageType::ImageDimension);
-    EigenAnalysis.SetOrderEigenValues(true);
-    
     Matrix3DType dtiTensor;
     Vector3DType eigVals;
     
@@ -391,7 +367,7 @@ void DTIProbabilisticTractographyImageFilter::GetEigenValueCombinations(VectorTy
             ++pos;
         }
     
-    EigenAnalysis.ComputeEigenValues(dtiTensor,eigVals);
+    anima::ComputeSymmetricEigenValues3D(dtiTensor,eigVals);
     
     meanLambda = 0;
     perpLambda = 0;
@@ -428,7 +404,6 @@ void DTIProbabilisticTractographyImageFilter::ComputeAdditionalScalarMaps()
     typedef vnl_matrix <double> MatrixType;
     MatrixType tmpMat(3,3);
     vnl_diag_matrix <double> eVals(3);
-    itk::SymmetricEigenAnalysis <MatrixType,vnl_diag_matrix <double>,MatrixType> EigenAnalysis(3);
     VectorType tensorValue(6);
 
     for (unsigned int i = 0;i < numPoints;++i)
@@ -451,7 +426,7 @@ void DTIProbabilisticTractographyImageFilter::ComputeAdditionalScalarMaps()
 
         double faValue = 0;
         double faValueDenom = 0;
-        EigenAnalysis.ComputeEigenValues(tmpMat,eVals);
+        anima::ComputeSymmetricEigenValues3D(tmpMat,eVals);
         for (unsigned int j = 0;j < 3;++j)
         {
             faValueDenom += eVals[j] * eVals[j];
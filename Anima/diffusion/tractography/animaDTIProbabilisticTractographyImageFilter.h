@@ -38,7 +38,7 @@ protected:
 
     virtual Vector3DType ProposeNewDirection(Vector3DType &oldDirection, VectorType &modelValue,
                                              Vector3DType &sampling_direction, double &log_prior,
-                                             double &log_proposal, std::mt19937 &random_generator,
+                                             double &log_proposal, RandomGeneratorType &random_generator,
                                              unsigned int threadId) ITK_OVERRIDE;
 
     virtual double ComputeLogWeightUpdate(double b0Value, double noiseValue, Vector3DType &newDirection, VectorType &modelValue,
@@ -1,11 +1,15 @@
 #include "animaDTITractographyImageFilter.h"
-#include <itkSymmetricEigenAnalysis.h>
 #include <animaVectorOperations.h>
+#include <animaSymmetricEigen3D.h>
 
 #include <vtkDoubleArray.h>
 #include <vtkPointData.h>
 #include <animaBaseTensorTools.h>
 
+#include <itkMultiThreaderBase.h>
+
+#include <algorithm>
+
 namespace anima
 {
 
@@ -13,6 +17,7 @@ dtiTractographyImageFilter::dtiTractographyImageFilter()
 {
     m_StopFAThreshold = 0.1;
     m_StopADCThreshold = 2.0e-3;
+    m_UsePrecomputedFields = false;
 }
 
 dtiTractographyImageFilter::~dtiTractographyImageFilter()
@@ -27,17 +32,171 @@ void dtiTractographyImageFilter::SetInputImage(ModelImageType *input)
     m_DTIInterpolator->SetInputImage(this->GetInputImage());
 }
 
-bool dtiTractographyImageFilter::CheckModelCompatibility(VectorType &modelValue, itk::ThreadIdType threadId)
+void dtiTractographyImageFilter::PrepareTractography()
 {
-    typedef vnl_matrix <double> MatrixType;
+    this->Superclass::PrepareTractography();
+
+    m_PrecomputedFields = nullptr;
+    if (!m_UsePrecomputedFields)
+        return;
+
+    ModelImageType *input = this->GetInputImage();
+
+    m_PrecomputedFields = PrecomputedFieldsImageType::New();
+    m_PrecomputedFields->Initialize();
+    m_PrecomputedFields->SetRegions(input->GetLargestPossibleRegion());
+    m_PrecomputedFields->SetOrigin(input->GetOrigin());
+    m_PrecomputedFields->SetSpacing(input->GetSpacing());
+    m_PrecomputedFields->SetDirection(input->GetDirection());
+    m_PrecomputedFields->SetVectorLength(PrecomputedFieldsSize);
+    m_PrecomputedFields->Allocate();
+
+    const double *inputBuffer = input->GetBufferPointer();
+    float *fieldsBuffer = m_PrecomputedFields->GetBufferPointer();
+    unsigned int inputSize = input->GetNumberOfComponentsPerPixel();
+    itk::SizeValueType numberOfVoxels = input->GetLargestPossibleRegion().GetNumberOfPixels();
+
+    const itk::SizeValueType chunkSize = 4096;
+    itk::SizeValueType numberOfChunks = (numberOfVoxels + chunkSize - 1) / chunkSize;
+
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    this->GetMultiThreader()->ParallelizeArray(0, numberOfChunks, [&](itk::SizeValueType chunk)
+    {
+        itk::SizeValueType endVoxel = std::min((chunk + 1) * chunkSize,numberOfVoxels);
+        for (itk::SizeValueType i = chunk * chunkSize;i < endVoxel;++i)
+            this->ComputeVoxelFields(inputBuffer + i * inputSize,fieldsBuffer + i * PrecomputedFieldsSize);
+    }, nullptr);
+}
+
+void dtiTractographyImageFilter::ComputeVoxelFields(const double *logTensor, float *fields)
+{
+    bool nullTensor = true;
+    for (unsigned int i = 0;i < 6;++i)
+    {
+        if (logTensor[i] != 0)
+        {
+            nullTensor = false;
+            break;
+        }
+    }
+
+    // Background stays null so that tracking stops as with log-tensors
+    if (nullTensor)
+    {
+        std::fill(fields,fields + PrecomputedFieldsSize,0.0f);
+        return;
+    }
+
+    double eVals[3], eVecs[3][3];
+    anima::ComputeTensorEigenSystem3D(logTensor,eVals,eVecs);
+
+    double meanEvals = 0;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        eVals[i] = std::exp(eVals[i]);
+        meanEvals += eVals[i];
+    }
+
+    double sumEigs = meanEvals;
+    meanEvals /= 3.0;
+
+    double num = 0;
+    double denom = 0;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        num += (eVals[i] - meanEvals) * (eVals[i] - meanEvals);
+        denom += eVals[i] * eVals[i];
+    }
+
+    for (unsigned int i = 0;i < 3;++i)
+        fields[i] = eVecs[2][i];
+
+    fields[3] = std::sqrt(3.0 * num / (2.0 * denom));
+    fields[4] = (eVals[2] - eVals[1]) / sumEigs;
+    anima::RecomposeTensor3D(eVals,eVecs,fields + 5);
+}
+
+void dtiTractographyImageFilter::InterpolatePrecomputedFields(ContinuousIndexType &index, VectorType &fieldsValue)
+{
+    fieldsValue.SetSize(PrecomputedFieldsSize);
+    fieldsValue.Fill(0.0);
+
+    RegionType region = m_PrecomputedFields->GetLargestPossibleRegion();
+    const float *fieldsBuffer = m_PrecomputedFields->GetBufferPointer();
+
+    long baseIndex[3];
+    double distance[3];
+    itk::OffsetValueType strides[3] = {1, (itk::OffsetValueType)region.GetSize(0),
+                                       (itk::OffsetValueType)(region.GetSize(0) * region.GetSize(1))};
+
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        baseIndex[i] = std::floor(index[i]);
+        distance[i] = index[i] - baseIndex[i];
+    }
+
+    // Neighbours are clamped to the image, as in itk::LinearInterpolateImageFunction
+    const float *neighbourFields[8];
+    double neighbourWeights[8];
+    unsigned int referenceNeighbour = 0;
+    for (unsigned int n = 0;n < 8;++n)
+    {
+        itk::OffsetValueType offset = 0;
+        neighbourWeights[n] = 1.0;
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            unsigned int upper = (n >> i) & 1;
+            long neighbourIndex = baseIndex[i] + upper;
+            long minIndex = region.GetIndex(i);
+            long maxIndex = minIndex + region.GetSize(i) - 1;
+            neighbourIndex = std::min(std::max(neighbourIndex,minIndex),maxIndex);
+
+            offset += (neighbourIndex - minIndex) * strides[i];
+            neighbourWeights[n] *= upper ? distance[i] : 1.0 - distance[i];
+        }
+
+        neighbourFields[n] = fieldsBuffer + offset * PrecomputedFieldsSize;
+        if (neighbourWeights[n] > neighbourWeights[referenceNeighbour])
+            referenceNeighbour = n;
+    }
+
+    // Principal directions are only defined up to their sign, align them before averaging
+    const float *referenceDirection = neighbourFields[referenceNeighbour];
+    for (unsigned int n = 0;n < 8;++n)
+    {
+        if (neighbourWeights[n] == 0)
+            continue;
+
+        double directionSign = 1.0;
+        double dotProduct = 0;
+        for (unsigned int i = 0;i < 3;++i)
+            dotProduct += neighbourFields[n][i] * referenceDirection[i];
 
-    itk::SymmetricEigenAnalysis <MatrixType,vnl_diag_matrix <double>,MatrixType> EigenAnalysis(3);
-    MatrixType tmpMat(3,3);
+        if (dotProduct < 0)
+            directionSign = -1.0;
 
-    anima::GetTensorFromVectorRepresentation(modelValue,tmpMat);
+        for (unsigned int i = 0;i < 3;++i)
+            fieldsValue[i] += directionSign * neighbourWeights[n] * neighbourFields[n][i];
+
+        for (unsigned int i = 3;i < PrecomputedFieldsSize;++i)
+            fieldsValue[i] += neighbourWeights[n] * neighbourFields[n][i];
+    }
+}
 
-    vnl_diag_matrix <double> eVals(3);
-    EigenAnalysis.ComputeEigenValues(tmpMat,eVals);
+bool dtiTractographyImageFilter::CheckModelCompatibility(VectorType &modelValue, itk::ThreadIdType threadId)
+{
+    if (m_UsePrecomputedFields)
+    {
+        // ADC from the exponentiated tensor trace
+        double adcValue = (modelValue[5] + modelValue[7] + modelValue[10]) / 3.0;
+        if (adcValue > m_StopADCThreshold)
+            return false;
+
+        return (modelValue[3] >= m_StopFAThreshold);
+    }
+
+    double eVals[3];
+    anima::ComputeTensorEigenValues3D(modelValue.GetDataPointer(),eVals);
 
     double meanEvals = 0;
     for (unsigned int i = 0;i < 3;++i)
@@ -75,27 +234,35 @@ bool dtiTractographyImageFilter::CheckIndexInImageBounds(ContinuousIndexType &in
 void
 dtiTractographyImageFilter::GetModelValue(ContinuousIndexType &index, VectorType &modelValue)
 {
+    if (m_UsePrecomputedFields)
+    {
+        this->InterpolatePrecomputedFields(index,modelValue);
+        return;
+    }
+
     modelValue = m_DTIInterpolator->EvaluateAtContinuousIndex(index);
 }
 
 std::vector <dtiTractographyImageFilter::PointType>
 dtiTractographyImageFilter::GetModelPrincipalDirections(VectorType &modelValue, bool is2d, itk::ThreadIdType threadId)
 {
-    typedef vnl_matrix <double> MatrixType;
-
-    itk::SymmetricEigenAnalysis <MatrixType,vnl_diag_matrix <double>,MatrixType> EigenAnalysis(3);
-
-    MatrixType tmpMat(3,3);
-    vnl_diag_matrix <double> eVals(3);
-    MatrixType eVec(3,3);
+    std::vector <PointType> resDir(1);
 
-    anima::GetTensorFromVectorRepresentation(modelValue,tmpMat);
+    if (m_UsePrecomputedFields)
+    {
+        for (unsigned int i = 0;i < 3;++i)
+            resDir[0][i] = modelValue[i];
 
-    EigenAnalysis.ComputeEigenValuesAndVectors(tmpMat,eVals,eVec);
-    std::vector <PointType> resDir(1);
+        anima::Normalize(resDir[0],resDir[0]);
+    }
+    else
+    {
+        double eVals[3], eVecs[3][3];
+        anima::ComputeTensorEigenSystem3D(modelValue.GetDataPointer(),eVals,eVecs);
 
-    for (unsigned int i = 0;i < 3;++i)
-        resDir[0][i] = eVec(2,i);
+        for (unsigned int i = 0;i < 3;++i)
+            resDir[0][i] = eVecs[2][i];
+    }
 
     if (is2d)
     {
@@ -110,45 +277,68 @@ dtiTractographyImageFilter::PointType
 dtiTractographyImageFilter::GetNextDirection(PointType &previousDirection, VectorType &modelValue, bool is2d,
                                              itk::ThreadIdType threadId)
 {
-    PointType newDirection = this->GetModelPrincipalDirections(modelValue,is2d,threadId)[0];
-    if (anima::ComputeScalarProduct(previousDirection, newDirection) < 0)
-        anima::Revert(newDirection,newDirection);
+    PointType newDirection, advectedDirection;
+    double linearCoefficient;
 
-    typedef vnl_matrix <double> MatrixType;
-    MatrixType tmpMat(3,3);
-
-    anima::GetTensorFromVectorRepresentation(modelValue,tmpMat,3,false);
+    if (m_UsePrecomputedFields)
+    {
+        // Everything comes from interpolated fields, no eigen-decomposition
+        for (unsigned int i = 0;i < 3;++i)
+            newDirection[i] = modelValue[i];
 
-    vnl_diag_matrix <double> eVals(3);
-    itk::SymmetricEigenAnalysis <MatrixType,vnl_diag_matrix <double>,MatrixType> EigenAnalysis(3);
-    MatrixType eVecs(3,3);
-    EigenAnalysis.ComputeEigenValuesAndVectors(tmpMat,eVals, eVecs);
+        linearCoefficient = modelValue[4];
 
-    double sumEigs = 0.0;
-    for (unsigned int i = 0;i < 3;++i)
-    {
-        eVals[i] = std::exp(eVals[i]);
-        sumEigs += eVals[i];
+        // Compute advected direction as in Weinstein et al.
+        const unsigned int tensorIndexes[3][3] = {{5, 6, 8}, {6, 7, 9}, {8, 9, 10}};
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            advectedDirection[i] = 0.0;
+            for (unsigned int j = 0;j < 3;++j)
+                advectedDirection[i] += modelValue[tensorIndexes[i][j]] * previousDirection[j];
+        }
     }
+    else
+    {
+        // Single eigen-decomposition for both principal direction and tensor deflection
+        double eVals[3], eVecs[3][3];
+        anima::ComputeTensorEigenSystem3D(modelValue.GetDataPointer(),eVals,eVecs);
+
+        for (unsigned int i = 0;i < 3;++i)
+            newDirection[i] = eVecs[2][i];
+
+        double sumEigs = 0.0;
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            eVals[i] = std::exp(eVals[i]);
+            sumEigs += eVals[i];
+        }
 
-    anima::RecomposeTensor(eVals,eVecs,tmpMat);
+        linearCoefficient = (eVals[2] - eVals[1]) / sumEigs;
 
-    // Compute advected direction as in Weinstein et al.
-    PointType advectedDirection;
+        // Compute advected direction as in Weinstein et al., applying the tensor through its eigen-decomposition
+        advectedDirection.Fill(0.0);
+        for (unsigned int k = 0;k < 3;++k)
+        {
+            double projection = 0.0;
+            for (unsigned int j = 0;j < 3;++j)
+                projection += eVecs[k][j] * previousDirection[j];
 
-    for (unsigned int i = 0;i < 3;++i)
-    {
-        advectedDirection[i] = 0.0;
-        for (unsigned int j = 0;j < 3;++j)
-            advectedDirection[i] += tmpMat(i,j) * previousDirection[j];
+            for (unsigned int i = 0;i < 3;++i)
+                advectedDirection[i] += eVals[k] * projection * eVecs[k][i];
+        }
     }
 
+    if (is2d)
+        newDirection[2] = 0;
+
+    anima::Normalize(newDirection,newDirection);
+    if (anima::ComputeScalarProduct(previousDirection, newDirection) < 0)
+        anima::Revert(newDirection,newDirection);
+
     anima::Normalize(advectedDirection,advectedDirection);
     if (anima::ComputeScalarProduct(previousDirection, advectedDirection) < 0)
         anima::Revert(advectedDirection,advectedDirection);
 
-    double linearCoefficient = (eVals[2] - eVals[1]) / sumEigs;
-
     for (unsigned int i = 0;i < 3;++i)
         newDirection[i] = newDirection[i] * linearCoefficient + (1.0 - linearCoefficient) * ((1.0 - this->GetPunctureWeight()) * previousDirection[i] + this->GetPunctureWeight() * advectedDirection[i]);
 
@@ -176,15 +366,9 @@ void dtiTractographyImageFilter::ComputeAdditionalScalarMaps()
     PointType tmpPoint;
     DTIInterpolatorType::ContinuousIndexType tmpIndex;
 
-    typedef vnl_matrix <double> MatrixType;
-    MatrixType tmpMat(3,3);
-
-    vnl_diag_matrix <double> eVals(3);
-    itk::SymmetricEigenAnalysis <MatrixType,vnl_diag_matrix <double>,MatrixType> EigenAnalysis(3);
+    double eVals[3];
     VectorType tensorValue(6);
 
-    anima::LogEuclideanTensorCalculator <double>::Pointer leCalculator = anima::LogEuclideanTensorCalculator <double>::New();
-
     for (unsigned int i = 0;i < numPoints;++i)
     {
         for (unsigned int j = 0;j < 3;++j)
@@ -192,21 +376,40 @@ void dtiTractographyImageFilter::ComputeAdditionalScalarMaps()
 
         this->GetInputImage()->TransformPhysicalPointToContinuousIndex(tmpPoint,tmpIndex);
         tensorValue.Fill(0.0);
-        if (m_DTIInterpolator->IsInsideBuffer(tmpIndex))
+        bool insideBuffer = m_DTIInterpolator->IsInsideBuffer(tmpIndex);
+        if (insideBuffer)
             this->GetModelValue(tmpIndex,tensorValue);
 
-        anima::GetTensorFromVectorRepresentation(tensorValue,tmpMat,3,false);
-        leCalculator->GetTensorExponential(tmpMat,tmpMat);
+        if (m_UsePrecomputedFields)
+        {
+            // Null fields stand for a null log-tensor, i.e. identity tensor
+            double adcValue = 1.0;
+            double faValue = 0.0;
+            if (insideBuffer && !this->isZero(tensorValue))
+            {
+                adcValue = (tensorValue[5] + tensorValue[7] + tensorValue[10]) / 3.0;
+                faValue = tensorValue[3];
+            }
+
+            adcArray->InsertNextValue(adcValue);
+            faArray->InsertNextValue(faValue);
+            continue;
+        }
+
+        // Tensor exponential eigenvalues are the exponentials of log-tensor eigenvalues
+        anima::ComputeTensorEigenValues3D(tensorValue.GetDataPointer(),eVals);
 
         double adcValue = 0;
         for (unsigned int j = 0;j < 3;++j)
-            adcValue += tmpMat(j,j);
+        {
+            eVals[j] = std::exp(eVals[j]);
+            adcValue += eVals[j];
+        }
 
         adcArray->InsertNextValue(adcValue / 3.0);
 
         double faValue = 0;
         double faValueDenom = 0;
-        EigenAnalysis.ComputeEigenValues(tmpMat,eVals);
         for (unsigned int j = 0;j < 3;++j)
         {
             faValueDenom += eVals[j] * eVals[j];
@@ -31,6 +31,11 @@ public:
     typedef Superclass::PointType PointType;
     typedef itk::LinearInterpolateImageFunction <ModelImageType> DTIInterpolatorType;
     typedef DTIInterpolatorType::Pointer DTIInterpolatorPointer;
+
+    //! Per voxel principal direction (3), FA, linear coefficient and exponentiated tensor (6)
+    typedef itk::VectorImage <float, 3> PrecomputedFieldsImageType;
+    typedef PrecomputedFieldsImageType::Pointer PrecomputedFieldsImagePointer;
+    static const unsigned int PrecomputedFieldsSize = 11;
         
     virtual void SetInputImage(ModelImageType *input) ITK_OVERRIDE;
 
@@ -40,6 +45,10 @@ public:
     itkGetMacro(PunctureWeight, double)
     itkSetMacro(PunctureWeight, double)
 
+    //! If on, eigen-decompositions are computed once per voxel before tracking and interpolated while stepping
+    itkGetMacro(UsePrecomputedFields, bool)
+    itkSetMacro(UsePrecomputedFields, bool)
+
 protected:
     dtiTractographyImageFilter();
     virtual ~dtiTractographyImageFilter();
@@ -53,6 +62,14 @@ protected:
 
     virtual void ComputeAdditionalScalarMaps() ITK_OVERRIDE;
 
+    virtual void PrepareTractography() ITK_OVERRIDE;
+
+    //! Computes precomputed fields from a log-tensor
+    void ComputeVoxelFields(const double *logTensor, float *fields);
+
+    //! Trilinear interpolation of precomputed fields, principal directions being sign aligned to the closest voxel one
+    void InterpolatePrecomputedFields(ContinuousIndexType &index, VectorType &fieldsValue);
+
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(dtiTractographyImageFilter);
 
@@ -61,6 +78,9 @@ private:
     double m_PunctureWeight;
 
     DTIInterpolatorPointer m_DTIInterpolator;
+
+    bool m_UsePrecomputedFields;
+    PrecomputedFieldsImagePointer m_PrecomputedFields;
 };
 
 } // end of namespace anima
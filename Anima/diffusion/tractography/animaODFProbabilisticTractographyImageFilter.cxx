@@ -10,6 +10,7 @@
 #include <animaDistributionSampling.h>
 #include <animaVMFDistribution.h>
 #include <animaWatsonDistribution.h>
+#include <animaWatsonDistributionSampler.h>
 
 namespace anima
 {
@@ -52,7 +53,7 @@ void ODFProbabilisticTractographyImageFilter::PrepareTractography()
 ODFProbabilisticTractographyImageFilter::Vector3DType
 ODFProbabilisticTractographyImageFilter::ProposeNewDirection(Vector3DType &oldDirection, VectorType &modelValue,
                                                              Vector3DType &sampling_direction, double &log_prior,
-                                                             double &log_proposal, std::mt19937 &random_generator,
+                                                             double &log_proposal, RandomGeneratorType &random_generator,
                                                              unsigned int threadId)
 {
     Vector3DType resVec(0.0);
@@ -109,7 +110,8 @@ ODFProbabilisticTractographyImageFilter::ProposeNewDirection(Vector3DType &oldDi
     //    else
     //        anima::SampleFromVMFDistribution(chosenKappa,sampling_direction,resVec,random_generator);
 
-    anima::SampleFromWatsonDistribution(chosenKappa,sampling_direction,resVec,3,random_generator);
+    anima::WatsonDistributionSampler watsonSampler(chosenKappa,sampling_direction);
+    watsonSampler.Sample(random_generator,resVec);
 
     if (is2d)
     {
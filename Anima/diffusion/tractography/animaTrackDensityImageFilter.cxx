@@ -0,0 +1,362 @@
+#include "animaTrackDensityImageFilter.h"
+
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPoints.h>
+
+#include <itkMultiThreaderBase.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace anima
+{
+
+TrackDensityImageFilter::TrackDensityImageFilter()
+{
+    m_DensityMode = Count;
+    m_UpsamplingFactor = 1;
+    m_ComputeColors = false;
+    m_NormalizeByNumberOfFibers = false;
+
+    this->SetNumberOfWorkUnits(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads());
+}
+
+void TrackDensityImageFilter::InitializeOutputs()
+{
+    unsigned int factor = std::max(m_UpsamplingFactor,1U);
+
+    OutputImageType::SpacingType spacing = m_Geometry->GetSpacing();
+    OutputImageType::PointType origin = m_Geometry->GetOrigin();
+    OutputImageType::DirectionType direction = m_Geometry->GetDirection();
+    OutputImageType::RegionType region;
+    region.SetIndex(m_Geometry->GetLargestPossibleRegion().GetIndex());
+
+    // Sub-voxel centers: first one is half a sub-voxel away from the corner of the first voxel
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        region.SetSize(i,m_Geometry->GetLargestPossibleRegion().GetSize()[i] * factor);
+        double originShift = spacing[i] * (0.5 / factor - 0.5);
+        for (unsigned int j = 0;j < 3;++j)
+            origin[j] += direction(j,i) * originShift;
+
+        spacing[i] /= factor;
+    }
+
+    m_DensityImage = OutputImageType::New();
+    m_DensityImage->Initialize();
+    m_DensityImage->SetRegions(region);
+    m_DensityImage->SetSpacing(spacing);
+    m_DensityImage->SetOrigin(origin);
+    m_DensityImage->SetDirection(direction);
+    m_DensityImage->Allocate();
+    m_DensityImage->FillBuffer(0.0);
+
+    m_ColorImage = nullptr;
+    if (m_ComputeColors)
+    {
+        m_ColorImage = ColorImageType::New();
+        m_ColorImage->Initialize();
+        m_ColorImage->SetRegions(region);
+        m_ColorImage->SetSpacing(spacing);
+        m_ColorImage->SetOrigin(origin);
+        m_ColorImage->SetDirection(direction);
+        m_ColorImage->SetVectorLength(3);
+        m_ColorImage->Allocate();
+
+        ColorImageType::PixelType zeroColor(3);
+        zeroColor.Fill(0.0);
+        m_ColorImage->FillBuffer(zeroColor);
+    }
+
+    // Continuous index with voxel i covering [i, i+1[, relative to the region start
+    OutputImageType::DirectionType pointToIndex = m_DensityImage->GetPhysicalPointToIndexMatrix();
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        m_PointToIndexOffset[i] = 0.5 - region.GetIndex()[i];
+        for (unsigned int j = 0;j < 3;++j)
+        {
+            m_PointToIndexMatrix[i][j] = pointToIndex(i,j);
+            m_PointToIndexOffset[i] -= pointToIndex(i,j) * origin[j];
+        }
+    }
+
+    unsigned int numberOfVoxels = region.GetNumberOfPixels();
+    m_DensityAccumulator = std::vector < std::atomic <double> > (numberOfVoxels);
+    for (unsigned int i = 0;i < numberOfVoxels;++i)
+        m_DensityAccumulator[i].store(0.0,std::memory_order_relaxed);
+
+    m_ColorAccumulator.clear();
+    if (m_ComputeColors)
+    {
+        // Three color components and total length in each voxel
+        m_ColorAccumulator = std::vector < std::atomic <double> > (4 * numberOfVoxels);
+        for (unsigned int i = 0;i < 4 * numberOfVoxels;++i)
+            m_ColorAccumulator[i].store(0.0,std::memory_order_relaxed);
+    }
+}
+
+template <class PointScalarType, class OffsetType>
+void TrackDensityImageFilter::ProcessTracks(const PointScalarType *points, const OffsetType *offsets,
+                                            const OffsetType *connectivity, vtkIdType numberOfTracks)
+{
+    OutputImageType::SizeType size = m_DensityImage->GetLargestPossibleRegion().GetSize();
+    long dims[3] = {(long)size[0], (long)size[1], (long)size[2]};
+
+    const vtkIdType chunkSize = 256;
+    vtkIdType numberOfChunks = (numberOfTracks + chunkSize - 1) / chunkSize;
+
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    this->GetMultiThreader()->ParallelizeArray(0, numberOfChunks, [&](itk::SizeValueType chunk)
+    {
+        std::vector <double> indexPoints;
+        std::vector <double> segmentLengths;
+        std::vector <itk::OffsetValueType> visitedVoxels;
+
+        vtkIdType endTrack = std::min((vtkIdType)((chunk + 1) * chunkSize),numberOfTracks);
+        for (vtkIdType track = chunk * chunkSize;track < endTrack;++track)
+        {
+            vtkIdType startPoint = offsets[track];
+            vtkIdType numberOfPoints = offsets[track + 1] - startPoint;
+            if (numberOfPoints == 0)
+                continue;
+
+            // Map points to continuous indexes and compute physical lengths
+            indexPoints.resize(3 * numberOfPoints);
+            segmentLengths.resize(numberOfPoints);
+            double totalLength = 0;
+            for (vtkIdType i = 0;i < numberOfPoints;++i)
+            {
+                const PointScalarType *point = points + 3 * connectivity[startPoint + i];
+                for (unsigned int j = 0;j < 3;++j)
+                {
+                    indexPoints[3 * i + j] = m_PointToIndexOffset[j];
+                    for (unsigned int k = 0;k < 3;++k)
+                        indexPoints[3 * i + j] += m_PointToIndexMatrix[j][k] * point[k];
+                }
+
+                segmentLengths[i] = 0;
+                if (i > 0)
+                {
+                    const PointScalarType *previousPoint = points + 3 * connectivity[startPoint + i - 1];
+                    double squaredLength = 0;
+                    for (unsigned int j = 0;j < 3;++j)
+                        squaredLength += (point[j] - previousPoint[j]) * (point[j] - previousPoint[j]);
+
+                    segmentLengths[i] = std::sqrt(squaredLength);
+                    totalLength += segmentLengths[i];
+                }
+            }
+
+            double lengthFactor = 1.0;
+            if (m_DensityMode == FiberNormalized)
+            {
+                if (totalLength <= 0)
+                    continue;
+
+                lengthFactor = 1.0 / totalLength;
+            }
+
+            visitedVoxels.clear();
+            if (numberOfPoints == 1)
+            {
+                long voxel[3];
+                bool inside = true;
+                for (unsigned int j = 0;j < 3;++j)
+                {
+                    voxel[j] = std::floor(indexPoints[j]);
+                    inside = inside && (voxel[j] >= 0) && (voxel[j] < dims[j]);
+                }
+
+                if (inside)
+                    visitedVoxels.push_back(voxel[0] + dims[0] * (voxel[1] + dims[1] * voxel[2]));
+            }
+
+            for (vtkIdType i = 1;i < numberOfPoints;++i)
+            {
+                const double *startIndex = indexPoints.data() + 3 * (i - 1);
+                const double *endIndex = indexPoints.data() + 3 * i;
+
+                // Absolute physical direction for color encoding
+                double colorDirection[3] = {0, 0, 0};
+                if (m_ComputeColors && (segmentLengths[i] > 0))
+                {
+                    const PointScalarType *point = points + 3 * connectivity[startPoint + i];
+                    const PointScalarType *previousPoint = points + 3 * connectivity[startPoint + i - 1];
+                    for (unsigned int j = 0;j < 3;++j)
+                        colorDirection[j] = std::abs(point[j] - previousPoint[j]) / segmentLengths[i];
+                }
+
+                // Amanatides and Woo traversal of the segment, t in [0,1]
+                long voxel[3], step[3];
+                double tMax[3], tDelta[3];
+                unsigned int maxNumberOfSteps = 1;
+                for (unsigned int j = 0;j < 3;++j)
+                {
+                    voxel[j] = std::floor(startIndex[j]);
+                    double delta = endIndex[j] - startIndex[j];
+                    maxNumberOfSteps += std::abs((long)std::floor(endIndex[j]) - voxel[j]);
+
+                    if (delta > 0)
+                    {
+                        step[j] = 1;
+                        tDelta[j] = 1.0 / delta;
+                        tMax[j] = (voxel[j] + 1 - startIndex[j]) / delta;
+                    }
+                    else if (delta < 0)
+                    {
+                        step[j] = -1;
+                        tDelta[j] = - 1.0 / delta;
+                        tMax[j] = (voxel[j] - startIndex[j]) / delta;
+                    }
+                    else
+                    {
+                        step[j] = 0;
+                        tDelta[j] = std::numeric_limits <double>::max();
+                        tMax[j] = std::numeric_limits <double>::max();
+                    }
+                }
+
+                double t = 0;
+                for (unsigned int s = 0;s < maxNumberOfSteps;++s)
+                {
+                    unsigned int minAxis = 0;
+                    if (tMax[1] < tMax[minAxis])
+                        minAxis = 1;
+                    if (tMax[2] < tMax[minAxis])
+                        minAxis = 2;
+
+                    double tNext = std::min(tMax[minAxis],1.0);
+
+                    if ((voxel[0] >= 0)&&(voxel[0] < dims[0])&&(voxel[1] >= 0)&&(voxel[1] < dims[1])&&
+                            (voxel[2] >= 0)&&(voxel[2] < dims[2]))
+                    {
+                        itk::OffsetValueType offset = voxel[0] + dims[0] * (voxel[1] + dims[1] * voxel[2]);
+                        double voxelLength = (tNext - t) * segmentLengths[i];
+
+                        if (m_DensityMode == Count)
+                            visitedVoxels.push_back(offset);
+                        else if (voxelLength > 0)
+                            this->AtomicAdd(m_DensityAccumulator[offset],voxelLength * lengthFactor);
+
+                        if (m_ComputeColors && (voxelLength > 0))
+                        {
+                            for (unsigned int j = 0;j < 3;++j)
+                                this->AtomicAdd(m_ColorAccumulator[4 * offset + j],colorDirection[j] * voxelLength);
+                            this->AtomicAdd(m_ColorAccumulator[4 * offset + 3],voxelLength);
+                        }
+                    }
+
+                    t = tNext;
+                    if (t >= 1.0)
+                        break;
+
+                    voxel[minAxis] += step[minAxis];
+                    tMax[minAxis] += tDelta[minAxis];
+                }
+            }
+
+            if (m_DensityMode == Count)
+            {
+                // Each streamline counts once in each voxel it goes through
+                std::sort(visitedVoxels.begin(),visitedVoxels.end());
+                std::vector <itk::OffsetValueType>::iterator lastVoxel = std::unique(visitedVoxels.begin(),visitedVoxels.end());
+                for (std::vector <itk::OffsetValueType>::iterator it = visitedVoxels.begin();it != lastVoxel;++it)
+                    this->AtomicAdd(m_DensityAccumulator[*it],1.0);
+            }
+        }
+    }, nullptr);
+}
+
+void TrackDensityImageFilter::Update()
+{
+    if (!m_InputTracks)
+        itkExceptionMacro("No input tracks provided");
+
+    if (!m_Geometry)
+        itkExceptionMacro("No output geometry provided");
+
+    this->InitializeOutputs();
+
+    vtkPoints *points = m_InputTracks->GetPoints();
+    vtkCellArray *lines = m_InputTracks->GetLines();
+    vtkIdType numberOfTracks = lines ? lines->GetNumberOfCells() : 0;
+
+    if ((numberOfTracks > 0)&&(points))
+    {
+        // Points are read from their raw buffer, converted only if not stored as float or double
+        vtkSmartPointer <vtkDataArray> pointArray = points->GetData();
+        if ((pointArray->GetDataType() != VTK_FLOAT)&&(pointArray->GetDataType() != VTK_DOUBLE))
+        {
+            vtkSmartPointer <vtkDoubleArray> doubleArray = vtkSmartPointer <vtkDoubleArray>::New();
+            doubleArray->DeepCopy(pointArray);
+            pointArray = doubleArray;
+        }
+
+        float *floatPoints = nullptr;
+        double *doublePoints = nullptr;
+        if (pointArray->GetDataType() == VTK_FLOAT)
+            floatPoints = vtkFloatArray::SafeDownCast(pointArray)->GetPointer(0);
+        else
+            doublePoints = vtkDoubleArray::SafeDownCast(pointArray)->GetPointer(0);
+
+        if (lines->IsStorage64Bit())
+        {
+            vtkTypeInt64 *offsets = lines->GetOffsetsArray64()->GetPointer(0);
+            vtkTypeInt64 *connectivity = lines->GetConnectivityArray64()->GetPointer(0);
+
+            if (floatPoints)
+                this->ProcessTracks(floatPoints,offsets,connectivity,numberOfTracks);
+            else
+                this->ProcessTracks(doublePoints,offsets,connectivity,numberOfTracks);
+        }
+        else
+        {
+            vtkTypeInt32 *offsets = lines->GetOffsetsArray32()->GetPointer(0);
+            vtkTypeInt32 *connectivity = lines->GetConnectivityArray32()->GetPointer(0);
+
+            if (floatPoints)
+                this->ProcessTracks(floatPoints,offsets,connectivity,numberOfTracks);
+            else
+                this->ProcessTracks(doublePoints,offsets,connectivity,numberOfTracks);
+        }
+    }
+
+    double normalizationFactor = 1.0;
+    if (m_NormalizeByNumberOfFibers && (numberOfTracks > 0))
+        normalizationFactor /= numberOfTracks;
+
+    // Copy accumulators into output images
+    double *densityBuffer = m_DensityImage->GetBufferPointer();
+    double *colorBuffer = m_ComputeColors ? m_ColorImage->GetBufferPointer() : nullptr;
+    itk::SizeValueType numberOfVoxels = m_DensityImage->GetLargestPossibleRegion().GetNumberOfPixels();
+
+    const itk::SizeValueType chunkSize = 65536;
+    itk::SizeValueType numberOfChunks = (numberOfVoxels + chunkSize - 1) / chunkSize;
+    this->GetMultiThreader()->ParallelizeArray(0, numberOfChunks, [&](itk::SizeValueType chunk)
+    {
+        itk::SizeValueType endVoxel = std::min((chunk + 1) * chunkSize,numberOfVoxels);
+        for (itk::SizeValueType i = chunk * chunkSize;i < endVoxel;++i)
+        {
+            densityBuffer[i] = m_DensityAccumulator[i].load(std::memory_order_relaxed) * normalizationFactor;
+
+            if (!colorBuffer)
+                continue;
+
+            double voxelLength = m_ColorAccumulator[4 * i + 3].load(std::memory_order_relaxed);
+            for (unsigned int j = 0;j < 3;++j)
+            {
+                colorBuffer[3 * i + j] = 0;
+                if (voxelLength > 0)
+                    colorBuffer[3 * i + j] = m_ColorAccumulator[4 * i + j].load(std::memory_order_relaxed) / voxelLength;
+            }
+        }
+    }, nullptr);
+
+    m_DensityAccumulator.clear();
+    m_ColorAccumulator.clear();
+}
+
+} // end namespace anima
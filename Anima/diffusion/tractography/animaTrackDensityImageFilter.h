@@ -0,0 +1,114 @@
+#pragma once
+
+#include <itkImage.h>
+#include <itkVectorImage.h>
+#include <itkProcessObject.h>
+
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <atomic>
+#include <vector>
+
+#include "AnimaTractographyExport.h"
+
+namespace anima
+{
+
+/**
+ * @brief Track density imaging from a set of streamlines. Each streamline segment is traversed exactly through
+ * the output grid (Amanatides and Woo voxel traversal), so that results do not depend on the tracking step size.
+ * Streamlines are processed in parallel directly from the raw VTK points and connectivity arrays, accumulating into
+ * shared maps with atomic additions. The output grid is the geometry image one, possibly upsampled (super-resolution).
+ */
+class ANIMATRACTOGRAPHY_EXPORT TrackDensityImageFilter : public itk::ProcessObject
+{
+public:
+    /** SmartPointer typedef support  */
+    typedef TrackDensityImageFilter Self;
+    typedef itk::ProcessObject Superclass;
+
+    typedef itk::SmartPointer<Self> Pointer;
+    typedef itk::SmartPointer<const Self> ConstPointer;
+
+    itkNewMacro(Self)
+    itkTypeMacro(TrackDensityImageFilter,itk::ProcessObject)
+
+    typedef itk::ImageBase <3> GeometryImageType;
+    typedef itk::Image <double, 3> OutputImageType;
+    typedef OutputImageType::Pointer OutputImagePointer;
+    typedef itk::VectorImage <double, 3> ColorImageType;
+    typedef ColorImageType::Pointer ColorImagePointer;
+
+    enum DensityMode
+    {
+        //! Number of streamlines going through each voxel
+        Count = 0,
+        //! Total streamline length in each voxel
+        Length,
+        //! Length in each voxel divided by streamline length, each streamline contributing 1 in total
+        FiberNormalized
+    };
+
+    void SetInputTracks(vtkPolyData *tracks) {m_InputTracks = tracks;}
+    void SetGeometry(const GeometryImageType *geometry) {m_Geometry = geometry;}
+
+    itkSetMacro(DensityMode, DensityMode)
+    itkGetConstMacro(DensityMode, DensityMode)
+
+    //! Number of output voxels per geometry voxel along each axis
+    itkSetMacro(UpsamplingFactor, unsigned int)
+    itkGetConstMacro(UpsamplingFactor, unsigned int)
+
+    //! Compute directionally encoded color map (length weighted mean of absolute segment directions)
+    itkSetMacro(ComputeColors, bool)
+
+    //! Divide density by the number of streamlines (proportion of streamlines in count mode)
+    itkSetMacro(NormalizeByNumberOfFibers, bool)
+
+    void Update() ITK_OVERRIDE;
+
+    OutputImageType *GetDensityImage() {return m_DensityImage;}
+    ColorImageType *GetColorImage() {return m_ColorImage;}
+
+protected:
+    TrackDensityImageFilter();
+    virtual ~TrackDensityImageFilter() {}
+
+    //! Builds output images from geometry and upsampling factor
+    void InitializeOutputs();
+
+    template <class PointScalarType, class OffsetType>
+    void ProcessTracks(const PointScalarType *points, const OffsetType *offsets, const OffsetType *connectivity,
+                       vtkIdType numberOfTracks);
+
+    //! Adds value to an atomic accumulator
+    inline void AtomicAdd(std::atomic <double> &target, double value)
+    {
+        double current = target.load(std::memory_order_relaxed);
+        while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed));
+    }
+
+private:
+    ITK_DISALLOW_COPY_AND_ASSIGN(TrackDensityImageFilter);
+
+    vtkSmartPointer <vtkPolyData> m_InputTracks;
+    GeometryImageType::ConstPointer m_Geometry;
+
+    DensityMode m_DensityMode;
+    unsigned int m_UpsamplingFactor;
+    bool m_ComputeColors;
+    bool m_NormalizeByNumberOfFibers;
+
+    OutputImagePointer m_DensityImage;
+    ColorImagePointer m_ColorImage;
+
+    //! Physical point to continuous index (voxel corner at 0) matrix and offset
+    double m_PointToIndexMatrix[3][3];
+    double m_PointToIndexOffset[3];
+
+    std::vector < std::atomic <double> > m_DensityAccumulator;
+    std::vector < std::atomic <double> > m_ColorAccumulator;
+};
+
+} // end namespace anima
@@ -2,6 +2,7 @@
 #include <itkTimeProbe.h>
 
 #include <tclap/CmdLine.h>
+#include <animaInstrumentationArguments.h>
 
 #include <animaReadWriteFunctions.h>
 #include <animaLogTensorImageFilter.h>
@@ -72,8 +73,12 @@ int main(int argc,  char*  argv[])
     TCLAP::SwitchArg averageClustersArg("M","average-clusters","Output only cluster mean",cmd,false);
     TCLAP::SwitchArg addLocalDataArg("L","local-data","Add local data information to output tracks",cmd);
 
+    TCLAP::ValueArg<unsigned int> randomSeedArg("","random-seed","Random generator seed, tracts are identical for a given seed whatever the number of threads (default: based on current time)",false,0,"random seed",cmd);
+
     TCLAP::ValueArg<unsigned int> nbThreadsArg("T","nb-threads","Number of threads to run on (default: all available)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
     
+    anima::InstrumentationArguments instrumentationArgs(cmd);
+
     try
     {
         cmd.parse(argc,argv);
@@ -84,6 +89,8 @@ int main(int argc,  char*  argv[])
         return(1);
     }
 
+    instrumentationArgs.Setup();
+
     typedef anima::DTIProbabilisticTractographyImageFilter MainFilterType;
     typedef MainFilterType::InputModelImageType InputModelImageType;
     typedef MainFilterType::MaskImageType MaskImageType;
@@ -150,6 +157,8 @@ int main(int argc,  char*  argv[])
     dtiTracker->SetComputeLocalColors(computeLocalColors);
     dtiTracker->SetMAPMergeFibers(averageClustersArg.isSet());
     dtiTracker->SetNumberOfWorkUnits(nbThreadsArg.getValue());
+    if (randomSeedArg.isSet())
+        dtiTracker->SetSeed(randomSeedArg.getValue());
 
     itk::CStyleCommand::Pointer callback = itk::CStyleCommand::New();
     callback->SetCallback(eventCallback);
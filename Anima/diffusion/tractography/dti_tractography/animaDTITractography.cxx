@@ -40,6 +40,7 @@ int main(int argc,  char*  argv[])
     TCLAP::ValueArg<double> maxLengthArg("","max-length","Maximum length of a tract (default: 200mm)",false,200.0,"maximum length",cmd);
 
     TCLAP::SwitchArg addLocalDataArg("L","local-data","Add local data information to output tracks",cmd);
+    TCLAP::SwitchArg precomputeArg("P","precompute-fields","Compute tensor eigen-decompositions once per voxel before tracking (faster with many seeds, interpolates directions instead of tensors)",cmd);
 
     TCLAP::ValueArg<unsigned int> nbThreadsArg("T","nb-threads","Number of threads to run on (default: all available)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
 
@@ -90,6 +91,7 @@ int main(int argc,  char*  argv[])
     dtiTracker->SetMaxFiberAngle(stopAngleArg.getValue());
     dtiTracker->SetMinLengthFiber(minLengthArg.getValue());
     dtiTracker->SetMaxLengthFiber(maxLengthArg.getValue());
+    dtiTracker->SetUsePrecomputedFields(precomputeArg.isSet());
 
     bool computeColors = (fibersArg.getValue().find(".fds") != std::string::npos) && (addLocalDataArg.isSet());
     dtiTracker->SetComputeLocalColors(computeColors);
@@ -2,22 +2,26 @@
 
 #include <animaReadWriteFunctions.h>
 #include <animaShapesReader.h>
+#include <animaTrackDensityImageFilter.h>
 
 #include <vtkSmartPointer.h>
-#include <vtkPoints.h>
-#include <vtkPointData.h>
 #include <vtkPolyData.h>
-#include <vtkCell.h>
 
+#include <itkImageFileReader.h>
 #include <itkCastImageFilter.h>
 
 int main(int argc, char **argv)
 {
-    TCLAP::CmdLine cmd("Filters fibers from a vtp file using a label image and specifying with several -t and -f which labels should be touched or are forbidden for each fiber. INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
+    TCLAP::CmdLine cmd("Computes track density images from a set of fibers. Each fiber segment is traversed exactly through the output grid, optionally upsampled from the geometry image. INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
 
     TCLAP::ValueArg<std::string> inArg("i","input","input tracks file",true,"","input tracks",cmd);
-    TCLAP::ValueArg<std::string> outArg("o","output","output mask image",true,"","output mask image",cmd);
+    TCLAP::ValueArg<std::string> outArg("o","output","output density image",true,"","output density image",cmd);
     TCLAP::ValueArg<std::string> geomArg("g","geometry","Geometry image",true,"","geometry image",cmd);
+    TCLAP::ValueArg<std::string> colorArg("c","colors","Output directionally encoded color image",false,"","output color image",cmd);
+
+    TCLAP::ValueArg<unsigned int> modeArg("m","mode","Density mode (0: fibers count, 1: fibers length, 2: length normalized by fiber length, default: 0)",false,0,"density mode",cmd);
+    TCLAP::ValueArg<unsigned int> upsamplingArg("u","upsampling","Upsampling factor of the geometry image grid (default: 1)",false,1,"upsampling factor",cmd);
+    TCLAP::ValueArg<unsigned int> nbpArg("T","nb-threads","Number of threads to run on (default: all cores)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
 
     TCLAP::SwitchArg proportionArg("P","proportion","Output proportion of fibers going through each pixel",cmd,false);
 
@@ -31,9 +35,20 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
-    typedef itk::Image <double, 3> OutputImageType;
-    OutputImageType::Pointer outputImage = anima::readImage <OutputImageType> (geomArg.getValue());
-    outputImage->FillBuffer(0.0);
+    if (modeArg.getValue() > 2)
+    {
+        std::cerr << "Error: unknown density mode " << modeArg.getValue() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    typedef anima::TrackDensityImageFilter DensityFilterType;
+    typedef DensityFilterType::OutputImageType OutputImageType;
+
+    // Only the geometry is needed, voxel values are not read
+    typedef itk::ImageFileReader <OutputImageType> GeometryReaderType;
+    GeometryReaderType::Pointer geometryReader = GeometryReaderType::New();
+    geometryReader->SetFileName(geomArg.getValue());
+    geometryReader->UpdateOutputInformation();
 
     anima::ShapesReader trackReader;
     trackReader.SetFileName(inArg.getValue());
@@ -41,63 +56,34 @@ int main(int argc, char **argv)
 
     vtkSmartPointer <vtkPolyData> tracks = trackReader.GetOutput();
 
-    vtkIdType nbCells = tracks->GetNumberOfCells();
-    double incrementFactor = 1.0;
-    if (proportionArg.isSet())
-        incrementFactor /= nbCells;
+    DensityFilterType::Pointer densityFilter = DensityFilterType::New();
+    densityFilter->SetInputTracks(tracks);
+    densityFilter->SetGeometry(geometryReader->GetOutput());
+    densityFilter->SetDensityMode((DensityFilterType::DensityMode)modeArg.getValue());
+    densityFilter->SetUpsamplingFactor(upsamplingArg.getValue());
+    densityFilter->SetComputeColors(colorArg.getValue() != "");
+    densityFilter->SetNormalizeByNumberOfFibers(proportionArg.isSet());
+    densityFilter->SetNumberOfWorkUnits(nbpArg.getValue());
 
-    double ptVals[3];
-    OutputImageType::IndexType currentIndex;
-    OutputImageType::PointType currentPoint;
-    OutputImageType::RegionType region = outputImage->GetLargestPossibleRegion();
+    densityFilter->Update();
 
-    // Explores individual fibers
-    for (int j = 0;j < nbCells;++j)
-    {
-        vtkCell *cell = tracks->GetCell(j);
-        vtkPoints *cellPts = cell->GetPoints();
-        vtkIdType nbPts = cellPts->GetNumberOfPoints();
-
-        // Explores points in fibers
-        for (int i = 0;i < nbPts;++i)
-        {
-            cellPts->GetPoint(i,ptVals);
-
-            for (unsigned int k = 0;k < 3;++k)
-                currentPoint[k] = ptVals[k];
-
-            outputImage->TransformPhysicalPointToIndex(currentPoint,currentIndex);
-            bool insideBuffer = true;
-            for (unsigned int k = 0;k < 3;++k)
-            {
-                if ((currentIndex[k] < 0)||(currentIndex[k] >= region.GetSize(k)))
-                {
-                    insideBuffer = false;
-                    break;
-                }
-            }
-
-            if (!insideBuffer)
-                continue;
-
-            double countIndex = outputImage->GetPixel(currentIndex) + incrementFactor;
-            outputImage->SetPixel(currentIndex, countIndex);
-        }
-    }
-
-    if (proportionArg.isSet())
-        anima::writeImage <OutputImageType> (outArg.getValue(),outputImage);
+    if (proportionArg.isSet() || (modeArg.getValue() != DensityFilterType::Count))
+        anima::writeImage <OutputImageType> (outArg.getValue(),densityFilter->GetDensityImage());
     else
     {
         using MaskImageType = itk::Image <unsigned int, 3>;
         using CastFilterType = itk::CastImageFilter <OutputImageType, MaskImageType>;
 
         CastFilterType::Pointer castFilter = CastFilterType::New();
-        castFilter->SetInput(outputImage);
+        castFilter->SetInput(densityFilter->GetDensityImage());
+        castFilter->SetNumberOfWorkUnits(nbpArg.getValue());
         castFilter->Update();
 
         anima::writeImage <MaskImageType> (outArg.getValue(), castFilter->GetOutput());
     }
 
+    if (colorArg.getValue() != "")
+        anima::writeImage <DensityFilterType::ColorImageType> (colorArg.getValue(),densityFilter->GetColorImage());
+
     return EXIT_SUCCESS;
 }
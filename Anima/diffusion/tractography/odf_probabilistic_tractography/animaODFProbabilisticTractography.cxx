@@ -3,6 +3,7 @@
 #include <itkTimeProbe.h>
 
 #include <tclap/CmdLine.h>
+#include <animaInstrumentationArguments.h>
 
 #include <animaReadWriteFunctions.h>
 #include <animaLogTensorImageFilter.h>
@@ -66,8 +67,12 @@ int main(int argc,  char*  argv[])
     TCLAP::SwitchArg averageClustersArg("M","average-clusters","Output only cluster mean",cmd,false);
     TCLAP::SwitchArg addLocalDataArg("L","local-data","Add local data information to output tracks",cmd);
 
+    TCLAP::ValueArg<unsigned int> randomSeedArg("","random-seed","Random generator seed, tracts are identical for a given seed whatever the number of threads (default: based on current time)",false,0,"random seed",cmd);
+
     TCLAP::ValueArg<unsigned int> nbThreadsArg("T","nb-threads","Number of threads to run on (default: all available)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
 
+    anima::InstrumentationArguments instrumentationArgs(cmd);
+
     try
     {
         cmd.parse(argc,argv);
@@ -77,6 +82,8 @@ int main(int argc,  char*  argv[])
         std::cerr << "Error: " << e.error() << "for argument " << e.argId() << std::endl;
         return(1);
     }
+
+    instrumentationArgs.Setup();
     
     typedef anima::ODFProbabilisticTractographyImageFilter MainFilterType;
     typedef MainFilterType::InputModelImageType InputModelImageType;
@@ -86,6 +93,8 @@ int main(int argc,  char*  argv[])
     MainFilterType::Pointer odfTracker = MainFilterType::New();
 
     odfTracker->SetNumberOfWorkUnits(nbThreadsArg.getValue());
+    if (randomSeedArg.isSet())
+        odfTracker->SetSeed(randomSeedArg.getValue());
     odfTracker->SetInputModelImage(anima::readImage <InputModelImageType> (odfArg.getValue()));
 
     odfTracker->SetInitialColinearityDirection((MainFilterType::ColinearityDirectionType)colinearityModeArg.getValue());
@@ -1,9 +1,16 @@
 #pragma once
 
 #include <vector>
+#include <itkMultiThreaderBase.h>
 
 namespace anima {
 
+/**
+ * @brief K-means clustering of points. Inputs are stored coordinate-wise in a contiguous buffer, memberships
+ * updates use Hamerly's bounds (G. Hamerly, "Making k-means even faster", SDM 2010) to skip most distance
+ * computations, and both steps are split between threads for large inputs. Without initial memberships,
+ * centroids are seeded with k-means++ (D. Arthur and S. Vassilvitskii, SODA 2007)
+ */
 template <class DataType, unsigned int PointDimension>
 class KMeansFilter
 {
@@ -11,6 +18,7 @@ public:
     typedef DataType VectorType;
     typedef std::vector < VectorType > DataHolderType;
     typedef std::vector < unsigned int > MembershipType;
+    typedef KMeansFilter <DataType,PointDimension> Self;
 
     KMeansFilter();
     virtual ~KMeansFilter();
@@ -24,6 +32,11 @@ public:
 
     void SetMaxIterations(unsigned int mIt) {m_MaxIterations = mIt;}
 
+    //! If false, the first inputs are used as initial centroids
+    void SetUseKMeansPlusPlusInitialization(bool val) {m_UseKMeansPlusPlusInitialization = val;}
+    void SetSeed(unsigned int val) {m_Seed = val;}
+    void SetNumberOfThreads(unsigned int val) {m_NumberOfThreads = val;}
+
     void ComputeCentroids();
     void UpdateMemberships();
 
@@ -42,12 +55,40 @@ public:
 
     unsigned int GetNumberPerClass(unsigned int i) {return m_NumberPerClass[i];}
 
+    //! Threads are only used for inputs larger than this number times the number of threads
+    static unsigned int GetMinimalNumberOfInputsPerThread() {return 2048;}
+
+protected:
+    void ComputeKMeansPlusPlusCentroids();
+    unsigned int GetActualNumberOfThreads();
+
+    struct ThreadedKMeansData
+    {
+        Self *kmeansFilter;
+        std::vector < std::vector <double> > partialSums;
+        std::vector < std::vector <unsigned int> > partialCounts;
+    };
+
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedCentroidsComputation(void *arg);
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedMembershipsUpdate(void *arg);
+    void InternalCentroidsComputation(unsigned int threadId, unsigned int numThreads,
+                                      std::vector <double> &sums, std::vector <unsigned int> &counts);
+    void InternalMembershipsUpdate(unsigned int threadId, unsigned int numThreads);
+
+    //! Exact nearest and second nearest centroids for inputs in [startIndex,endIndex), bounds are reset
+    void ComputeNearestCentroids(unsigned int startIndex, unsigned int endIndex);
+
 private:
-    double computeDistance(VectorType &vec1, VectorType &vec2);
+    double computeInputDistance(unsigned int inputIndex, unsigned int classIndex);
 
     MembershipType m_ClassesMembership;
     DataHolderType m_Centroids;
-    DataHolderType m_InputData;
+
+    //! Input coordinate k of input i is at k * m_NbInputs + i
+    std::vector <double> m_InputBuffer;
+    //! Coordinate k of centroid j is at j * PointDimension + k
+    std::vector <double> m_CentroidsBuffer;
+    VectorType m_ZeroVector;
 
     std::vector <unsigned int> m_NumberPerClass;
 
@@ -55,6 +96,17 @@ private:
     unsigned int m_MaxIterations;
 
     bool m_Verbose;
+
+    bool m_UseKMeansPlusPlusInitialization;
+    unsigned int m_Seed;
+    unsigned int m_NumberOfThreads;
+
+    // Hamerly bounds: upper bound to the assigned centroid, lower bound to all others
+    bool m_BoundsUpToDate;
+    std::vector <double> m_UpperBounds, m_LowerBounds;
+    std::vector <double> m_CentroidMoves, m_CentroidHalfSeparations;
+    double m_MaximalMove, m_SecondMaximalMove;
+    unsigned int m_MaximalMoveIndex;
 };
 
 } // end namespace anima
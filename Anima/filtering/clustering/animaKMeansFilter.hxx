@@ -1,6 +1,13 @@
 #pragma once
 #include "animaKMeansFilter.h"
 
+#include <itkPoolMultiThreader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
 namespace anima {
 
 template <class DataType, unsigned int PointDimension>
@@ -9,7 +16,7 @@ KMeansFilter()
 {
     m_ClassesMembership.clear();
     m_Centroids.clear();
-    m_InputData.clear();
+    m_InputBuffer.clear();
     m_NumberPerClass.clear();
 
     m_NbClass = 0;
@@ -17,6 +24,15 @@ KMeansFilter()
     m_MaxIterations = 100;
 
     m_Verbose = true;
+
+    m_UseKMeansPlusPlusInitialization = true;
+    m_Seed = 0;
+    m_NumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+
+    m_BoundsUpToDate = false;
+    m_MaximalMove = 0;
+    m_SecondMaximalMove = 0;
+    m_MaximalMoveIndex = 0;
 }
 
 template <class DataType, unsigned int PointDimension>
@@ -33,8 +49,17 @@ SetInputData(DataHolderType &data)
     if (data.size() == 0)
         return;
 
-    m_InputData = data;
-    m_NbInputs = m_InputData.size();
+    m_NbInputs = data.size();
+    m_InputBuffer.resize(PointDimension * m_NbInputs);
+    for (unsigned int i = 0;i < m_NbInputs;++i)
+    {
+        for (unsigned int k = 0;k < PointDimension;++k)
+            m_InputBuffer[k * m_NbInputs + i] = data[i][k];
+    }
+
+    m_ZeroVector = data[0];
+    m_ZeroVector.Fill(0);
+    m_BoundsUpToDate = false;
 }
 
 template <class DataType, unsigned int PointDimension>
@@ -65,28 +90,125 @@ Update()
     }
 }
 
+template <class DataType, unsigned int PointDimension>
+unsigned int
+KMeansFilter <DataType,PointDimension>::
+GetActualNumberOfThreads()
+{
+    unsigned int maximalNumberOfThreads = std::max(1u, m_NbInputs / GetMinimalNumberOfInputsPerThread());
+    return std::max(1u, std::min(m_NumberOfThreads, maximalNumberOfThreads));
+}
+
 template <class DataType, unsigned int PointDimension>
 void
 KMeansFilter <DataType,PointDimension>::
 ComputeCentroids()
 {
-    for (unsigned int i = 0;i < m_NbClass;++i)
-        m_Centroids[i].Fill(0);
+    unsigned int actualNumberOfThreads = this->GetActualNumberOfThreads();
 
-    for (unsigned int j = 0;j < m_NbInputs;++j)
+    ThreadedKMeansData *tmpStr = new ThreadedKMeansData;
+    tmpStr->kmeansFilter = this;
+    tmpStr->partialSums.resize(actualNumberOfThreads);
+    tmpStr->partialCounts.resize(actualNumberOfThreads);
+
+    if (actualNumberOfThreads > 1)
     {
-        for (unsigned int k = 0;k < PointDimension;++k)
-            m_Centroids[m_ClassesMembership[j]][k] += m_InputData[j][k];
+        itk::PoolMultiThreader::Pointer threaderCentroids = itk::PoolMultiThreader::New();
+        threaderCentroids->SetNumberOfWorkUnits(actualNumberOfThreads);
+        threaderCentroids->SetSingleMethod(this->ThreadedCentroidsComputation,tmpStr);
+        threaderCentroids->SingleMethodExecute();
+    }
+    else
+        this->InternalCentroidsComputation(0,1,tmpStr->partialSums[0],tmpStr->partialCounts[0]);
+
+    // Reduction in thread order, empty classes get a null centroid
+    std::vector <double> newCentroids(m_NbClass * PointDimension,0.0);
+    std::fill(m_NumberPerClass.begin(),m_NumberPerClass.end(),0);
+    for (unsigned int i = 0;i < actualNumberOfThreads;++i)
+    {
+        for (unsigned int j = 0;j < m_NbClass * PointDimension;++j)
+            newCentroids[j] += tmpStr->partialSums[i][j];
+
+        for (unsigned int j = 0;j < m_NbClass;++j)
+            m_NumberPerClass[j] += tmpStr->partialCounts[i][j];
     }
 
+    delete tmpStr;
+
+    m_CentroidMoves.resize(m_NbClass);
     for (unsigned int j = 0;j < m_NbClass;++j)
     {
         if (m_NumberPerClass[j] != 0)
         {
             for (unsigned int k = 0;k < PointDimension;++k)
-                m_Centroids[j][k] /= m_NumberPerClass[j];
+                newCentroids[j * PointDimension + k] /= m_NumberPerClass[j];
+        }
+
+        m_CentroidMoves[j] = 0;
+        if (m_BoundsUpToDate)
+        {
+            for (unsigned int k = 0;k < PointDimension;++k)
+            {
+                double diff = newCentroids[j * PointDimension + k] - m_CentroidsBuffer[j * PointDimension + k];
+                m_CentroidMoves[j] += diff * diff;
+            }
+
+            m_CentroidMoves[j] = std::sqrt(m_CentroidMoves[j]);
         }
     }
+
+    m_CentroidsBuffer = newCentroids;
+    m_Centroids.resize(m_NbClass);
+    for (unsigned int j = 0;j < m_NbClass;++j)
+    {
+        m_Centroids[j] = m_ZeroVector;
+        for (unsigned int k = 0;k < PointDimension;++k)
+            m_Centroids[j][k] = m_CentroidsBuffer[j * PointDimension + k];
+    }
+}
+
+template <class DataType, unsigned int PointDimension>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+KMeansFilter <DataType,PointDimension>::
+ThreadedCentroidsComputation(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+
+    unsigned int nbThread = threadArgs->WorkUnitID;
+    unsigned int nbProcs = threadArgs->NumberOfWorkUnits;
+
+    ThreadedKMeansData *tmpStr = (ThreadedKMeansData *)threadArgs->UserData;
+
+    tmpStr->kmeansFilter->InternalCentroidsComputation(nbThread,nbProcs,tmpStr->partialSums[nbThread],
+                                                       tmpStr->partialCounts[nbThread]);
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <class DataType, unsigned int PointDimension>
+void
+KMeansFilter <DataType,PointDimension>::
+InternalCentroidsComputation(unsigned int threadId, unsigned int numThreads,
+                             std::vector <double> &sums, std::vector <unsigned int> &counts)
+{
+    unsigned int step = m_NbInputs / numThreads;
+    unsigned int startIndex = threadId * step;
+    unsigned int endIndex = (threadId + 1 == numThreads) ? m_NbInputs : (threadId + 1) * step;
+
+    sums.resize(m_NbClass * PointDimension);
+    std::fill(sums.begin(),sums.end(),0.0);
+    counts.resize(m_NbClass);
+    std::fill(counts.begin(),counts.end(),0);
+
+    for (unsigned int k = 0;k < PointDimension;++k)
+    {
+        const double *inputCoordinates = m_InputBuffer.data() + k * m_NbInputs;
+        for (unsigned int i = startIndex;i < endIndex;++i)
+            sums[m_ClassesMembership[i] * PointDimension + k] += inputCoordinates[i];
+    }
+
+    for (unsigned int i = startIndex;i < endIndex;++i)
+        ++counts[m_ClassesMembership[i]];
 }
 
 template <class DataType, unsigned int PointDimension>
@@ -94,24 +216,198 @@ void
 KMeansFilter <DataType,PointDimension>::
 UpdateMemberships()
 {
+    m_UpperBounds.resize(m_NbInputs);
+    m_LowerBounds.resize(m_NbInputs);
+
+    if (m_BoundsUpToDate)
+    {
+        // Half distance from each centroid to its closest one: points within it cannot change class
+        m_CentroidHalfSeparations.resize(m_NbClass);
+        for (unsigned int j = 0;j < m_NbClass;++j)
+        {
+            double minDistance = std::numeric_limits <double>::max();
+            for (unsigned int l = 0;l < m_NbClass;++l)
+            {
+                if (l == j)
+                    continue;
+
+                double tmpDist = 0;
+                for (unsigned int k = 0;k < PointDimension;++k)
+                {
+                    double diff = m_CentroidsBuffer[j * PointDimension + k] - m_CentroidsBuffer[l * PointDimension + k];
+                    tmpDist += diff * diff;
+                }
+
+                minDistance = std::min(minDistance,tmpDist);
+            }
+
+            m_CentroidHalfSeparations[j] = (m_NbClass > 1) ? 0.5 * std::sqrt(minDistance) : std::numeric_limits <double>::max();
+        }
+
+        m_MaximalMove = 0;
+        m_SecondMaximalMove = 0;
+        m_MaximalMoveIndex = 0;
+        for (unsigned int j = 0;j < m_NbClass;++j)
+        {
+            if (m_CentroidMoves[j] > m_MaximalMove)
+            {
+                m_SecondMaximalMove = m_MaximalMove;
+                m_MaximalMove = m_CentroidMoves[j];
+                m_MaximalMoveIndex = j;
+            }
+            else if (m_CentroidMoves[j] > m_SecondMaximalMove)
+                m_SecondMaximalMove = m_CentroidMoves[j];
+        }
+    }
+
+    unsigned int actualNumberOfThreads = this->GetActualNumberOfThreads();
+    if (actualNumberOfThreads > 1)
+    {
+        itk::PoolMultiThreader::Pointer threaderMemberships = itk::PoolMultiThreader::New();
+
+        ThreadedKMeansData *tmpStr = new ThreadedKMeansData;
+        tmpStr->kmeansFilter = this;
+
+        threaderMemberships->SetNumberOfWorkUnits(actualNumberOfThreads);
+        threaderMemberships->SetSingleMethod(this->ThreadedMembershipsUpdate,tmpStr);
+        threaderMemberships->SingleMethodExecute();
+
+        delete tmpStr;
+    }
+    else
+        this->InternalMembershipsUpdate(0,1);
+
+    m_BoundsUpToDate = true;
+
     std::fill(m_NumberPerClass.begin(),m_NumberPerClass.end(),0);
     for (unsigned int i = 0;i < m_NbInputs;++i)
+        ++m_NumberPerClass[m_ClassesMembership[i]];
+}
+
+template <class DataType, unsigned int PointDimension>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+KMeansFilter <DataType,PointDimension>::
+ThreadedMembershipsUpdate(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+
+    unsigned int nbThread = threadArgs->WorkUnitID;
+    unsigned int nbProcs = threadArgs->NumberOfWorkUnits;
+
+    ThreadedKMeansData *tmpStr = (ThreadedKMeansData *)threadArgs->UserData;
+
+    tmpStr->kmeansFilter->InternalMembershipsUpdate(nbThread,nbProcs);
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <class DataType, unsigned int PointDimension>
+void
+KMeansFilter <DataType,PointDimension>::
+InternalMembershipsUpdate(unsigned int threadId, unsigned int numThreads)
+{
+    unsigned int step = m_NbInputs / numThreads;
+    unsigned int startIndex = threadId * step;
+    unsigned int endIndex = (threadId + 1 == numThreads) ? m_NbInputs : (threadId + 1) * step;
+
+    if (!m_BoundsUpToDate)
+    {
+        this->ComputeNearestCentroids(startIndex,endIndex);
+        return;
+    }
+
+    for (unsigned int i = startIndex;i < endIndex;++i)
     {
-        unsigned int bestClass = 0;
-        double bestDistance = this->computeDistance(m_InputData[i],m_Centroids[0]);
+        unsigned int currentClass = m_ClassesMembership[i];
+        m_UpperBounds[i] += m_CentroidMoves[currentClass];
+        m_LowerBounds[i] -= (currentClass == m_MaximalMoveIndex) ? m_SecondMaximalMove : m_MaximalMove;
+
+        double testBound = std::max(m_CentroidHalfSeparations[currentClass],m_LowerBounds[i]);
+        if (m_UpperBounds[i] <= testBound)
+            continue;
+
+        // Tighten upper bound before scanning all centroids
+        m_UpperBounds[i] = std::sqrt(this->computeInputDistance(i,currentClass));
+        if (m_UpperBounds[i] <= testBound)
+            continue;
 
-        for (unsigned int j = 1;j < m_NbClass;++j)
+        unsigned int bestClass = currentClass;
+        double bestDistance = m_UpperBounds[i] * m_UpperBounds[i];
+        double secondBestDistance = std::numeric_limits <double>::max();
+        for (unsigned int j = 0;j < m_NbClass;++j)
         {
-            double tmpDist = this->computeDistance(m_InputData[i],m_Centroids[j]);
-            if (tmpDist < bestDistance)
+            if (j == currentClass)
+                continue;
+
+            double tmpDist = this->computeInputDistance(i,j);
+            if ((tmpDist < bestDistance) || ((tmpDist == bestDistance) && (j < bestClass)))
             {
+                secondBestDistance = bestDistance;
                 bestDistance = tmpDist;
                 bestClass = j;
             }
+            else if (tmpDist < secondBestDistance)
+                secondBestDistance = tmpDist;
         }
 
         m_ClassesMembership[i] = bestClass;
-        ++m_NumberPerClass[bestClass];
+        m_UpperBounds[i] = std::sqrt(bestDistance);
+        m_LowerBounds[i] = std::sqrt(secondBestDistance);
+    }
+}
+
+template <class DataType, unsigned int PointDimension>
+void
+KMeansFilter <DataType,PointDimension>::
+ComputeNearestCentroids(unsigned int startIndex, unsigned int endIndex)
+{
+    // Blocks of inputs are processed centroid by centroid to keep inner loops contiguous
+    const unsigned int blockSize = 256;
+    std::vector <double> blockDistances(blockSize * m_NbClass);
+
+    for (unsigned int blockStart = startIndex;blockStart < endIndex;blockStart += blockSize)
+    {
+        unsigned int currentBlockSize = std::min(blockSize,endIndex - blockStart);
+        std::fill(blockDistances.begin(),blockDistances.end(),0.0);
+
+        for (unsigned int j = 0;j < m_NbClass;++j)
+        {
+            double *classDistances = blockDistances.data() + j * blockSize;
+            for (unsigned int k = 0;k < PointDimension;++k)
+            {
+                double centroidCoordinate = m_CentroidsBuffer[j * PointDimension + k];
+                const double *inputCoordinates = m_InputBuffer.data() + k * m_NbInputs + blockStart;
+                for (unsigned int i = 0;i < currentBlockSize;++i)
+                {
+                    double diff = inputCoordinates[i] - centroidCoordinate;
+                    classDistances[i] += diff * diff;
+                }
+            }
+        }
+
+        for (unsigned int i = 0;i < currentBlockSize;++i)
+        {
+            unsigned int bestClass = 0;
+            double bestDistance = blockDistances[i];
+            double secondBestDistance = std::numeric_limits <double>::max();
+
+            for (unsigned int j = 1;j < m_NbClass;++j)
+            {
+                double tmpDist = blockDistances[j * blockSize + i];
+                if (tmpDist < bestDistance)
+                {
+                    secondBestDistance = bestDistance;
+                    bestDistance = tmpDist;
+                    bestClass = j;
+                }
+                else if (tmpDist < secondBestDistance)
+                    secondBestDistance = tmpDist;
+            }
+
+            m_ClassesMembership[blockStart + i] = bestClass;
+            m_UpperBounds[blockStart + i] = std::sqrt(bestDistance);
+            m_LowerBounds[blockStart + i] = (m_NbClass > 1) ? std::sqrt(secondBestDistance) : std::numeric_limits <double>::max();
+        }
     }
 }
 
@@ -134,21 +430,89 @@ void
 KMeansFilter <DataType,PointDimension>::
 InitializeKMeansFromData()
 {
-    m_Centroids.clear();
+    // Memberships already given by the user: centroids will be computed from them
+    bool initialMemberships = (m_ClassesMembership.size() == m_NbInputs);
+
+    m_CentroidsBuffer.resize(m_NbClass * PointDimension);
+    if (m_UseKMeansPlusPlusInitialization && !initialMemberships)
+        this->ComputeKMeansPlusPlusCentroids();
+    else
+    {
+        for (unsigned int j = 0;j < m_NbClass;++j)
+        {
+            for (unsigned int k = 0;k < PointDimension;++k)
+                m_CentroidsBuffer[j * PointDimension + k] = m_InputBuffer[k * m_NbInputs + j];
+        }
+    }
 
-    for (unsigned int i = 0;i < m_NbClass;++i)
-        m_Centroids.push_back(m_InputData[i]);
+    m_Centroids.resize(m_NbClass);
+    for (unsigned int j = 0;j < m_NbClass;++j)
+    {
+        m_Centroids[j] = m_ZeroVector;
+        for (unsigned int k = 0;k < PointDimension;++k)
+            m_Centroids[j][k] = m_CentroidsBuffer[j * PointDimension + k];
+    }
 
     //Centroids initialized, now compute memberships
-    if (m_ClassesMembership.size() != m_NbInputs)
+    if (!initialMemberships)
     {
         m_ClassesMembership.resize(m_NbInputs);
         std::fill(m_ClassesMembership.begin(),m_ClassesMembership.end(),0);
-        
+
+        m_BoundsUpToDate = false;
         this->UpdateMemberships();
     }
 }
 
+template <class DataType, unsigned int PointDimension>
+void
+KMeansFilter <DataType,PointDimension>::
+ComputeKMeansPlusPlusCentroids()
+{
+    std::mt19937 generator(m_Seed);
+    std::uniform_int_distribution <unsigned int> uniInt(0,m_NbInputs - 1);
+    std::uniform_real_distribution <double> uniDbl(0.0,1.0);
+
+    unsigned int chosenIndex = uniInt(generator);
+    std::vector <double> minDistances(m_NbInputs,std::numeric_limits <double>::max());
+
+    for (unsigned int j = 0;j < m_NbClass;++j)
+    {
+        for (unsigned int k = 0;k < PointDimension;++k)
+            m_CentroidsBuffer[j * PointDimension + k] = m_InputBuffer[k * m_NbInputs + chosenIndex];
+
+        if (j + 1 == m_NbClass)
+            break;
+
+        double sumDistances = 0;
+        for (unsigned int i = 0;i < m_NbInputs;++i)
+        {
+            minDistances[i] = std::min(minDistances[i],this->computeInputDistance(i,j));
+            sumDistances += minDistances[i];
+        }
+
+        // Next centroid drawn with a probability proportional to the squared distance to the closest centroid
+        if (sumDistances <= 0)
+        {
+            chosenIndex = (j + 1) % m_NbInputs;
+            continue;
+        }
+
+        double randomValue = uniDbl(generator) * sumDistances;
+        double cumulatedSum = 0;
+        chosenIndex = m_NbInputs - 1;
+        for (unsigned int i = 0;i < m_NbInputs;++i)
+        {
+            cumulatedSum += minDistances[i];
+            if ((cumulatedSum > randomValue) && (minDistances[i] > 0))
+            {
+                chosenIndex = i;
+                break;
+            }
+        }
+    }
+}
+
 template <class DataType, unsigned int PointDimension>
 void
 KMeansFilter <DataType,PointDimension>::
@@ -159,17 +523,22 @@ InitializeClassesMemberships(MembershipType &classM)
 
     for (unsigned int i = 0;i < m_NbInputs;++i)
         m_NumberPerClass[m_ClassesMembership[i]]++;
+
+    m_BoundsUpToDate = false;
 }
 
 template <class DataType, unsigned int PointDimension>
 double
 KMeansFilter <DataType,PointDimension>::
-computeDistance(VectorType &vec1, VectorType &vec2)
+computeInputDistance(unsigned int inputIndex, unsigned int classIndex)
 {
     double resVal = 0;
 
-    for (unsigned int i = 0;i < PointDimension;++i)
-        resVal += (vec1[i] - vec2[i])*(vec1[i] - vec2[i]);
+    for (unsigned int k = 0;k < PointDimension;++k)
+    {
+        double diff = m_InputBuffer[k * m_NbInputs + inputIndex] - m_CentroidsBuffer[classIndex * PointDimension + k];
+        resVal += diff * diff;
+    }
 
     return resVal;
 }
@@ -1,5 +1,6 @@
 #include <animaNonLocalMeansImageFilter.h>
 #include <animaReadWriteFunctions.h>
+#include <animaImageWriteArguments.h>
 #include <tclap/CmdLine.h>
 
 #include <itkImage.h>
@@ -105,6 +106,8 @@ int main(int ac, const char** av)
                                                 "Patch search neighborhood size",
                                                 cmd);
 
+    anima::ImageWriteArguments imageWriteArgs(cmd);
+
     try
     {
         cmd.parse(ac,av);
@@ -115,6 +118,8 @@ int main(int ac, const char** av)
         return EXIT_FAILURE;
     }
 
+    imageWriteArgs.Setup();
+
     // Find out the type of the image in file
     itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(inputArg.getValue().c_str(),
                                                                            itk::IOFileModeEnum::ReadMode);
@@ -9,15 +9,20 @@
 namespace anima
 {
 
-template <class TScalarType, unsigned int NDimensions = 3>
+/**
+ * Image type is either a vector image or an image of fixed length vectors of TScalarType values
+ * (e.g. itk::Image < itk::Vector <TScalarType,6>, 3 > for 3D tensors).
+ */
+template <class TScalarType, unsigned int NDimensions = 3,
+          class TImageType = itk::VectorImage <TScalarType, NDimensions> >
 class ExpTensorImageFilter :
-public itk::ImageToImageFilter< itk::VectorImage <TScalarType, NDimensions> , itk::VectorImage <TScalarType, NDimensions> >
+public itk::ImageToImageFilter< TImageType, TImageType >
 {
 public:
     /** Standard class typedefs. */
     typedef ExpTensorImageFilter Self;
-    typedef itk::VectorImage <TScalarType, NDimensions> TInputImage;
-    typedef itk::VectorImage <TScalarType, NDimensions> TOutputImage;
+    typedef TImageType TInputImage;
+    typedef TImageType TOutputImage;
 
     typedef itk::ImageToImageFilter< TInputImage, TOutputImage > Superclass;
     typedef itk::SmartPointer<Self> Pointer;
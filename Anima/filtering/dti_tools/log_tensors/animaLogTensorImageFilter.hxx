@@ -3,12 +3,15 @@
 
 #include <itkImageRegionIterator.h>
 #include <itkImageRegionConstIterator.h>
+#include <itkImageScanlineConstIterator.h>
+
+#include <animaSymmetricEigen3D.h>
 
 namespace anima
 {
-template <class TScalarType, unsigned int NDimensions>
+template <class TScalarType, unsigned int NDimensions, class TImageType>
 void
-LogTensorImageFilter<TScalarType,NDimensions>::
+LogTensorImageFilter<TScalarType,NDimensions,TImageType>::
 GenerateOutputInformation()
 {
     // Override the method in itkImageSource, so we can set the vector length of
@@ -18,12 +21,12 @@ GenerateOutputInformation()
 
     m_VectorSize = this->GetInput(0)->GetNumberOfComponentsPerPixel();
     TOutputImage *output = this->GetOutput();
-    output->SetVectorLength(m_VectorSize);
+    output->SetNumberOfComponentsPerPixel(m_VectorSize);
 }
 
-template <class TScalarType, unsigned int NDimensions>
+template <class TScalarType, unsigned int NDimensions, class TImageType>
 void
-LogTensorImageFilter<TScalarType,NDimensions>::
+LogTensorImageFilter<TScalarType,NDimensions,TImageType>::
 BeforeThreadedGenerateData ()
 {
     unsigned int nbInputs = this->GetNumberOfIndexedInputs();
@@ -37,11 +40,34 @@ BeforeThreadedGenerateData ()
     this->AllocateOutputs();
 }
 
-template <class TScalarType, unsigned int NDimensions>
+template <class TScalarType, unsigned int NDimensions, class TImageType>
 void
-LogTensorImageFilter<TScalarType,NDimensions>::
+LogTensorImageFilter<TScalarType,NDimensions,TImageType>::
 DynamicThreadedGenerateData (const OutputImageRegionType &outputRegionForThread)
 {
+    if (m_TensorDimension == 3)
+    {
+        // Closed form 3D path, run on whole image lines
+        const TInputImage *input = this->GetInput();
+        TOutputImage *output = this->GetOutput();
+
+        itk::ImageScanlineConstIterator <TInputImage> lineIterator(input, outputRegionForThread);
+        unsigned int lineLength = outputRegionForThread.GetSize()[0];
+
+        while (!lineIterator.IsAtEnd())
+        {
+            const TScalarType *inputLine = reinterpret_cast <const TScalarType *> (input->GetBufferPointer()) +
+                    input->ComputeOffset(lineIterator.GetIndex()) * m_VectorSize;
+            TScalarType *outputLine = reinterpret_cast <TScalarType *> (output->GetBufferPointer()) +
+                    output->ComputeOffset(lineIterator.GetIndex()) * m_VectorSize;
+
+            anima::GetTensorLogarithm3D(inputLine,outputLine,lineLength,m_ScaleNonDiagonal,true);
+            lineIterator.NextLine();
+        }
+
+        return;
+    }
+
     typedef itk::ImageRegionConstIterator< TInputImage > InIteratorType;
     typedef itk::ImageRegionIterator< TOutputImage > OutRegionIteratorType;
 
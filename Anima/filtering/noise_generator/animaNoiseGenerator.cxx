@@ -8,8 +8,8 @@ struct arguments
 {
     std::string input, output;
     double sigma;
-    unsigned int nreplicates, nthreads;
-    bool gaussianNoise;
+    unsigned int nreplicates, nthreads, seed;
+    bool gaussianNoise, seedSet;
 };
 
 template <class ComponentType, unsigned int InputDim>
@@ -26,6 +26,8 @@ addNoise(itk::ImageIOBase::Pointer imageIO, const arguments &args)
     mainFilter->SetNoiseSigma(args.sigma);
     mainFilter->SetUseGaussianDistribution(args.gaussianNoise);
     mainFilter->SetNumberOfReplicates(args.nreplicates);
+    if (args.seedSet)
+        mainFilter->SetSeed(args.seed);
     mainFilter->Update();
     
     if (args.nreplicates == 1)
@@ -71,6 +73,8 @@ int main(int argc, char **argv)
     TCLAP::ValueArg<double> snrArg("s","snr","Average SNR in dB over the reference image (default: 25dB).",false,25.0,"mean snr",cmd);
     TCLAP::ValueArg<unsigned int> repArg("n","num-replicates","Number of independent noisy datasets to generate (default: 1).",false,1,"number of replicates",cmd);
     
+    TCLAP::ValueArg<unsigned int> seedArg("S","seed","Random generator seed, outputs are identical for a given seed whatever the number of threads (default: based on current time).",false,0,"seed",cmd);
+    
     TCLAP::SwitchArg gaussArg("G","gauss-noise","Adds Gaussian noise instead of Rician noise.",cmd,false);
     TCLAP::SwitchArg matchArg("M","match-snr","Make Gaussian noise comparable to Rician noise in terms of SNR.",cmd,false);
     TCLAP::SwitchArg verboseArg("V","verbose","Outputs noise calculations to the console.",cmd,false);
@@ -181,6 +185,8 @@ int main(int argc, char **argv)
     args.nreplicates = repArg.getValue();
     args.nthreads = nbpArg.getValue();
     args.gaussianNoise = gaussArg.isSet();
+    args.seed = seedArg.getValue();
+    args.seedSet = seedArg.isSet();
     
     try
     {
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <iostream>
-#include <random>
 #include <animaNumberedThreadImageToImageFilter.h>
 #include <itkImage.h>
 
@@ -50,12 +49,17 @@ public:
     itkSetMacro(UseGaussianDistribution, bool)
     itkGetConstMacro(UseGaussianDistribution, bool)
 
+    //! Seed of the counter-based generator, noise at each voxel being drawn from a stream keyed by its offset
+    itkSetMacro(Seed, unsigned int)
+    itkGetConstMacro(Seed, unsigned int)
+
 protected:
     NoiseGeneratorImageFilter()
     {
         m_NumberOfReplicates = 1;
         m_NoiseSigma = 1.0;
         m_UseGaussianDistribution = false;
+        m_Seed = time(ITK_NULLPTR);
     }
 
     virtual ~NoiseGeneratorImageFilter()
@@ -63,7 +67,6 @@ protected:
     }
 
     void GenerateOutputInformation() ITK_OVERRIDE;
-    void BeforeThreadedGenerateData() ITK_OVERRIDE;
     void DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread) ITK_OVERRIDE;
 
 private:
@@ -72,7 +75,7 @@ private:
     unsigned int m_NumberOfReplicates;
     double m_NoiseSigma;
     bool m_UseGaussianDistribution;
-    std::vector <std::mt19937> m_Generators;
+    unsigned int m_Seed;
 };
 
 } // end namespace anima
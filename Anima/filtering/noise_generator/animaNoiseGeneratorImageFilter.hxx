@@ -1,10 +1,10 @@
 #pragma once
 
 #include "animaNoiseGeneratorImageFilter.h"
-#include <animaDistributionSampling.h>
+#include <animaCounterBasedRandomGenerator.h>
 
-#include <itkImageRegionIterator.h>
-#include <itkImageRegionConstIterator.h>
+#include <itkImageScanlineIterator.h>
+#include <itkImageScanlineConstIterator.h>
 
 namespace anima
 {
@@ -32,26 +32,13 @@ NoiseGeneratorImageFilter<ImageType>
     Superclass::GenerateOutputInformation();
 }
 
-template <class ImageType>
-void
-NoiseGeneratorImageFilter<ImageType>
-::BeforeThreadedGenerateData ()
-{
-    Superclass::BeforeThreadedGenerateData();
-
-    m_Generators.clear();
-    std::mt19937 motherGenerator(time(ITK_NULLPTR));
-    for (int i = 0;i < this->GetNumberOfWorkUnits();++i)
-        m_Generators.push_back(std::mt19937(motherGenerator()));
-}
-
 template <class ImageType>
 void
 NoiseGeneratorImageFilter<ImageType>
 ::DynamicThreadedGenerateData (const OutputImageRegionType &outputRegionForThread)
 {
-    typedef itk::ImageRegionConstIterator<InputImageType> InputImageIteratorType;
-    typedef itk::ImageRegionIterator<OutputImageType> OutputImageIteratorType;
+    typedef itk::ImageScanlineConstIterator<InputImageType> InputImageIteratorType;
+    typedef itk::ImageScanlineIterator<OutputImageType> OutputImageIteratorType;
     
     InputImageIteratorType inputIterator(this->GetInput(), outputRegionForThread);
     
@@ -59,34 +46,48 @@ NoiseGeneratorImageFilter<ImageType>
     for (unsigned int i = 0;i < m_NumberOfReplicates;++i)
         outIterators[i] = OutputImageIteratorType(this->GetOutput(i), outputRegionForThread);
     
-    unsigned int threadId = this->GetSafeThreadId();
+    // Each voxel has its own stream, keyed by its offset: output does not depend on the region split
+    anima::CounterBasedRandomGenerator generator;
+    unsigned int lineLength = outputRegionForThread.GetSize()[0];
+    std::vector <double> noisyValues(lineLength * m_NumberOfReplicates);
     
     while (!inputIterator.IsAtEnd())
     {
-        double refData = inputIterator.Get();
+        itk::OffsetValueType lineOffset = this->GetInput()->ComputeOffset(inputIterator.GetIndex());
         
-        for (unsigned int i = 0;i < m_NumberOfReplicates;++i)
+        for (unsigned int j = 0;j < lineLength;++j)
         {
-            double realNoise = SampleFromGaussianDistribution(0.0, m_NoiseSigma, m_Generators[threadId]);
-            double data = refData + realNoise;
+            double refData = inputIterator.Get();
+            double *voxelValues = noisyValues.data() + j * m_NumberOfReplicates;
             
-            if (!m_UseGaussianDistribution)
+            generator.SetKey(m_Seed, lineOffset + j);
+            if (m_UseGaussianDistribution)
+                generator.FillGaussian(voxelValues, m_NumberOfReplicates, refData, m_NoiseSigma);
+            else
+                generator.FillRician(refData, m_NoiseSigma, voxelValues, m_NumberOfReplicates);
+            
+            for (unsigned int i = 0;i < m_NumberOfReplicates;++i)
             {
-                double imagNoise = SampleFromGaussianDistribution(0.0, m_NoiseSigma, m_Generators[threadId]);
-                data = std::sqrt(data * data + imagNoise * imagNoise);
+                if ((std::isnan(voxelValues[i])) || (!std::isfinite(voxelValues[i])))
+                    voxelValues[i] = refData;
             }
             
-            if ((std::isnan(data)) || (!std::isfinite(data)))
-                data = refData;
+            ++inputIterator;
+        }
+        
+        for (unsigned int i = 0;i < m_NumberOfReplicates;++i)
+        {
+            for (unsigned int j = 0;j < lineLength;++j)
+            {
+                outIterators[i].Set(noisyValues[j * m_NumberOfReplicates + i]);
+                ++outIterators[i];
+            }
             
-            outIterators[i].Set(data);
-            ++outIterators[i];
+            outIterators[i].NextLine();
         }
         
-        ++inputIterator;
+        inputIterator.NextLine();
     }
-
-    this->SafeReleaseThreadId(threadId);
 }
 
 } //end of namespace anima
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <itkMultiThreaderBase.h>
 
 namespace anima
 {
@@ -9,7 +10,8 @@ namespace anima
  * Provides an implementation of fuzzy c-means, as proposed in
  * J. C. Bezdek (1981): "Pattern Recognition with Fuzzy Objective Function Algoritms", Plenum Press, New York.
  * It contains flags for interfacing it with spectral clustering, and to compute spherical distances rather than
- * Euclidean distances.
+ * Euclidean distances. Inputs are also stored coordinate-wise in a contiguous buffer for distance computations,
+ * and both steps are split between threads for large inputs.
  */
 template <class ScalarType>
 class FuzzyCMeansFilter
@@ -17,6 +19,7 @@ class FuzzyCMeansFilter
 public:
     typedef std::vector <ScalarType> VectorType;
     typedef std::vector <VectorType> DataHolderType;
+    typedef FuzzyCMeansFilter <ScalarType> Self;
 
     enum CentroidAverageType
     {
@@ -36,6 +39,7 @@ public:
     void SetRelStopCriterion(double rC) {m_RelStopCriterion = rC;}
     void SetMValue(double mV) {m_MValue = mV;}
     void SetSphericalAverageType(CentroidAverageType spher) {m_SphericalAverageType = spher;}
+    void SetNumberOfThreads(unsigned int val) {m_NumberOfThreads = val;}
 
     void ComputeCentroids();
     void UpdateMemberships();
@@ -52,14 +56,35 @@ public:
     VectorType &GetCentroid(unsigned int i) {return m_Centroids[i];}
     VectorType &GetClassesMembership(unsigned int i) {return m_ClassesMembership[i];}
 
+    //! Threads are only used for inputs larger than this number times the number of threads
+    static unsigned int GetMinimalNumberOfInputsPerThread() {return 2048;}
+
+protected:
+    unsigned int GetActualNumberOfThreads();
+
+    struct ThreadedCMeansData
+    {
+        Self *cmeansFilter;
+        std::vector < std::vector <double> > partialSums;
+    };
+
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedCentroidsComputation(void *arg);
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedMembershipsUpdate(void *arg);
+
+    //! Weighted sums of inputs (m_NbClass x m_NDim) followed by sums of weights (m_NbClass)
+    void InternalCentroidsComputation(unsigned int threadId, unsigned int numThreads, std::vector <double> &sums);
+    void InternalMembershipsUpdate(unsigned int threadId, unsigned int numThreads);
+
 private:
-    long double computeDistance(VectorType &vec1, VectorType &vec2);
 
     DataHolderType m_ClassesMembership;
     DataHolderType m_Centroids;
     DataHolderType m_InputData;
     VectorType m_DataWeights;
 
+    //! Input coordinate k of input i is at k * m_NbInputs + i
+    std::vector <double> m_InputBuffer;
+
     unsigned int m_NbClass, m_NbInputs;
     unsigned int m_NDim;
     unsigned int m_MaxIterations;
@@ -71,9 +96,9 @@ private:
 
     double m_RelStopCriterion;
     double m_MValue;
+    unsigned int m_NumberOfThreads;
 
     // Internal work values
-    std::vector <long double> m_DistancesPointsCentroids;
     DataHolderType m_PowMemberships;
     VectorType m_TmpVector;
     VectorType m_TmpWeights;
@@ -2,9 +2,12 @@
 #include "animaFuzzyCMeansFilter.h"
 
 #include <iostream>
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
+#include <itkPoolMultiThreader.h>
+
 #include <animaLogExpMapsUnitSphere.h>
 
 namespace anima
@@ -29,6 +32,7 @@ FuzzyCMeansFilter <ScalarType>
 
     m_RelStopCriterion = 1.0e-4;
     m_MValue = 2;
+    m_NumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
 }
 
 template <class ScalarType>
@@ -42,6 +46,13 @@ FuzzyCMeansFilter <ScalarType>
     m_InputData = data;
     m_NbInputs = m_InputData.size();
     m_NDim = m_InputData[0].size();
+
+    m_InputBuffer.resize(m_NDim * m_NbInputs);
+    for (unsigned int i = 0;i < m_NbInputs;++i)
+    {
+        for (unsigned int k = 0;k < m_NDim;++k)
+            m_InputBuffer[k * m_NbInputs + i] = m_InputData[i][k];
+    }
 }
 
 template <class ScalarType>
@@ -76,6 +87,15 @@ FuzzyCMeansFilter <ScalarType>
     }
 }
 
+template <class ScalarType>
+unsigned int
+FuzzyCMeansFilter <ScalarType>
+::GetActualNumberOfThreads()
+{
+    unsigned int maximalNumberOfThreads = std::max(1u, m_NbInputs / GetMinimalNumberOfInputsPerThread());
+    return std::max(1u, std::min(m_NumberOfThreads, maximalNumberOfThreads));
+}
+
 template <class ScalarType>
 void
 FuzzyCMeansFilter <ScalarType>
@@ -88,9 +108,6 @@ FuzzyCMeansFilter <ScalarType>
     {
         if (m_PowMemberships[i].size() != m_NbClass)
             m_PowMemberships[i].resize(m_NbClass);
-
-        for (unsigned int j = 0;j < m_NbClass;++j)
-            m_PowMemberships[i][j] = std::pow(m_ClassesMembership[i][j],m_MValue);
     }
 
     if (m_TmpVector.size() != m_NDim)
@@ -99,20 +116,36 @@ FuzzyCMeansFilter <ScalarType>
     if (m_TmpWeights.size() != m_NbInputs)
         m_TmpWeights.resize(m_NbInputs);
 
-    for (unsigned int i = 0;i < m_NbClass;++i)
+    unsigned int actualNumberOfThreads = this->GetActualNumberOfThreads();
+
+    ThreadedCMeansData *tmpStr = new ThreadedCMeansData;
+    tmpStr->cmeansFilter = this;
+    tmpStr->partialSums.resize(actualNumberOfThreads);
+
+    if (actualNumberOfThreads > 1)
     {
-        double sumPowMemberShips = 0;
-        std::fill(m_TmpVector.begin(),m_TmpVector.end(),0.0);
+        itk::PoolMultiThreader::Pointer threaderCentroids = itk::PoolMultiThreader::New();
+        threaderCentroids->SetNumberOfWorkUnits(actualNumberOfThreads);
+        threaderCentroids->SetSingleMethod(this->ThreadedCentroidsComputation,tmpStr);
+        threaderCentroids->SingleMethodExecute();
+    }
+    else
+        this->InternalCentroidsComputation(0,1,tmpStr->partialSums[0]);
 
-        for (unsigned int j = 0;j < m_NbInputs;++j)
-        {
-            sumPowMemberShips += m_DataWeights[j] * m_PowMemberships[j][i];
-            for (unsigned int k = 0;k < m_NDim;++k)
-                m_TmpVector[k] += m_DataWeights[j] * m_PowMemberships[j][i] * m_InputData[j][k];
-        }
+    std::vector <double> sums(m_NbClass * (m_NDim + 1),0.0);
+    for (unsigned int i = 0;i < actualNumberOfThreads;++i)
+    {
+        for (unsigned int j = 0;j < sums.size();++j)
+            sums[j] += tmpStr->partialSums[i][j];
+    }
 
+    delete tmpStr;
+
+    for (unsigned int i = 0;i < m_NbClass;++i)
+    {
+        double sumPowMemberShips = sums[m_NbClass * m_NDim + i];
         for (unsigned int k = 0;k < m_NDim;++k)
-            m_TmpVector[k] /= sumPowMemberShips;
+            m_TmpVector[k] = sums[i * m_NDim + k] / sumPowMemberShips;
 
         switch (m_SphericalAverageType)
         {
@@ -156,55 +189,175 @@ FuzzyCMeansFilter <ScalarType>
     }
 }
 
+template <class ScalarType>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+FuzzyCMeansFilter <ScalarType>
+::ThreadedCentroidsComputation(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+
+    unsigned int nbThread = threadArgs->WorkUnitID;
+    unsigned int nbProcs = threadArgs->NumberOfWorkUnits;
+
+    ThreadedCMeansData *tmpStr = (ThreadedCMeansData *)threadArgs->UserData;
+
+    tmpStr->cmeansFilter->InternalCentroidsComputation(nbThread,nbProcs,tmpStr->partialSums[nbThread]);
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <class ScalarType>
+void
+FuzzyCMeansFilter <ScalarType>
+::InternalCentroidsComputation(unsigned int threadId, unsigned int numThreads, std::vector <double> &sums)
+{
+    unsigned int step = m_NbInputs / numThreads;
+    unsigned int startIndex = threadId * step;
+    unsigned int endIndex = (threadId + 1 == numThreads) ? m_NbInputs : (threadId + 1) * step;
+
+    sums.resize(m_NbClass * (m_NDim + 1));
+    std::fill(sums.begin(),sums.end(),0.0);
+    double *weightSums = sums.data() + m_NbClass * m_NDim;
+
+    for (unsigned int i = startIndex;i < endIndex;++i)
+    {
+        for (unsigned int j = 0;j < m_NbClass;++j)
+        {
+            double membership = m_ClassesMembership[i][j];
+            double powMembership = (m_MValue == 2.0) ? membership * membership : std::pow(membership,m_MValue);
+            m_PowMemberships[i][j] = powMembership;
+
+            double weight = m_DataWeights[i] * powMembership;
+            weightSums[j] += weight;
+            for (unsigned int k = 0;k < m_NDim;++k)
+                sums[j * m_NDim + k] += weight * m_InputBuffer[k * m_NbInputs + i];
+        }
+    }
+}
+
 template <class ScalarType>
 void
 FuzzyCMeansFilter <ScalarType>
 ::UpdateMemberships()
 {
+    unsigned int actualNumberOfThreads = this->GetActualNumberOfThreads();
+    if (actualNumberOfThreads > 1)
+    {
+        itk::PoolMultiThreader::Pointer threaderMemberships = itk::PoolMultiThreader::New();
+
+        ThreadedCMeansData *tmpStr = new ThreadedCMeansData;
+        tmpStr->cmeansFilter = this;
+
+        threaderMemberships->SetNumberOfWorkUnits(actualNumberOfThreads);
+        threaderMemberships->SetSingleMethod(this->ThreadedMembershipsUpdate,tmpStr);
+        threaderMemberships->SingleMethodExecute();
+
+        delete tmpStr;
+    }
+    else
+        this->InternalMembershipsUpdate(0,1);
+}
+
+template <class ScalarType>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+FuzzyCMeansFilter <ScalarType>
+::ThreadedMembershipsUpdate(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+
+    unsigned int nbThread = threadArgs->WorkUnitID;
+    unsigned int nbProcs = threadArgs->NumberOfWorkUnits;
+
+    ThreadedCMeansData *tmpStr = (ThreadedCMeansData *)threadArgs->UserData;
+
+    tmpStr->cmeansFilter->InternalMembershipsUpdate(nbThread,nbProcs);
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <class ScalarType>
+void
+FuzzyCMeansFilter <ScalarType>
+::InternalMembershipsUpdate(unsigned int threadId, unsigned int numThreads)
+{
+    unsigned int step = m_NbInputs / numThreads;
+    unsigned int startIndex = threadId * step;
+    unsigned int endIndex = (threadId + 1 == numThreads) ? m_NbInputs : (threadId + 1) * step;
+
     long double powFactor = 1.0/(m_MValue - 1.0);
-    m_DistancesPointsCentroids.resize(m_NbClass);
 
-    for (unsigned int i = 0;i < m_NbInputs;++i)
+    // Blocks of inputs are processed centroid by centroid to keep inner loops contiguous
+    const unsigned int blockSize = 256;
+    std::vector <double> blockValues(blockSize * m_NbClass);
+    std::vector <long double> distancesPointsCentroids(m_NbClass);
+
+    for (unsigned int blockStart = startIndex;blockStart < endIndex;blockStart += blockSize)
     {
-        unsigned int minClassIndex = 0;
-        bool nullDistance = false;
+        unsigned int currentBlockSize = std::min(blockSize,endIndex - blockStart);
+        std::fill(blockValues.begin(),blockValues.end(),0.0);
+
         for (unsigned int j = 0;j < m_NbClass;++j)
         {
-            m_DistancesPointsCentroids[j] = computeDistance(m_InputData[i],m_Centroids[j]);
-
-            if (m_DistancesPointsCentroids[j] <= 0)
+            double *classValues = blockValues.data() + j * blockSize;
+            for (unsigned int k = 0;k < m_NDim;++k)
             {
-                nullDistance = true;
-                minClassIndex = j;
-                break;
+                double centroidCoordinate = m_Centroids[j][k];
+                const double *inputCoordinates = m_InputBuffer.data() + k * m_NbInputs + blockStart;
+
+                if (m_SphericalAverageType != Euclidean)
+                {
+                    for (unsigned int i = 0;i < currentBlockSize;++i)
+                        classValues[i] += inputCoordinates[i] * centroidCoordinate;
+                }
+                else
+                {
+                    for (unsigned int i = 0;i < currentBlockSize;++i)
+                        classValues[i] += (inputCoordinates[i] - centroidCoordinate) * (inputCoordinates[i] - centroidCoordinate);
+                }
             }
         }
 
-        if (nullDistance)
+        for (unsigned int i = 0;i < currentBlockSize;++i)
         {
+            unsigned int inputIndex = blockStart + i;
+            unsigned int minClassIndex = 0;
+            bool nullDistance = false;
             for (unsigned int j = 0;j < m_NbClass;++j)
-                m_ClassesMembership[i][j] = 0;
-
-            m_ClassesMembership[i][minClassIndex] = 1.0;
-            continue;
-        }
+            {
+                long double distanceValue = blockValues[j * blockSize + i];
+                if (m_SphericalAverageType != Euclidean)
+                    distanceValue = std::abs(std::acos(std::max(-1.0L,std::min(1.0L,distanceValue))));
 
-        for (unsigned int j = 0;j < m_NbClass;++j)
-        {
-            long double tmpVal = 0;
+                distancesPointsCentroids[j] = distanceValue;
+                if (distanceValue <= 0)
+                {
+                    nullDistance = true;
+                    minClassIndex = j;
+                    break;
+                }
+            }
 
-            if (m_MValue == 2.0)
+            if (nullDistance)
             {
-                for (unsigned int k = 0;k < m_NbClass;++k)
-                    tmpVal += m_DistancesPointsCentroids[j] / m_DistancesPointsCentroids[k];
+                for (unsigned int j = 0;j < m_NbClass;++j)
+                    m_ClassesMembership[inputIndex][j] = 0;
+
+                m_ClassesMembership[inputIndex][minClassIndex] = 1.0;
+                continue;
             }
-            else
+
+            // sum_k (d_j / d_k)^p = d_j^p sum_k d_k^-p, one power per class instead of per pair of classes
+            long double inverseSum = 0;
+            for (unsigned int k = 0;k < m_NbClass;++k)
             {
-                for (unsigned int k = 0;k < m_NbClass;++k)
-                    tmpVal += std::pow(m_DistancesPointsCentroids[j] / m_DistancesPointsCentroids[k],powFactor);
+                if (m_MValue != 2.0)
+                    distancesPointsCentroids[k] = std::pow(distancesPointsCentroids[k],powFactor);
+
+                inverseSum += 1.0 / distancesPointsCentroids[k];
             }
 
-            m_ClassesMembership[i][j] = 1.0 / tmpVal;
+            for (unsigned int j = 0;j < m_NbClass;++j)
+                m_ClassesMembership[inputIndex][j] = 1.0 / (distancesPointsCentroids[j] * inverseSum);
         }
     }
 }
@@ -327,32 +480,4 @@ FuzzyCMeansFilter <ScalarType>
     }
 }
 
-template <class ScalarType>
-long double
-FuzzyCMeansFilter <ScalarType>
-::computeDistance(VectorType &vec1, VectorType &vec2)
-{
-    long double resVal = 0;
-
-    if (m_SphericalAverageType != Euclidean)
-    {
-        long double dotProd = 0;
-        for (unsigned int i = 0;i < m_NDim;++i)
-            dotProd += vec1[i]*vec2[i];
-
-        if (dotProd > 1)
-            dotProd = 1;
-
-        resVal = std::abs(std::acos(dotProd));
-    }
-    else
-    {
-        resVal = 0;
-        for (unsigned int i = 0;i < m_NDim;++i)
-            resVal += (vec1[i] - vec2[i])*(vec1[i] - vec2[i]);
-    }
-
-    return resVal;
-}
-
 } // end namespace anima
@@ -5,6 +5,7 @@
 #include <vnl/vnl_diag_matrix.h>
 
 #include <itkSymmetricEigenAnalysis.h>
+#include <itkMultiThreaderBase.h>
 
 #include <animaFuzzyCMeansFilter.h>
 
@@ -15,6 +16,9 @@ namespace anima
  * \brief Provides an implementation of spectral clustering, as proposed in
  * A.Y. Ng, M.I. Jordan and Y. Weiss. "On Spectral Clustering: Analysis and an Algorithm."
  * Advances in Neural Information Processing Systems 14. 2001
+ *
+ * For large inputs, the affinity matrix is replaced by a sparse symmetrized k-nearest neighbours graph
+ * and the leading eigenvectors are extracted by Lanczos iterations on each of its connected components
  */
 template <class ScalarType>
 class SpectralClusteringFilter
@@ -26,11 +30,20 @@ public:
     typedef anima::FuzzyCMeansFilter <ScalarType> CMeansFilterType;
     typedef typename CMeansFilterType::CentroidAverageType CMeansAverageType;
     typedef itk::SymmetricEigenAnalysis <MatrixType, vnl_diag_matrix<ScalarType>, MatrixType> EigenAnalysisType;
+    typedef SpectralClusteringFilter <ScalarType> Self;
+
+    //! Affinity and eigen decomposition mode: automatic switches to sparse for inputs larger than the sparse minimal size
+    enum ComputationModeType
+    {
+        Automatic = 0,
+        Dense,
+        Sparse
+    };
 
     SpectralClusteringFilter();
     virtual ~SpectralClusteringFilter() {}
 
-    //! Input data: matrix of squared distances
+    //! Input data: matrix of squared distances, only its upper triangle is used
     void SetInputData(MatrixType &data);
     void SetDataWeights(VectorType &val) {m_DataWeights = val;}
     void SetNbClass(unsigned int nbC) {m_NbClass = nbC;}
@@ -43,6 +56,17 @@ public:
 
     void SetCMeansAverageType(CMeansAverageType val) {m_CMeansAverageType = val;}
 
+    // Parameters for the sparse mode
+    void SetComputationMode(ComputationModeType val) {m_ComputationMode = val;}
+    void SetSparseMinimalInputSize(unsigned int val) {m_SparseMinimalInputSize = val;}
+    //! Number of nearest neighbours kept per input in the sparse affinity graph
+    void SetNumberOfNeighbors(unsigned int val) {m_NumberOfNeighbors = val;}
+    void SetLanczosMaximalDimension(unsigned int val) {m_LanczosMaximalDimension = val;}
+    void SetLanczosTolerance(double val) {m_LanczosTolerance = val;}
+    void SetNumberOfThreads(unsigned int val) {m_NumberOfThreads = val;}
+
+    bool UseSparseComputation();
+
     void ComputeSpectralVectors();
     void Update();
 
@@ -56,6 +80,34 @@ public:
     VectorType &GetCentroid(unsigned int i) {return m_Centroids[i];}
     std::vector <unsigned int> GetClassMembers(unsigned int i);
 
+protected:
+    void ComputeDenseSpectralVectors();
+    void ComputeSparseSpectralVectors();
+
+    //! Builds m_SparseIndexes and m_SparseValues (normalized affinities) from the k nearest neighbours of each input
+    void ComputeSparseAffinityGraph();
+
+    /**
+     * Leading eigenpairs of the normalized sparse affinity restricted to a connected component,
+     * eigen vectors are expressed on the component indexes
+     */
+    void ComputeComponentEigenVectors(std::vector <unsigned int> &componentIndexes, unsigned int numVectors,
+                                      std::vector <double> &eigenValues, std::vector <VectorType> &eigenVectors);
+
+    //! Product of the normalized sparse affinity restricted to a connected component by a vector
+    void MultiplyComponentVector(std::vector <unsigned int> &componentIndexes, VectorType &inputVector, VectorType &outputVector);
+
+    struct ThreadedSpectralData
+    {
+        Self *spectralFilter;
+        std::vector <double> partialSums;
+    };
+
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedSigmaComputation(void *arg);
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedNeighborsComputation(void *arg);
+    double InternalSigmaComputation(unsigned int threadId, unsigned int numThreads);
+    void InternalNeighborsComputation(unsigned int threadId, unsigned int numThreads);
+
 private:
     std::vector <VectorType> m_ClassesMembership;
     std::vector <VectorType> m_Centroids;
@@ -76,6 +128,13 @@ private:
 
     double m_SigmaWeighting;
 
+    ComputationModeType m_ComputationMode;
+    unsigned int m_SparseMinimalInputSize;
+    unsigned int m_NumberOfNeighbors;
+    unsigned int m_LanczosMaximalDimension;
+    double m_LanczosTolerance;
+    unsigned int m_NumberOfThreads;
+
     // Internal data
     MatrixType m_WMatrix;
     std::vector <double> m_DValues;
@@ -84,6 +143,11 @@ private:
     vnl_diag_matrix<ScalarType> m_EigVals;
     MatrixType m_EigVecs;
     VectorType m_WorkVec;
+
+    // Sparse affinity graph: neighbour indexes and normalized affinities per input, and position in the current component
+    std::vector < std::vector <unsigned int> > m_SparseIndexes;
+    std::vector <VectorType> m_SparseValues;
+    std::vector <unsigned int> m_ComponentPositions;
 };
 
 } // end namespace anima
@@ -1,6 +1,11 @@
 #pragma once
 #include "animaSpectralClusteringFilter.h"
 
+#include <itkPoolMultiThreader.h>
+
+#include <algorithm>
+#include <random>
+
 namespace anima
 {
 
@@ -23,6 +28,24 @@ SpectralClusteringFilter <ScalarType>
     m_MValue = 2;
 
     m_SigmaWeighting = 1;
+
+    m_ComputationMode = Automatic;
+    m_SparseMinimalInputSize = 1000;
+    m_NumberOfNeighbors = 10;
+    m_LanczosMaximalDimension = 300;
+    m_LanczosTolerance = 1.0e-8;
+    m_NumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+}
+
+template <class ScalarType>
+bool
+SpectralClusteringFilter <ScalarType>
+::UseSparseComputation()
+{
+    if (m_ComputationMode == Automatic)
+        return (m_InputData.rows() >= m_SparseMinimalInputSize);
+
+    return (m_ComputationMode == Sparse);
 }
 
 template <class ScalarType>
@@ -41,6 +64,9 @@ void
 SpectralClusteringFilter <ScalarType>
 ::Update()
 {
+    if (m_InputData.rows() == 0)
+        throw itk::ExceptionObject(__FILE__,__LINE__,"No input data to cluster...",ITK_LOCATION);
+
     if (m_NbClass > m_InputData.rows())
         throw itk::ExceptionObject(__FILE__,__LINE__,"More classes than inputs...",ITK_LOCATION);
 
@@ -59,6 +85,7 @@ SpectralClusteringFilter <ScalarType>
     m_MainFilter.SetVerbose(m_Verbose);
     m_MainFilter.SetFlagSpectralClustering(true);
     m_MainFilter.SetSphericalAverageType(m_CMeansAverageType);
+    m_MainFilter.SetNumberOfThreads(m_NumberOfThreads);
 
     m_MainFilter.Update();
 
@@ -82,9 +109,28 @@ SpectralClusteringFilter <ScalarType>
     unsigned int inputSize = m_InputData.rows();
     unsigned int numPts = inputSize*(inputSize + 1)/2 - inputSize - 1;
 
-    for (unsigned int i = 0;i < inputSize;++i)
-        for (unsigned int j = i+1;j < inputSize;++j)
-            sigmaTmp += m_InputData(i,j);
+    // Small inputs (e.g. per voxel compartments) are often clustered from already threaded filters
+    if (this->UseSparseComputation() && (m_NumberOfThreads > 1))
+    {
+        itk::PoolMultiThreader::Pointer threaderSigma = itk::PoolMultiThreader::New();
+
+        ThreadedSpectralData *tmpStr = new ThreadedSpectralData;
+        tmpStr->spectralFilter = this;
+
+        unsigned int actualNumberOfThreads = std::min(m_NumberOfThreads,inputSize);
+        tmpStr->partialSums.resize(actualNumberOfThreads);
+
+        threaderSigma->SetNumberOfWorkUnits(actualNumberOfThreads);
+        threaderSigma->SetSingleMethod(this->ThreadedSigmaComputation,tmpStr);
+        threaderSigma->SingleMethodExecute();
+
+        for (unsigned int i = 0;i < actualNumberOfThreads;++i)
+            sigmaTmp += tmpStr->partialSums[i];
+
+        delete tmpStr;
+    }
+    else
+        sigmaTmp = this->InternalSigmaComputation(0,1);
 
     if (sigmaTmp > 0)
         m_SigmaWeighting = std::sqrt(sigmaTmp/numPts);
@@ -92,10 +138,53 @@ SpectralClusteringFilter <ScalarType>
         m_SigmaWeighting = 1;
 }
 
+template <class ScalarType>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+SpectralClusteringFilter <ScalarType>
+::ThreadedSigmaComputation(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+
+    unsigned int nbThread = threadArgs->WorkUnitID;
+    unsigned int nbProcs = threadArgs->NumberOfWorkUnits;
+
+    ThreadedSpectralData *tmpStr = (ThreadedSpectralData *)threadArgs->UserData;
+
+    tmpStr->partialSums[nbThread] = tmpStr->spectralFilter->InternalSigmaComputation(nbThread,nbProcs);
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <class ScalarType>
+double
+SpectralClusteringFilter <ScalarType>
+::InternalSigmaComputation(unsigned int threadId, unsigned int numThreads)
+{
+    // Rows are interleaved between threads to balance the upper triangle
+    double resVal = 0;
+    unsigned int inputSize = m_InputData.rows();
+    for (unsigned int i = threadId;i < inputSize;i += numThreads)
+        for (unsigned int j = i+1;j < inputSize;++j)
+            resVal += m_InputData(i,j);
+
+    return resVal;
+}
+
 template <class ScalarType>
 void
 SpectralClusteringFilter <ScalarType>
 ::ComputeSpectralVectors()
+{
+    if (this->UseSparseComputation())
+        this->ComputeSparseSpectralVectors();
+    else
+        this->ComputeDenseSpectralVectors();
+}
+
+template <class ScalarType>
+void
+SpectralClusteringFilter <ScalarType>
+::ComputeDenseSpectralVectors()
 {
     unsigned int inputSize = m_InputData.rows();
     m_WMatrix.set_size(inputSize,inputSize);
@@ -155,6 +244,446 @@ SpectralClusteringFilter <ScalarType>
     }
 }
 
+template <class ScalarType>
+void
+SpectralClusteringFilter <ScalarType>
+::ComputeSparseSpectralVectors()
+{
+    this->ComputeSparseAffinityGraph();
+
+    // The graph may be disconnected: its spectrum is the union of its connected components spectra
+    unsigned int inputSize = m_InputData.rows();
+    std::vector <bool> visitedInputs(inputSize,false);
+    m_ComponentPositions.resize(inputSize);
+
+    std::vector < std::vector <unsigned int> > components;
+    std::vector < std::vector <VectorType> > componentsEigenVectors;
+    std::vector < std::pair <double, std::pair <unsigned int, unsigned int> > > eigenCandidates;
+    std::vector <double> eigenValues;
+
+    for (unsigned int i = 0;i < inputSize;++i)
+    {
+        if (visitedInputs[i])
+            continue;
+
+        std::vector <unsigned int> componentIndexes(1,i);
+        visitedInputs[i] = true;
+        for (unsigned int j = 0;j < componentIndexes.size();++j)
+        {
+            unsigned int currentIndex = componentIndexes[j];
+            m_ComponentPositions[currentIndex] = j;
+            for (unsigned int k = 0;k < m_SparseIndexes[currentIndex].size();++k)
+            {
+                unsigned int neighborIndex = m_SparseIndexes[currentIndex][k];
+                if (!visitedInputs[neighborIndex])
+                {
+                    visitedInputs[neighborIndex] = true;
+                    componentIndexes.push_back(neighborIndex);
+                }
+            }
+        }
+
+        unsigned int numVectors = std::min(m_NbClass,(unsigned int)componentIndexes.size());
+        std::vector <VectorType> eigenVectors;
+        this->ComputeComponentEigenVectors(componentIndexes,numVectors,eigenValues,eigenVectors);
+
+        for (unsigned int j = 0;j < numVectors;++j)
+            eigenCandidates.push_back(std::make_pair(eigenValues[j],std::make_pair(components.size(),j)));
+
+        components.push_back(componentIndexes);
+        componentsEigenVectors.push_back(eigenVectors);
+    }
+
+    // Keep the m_NbClass largest eigenvalues over all components
+    std::stable_sort(eigenCandidates.begin(),eigenCandidates.end(),
+                     [](const std::pair <double, std::pair <unsigned int, unsigned int> > &a,
+                        const std::pair <double, std::pair <unsigned int, unsigned int> > &b)
+    {
+        return a.first > b.first;
+    });
+
+    m_SpectralVectors.resize(inputSize);
+    for (unsigned int i = 0;i < inputSize;++i)
+    {
+        m_SpectralVectors[i].resize(m_NbClass);
+        std::fill(m_SpectralVectors[i].begin(),m_SpectralVectors[i].end(),0.0);
+    }
+
+    for (unsigned int j = 0;j < m_NbClass;++j)
+    {
+        unsigned int componentNumber = eigenCandidates[j].second.first;
+        VectorType &eigenVector = componentsEigenVectors[componentNumber][eigenCandidates[j].second.second];
+        for (unsigned int k = 0;k < components[componentNumber].size();++k)
+            m_SpectralVectors[components[componentNumber][k]][j] = eigenVector[k];
+    }
+
+    for (unsigned int i = 0;i < inputSize;++i)
+    {
+        double tmpSum = 0;
+        for (unsigned int j = 0;j < m_NbClass;++j)
+            tmpSum += m_SpectralVectors[i][j] * m_SpectralVectors[i][j];
+
+        // Inputs of components with no kept eigenvector have a null spectral vector
+        if (tmpSum <= 0)
+            continue;
+
+        tmpSum = std::sqrt(tmpSum);
+        for (unsigned int j = 0;j < m_NbClass;++j)
+            m_SpectralVectors[i][j] /= tmpSum;
+    }
+}
+
+template <class ScalarType>
+void
+SpectralClusteringFilter <ScalarType>
+::ComputeSparseAffinityGraph()
+{
+    unsigned int inputSize = m_InputData.rows();
+    m_SparseIndexes.resize(inputSize);
+
+    if (m_NumberOfThreads > 1)
+    {
+        itk::PoolMultiThreader::Pointer threaderNeighbors = itk::PoolMultiThreader::New();
+
+        ThreadedSpectralData *tmpStr = new ThreadedSpectralData;
+        tmpStr->spectralFilter = this;
+
+        unsigned int actualNumberOfThreads = std::min(m_NumberOfThreads,inputSize);
+
+        threaderNeighbors->SetNumberOfWorkUnits(actualNumberOfThreads);
+        threaderNeighbors->SetSingleMethod(this->ThreadedNeighborsComputation,tmpStr);
+        threaderNeighbors->SingleMethodExecute();
+
+        delete tmpStr;
+    }
+    else
+        this->InternalNeighborsComputation(0,1);
+
+    // Symmetrization: i and j are linked if one of them is among the nearest neighbours of the other
+    std::vector < std::vector <unsigned int> > symmetricIndexes(inputSize);
+    for (unsigned int i = 0;i < inputSize;++i)
+    {
+        for (unsigned int j = 0;j < m_SparseIndexes[i].size();++j)
+        {
+            symmetricIndexes[i].push_back(m_SparseIndexes[i][j]);
+            symmetricIndexes[m_SparseIndexes[i][j]].push_back(i);
+        }
+    }
+
+    m_SparseValues.resize(inputSize);
+    m_DValues.resize(inputSize);
+    for (unsigned int i = 0;i < inputSize;++i)
+    {
+        std::sort(symmetricIndexes[i].begin(),symmetricIndexes[i].end());
+        symmetricIndexes[i].erase(std::unique(symmetricIndexes[i].begin(),symmetricIndexes[i].end()),symmetricIndexes[i].end());
+
+        // Underflowing affinities are removed so that connected components are actual diagonal blocks
+        unsigned int numKept = 0;
+        m_SparseValues[i].resize(symmetricIndexes[i].size());
+        m_DValues[i] = 0;
+        for (unsigned int j = 0;j < symmetricIndexes[i].size();++j)
+        {
+            unsigned int minIndex = std::min(i,symmetricIndexes[i][j]);
+            unsigned int maxIndex = std::max(i,symmetricIndexes[i][j]);
+            double affinity = std::exp(- m_InputData(minIndex,maxIndex) / (2.0 * m_SigmaWeighting * m_SigmaWeighting));
+            if (affinity <= 0)
+                continue;
+
+            symmetricIndexes[i][numKept] = symmetricIndexes[i][j];
+            m_SparseValues[i][numKept] = affinity;
+            m_DValues[i] += affinity;
+            ++numKept;
+        }
+
+        symmetricIndexes[i].resize(numKept);
+        m_SparseValues[i].resize(numKept);
+
+        if (m_DValues[i] > 0)
+            m_DValues[i] = 1.0/std::sqrt(m_DValues[i]);
+    }
+
+    m_SparseIndexes.swap(symmetricIndexes);
+
+    for (unsigned int i = 0;i < inputSize;++i)
+    {
+        for (unsigned int j = 0;j < m_SparseIndexes[i].size();++j)
+            m_SparseValues[i][j] *= m_DValues[i] * m_DValues[m_SparseIndexes[i][j]];
+    }
+}
+
+template <class ScalarType>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+SpectralClusteringFilter <ScalarType>
+::ThreadedNeighborsComputation(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+
+    unsigned int nbThread = threadArgs->WorkUnitID;
+    unsigned int nbProcs = threadArgs->NumberOfWorkUnits;
+
+    ThreadedSpectralData *tmpStr = (ThreadedSpectralData *)threadArgs->UserData;
+
+    tmpStr->spectralFilter->InternalNeighborsComputation(nbThread,nbProcs);
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <class ScalarType>
+void
+SpectralClusteringFilter <ScalarType>
+::InternalNeighborsComputation(unsigned int threadId, unsigned int numThreads)
+{
+    unsigned int inputSize = m_InputData.rows();
+    if (inputSize == 0)
+        return;
+
+    unsigned int step = inputSize / numThreads;
+
+    unsigned int startIndex = threadId * step;
+    unsigned int endIndex = (1 + threadId) * step;
+
+    if (threadId + 1 == numThreads)
+        endIndex = inputSize;
+
+    unsigned int numNeighbors = 0;
+    if (inputSize > 1)
+        numNeighbors = std::min(std::max(m_NumberOfNeighbors,1u),inputSize - 1);
+
+    std::vector < std::pair <double, unsigned int> > distances(inputSize - 1);
+    for (unsigned int i = startIndex;i < endIndex;++i)
+    {
+        unsigned int pos = 0;
+        for (unsigned int j = 0;j < inputSize;++j)
+        {
+            if (j == i)
+                continue;
+
+            distances[pos] = std::make_pair(m_InputData(std::min(i,j),std::max(i,j)),j);
+            ++pos;
+        }
+
+        // Ties are broken on indexes so that the graph does not depend on the number of threads
+        std::nth_element(distances.begin(),distances.begin() + numNeighbors,distances.end());
+
+        m_SparseIndexes[i].resize(numNeighbors);
+        for (unsigned int j = 0;j < numNeighbors;++j)
+            m_SparseIndexes[i][j] = distances[j].second;
+    }
+}
+
+template <class ScalarType>
+void
+SpectralClusteringFilter <ScalarType>
+::MultiplyComponentVector(std::vector <unsigned int> &componentIndexes, VectorType &inputVector, VectorType &outputVector)
+{
+    for (unsigned int i = 0;i < componentIndexes.size();++i)
+    {
+        unsigned int inputIndex = componentIndexes[i];
+        double tmpSum = 0;
+        for (unsigned int j = 0;j < m_SparseIndexes[inputIndex].size();++j)
+            tmpSum += m_SparseValues[inputIndex][j] * inputVector[m_ComponentPositions[m_SparseIndexes[inputIndex][j]]];
+
+        outputVector[i] = tmpSum;
+    }
+}
+
+template <class ScalarType>
+void
+SpectralClusteringFilter <ScalarType>
+::ComputeComponentEigenVectors(std::vector <unsigned int> &componentIndexes, unsigned int numVectors,
+                               std::vector <double> &eigenValues, std::vector <VectorType> &eigenVectors)
+{
+    unsigned int componentSize = componentIndexes.size();
+    eigenValues.resize(numVectors);
+    eigenVectors.resize(numVectors);
+    for (unsigned int i = 0;i < numVectors;++i)
+        eigenVectors[i].resize(componentSize);
+
+    EigenAnalysisType eigenAnalyzer;
+    vnl_diag_matrix <ScalarType> eigVals;
+    MatrixType eigVecs;
+
+    // Small components are decomposed directly
+    const unsigned int maximalDenseSize = 64;
+    if (componentSize <= maximalDenseSize)
+    {
+        MatrixType componentMatrix(componentSize,componentSize,0.0);
+        for (unsigned int i = 0;i < componentSize;++i)
+        {
+            unsigned int inputIndex = componentIndexes[i];
+            for (unsigned int j = 0;j < m_SparseIndexes[inputIndex].size();++j)
+                componentMatrix(i,m_ComponentPositions[m_SparseIndexes[inputIndex][j]]) = m_SparseValues[inputIndex][j];
+        }
+
+        eigenAnalyzer.SetDimension(componentSize);
+        eigenAnalyzer.SetOrder(componentSize);
+        eigVals.set_size(componentSize);
+        eigVecs.set_size(componentSize,componentSize);
+        eigenAnalyzer.ComputeEigenValuesAndVectors(componentMatrix,eigVals,eigVecs);
+
+        for (unsigned int i = 0;i < numVectors;++i)
+        {
+            eigenValues[i] = eigVals[componentSize - i - 1];
+            for (unsigned int j = 0;j < componentSize;++j)
+                eigenVectors[i][j] = eigVecs.get(componentSize - i - 1,j);
+        }
+
+        return;
+    }
+
+    // Lanczos iterations with full reorthogonalization, restarted on a new random direction if an invariant subspace is found
+    unsigned int maximalDimension = std::min(componentSize,std::max(m_LanczosMaximalDimension,2 * numVectors + 10));
+    std::mt19937 generator(componentIndexes[0]);
+    std::uniform_real_distribution <double> uniDbl(-1.0,1.0);
+
+    std::vector <VectorType> lanczosBasis;
+    std::vector <double> alphaValues, betaValues;
+    VectorType currentVector(componentSize), workVector(componentSize);
+
+    bool newDirection = true;
+    double previousBeta = 0;
+    while (true)
+    {
+        if (newDirection)
+        {
+            for (unsigned int i = 0;i < componentSize;++i)
+                currentVector[i] = uniDbl(generator);
+
+            for (unsigned int k = 0;k < 2;++k)
+            {
+                for (unsigned int l = 0;l < lanczosBasis.size();++l)
+                {
+                    double projection = 0;
+                    for (unsigned int i = 0;i < componentSize;++i)
+                        projection += lanczosBasis[l][i] * currentVector[i];
+
+                    for (unsigned int i = 0;i < componentSize;++i)
+                        currentVector[i] -= projection * lanczosBasis[l][i];
+                }
+            }
+
+            double vectorNorm = 0;
+            for (unsigned int i = 0;i < componentSize;++i)
+                vectorNorm += currentVector[i] * currentVector[i];
+
+            vectorNorm = std::sqrt(vectorNorm);
+            for (unsigned int i = 0;i < componentSize;++i)
+                currentVector[i] /= vectorNorm;
+
+            if (lanczosBasis.size() != 0)
+                betaValues.push_back(0.0);
+
+            previousBeta = 0;
+            newDirection = false;
+        }
+
+        lanczosBasis.push_back(currentVector);
+        unsigned int dimension = lanczosBasis.size();
+        this->MultiplyComponentVector(componentIndexes,currentVector,workVector);
+
+        double alpha = 0;
+        for (unsigned int i = 0;i < componentSize;++i)
+            alpha += currentVector[i] * workVector[i];
+
+        for (unsigned int i = 0;i < componentSize;++i)
+        {
+            workVector[i] -= alpha * currentVector[i];
+            if (dimension > 1)
+                workVector[i] -= previousBeta * lanczosBasis[dimension - 2][i];
+        }
+
+        for (unsigned int k = 0;k < 2;++k)
+        {
+            for (unsigned int l = 0;l < dimension;++l)
+            {
+                double projection = 0;
+                for (unsigned int i = 0;i < componentSize;++i)
+                    projection += lanczosBasis[l][i] * workVector[i];
+
+                for (unsigned int i = 0;i < componentSize;++i)
+                    workVector[i] -= projection * lanczosBasis[l][i];
+            }
+        }
+
+        double beta = 0;
+        for (unsigned int i = 0;i < componentSize;++i)
+            beta += workVector[i] * workVector[i];
+
+        beta = std::sqrt(beta);
+        alphaValues.push_back(alpha);
+
+        bool lastIteration = (dimension == maximalDimension);
+        bool invariantSubspace = (beta < 1.0e-10);
+
+        if (invariantSubspace && !lastIteration)
+        {
+            newDirection = true;
+            continue;
+        }
+
+        if ((dimension >= numVectors) && ((dimension % 10 == 0) || lastIteration))
+        {
+            MatrixType tridiagonalMatrix(dimension,dimension,0.0);
+            for (unsigned int i = 0;i < dimension;++i)
+            {
+                tridiagonalMatrix(i,i) = alphaValues[i];
+                if (i + 1 < dimension)
+                {
+                    tridiagonalMatrix(i,i+1) = betaValues[i];
+                    tridiagonalMatrix(i+1,i) = betaValues[i];
+                }
+            }
+
+            eigenAnalyzer.SetDimension(dimension);
+            eigenAnalyzer.SetOrder(dimension);
+            eigVals.set_size(dimension);
+            eigVecs.set_size(dimension,dimension);
+            eigenAnalyzer.ComputeEigenValuesAndVectors(tridiagonalMatrix,eigVals,eigVecs);
+
+            // Ritz pairs residuals are given by the last components of the tridiagonal matrix eigenvectors
+            bool converged = true;
+            for (unsigned int i = 0;i < numVectors;++i)
+            {
+                if (beta * std::abs(eigVecs.get(dimension - i - 1,dimension - 1)) > m_LanczosTolerance)
+                {
+                    converged = false;
+                    break;
+                }
+            }
+
+            if (converged || lastIteration)
+            {
+                for (unsigned int i = 0;i < numVectors;++i)
+                {
+                    eigenValues[i] = eigVals[dimension - i - 1];
+                    std::fill(eigenVectors[i].begin(),eigenVectors[i].end(),0.0);
+                    for (unsigned int l = 0;l < dimension;++l)
+                    {
+                        double coefficient = eigVecs.get(dimension - i - 1,l);
+                        for (unsigned int j = 0;j < componentSize;++j)
+                            eigenVectors[i][j] += coefficient * lanczosBasis[l][j];
+                    }
+
+                    double vectorNorm = 0;
+                    for (unsigned int j = 0;j < componentSize;++j)
+                        vectorNorm += eigenVectors[i][j] * eigenVectors[i][j];
+
+                    vectorNorm = std::sqrt(vectorNorm);
+                    for (unsigned int j = 0;j < componentSize;++j)
+                        eigenVectors[i][j] /= vectorNorm;
+                }
+
+                return;
+            }
+        }
+
+        betaValues.push_back(beta);
+        previousBeta = beta;
+        for (unsigned int i = 0;i < componentSize;++i)
+            currentVector[i] = workVector[i] / beta;
+    }
+}
+
 template <class ScalarType>
 std::vector <unsigned int>
 SpectralClusteringFilter <ScalarType>
@@ -0,0 +1,114 @@
+#include <animaSpectralClusteringFilter.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef anima::SpectralClusteringFilter <double> SpectralClusteringType;
+
+//! Index of the class with the largest membership for each input
+std::vector <unsigned int> GetLabels(SpectralClusteringType &spectralClustering, unsigned int inputSize, unsigned int numClasses)
+{
+    std::vector <unsigned int> labels(inputSize,0);
+    for (unsigned int i = 0;i < inputSize;++i)
+    {
+        SpectralClusteringType::VectorType &membership = spectralClustering.GetClassesMembership(i);
+        for (unsigned int j = 1;j < numClasses;++j)
+        {
+            if (membership[j] > membership[labels[i]])
+                labels[i] = j;
+        }
+    }
+
+    return labels;
+}
+
+//! Checks that two labelings define the same partition, up to a permutation of labels
+bool SamePartition(const std::vector <unsigned int> &firstLabels, const std::vector <unsigned int> &secondLabels)
+{
+    std::map <unsigned int, unsigned int> firstToSecond, secondToFirst;
+    for (unsigned int i = 0;i < firstLabels.size();++i)
+    {
+        if (firstToSecond.count(firstLabels[i]) == 0)
+            firstToSecond[firstLabels[i]] = secondLabels[i];
+
+        if (secondToFirst.count(secondLabels[i]) == 0)
+            secondToFirst[secondLabels[i]] = firstLabels[i];
+
+        if ((firstToSecond[firstLabels[i]] != secondLabels[i]) || (secondToFirst[secondLabels[i]] != firstLabels[i]))
+            return false;
+    }
+
+    return true;
+}
+
+std::vector <unsigned int> RunClustering(SpectralClusteringType::MatrixType &distances, unsigned int numClasses,
+                                         SpectralClusteringType::ComputationModeType mode, unsigned int numThreads)
+{
+    SpectralClusteringType spectralClustering;
+    spectralClustering.SetInputData(distances);
+    spectralClustering.SetNbClass(numClasses);
+    spectralClustering.SetSigmaWeighting(2.0);
+    spectralClustering.SetComputationMode(mode);
+    spectralClustering.SetNumberOfNeighbors(6);
+    spectralClustering.SetNumberOfThreads(numThreads);
+    spectralClustering.SetVerbose(false);
+    spectralClustering.Update();
+
+    return GetLabels(spectralClustering,distances.rows(),numClasses);
+}
+
+bool ReportTest(const std::string &testName, bool success)
+{
+    std::cout << testName << (success ? " -> OK" : " -> FAILED") << std::endl;
+    return success;
+}
+
+int main()
+{
+    // Well separated clusters of 2D points
+    const unsigned int numClasses = 3;
+    const unsigned int clusterSize = 40;
+    const double centers[numClasses][2] = {{0.0, 0.0}, {30.0, 0.0}, {10.0, 40.0}};
+
+    std::mt19937 generator(0);
+    std::normal_distribution <double> normalDistribution(0.0,1.0);
+
+    unsigned int inputSize = numClasses * clusterSize;
+    std::vector < std::vector <double> > points(inputSize,std::vector <double> (2,0.0));
+    std::vector <unsigned int> trueLabels(inputSize,0);
+    for (unsigned int i = 0;i < inputSize;++i)
+    {
+        // Interleaved classes so that neighbours are not contiguous indexes
+        trueLabels[i] = i % numClasses;
+        for (unsigned int j = 0;j < 2;++j)
+            points[i][j] = centers[trueLabels[i]][j] + normalDistribution(generator);
+    }
+
+    // Only the upper triangle of squared distances is filled, as documented for the filter input
+    SpectralClusteringType::MatrixType distances(inputSize,inputSize,0.0);
+    for (unsigned int i = 0;i < inputSize;++i)
+    {
+        for (unsigned int j = i + 1;j < inputSize;++j)
+        {
+            for (unsigned int k = 0;k < 2;++k)
+                distances(i,j) += (points[i][k] - points[j][k]) * (points[i][k] - points[j][k]);
+        }
+    }
+
+    bool success = true;
+    std::vector <unsigned int> denseLabels = RunClustering(distances,numClasses,SpectralClusteringType::Dense,1);
+    success &= ReportTest("Dense clustering",SamePartition(denseLabels,trueLabels));
+
+    std::vector <unsigned int> sparseLabels = RunClustering(distances,numClasses,SpectralClusteringType::Sparse,1);
+    success &= ReportTest("Sparse clustering",SamePartition(sparseLabels,trueLabels));
+    success &= ReportTest("Sparse and dense labels",SamePartition(sparseLabels,denseLabels));
+
+    std::vector <unsigned int> threadedSparseLabels = RunClustering(distances,numClasses,SpectralClusteringType::Sparse,4);
+    success &= ReportTest("Threaded sparse clustering",SamePartition(threadedSparseLabels,sparseLabels));
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
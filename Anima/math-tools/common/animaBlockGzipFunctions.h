@@ -0,0 +1,375 @@
+#pragma once
+
+#include <itkMacro.h>
+#include <itkMultiThreaderBase.h>
+#include <itkNiftiImageIO.h>
+#include <itk_zlib.h>
+
+#include <nifti1.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace anima
+{
+
+/**
+ * @brief Compresses dataSize bytes as a series of independent gzip members, each holding one block of the data.
+ * Blocks are filled in memory by fillBlock(offset,size,buffer) and deflated in parallel, no uncompressed copy of the
+ * whole data is made. Concatenated members are a valid gzip stream (as in BGZF), read transparently by zlib hence by
+ * ITK NIfTI readers.
+ * @param compressionLevel zlib level in [0,9], 0 storing blocks uncompressed, negative values use the zlib default
+ */
+template <class BlockFillerType>
+void
+blockGzipData(std::size_t dataSize, const BlockFillerType &fillBlock, std::ostream &outputStream,
+              int compressionLevel, unsigned int numberOfThreads, std::size_t blockSize = 1 << 20)
+{
+    if (compressionLevel < 0)
+        compressionLevel = Z_DEFAULT_COMPRESSION;
+    else if (compressionLevel > 9)
+        compressionLevel = 9;
+
+    if (numberOfThreads == 0)
+        numberOfThreads = 1;
+
+    // Blocks are processed by batches to bound memory use
+    std::size_t numberOfBlocks = (dataSize + blockSize - 1) / blockSize;
+    std::size_t batchSize = 4 * numberOfThreads;
+    std::vector < std::vector <char> > inputBlocks(batchSize);
+    std::vector < std::vector <unsigned char> > outputBlocks(batchSize);
+    std::vector <std::size_t> outputSizes(batchSize,0);
+    std::vector <int> deflateStatus(batchSize,Z_OK);
+
+    itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+    threader->SetNumberOfWorkUnits(numberOfThreads);
+
+    for (std::size_t batchStart = 0;batchStart < numberOfBlocks;batchStart += batchSize)
+    {
+        std::size_t numBlocks = std::min(batchSize,numberOfBlocks - batchStart);
+
+        threader->ParallelizeArray(0, numBlocks, [&](itk::SizeValueType i)
+        {
+            std::size_t blockOffset = (batchStart + i) * blockSize;
+            inputBlocks[i].resize(std::min(blockSize,dataSize - blockOffset));
+            fillBlock(blockOffset,inputBlocks[i].size(),inputBlocks[i].data());
+
+            z_stream stream;
+            stream.zalloc = Z_NULL;
+            stream.zfree = Z_NULL;
+            stream.opaque = Z_NULL;
+
+            // 15 + 16 window bits: full gzip wrapper for each member
+            deflateStatus[i] = deflateInit2(&stream, compressionLevel, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+            if (deflateStatus[i] != Z_OK)
+                return;
+
+            outputBlocks[i].resize(deflateBound(&stream, inputBlocks[i].size()));
+
+            stream.next_in = reinterpret_cast <Bytef *> (inputBlocks[i].data());
+            stream.avail_in = inputBlocks[i].size();
+            stream.next_out = outputBlocks[i].data();
+            stream.avail_out = outputBlocks[i].size();
+
+            deflateStatus[i] = deflate(&stream, Z_FINISH);
+            outputSizes[i] = stream.total_out;
+            deflateEnd(&stream);
+
+            if (deflateStatus[i] == Z_STREAM_END)
+                deflateStatus[i] = Z_OK;
+        }, nullptr);
+
+        for (std::size_t i = 0;i < numBlocks;++i)
+        {
+            if (deflateStatus[i] != Z_OK)
+                throw itk::ExceptionObject(__FILE__, __LINE__,"Block compression failed",ITK_LOCATION);
+
+            outputStream.write(reinterpret_cast <char *> (outputBlocks[i].data()),outputSizes[i]);
+        }
+
+        if (!outputStream.good())
+            throw itk::ExceptionObject(__FILE__, __LINE__,"Unable to write compressed blocks",ITK_LOCATION);
+    }
+}
+
+//! Checks whether an image can be written by writeBlockGzipNiftiImage: .nii.gz file, scalar or vector pixels of a NIfTI data type, up to 4 dimensions
+template <class ImageType>
+bool
+canBlockGzipNiftiImage(const std::string &fileName)
+{
+    std::string blockExtension(".nii.gz");
+    if ((fileName.size() <= blockExtension.size()) ||
+            (fileName.compare(fileName.size() - blockExtension.size(),blockExtension.size(),blockExtension) != 0))
+        return false;
+
+    if (ImageType::ImageDimension > 4)
+        return false;
+
+    itk::NiftiImageIO::Pointer imageIO = itk::NiftiImageIO::New();
+    imageIO->SetPixelTypeInfo(static_cast <const typename ImageType::PixelType *> (nullptr));
+
+    // Other pixel types (tensors, RGB, complex) have specific NIfTI layouts, left to the ITK writer
+    itk::IOPixelEnum pixelType = imageIO->GetPixelType();
+    if ((pixelType != itk::IOPixelEnum::SCALAR) && (pixelType != itk::IOPixelEnum::VECTOR) &&
+            (pixelType != itk::IOPixelEnum::VARIABLELENGTHVECTOR))
+        return false;
+
+    switch (imageIO->GetComponentType())
+    {
+        case itk::IOComponentEnum::UCHAR:
+        case itk::IOComponentEnum::CHAR:
+        case itk::IOComponentEnum::USHORT:
+        case itk::IOComponentEnum::SHORT:
+        case itk::IOComponentEnum::UINT:
+        case itk::IOComponentEnum::INT:
+        case itk::IOComponentEnum::ULONG:
+        case itk::IOComponentEnum::LONG:
+        case itk::IOComponentEnum::ULONGLONG:
+        case itk::IOComponentEnum::LONGLONG:
+        case itk::IOComponentEnum::FLOAT:
+        case itk::IOComponentEnum::DOUBLE:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Writes an image as a block compressed .nii.gz file (see blockGzipData). The NIfTI header and voxel data are
+ * generated in memory block by block, with the same geometry and vector layout as the ITK NIfTI writer.
+ * Only types accepted by canBlockGzipNiftiImage are supported.
+ */
+template <class ImageType>
+void
+writeBlockGzipNiftiImage(const std::string &fileName, ImageType *image, int compressionLevel, unsigned int numberOfThreads)
+{
+    const unsigned int imageDimension = ImageType::ImageDimension;
+
+    image->UpdateOutputInformation();
+    image->SetRequestedRegionToLargestPossibleRegion();
+    image->Update();
+
+    typename ImageType::RegionType largestRegion = image->GetLargestPossibleRegion();
+    if (image->GetBufferedRegion() != largestRegion)
+        throw itk::ExceptionObject(__FILE__, __LINE__,"Block compression requires the whole image in memory",ITK_LOCATION);
+
+    itk::NiftiImageIO::Pointer imageIO = itk::NiftiImageIO::New();
+    imageIO->SetPixelTypeInfo(static_cast <const typename ImageType::PixelType *> (nullptr));
+    std::size_t componentSize = imageIO->GetComponentSize();
+    std::size_t numberOfComponents = image->GetNumberOfComponentsPerPixel();
+    std::size_t numberOfPixels = largestRegion.GetNumberOfPixels();
+
+    nifti_1_header header;
+    std::memset(&header,0,sizeof(nifti_1_header));
+    header.sizeof_hdr = 348;
+    header.regular = 'r';
+    std::strcpy(header.magic,"n+1");
+    header.vox_offset = 352;
+    header.scl_slope = 1;
+    header.xyzt_units = NIFTI_UNITS_MM | NIFTI_UNITS_SEC;
+    header.bitpix = 8 * componentSize;
+
+    switch (imageIO->GetComponentType())
+    {
+        case itk::IOComponentEnum::FLOAT:
+            header.datatype = NIFTI_TYPE_FLOAT32;
+            break;
+        case itk::IOComponentEnum::DOUBLE:
+            header.datatype = NIFTI_TYPE_FLOAT64;
+            break;
+        case itk::IOComponentEnum::CHAR:
+        case itk::IOComponentEnum::SHORT:
+        case itk::IOComponentEnum::INT:
+        case itk::IOComponentEnum::LONG:
+        case itk::IOComponentEnum::LONGLONG:
+            header.datatype = (componentSize == 1) ? NIFTI_TYPE_INT8 : (componentSize == 2) ? NIFTI_TYPE_INT16 :
+                                                     (componentSize == 4) ? NIFTI_TYPE_INT32 : NIFTI_TYPE_INT64;
+            break;
+        default:
+            header.datatype = (componentSize == 1) ? NIFTI_TYPE_UINT8 : (componentSize == 2) ? NIFTI_TYPE_UINT16 :
+                                                     (componentSize == 4) ? NIFTI_TYPE_UINT32 : NIFTI_TYPE_UINT64;
+            break;
+    }
+
+    for (unsigned int i = 1;i < 8;++i)
+    {
+        header.dim[i] = 1;
+        header.pixdim[i] = 1;
+    }
+
+    header.dim[0] = imageDimension;
+    for (unsigned int i = 0;i < imageDimension;++i)
+    {
+        header.dim[i + 1] = largestRegion.GetSize()[i];
+        header.pixdim[i + 1] = image->GetSpacing()[i];
+    }
+
+    // Vector components are the fifth NIfTI dimension
+    if (numberOfComponents > 1)
+    {
+        header.dim[0] = 5;
+        header.dim[5] = numberOfComponents;
+        header.intent_code = NIFTI_INTENT_VECTOR;
+    }
+
+    // Spatial transform from the (at most 3D) geometry, LPS to RAS as in ITK NIfTI writer. Stored as sform and qform
+    unsigned int spatialDimension = std::min(imageDimension,3U);
+    double matrix[3][4];
+    double rotation[3][3];
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        double sign = (i < 2) ? -1.0 : 1.0;
+        for (unsigned int j = 0;j < 3;++j)
+        {
+            double spacing = 1.0;
+            rotation[i][j] = (i == j);
+            if ((i < spatialDimension) && (j < spatialDimension))
+            {
+                rotation[i][j] = image->GetDirection()(i,j);
+                spacing = image->GetSpacing()[j];
+            }
+            else if (j < spatialDimension)
+                spacing = image->GetSpacing()[j];
+
+            rotation[i][j] *= sign;
+            matrix[i][j] = rotation[i][j] * spacing;
+        }
+
+        matrix[i][3] = (i < spatialDimension) ? sign * image->GetOrigin()[i] : 0.0;
+    }
+
+    for (unsigned int j = 0;j < 4;++j)
+    {
+        header.srow_x[j] = matrix[0][j];
+        header.srow_y[j] = matrix[1][j];
+        header.srow_z[j] = matrix[2][j];
+    }
+
+    header.sform_code = NIFTI_XFORM_SCANNER_ANAT;
+    header.qform_code = NIFTI_XFORM_SCANNER_ANAT;
+    header.qoffset_x = matrix[0][3];
+    header.qoffset_y = matrix[1][3];
+    header.qoffset_z = matrix[2][3];
+
+    // Proper rotation and quaternion, as in nifti_mat44_to_quatern
+    double determinant = rotation[0][0] * (rotation[1][1] * rotation[2][2] - rotation[1][2] * rotation[2][1]) -
+            rotation[0][1] * (rotation[1][0] * rotation[2][2] - rotation[1][2] * rotation[2][0]) +
+            rotation[0][2] * (rotation[1][0] * rotation[2][1] - rotation[1][1] * rotation[2][0]);
+
+    header.pixdim[0] = 1;
+    if (determinant < 0)
+    {
+        header.pixdim[0] = -1;
+        for (unsigned int i = 0;i < 3;++i)
+            rotation[i][2] *= -1;
+    }
+
+    double quaternion[4];
+    double trace = rotation[0][0] + rotation[1][1] + rotation[2][2] + 1.0;
+    if (trace > 0.5)
+    {
+        quaternion[0] = 0.5 * std::sqrt(trace);
+        quaternion[1] = 0.25 * (rotation[2][1] - rotation[1][2]) / quaternion[0];
+        quaternion[2] = 0.25 * (rotation[0][2] - rotation[2][0]) / quaternion[0];
+        quaternion[3] = 0.25 * (rotation[1][0] - rotation[0][1]) / quaternion[0];
+    }
+    else
+    {
+        double xd = 1.0 + rotation[0][0] - (rotation[1][1] + rotation[2][2]);
+        double yd = 1.0 + rotation[1][1] - (rotation[0][0] + rotation[2][2]);
+        double zd = 1.0 + rotation[2][2] - (rotation[0][0] + rotation[1][1]);
+
+        if (xd > 1.0)
+        {
+            quaternion[1] = 0.5 * std::sqrt(xd);
+            quaternion[2] = 0.25 * (rotation[0][1] + rotation[1][0]) / quaternion[1];
+            quaternion[3] = 0.25 * (rotation[0][2] + rotation[2][0]) / quaternion[1];
+            quaternion[0] = 0.25 * (rotation[2][1] - rotation[1][2]) / quaternion[1];
+        }
+        else if (yd > 1.0)
+        {
+            quaternion[2] = 0.5 * std::sqrt(yd);
+            quaternion[1] = 0.25 * (rotation[0][1] + rotation[1][0]) / quaternion[2];
+            quaternion[3] = 0.25 * (rotation[1][2] + rotation[2][1]) / quaternion[2];
+            quaternion[0] = 0.25 * (rotation[0][2] - rotation[2][0]) / quaternion[2];
+        }
+        else
+        {
+            quaternion[3] = 0.5 * std::sqrt(zd);
+            quaternion[1] = 0.25 * (rotation[0][2] + rotation[2][0]) / quaternion[3];
+            quaternion[2] = 0.25 * (rotation[1][2] + rotation[2][1]) / quaternion[3];
+            quaternion[0] = 0.25 * (rotation[1][0] - rotation[0][1]) / quaternion[3];
+        }
+
+        if (quaternion[0] < 0)
+        {
+            for (unsigned int i = 1;i < 4;++i)
+                quaternion[i] *= -1;
+        }
+    }
+
+    header.quatern_b = quaternion[1];
+    header.quatern_c = quaternion[2];
+    header.quatern_d = quaternion[3];
+
+    // Header, 4 null extension bytes, then voxel data with vector components as the slowest dimension
+    std::vector <char> headerBuffer(352,0);
+    std::memcpy(headerBuffer.data(),&header,sizeof(nifti_1_header));
+
+    const char *imageBuffer = reinterpret_cast <const char *> (image->GetBufferPointer());
+    std::size_t componentImageSize = numberOfPixels * componentSize;
+
+    auto fillBlock = [&](std::size_t offset, std::size_t size, char *buffer)
+    {
+        std::size_t headerPart = 0;
+        if (offset < headerBuffer.size())
+        {
+            headerPart = std::min(size,headerBuffer.size() - offset);
+            std::copy(headerBuffer.begin() + offset,headerBuffer.begin() + offset + headerPart,buffer);
+            if (headerPart == size)
+                return;
+        }
+
+        // Blocks and header sizes are multiples of the component size, so blocks hold whole components
+        std::size_t dataOffset = offset + headerPart - headerBuffer.size();
+        for (std::size_t pos = headerPart;pos < size;pos += componentSize)
+        {
+            std::size_t component = dataOffset / componentImageSize;
+            std::size_t pixel = (dataOffset % componentImageSize) / componentSize;
+            std::memcpy(buffer + pos,imageBuffer + (pixel * numberOfComponents + component) * componentSize,componentSize);
+            dataOffset += componentSize;
+        }
+    };
+
+    std::ofstream outputFile(fileName.c_str(), std::ios::binary);
+    if (!outputFile.is_open())
+    {
+        std::string error("Unable to write compressed file: ");
+        error += fileName;
+        throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
+    }
+
+    try
+    {
+        anima::blockGzipData(headerBuffer.size() + numberOfComponents * componentImageSize,fillBlock,outputFile,
+                             compressionLevel,numberOfThreads);
+    }
+    catch (itk::ExceptionObject &)
+    {
+        // Do not leave a truncated image behind
+        outputFile.close();
+        std::remove(fileName.c_str());
+        throw;
+    }
+
+    outputFile.close();
+}
+
+} // end namespace anima
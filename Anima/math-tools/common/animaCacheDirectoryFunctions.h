@@ -0,0 +1,148 @@
+#pragma once
+
+#include <itkMacro.h>
+#include <itksys/Directory.hxx>
+#include <itksys/SystemTools.hxx>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace anima
+{
+
+//! Bumped when the layout of cached data changes, so that older entries are never read
+const unsigned int CacheFormatVersion = 1;
+
+//! Initial value of 64 bits FNV-1a cache keys, already combined with the cache format version
+inline uint64_t
+initialCacheHash()
+{
+    uint64_t hashValue = 14695981039346656037ULL;
+    unsigned int version = CacheFormatVersion;
+    const unsigned char *versionBytes = reinterpret_cast <const unsigned char *> (&version);
+    for (unsigned int i = 0;i < sizeof(unsigned int);++i)
+    {
+        hashValue ^= versionBytes[i];
+        hashValue *= 1099511628211ULL;
+    }
+
+    return hashValue;
+}
+
+//! Adds bytes to a 64 bits FNV-1a cache key
+inline void
+hashCacheBytes(uint64_t &hashValue, const void *data, std::size_t size)
+{
+    const unsigned char *bytes = static_cast <const unsigned char *> (data);
+    for (std::size_t i = 0;i < size;++i)
+    {
+        hashValue ^= bytes[i];
+        hashValue *= 1099511628211ULL;
+    }
+}
+
+inline void
+hashCacheString(uint64_t &hashValue, const std::string &value)
+{
+    hashCacheBytes(hashValue, value.c_str(), value.size() + 1);
+}
+
+inline std::string
+cacheKeyToString(uint64_t hashValue)
+{
+    std::ostringstream keyStream;
+    keyStream << std::hex << std::setw(16) << std::setfill('0') << hashValue;
+
+    return keyStream.str();
+}
+
+//! Temporary file name in the cache directory: entries are written there first, then renamed by commitCacheFile
+inline std::string
+temporaryCacheFileName(const std::string &cacheDirectory, const std::string &extension)
+{
+    std::random_device randomDevice;
+    std::ostringstream tmpFileName;
+    tmpFileName << cacheDirectory << "/tmp_" << std::hex << randomDevice() << randomDevice() << extension;
+
+    return tmpFileName.str();
+}
+
+//! Atomically publishes a cache entry, concurrent runs never read a partial file
+inline void
+commitCacheFile(const std::string &tmpFileName, const std::string &cacheFileName)
+{
+    if (std::rename(tmpFileName.c_str(),cacheFileName.c_str()) != 0)
+        itksys::SystemTools::RemoveFile(tmpFileName);
+}
+
+//! Marks a cache entry as used: pruning removes least recently used entries first
+inline void
+touchCacheFile(const std::string &fileName)
+{
+    itksys::SystemTools::Touch(fileName,false);
+}
+
+/**
+ * @brief Removes least recently used entries (files starting with "anima") of a cache directory until its size
+ * is below maximumSize (in megabytes). Temporary files of running writes are left untouched. No limit if maximumSize is 0.
+ */
+inline void
+pruneCacheDirectory(const std::string &cacheDirectory, unsigned long maximumSize)
+{
+    if ((maximumSize == 0) || (cacheDirectory == ""))
+        return;
+
+    itksys::Directory directory;
+    if (!directory.Load(cacheDirectory))
+        return;
+
+    struct CacheEntry
+    {
+        std::string fileName;
+        long int modifiedTime;
+        unsigned long long size;
+    };
+
+    std::vector <CacheEntry> cacheEntries;
+    unsigned long long totalSize = 0;
+    for (unsigned long i = 0;i < directory.GetNumberOfFiles();++i)
+    {
+        std::string fileName = directory.GetFile(i);
+        if (fileName.compare(0,5,"anima") != 0)
+            continue;
+
+        CacheEntry entry;
+        entry.fileName = cacheDirectory + "/" + fileName;
+        if (itksys::SystemTools::FileIsDirectory(entry.fileName))
+            continue;
+
+        entry.modifiedTime = itksys::SystemTools::ModifiedTime(entry.fileName);
+        entry.size = itksys::SystemTools::FileLength(entry.fileName);
+        totalSize += entry.size;
+
+        cacheEntries.push_back(entry);
+    }
+
+    unsigned long long maximumBytes = static_cast <unsigned long long> (maximumSize) << 20;
+    if (totalSize <= maximumBytes)
+        return;
+
+    std::sort(cacheEntries.begin(),cacheEntries.end(),[] (const CacheEntry &lhs, const CacheEntry &rhs)
+    {
+        return lhs.modifiedTime < rhs.modifiedTime;
+    });
+
+    for (unsigned int i = 0;(i < cacheEntries.size()) && (totalSize > maximumBytes);++i)
+    {
+        if (itksys::SystemTools::RemoveFile(cacheEntries[i].fileName))
+            totalSize -= cacheEntries[i].size;
+    }
+}
+
+} // end namespace anima
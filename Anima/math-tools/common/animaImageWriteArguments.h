@@ -0,0 +1,38 @@
+#pragma once
+
+#include <animaReadWriteFunctions.h>
+
+#include <tclap/CmdLine.h>
+
+namespace anima
+{
+
+/**
+ * @brief Output image compression options shared by tools writing large images through anima::writeImage.
+ * Arguments are added to cmd on construction, Setup is called once parsed.
+ */
+class ImageWriteArguments
+{
+public:
+    ImageWriteArguments(TCLAP::CmdLine &cmd)
+        : m_CompressionLevelArg("","compression-level","Compression level of output images: 0 to store data uncompressed (.nii.gz files stay readable gzip streams), 1 to 9 for the zlib level (default: zlib default)",
+                                false,-1,"compression level",cmd),
+          m_CompressionThreadsArg("","compression-threads","Number of threads compressing .nii.gz outputs by independent blocks in memory, 1 for standard serial compression (default: 1)",
+                                  false,1,"compression threads",cmd)
+    {
+    }
+
+    void Setup()
+    {
+        if (m_CompressionLevelArg.isSet())
+            anima::SetImageWriteCompressionLevel(m_CompressionLevelArg.getValue());
+
+        anima::SetImageWriteCompressionThreads(m_CompressionThreadsArg.getValue());
+    }
+
+private:
+    TCLAP::ValueArg <int> m_CompressionLevelArg;
+    TCLAP::ValueArg <unsigned int> m_CompressionThreadsArg;
+};
+
+} // end namespace anima
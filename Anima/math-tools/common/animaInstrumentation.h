@@ -0,0 +1,719 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace anima
+{
+
+/**
+ * @brief Lightweight instrumentation of hot paths: hierarchical scoped timers, counters and histograms.
+ * Instrumentation points use the ANIMA_INSTRUMENT_* macros below, compiled out unless ANIMA_USE_INSTRUMENTATION
+ * is defined (USE_INSTRUMENTATION CMake option). Even when compiled in, nothing is recorded unless an output is set,
+ * either by SetOutput (--instrumentation option of tools) or by the ANIMA_INSTRUMENTATION_OUTPUT environment variable
+ * (ANIMA_INSTRUMENTATION_FORMAT: json or chrome).
+ *
+ * Recording is lock free: each thread fills its own data. Merge folds them into global statistics, it is called by
+ * instrumented filters at their end, when no worker thread records anymore. Scopes are hierarchical per thread: scopes
+ * opened in worker threads are roots of their thread. Results are written at exit, as JSON statistics (stages,
+ * counters with per thread totals, log2 histograms, calibrated overhead) or as a Chrome trace (chrome://tracing,
+ * Perfetto) of scopes up to a maximal depth.
+ */
+class Instrumentation
+{
+public:
+    enum OutputFormat
+    {
+        JSON = 0,
+        ChromeTrace
+    };
+
+    static Instrumentation &GetInstance()
+    {
+        static Instrumentation instance;
+        return instance;
+    }
+
+    //! Hot path calls check this first, true when an output is set
+    static bool IsEnabled() {return m_Enabled.load(std::memory_order_relaxed);}
+
+    //! Interned identifier of a scope, counter or histogram name, computed once per instrumentation point
+    unsigned int RegisterName(const std::string &name)
+    {
+        std::lock_guard <std::mutex> lock(m_Mutex);
+        std::map <std::string, unsigned int>::iterator nameItr = m_NameIds.find(name);
+        if (nameItr != m_NameIds.end())
+            return nameItr->second;
+
+        unsigned int nameId = m_Names.size();
+        m_Names.push_back(name);
+        m_NameIds[name] = nameId;
+
+        return nameId;
+    }
+
+    static void EnterScope(unsigned int nameId) {GetThreadData()->EnterScope(nameId);}
+    static void ExitScope()
+    {
+        ThreadData *data = GetThreadData();
+        data->ExitScope(GetInstance().m_MaximumTraceDepth, GetInstance().m_MaximumNumberOfTraceEvents,
+                        GetInstance().m_StartTime);
+    }
+
+    static void AddToCounter(unsigned int nameId, double value) {GetThreadData()->AddToCounter(nameId,value);}
+    static void AddToHistogram(unsigned int nameId, double value) {GetThreadData()->AddToHistogram(nameId,value);}
+
+    //! Folds per thread data into global statistics. Not to be called while instrumented threads are running
+    void Merge()
+    {
+        std::lock_guard <std::mutex> lock(m_Mutex);
+        for (unsigned int i = 0;i < m_ThreadData.size();++i)
+            this->MergeThreadData(*m_ThreadData[i]);
+    }
+
+    void SetOutput(const std::string &fileName, OutputFormat format)
+    {
+        m_OutputFileName = fileName;
+        m_OutputFormat = format;
+        m_Enabled = (fileName != "");
+    }
+
+    //! Format from its name: "chrome" for Chrome traces, JSON statistics otherwise
+    static OutputFormat GetFormatFromString(const std::string &format)
+    {
+        if ((format == "chrome") || (format == "trace"))
+            return ChromeTrace;
+
+        return JSON;
+    }
+
+    //! Only scopes up to this depth in their thread are kept as trace events (default: 4)
+    void SetMaximumTraceDepth(unsigned int val) {m_MaximumTraceDepth = val;}
+    //! Trace events kept per thread (default: 1000000), statistics are still computed for later ones
+    void SetMaximumNumberOfTraceEvents(unsigned long val) {m_MaximumNumberOfTraceEvents = val;}
+
+    void WriteResults(const std::string &fileName, OutputFormat format)
+    {
+        this->Merge();
+
+        std::ofstream outputFile(fileName.c_str());
+        if (!outputFile.is_open())
+        {
+            std::cerr << "Unable to write instrumentation results to " << fileName << std::endl;
+            return;
+        }
+
+        outputFile << std::setprecision(9);
+        if (format == ChromeTrace)
+            this->WriteChromeTrace(outputFile);
+        else
+            this->WriteStatistics(outputFile);
+    }
+
+    ~Instrumentation()
+    {
+        bool enabled = m_Enabled;
+        m_Enabled = false;
+
+        if (enabled)
+            this->WriteResults(m_OutputFileName,m_OutputFormat);
+    }
+
+private:
+    typedef std::chrono::steady_clock ClockType;
+
+    struct ScopeNode
+    {
+        unsigned int NameId;
+        int Parent;
+        std::vector < std::pair <unsigned int, unsigned int> > Children;
+        unsigned long Count;
+        double Total, Minimum, Maximum;
+    };
+
+    struct OpenScope
+    {
+        unsigned int Node;
+        ClockType::time_point Start;
+    };
+
+    struct TraceEvent
+    {
+        unsigned int NameId;
+        unsigned int ThreadIndex;
+        double Start, Duration;
+    };
+
+    struct CounterData
+    {
+        double Value;
+        unsigned long Updates;
+    };
+
+    //! Powers of two buckets from 2^-MinimalExponent, first and last ones also hold values out of range
+    static const int MinimalExponent = 32;
+    static const unsigned int NumberOfHistogramBuckets = 64;
+
+    struct HistogramData
+    {
+        unsigned long Count;
+        double Sum, Minimum, Maximum;
+        std::vector <unsigned long> Buckets;
+
+        void Reset()
+        {
+            Count = 0;
+            Sum = 0;
+            Minimum = 0;
+            Maximum = 0;
+            Buckets.assign(NumberOfHistogramBuckets,0);
+        }
+    };
+
+    struct ThreadData
+    {
+        unsigned int ThreadIndex;
+        std::vector <ScopeNode> Nodes;
+        unsigned int CurrentNode;
+        std::vector <OpenScope> OpenScopes;
+        std::vector <CounterData> Counters;
+        std::vector <HistogramData> Histograms;
+        std::vector <TraceEvent> TraceEvents;
+
+        ThreadData(unsigned int index)
+        {
+            ThreadIndex = index;
+
+            // Root node, never timed
+            ScopeNode root;
+            root.NameId = 0;
+            root.Parent = -1;
+            root.Count = 0;
+            root.Total = root.Minimum = root.Maximum = 0;
+            Nodes.push_back(root);
+            CurrentNode = 0;
+        }
+
+        void EnterScope(unsigned int nameId)
+        {
+            std::vector < std::pair <unsigned int, unsigned int> > &children = Nodes[CurrentNode].Children;
+            unsigned int childNode = 0;
+            for (unsigned int i = 0;i < children.size();++i)
+            {
+                if (children[i].first == nameId)
+                {
+                    childNode = children[i].second;
+                    break;
+                }
+            }
+
+            if (childNode == 0)
+            {
+                ScopeNode node;
+                node.NameId = nameId;
+                node.Parent = CurrentNode;
+                node.Count = 0;
+                node.Total = node.Minimum = node.Maximum = 0;
+
+                childNode = Nodes.size();
+                Nodes[CurrentNode].Children.push_back(std::make_pair(nameId,childNode));
+                Nodes.push_back(node);
+            }
+
+            CurrentNode = childNode;
+
+            OpenScope scope;
+            scope.Node = childNode;
+            OpenScopes.push_back(scope);
+            OpenScopes.back().Start = ClockType::now();
+        }
+
+        void ExitScope(unsigned int maximumTraceDepth, unsigned long maximumNumberOfTraceEvents,
+                       const ClockType::time_point &startTime)
+        {
+            ClockType::time_point endTime = ClockType::now();
+            if (OpenScopes.size() == 0)
+                return;
+
+            const OpenScope &scope = OpenScopes.back();
+            double duration = std::chrono::duration <double> (endTime - scope.Start).count();
+
+            ScopeNode &node = Nodes[scope.Node];
+            if ((node.Count == 0) || (duration < node.Minimum))
+                node.Minimum = duration;
+            if ((node.Count == 0) || (duration > node.Maximum))
+                node.Maximum = duration;
+
+            ++node.Count;
+            node.Total += duration;
+
+            if ((OpenScopes.size() <= maximumTraceDepth) && (TraceEvents.size() < maximumNumberOfTraceEvents))
+            {
+                TraceEvent event;
+                event.NameId = node.NameId;
+                event.ThreadIndex = ThreadIndex;
+                event.Start = std::chrono::duration <double> (scope.Start - startTime).count();
+                event.Duration = duration;
+                TraceEvents.push_back(event);
+            }
+
+            CurrentNode = node.Parent;
+            OpenScopes.pop_back();
+        }
+
+        void AddToCounter(unsigned int nameId, double value)
+        {
+            if (nameId >= Counters.size())
+            {
+                CounterData zeroCounter = {0, 0};
+                Counters.resize(nameId + 1,zeroCounter);
+            }
+
+            Counters[nameId].Value += value;
+            ++Counters[nameId].Updates;
+        }
+
+        void AddToHistogram(unsigned int nameId, double value)
+        {
+            if (nameId >= Histograms.size())
+            {
+                unsigned int oldSize = Histograms.size();
+                Histograms.resize(nameId + 1);
+                for (unsigned int i = oldSize;i <= nameId;++i)
+                    Histograms[i].Reset();
+            }
+
+            HistogramData &histogram = Histograms[nameId];
+            if ((histogram.Count == 0) || (value < histogram.Minimum))
+                histogram.Minimum = value;
+            if ((histogram.Count == 0) || (value > histogram.Maximum))
+                histogram.Maximum = value;
+
+            ++histogram.Count;
+            histogram.Sum += value;
+            ++histogram.Buckets[GetHistogramBucket(value)];
+        }
+    };
+
+    struct StageStatistics
+    {
+        unsigned long Count;
+        double Total, Minimum, Maximum;
+    };
+
+    Instrumentation()
+    {
+        m_StartTime = ClockType::now();
+        m_MaximumTraceDepth = 4;
+        m_MaximumNumberOfTraceEvents = 1000000;
+        m_OutputFormat = JSON;
+
+        const char *outputName = std::getenv("ANIMA_INSTRUMENTATION_OUTPUT");
+        if (outputName != NULL)
+        {
+            const char *formatName = std::getenv("ANIMA_INSTRUMENTATION_FORMAT");
+            this->SetOutput(outputName, (formatName != NULL) ? GetFormatFromString(formatName) : JSON);
+        }
+    }
+
+    Instrumentation(const Instrumentation &) = delete;
+    Instrumentation &operator=(const Instrumentation &) = delete;
+
+    static ThreadData *GetThreadData()
+    {
+        if (m_CurrentThreadData == NULL)
+            m_CurrentThreadData = GetInstance().RegisterThread();
+
+        return m_CurrentThreadData;
+    }
+
+    //! Thread data is owned by the instance, it outlives threads of the pool
+    ThreadData *RegisterThread()
+    {
+        std::lock_guard <std::mutex> lock(m_Mutex);
+        m_ThreadData.push_back(std::unique_ptr <ThreadData> (new ThreadData(m_ThreadData.size())));
+        return m_ThreadData.back().get();
+    }
+
+    static unsigned int GetHistogramBucket(double value)
+    {
+        if (!(value > 0))
+            return 0;
+
+        int exponent;
+        std::frexp(value,&exponent);
+
+        int bucket = exponent - 1 + MinimalExponent;
+        bucket = std::max(0, std::min(bucket, (int)NumberOfHistogramBuckets - 1));
+
+        return bucket;
+    }
+
+    std::string GetScopePath(const ThreadData &data, unsigned int node)
+    {
+        std::string path = m_Names[data.Nodes[node].NameId];
+        int parent = data.Nodes[node].Parent;
+        while (parent > 0)
+        {
+            path = m_Names[data.Nodes[parent].NameId] + "/" + path;
+            parent = data.Nodes[parent].Parent;
+        }
+
+        return path;
+    }
+
+    //! Called with the mutex locked, resets thread data but keeps its scope tree for later scopes
+    void MergeThreadData(ThreadData &data)
+    {
+        for (unsigned int i = 1;i < data.Nodes.size();++i)
+        {
+            ScopeNode &node = data.Nodes[i];
+            if (node.Count == 0)
+                continue;
+
+            StageStatistics &stage = m_MergedStages[this->GetScopePath(data,i)];
+            if ((stage.Count == 0) || (node.Minimum < stage.Minimum))
+                stage.Minimum = node.Minimum;
+            if ((stage.Count == 0) || (node.Maximum > stage.Maximum))
+                stage.Maximum = node.Maximum;
+
+            stage.Count += node.Count;
+            stage.Total += node.Total;
+
+            node.Count = 0;
+            node.Total = node.Minimum = node.Maximum = 0;
+        }
+
+        for (unsigned int i = 0;i < data.Counters.size();++i)
+        {
+            if (data.Counters[i].Updates == 0)
+                continue;
+
+            std::vector <double> &counterValues = m_MergedCounters[m_Names[i]];
+            if (counterValues.size() <= data.ThreadIndex)
+                counterValues.resize(data.ThreadIndex + 1,0.0);
+
+            counterValues[data.ThreadIndex] += data.Counters[i].Value;
+            m_NumberOfCounterUpdates += data.Counters[i].Updates;
+
+            data.Counters[i].Value = 0;
+            data.Counters[i].Updates = 0;
+        }
+
+        for (unsigned int i = 0;i < data.Histograms.size();++i)
+        {
+            HistogramData &threadHistogram = data.Histograms[i];
+            if (threadHistogram.Count == 0)
+                continue;
+
+            std::map <std::string, HistogramData>::iterator histogramItr = m_MergedHistograms.find(m_Names[i]);
+            if (histogramItr == m_MergedHistograms.end())
+            {
+                histogramItr = m_MergedHistograms.insert(std::make_pair(m_Names[i],HistogramData())).first;
+                histogramItr->second.Reset();
+            }
+
+            HistogramData &histogram = histogramItr->second;
+            if ((histogram.Count == 0) || (threadHistogram.Minimum < histogram.Minimum))
+                histogram.Minimum = threadHistogram.Minimum;
+            if ((histogram.Count == 0) || (threadHistogram.Maximum > histogram.Maximum))
+                histogram.Maximum = threadHistogram.Maximum;
+
+            histogram.Count += threadHistogram.Count;
+            histogram.Sum += threadHistogram.Sum;
+            for (unsigned int j = 0;j < NumberOfHistogramBuckets;++j)
+                histogram.Buckets[j] += threadHistogram.Buckets[j];
+
+            threadHistogram.Reset();
+        }
+
+        m_MergedTraceEvents.insert(m_MergedTraceEvents.end(),data.TraceEvents.begin(),data.TraceEvents.end());
+        data.TraceEvents.clear();
+
+        m_NumberOfThreads = std::max(m_NumberOfThreads, data.ThreadIndex + 1);
+    }
+
+    /**
+     * Cost of instrumentation points measured on a private thread data: scope enter and exit pair, counter and
+     * histogram update, in seconds
+     */
+    void CalibrateOverhead(double &scopeCost, double &counterCost, double &histogramCost)
+    {
+        const unsigned int numCalibrationCalls = 100000;
+        ThreadData calibrationData(0);
+        ClockType::time_point startTime = ClockType::now();
+
+        ClockType::time_point beginTime = ClockType::now();
+        for (unsigned int i = 0;i < numCalibrationCalls;++i)
+        {
+            calibrationData.EnterScope(0);
+            calibrationData.ExitScope(0,0,startTime);
+        }
+        scopeCost = std::chrono::duration <double> (ClockType::now() - beginTime).count() / numCalibrationCalls;
+
+        beginTime = ClockType::now();
+        for (unsigned int i = 0;i < numCalibrationCalls;++i)
+            calibrationData.AddToCounter(0,1.0);
+        counterCost = std::chrono::duration <double> (ClockType::now() - beginTime).count() / numCalibrationCalls;
+
+        beginTime = ClockType::now();
+        for (unsigned int i = 0;i < numCalibrationCalls;++i)
+            calibrationData.AddToHistogram(0,i);
+        histogramCost = std::chrono::duration <double> (ClockType::now() - beginTime).count() / numCalibrationCalls;
+    }
+
+    static std::string EscapeString(const std::string &value)
+    {
+        std::string escapedValue;
+        for (unsigned int i = 0;i < value.size();++i)
+        {
+            if ((value[i] == '"') || (value[i] == '\\'))
+                escapedValue += '\\';
+            escapedValue += value[i];
+        }
+
+        return escapedValue;
+    }
+
+    void WriteStatistics(std::ostream &outputFile)
+    {
+        double scopeCost, counterCost, histogramCost;
+        this->CalibrateOverhead(scopeCost,counterCost,histogramCost);
+
+        unsigned long numScopes = 0;
+        for (std::map <std::string, StageStatistics>::iterator stageItr = m_MergedStages.begin();
+             stageItr != m_MergedStages.end();++stageItr)
+            numScopes += stageItr->second.Count;
+
+        unsigned long numHistogramUpdates = 0;
+        for (std::map <std::string, HistogramData>::iterator histogramItr = m_MergedHistograms.begin();
+             histogramItr != m_MergedHistograms.end();++histogramItr)
+            numHistogramUpdates += histogramItr->second.Count;
+
+        outputFile << "{" << std::endl;
+        outputFile << "  \"threads\": " << m_NumberOfThreads << "," << std::endl;
+        outputFile << "  \"overhead\": {\"scope\": " << scopeCost << ", \"counter\": " << counterCost
+                   << ", \"histogram\": " << histogramCost << ", \"estimated_total\": "
+                   << numScopes * scopeCost + m_NumberOfCounterUpdates * counterCost + numHistogramUpdates * histogramCost
+                   << "}," << std::endl;
+
+        // Stages sorted by path: children follow their parent
+        outputFile << "  \"stages\": [" << std::endl;
+        unsigned int index = 0;
+        for (std::map <std::string, StageStatistics>::iterator stageItr = m_MergedStages.begin();
+             stageItr != m_MergedStages.end();++stageItr,++index)
+        {
+            const StageStatistics &stage = stageItr->second;
+            outputFile << "    {\"path\": \"" << EscapeString(stageItr->first) << "\", \"count\": " << stage.Count
+                       << ", \"total\": " << stage.Total << ", \"mean\": " << stage.Total / stage.Count
+                       << ", \"min\": " << stage.Minimum << ", \"max\": " << stage.Maximum << "}";
+
+            if (index != m_MergedStages.size() - 1)
+                outputFile << ",";
+            outputFile << std::endl;
+        }
+        outputFile << "  ]," << std::endl;
+
+        outputFile << "  \"counters\": [" << std::endl;
+        index = 0;
+        for (std::map <std::string, std::vector <double> >::iterator counterItr = m_MergedCounters.begin();
+             counterItr != m_MergedCounters.end();++counterItr,++index)
+        {
+            const std::vector <double> &counterValues = counterItr->second;
+            double totalValue = 0;
+            for (unsigned int i = 0;i < counterValues.size();++i)
+                totalValue += counterValues[i];
+
+            outputFile << "    {\"name\": \"" << EscapeString(counterItr->first) << "\", \"total\": " << totalValue
+                       << ", \"per_thread\": [";
+            for (unsigned int i = 0;i < counterValues.size();++i)
+            {
+                if (i != 0)
+                    outputFile << ", ";
+                outputFile << counterValues[i];
+            }
+            outputFile << "]}";
+
+            if (index != m_MergedCounters.size() - 1)
+                outputFile << ",";
+            outputFile << std::endl;
+        }
+        outputFile << "  ]," << std::endl;
+
+        outputFile << "  \"histograms\": [" << std::endl;
+        index = 0;
+        for (std::map <std::string, HistogramData>::iterator histogramItr = m_MergedHistograms.begin();
+             histogramItr != m_MergedHistograms.end();++histogramItr,++index)
+        {
+            const HistogramData &histogram = histogramItr->second;
+            outputFile << "    {\"name\": \"" << EscapeString(histogramItr->first) << "\", \"count\": " << histogram.Count
+                       << ", \"mean\": " << histogram.Sum / histogram.Count << ", \"min\": " << histogram.Minimum
+                       << ", \"max\": " << histogram.Maximum << ", \"buckets\": [";
+
+            bool firstBucket = true;
+            for (unsigned int i = 0;i < NumberOfHistogramBuckets;++i)
+            {
+                if (histogram.Buckets[i] == 0)
+                    continue;
+
+                if (!firstBucket)
+                    outputFile << ", ";
+                firstBucket = false;
+
+                outputFile << "{\"lower\": " << std::ldexp(1.0, (int)i - MinimalExponent) << ", \"upper\": "
+                           << std::ldexp(1.0, (int)i + 1 - MinimalExponent) << ", \"count\": " << histogram.Buckets[i] << "}";
+            }
+            outputFile << "]}";
+
+            if (index != m_MergedHistograms.size() - 1)
+                outputFile << ",";
+            outputFile << std::endl;
+        }
+        outputFile << "  ]" << std::endl;
+        outputFile << "}" << std::endl;
+    }
+
+    //! Complete events in microseconds, counters as a final counter event
+    void WriteChromeTrace(std::ostream &outputFile)
+    {
+        outputFile << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+
+        bool firstEvent = true;
+        for (unsigned int i = 0;i < m_MergedTraceEvents.size();++i)
+        {
+            const TraceEvent &event = m_MergedTraceEvents[i];
+            if (!firstEvent)
+                outputFile << "," << std::endl;
+            firstEvent = false;
+
+            outputFile << "  {\"name\": \"" << EscapeString(m_Names[event.NameId]) << "\", \"cat\": \"anima\", \"ph\": \"X\", "
+                       << "\"pid\": 1, \"tid\": " << event.ThreadIndex << ", \"ts\": " << event.Start * 1.0e6
+                       << ", \"dur\": " << event.Duration * 1.0e6 << "}";
+        }
+
+        double endTime = std::chrono::duration <double> (ClockType::now() - m_StartTime).count();
+        for (std::map <std::string, std::vector <double> >::iterator counterItr = m_MergedCounters.begin();
+             counterItr != m_MergedCounters.end();++counterItr)
+        {
+            double totalValue = 0;
+            for (unsigned int i = 0;i < counterItr->second.size();++i)
+                totalValue += counterItr->second[i];
+
+            if (!firstEvent)
+                outputFile << "," << std::endl;
+            firstEvent = false;
+
+            outputFile << "  {\"name\": \"" << EscapeString(counterItr->first) << "\", \"ph\": \"C\", \"pid\": 1, \"ts\": "
+                       << endTime * 1.0e6 << ", \"args\": {\"total\": " << totalValue << "}}";
+        }
+
+        outputFile << std::endl << "]}" << std::endl;
+    }
+
+    static inline std::atomic <bool> m_Enabled {false};
+    static inline thread_local ThreadData *m_CurrentThreadData = NULL;
+
+    std::mutex m_Mutex;
+    std::vector <std::string> m_Names;
+    std::map <std::string, unsigned int> m_NameIds;
+    std::vector < std::unique_ptr <ThreadData> > m_ThreadData;
+
+    ClockType::time_point m_StartTime;
+    unsigned int m_MaximumTraceDepth;
+    unsigned long m_MaximumNumberOfTraceEvents;
+
+    std::string m_OutputFileName;
+    OutputFormat m_OutputFormat;
+
+    std::map <std::string, StageStatistics> m_MergedStages;
+    std::map <std::string, std::vector <double> > m_MergedCounters;
+    std::map <std::string, HistogramData> m_MergedHistograms;
+    std::vector <TraceEvent> m_MergedTraceEvents;
+    unsigned long m_NumberOfCounterUpdates = 0;
+    unsigned int m_NumberOfThreads = 0;
+};
+
+//! Times its lifetime as a stage, nested in the scope open in the same thread
+class InstrumentationScope
+{
+public:
+    InstrumentationScope(unsigned int nameId)
+    {
+        m_Active = Instrumentation::IsEnabled();
+        if (m_Active)
+            Instrumentation::EnterScope(nameId);
+    }
+
+    ~InstrumentationScope()
+    {
+        if (m_Active)
+            Instrumentation::ExitScope();
+    }
+
+private:
+    InstrumentationScope(const InstrumentationScope &) = delete;
+    InstrumentationScope &operator=(const InstrumentationScope &) = delete;
+
+    bool m_Active;
+};
+
+} // end namespace anima
+
+#define ANIMA_INSTRUMENT_CONCATENATE_IMPL(a,b) a##b
+#define ANIMA_INSTRUMENT_CONCATENATE(a,b) ANIMA_INSTRUMENT_CONCATENATE_IMPL(a,b)
+
+#ifdef ANIMA_USE_INSTRUMENTATION
+
+//! Times the enclosing block as stage name
+#define ANIMA_INSTRUMENT_SCOPE(name) \
+    static const unsigned int ANIMA_INSTRUMENT_CONCATENATE(animaInstrumentId,__LINE__) = \
+        anima::Instrumentation::GetInstance().RegisterName(name); \
+    anima::InstrumentationScope ANIMA_INSTRUMENT_CONCATENATE(animaInstrumentScope,__LINE__) \
+        (ANIMA_INSTRUMENT_CONCATENATE(animaInstrumentId,__LINE__))
+
+//! Adds value to counter name, totals are also kept per thread
+#define ANIMA_INSTRUMENT_COUNT(name,value) \
+    do \
+    { \
+        static const unsigned int animaInstrumentId = anima::Instrumentation::GetInstance().RegisterName(name); \
+        if (anima::Instrumentation::IsEnabled()) \
+            anima::Instrumentation::AddToCounter(animaInstrumentId,value); \
+    } while (0)
+
+//! Adds value to the powers of two histogram name
+#define ANIMA_INSTRUMENT_HISTOGRAM(name,value) \
+    do \
+    { \
+        static const unsigned int animaInstrumentId = anima::Instrumentation::GetInstance().RegisterName(name); \
+        if (anima::Instrumentation::IsEnabled()) \
+            anima::Instrumentation::AddToHistogram(animaInstrumentId,value); \
+    } while (0)
+
+//! Merges per thread data, at the end of instrumented filters. Only where no other instrumented thread may be running
+#define ANIMA_INSTRUMENT_MERGE() \
+    do \
+    { \
+        if (anima::Instrumentation::IsEnabled()) \
+            anima::Instrumentation::GetInstance().Merge(); \
+    } while (0)
+
+#else
+
+// Values are not evaluated, only referenced to keep variables computed for instrumentation used
+#define ANIMA_INSTRUMENT_SCOPE(name)
+#define ANIMA_INSTRUMENT_COUNT(name,value) do {(void) sizeof(value);} while (0)
+#define ANIMA_INSTRUMENT_HISTOGRAM(name,value) do {(void) sizeof(value);} while (0)
+#define ANIMA_INSTRUMENT_MERGE() do {} while (0)
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <animaInstrumentation.h>
+
+#include <tclap/CmdLine.h>
+
+namespace anima
+{
+
+/**
+ * @brief Instrumentation options shared by tools with instrumented hot paths: output file and format of timings and
+ * counters. Arguments are added to cmd on construction, Setup is called once parsed.
+ */
+class InstrumentationArguments
+{
+public:
+    InstrumentationArguments(TCLAP::CmdLine &cmd)
+        : m_OutputArg("","instrumentation","Output file of stage timings and counters, requires a build with USE_INSTRUMENTATION (default: ANIMA_INSTRUMENTATION_OUTPUT environment variable)",
+                      false,"","instrumentation output",cmd),
+          m_FormatArg("","instrumentation-format","Instrumentation output format: json (statistics) or chrome (trace for chrome://tracing) (default: json)",
+                      false,"json","instrumentation format",cmd)
+    {
+    }
+
+    void Setup()
+    {
+        if (m_OutputArg.getValue() == "")
+            return;
+
+#ifdef ANIMA_USE_INSTRUMENTATION
+        anima::Instrumentation::GetInstance().SetOutput(m_OutputArg.getValue(),
+                                                        anima::Instrumentation::GetFormatFromString(m_FormatArg.getValue()));
+#else
+        std::cerr << "Warning: instrumentation requested but not compiled in (USE_INSTRUMENTATION), no output written" << std::endl;
+#endif
+    }
+
+private:
+    TCLAP::ValueArg <std::string> m_OutputArg;
+    TCLAP::ValueArg <std::string> m_FormatArg;
+};
+
+} // end namespace anima
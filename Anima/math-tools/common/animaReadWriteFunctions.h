@@ -4,9 +4,41 @@
 #include <itkImageFileWriter.h>
 #include <itkExtractImageFilter.h>
 
+#include <animaBlockGzipFunctions.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
 namespace anima
 {
 
+//! Reads non empty lines of a text file
+inline std::vector <std::string>
+readFileList(const std::string &fileName)
+{
+    std::ifstream fileIn(fileName.c_str());
+    if (!fileIn.is_open())
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Unable to read file: " + fileName, ITK_LOCATION);
+
+    std::vector <std::string> fileList;
+    while (!fileIn.eof())
+    {
+        char tmpStr[2048];
+        fileIn.getline(tmpStr,2048);
+
+        std::string workStr(tmpStr);
+        workStr.erase(workStr.find_last_not_of(" \n\r\t")+1);
+        if (workStr == "")
+            continue;
+
+        fileList.push_back(workStr);
+    }
+
+    return fileList;
+}
+
 template <class ImageType>
 typename itk::SmartPointer<ImageType>
 readImage(std::string filename)
@@ -23,13 +55,61 @@ readImage(std::string filename)
     return img;
 }
 
+/**
+ * Options shared by all writeImage calls of a process, set by tools (see animaImageWriteArguments.h).
+ * Defaults keep the ITK writer behaviour: compression with the zlib default level, serial .nii.gz compression
+ */
+struct ImageWriteOptions
+{
+    bool useCompression;
+    int compressionLevel;
+    unsigned int numberOfCompressionThreads;
+};
+
+inline ImageWriteOptions &
+GetImageWriteOptions()
+{
+    static ImageWriteOptions options = {true, -1, 1};
+    return options;
+}
+
+//! Sets compression for all subsequent image writes, 0 to skip compression (e.g. for intermediate files, .nii.gz data is then stored uncompressed)
+inline void
+SetImageWriteCompressionLevel(int level)
+{
+    GetImageWriteOptions().compressionLevel = level;
+    GetImageWriteOptions().useCompression = (level != 0);
+}
+
+//! Sets the number of threads compressing .nii.gz outputs by blocks in memory, 1 (default) uses ITK serial compression
+inline void
+SetImageWriteCompressionThreads(unsigned int numThreads)
+{
+    GetImageWriteOptions().numberOfCompressionThreads = std::max(numThreads,1U);
+}
+
 template <class OutputImageType>
 void
 writeImage(std::string filename, OutputImageType* img)
 {
+    ImageWriteOptions &options = GetImageWriteOptions();
+
+    // The ITK NIfTI writer always deflates .nii.gz files: without compression, data is stored as is in the gzip members
+    if (((options.numberOfCompressionThreads > 1) || !options.useCompression) &&
+            anima::canBlockGzipNiftiImage <OutputImageType> (filename))
+    {
+        int compressionLevel = options.useCompression ? options.compressionLevel : 0;
+        anima::writeBlockGzipNiftiImage(filename,img,compressionLevel,options.numberOfCompressionThreads);
+        return;
+    }
+
     typedef itk::ImageFileWriter<OutputImageType> WriterType;
     typename WriterType::Pointer writer = WriterType::New();
-    writer->SetUseCompression(true);
+
+    writer->SetUseCompression(options.useCompression);
+    if (options.useCompression && (options.compressionLevel > 0))
+        writer->SetCompressionLevel(options.compressionLevel);
+
     writer->SetFileName(filename);
     writer->SetInput(img);
 
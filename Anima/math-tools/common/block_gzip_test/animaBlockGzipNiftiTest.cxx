@@ -0,0 +1,287 @@
+#include <animaBlockGzipFunctions.h>
+#include <animaReadWriteFunctions.h>
+
+#include <itkImageFileReader.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkImageRegionIterator.h>
+#include <itkVectorImage.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+//! Rotation of angle around axis (z for 2D images), with a flipped last spatial column if flip is true
+template <class DirectionType>
+DirectionType GetDirection(double angle, const double axis[3], bool flip)
+{
+    DirectionType direction;
+    direction.SetIdentity();
+
+    unsigned int spatialDimension = std::min((unsigned int)DirectionType::RowDimensions,3U);
+    const double zAxis[3] = {0.0, 0.0, 1.0};
+    if (spatialDimension < 3)
+        axis = zAxis;
+
+    double norm = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    double x = axis[0] / norm, y = axis[1] / norm, z = axis[2] / norm;
+    double c = std::cos(angle), s = std::sin(angle);
+    double rotation[3][3] = {{c + x * x * (1.0 - c), x * y * (1.0 - c) - z * s, x * z * (1.0 - c) + y * s},
+                             {y * x * (1.0 - c) + z * s, c + y * y * (1.0 - c), y * z * (1.0 - c) - x * s},
+                             {z * x * (1.0 - c) - y * s, z * y * (1.0 - c) + x * s, c + z * z * (1.0 - c)}};
+
+    for (unsigned int i = 0;i < spatialDimension;++i)
+    {
+        for (unsigned int j = 0;j < spatialDimension;++j)
+            direction(i,j) = rotation[i][j];
+    }
+
+    if (flip)
+    {
+        for (unsigned int i = 0;i < spatialDimension;++i)
+            direction(i,spatialDimension - 1) *= -1;
+    }
+
+    return direction;
+}
+
+template <class ImageType>
+void SetComponents(ImageType *image, unsigned int numComponents)
+{
+}
+
+template <class PixelType, unsigned int Dimension>
+void SetComponents(itk::VectorImage <PixelType,Dimension> *image, unsigned int numComponents)
+{
+    image->SetVectorLength(numComponents);
+}
+
+template <class ValueType>
+void SetRandomPixel(ValueType &pixel, unsigned int numComponents, std::mt19937 &generator)
+{
+    std::uniform_real_distribution <double> distribution(-100.0,100.0);
+    pixel = static_cast <ValueType> (distribution(generator));
+}
+
+template <class ValueType>
+void SetRandomPixel(itk::VariableLengthVector <ValueType> &pixel, unsigned int numComponents, std::mt19937 &generator)
+{
+    pixel.SetSize(numComponents);
+    for (unsigned int i = 0;i < numComponents;++i)
+        SetRandomPixel(pixel[i],1,generator);
+}
+
+template <class ValueType, unsigned int NumComponents>
+void SetRandomPixel(itk::Vector <ValueType,NumComponents> &pixel, unsigned int numComponents, std::mt19937 &generator)
+{
+    for (unsigned int i = 0;i < NumComponents;++i)
+        SetRandomPixel(pixel[i],1,generator);
+}
+
+//! Image with random voxels and the given geometry
+template <class ImageType>
+typename ImageType::Pointer
+CreateImage(const typename ImageType::SizeType &size, const typename ImageType::SpacingType &spacing,
+            const typename ImageType::PointType &origin, const typename ImageType::DirectionType &direction,
+            unsigned int numComponents, std::mt19937 &generator)
+{
+    typename ImageType::Pointer image = ImageType::New();
+    typename ImageType::RegionType region;
+    region.SetSize(size);
+    image->SetRegions(region);
+    image->SetSpacing(spacing);
+    image->SetOrigin(origin);
+    image->SetDirection(direction);
+    SetComponents(image.GetPointer(),numComponents);
+    image->Allocate();
+
+    itk::ImageRegionIterator <ImageType> imageItr(image,region);
+    typename ImageType::PixelType pixel;
+    while (!imageItr.IsAtEnd())
+    {
+        SetRandomPixel(pixel,numComponents,generator);
+        imageItr.Set(pixel);
+        ++imageItr;
+    }
+
+    return image;
+}
+
+//! Reads back fileName with the ITK reader, compares geometry (up to NIfTI float precision) and voxels (exactly) to image
+template <class ImageType>
+bool CheckReadImage(const std::string &fileName, ImageType *image)
+{
+    typedef itk::ImageFileReader <ImageType> ReaderType;
+    typename ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName(fileName);
+
+    try
+    {
+        reader->Update();
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        std::cerr << e << std::endl;
+        return false;
+    }
+
+    typename ImageType::Pointer readImage = reader->GetOutput();
+    if ((readImage->GetLargestPossibleRegion() != image->GetLargestPossibleRegion()) ||
+            (readImage->GetNumberOfComponentsPerPixel() != image->GetNumberOfComponentsPerPixel()))
+        return false;
+
+    double tolerance = 1.0e-5;
+    for (unsigned int i = 0;i < ImageType::ImageDimension;++i)
+    {
+        if ((std::abs(readImage->GetSpacing()[i] - image->GetSpacing()[i]) > tolerance * image->GetSpacing()[i]) ||
+                (std::abs(readImage->GetOrigin()[i] - image->GetOrigin()[i]) > tolerance * (1.0 + std::abs(image->GetOrigin()[i]))))
+            return false;
+
+        for (unsigned int j = 0;j < ImageType::ImageDimension;++j)
+        {
+            if (std::abs(readImage->GetDirection()(i,j) - image->GetDirection()(i,j)) > tolerance)
+                return false;
+        }
+    }
+
+    itk::ImageRegionConstIterator <ImageType> imageItr(image,image->GetLargestPossibleRegion());
+    itk::ImageRegionConstIterator <ImageType> readItr(readImage,image->GetLargestPossibleRegion());
+    while (!imageItr.IsAtEnd())
+    {
+        if (readItr.Get() != imageItr.Get())
+            return false;
+
+        ++imageItr;
+        ++readItr;
+    }
+
+    return true;
+}
+
+std::size_t GetFileSize(const std::string &fileName)
+{
+    std::ifstream file(fileName.c_str(), std::ios::binary | std::ios::ate);
+    return file.is_open() ? static_cast <std::size_t> (file.tellg()) : 0;
+}
+
+//! Writes image by blocks with each direction, at a compressed and at the uncompressed level, then reads it back
+template <class ImageType>
+bool TestRoundTrip(const std::string &testName, const typename ImageType::SizeType &size,
+                   const typename ImageType::SpacingType &spacing, const typename ImageType::PointType &origin,
+                   unsigned int numComponents, std::mt19937 &generator)
+{
+    typedef typename ImageType::DirectionType DirectionType;
+    const double axes[4][3] = {{0.0, 0.0, 1.0}, {1.0, 2.0, -0.5}, {0.3, -1.0, 0.8}, {1.0, 1.0, 0.0}};
+    const double angles[4] = {0.0, 0.7, 2.4, M_PI};
+    std::string fileName = "animaBlockGzipNiftiTest.nii.gz";
+
+    unsigned int numFailures = 0;
+    unsigned int numTests = 0;
+    for (unsigned int i = 0;i < 4;++i)
+    {
+        for (unsigned int flip = 0;flip < 2;++flip)
+        {
+            DirectionType direction = GetDirection <DirectionType> (angles[i],axes[i],flip);
+            typename ImageType::Pointer image = CreateImage <ImageType> (size,spacing,origin,direction,numComponents,generator);
+
+            std::size_t dataSize = image->GetLargestPossibleRegion().GetNumberOfPixels() *
+                    image->GetNumberOfComponentsPerPixel() * sizeof(typename itk::NumericTraits <typename ImageType::PixelType>::ValueType);
+
+            // Level 0 files hold the whole data, stored uncompressed
+            int levels[2] = {6, 0};
+            for (unsigned int j = 0;j < 2;++j)
+            {
+                anima::writeBlockGzipNiftiImage(fileName,image.GetPointer(),levels[j],4);
+                bool success = CheckReadImage(fileName,image.GetPointer());
+                if (levels[j] == 0)
+                    success &= (GetFileSize(fileName) > dataSize);
+
+                numFailures += !success;
+                ++numTests;
+            }
+        }
+    }
+
+    std::remove(fileName.c_str());
+
+    bool success = (numFailures == 0);
+    std::cout << testName << ": " << numFailures << " failures out of " << numTests
+              << (success ? " -> OK" : " -> FAILED") << std::endl;
+
+    return success;
+}
+
+int main()
+{
+    std::mt19937 generator(0);
+    bool success = true;
+
+    // Scalar 3D image over several compressed blocks
+    typedef itk::Image <float,3> ScalarImageType;
+    ScalarImageType::SizeType size3D = {{70, 64, 60}};
+    ScalarImageType::SpacingType spacing3D;
+    spacing3D[0] = 0.9;
+    spacing3D[1] = 1.1;
+    spacing3D[2] = 2.5;
+    ScalarImageType::PointType origin3D;
+    origin3D[0] = -12.5;
+    origin3D[1] = 30.25;
+    origin3D[2] = 7.0;
+    success &= TestRoundTrip <ScalarImageType> ("Scalar 3D float image",size3D,spacing3D,origin3D,1,generator);
+
+    // 2D integer image
+    typedef itk::Image <short,2> Scalar2DImageType;
+    Scalar2DImageType::SizeType size2D = {{45, 33}};
+    Scalar2DImageType::SpacingType spacing2D;
+    spacing2D[0] = 0.4;
+    spacing2D[1] = 0.6;
+    Scalar2DImageType::PointType origin2D;
+    origin2D[0] = 3.0;
+    origin2D[1] = -8.5;
+    success &= TestRoundTrip <Scalar2DImageType> ("Scalar 2D short image",size2D,spacing2D,origin2D,1,generator);
+
+    // 4D image: spatial geometry in the first three dimensions, time spacing in the fourth
+    typedef itk::Image <int,4> Scalar4DImageType;
+    Scalar4DImageType::SizeType size4D = {{20, 18, 16, 5}};
+    Scalar4DImageType::SpacingType spacing4D;
+    Scalar4DImageType::PointType origin4D;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        spacing4D[i] = spacing3D[i];
+        origin4D[i] = origin3D[i];
+    }
+
+    spacing4D[3] = 3.0;
+    origin4D[3] = 0.0;
+    success &= TestRoundTrip <Scalar4DImageType> ("Scalar 4D int image",size4D,spacing4D,origin4D,1,generator);
+
+    // Vector images, components stored as the fifth NIfTI dimension
+    typedef itk::VectorImage <double,3> VectorImageType;
+    VectorImageType::SizeType sizeVector = {{24, 20, 12}};
+    success &= TestRoundTrip <VectorImageType> ("Vector 3D double image",sizeVector,spacing3D,origin3D,6,generator);
+
+    typedef itk::Image < itk::Vector <float,3>, 3 > FixedVectorImageType;
+    success &= TestRoundTrip <FixedVectorImageType> ("Fixed vector 3D float image",sizeVector,spacing3D,origin3D,3,generator);
+
+    // Uncompressed writes through writeImage go through stored gzip blocks
+    anima::SetImageWriteCompressionLevel(0);
+    const double axis[3] = {1.0, -1.0, 2.0};
+    ScalarImageType::Pointer image = CreateImage <ScalarImageType> (size3D,spacing3D,origin3D,
+                                                                    GetDirection <ScalarImageType::DirectionType> (0.7,axis,false),
+                                                                    1,generator);
+
+    std::string fileName = "animaBlockGzipNiftiTestLevel0.nii.gz";
+    anima::writeImage <ScalarImageType> (fileName,image);
+    bool levelZeroSuccess = CheckReadImage(fileName,image.GetPointer()) &&
+            (GetFileSize(fileName) > image->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(float));
+    std::remove(fileName.c_str());
+
+    std::cout << "Uncompressed writeImage: " << (levelZeroSuccess ? "OK" : "FAILED") << std::endl;
+    success &= levelZeroSuccess;
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
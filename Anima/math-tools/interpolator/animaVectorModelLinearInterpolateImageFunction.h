@@ -2,6 +2,10 @@
 
 #include <itkInterpolateImageFunction.h>
 #include <itkVariableLengthVector.h>
+#include <itkNumericTraitsVariableLengthVectorPixel.h>
+#include <itkNumericTraitsVectorPixel.h>
+
+#include <vector>
 
 namespace anima
 {
@@ -43,6 +47,10 @@ public:
     typedef typename Superclass::OutputType OutputType;
     typedef itk::VariableLengthVector <typename TInputImage::IOPixelType> VectorPixelType;
 
+    //! Scalar values of the buffer, for vector images as well as images of fixed length vectors (e.g. itk::Vector <float,6>)
+    typedef typename itk::NumericTraits <PixelType>::ValueType InternalScalarType;
+    typedef typename TInputImage::OffsetValueType OffsetValueType;
+
     /** Evaluate the function at a ContinuousIndex position
          *
          * Returns the linearly interpolated image intensity at a
@@ -53,6 +61,15 @@ public:
          * calling the method. */
     virtual OutputType EvaluateAtContinuousIndex(const ContinuousIndexType & index) const ITK_OVERRIDE;
 
+    /** Same as EvaluateAtContinuousIndex but writes the interpolated model in a caller allocated buffer
+     * of GetNumberOfComponentsPerPixel() values, without any allocation. Tensor (6) and usual ODF (15, 28, 45)
+     * lengths are interpolated by fixed length code. */
+    template <class TOutputValue>
+    void EvaluateAtContinuousIndexInBuffer(const ContinuousIndexType &index, TOutputValue *output) const;
+
+    //! Also computes neighbor buffer offsets from the input offset table
+    virtual void SetInputImage(const InputImageType *ptr) ITK_OVERRIDE;
+
     SizeType GetRadius() const override
     {
         return SizeType::Filled(1);
@@ -62,52 +79,13 @@ protected:
     VectorModelLinearInterpolateImageFunction();
     virtual ~VectorModelLinearInterpolateImageFunction() {}
 
-    template <class T> inline bool isZero(itk::VariableLengthVector <T> &value) const
-    {
-        for (unsigned int i = 0;i < value.GetNumberOfElements();++i)
-        {
-            if (value[i] != 0)
-                return false;
-        }
-
-        return true;
-    }
-
-    // Fake method for compilation purposes, should never go in there
-    template <class T> inline bool isZero(T &data) const
-    {
-        itkExceptionMacro("Access to unauthorized zero test method");
-        return true;
-    }
-
-    //! Utility function to initialize output images pixel to zero for vector images
-    template <class T> inline void InitializeZeroPixel(itk::VariableLengthVector <T> &zeroPixel) const
-    {
-        zeroPixel.Fill(0.0);
-    }
-
-    //! Utility function to initialize output images pixel to zero for all images except vector images
-    template <class T> inline void InitializeZeroPixel(T &zeroPixel) const
-    {
-        itkExceptionMacro("Access to unauthorized zero pixel method");
-        zeroPixel = itk::NumericTraits <T>::ZeroValue();
-    }
-
-    //! Utility function to initialize output images pixel to zero for vector images
-    template <class T1, class T2>
-    void AddValue(itk::VariableLengthVector <T1> &input, double weight,
-                  itk::VariableLengthVector <T2> &output) const
-    {
-        unsigned int vecDim = input.GetNumberOfElements();
-        for (unsigned int i = 0;i < vecDim;++i)
-            output[i] += weight * input[i];
-    }
-
-    //! Utility function to initialize output images pixel to zero for all images except vector images
-    template <class T1, class T2> void AddValue(T1 &input, double weight, T2 &output) const
-    {
-        itkExceptionMacro("Acces to unauthorized method, check your implementation");
-    }
+    /**
+     * Interpolation kernel: NComponents is the model length if known at compile time, 0 otherwise (numComponents
+     * is then used). Sums are done in the accumulator buffer (at least numComponents values).
+     */
+    template <unsigned int NComponents, class TOutputValue>
+    void InterpolateInBuffer(const ContinuousIndexType &index, unsigned int numComponents,
+                             double *accumulator, TOutputValue *output) const;
 
 private:
     VectorModelLinearInterpolateImageFunction(const Self&); //purposely not implemented
@@ -115,6 +93,10 @@ private:
 
     /** Number of neighbors used in the interpolation */
     static const unsigned long m_Neighbors;
+
+    //! Offsets (in scalar values) of neighbors from the lower corner, bit dim of the neighbor number is its upper / lower side
+    OffsetValueType m_NeighborOffsets[1 << TInputImage::ImageDimension];
+    unsigned int m_NumberOfComponents;
 };
 
 } // end namespace itk
@@ -22,7 +22,35 @@ template<class TInputImage, class TCoordRep>
 VectorModelLinearInterpolateImageFunction< TInputImage, TCoordRep >
 ::VectorModelLinearInterpolateImageFunction()
 {
+    m_NumberOfComponents = 0;
+    for (unsigned int i = 0;i < m_Neighbors;++i)
+        m_NeighborOffsets[i] = 0;
+}
+
+template<class TInputImage, class TCoordRep>
+void
+VectorModelLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::SetInputImage(const InputImageType *ptr)
+{
+    this->Superclass::SetInputImage(ptr);
 
+    if (!ptr)
+        return;
+
+    m_NumberOfComponents = ptr->GetNumberOfComponentsPerPixel();
+    const OffsetValueType *offsetTable = ptr->GetOffsetTable();
+
+    for (unsigned int counter = 0;counter < m_Neighbors;++counter)
+    {
+        OffsetValueType neighborOffset = 0;
+        for (unsigned int dim = 0;dim < ImageDimension;++dim)
+        {
+            if ((counter >> dim) & 1)
+                neighborOffset += offsetTable[dim];
+        }
+
+        m_NeighborOffsets[counter] = neighborOffset * m_NumberOfComponents;
+    }
 }
 
 /**
@@ -34,80 +62,198 @@ typename VectorModelLinearInterpolateImageFunction< TInputImage, TCoordRep >
 VectorModelLinearInterpolateImageFunction< TInputImage, TCoordRep >
 ::EvaluateAtContinuousIndex(const ContinuousIndexType& index) const
 {
+    OutputType output;
+    itk::NumericTraits <OutputType>::SetLength(output,m_NumberOfComponents);
+    this->EvaluateAtContinuousIndexInBuffer(index,output.GetDataPointer());
+
+    return output;
+}
+
+template<class TInputImage, class TCoordRep>
+template <class TOutputValue>
+void
+VectorModelLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::EvaluateAtContinuousIndexInBuffer(const ContinuousIndexType &index, TOutputValue *output) const
+{
+    // Stack accumulators for all usual models, MCM images with many compartments fall back on the heap
+    const unsigned int maximalStackLength = 64;
+    double accumulator[maximalStackLength];
+
+    switch (m_NumberOfComponents)
+    {
+        case 6:
+            this->template InterpolateInBuffer <6> (index,6,accumulator,output);
+            break;
+
+        case 15:
+            this->template InterpolateInBuffer <15> (index,15,accumulator,output);
+            break;
+
+        case 28:
+            this->template InterpolateInBuffer <28> (index,28,accumulator,output);
+            break;
+
+        case 45:
+            this->template InterpolateInBuffer <45> (index,45,accumulator,output);
+            break;
+
+        default:
+        {
+            if (m_NumberOfComponents <= maximalStackLength)
+                this->template InterpolateInBuffer <0> (index,m_NumberOfComponents,accumulator,output);
+            else
+            {
+                std::vector <double> largeAccumulator(m_NumberOfComponents);
+                this->template InterpolateInBuffer <0> (index,m_NumberOfComponents,largeAccumulator.data(),output);
+            }
+
+            break;
+        }
+    }
+}
+
+template<class TInputImage, class TCoordRep>
+template <unsigned int NComponents, class TOutputValue>
+void
+VectorModelLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::InterpolateInBuffer(const ContinuousIndexType &index, unsigned int numComponents,
+                      double *accumulator, TOutputValue *output) const
+{
+    // Compile time bound for fixed lengths, so that component loops are unrolled and vectorized
+    const unsigned int vectorDim = (NComponents > 0) ? NComponents : numComponents;
+
     IndexType baseIndex;
     double distance[ImageDimension], oppDistance[ImageDimension];
+    bool interiorPoint = true;
 
     for (unsigned int dim = 0; dim < ImageDimension; ++dim)
     {
         baseIndex[dim] = itk::Math::Floor< IndexValueType >( index[dim] );
         distance[dim] = index[dim] - static_cast< double >( baseIndex[dim] );
         oppDistance[dim] = 1.0 - distance[dim];
+
+        if ((baseIndex[dim] < this->m_StartIndex[dim]) || (baseIndex[dim] >= this->m_EndIndex[dim]))
+            interiorPoint = false;
     }
 
-    unsigned int vectorDim = this->GetInputImage()->GetNumberOfComponentsPerPixel();
-    OutputType output(vectorDim);
-    this->InitializeZeroPixel(output);
+    for (unsigned int i = 0;i < vectorDim;++i)
+        accumulator[i] = 0;
 
+    const InputImageType *inputImage = this->GetInputImage();
+    const InternalScalarType *bufferPointer = reinterpret_cast <const InternalScalarType *> (inputImage->GetBufferPointer());
     double totalOverlap = 0;
 
-    for( unsigned int counter = 0; counter < m_Neighbors; ++counter)
+    if (interiorPoint)
     {
-        double overlap = 1.0;          // fraction overlap
-        unsigned int upper = counter;  // each bit indicates upper/lower neighbour
-        IndexType neighIndex;
+        // All neighbors are in the buffer: no bound check, neighbors from the lower corner offset
+        const InternalScalarType *basePointer = bufferPointer + inputImage->ComputeOffset(baseIndex) * vectorDim;
 
-        // get neighbor index and overlap fraction
-        bool okValue = true;
-        for (unsigned int dim = 0; dim < ImageDimension; ++dim)
+        for (unsigned int counter = 0;counter < m_Neighbors;++counter)
         {
-            if (upper & 1)
-            {
-                neighIndex[dim] = baseIndex[dim] + 1;
+            double overlap = 1.0;
+            for (unsigned int dim = 0;dim < ImageDimension;++dim)
+                overlap *= ((counter >> dim) & 1) ? distance[dim] : oppDistance[dim];
+
+            if (overlap <= 0)
+                continue;
 
-                if (neighIndex[dim] > this->m_EndIndex[dim])
+            const InternalScalarType *neighborPointer = basePointer + m_NeighborOffsets[counter];
+
+            bool zeroValue = true;
+            for (unsigned int i = 0;i < vectorDim;++i)
+            {
+                if (neighborPointer[i] != 0)
                 {
-                    okValue = false;
+                    zeroValue = false;
                     break;
                 }
-
-                overlap *= distance[dim];
             }
-            else
+
+            if (zeroValue)
+                continue;
+
+            for (unsigned int i = 0;i < vectorDim;++i)
+                accumulator[i] += overlap * neighborPointer[i];
+
+            totalOverlap += overlap;
+        }
+    }
+    else
+    {
+        for (unsigned int counter = 0;counter < m_Neighbors;++counter)
+        {
+            double overlap = 1.0;          // fraction overlap
+            unsigned int upper = counter;  // each bit indicates upper/lower neighbour
+            IndexType neighIndex;
+
+            // get neighbor index and overlap fraction
+            bool okValue = true;
+            for (unsigned int dim = 0; dim < ImageDimension; ++dim)
             {
-                neighIndex[dim] = baseIndex[dim];
+                if (upper & 1)
+                {
+                    neighIndex[dim] = baseIndex[dim] + 1;
 
-                if (neighIndex[dim] < this->m_StartIndex[dim])
+                    if (neighIndex[dim] > this->m_EndIndex[dim])
+                    {
+                        okValue = false;
+                        break;
+                    }
+
+                    overlap *= distance[dim];
+                }
+                else
                 {
-                    okValue = false;
-                    break;
+                    neighIndex[dim] = baseIndex[dim];
+
+                    if (neighIndex[dim] < this->m_StartIndex[dim])
+                    {
+                        okValue = false;
+                        break;
+                    }
+
+                    overlap *= oppDistance[dim];
                 }
 
-                overlap *= oppDistance[dim];
+                upper >>= 1;
             }
 
-            upper >>= 1;
-        }
+            // get neighbor value only if overlap is not zero
+            if ((overlap <= 0) || !okValue)
+                continue;
 
-        // get neighbor value only if overlap is not zero
-        if ((overlap > 0) && okValue)
-        {
-            VectorPixelType input = static_cast <VectorPixelType> (this->GetInputImage()->GetPixel(neighIndex));
+            const InternalScalarType *neighborPointer = bufferPointer + inputImage->ComputeOffset(neighIndex) * vectorDim;
 
-            if (!isZero(input))
+            bool zeroValue = true;
+            for (unsigned int i = 0;i < vectorDim;++i)
             {
-                this->AddValue(input,overlap,output);
-                totalOverlap += overlap;
+                if (neighborPointer[i] != 0)
+                {
+                    zeroValue = false;
+                    break;
+                }
             }
-        }
 
+            if (zeroValue)
+                continue;
+
+            for (unsigned int i = 0;i < vectorDim;++i)
+                accumulator[i] += overlap * neighborPointer[i];
+
+            totalOverlap += overlap;
+        }
     }
 
     if (totalOverlap >= 0.5)
-        output /= totalOverlap;
+    {
+        for (unsigned int i = 0;i < vectorDim;++i)
+            output[i] = static_cast <TOutputValue> (accumulator[i] / totalOverlap);
+    }
     else
-        this->InitializeZeroPixel(output);
-
-    return output;
+    {
+        for (unsigned int i = 0;i < vectorDim;++i)
+            output[i] = 0;
+    }
 }
 
 } // end namespace itk
@@ -5,6 +5,7 @@
 #include <vnl/vnl_diag_matrix.h>
 
 #include <itkVariableLengthVector.h>
+#include <itkVector.h>
 #include <itkMatrixOffsetTransformBase.h>
 #include <itkSymmetricEigenAnalysis.h>
 
@@ -35,6 +36,7 @@ public:
     void GetTensorPower(const vnl_matrix <TScalarType> &tensor, vnl_matrix <TScalarType> &outputTensor, double powerValue);
 
 private:
+    //! Generic path for tensor dimensions other than 3
     EigenAnalysisType m_EigenAnalyzer;
     vnl_matrix <TScalarType> m_EigVecs;
     vnl_diag_matrix <TScalarType> m_EigVals;
@@ -48,6 +50,15 @@ template <class T1, class T2> void GetTensorFromVectorRepresentation(const itk::
                                                                      vnl_matrix <T2> &tensor, unsigned int tensDim = 0,
                                                                      bool scale = false);
 
+//! Fixed length pixels (e.g. itk::Vector <float,6> for 3D tensors): same as above, pixels are never resized
+template <class T1, class T2, unsigned int NVectorDimension>
+void GetVectorRepresentation(const vnl_matrix <T1> &tensor, itk::Vector <T2,NVectorDimension> &vector,
+                             unsigned int vecDim = 0, bool scale = false);
+
+template <class T1, class T2, unsigned int NVectorDimension>
+void GetTensorFromVectorRepresentation(const itk::Vector <T1,NVectorDimension> &vector,
+                                       vnl_matrix <T2> &tensor, unsigned int tensDim = 0, bool scale = false);
+
 //! Recompose tensor from values extracted using SymmetricEigenAnalysis (vnl_symmetric_eigensystem transposes all this)
 template <class T1, class T2>
 void RecomposeTensor(vnl_diag_matrix <T1> &eigs, vnl_matrix <T1> &eigVecs, vnl_matrix <T2> &resMatrix);
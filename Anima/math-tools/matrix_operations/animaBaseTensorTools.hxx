@@ -4,6 +4,7 @@
 
 #include <animaVectorOperations.h>
 #include <animaMatrixOperations.h>
+#include <animaSymmetricEigen3D.h>
 
 namespace anima
 {
@@ -15,6 +16,16 @@ LogEuclideanTensorCalculator <TScalarType>
 {
     unsigned int tensDim = tensor.rows();
 
+    if (tensDim == 3)
+    {
+        double tensorValues[6];
+        anima::GetPackedTensor3D(tensor,tensorValues);
+        anima::GetTensorLogarithm3D(tensorValues,tensorValues,1);
+        log_tensor.set_size(3,3);
+        anima::GetTensorFromPacked3D(tensorValues,log_tensor);
+        return;
+    }
+
     m_EigenAnalyzer.SetDimension(tensDim);
     m_EigenAnalyzer.SetOrder(tensDim);
     m_EigVals.set_size(tensDim);
@@ -40,6 +51,16 @@ LogEuclideanTensorCalculator <TScalarType>
 {
     unsigned int tensDim = tensor.rows();
 
+    if (tensDim == 3)
+    {
+        double tensorValues[6];
+        anima::GetPackedTensor3D(tensor,tensorValues);
+        anima::GetTensorPower3D(tensorValues,tensorValues,1,powerValue);
+        outputTensor.set_size(3,3);
+        anima::GetTensorFromPacked3D(tensorValues,outputTensor);
+        return;
+    }
+
     m_EigenAnalyzer.SetDimension(tensDim);
     m_EigenAnalyzer.SetOrder(tensDim);
     m_EigVals.set_size(tensDim);
@@ -65,6 +86,16 @@ LogEuclideanTensorCalculator <TScalarType>
 {
     unsigned int tensDim = log_tensor.rows();
 
+    if (tensDim == 3)
+    {
+        double tensorValues[6];
+        anima::GetPackedTensor3D(log_tensor,tensorValues);
+        anima::GetTensorExponential3D(tensorValues,tensorValues,1);
+        tensor.set_size(3,3);
+        anima::GetTensorFromPacked3D(tensorValues,tensor);
+        return;
+    }
+
     m_EigenAnalyzer.SetDimension(tensDim);
     m_EigenAnalyzer.SetOrder(tensDim);
     m_EigVals.set_size(tensDim);
@@ -132,11 +163,82 @@ GetTensorFromVectorRepresentation(const itk::VariableLengthVector <T1> &vector,
         }
 }
 
+template <class T1, class T2, unsigned int NVectorDimension>
+void
+GetVectorRepresentation(const vnl_matrix <T1> &tensor, itk::Vector <T2,NVectorDimension> &vector,
+                        unsigned int vecDim, bool scale)
+{
+    unsigned int dim = tensor.rows();
+    if ((vecDim != 0) && (vecDim != NVectorDimension))
+        throw itk::ExceptionObject(__FILE__, __LINE__,"Fixed length vector representation of the wrong size",ITK_LOCATION);
+
+    if (dim * (dim + 1) / 2 != NVectorDimension)
+        throw itk::ExceptionObject(__FILE__, __LINE__,"Tensor dimension does not match fixed length vector representation",ITK_LOCATION);
+
+    double sqrt2 = std::sqrt(2.0);
+
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < dim;++i)
+        for (unsigned int j = 0;j <= i;++j)
+        {
+            vector[pos] = tensor(i,j);
+            if ((i != j)&&scale)
+                vector[pos] *= sqrt2;
+            ++pos;
+        }
+}
+
+template <class T1, class T2, unsigned int NVectorDimension>
+void
+GetTensorFromVectorRepresentation(const itk::Vector <T1,NVectorDimension> &vector,
+                                  vnl_matrix <T2> &tensor, unsigned int tensDim, bool scale)
+{
+    if (tensDim == 0)
+        tensDim = std::floor((std::sqrt((double)(8 * NVectorDimension + 1)) - 1) / 2.0);
+
+    double sqrt2 = std::sqrt(2.0);
+    if ((tensor.rows() != tensDim) || (tensor.cols() != tensDim))
+        tensor.set_size(tensDim,tensDim);
+
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < tensDim;++i)
+        for (unsigned int j = 0;j <= i;++j)
+        {
+            tensor(i,j) = vector[pos];
+            if (i != j)
+            {
+                if (scale)
+                    tensor(i,j) /= sqrt2;
+
+                tensor(j,i) = tensor(i,j);
+            }
+
+            ++pos;
+        }
+}
+
 template <class T> void ProjectOnTensorSpace(const vnl_matrix <T> &matrix, vnl_matrix <T> &tensor)
 {
-    typedef itk::SymmetricEigenAnalysis < vnl_matrix <T>, vnl_diag_matrix<T>, vnl_matrix <T> > EigenAnalysisType;
     unsigned int tensDim = matrix.rows();
 
+    if (tensDim == 3)
+    {
+        double eigVals[3], eigVecs[3][3], tensorValues[6];
+        anima::GetPackedTensor3D(matrix,tensorValues);
+        anima::ComputeTensorEigenSystem3D(tensorValues,eigVals,eigVecs);
+
+        for (unsigned int i = 0;i < 3;++i)
+            eigVals[i] = std::max(eigVals[i],1.0e-16);
+
+        anima::RecomposeTensor3D(eigVals,eigVecs,tensorValues);
+
+        tensor.set_size(3,3);
+        anima::GetTensorFromPacked3D(tensorValues,tensor);
+
+        return;
+    }
+
+    typedef itk::SymmetricEigenAnalysis < vnl_matrix <T>, vnl_diag_matrix<T>, vnl_matrix <T> > EigenAnalysisType;
     EigenAnalysisType eigen(tensDim);
     vnl_matrix <T> eigVecs(tensDim,tensDim);
     vnl_diag_matrix <T> eigVals(tensDim);
@@ -173,18 +275,28 @@ ExtractRotationFromJacobianMatrix(vnl_matrix <RealType> &jacobianMatrix, vnl_mat
                 tmpMat.put(m,l,tmpVal);
         }
 
-    itk::SymmetricEigenAnalysis < vnl_matrix <RealType>, vnl_diag_matrix<RealType>, vnl_matrix <RealType> > eigenComputer(tensorDimension);
-    vnl_matrix <RealType> eVec(tensorDimension,tensorDimension);
-    vnl_diag_matrix <RealType> eVals(tensorDimension);
-
-    eigenComputer.ComputeEigenValuesAndVectors(tmpMat, eVals, eVec);
+    // Rotation is (J J^T)^{-1/2} J
+    double eVals[3], eVecs[3][3], invSqrtValues[6];
+    anima::GetPackedTensor3D(tmpMat,invSqrtValues);
+    anima::ComputeTensorEigenSystem3D(invSqrtValues, eVals, eVecs);
 
     for (unsigned int i = 0;i < tensorDimension;++i)
         eVals[i] = std::pow(eVals[i], -0.5);
 
-    RecomposeTensor(eVals,eVec,rotationMatrix);
+    anima::RecomposeTensor3D(eVals,eVecs,invSqrtValues);
+
+    anima::GetTensorFromPacked3D(invSqrtValues,tmpMat);
 
-    rotationMatrix *= jacobianMatrix;
+    rotationMatrix.set_size(tensorDimension,tensorDimension);
+    for (unsigned int i = 0;i < tensorDimension;++i)
+        for (unsigned int j = 0;j < tensorDimension;++j)
+        {
+            double rotVal = 0.0;
+            for (unsigned int k = 0;k < tensorDimension;++k)
+                rotVal += tmpMat.get(i,k) * jacobianMatrix.get(k,j);
+
+            rotationMatrix.put(i,j,rotVal);
+        }
 }
 
 template <typename RealType, typename MatrixType>
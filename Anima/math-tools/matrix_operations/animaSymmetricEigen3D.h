@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+
+namespace anima
+{
+/* Fixed size 3x3 symmetric eigen-decomposition and tensor functions, with no heap allocation.
+ * Tensors are stored as their 6 lower triangular values (xx, yx, yy, zx, zy, zz), i.e. the order of GetVectorRepresentation.
+ * Eigenvalues are sorted in ascending order and eigenvectors are stored as rows, as with itk::SymmetricEigenAnalysis. */
+
+//! Analytic eigen-decomposition (trigonometric Cardano eigenvalues, robust eigenvectors), falls back to Jacobi sweeps if inaccurate
+template <class T> void ComputeTensorEigenSystem3D(const T *tensor, double eigenValues[3], double eigenVectors[3][3]);
+
+//! Analytic eigenvalues only
+template <class T> void ComputeTensorEigenValues3D(const T *tensor, double eigenValues[3]);
+
+//! Eigen-decomposition of a 3x3 symmetric matrix (vnl_matrix, vnl_matrix_fixed, itk::Matrix), outputs have to be already sized
+template <class MatrixType, class EigenValuesType, class EigenVectorsType>
+void ComputeSymmetricEigenSystem3D(const MatrixType &matrix, EigenValuesType &eigenValues, EigenVectorsType &eigenVectors);
+
+//! Eigenvalues of a 3x3 symmetric matrix, output has to be already sized
+template <class MatrixType, class EigenValuesType>
+void ComputeSymmetricEigenValues3D(const MatrixType &matrix, EigenValuesType &eigenValues);
+
+//! Packs the lower triangular part of a 3x3 symmetric matrix into 6 values
+template <class MatrixType, class T> void GetPackedTensor3D(const MatrixType &matrix, T *tensor);
+
+//! Unpacks 6 tensor values into a 3x3 symmetric matrix, which has to be already sized
+template <class T, class MatrixType> void GetTensorFromPacked3D(const T *tensor, MatrixType &matrix);
+
+//! Recompose a tensor (as 6 values) from its eigen-decomposition
+template <class T> void RecomposeTensor3D(const double eigenValues[3], const double eigenVectors[3][3], T *tensor);
+
+/** @brief Batched tensor logarithm. Input and output may be the same array.
+ * @param scaleNonDiagonal multiplies off-diagonal output values by sqrt(2)
+ * @param keepNullTensors null input tensors are left null instead of being processed
+ */
+template <class TInput, class TOutput>
+void GetTensorLogarithm3D(const TInput *tensors, TOutput *logTensors, std::size_t numberOfTensors,
+                          bool scaleNonDiagonal = false, bool keepNullTensors = false);
+
+/** @brief Batched tensor exponential. Input and output may be the same array.
+ * @param scaleNonDiagonal divides off-diagonal input values by sqrt(2)
+ * @param keepNullTensors null input tensors are left null instead of being mapped to identity
+ */
+template <class TInput, class TOutput>
+void GetTensorExponential3D(const TInput *logTensors, TOutput *tensors, std::size_t numberOfTensors,
+                            bool scaleNonDiagonal = false, bool keepNullTensors = false);
+
+//! Batched tensor power. Input and output may be the same array.
+template <class TInput, class TOutput>
+void GetTensorPower3D(const TInput *tensors, TOutput *outputTensors, std::size_t numberOfTensors, double powerValue);
+
+} // end of namespace anima
+
+#include "animaSymmetricEigen3D.hxx"
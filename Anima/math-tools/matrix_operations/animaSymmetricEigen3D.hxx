@@ -0,0 +1,544 @@
+#pragma once
+
+#include "animaSymmetricEigen3D.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace anima
+{
+
+inline void CrossProduct3D(const double a[3], const double b[3], double c[3])
+{
+    c[0] = a[1] * b[2] - a[2] * b[1];
+    c[1] = a[2] * b[0] - a[0] * b[2];
+    c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+//! Product of a packed symmetric matrix with a vector
+inline void SymmetricProduct3D(const double a[6], const double v[3], double result[3])
+{
+    result[0] = a[0] * v[0] + a[1] * v[1] + a[3] * v[2];
+    result[1] = a[1] * v[0] + a[2] * v[1] + a[4] * v[2];
+    result[2] = a[3] * v[0] + a[4] * v[1] + a[5] * v[2];
+}
+
+//! Computes unit vectors u, v such that (u, v, w) is an orthonormal basis, w being a unit vector
+inline void ComputeOrthogonalComplement3D(const double w[3], double u[3], double v[3])
+{
+    if (std::abs(w[0]) > std::abs(w[1]))
+    {
+        double invLength = 1.0 / std::sqrt(w[0] * w[0] + w[2] * w[2]);
+        u[0] = - w[2] * invLength;
+        u[1] = 0;
+        u[2] = w[0] * invLength;
+    }
+    else
+    {
+        double invLength = 1.0 / std::sqrt(w[1] * w[1] + w[2] * w[2]);
+        u[0] = 0;
+        u[1] = w[2] * invLength;
+        u[2] = - w[1] * invLength;
+    }
+
+    CrossProduct3D(w,u,v);
+}
+
+//! Eigenvector of a simple eigenvalue, from the largest cross product of two rows of A - lambda I
+inline bool ComputeSimpleEigenVector3D(const double a[6], double eigenValue, double eigenVector[3])
+{
+    double row0[3] = {a[0] - eigenValue, a[1], a[3]};
+    double row1[3] = {a[1], a[2] - eigenValue, a[4]};
+    double row2[3] = {a[3], a[4], a[5] - eigenValue};
+
+    double crossProducts[3][3];
+    CrossProduct3D(row0,row1,crossProducts[0]);
+    CrossProduct3D(row0,row2,crossProducts[1]);
+    CrossProduct3D(row1,row2,crossProducts[2]);
+
+    unsigned int maxIndex = 0;
+    double maxNorm = 0;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        double norm = crossProducts[i][0] * crossProducts[i][0] + crossProducts[i][1] * crossProducts[i][1] +
+                crossProducts[i][2] * crossProducts[i][2];
+
+        if (norm > maxNorm)
+        {
+            maxNorm = norm;
+            maxIndex = i;
+        }
+    }
+
+    if (maxNorm <= 0)
+        return false;
+
+    double invNorm = 1.0 / std::sqrt(maxNorm);
+    for (unsigned int i = 0;i < 3;++i)
+        eigenVector[i] = crossProducts[maxIndex][i] * invNorm;
+
+    return true;
+}
+
+//! Eigenvector of the middle eigenvalue, solved in the plane orthogonal to a known eigenvector (robust to multiplicity)
+inline void ComputeMiddleEigenVector3D(const double a[6], const double firstVector[3], double eigenValue, double eigenVector[3])
+{
+    double u[3], v[3], au[3], av[3];
+    ComputeOrthogonalComplement3D(firstVector,u,v);
+    SymmetricProduct3D(a,u,au);
+    SymmetricProduct3D(a,v,av);
+
+    double m00 = u[0] * au[0] + u[1] * au[1] + u[2] * au[2] - eigenValue;
+    double m01 = u[0] * av[0] + u[1] * av[1] + u[2] * av[2];
+    double m11 = v[0] * av[0] + v[1] * av[1] + v[2] * av[2] - eigenValue;
+
+    double absM00 = std::abs(m00);
+    double absM01 = std::abs(m01);
+    double absM11 = std::abs(m11);
+
+    double uFactor = 1.0;
+    double vFactor = 0.0;
+    if (absM00 >= absM11)
+    {
+        if (std::max(absM00,absM01) > 0)
+        {
+            if (absM00 >= absM01)
+            {
+                m01 /= m00;
+                m00 = 1.0 / std::sqrt(1.0 + m01 * m01);
+                m01 *= m00;
+            }
+            else
+            {
+                m00 /= m01;
+                m01 = 1.0 / std::sqrt(1.0 + m00 * m00);
+                m00 *= m01;
+            }
+
+            uFactor = m01;
+            vFactor = - m00;
+        }
+    }
+    else
+    {
+        if (std::max(absM11,absM01) > 0)
+        {
+            if (absM11 >= absM01)
+            {
+                m01 /= m11;
+                m11 = 1.0 / std::sqrt(1.0 + m01 * m01);
+                m01 *= m11;
+            }
+            else
+            {
+                m11 /= m01;
+                m01 = 1.0 / std::sqrt(1.0 + m11 * m11);
+                m11 *= m01;
+            }
+
+            uFactor = m11;
+            vFactor = - m01;
+        }
+    }
+
+    for (unsigned int i = 0;i < 3;++i)
+        eigenVector[i] = uFactor * u[i] + vFactor * v[i];
+}
+
+//! Fallback cyclic Jacobi eigen-decomposition
+inline void ComputeJacobiEigenSystem3D(const double a[6], double eigenValues[3], double eigenVectors[3][3])
+{
+    double m[3][3] = {{a[0], a[1], a[3]}, {a[1], a[2], a[4]}, {a[3], a[4], a[5]}};
+    double v[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+
+    for (unsigned int sweep = 0;sweep < 50;++sweep)
+    {
+        double offDiagonal = m[0][1] * m[0][1] + m[0][2] * m[0][2] + m[1][2] * m[1][2];
+        double diagonal = m[0][0] * m[0][0] + m[1][1] * m[1][1] + m[2][2] * m[2][2];
+        if (offDiagonal <= 1.0e-32 * diagonal)
+            break;
+
+        for (unsigned int p = 0;p < 2;++p)
+        {
+            for (unsigned int q = p + 1;q < 3;++q)
+            {
+                if (m[p][q] == 0)
+                    continue;
+
+                double theta = (m[q][q] - m[p][p]) / (2.0 * m[p][q]);
+                double t = 1.0 / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                if (theta < 0)
+                    t = - t;
+
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+
+                for (unsigned int k = 0;k < 3;++k)
+                {
+                    double mkp = m[k][p];
+                    double mkq = m[k][q];
+                    m[k][p] = c * mkp - s * mkq;
+                    m[k][q] = s * mkp + c * mkq;
+                }
+
+                for (unsigned int k = 0;k < 3;++k)
+                {
+                    double mpk = m[p][k];
+                    double mqk = m[q][k];
+                    m[p][k] = c * mpk - s * mqk;
+                    m[q][k] = s * mpk + c * mqk;
+                }
+
+                for (unsigned int k = 0;k < 3;++k)
+                {
+                    double vkp = v[k][p];
+                    double vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    unsigned int order[3] = {0, 1, 2};
+    std::sort(order, order + 3, [&m](unsigned int i, unsigned int j){return m[i][i] < m[j][j];});
+
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        eigenValues[i] = m[order[i]][order[i]];
+        for (unsigned int j = 0;j < 3;++j)
+            eigenVectors[i][j] = v[j][order[i]];
+    }
+}
+
+//! Shared part of the analytic solver: scales the matrix, returns false if it is diagonal (then eigenvalues are set, unsorted)
+inline bool ComputeScaledEigenValues3D(double a[6], double &scale, double eigenValues[3], double &halfDeterminant)
+{
+    scale = 0;
+    for (unsigned int i = 0;i < 6;++i)
+        scale = std::max(scale,std::abs(a[i]));
+
+    if (scale > 0)
+    {
+        for (unsigned int i = 0;i < 6;++i)
+            a[i] /= scale;
+    }
+
+    double offDiagonal = a[1] * a[1] + a[3] * a[3] + a[4] * a[4];
+    if ((scale == 0)||(offDiagonal == 0))
+    {
+        eigenValues[0] = a[0];
+        eigenValues[1] = a[2];
+        eigenValues[2] = a[5];
+        return false;
+    }
+
+    double q = (a[0] + a[2] + a[5]) / 3.0;
+    double b00 = a[0] - q;
+    double b11 = a[2] - q;
+    double b22 = a[5] - q;
+    double p = std::sqrt((b00 * b00 + b11 * b11 + b22 * b22 + 2.0 * offDiagonal) / 6.0);
+
+    double c00 = b11 * b22 - a[4] * a[4];
+    double c01 = a[1] * b22 - a[4] * a[3];
+    double c02 = a[1] * a[4] - b11 * a[3];
+    halfDeterminant = (b00 * c00 - a[1] * c01 + a[3] * c02) / (2.0 * p * p * p);
+    halfDeterminant = std::min(std::max(halfDeterminant,-1.0),1.0);
+
+    double angle = std::acos(halfDeterminant) / 3.0;
+    const double twoThirdsPi = 2.09439510239319549;
+    double beta2 = 2.0 * std::cos(angle);
+    double beta0 = 2.0 * std::cos(angle + twoThirdsPi);
+    double beta1 = - (beta0 + beta2);
+
+    eigenValues[0] = q + p * beta0;
+    eigenValues[1] = q + p * beta1;
+    eigenValues[2] = q + p * beta2;
+
+    return true;
+}
+
+template <class T>
+void ComputeTensorEigenSystem3D(const T *tensor, double eigenValues[3], double eigenVectors[3][3])
+{
+    double a[6];
+    for (unsigned int i = 0;i < 6;++i)
+        a[i] = tensor[i];
+
+    double scale, halfDeterminant = 0;
+    if (!ComputeScaledEigenValues3D(a,scale,eigenValues,halfDeterminant))
+    {
+        unsigned int order[3] = {0, 1, 2};
+        std::sort(order, order + 3, [eigenValues](unsigned int i, unsigned int j){return eigenValues[i] < eigenValues[j];});
+
+        double diagonalValues[3] = {eigenValues[0], eigenValues[1], eigenValues[2]};
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            eigenValues[i] = diagonalValues[order[i]] * scale;
+            for (unsigned int j = 0;j < 3;++j)
+                eigenVectors[i][j] = (j == order[i]);
+        }
+
+        return;
+    }
+
+    // The eigenvalue furthest from the middle one is simple, its vector is computed first
+    bool analyticSuccess;
+    if (halfDeterminant >= 0)
+    {
+        analyticSuccess = ComputeSimpleEigenVector3D(a,eigenValues[2],eigenVectors[2]);
+        if (analyticSuccess)
+        {
+            ComputeMiddleEigenVector3D(a,eigenVectors[2],eigenValues[1],eigenVectors[1]);
+            CrossProduct3D(eigenVectors[1],eigenVectors[2],eigenVectors[0]);
+        }
+    }
+    else
+    {
+        analyticSuccess = ComputeSimpleEigenVector3D(a,eigenValues[0],eigenVectors[0]);
+        if (analyticSuccess)
+        {
+            ComputeMiddleEigenVector3D(a,eigenVectors[0],eigenValues[1],eigenVectors[1]);
+            CrossProduct3D(eigenVectors[0],eigenVectors[1],eigenVectors[2]);
+        }
+    }
+
+    // Residual check on the scaled matrix, relative to its Frobenius norm: Jacobi fallback if precision was lost
+    double matrixNorm = std::sqrt(a[0] * a[0] + a[2] * a[2] + a[5] * a[5] + 2.0 * (a[1] * a[1] + a[3] * a[3] + a[4] * a[4]));
+    double residualTolerance = 64.0 * std::numeric_limits <double>::epsilon() * matrixNorm;
+    double refinedEigenValues[3];
+    for (unsigned int i = 0;(i < 3) && analyticSuccess;++i)
+    {
+        double product[3];
+        SymmetricProduct3D(a,eigenVectors[i],product);
+
+        double residual = 0;
+        refinedEigenValues[i] = 0;
+        for (unsigned int j = 0;j < 3;++j)
+        {
+            residual += (product[j] - eigenValues[i] * eigenVectors[i][j]) * (product[j] - eigenValues[i] * eigenVectors[i][j]);
+            refinedEigenValues[i] += product[j] * eigenVectors[i][j];
+        }
+
+        analyticSuccess = (std::sqrt(residual) <= residualTolerance);
+    }
+
+    if (analyticSuccess)
+    {
+        // Rayleigh quotients are more accurate than the trigonometric formula close to multiple eigenvalues
+        for (unsigned int i = 0;i < 3;++i)
+            eigenValues[i] = refinedEigenValues[i];
+
+        for (unsigned int i = 1;i < 3;++i)
+        {
+            for (unsigned int j = i;(j > 0) && (eigenValues[j] < eigenValues[j - 1]);--j)
+            {
+                std::swap(eigenValues[j],eigenValues[j - 1]);
+                for (unsigned int k = 0;k < 3;++k)
+                    std::swap(eigenVectors[j][k],eigenVectors[j - 1][k]);
+            }
+        }
+    }
+    else
+        ComputeJacobiEigenSystem3D(a,eigenValues,eigenVectors);
+
+    for (unsigned int i = 0;i < 3;++i)
+        eigenValues[i] *= scale;
+}
+
+template <class T>
+void ComputeTensorEigenValues3D(const T *tensor, double eigenValues[3])
+{
+    double a[6];
+    for (unsigned int i = 0;i < 6;++i)
+        a[i] = tensor[i];
+
+    double scale, halfDeterminant = 0;
+    if (!ComputeScaledEigenValues3D(a,scale,eigenValues,halfDeterminant))
+        std::sort(eigenValues, eigenValues + 3);
+
+    for (unsigned int i = 0;i < 3;++i)
+        eigenValues[i] *= scale;
+}
+
+template <class MatrixType, class T>
+void GetPackedTensor3D(const MatrixType &matrix, T *tensor)
+{
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < 3;++i)
+        for (unsigned int j = 0;j <= i;++j)
+        {
+            tensor[pos] = matrix(i,j);
+            ++pos;
+        }
+}
+
+template <class T, class MatrixType>
+void GetTensorFromPacked3D(const T *tensor, MatrixType &matrix)
+{
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < 3;++i)
+        for (unsigned int j = 0;j <= i;++j)
+        {
+            matrix(i,j) = tensor[pos];
+            matrix(j,i) = tensor[pos];
+            ++pos;
+        }
+}
+
+template <class MatrixType, class EigenValuesType, class EigenVectorsType>
+void ComputeSymmetricEigenSystem3D(const MatrixType &matrix, EigenValuesType &eigenValues, EigenVectorsType &eigenVectors)
+{
+    double tensor[6], eigVals[3], eigVecs[3][3];
+    anima::GetPackedTensor3D(matrix,tensor);
+
+    ComputeTensorEigenSystem3D(tensor,eigVals,eigVecs);
+
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        eigenValues[i] = eigVals[i];
+        for (unsigned int j = 0;j < 3;++j)
+            eigenVectors(i,j) = eigVecs[i][j];
+    }
+}
+
+template <class MatrixType, class EigenValuesType>
+void ComputeSymmetricEigenValues3D(const MatrixType &matrix, EigenValuesType &eigenValues)
+{
+    double tensor[6], eigVals[3];
+    anima::GetPackedTensor3D(matrix,tensor);
+
+    ComputeTensorEigenValues3D(tensor,eigVals);
+
+    for (unsigned int i = 0;i < 3;++i)
+        eigenValues[i] = eigVals[i];
+}
+
+template <class T>
+void RecomposeTensor3D(const double eigenValues[3], const double eigenVectors[3][3], T *tensor)
+{
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        for (unsigned int j = 0;j <= i;++j)
+        {
+            double resVal = 0.0;
+            for (unsigned int k = 0;k < 3;++k)
+                resVal += eigenValues[k] * eigenVectors[k][i] * eigenVectors[k][j];
+
+            tensor[pos] = resVal;
+            ++pos;
+        }
+    }
+}
+
+template <class TInput, class TOutput>
+void GetTensorLogarithm3D(const TInput *tensors, TOutput *logTensors, std::size_t numberOfTensors,
+                          bool scaleNonDiagonal, bool keepNullTensors)
+{
+    const double sqrt2 = std::sqrt(2.0);
+    double tensor[6], eigenValues[3], eigenVectors[3][3];
+
+    for (std::size_t n = 0;n < numberOfTensors;++n)
+    {
+        bool nullTensor = true;
+        for (unsigned int i = 0;i < 6;++i)
+        {
+            tensor[i] = tensors[6 * n + i];
+            nullTensor = nullTensor && (tensor[i] == 0);
+        }
+
+        if (nullTensor && keepNullTensors)
+        {
+            for (unsigned int i = 0;i < 6;++i)
+                logTensors[6 * n + i] = 0;
+
+            continue;
+        }
+
+        ComputeTensorEigenSystem3D(tensor,eigenValues,eigenVectors);
+
+        for (unsigned int i = 0;i < 3;++i)
+            eigenValues[i] = std::log(std::max(eigenValues[i],1.0e-16));
+
+        RecomposeTensor3D(eigenValues,eigenVectors,tensor);
+
+        if (scaleNonDiagonal)
+        {
+            tensor[1] *= sqrt2;
+            tensor[3] *= sqrt2;
+            tensor[4] *= sqrt2;
+        }
+
+        for (unsigned int i = 0;i < 6;++i)
+            logTensors[6 * n + i] = tensor[i];
+    }
+}
+
+template <class TInput, class TOutput>
+void GetTensorExponential3D(const TInput *logTensors, TOutput *tensors, std::size_t numberOfTensors,
+                            bool scaleNonDiagonal, bool keepNullTensors)
+{
+    const double sqrt2 = std::sqrt(2.0);
+    double tensor[6], eigenValues[3], eigenVectors[3][3];
+
+    for (std::size_t n = 0;n < numberOfTensors;++n)
+    {
+        bool nullTensor = true;
+        for (unsigned int i = 0;i < 6;++i)
+        {
+            tensor[i] = logTensors[6 * n + i];
+            nullTensor = nullTensor && (tensor[i] == 0);
+        }
+
+        if (nullTensor && keepNullTensors)
+        {
+            for (unsigned int i = 0;i < 6;++i)
+                tensors[6 * n + i] = 0;
+
+            continue;
+        }
+
+        if (scaleNonDiagonal)
+        {
+            tensor[1] /= sqrt2;
+            tensor[3] /= sqrt2;
+            tensor[4] /= sqrt2;
+        }
+
+        ComputeTensorEigenSystem3D(tensor,eigenValues,eigenVectors);
+
+        for (unsigned int i = 0;i < 3;++i)
+            eigenValues[i] = std::exp(eigenValues[i]);
+
+        RecomposeTensor3D(eigenValues,eigenVectors,tensor);
+
+        for (unsigned int i = 0;i < 6;++i)
+            tensors[6 * n + i] = tensor[i];
+    }
+}
+
+template <class TInput, class TOutput>
+void GetTensorPower3D(const TInput *tensors, TOutput *outputTensors, std::size_t numberOfTensors, double powerValue)
+{
+    double tensor[6], eigenValues[3], eigenVectors[3][3];
+
+    for (std::size_t n = 0;n < numberOfTensors;++n)
+    {
+        for (unsigned int i = 0;i < 6;++i)
+            tensor[i] = tensors[6 * n + i];
+
+        ComputeTensorEigenSystem3D(tensor,eigenValues,eigenVectors);
+
+        for (unsigned int i = 0;i < 3;++i)
+            eigenValues[i] = std::pow(std::max(eigenValues[i],1.0e-16),powerValue);
+
+        RecomposeTensor3D(eigenValues,eigenVectors,tensor);
+
+        for (unsigned int i = 0;i < 6;++i)
+            outputTensors[6 * n + i] = tensor[i];
+    }
+}
+
+} // end of namespace anima
@@ -0,0 +1,176 @@
+#include <animaSymmetricEigen3D.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+
+//! Tensor (6 values) with known eigenvalues, rotated by a random unit quaternion
+void GenerateTensor(const double eigenValues[3], std::mt19937 &generator, double tensor[6])
+{
+    std::normal_distribution <double> normalDistribution(0.0,1.0);
+    double quaternion[4];
+    double norm = 0;
+    for (unsigned int i = 0;i < 4;++i)
+    {
+        quaternion[i] = normalDistribution(generator);
+        norm += quaternion[i] * quaternion[i];
+    }
+
+    norm = std::sqrt(norm);
+    double w = quaternion[0] / norm, x = quaternion[1] / norm, y = quaternion[2] / norm, z = quaternion[3] / norm;
+    double rotation[3][3] = {{1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y - w * z), 2.0 * (x * z + w * y)},
+                             {2.0 * (x * y + w * z), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z - w * x)},
+                             {2.0 * (x * z - w * y), 2.0 * (y * z + w * x), 1.0 - 2.0 * (x * x + y * y)}};
+
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        for (unsigned int j = 0;j <= i;++j)
+        {
+            tensor[pos] = 0;
+            for (unsigned int k = 0;k < 3;++k)
+                tensor[pos] += rotation[i][k] * eigenValues[k] * rotation[j][k];
+
+            ++pos;
+        }
+    }
+}
+
+//! Checks eigenvalues against expected ones, eigenpair residuals and orthonormality, all relative to the matrix norm
+bool CheckEigenSystem(const double tensor[6], const double expectedEigenValues[3], double &maxError)
+{
+    double eigenValues[3], eigenVectors[3][3];
+    anima::ComputeTensorEigenSystem3D(tensor,eigenValues,eigenVectors);
+
+    double sortedExpected[3] = {expectedEigenValues[0], expectedEigenValues[1], expectedEigenValues[2]};
+    std::sort(sortedExpected,sortedExpected + 3);
+
+    double matrixNorm = 0;
+    for (unsigned int i = 0;i < 3;++i)
+        matrixNorm = std::max(matrixNorm,std::abs(sortedExpected[i]));
+
+    if (matrixNorm == 0)
+        matrixNorm = 1;
+
+    double error = 0;
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        error = std::max(error,std::abs(eigenValues[i] - sortedExpected[i]) / matrixNorm);
+
+        double product[3];
+        anima::SymmetricProduct3D(tensor,eigenVectors[i],product);
+        double residual = 0;
+        for (unsigned int j = 0;j < 3;++j)
+            residual += (product[j] - eigenValues[i] * eigenVectors[i][j]) * (product[j] - eigenValues[i] * eigenVectors[i][j]);
+
+        error = std::max(error,std::sqrt(residual) / matrixNorm);
+
+        for (unsigned int j = 0;j <= i;++j)
+        {
+            double dotProduct = 0;
+            for (unsigned int k = 0;k < 3;++k)
+                dotProduct += eigenVectors[i][k] * eigenVectors[j][k];
+
+            error = std::max(error,std::abs(dotProduct - (i == j)));
+        }
+    }
+
+    maxError = std::max(maxError,error);
+    return (error < 1.0e-12);
+}
+
+bool ReportTest(const std::string &testName, unsigned int numFailures, unsigned int numTests, double maxError)
+{
+    bool success = (numFailures == 0);
+    std::cout << testName << ": " << numFailures << " failures out of " << numTests << ", max relative error "
+              << maxError << (success ? " -> OK" : " -> FAILED") << std::endl;
+
+    return success;
+}
+
+int main()
+{
+    unsigned int numTests = 100000;
+    std::mt19937 generator(0);
+    std::uniform_real_distribution <double> uniformDistribution(0.0,1.0);
+    double tensor[6], expectedEigenValues[3];
+    bool success = true;
+
+    // Random tensors: positive diffusion-like eigenvalues, then signed eigenvalues spanning several orders of magnitude
+    unsigned int numFailures = 0;
+    double maxError = 0;
+    for (unsigned int i = 0;i < numTests;++i)
+    {
+        for (unsigned int j = 0;j < 3;++j)
+        {
+            if (i < numTests / 2)
+                expectedEigenValues[j] = 1.0e-4 + 3.0e-3 * uniformDistribution(generator);
+            else
+                expectedEigenValues[j] = (2.0 * uniformDistribution(generator) - 1.0) * std::pow(10.0,8.0 * uniformDistribution(generator) - 4.0);
+        }
+
+        GenerateTensor(expectedEigenValues,generator,tensor);
+        numFailures += !CheckEigenSystem(tensor,expectedEigenValues,maxError);
+    }
+
+    success &= ReportTest("Random tensors",numFailures,numTests,maxError);
+
+    // Near-degenerate tensors: two (or three) eigenvalues separated by relative gaps from 1e-3 down to 1e-15, and exact multiplicities
+    numFailures = 0;
+    maxError = 0;
+    for (unsigned int i = 0;i < numTests;++i)
+    {
+        double baseValue = 1.0e-4 + 3.0e-3 * uniformDistribution(generator);
+        double gap = (i % 10 == 0) ? 0.0 : std::pow(10.0,- 3.0 - 12.0 * uniformDistribution(generator));
+        double otherValue = 1.0e-4 + 3.0e-3 * uniformDistribution(generator);
+
+        expectedEigenValues[0] = baseValue;
+        expectedEigenValues[1] = baseValue * (1.0 + gap);
+        if (i % 3 == 0)
+            expectedEigenValues[2] = baseValue * (1.0 - gap);
+        else
+            expectedEigenValues[2] = otherValue;
+
+        GenerateTensor(expectedEigenValues,generator,tensor);
+        numFailures += !CheckEigenSystem(tensor,expectedEigenValues,maxError);
+    }
+
+    success &= ReportTest("Near-degenerate tensors",numFailures,numTests,maxError);
+
+    // Diagonal tensors, with repeated and null values, and diagonal tensors with a tiny off-diagonal perturbation
+    numFailures = 0;
+    maxError = 0;
+    unsigned int numDiagonalTests = 0;
+    for (unsigned int i = 0;i < numTests / 10;++i)
+    {
+        for (unsigned int j = 0;j < 3;++j)
+            expectedEigenValues[j] = (i % 4 == 0) ? 0.0 : 1.0e-4 + 3.0e-3 * uniformDistribution(generator);
+
+        if (i % 5 == 0)
+            expectedEigenValues[1] = expectedEigenValues[0];
+
+        tensor[0] = expectedEigenValues[0];
+        tensor[2] = expectedEigenValues[1];
+        tensor[5] = expectedEigenValues[2];
+        tensor[1] = tensor[3] = tensor[4] = 0;
+
+        numFailures += !CheckEigenSystem(tensor,expectedEigenValues,maxError);
+        ++numDiagonalTests;
+
+        // Perturbation below double precision of the diagonal: eigenvalues are unchanged
+        tensor[4] = std::numeric_limits <double>::epsilon() * 1.0e-6 * tensor[5];
+        if (tensor[4] != 0)
+        {
+            numFailures += !CheckEigenSystem(tensor,expectedEigenValues,maxError);
+            ++numDiagonalTests;
+        }
+    }
+
+    success &= ReportTest("Diagonal tensors",numFailures,numDiagonalTests,maxError);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -25,6 +25,8 @@ public:
     typedef typename OutputImageType::Pointer OutputImagePointer;
     typedef itk::VectorImage <PixelType, ImageDimension> BaseInputImageType;
     typedef typename BaseInputImageType::Pointer BaseInputImagePointer;
+    typedef typename BaseInputImageType::RegionType RegionType;
+    typedef typename BaseInputImageType::IndexType IndexType;
 
     MCMFileReader();
     ~MCMFileReader();
@@ -32,12 +34,22 @@ public:
     OutputImagePointer &GetModelVectorImage() {return m_OutputImage;}
     void SetFileName(std::string fileName) {m_FileName = fileName;}
 
+    //! Reads only a sub-region of the MCM image, output is then re-indexed to start at 0
+    void SetRegionOfInterest(const RegionType &roi) {m_RegionOfInterest = roi; m_UseRegionOfInterest = true;}
+
+    //! Number of slabs in which each compartment file is streamed into the output (if the file format allows it)
+    void SetNumberOfSlabs(unsigned int num) {m_NumberOfSlabs = num;}
+
     void Update();
     virtual anima::BaseCompartment::Pointer CreateCompartmentForType(std::string &compartmentType);
 
 private:
     OutputImagePointer m_OutputImage;
     std::string m_FileName;
+
+    RegionType m_RegionOfInterest;
+    bool m_UseRegionOfInterest;
+    unsigned int m_NumberOfSlabs;
 };
 
 } // end namespace anima
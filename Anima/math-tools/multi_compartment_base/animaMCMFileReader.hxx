@@ -12,9 +12,13 @@
 #include <animaTensorCompartment.h>
 #include <animaNODDICompartment.h>
 
-#include <itkImageRegionIterator.h>
+#include <itkImageFileReader.h>
+#include <itkImageScanlineConstIterator.h>
+#include <itkMultiThreaderBase.h>
 #include <tinyxml2.h>
 
+#include <algorithm>
+
 namespace anima
 {
 
@@ -23,6 +27,8 @@ MCMFileReader <PixelType, ImageDimension>
 ::MCMFileReader()
 {
     m_FileName = "";
+    m_UseRegionOfInterest = false;
+    m_NumberOfSlabs = 8;
 }
 
 template <class PixelType, unsigned int ImageDimension>
@@ -85,87 +91,221 @@ MCMFileReader <PixelType, ImageDimension>
     std::string weightsFileName = basePath + baseName + "/";
     weightsFileName += weightsNode->GetText();
     
-    BaseInputImagePointer weightsImage = anima::readImage <BaseInputImageType>(weightsFileName);
-    unsigned int numCompartments = weightsImage->GetVectorLength();
-    
     tinyxml2::XMLElement *compartmentNode = modelNode->FirstChildElement( "Compartment" );
     ModelPointer referenceModel = ModelType::New();
     
-    std::vector <BaseInputImagePointer> compartmentImages;
+    std::vector <anima::BaseCompartment::Pointer> compartments;
+    std::vector <std::string> imageFileNames(1,weightsFileName);
     while (compartmentNode)
     {
         tinyxml2::XMLElement *typeNode = compartmentNode->FirstChildElement("Type");
         std::string compartmentType = typeNode->GetText();
         
-        anima::BaseCompartment::Pointer additionalCompartment = this->CreateCompartmentForType(compartmentType);
-        
-        referenceModel->AddCompartment(1.0 / numCompartments,additionalCompartment);
+        compartments.push_back(this->CreateCompartmentForType(compartmentType));
         
         tinyxml2::XMLElement *fileNameNode = compartmentNode->FirstChildElement("FileName");
         std::string imageFileName = basePath + baseName + "/";
         imageFileName += fileNameNode->GetText();
 
-        compartmentImages.push_back(anima::readImage <BaseInputImageType> (imageFileName));
+        imageFileNames.push_back(imageFileName);
 
         compartmentNode = compartmentNode->NextSiblingElement("Compartment");
     }
-    
+
+    unsigned int numCompartments = compartments.size();
+    if (numCompartments == 0)
+    {
+        std::string error("No compartment in ");
+        error += m_FileName;
+        throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
+    }
+
+    for (unsigned int i = 0;i < numCompartments;++i)
+        referenceModel->AddCompartment(1.0 / numCompartments,compartments[i]);
+
+    // Read headers only, to check sizes and set up output geometry
+    unsigned int numFiles = imageFileNames.size();
+    std::vector <unsigned int> startPositions(numFiles);
+    std::vector <unsigned int> componentSizes(numFiles);
+    std::vector <bool> canStreamRead(numFiles);
+
+    typedef itk::ImageFileReader <BaseInputImageType> ReaderType;
+    typename ReaderType::Pointer headerReader = ReaderType::New();
+    headerReader->SetFileName(imageFileNames[0]);
+    headerReader->UpdateOutputInformation();
+    BaseInputImagePointer geometryImage = headerReader->GetOutput();
+
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < numFiles;++i)
+    {
+        itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(imageFileNames[i].c_str(),
+                                                                               itk::IOFileModeEnum::ReadMode);
+
+        if (!imageIO)
+        {
+            std::string error("Unable to read MCM file ");
+            error += imageFileNames[i];
+            throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
+        }
+
+        imageIO->SetFileName(imageFileNames[i].c_str());
+        imageIO->ReadImageInformation();
+
+        unsigned int expectedSize = (i == 0) ? numCompartments : compartments[i - 1]->GetCompartmentSize();
+        if (imageIO->GetNumberOfComponents() != expectedSize)
+        {
+            std::string error("Unexpected number of components in MCM file ");
+            error += imageFileNames[i];
+            throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
+        }
+
+        for (unsigned int j = 0;j < ImageDimension;++j)
+        {
+            if (imageIO->GetDimensions(j) != geometryImage->GetLargestPossibleRegion().GetSize()[j])
+            {
+                std::string error("Image size differs from weights image in MCM file ");
+                error += imageFileNames[i];
+                throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
+            }
+        }
+
+        startPositions[i] = pos;
+        componentSizes[i] = expectedSize;
+        canStreamRead[i] = imageIO->CanStreamRead();
+        pos += expectedSize;
+    }
+
+    // Output region, cropped to the region of interest if any, re-indexed to start at 0
+    RegionType inputRegion = geometryImage->GetLargestPossibleRegion();
+    if (m_UseRegionOfInterest)
+    {
+        RegionType roi = m_RegionOfInterest;
+        if (!roi.Crop(inputRegion))
+            throw itk::ExceptionObject(__FILE__, __LINE__,"Region of interest outside of MCM image",ITK_LOCATION);
+
+        inputRegion = roi;
+    }
+
+    typename BaseInputImageType::PointType outputOrigin;
+    geometryImage->TransformIndexToPhysicalPoint(inputRegion.GetIndex(),outputOrigin);
+
+    RegionType outputRegion;
+    outputRegion.SetSize(inputRegion.GetSize());
+
     unsigned int vectorFinalSize = referenceModel->GetSize();
     m_OutputImage = OutputImageType::New();
     m_OutputImage->Initialize();
-    m_OutputImage->CopyInformation(compartmentImages[0]);
-    m_OutputImage->SetRegions(compartmentImages[0]->GetLargestPossibleRegion());
+    m_OutputImage->SetOrigin(outputOrigin);
+    m_OutputImage->SetSpacing(geometryImage->GetSpacing());
+    m_OutputImage->SetDirection(geometryImage->GetDirection());
+    m_OutputImage->SetRegions(outputRegion);
     m_OutputImage->SetNumberOfComponentsPerPixel(vectorFinalSize);
     m_OutputImage->Allocate();
     m_OutputImage->SetDescriptionModel(referenceModel);
-    
-    typedef itk::ImageRegionIterator <BaseInputImageType> InputImageIteratorType;
-    typedef itk::ImageRegionIterator <OutputImageType> OutputImageIteratorType;
 
-    std::vector <InputImageIteratorType> inputIterators(numCompartments);
-    for (unsigned int i = 0;i < numCompartments;++i)
-        inputIterators[i] = InputImageIteratorType(compartmentImages[i],m_OutputImage->GetLargestPossibleRegion());
-    
-    InputImageIteratorType weightsIterator(weightsImage,m_OutputImage->GetLargestPossibleRegion());
-    OutputImageIteratorType outItr(m_OutputImage,m_OutputImage->GetLargestPossibleRegion());
+    // Files are read one after the other, each reader being released before the next one: only one file, or one
+    // slab of it for formats that can stream read, is in memory at a time besides the interleaved output buffer
+    PixelType *outputBuffer = m_OutputImage->GetBufferPointer();
+    for (unsigned int i = 0;i < numFiles;++i)
+    {
+        try
+        {
+            typename ReaderType::Pointer reader = ReaderType::New();
+            reader->SetFileName(imageFileNames[i]);
 
-    typedef typename OutputImageType::PixelType ImagePixelType;
-    ImagePixelType outValue(vectorFinalSize);
-    ImagePixelType weightsData(vectorFinalSize);
+            unsigned int lastDimSize = inputRegion.GetSize()[ImageDimension - 1];
+            unsigned int numSlabs = canStreamRead[i] ? std::min(std::max(m_NumberOfSlabs,1U),lastDimSize) : 1;
 
-    ImagePixelType inputCompartmentValue;
-    ModelType::ModelOutputVectorType inputMCMValue;
-    ModelType::ListType weightsVector(numCompartments);
+            for (unsigned int k = 0;k < numSlabs;++k)
+            {
+                RegionType slabRegion = inputRegion;
+                unsigned int slabStart = k * lastDimSize / numSlabs;
+                unsigned int slabEnd = (k + 1) * lastDimSize / numSlabs;
+                slabRegion.SetIndex(ImageDimension - 1,inputRegion.GetIndex()[ImageDimension - 1] + slabStart);
+                slabRegion.SetSize(ImageDimension - 1,slabEnd - slabStart);
 
-    while (!outItr.IsAtEnd())
-    {
-        weightsData = weightsIterator.Get();
-        for (unsigned int i = 0;i < numCompartments;++i)
-            weightsVector[i] = weightsData[i];
+                reader->GetOutput()->SetRequestedRegion(slabRegion);
+                reader->Update();
 
-        referenceModel->SetCompartmentWeights(weightsVector);
+                BaseInputImageType *slabImage = reader->GetOutput();
+                const PixelType *slabBuffer = slabImage->GetBufferPointer();
+                unsigned int componentSize = componentSizes[i];
+                unsigned int startPosition = startPositions[i];
 
-        for (unsigned int i = 0;i < numCompartments;++i)
-        {
-            inputCompartmentValue = inputIterators[i].Get();
-            unsigned int compartmentSize = inputCompartmentValue.GetSize();
+                itk::ImageScanlineConstIterator <BaseInputImageType> slabItr(slabImage,slabRegion);
+                while (!slabItr.IsAtEnd())
+                {
+                    IndexType inputIndex = slabItr.GetIndex();
+                    IndexType outputIndex;
+                    for (unsigned int j = 0;j < ImageDimension;++j)
+                        outputIndex[j] = inputIndex[j] - inputRegion.GetIndex()[j];
+
+                    const PixelType *inputPointer = slabBuffer + slabImage->ComputeOffset(inputIndex) * componentSize;
+                    PixelType *outputPointer = outputBuffer + m_OutputImage->ComputeOffset(outputIndex) * vectorFinalSize + startPosition;
 
-            if (inputMCMValue.GetSize() != compartmentSize)
-                inputMCMValue.SetSize(compartmentSize);
-            for (unsigned int j = 0;j < compartmentSize;++j)
-                inputMCMValue[j] = inputCompartmentValue[j];
+                    unsigned int lineLength = slabRegion.GetSize()[0];
+                    for (unsigned int l = 0;l < lineLength;++l)
+                    {
+                        std::copy(inputPointer,inputPointer + componentSize,outputPointer);
+                        inputPointer += componentSize;
+                        outputPointer += vectorFinalSize;
+                    }
 
-            referenceModel->GetCompartment(i)->SetCompartmentVector(inputMCMValue);
+                    slabItr.NextLine();
+                }
+            }
         }
+        catch (itk::ExceptionObject &e)
+        {
+            std::string error("Unable to read MCM file ");
+            error += imageFileNames[i] + ": " + e.GetDescription();
+            throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
+        }
+    }
 
-        outValue = referenceModel->GetModelVector();
-        outItr.Set(outValue);
+    // In place pass through the model so that values are consistent with compartment constraints,
+    // and zero weight compartments are zeroed
+    itk::SizeValueType numberOfPixels = outputRegion.GetNumberOfPixels();
+    const itk::SizeValueType chunkSize = 4096;
+    itk::SizeValueType numberOfChunks = (numberOfPixels + chunkSize - 1) / chunkSize;
 
-        ++outItr;
-        ++weightsIterator;
-        for (unsigned int i = 0;i < numCompartments;++i)
-            ++inputIterators[i];
-    }
+    itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+    threader->ParallelizeArray(0, numberOfChunks, [&](itk::SizeValueType k)
+    {
+        ModelPointer workModel = referenceModel->Clone();
+        ModelType::ModelOutputVectorType modelVector(vectorFinalSize);
+
+        itk::SizeValueType chunkEnd = std::min((k + 1) * chunkSize,numberOfPixels);
+        for (itk::SizeValueType i = k * chunkSize;i < chunkEnd;++i)
+        {
+            PixelType *voxelPointer = outputBuffer + i * vectorFinalSize;
+
+            bool nullVoxel = true;
+            for (unsigned int j = 0;j < numCompartments;++j)
+            {
+                if (voxelPointer[j] != 0)
+                {
+                    nullVoxel = false;
+                    break;
+                }
+            }
+
+            if (nullVoxel)
+            {
+                std::fill(voxelPointer,voxelPointer + vectorFinalSize,0);
+                continue;
+            }
+
+            for (unsigned int j = 0;j < vectorFinalSize;++j)
+                modelVector[j] = voxelPointer[j];
+
+            workModel->SetModelVector(modelVector);
+            const ModelType::ModelOutputVectorType &outputVector = workModel->GetModelVector();
+
+            for (unsigned int j = 0;j < vectorFinalSize;++j)
+                voxelPointer[j] = outputVector[j];
+        }
+    }, nullptr);
 }
 
 template <class PixelType, unsigned int ImageDimension>
@@ -1,7 +1,6 @@
 #pragma once
 #include "animaMCMFileWriter.h"
 
-#include <itkImageRegionIterator.h>
 #include <itkFileTools.h>
 #include <animaReadWriteFunctions.h>
 
@@ -61,54 +60,25 @@ MCMFileWriter <PixelType, ImageDimension>
     outputHeaderFile << "<?xml version=\"1.0\"?>" << std::endl;
     outputHeaderFile << "<Model>" << std::endl;
 
-    // Output weights image
     ModelPointer descriptionModel = m_InputImage->GetDescriptionModel();
-
     unsigned int numberOfCompartments = descriptionModel->GetNumberOfCompartments();
-    BaseOutputImagePointer weightsImage = BaseOutputImageType::New();
-    weightsImage->Initialize();
-    weightsImage->SetRegions(m_InputImage->GetLargestPossibleRegion());
-    weightsImage->SetSpacing (m_InputImage->GetSpacing());
-    weightsImage->SetOrigin (m_InputImage->GetOrigin());
-    weightsImage->SetDirection (m_InputImage->GetDirection());
-    weightsImage->SetVectorLength(numberOfCompartments);
-    weightsImage->Allocate();
-
-    typedef itk::ImageRegionIterator <InputImageType> InputImageIteratorType;
-    typedef itk::ImageRegionIterator <BaseOutputImageType> BaseOutputImageIteratorType;
-    typedef typename InputImageType::PixelType VectorType;
-
-    BaseOutputImageIteratorType weightsItr(weightsImage,m_InputImage->GetLargestPossibleRegion());
-    InputImageIteratorType inputItr(m_InputImage,m_InputImage->GetLargestPossibleRegion());
-
-    VectorType tmpWeights(numberOfCompartments);
-    VectorType workVector;
-    while (!weightsItr.IsAtEnd())
-    {
-        workVector = inputItr.Get();
-
-        for (unsigned int i = 0;i < numberOfCompartments;++i)
-            tmpWeights[i] = workVector[i];
-
-        weightsItr.Set(tmpWeights);
 
-        ++weightsItr;
-        ++inputItr;
-    }
-
-    std::string weightsName = m_FileName + "/";
-    weightsName += noPathName;
-    weightsName += "_weights.nrrd";
+    // Output file names and positions in model vector: weights first, then each compartment
+    std::vector <std::string> outputFileNames(numberOfCompartments + 1);
+    std::vector <unsigned int> outputStartPositions(numberOfCompartments + 1);
+    std::vector <unsigned int> outputSizes(numberOfCompartments + 1);
 
-    anima::writeImage <BaseOutputImageType> (weightsName,weightsImage);
     std::string xmlFileNameWeights = noPathName + "_weights.nrrd";
+    outputFileNames[0] = m_FileName + "/" + xmlFileNameWeights;
+    outputStartPositions[0] = 0;
+    outputSizes[0] = numberOfCompartments;
 
     outputHeaderFile << "<Weights>" << xmlFileNameWeights << "</Weights>" << std::endl;
 
     // Start index is after weights for image data
     unsigned int pos = numberOfCompartments;
 
-    for (unsigned int i = 0;i < descriptionModel->GetNumberOfCompartments();++i)
+    for (unsigned int i = 0;i < numberOfCompartments;++i)
     {
         outputHeaderFile << "<Compartment>" << std::endl;
         switch(descriptionModel->GetCompartment(i)->GetCompartmentType())
@@ -151,38 +121,8 @@ MCMFileWriter <PixelType, ImageDimension>
                 break;
         }
 
-        // Output compartment image
         unsigned int compartmentSize = descriptionModel->GetCompartment(i)->GetCompartmentSize();
 
-        BaseOutputImagePointer compartmentImage = BaseOutputImageType::New();
-        compartmentImage->Initialize();
-        compartmentImage->SetRegions(m_InputImage->GetLargestPossibleRegion());
-        compartmentImage->SetSpacing (m_InputImage->GetSpacing());
-        compartmentImage->SetOrigin (m_InputImage->GetOrigin());
-        compartmentImage->SetDirection (m_InputImage->GetDirection());
-        compartmentImage->SetVectorLength(compartmentSize);
-        compartmentImage->Allocate();
-
-        inputItr.GoToBegin();
-        BaseOutputImageIteratorType compartmentItr(compartmentImage,m_InputImage->GetLargestPossibleRegion());
-
-        VectorType tmpCompartment(compartmentSize);
-        while (!compartmentItr.IsAtEnd())
-        {
-            workVector = inputItr.Get();
-
-            for (unsigned int j = 0;j < compartmentSize;++j)
-                tmpCompartment[j] = workVector[pos + j];
-
-            compartmentItr.Set(tmpCompartment);
-
-            ++compartmentItr;
-            ++inputItr;
-        }
-
-        pos += compartmentSize;
-
-        std::string fullPathCompartmentName = m_FileName + "/";
         std::string compartmentName = noPathName + "_";
 
         char tmpStr[2048];
@@ -190,18 +130,60 @@ MCMFileWriter <PixelType, ImageDimension>
         compartmentName += tmpStr;
         compartmentName += ".nrrd";
 
-        fullPathCompartmentName += compartmentName;
-
-        std::string xmlFileNameCompartment = compartmentName;
+        outputFileNames[i + 1] = m_FileName + "/" + compartmentName;
+        outputStartPositions[i + 1] = pos;
+        outputSizes[i + 1] = compartmentSize;
 
-        anima::writeImage <BaseOutputImageType> (fullPathCompartmentName,compartmentImage);
-        outputHeaderFile << "<FileName>" << xmlFileNameCompartment << "</FileName>" << std::endl;
+        pos += compartmentSize;
 
+        outputHeaderFile << "<FileName>" << compartmentName << "</FileName>" << std::endl;
         outputHeaderFile << "</Compartment>" << std::endl;
     }
 
+    // Extract and write weights and compartment images one after the other, straight from the interleaved input
+    // buffer: only one extracted image is in memory at a time
+    unsigned int inputVectorLength = m_InputImage->GetNumberOfComponentsPerPixel();
+    itk::SizeValueType numberOfPixels = m_InputImage->GetLargestPossibleRegion().GetNumberOfPixels();
+    const PixelType *inputBuffer = m_InputImage->GetBufferPointer();
+
     outputHeaderFile << "</Model>" << std::endl;
     outputHeaderFile.close();
+
+    for (unsigned int k = 0;k <= numberOfCompartments;++k)
+    {
+        BaseOutputImagePointer outputImage = BaseOutputImageType::New();
+        outputImage->Initialize();
+        outputImage->SetRegions(m_InputImage->GetLargestPossibleRegion());
+        outputImage->SetSpacing (m_InputImage->GetSpacing());
+        outputImage->SetOrigin (m_InputImage->GetOrigin());
+        outputImage->SetDirection (m_InputImage->GetDirection());
+        outputImage->SetVectorLength(outputSizes[k]);
+        outputImage->Allocate();
+
+        PixelType *outputBuffer = outputImage->GetBufferPointer();
+        const PixelType *inputPointer = inputBuffer + outputStartPositions[k];
+        unsigned int outputSize = outputSizes[k];
+
+        for (itk::SizeValueType j = 0;j < numberOfPixels;++j)
+        {
+            for (unsigned int l = 0;l < outputSize;++l)
+                outputBuffer[l] = inputPointer[l];
+
+            outputBuffer += outputSize;
+            inputPointer += inputVectorLength;
+        }
+
+        try
+        {
+            anima::writeImage <BaseOutputImageType> (outputFileNames[k],outputImage);
+        }
+        catch (itk::ExceptionObject &e)
+        {
+            std::string error("Unable to write MCM file ");
+            error += outputFileNames[k] + ": " + e.GetDescription();
+            throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
+        }
+    }
 }
 
 } // end namespace anima
@@ -4,6 +4,7 @@
  */
 
 #include "animaBobyqaOptimizer.h"
+#include <animaInstrumentation.h>
 #include <algorithm>
 
 namespace anima
@@ -85,7 +86,13 @@ BobyqaOptimizer
 
     this->InvokeEvent( itk::StartEvent() );
 
-    this->optimize(npt,p,xl,xu,m_RhoBegin,m_RhoEnd,maxfun,w);
+    {
+        ANIMA_INSTRUMENT_SCOPE("bobyqa");
+        this->optimize(npt,p,xl,xu,m_RhoBegin,m_RhoEnd,maxfun,w);
+    }
+
+    // Current iteration holds the number of cost function evaluations
+    ANIMA_INSTRUMENT_HISTOGRAM("bobyqa_evaluations",m_CurrentIteration);
 
     this->m_CurrentPosition = BobyqaOptimizer::ParametersType(m_SpaceDimension);
     for (unsigned i = 0; i < m_SpaceDimension; ++i) m_CurrentPosition[i] = p[i] / this->GetScales()[i];
@@ -1,4 +1,5 @@
 #include <animaNNLSOptimizer.h>
+#include <animaInstrumentation.h>
 #include <vnl/algo/vnl_qr.h>
 
 namespace anima
@@ -14,6 +15,8 @@ void NNLSOptimizer::StartOptimization()
     if ((numEquations != m_Points.size())||(numEquations == 0)||(parametersSize == 0))
         itkExceptionMacro("Wrongly sized inputs to NNLS, aborting");
 
+    ANIMA_INSTRUMENT_SCOPE("nnls");
+
     m_CurrentPosition.SetSize(parametersSize);
     m_CurrentPosition.Fill(0.0);
     m_TreatedIndexes.resize(parametersSize);
@@ -27,8 +30,10 @@ void NNLSOptimizer::StartOptimization()
 
     bool continueMainLoop = true;
     double previousMaxW = -1;
+    unsigned int numIterations = 0;
     while (continueMainLoop)
     {
+        ++numIterations;
         double maxW = 0;
         int maxIndex = -1;
         for (unsigned int i = 0;i < parametersSize;++i)
@@ -129,6 +134,8 @@ void NNLSOptimizer::StartOptimization()
 
         this->ComputeWVector();
     }
+
+    ANIMA_INSTRUMENT_HISTOGRAM("nnls_iterations",numIterations);
 }
 
 void NNLSOptimizer::ComputeWVector()
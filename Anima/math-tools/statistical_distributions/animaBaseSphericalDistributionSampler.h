@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace anima
+{
+
+/**
+ * @brief Base class for samplers on the 2-sphere built once for a given mean direction. Samples are drawn around the
+ * z axis and mapped onto the mean direction with a cached rotation matrix (the rotation of axis z x mu taking z onto mu).
+ */
+class BaseSphericalDistributionSampler
+{
+public:
+    BaseSphericalDistributionSampler()
+    {
+        m_ValidMeanDirection = false;
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            for (unsigned int j = 0;j < 3;++j)
+                m_RotationMatrix[i][j] = (i == j);
+        }
+    }
+
+    /**
+     * @brief Sets mean direction (normalized on the fly) and computes the rotation frame.
+     * Returns false, without throwing, if the direction cannot be normalized
+     */
+    template <class VectorType> bool SetMeanDirection(const VectorType &meanDirection)
+    {
+        double norm = std::sqrt(meanDirection[0] * meanDirection[0] + meanDirection[1] * meanDirection[1] +
+                meanDirection[2] * meanDirection[2]);
+
+        m_ValidMeanDirection = std::isfinite(norm) && (norm > 1.0e-12);
+        if (!m_ValidMeanDirection)
+            return false;
+
+        double a = meanDirection[0] / norm;
+        double b = meanDirection[1] / norm;
+        double c = meanDirection[2] / norm;
+
+        if (1.0 + c < 1.0e-12)
+        {
+            // Mean direction is -z: rotation of angle pi around x
+            for (unsigned int i = 0;i < 3;++i)
+            {
+                for (unsigned int j = 0;j < 3;++j)
+                    m_RotationMatrix[i][j] = (i == j) ? ((i == 0) ? 1.0 : -1.0) : 0.0;
+            }
+
+            return true;
+        }
+
+        // Rodrigues formula with v = z x mu = (-b, a, 0): R = I + [v]x + [v]x^2 / (1 + c)
+        double factor = 1.0 / (1.0 + c);
+        m_RotationMatrix[0][0] = 1.0 - a * a * factor;
+        m_RotationMatrix[0][1] = - a * b * factor;
+        m_RotationMatrix[0][2] = a;
+        m_RotationMatrix[1][0] = m_RotationMatrix[0][1];
+        m_RotationMatrix[1][1] = 1.0 - b * b * factor;
+        m_RotationMatrix[1][2] = b;
+        m_RotationMatrix[2][0] = - a;
+        m_RotationMatrix[2][1] = - b;
+        m_RotationMatrix[2][2] = c;
+
+        return true;
+    }
+
+    bool HasValidMeanDirection() const {return m_ValidMeanDirection;}
+
+protected:
+    //! Maps a sample given around the z axis as (sqrt(1 - w^2) cos(phi), sqrt(1 - w^2) sin(phi), w) into the mean direction frame
+    template <class VectorType> void RotateSample(double w, double phi, VectorType &resVec) const
+    {
+        double radius = std::sqrt(std::max(0.0, 1.0 - w * w));
+        double x = radius * std::cos(phi);
+        double y = radius * std::sin(phi);
+
+        for (unsigned int i = 0;i < 3;++i)
+            resVec[i] = m_RotationMatrix[i][0] * x + m_RotationMatrix[i][1] * y + m_RotationMatrix[i][2] * w;
+    }
+
+private:
+    double m_RotationMatrix[3][3];
+    bool m_ValidMeanDirection;
+};
+
+} // end namespace anima
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace anima
+{
+
+/**
+ * @brief Counter-based pseudo-random generator (Philox4x32-10, Salmon et al., SC 2011).
+ * A seed and a stream index define an independent sequence, each block of which is computed directly from its counter.
+ * Keying streams on voxel, seed point or replicate indices therefore gives bit-reproducible results whatever the
+ * number of threads or the way work is split. Satisfies UniformRandomBitGenerator, hence usable with std distributions.
+ */
+class CounterBasedRandomGenerator
+{
+public:
+    typedef uint32_t result_type;
+
+    //! Number of 32 bits words produced per counter value
+    static const unsigned int BlockSize = 4;
+
+    CounterBasedRandomGenerator(uint64_t seed = 0, uint64_t streamIndex = 0)
+    {
+        this->SetKey(seed, streamIndex);
+    }
+
+    //! Selects the stream to draw from and rewinds it
+    void SetKey(uint64_t seed, uint64_t streamIndex);
+
+    //! Moves to the start of a given block of the current stream
+    void SetBlockPosition(uint64_t blockIndex);
+
+    static constexpr result_type min() {return 0;}
+    static constexpr result_type max() {return std::numeric_limits <result_type>::max();}
+
+    result_type operator()()
+    {
+        if (m_BufferPosition == BlockSize)
+            this->GenerateNextBlock();
+
+        return m_Buffer[m_BufferPosition++];
+    }
+
+    void discard(unsigned long long numberOfValues);
+
+    //! Uniform value in [0,1), built from two words (53 random bits)
+    double GetUniformValue();
+
+    //! Gaussian value, one Box-Muller pair per call (the second value is dropped)
+    double GetGaussianValue(double mean = 0.0, double std = 1.0);
+
+    //! Batch uniform samples in [a,b), computed block by block when the stream is block aligned
+    void FillUniform(double *values, std::size_t numberOfValues, double a = 0.0, double b = 1.0);
+
+    //! Batch Gaussian samples, one block giving two values through Box-Muller
+    void FillGaussian(double *values, std::size_t numberOfValues, double mean = 0.0, double std = 1.0);
+
+    //! Batch Rician samples: magnitude of a real signal corrupted by complex Gaussian noise of standard deviation sigma
+    void FillRician(double signal, double sigma, double *values, std::size_t numberOfValues);
+
+    //! Philox4x32-10 bijection, computing one output block from a counter and a key
+    static void ComputeBlock(const uint32_t counter[4], const uint32_t key[2], uint32_t output[4]);
+
+private:
+    void GenerateNextBlock();
+    void IncrementCounter();
+
+    //! Box-Muller transform of a full block into two standard Gaussian values
+    static void ComputeGaussianPair(const uint32_t block[4], double &firstValue, double &secondValue);
+    static double ComputeUniformValue(uint32_t highWord, uint32_t lowWord);
+
+    //! Seed as key, counter made of the block index (words 0 and 1) and the stream index (words 2 and 3)
+    uint32_t m_Key[2];
+    uint32_t m_Counter[4];
+
+    uint32_t m_Buffer[4];
+    unsigned int m_BufferPosition;
+};
+
+} // end namespace anima
+
+#include "animaCounterBasedRandomGenerator.hxx"
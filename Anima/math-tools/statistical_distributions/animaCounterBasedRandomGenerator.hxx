@@ -0,0 +1,210 @@
+#pragma once
+#include "animaCounterBasedRandomGenerator.h"
+
+#include <cmath>
+
+namespace anima
+{
+
+inline void
+CounterBasedRandomGenerator::SetKey(uint64_t seed, uint64_t streamIndex)
+{
+    m_Key[0] = (uint32_t)seed;
+    m_Key[1] = (uint32_t)(seed >> 32);
+
+    m_Counter[2] = (uint32_t)streamIndex;
+    m_Counter[3] = (uint32_t)(streamIndex >> 32);
+
+    this->SetBlockPosition(0);
+}
+
+inline void
+CounterBasedRandomGenerator::SetBlockPosition(uint64_t blockIndex)
+{
+    m_Counter[0] = (uint32_t)blockIndex;
+    m_Counter[1] = (uint32_t)(blockIndex >> 32);
+
+    // Empty buffer: next draw computes the block at the current counter
+    m_BufferPosition = BlockSize;
+}
+
+inline void
+CounterBasedRandomGenerator::discard(unsigned long long numberOfValues)
+{
+    uint64_t nextBlockIndex = ((uint64_t)m_Counter[1] << 32) | m_Counter[0];
+    uint64_t wordPosition = nextBlockIndex * BlockSize - (BlockSize - m_BufferPosition) + numberOfValues;
+
+    this->SetBlockPosition(wordPosition / BlockSize);
+    unsigned int positionInBlock = wordPosition % BlockSize;
+    if (positionInBlock != 0)
+    {
+        this->GenerateNextBlock();
+        m_BufferPosition = positionInBlock;
+    }
+}
+
+inline void
+CounterBasedRandomGenerator::IncrementCounter()
+{
+    ++m_Counter[0];
+    if (m_Counter[0] == 0)
+        ++m_Counter[1];
+}
+
+inline void
+CounterBasedRandomGenerator::GenerateNextBlock()
+{
+    ComputeBlock(m_Counter, m_Key, m_Buffer);
+    this->IncrementCounter();
+    m_BufferPosition = 0;
+}
+
+inline void
+CounterBasedRandomGenerator::ComputeBlock(const uint32_t counter[4], const uint32_t key[2], uint32_t output[4])
+{
+    const uint64_t firstMultiplier = 0xD2511F53;
+    const uint64_t secondMultiplier = 0xCD9E8D57;
+
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for (unsigned int i = 0;i < 10;++i)
+    {
+        if (i > 0)
+        {
+            // Weyl sequence key schedule (golden ratio and sqrt(3) - 1)
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+
+        uint64_t firstProduct = firstMultiplier * c0;
+        uint64_t secondProduct = secondMultiplier * c2;
+
+        c0 = (uint32_t)(secondProduct >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t)secondProduct;
+        c2 = (uint32_t)(firstProduct >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t)firstProduct;
+    }
+
+    output[0] = c0;
+    output[1] = c1;
+    output[2] = c2;
+    output[3] = c3;
+}
+
+inline double
+CounterBasedRandomGenerator::ComputeUniformValue(uint32_t highWord, uint32_t lowWord)
+{
+    // 27 + 26 bits mantissa, as in std::generate_canonical
+    return ((highWord >> 5) * 67108864.0 + (lowWord >> 6)) * (1.0 / 9007199254740992.0);
+}
+
+inline void
+CounterBasedRandomGenerator::ComputeGaussianPair(const uint32_t block[4], double &firstValue, double &secondValue)
+{
+    // Uniform in (0,1] to avoid log(0)
+    double radius = std::sqrt(-2.0 * std::log(1.0 - ComputeUniformValue(block[0], block[1])));
+    double angle = 2.0 * M_PI * ComputeUniformValue(block[2], block[3]);
+
+    firstValue = radius * std::cos(angle);
+    secondValue = radius * std::sin(angle);
+}
+
+inline double
+CounterBasedRandomGenerator::GetUniformValue()
+{
+    uint32_t highWord = (*this)();
+    uint32_t lowWord = (*this)();
+    return ComputeUniformValue(highWord, lowWord);
+}
+
+inline double
+CounterBasedRandomGenerator::GetGaussianValue(double mean, double std)
+{
+    uint32_t block[4];
+    for (unsigned int i = 0;i < BlockSize;++i)
+        block[i] = (*this)();
+
+    double firstValue, secondValue;
+    ComputeGaussianPair(block, firstValue, secondValue);
+    return mean + std * firstValue;
+}
+
+inline void
+CounterBasedRandomGenerator::FillUniform(double *values, std::size_t numberOfValues, double a, double b)
+{
+    std::size_t pos = 0;
+    double scale = b - a;
+
+    // Drain a partially used buffer first
+    while ((pos < numberOfValues) && (m_BufferPosition != BlockSize))
+        values[pos++] = a + scale * this->GetUniformValue();
+
+    // Block aligned main loop: no buffering, two values per block
+    uint32_t block[4];
+    for (;pos + 1 < numberOfValues;pos += 2)
+    {
+        ComputeBlock(m_Counter, m_Key, block);
+        this->IncrementCounter();
+
+        values[pos] = a + scale * ComputeUniformValue(block[0], block[1]);
+        values[pos + 1] = a + scale * ComputeUniformValue(block[2], block[3]);
+    }
+
+    if (pos < numberOfValues)
+        values[pos] = a + scale * this->GetUniformValue();
+}
+
+inline void
+CounterBasedRandomGenerator::FillGaussian(double *values, std::size_t numberOfValues, double mean, double std)
+{
+    uint32_t block[4];
+    double firstValue, secondValue;
+    for (std::size_t pos = 0;pos < numberOfValues;pos += 2)
+    {
+        if (m_BufferPosition == BlockSize)
+        {
+            ComputeBlock(m_Counter, m_Key, block);
+            this->IncrementCounter();
+        }
+        else
+        {
+            for (unsigned int i = 0;i < BlockSize;++i)
+                block[i] = (*this)();
+        }
+
+        ComputeGaussianPair(block, firstValue, secondValue);
+
+        values[pos] = mean + std * firstValue;
+        if (pos + 1 < numberOfValues)
+            values[pos + 1] = mean + std * secondValue;
+    }
+}
+
+inline void
+CounterBasedRandomGenerator::FillRician(double signal, double sigma, double *values, std::size_t numberOfValues)
+{
+    uint32_t block[4];
+    double realNoise, imaginaryNoise;
+    for (std::size_t pos = 0;pos < numberOfValues;++pos)
+    {
+        if (m_BufferPosition == BlockSize)
+        {
+            ComputeBlock(m_Counter, m_Key, block);
+            this->IncrementCounter();
+        }
+        else
+        {
+            for (unsigned int i = 0;i < BlockSize;++i)
+                block[i] = (*this)();
+        }
+
+        ComputeGaussianPair(block, realNoise, imaginaryNoise);
+
+        double realPart = signal + sigma * realNoise;
+        double imaginaryPart = sigma * imaginaryNoise;
+        values[pos] = std::sqrt(realPart * realPart + imaginaryPart * imaginaryPart);
+    }
+}
+
+} // end namespace anima
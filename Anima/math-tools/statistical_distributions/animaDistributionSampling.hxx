@@ -14,16 +14,16 @@
 namespace anima
 {
 
-template <class T>
-double SampleFromUniformDistribution(const T &a, const T &b, std::mt19937 &generator)
+template <class T, class RandomGeneratorType>
+double SampleFromUniformDistribution(const T &a, const T &b, RandomGeneratorType &generator)
 {
     // Define distribution U[a,b) [double values]
     std::uniform_real_distribution<T> uniDbl(a,b);
     return uniDbl(generator);
 }
 
-template <class VectorType>
-void SampleFromUniformDistributionOn2Sphere(std::mt19937 &generator, VectorType &resVec)
+template <class VectorType, class RandomGeneratorType>
+void SampleFromUniformDistributionOn2Sphere(RandomGeneratorType &generator, VectorType &resVec)
 {
     std::uniform_real_distribution<double> uniDbl(-1.0,1.0);
     double sqSum = 2;
@@ -41,23 +41,23 @@ void SampleFromUniformDistributionOn2Sphere(std::mt19937 &generator, VectorType
     resVec[2] = 2.0 * sqSum - 1.0;
 }
 
-template <class T>
-unsigned int SampleFromBernoulliDistribution(const T &p, std::mt19937 &generator)
+template <class T, class RandomGeneratorType>
+unsigned int SampleFromBernoulliDistribution(const T &p, RandomGeneratorType &generator)
 {
     std::bernoulli_distribution bernoulli(p);
     return bernoulli(generator);
 }
 
-template <class T>
-double SampleFromGaussianDistribution(const T &mean, const T &std, std::mt19937 &generator)
+template <class T, class RandomGeneratorType>
+double SampleFromGaussianDistribution(const T &mean, const T &std, RandomGeneratorType &generator)
 {
     std::normal_distribution<T> normalDist(mean,std);
     return normalDist(generator);
 }
 
-template <class VectorType, class ScalarType>
+template <class VectorType, class ScalarType, class RandomGeneratorType>
 void SampleFromMultivariateGaussianDistribution(const VectorType &mean, const vnl_matrix <ScalarType> &mat, VectorType &resVec,
-                                                std::mt19937 &generator, bool isMatCovariance)
+                                                RandomGeneratorType &generator, bool isMatCovariance)
 {
     unsigned int vectorSize = mat.rows();
 
@@ -89,8 +89,8 @@ void SampleFromMultivariateGaussianDistribution(const VectorType &mean, const vn
     }
 }
 
-template <class VectorType, class ScalarType>
-void SampleFromVMFDistribution(const ScalarType &kappa, const VectorType &meanDirection, VectorType &resVec, std::mt19937 &generator)
+template <class VectorType, class ScalarType, class RandomGeneratorType>
+void SampleFromVMFDistribution(const ScalarType &kappa, const VectorType &meanDirection, VectorType &resVec, RandomGeneratorType &generator)
 {
     VectorType tmpVec;
 
@@ -139,8 +139,8 @@ void SampleFromVMFDistribution(const ScalarType &kappa, const VectorType &meanDi
             resVec[i] += rotationMatrix(i,j) * tmpVec[j];
 }
 
-template <class VectorType, class ScalarType>
-void SampleFromVMFDistributionNumericallyStable(const ScalarType &kappa, const VectorType &meanDirection, VectorType &resVec, std::mt19937 &generator)
+template <class VectorType, class ScalarType, class RandomGeneratorType>
+void SampleFromVMFDistributionNumericallyStable(const ScalarType &kappa, const VectorType &meanDirection, VectorType &resVec, RandomGeneratorType &generator)
 {
     VectorType tmpVec;
 
@@ -172,18 +172,18 @@ void SampleFromVMFDistributionNumericallyStable(const ScalarType &kappa, const V
             resVec[i] += rotationMatrix(i,j) * tmpVec[j];
 }
 
-template <class ScalarType, class VectorType>
+template <class ScalarType, class VectorType, class RandomGeneratorType>
 void
-SampleFromWatsonDistribution(const ScalarType &kappa, const VectorType &meanDirection, VectorType &resVec, unsigned int DataDimension, std::mt19937 &generator)
+SampleFromWatsonDistribution(const ScalarType &kappa, const VectorType &meanDirection, VectorType &resVec, unsigned int DataDimension, RandomGeneratorType &generator)
 {
     /**********************************************************************************************//**
-         * \fn template <class ScalarType, class VectorType>
+         * \fn template <class ScalarType, class VectorType, class RandomGeneratorType>
          * 	   void
          *     SampleFromWatsonDistribution(const ScalarType &kappa,
          * 					const VectorType &meanDirection,
          * 					VectorType &resVec,
          * 					unsigned int DataDimension,
-         * 					std::mt19937 &generator)
+         * 					RandomGeneratorType &generator)
          *
          * \brief	Sample from the Watson distribution using the procedure described in
          * 			Fisher et al., Statistical Analysis of Spherical Data, 1993, p.59.
@@ -287,17 +287,17 @@ SampleFromWatsonDistribution(const ScalarType &kappa, const VectorType &meanDire
     anima::Normalize(resVec,resVec);
 }
 
-template <class ScalarType, unsigned int DataDimension>
+template <class ScalarType, unsigned int DataDimension, class RandomGeneratorType>
 void
-SampleFromWatsonDistribution(const ScalarType &kappa, const vnl_vector_fixed < ScalarType, DataDimension > &meanDirection, vnl_vector_fixed < ScalarType, DataDimension > &resVec, std::mt19937 &generator)
+SampleFromWatsonDistribution(const ScalarType &kappa, const vnl_vector_fixed < ScalarType, DataDimension > &meanDirection, vnl_vector_fixed < ScalarType, DataDimension > &resVec, RandomGeneratorType &generator)
 {
     /**********************************************************************************************//**
-         * \fn template <class ScalarType, unsigned int DataDimension>
+         * \fn template <class ScalarType, unsigned int DataDimension, class RandomGeneratorType>
          * 	   void
          *     SampleFromWatsonDistribution(const ScalarType &kappa,
          * 					const vnl_vector_fixed < ScalarType, DataDimension > &meanDirection,
          * 					vnl_vector_fixed < ScalarType, DataDimension > &resVec,
-         * 					std::mt19937 &generator)
+         * 					RandomGeneratorType &generator)
          *
          * \brief	Sample from the Watson distribution using the procedure described in
          * 			Fisher et al., Statistical Analysis of Spherical Data, 1993, p.59.
@@ -315,17 +315,17 @@ SampleFromWatsonDistribution(const ScalarType &kappa, const vnl_vector_fixed < S
     SampleFromWatsonDistribution(kappa, meanDirection, resVec, DataDimension, generator);
 }
 
-template <class ScalarType, unsigned int DataDimension>
+template <class ScalarType, unsigned int DataDimension, class RandomGeneratorType>
 void
-SampleFromWatsonDistribution(const ScalarType &kappa, const itk::Point < ScalarType, DataDimension > &meanDirection, itk::Point < ScalarType, DataDimension > &resVec, std::mt19937 &generator)
+SampleFromWatsonDistribution(const ScalarType &kappa, const itk::Point < ScalarType, DataDimension > &meanDirection, itk::Point < ScalarType, DataDimension > &resVec, RandomGeneratorType &generator)
 {
     /**********************************************************************************************//**
-         * \fn template <class ScalarType, unsigned int DataDimension>
+         * \fn template <class ScalarType, unsigned int DataDimension, class RandomGeneratorType>
          * 	   void
          *     SampleFromWatsonDistribution(const ScalarType &kappa,
          * 					const itk::Point < ScalarType, DataDimension > &meanDirection,
          * 					itk::Point < ScalarType, DataDimension > &resVec,
-         * 					std::mt19937 &generator)
+         * 					RandomGeneratorType &generator)
          *
          * \brief	Sample from the Watson distribution using the procedure described in
          * 			Fisher et al., Statistical Analysis of Spherical Data, 1993, p.59.
@@ -343,17 +343,17 @@ SampleFromWatsonDistribution(const ScalarType &kappa, const itk::Point < ScalarT
     SampleFromWatsonDistribution(kappa, meanDirection, resVec, DataDimension, generator);
 }
 
-template <class ScalarType, unsigned int DataDimension>
+template <class ScalarType, unsigned int DataDimension, class RandomGeneratorType>
 void
-SampleFromWatsonDistribution(const ScalarType &kappa, const itk::Vector < ScalarType, DataDimension > &meanDirection, itk::Vector < ScalarType, DataDimension > &resVec, std::mt19937 &generator)
+SampleFromWatsonDistribution(const ScalarType &kappa, const itk::Vector < ScalarType, DataDimension > &meanDirection, itk::Vector < ScalarType, DataDimension > &resVec, RandomGeneratorType &generator)
 {
     /**********************************************************************************************//**
-         * \fn template <class ScalarType, unsigned int DataDimension>
+         * \fn template <class ScalarType, unsigned int DataDimension, class RandomGeneratorType>
          * 	   void
          *     SampleFromWatsonDistribution(const ScalarType &kappa,
          * 					const itk::Vector < ScalarType, DataDimension > &meanDirection,
          * 					itk::Vector < ScalarType, DataDimension > &resVec,
-         * 					std::mt19937 &generator)
+         * 					RandomGeneratorType &generator)
          *
          * \brief	Sample from the Watson distribution using the procedure described in
          * 			Fisher et al., Statistical Analysis of Spherical Data, 1993, p.59.
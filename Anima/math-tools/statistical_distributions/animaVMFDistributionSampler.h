@@ -0,0 +1,45 @@
+#pragma once
+
+#include <animaBaseSphericalDistributionSampler.h>
+
+namespace anima
+{
+
+/**
+ * @brief Von Mises & Fisher distribution sampler on the 2-sphere, built once for a concentration and a mean direction.
+ * On the 2-sphere, the cosine to the mean direction has a closed-form inverse CDF (Wenzel 2012), so that each sample costs
+ * one logarithm and no rejection loop. Draws and rotation are the same as SampleFromVMFDistributionNumericallyStable.
+ */
+class VMFDistributionSampler : public BaseSphericalDistributionSampler
+{
+public:
+    VMFDistributionSampler() {this->SetKappa(0.0);}
+
+    template <class VectorType> VMFDistributionSampler(double kappa, const VectorType &meanDirection)
+    {
+        this->SetKappa(kappa);
+        this->SetMeanDirection(meanDirection);
+    }
+
+    void SetKappa(double kappa);
+    double GetKappa() const {return m_Kappa;}
+
+    //! Cosine of the angle to the mean direction from a uniform value in [0,1)
+    double GetCosineFromUniformValue(double uniformValue) const;
+
+    //! One sample, resVec needs an operator[] and a size of at least 3
+    template <class RandomGeneratorType, class VectorType> void Sample(RandomGeneratorType &generator, VectorType &resVec) const;
+
+    //! Batch sampling into a flat buffer of 3 * numberOfSamples values
+    template <class RandomGeneratorType> void Sample(RandomGeneratorType &generator, double *samples, unsigned int numberOfSamples) const;
+
+private:
+    double m_Kappa;
+
+    // Cached inverse CDF constants
+    double m_ExpMinusTwoKappa, m_InverseKappa;
+};
+
+} // end namespace anima
+
+#include "animaVMFDistributionSampler.hxx"
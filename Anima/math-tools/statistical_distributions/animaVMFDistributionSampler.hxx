@@ -0,0 +1,57 @@
+#pragma once
+#include "animaVMFDistributionSampler.h"
+
+#include <random>
+
+namespace anima
+{
+
+inline void
+VMFDistributionSampler::SetKappa(double kappa)
+{
+    m_Kappa = kappa;
+    m_ExpMinusTwoKappa = std::exp(-2.0 * kappa);
+    m_InverseKappa = (kappa > 1.0e-6) ? 1.0 / kappa : 0.0;
+}
+
+inline double
+VMFDistributionSampler::GetCosineFromUniformValue(double uniformValue) const
+{
+    // Uniform distribution on the sphere
+    if (m_Kappa <= 1.0e-6)
+        return 2.0 * uniformValue - 1.0;
+
+    double W = 1.0 + std::log(uniformValue + (1.0 - uniformValue) * m_ExpMinusTwoKappa) * m_InverseKappa;
+    return std::max(-1.0, std::min(1.0, W));
+}
+
+template <class RandomGeneratorType, class VectorType>
+void
+VMFDistributionSampler::Sample(RandomGeneratorType &generator, VectorType &resVec) const
+{
+    std::uniform_real_distribution <double> uniDbl(0.0, 1.0);
+
+    double W = this->GetCosineFromUniformValue(uniDbl(generator));
+    double phi = 2.0 * M_PI * uniDbl(generator);
+
+    this->RotateSample(W, phi, resVec);
+}
+
+template <class RandomGeneratorType>
+void
+VMFDistributionSampler::Sample(RandomGeneratorType &generator, double *samples, unsigned int numberOfSamples) const
+{
+    std::uniform_real_distribution <double> uniDbl(0.0, 1.0);
+
+    for (unsigned int i = 0;i < numberOfSamples;++i)
+    {
+        double W = this->GetCosineFromUniformValue(uniDbl(generator));
+        double phi = 2.0 * M_PI * uniDbl(generator);
+
+        double *currentSample = samples + 3 * i;
+
+        this->RotateSample(W, phi, currentSample);
+    }
+}
+
+} // end namespace anima
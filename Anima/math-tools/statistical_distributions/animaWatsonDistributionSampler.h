@@ -0,0 +1,64 @@
+#pragma once
+
+#include <animaBaseSphericalDistributionSampler.h>
+#include <vector>
+
+namespace anima
+{
+
+/**
+ * @brief Watson distribution sampler on the 2-sphere (Fisher et al., Statistical Analysis of Spherical Data, 1993, p.59),
+ * built once for a concentration and a mean direction. Rejection constants are cached and acceptance tests use
+ * squeeze bounds (exp(x) >= 1 + x) so that most draws need a single logarithm (bipolar) or tangent (girdle).
+ * For low absolute concentrations, batches are drawn from a tabulated inverse CDF of the cosine to the mean axis.
+ * Draws and rotation are the same as SampleFromWatsonDistribution, batches apart.
+ */
+class WatsonDistributionSampler : public BaseSphericalDistributionSampler
+{
+public:
+    WatsonDistributionSampler();
+
+    template <class VectorType> WatsonDistributionSampler(double kappa, const VectorType &meanDirection)
+    {
+        m_InverseCDFTableKappa = 0.0;
+        this->SetKappa(kappa);
+        this->SetMeanDirection(meanDirection);
+    }
+
+    void SetKappa(double kappa);
+    double GetKappa() const {return m_Kappa;}
+
+    //! Samples the cosine of the angle to the mean axis by rejection (or directly for uniform distributions)
+    template <class RandomGeneratorType> double SampleCosine(RandomGeneratorType &generator) const;
+
+    //! One sample, resVec needs an operator[] and a size of at least 3
+    template <class RandomGeneratorType, class VectorType> void Sample(RandomGeneratorType &generator, VectorType &resVec) const;
+
+    //! Batch sampling into a flat buffer of 3 * numberOfSamples values
+    template <class RandomGeneratorType> void Sample(RandomGeneratorType &generator, double *samples, unsigned int numberOfSamples);
+
+    //! Absolute concentration below which batches use the inverse CDF table
+    static double GetInverseCDFKappaThreshold() {return 1.0;}
+
+    //! Minimal batch size triggering the table computation (a table already computed for the current kappa is always used)
+    static unsigned int GetInverseCDFMinimalBatchSize() {return 64;}
+
+protected:
+    bool UseInverseCDFTable(unsigned int numberOfSamples) const;
+    void ComputeInverseCDFTable();
+
+private:
+    double m_Kappa;
+
+    // Cached rejection constants
+    double m_ExpMinusKappa, m_InverseKappa;
+    double m_GirdleSqrtKappa, m_GirdleInverseSqrtKappa, m_GirdleArcTangent;
+
+    //! Inverse CDF of the cosine on [0,1], density proportional to exp(kappa * s^2)
+    std::vector <double> m_InverseCDFTable;
+    double m_InverseCDFTableKappa;
+};
+
+} // end namespace anima
+
+#include "animaWatsonDistributionSampler.hxx"
@@ -0,0 +1,177 @@
+#pragma once
+#include "animaWatsonDistributionSampler.h"
+
+#include <random>
+
+namespace anima
+{
+
+inline WatsonDistributionSampler::WatsonDistributionSampler()
+{
+    m_InverseCDFTableKappa = 0.0;
+    this->SetKappa(0.0);
+}
+
+inline void
+WatsonDistributionSampler::SetKappa(double kappa)
+{
+    m_Kappa = kappa;
+
+    m_ExpMinusKappa = std::exp(-kappa);
+    m_InverseKappa = (std::abs(kappa) > 1.0e-6) ? 1.0 / kappa : 0.0;
+
+    m_GirdleSqrtKappa = std::sqrt(std::abs(kappa));
+    m_GirdleInverseSqrtKappa = (m_GirdleSqrtKappa > 0.0) ? 1.0 / m_GirdleSqrtKappa : 0.0;
+    m_GirdleArcTangent = std::atan(m_GirdleSqrtKappa);
+}
+
+template <class RandomGeneratorType>
+double
+WatsonDistributionSampler::SampleCosine(RandomGeneratorType &generator) const
+{
+    std::uniform_real_distribution <double> uniDbl(0.0, 1.0);
+
+    if (m_Kappa > 1.0e-6)
+    {
+        // Bipolar distribution: S = 1 + log(W) / kappa, accepted if log(V) <= kappa S (S - 1) = L + L^2 / kappa
+        while (true)
+        {
+            double U = uniDbl(generator);
+            double W = U + (1.0 - U) * m_ExpMinusKappa;
+            double L = std::log(W);
+            double S = 1.0 + L * m_InverseKappa;
+
+            double V = uniDbl(generator);
+            if (V < 1.0e-6)
+                return S;
+
+            double exponent = L * L * m_InverseKappa;
+            if (V <= W * (1.0 + exponent))
+                return S;
+
+            if (V <= W * std::exp(exponent))
+                return S;
+        }
+    }
+
+    if (m_Kappa < -1.0e-6)
+    {
+        // Girdle distribution: accepted if V <= (1 - T) exp(T), squeezed by 1 - T^2
+        while (true)
+        {
+            double U = uniDbl(generator);
+            double V = uniDbl(generator);
+            double S = m_GirdleInverseSqrtKappa * std::tan(m_GirdleArcTangent * U);
+            double T = m_Kappa * S * S;
+
+            if (V <= 1.0 - T * T)
+                return S;
+
+            if (V <= (1.0 - T) * std::exp(T))
+                return S;
+        }
+    }
+
+    // Sampling uniformly on the sphere
+    return std::cos(M_PI * uniDbl(generator));
+}
+
+template <class RandomGeneratorType, class VectorType>
+void
+WatsonDistributionSampler::Sample(RandomGeneratorType &generator, VectorType &resVec) const
+{
+    double S = this->SampleCosine(generator);
+
+    std::uniform_real_distribution <double> uniDbl(0.0, 2.0 * M_PI);
+    double phi = uniDbl(generator);
+
+    this->RotateSample(S, phi, resVec);
+}
+
+inline bool
+WatsonDistributionSampler::UseInverseCDFTable(unsigned int numberOfSamples) const
+{
+    if ((std::abs(m_Kappa) <= 1.0e-6) || (std::abs(m_Kappa) > GetInverseCDFKappaThreshold()))
+        return false;
+
+    if ((m_InverseCDFTable.size() != 0) && (m_InverseCDFTableKappa == m_Kappa))
+        return true;
+
+    return (numberOfSamples >= GetInverseCDFMinimalBatchSize());
+}
+
+inline void
+WatsonDistributionSampler::ComputeInverseCDFTable()
+{
+    const unsigned int tableSize = 1024;
+    const unsigned int gridSize = 4096;
+
+    // Cumulative trapezoidal integration of exp(kappa * s^2) on [0,1]
+    std::vector <double> cdfValues(gridSize + 1, 0.0);
+    double previousDensity = 1.0;
+    for (unsigned int i = 1;i <= gridSize;++i)
+    {
+        double s = (double)i / gridSize;
+        double density = std::exp(m_Kappa * s * s);
+        cdfValues[i] = cdfValues[i - 1] + 0.5 * (previousDensity + density) / gridSize;
+        previousDensity = density;
+    }
+
+    double totalIntegral = cdfValues[gridSize];
+
+    m_InverseCDFTable.resize(tableSize + 1);
+    m_InverseCDFTable[0] = 0.0;
+    m_InverseCDFTable[tableSize] = 1.0;
+
+    unsigned int gridPosition = 0;
+    for (unsigned int i = 1;i < tableSize;++i)
+    {
+        double target = totalIntegral * i / tableSize;
+        while ((gridPosition < gridSize - 1) && (cdfValues[gridPosition + 1] < target))
+            ++gridPosition;
+
+        double segmentWidth = cdfValues[gridPosition + 1] - cdfValues[gridPosition];
+        double fraction = (segmentWidth > 0.0) ? (target - cdfValues[gridPosition]) / segmentWidth : 0.0;
+        m_InverseCDFTable[i] = (gridPosition + fraction) / gridSize;
+    }
+
+    m_InverseCDFTableKappa = m_Kappa;
+}
+
+template <class RandomGeneratorType>
+void
+WatsonDistributionSampler::Sample(RandomGeneratorType &generator, double *samples, unsigned int numberOfSamples)
+{
+    std::uniform_real_distribution <double> uniDbl(0.0, 1.0);
+
+    if (!this->UseInverseCDFTable(numberOfSamples))
+    {
+        for (unsigned int i = 0;i < numberOfSamples;++i)
+        {
+            double S = this->SampleCosine(generator);
+            double phi = 2.0 * M_PI * uniDbl(generator);
+            double *currentSample = samples + 3 * i;
+            this->RotateSample(S, phi, currentSample);
+        }
+
+        return;
+    }
+
+    if ((m_InverseCDFTable.size() == 0) || (m_InverseCDFTableKappa != m_Kappa))
+        this->ComputeInverseCDFTable();
+
+    double tableSize = m_InverseCDFTable.size() - 1;
+    for (unsigned int i = 0;i < numberOfSamples;++i)
+    {
+        double position = uniDbl(generator) * tableSize;
+        unsigned int index = std::min((unsigned int)position, (unsigned int)tableSize - 1);
+        double fraction = position - index;
+        double S = m_InverseCDFTable[index] + fraction * (m_InverseCDFTable[index + 1] - m_InverseCDFTable[index]);
+
+        double phi = 2.0 * M_PI * uniDbl(generator);
+        double *currentSample = samples + 3 * i;
+        this->RotateSample(S, phi, currentSample);
+    }
+}
+
+} // end namespace anima
@@ -0,0 +1,178 @@
+#include <animaDistributionSampling.h>
+#include <animaWatsonDistributionSampler.h>
+#include <animaVMFDistributionSampler.h>
+#include <tclap/CmdLine.h>
+
+#include <itkVector.h>
+
+#include <algorithm>
+#include <iostream>
+
+//! Two-sample Kolmogorov-Smirnov statistic
+double ComputeKSStatistic(std::vector <double> &firstSample, std::vector <double> &secondSample)
+{
+    std::sort(firstSample.begin(), firstSample.end());
+    std::sort(secondSample.begin(), secondSample.end());
+
+    unsigned int i = 0, j = 0;
+    double maxDistance = 0.0;
+    while ((i < firstSample.size()) && (j < secondSample.size()))
+    {
+        if (firstSample[i] <= secondSample[j])
+            ++i;
+        else
+            ++j;
+
+        double distance = std::abs((double)i / firstSample.size() - (double)j / secondSample.size());
+        maxDistance = std::max(maxDistance, distance);
+    }
+
+    return maxDistance;
+}
+
+//! Compares cosines to the mean axis and mean samples from both samplers, returns true if they are compatible
+bool CompareSamples(const std::vector <double> &referenceSamples, const std::vector <double> &newSamples,
+                    const itk::Vector <double,3> &meanDirection, bool axial, const std::string &testName)
+{
+    unsigned int numSamples = referenceSamples.size() / 3;
+    std::vector <double> referenceCosines(numSamples), newCosines(numSamples);
+    double referenceMean[3] = {0, 0, 0};
+    double newMean[3] = {0, 0, 0};
+    double maxNormError = 0;
+
+    for (unsigned int i = 0;i < numSamples;++i)
+    {
+        double referenceCosine = 0, newCosine = 0, newNorm = 0;
+        for (unsigned int j = 0;j < 3;++j)
+        {
+            referenceCosine += referenceSamples[3 * i + j] * meanDirection[j];
+            newCosine += newSamples[3 * i + j] * meanDirection[j];
+            newNorm += newSamples[3 * i + j] * newSamples[3 * i + j];
+        }
+
+        double referenceSign = ((axial) && (referenceCosine < 0)) ? -1.0 : 1.0;
+        double newSign = ((axial) && (newCosine < 0)) ? -1.0 : 1.0;
+        for (unsigned int j = 0;j < 3;++j)
+        {
+            referenceMean[j] += referenceSign * referenceSamples[3 * i + j] / numSamples;
+            newMean[j] += newSign * newSamples[3 * i + j] / numSamples;
+        }
+
+        referenceCosines[i] = referenceSign * referenceCosine;
+        newCosines[i] = newSign * newCosine;
+        maxNormError = std::max(maxNormError, std::abs(newNorm - 1.0));
+    }
+
+    // Critical value at the 0.001 level
+    double ksStatistic = ComputeKSStatistic(referenceCosines, newCosines);
+    double ksThreshold = 1.95 * std::sqrt(2.0 / numSamples);
+
+    // Mean samples (coordinates have variance below 1), compared at about 5 standard deviations
+    double meanDistance = 0;
+    for (unsigned int j = 0;j < 3;++j)
+        meanDistance = std::max(meanDistance, std::abs(referenceMean[j] - newMean[j]));
+    double meanThreshold = 5.0 * std::sqrt(2.0 / numSamples);
+
+    bool success = (ksStatistic < ksThreshold) && (meanDistance < meanThreshold) && (maxNormError < 1.0e-10);
+    std::cout << testName << ": KS statistic " << ksStatistic << " (threshold " << ksThreshold << "), mean sample distance "
+              << meanDistance << " (threshold " << meanThreshold << "), max norm error " << maxNormError
+              << (success ? " -> OK" : " -> FAILED") << std::endl;
+
+    return success;
+}
+
+int main(int argc, char **argv)
+{
+    TCLAP::CmdLine cmd("INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
+
+    TCLAP::ValueArg<unsigned int> numSamplesArg("n","nb-samples","Number of samples per test (default: 100000)",false,100000,"number of samples",cmd);
+    TCLAP::ValueArg<unsigned int> seedArg("s","seed","Random generator seed (default: 0)",false,0,"seed",cmd);
+
+    try
+    {
+        cmd.parse(argc,argv);
+    }
+    catch (TCLAP::ArgException& e)
+    {
+        std::cerr << "Error: " << e.error() << "for argument " << e.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    unsigned int numSamples = numSamplesArg.getValue();
+    std::mt19937 referenceGenerator(seedArg.getValue());
+    std::mt19937 newGenerator(seedArg.getValue() + 1);
+
+    itk::Vector <double,3> meanDirection;
+    meanDirection[0] = 0.3;
+    meanDirection[1] = -0.5;
+    meanDirection[2] = 0.8;
+    meanDirection.Normalize();
+
+    itk::Vector <double,3> referenceSample;
+    std::vector <double> referenceSamples(3 * numSamples), newSamples(3 * numSamples);
+    bool success = true;
+
+    // Watson: girdle, low kappa (inverse CDF table for batches), uniform and bipolar
+    std::vector <double> watsonKappas = {-20.0, -2.0, -0.5, 0.0, 0.5, 2.0, 15.0, 80.0};
+    for (unsigned int k = 0;k < watsonKappas.size();++k)
+    {
+        for (unsigned int i = 0;i < numSamples;++i)
+        {
+            anima::SampleFromWatsonDistribution(watsonKappas[k], meanDirection, referenceSample, referenceGenerator);
+            for (unsigned int j = 0;j < 3;++j)
+                referenceSamples[3 * i + j] = referenceSample[j];
+        }
+
+        anima::WatsonDistributionSampler watsonSampler(watsonKappas[k], meanDirection);
+        watsonSampler.Sample(newGenerator, newSamples.data(), numSamples);
+
+        std::string testName = "Watson kappa " + std::to_string(watsonKappas[k]);
+        success &= CompareSamples(referenceSamples, newSamples, meanDirection, true, testName);
+    }
+
+    // Von Mises & Fisher, compared to both the Ulrich and Wenzel samplers
+    std::vector <double> vmfKappas = {0.5, 2.0, 15.0, 200.0};
+    for (unsigned int k = 0;k < vmfKappas.size();++k)
+    {
+        anima::VMFDistributionSampler vmfSampler(vmfKappas[k], meanDirection);
+        vmfSampler.Sample(newGenerator, newSamples.data(), numSamples);
+
+        for (unsigned int i = 0;i < numSamples;++i)
+        {
+            anima::SampleFromVMFDistribution(vmfKappas[k], meanDirection, referenceSample, referenceGenerator);
+            for (unsigned int j = 0;j < 3;++j)
+                referenceSamples[3 * i + j] = referenceSample[j];
+        }
+
+        std::string testName = "VMF (Ulrich) kappa " + std::to_string(vmfKappas[k]);
+        success &= CompareSamples(referenceSamples, newSamples, meanDirection, false, testName);
+
+        for (unsigned int i = 0;i < numSamples;++i)
+        {
+            anima::SampleFromVMFDistributionNumericallyStable(vmfKappas[k], meanDirection, referenceSample, referenceGenerator);
+            for (unsigned int j = 0;j < 3;++j)
+                referenceSamples[3 * i + j] = referenceSample[j];
+        }
+
+        testName = "VMF (Wenzel) kappa " + std::to_string(vmfKappas[k]);
+        success &= CompareSamples(referenceSamples, newSamples, meanDirection, false, testName);
+    }
+
+    // Single draws from the same generator state follow the exact same path as the original samplers
+    std::mt19937 firstGenerator(seedArg.getValue()), secondGenerator(seedArg.getValue());
+    itk::Vector <double,3> newSample;
+    double maxDifference = 0;
+    anima::WatsonDistributionSampler watsonSampler(10.0, meanDirection);
+    for (unsigned int i = 0;i < 1000;++i)
+    {
+        anima::SampleFromWatsonDistribution(10.0, meanDirection, referenceSample, firstGenerator);
+        watsonSampler.Sample(secondGenerator, newSample);
+        maxDifference = std::max(maxDifference, (referenceSample - newSample).GetNorm());
+    }
+
+    bool sameDraws = (maxDifference < 1.0e-8);
+    std::cout << "Watson single draws: max difference " << maxDifference << (sameDraws ? " -> OK" : " -> FAILED") << std::endl;
+    success &= sameDraws;
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
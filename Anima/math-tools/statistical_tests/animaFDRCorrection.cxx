@@ -1,64 +1,200 @@
 #include "animaFDRCorrection.h"
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
 namespace anima
 {
-    
-    void BHCorrection(std::vector <double> &pvalues, double qValue)
+
+    FDRThresholdComputer::FDRThresholdComputer()
     {
-        std::vector < std::pair <unsigned int, double> > indexedPvalues;
-        unsigned int numData = pvalues.size();
-        for (unsigned int i = 0;i < numData;++i)
-            indexedPvalues.push_back(std::pair <unsigned int, double> (i,pvalues[i]));
-        
-        std::sort(indexedPvalues.begin(),indexedPvalues.end(),pair_increasing_comparator());
-        
-        // Update p-values
-        unsigned int breakingIndex = 0;
-        for (unsigned int i = 0;i < numData;++i)
+        this->Initialize(0.05,false);
+    }
+
+    void FDRThresholdComputer::Initialize(double qValue, bool byCorrection)
+    {
+        m_QValue = qValue;
+        m_BYCorrection = byCorrection;
+        m_BucketScale = (qValue > 0) ? GetNumberOfBuckets() / qValue : 0.0;
+        m_CorrectionFactor = 1.0;
+
+        m_NumberOfPValues = 0;
+        m_BucketCounts.assign(GetNumberOfBuckets(),0);
+        m_CumulativeCounts.clear();
+        m_BucketMaxima.assign(GetNumberOfBuckets(),- std::numeric_limits <double>::max());
+
+        m_RejectedBucket = -1;
+        m_RefinedBuckets.assign(GetNumberOfBuckets(),false);
+        m_RefinementValues.clear();
+    }
+
+    void FDRThresholdComputer::Merge(const FDRThresholdComputer &other)
+    {
+        m_NumberOfPValues += other.m_NumberOfPValues;
+        for (unsigned int i = 0;i < GetNumberOfBuckets();++i)
+        {
+            m_BucketCounts[i] += other.m_BucketCounts[i];
+            m_BucketMaxima[i] = std::max(m_BucketMaxima[i],other.m_BucketMaxima[i]);
+        }
+    }
+
+    double FDRThresholdComputer::GetRankThreshold(unsigned long rank) const
+    {
+        return m_QValue * rank / m_NumberOfPValues / m_CorrectionFactor;
+    }
+
+    bool FDRThresholdComputer::PrepareRefinement()
+    {
+        m_CorrectionFactor = 1.0;
+        if (m_BYCorrection)
+        {
+            m_CorrectionFactor = 0;
+            for (unsigned int i = 0;i < m_NumberOfPValues;++i)
+                m_CorrectionFactor += 1.0 / (i + 1.0);
+        }
+
+        m_CumulativeCounts.resize(GetNumberOfBuckets());
+        unsigned int cumulatedCount = 0;
+        for (unsigned int i = 0;i < GetNumberOfBuckets();++i)
+        {
+            cumulatedCount += m_BucketCounts[i];
+            m_CumulativeCounts[i] = cumulatedCount;
+        }
+
+        m_RejectedBucket = -1;
+        std::fill(m_RefinedBuckets.begin(),m_RefinedBuckets.end(),false);
+        m_RefinementValues.clear();
+
+        bool needsRefinement = false;
+        for (int i = GetNumberOfBuckets() - 1;i >= 0;--i)
         {
-            if (indexedPvalues[i].second > qValue * (i + 1) / numData)
+            if (m_BucketCounts[i] == 0)
+                continue;
+
+            // The bucket maximum has the highest rank in the bucket: if rejected, it is the threshold
+            double rankThreshold = this->GetRankThreshold(m_CumulativeCounts[i]);
+            if (m_BucketMaxima[i] <= rankThreshold)
             {
-                breakingIndex = i;
+                m_RejectedBucket = i;
                 break;
             }
+
+            // Otherwise, smaller values of the bucket may only be rejected if its lower edge is below the line
+            double lowerEdge = i / m_BucketScale;
+            if (lowerEdge <= rankThreshold * (1.0 + 1.0e-12))
+            {
+                m_RefinedBuckets[i] = true;
+                needsRefinement = true;
+            }
         }
-        
-        // Now put back values to their places
-        for (unsigned int i = 0;i < numData;++i)
-            pvalues[indexedPvalues[i].first] = (i < breakingIndex);
+
+        return needsRefinement;
     }
-    
-    void BYCorrection(std::vector <double> &pvalues, double qValue)
+
+    void FDRThresholdComputer::MergeRefinement(const FDRThresholdComputer &other)
+    {
+        m_RefinementValues.insert(m_RefinementValues.end(),other.m_RefinementValues.begin(),other.m_RefinementValues.end());
+    }
+
+    double FDRThresholdComputer::ComputeThreshold()
+    {
+        if (m_CumulativeCounts.size() != GetNumberOfBuckets())
+            this->PrepareRefinement();
+
+        // Refined values are all above the rejected bucket, each one is tested with its exact rank
+        std::sort(m_RefinementValues.begin(),m_RefinementValues.end(),std::greater <double> ());
+
+        unsigned int bucketStart = 0;
+        unsigned int valueStart = 0;
+        for (unsigned int i = 0;i < m_RefinementValues.size();++i)
+        {
+            unsigned int bucket = this->GetBucketIndex(m_RefinementValues[i]);
+            if ((i == 0) || (bucket != this->GetBucketIndex(m_RefinementValues[i - 1])))
+                bucketStart = i;
+
+            if ((i == 0) || (m_RefinementValues[i] != m_RefinementValues[i - 1]))
+                valueStart = i;
+
+            unsigned long rank = m_CumulativeCounts[bucket] - (valueStart - bucketStart);
+            if (m_RefinementValues[i] <= this->GetRankThreshold(rank))
+                return m_RefinementValues[i];
+        }
+
+        if (m_RejectedBucket >= 0)
+            return m_BucketMaxima[m_RejectedBucket];
+
+        return -1.0;
+    }
+
+    void ComputeFDRAdjustedPValues(const std::vector <double> &pvalues, std::vector <double> &adjustedPValues, bool byCorrection)
     {
-        std::vector < std::pair <unsigned int, double> > indexedPvalues;
         unsigned int numData = pvalues.size();
-        
-        double byFactor = 0;
-        
+        adjustedPValues.resize(numData);
+        if (numData == 0)
+            return;
+
+        // Undefined p-values are never rejected
+        std::vector <double> sortedPValues(numData);
         for (unsigned int i = 0;i < numData;++i)
+            sortedPValues[i] = std::isnan(pvalues[i]) ? 1.0 : pvalues[i];
+
+        std::sort(sortedPValues.begin(),sortedPValues.end());
+
+        double correctionFactor = 1.0;
+        if (byCorrection)
+        {
+            correctionFactor = 0;
+            for (unsigned int i = 0;i < numData;++i)
+                correctionFactor += 1.0 / (i + 1.0);
+        }
+
+        // Running minimum from the largest p-value, ties end up with the value of their highest rank
+        std::vector <double> sortedAdjustedPValues(numData);
+        double runningMinimum = 1.0;
+        for (int i = numData - 1;i >= 0;--i)
         {
-            indexedPvalues.push_back(std::pair <unsigned int, double> (i,pvalues[i]));
-            byFactor += 1.0 / (i + 1.0);
+            double adjustedValue = sortedPValues[i] * numData * correctionFactor / (i + 1.0);
+            runningMinimum = std::min(runningMinimum,adjustedValue);
+            sortedAdjustedPValues[i] = runningMinimum;
         }
-        
-        std::sort(indexedPvalues.begin(),indexedPvalues.end(),pair_increasing_comparator());
-        
-        // Update p-values
-        unsigned int breakingIndex = 0;
+
         for (unsigned int i = 0;i < numData;++i)
         {
-            if (indexedPvalues[i].second > qValue * (i + 1) / numData / byFactor)
-            {
-                breakingIndex = i;
-                break;
-            }
+            double pvalue = std::isnan(pvalues[i]) ? 1.0 : pvalues[i];
+            unsigned int position = std::upper_bound(sortedPValues.begin(),sortedPValues.end(),pvalue) - sortedPValues.begin();
+            adjustedPValues[i] = sortedAdjustedPValues[position - 1];
         }
-        
-        // Now put back values to their places
+    }
+
+    static void FDRCorrection(std::vector <double> &pvalues, double qValue, bool byCorrection)
+    {
+        FDRThresholdComputer thresholdComputer;
+        thresholdComputer.Initialize(qValue,byCorrection);
+
+        unsigned int numData = pvalues.size();
+        for (unsigned int i = 0;i < numData;++i)
+            thresholdComputer.AddPValue(pvalues[i]);
+
+        if (thresholdComputer.PrepareRefinement())
+        {
+            for (unsigned int i = 0;i < numData;++i)
+                thresholdComputer.RefinePValue(pvalues[i]);
+        }
+
+        double threshold = thresholdComputer.ComputeThreshold();
         for (unsigned int i = 0;i < numData;++i)
-            pvalues[indexedPvalues[i].first] = (i < breakingIndex);
+            pvalues[i] = (pvalues[i] <= threshold);
     }
-    
+
+    void BHCorrection(std::vector <double> &pvalues, double qValue)
+    {
+        FDRCorrection(pvalues,qValue,false);
+    }
+
+    void BYCorrection(std::vector <double> &pvalues, double qValue)
+    {
+        FDRCorrection(pvalues,qValue,true);
+    }
+
 } // end of namespace anima
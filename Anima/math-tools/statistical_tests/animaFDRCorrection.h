@@ -5,7 +5,7 @@
 
 namespace anima
 {
-    
+
     // Pair comparison functor
     struct pair_increasing_comparator
     {
@@ -14,7 +14,108 @@ namespace anima
             return (f.second < s.second);
         }
     };
-    
+
+    /**
+     * @brief Computes the FDR rejection threshold on p-values without sorting them: step-up procedure of Benjamini
+     * and Hochberg (Eq. (1) of the reference below), rejecting all p-values below the largest p_(k) <= q k / N,
+     * or of Benjamini and Yekutieli (q replaced by q / sum_{i <= N} 1/i).
+     *
+     * A first pass builds a histogram of p-values on [0,q]. From cumulative counts, each bucket either contains the
+     * threshold, cannot contain it, or is ambiguous. Only ambiguous buckets above the highest bucket known to contain a
+     * rejected p-value need their values, gathered in a second pass over the data. Both passes accept p-values in any
+     * order and any number of chunks, and computers filled on separate chunks (threads, image slabs) can be merged.
+     *
+     * Y. Benjamini and Y. Hochberg. Controlling the False Discovery Rate: A Practical and Powerful Approach to Multiple Testing.
+     * Journal of the Royal Statistical Society. Series B (Methodological)
+     * Vol. 57, No. 1 (1995), pp. 289-300
+     */
+    class ANIMASTATISTICALTESTS_EXPORT FDRThresholdComputer
+    {
+    public:
+        FDRThresholdComputer();
+
+        //! Resets the computer, to be called before the first pass
+        void Initialize(double qValue, bool byCorrection);
+
+        //! First pass
+        void AddPValue(double pvalue)
+        {
+            ++m_NumberOfPValues;
+            if (!(pvalue <= m_QValue))
+                return;
+
+            unsigned int bucket = this->GetBucketIndex(pvalue);
+            ++m_BucketCounts[bucket];
+            if (pvalue > m_BucketMaxima[bucket])
+                m_BucketMaxima[bucket] = pvalue;
+        }
+
+        //! Adds the first pass data of a computer initialized with the same parameters
+        void Merge(const FDRThresholdComputer &other);
+
+        //! Ends the first pass. Returns true if a second pass (RefinePValue on the same p-values) is needed
+        bool PrepareRefinement();
+
+        //! Second pass
+        void RefinePValue(double pvalue)
+        {
+            if (!(pvalue <= m_QValue))
+                return;
+
+            unsigned int bucket = this->GetBucketIndex(pvalue);
+            if (m_RefinedBuckets[bucket])
+                m_RefinementValues.push_back(pvalue);
+        }
+
+        //! Adds the second pass data of a computer initialized with the same parameters
+        void MergeRefinement(const FDRThresholdComputer &other);
+
+        //! Threshold: p-values lower or equal to it are rejected, negative if no p-value is rejected
+        double ComputeThreshold();
+
+        unsigned int GetNumberOfPValues() const {return m_NumberOfPValues;}
+
+        //! Number of histogram buckets on [0,q]
+        static unsigned int GetNumberOfBuckets() {return 65536;}
+
+    protected:
+        unsigned int GetBucketIndex(double pvalue) const
+        {
+            if (pvalue <= 0)
+                return 0;
+
+            double position = pvalue * m_BucketScale;
+            if (position >= GetNumberOfBuckets() - 1)
+                return GetNumberOfBuckets() - 1;
+
+            return (unsigned int)position;
+        }
+
+        //! Line the sorted p-values are compared to, for a given rank
+        double GetRankThreshold(unsigned long rank) const;
+
+    private:
+        double m_QValue, m_BucketScale;
+        bool m_BYCorrection;
+        double m_CorrectionFactor;
+
+        unsigned int m_NumberOfPValues;
+        std::vector <unsigned int> m_BucketCounts, m_CumulativeCounts;
+        std::vector <double> m_BucketMaxima;
+
+        //! Highest bucket whose maximum is rejected, -1 if none
+        int m_RejectedBucket;
+        std::vector <bool> m_RefinedBuckets;
+        std::vector <double> m_RefinementValues;
+    };
+
+    /**
+     * @brief Adjusted p-values (q-values) of the BH or BY procedures: a p-value is rejected at level q if and only if
+     * its adjusted value is lower or equal to q. Requires a sort of the p-values.
+     */
+    ANIMASTATISTICALTESTS_EXPORT void ComputeFDRAdjustedPValues(const std::vector <double> &pvalues, std::vector <double> &adjustedPValues,
+                                                                bool byCorrection);
+
     /**
      * In place correction of p-values according to Benjamini Hochberg FDR method
      * Output is a thresholded list at the specified q-value
@@ -24,7 +125,6 @@ namespace anima
      */
     ANIMASTATISTICALTESTS_EXPORT void BHCorrection(std::vector <double> &pvalues, double qValue);
     ANIMASTATISTICALTESTS_EXPORT void BYCorrection(std::vector <double> &pvalues, double qValue);
-    
-} // end of namespace anima
 
+} // end of namespace anima
 
@@ -1,10 +1,16 @@
 #pragma once
 
 #include <itkImageToImageFilter.h>
+#include <animaFDRCorrection.h>
 
 namespace anima
 {
 
+/**
+ * @brief FDR correction of a p-value image (BH or BY procedures). Outputs the mask of rejected p-values at the
+ * given q-value and, if requested, the adjusted p-values (q-values) image as second output. The threshold is computed
+ * without sorting, in threaded passes over the image buffer.
+ */
 template <class PixelScalarType>
 class FDRCorrectImageFilter :
 public itk::ImageToImageFilter< itk::Image<PixelScalarType, 3> , itk::Image <unsigned char, 3> >
@@ -31,6 +37,9 @@ public:
     typedef itk::Image <unsigned char, 3> MaskImageType;
     typedef typename MaskImageType::Pointer MaskImagePointer;
 
+    //! Adjusted p-values image, same type as the input
+    typedef TInputImage QValueImageType;
+
     /** Superclass typedefs. */
     typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
 
@@ -38,26 +47,59 @@ public:
     itkSetMacro(QValue, double)
     itkSetMacro(BYCorrection, bool)
 
+    //! Also computes the adjusted p-values image (requires a sort of masked p-values)
+    itkSetMacro(ComputeQValues, bool)
+
+    //! P-values lower or equal to the threshold are rejected (negative if none is), available after update
+    itkGetMacro(Threshold, double)
+
+    QValueImageType *GetQValueOutput();
+
+    struct FDRThreadStruct
+    {
+        Pointer Filter;
+        std::vector <anima::FDRThresholdComputer> thresholdComputers;
+        unsigned int computationStep;
+    };
+
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadFDRComputation(void *arg);
+    void FDRComputation(FDRThreadStruct *workStr, unsigned int threadId, unsigned int numThreads);
+
 protected:
     FDRCorrectImageFilter()
     {
+        this->SetNthOutput(0, this->MakeOutput(0));
+        this->SetNthOutput(1, this->MakeOutput(1));
+        this->SetNumberOfRequiredOutputs(2);
+
         m_MaskImage = NULL;
         m_QValue = 0.05;
         m_BYCorrection = false;
+        m_ComputeQValues = false;
+        m_Threshold = -1.0;
     }
 
     virtual ~FDRCorrectImageFilter() {}
 
+    /**  Create the Output */
+    itk::DataObject::Pointer MakeOutput(unsigned int idx);
+
+    //! The correction is global: the whole image is always computed
+    void EnlargeOutputRequestedRegion(itk::DataObject *output) ITK_OVERRIDE;
+
     void GenerateData() ITK_OVERRIDE;
 
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(FDRCorrectImageFilter);
 
     void CreateFullMask();
+    void ComputeQValueImage();
 
     MaskImagePointer m_MaskImage;
     double m_QValue;
     bool m_BYCorrection;
+    bool m_ComputeQValues;
+    double m_Threshold;
 };
 
 } // end of namespace anima
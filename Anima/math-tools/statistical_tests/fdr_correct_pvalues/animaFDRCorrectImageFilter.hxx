@@ -1,75 +1,214 @@
 #pragma once
 #include "animaFDRCorrectImageFilter.h"
 
-#include <itkImageRegionConstIterator.h>
-#include <itkImageRegionIterator.h>
-
-#include <animaFDRCorrection.h>
+#include <itkPoolMultiThreader.h>
 
 namespace anima
 {
 
+template <class PixelScalarType>
+itk::DataObject::Pointer
+FDRCorrectImageFilter <PixelScalarType>
+::MakeOutput(unsigned int idx)
+{
+    itk::DataObject::Pointer output;
+
+    switch (idx)
+    {
+        case 0:
+            output = (TOutputImage::New()).GetPointer();
+            break;
+
+        case 1:
+            output = (QValueImageType::New()).GetPointer();
+            break;
+
+        default:
+            std::cerr << "No output " << idx << std::endl;
+            output = NULL;
+            break;
+    }
+
+    return output.GetPointer();
+}
+
+template <class PixelScalarType>
+typename FDRCorrectImageFilter <PixelScalarType>::QValueImageType *
+FDRCorrectImageFilter <PixelScalarType>
+::GetQValueOutput()
+{
+    return dynamic_cast <QValueImageType *> (this->itk::ProcessObject::GetOutput(1));
+}
+
+template <class PixelScalarType>
+void
+FDRCorrectImageFilter <PixelScalarType>
+::EnlargeOutputRequestedRegion(itk::DataObject *output)
+{
+    Superclass::EnlargeOutputRequestedRegion(output);
+    output->SetRequestedRegionToLargestPossibleRegion();
+}
+
 template <class PixelScalarType>
 void
 FDRCorrectImageFilter <PixelScalarType>
 ::GenerateData()
 {
-    this->AllocateOutputs();
+    // Q-values output is only allocated when requested
+    TOutputImage *output = this->GetOutput();
+    output->SetBufferedRegion(output->GetLargestPossibleRegion());
+    output->Allocate();
 
     if (!m_MaskImage)
-    {
         this->CreateFullMask();
-        this->GetOutput()->SetRequestedRegion(this->GetInput()->GetLargestPossibleRegion());
-    }
 
-    typedef itk::ImageRegionConstIterator <TInputImage> InputImageIteratorType;
-    typedef itk::ImageRegionConstIterator <MaskImageType> MaskIteratorType;
-    typedef itk::ImageRegionIterator <TOutputImage> OutputImageIteratorType;
+    // Pass 1: histogram of p-values, pass 2: gathering of ambiguous buckets values, pass 3: output mask
+    FDRThreadStruct *tmpStr = new FDRThreadStruct;
+    tmpStr->Filter = this;
 
-    MaskIteratorType maskItr(m_MaskImage, this->GetOutput()->GetRequestedRegion());
-    InputImageIteratorType inItr(this->GetInput(), this->GetOutput()->GetRequestedRegion());
-    OutputImageIteratorType outItr(this->GetOutput(), this->GetOutput()->GetRequestedRegion());
+    unsigned int numThreads = this->GetNumberOfWorkUnits();
+    tmpStr->thresholdComputers.resize(numThreads);
+    for (unsigned int i = 0;i < numThreads;++i)
+        tmpStr->thresholdComputers[i].Initialize(m_QValue,m_BYCorrection);
 
-    std::vector <double> pvalues;
+    itk::PoolMultiThreader::Pointer threaderFDR = itk::PoolMultiThreader::New();
+    threaderFDR->SetNumberOfWorkUnits(numThreads);
+    threaderFDR->SetSingleMethod(this->ThreadFDRComputation,tmpStr);
 
-    while (!maskItr.IsAtEnd())
+    tmpStr->computationStep = 0;
+    threaderFDR->SingleMethodExecute();
+
+    anima::FDRThresholdComputer &thresholdComputer = tmpStr->thresholdComputers[0];
+    for (unsigned int i = 1;i < numThreads;++i)
+        thresholdComputer.Merge(tmpStr->thresholdComputers[i]);
+
+    if (thresholdComputer.PrepareRefinement())
     {
-        if (maskItr.Get() == 0)
+        // Each thread computer is prepared the same way and refines its own part of the image
+        for (unsigned int i = 1;i < numThreads;++i)
         {
-            ++maskItr;
-            ++inItr;
-            continue;
+            tmpStr->thresholdComputers[i] = thresholdComputer;
+            tmpStr->thresholdComputers[i].PrepareRefinement();
         }
 
-        pvalues.push_back(inItr.Get());
+        tmpStr->computationStep = 1;
+        threaderFDR->SingleMethodExecute();
 
-        ++inItr;
-        ++maskItr;
+        for (unsigned int i = 1;i < numThreads;++i)
+            thresholdComputer.MergeRefinement(tmpStr->thresholdComputers[i]);
     }
 
-    if (m_BYCorrection)
-        anima::BYCorrection(pvalues, m_QValue);
-    else
-        anima::BHCorrection(pvalues, m_QValue);
+    m_Threshold = thresholdComputer.ComputeThreshold();
 
-    maskItr.GoToBegin();
+    tmpStr->computationStep = 2;
+    threaderFDR->SingleMethodExecute();
 
-    unsigned int pos = 0;
-    while (!maskItr.IsAtEnd())
+    delete tmpStr;
+
+    if (m_ComputeQValues)
+        this->ComputeQValueImage();
+}
+
+template <class PixelScalarType>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+FDRCorrectImageFilter <PixelScalarType>
+::ThreadFDRComputation(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+
+    unsigned int nbThread = threadArgs->WorkUnitID;
+    unsigned int nbProcs = threadArgs->NumberOfWorkUnits;
+
+    FDRThreadStruct *tmpStr = (FDRThreadStruct *)threadArgs->UserData;
+
+    tmpStr->Filter->FDRComputation(tmpStr,nbThread,nbProcs);
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <class PixelScalarType>
+void
+FDRCorrectImageFilter <PixelScalarType>
+::FDRComputation(FDRThreadStruct *workStr, unsigned int threadId, unsigned int numThreads)
+{
+    unsigned int numPixels = this->GetOutput()->GetLargestPossibleRegion().GetNumberOfPixels();
+    unsigned int step = numPixels / numThreads;
+
+    unsigned int startPixel = threadId * step;
+    unsigned int endPixel = (threadId + 1) * step;
+
+    if (threadId + 1 == numThreads)
+        endPixel = numPixels;
+
+    const InputImagePixel *inputBuffer = this->GetInput()->GetBufferPointer();
+    const unsigned char *maskBuffer = m_MaskImage->GetBufferPointer();
+    anima::FDRThresholdComputer &thresholdComputer = workStr->thresholdComputers[threadId];
+
+    switch (workStr->computationStep)
     {
-        if (maskItr.Get() == 0)
+        case 0:
+            for (unsigned int i = startPixel;i < endPixel;++i)
+            {
+                if (maskBuffer[i] != 0)
+                    thresholdComputer.AddPValue(inputBuffer[i]);
+            }
+
+            break;
+
+        case 1:
+            for (unsigned int i = startPixel;i < endPixel;++i)
+            {
+                if (maskBuffer[i] != 0)
+                    thresholdComputer.RefinePValue(inputBuffer[i]);
+            }
+
+            break;
+
+        case 2:
+        default:
         {
-            ++maskItr;
-            outItr.Set(0);
-            ++outItr;
-            continue;
+            unsigned char *outputBuffer = this->GetOutput()->GetBufferPointer();
+            for (unsigned int i = startPixel;i < endPixel;++i)
+                outputBuffer[i] = (maskBuffer[i] != 0) && (inputBuffer[i] <= m_Threshold);
+
+            break;
         }
+    }
+}
+
+template <class PixelScalarType>
+void
+FDRCorrectImageFilter <PixelScalarType>
+::ComputeQValueImage()
+{
+    QValueImageType *qValueImage = this->GetQValueOutput();
+    qValueImage->SetBufferedRegion(qValueImage->GetLargestPossibleRegion());
+    qValueImage->Allocate();
+    qValueImage->FillBuffer(1.0);
+
+    unsigned int numPixels = qValueImage->GetLargestPossibleRegion().GetNumberOfPixels();
+    const InputImagePixel *inputBuffer = this->GetInput()->GetBufferPointer();
+    const unsigned char *maskBuffer = m_MaskImage->GetBufferPointer();
+    InputImagePixel *qValueBuffer = qValueImage->GetBufferPointer();
 
-        outItr.Set(pvalues[pos]);
-        ++pos;
+    std::vector <double> pvalues;
+    for (unsigned int i = 0;i < numPixels;++i)
+    {
+        if (maskBuffer[i] != 0)
+            pvalues.push_back(inputBuffer[i]);
+    }
+
+    std::vector <double> qvalues;
+    anima::ComputeFDRAdjustedPValues(pvalues,qvalues,m_BYCorrection);
 
-        ++outItr;
-        ++maskItr;
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < numPixels;++i)
+    {
+        if (maskBuffer[i] != 0)
+        {
+            qValueBuffer[i] = qvalues[pos];
+            ++pos;
+        }
     }
 }
 
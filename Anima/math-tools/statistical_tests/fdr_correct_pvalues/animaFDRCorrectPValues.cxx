@@ -7,11 +7,13 @@ int main(int argc, char **argv)
 {
     TCLAP::CmdLine cmd("INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
 
-    TCLAP::ValueArg<std::string> inArg("i","input","Non corrected P-value image",true,"","Non corrected P-value image",cmd);
-    TCLAP::ValueArg<std::string> resArg("o","output","FDR thresholded output image at q",true,"","FDR corrected output image at q",cmd);
+    TCLAP::MultiArg<std::string> inArg("i","input","Non corrected P-value image (may be used several times, each one is corrected separately)",true,"Non corrected P-value image",cmd);
+    TCLAP::MultiArg<std::string> resArg("o","output","FDR thresholded output image at q (one for each input)",true,"FDR corrected output image at q",cmd);
+    TCLAP::MultiArg<std::string> qValuesArg("Q","qvalues-output","Adjusted p-values (q-values) output image (optional, one for each input)",false,"q-values output image",cmd);
     TCLAP::ValueArg<double> qArg("q","q-val","FDR q value",true,0.05,"FDR q value",cmd);
     TCLAP::SwitchArg byCorrArg("Y", "by-corr", "Use BY correction (if not set, BH correction is used)", cmd, false);
     TCLAP::ValueArg<std::string> maskArg("m","mask","Mask image (default: all pixels are in mask)",false,"","Mask image",cmd);
+    TCLAP::ValueArg<unsigned int> numThreadsArg("T","threads","Number of execution threads (default: all cores)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
 
     try
     {
@@ -23,22 +25,53 @@ int main(int argc, char **argv)
         return(1);
     }
 
-    typedef anima::FDRCorrectImageFilter<double> MainFilterType;
+    std::vector <std::string> inputNames = inArg.getValue();
+    std::vector <std::string> outputNames = resArg.getValue();
+    std::vector <std::string> qValuesNames = qValuesArg.getValue();
+
+    if (outputNames.size() != inputNames.size())
+    {
+        std::cerr << "Error: the number of outputs should match the number of inputs" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-    MainFilterType::Pointer mainFilter = MainFilterType::New();
+    if ((qValuesNames.size() != 0) && (qValuesNames.size() != inputNames.size()))
+    {
+        std::cerr << "Error: the number of q-values outputs should match the number of inputs" << std::endl;
+        return EXIT_FAILURE;
+    }
 
-    mainFilter->SetInput(anima::readImage<MainFilterType::TInputImage> (inArg.getValue()));
-    mainFilter->SetQValue(qArg.getValue());
-    mainFilter->SetBYCorrection(byCorrArg.isSet());
+    typedef anima::FDRCorrectImageFilter<double> MainFilterType;
 
+    // Mask is read once and shared by all contrasts
+    MainFilterType::MaskImagePointer maskImage;
     if (maskArg.getValue() != "")
-        mainFilter->SetMaskImage(anima::readImage <MainFilterType::MaskImageType> (maskArg.getValue()));
+        maskImage = anima::readImage <MainFilterType::MaskImageType> (maskArg.getValue());
+
+    for (unsigned int i = 0;i < inputNames.size();++i)
+    {
+        MainFilterType::Pointer mainFilter = MainFilterType::New();
 
-    mainFilter->Update();
+        mainFilter->SetInput(anima::readImage<MainFilterType::TInputImage> (inputNames[i]));
+        mainFilter->SetQValue(qArg.getValue());
+        mainFilter->SetBYCorrection(byCorrArg.isSet());
+        mainFilter->SetComputeQValues(qValuesNames.size() != 0);
+        mainFilter->SetNumberOfWorkUnits(numThreadsArg.getValue());
 
-    std::cout << "Writing result to : " << resArg.getValue() << std::endl;
+        if (maskImage)
+            mainFilter->SetMaskImage(maskImage);
 
-    anima::writeImage<MainFilterType::TOutputImage>(resArg.getValue(), mainFilter->GetOutput());
+        mainFilter->Update();
+
+        std::cout << "Writing result to : " << outputNames[i] << " (p-value threshold: " << mainFilter->GetThreshold() << ")" << std::endl;
+        anima::writeImage<MainFilterType::TOutputImage>(outputNames[i], mainFilter->GetOutput());
+
+        if (qValuesNames.size() != 0)
+        {
+            std::cout << "Writing q-values to : " << qValuesNames[i] << std::endl;
+            anima::writeImage<MainFilterType::QValueImageType>(qValuesNames[i], mainFilter->GetQValueOutput());
+        }
+    }
 
-    return 0;
+    return EXIT_SUCCESS;
 }
@@ -0,0 +1,194 @@
+#include <animaFDRCorrection.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+//! Reference BH / BY step-up procedure on fully sorted p-values: rejects p-values below the largest p_(k) <= q k / (N c)
+std::vector <bool> SortedFDRRejection(const std::vector <double> &pvalues, double qValue, bool byCorrection)
+{
+    unsigned int numData = pvalues.size();
+    std::vector <double> sortedPValues;
+    for (unsigned int i = 0;i < numData;++i)
+    {
+        if (!std::isnan(pvalues[i]))
+            sortedPValues.push_back(pvalues[i]);
+    }
+
+    std::sort(sortedPValues.begin(),sortedPValues.end());
+
+    double correctionFactor = 1.0;
+    if (byCorrection)
+    {
+        correctionFactor = 0;
+        for (unsigned int i = 0;i < numData;++i)
+            correctionFactor += 1.0 / (i + 1.0);
+    }
+
+    double threshold = -1.0;
+    for (int i = sortedPValues.size() - 1;i >= 0;--i)
+    {
+        if (sortedPValues[i] <= qValue * (i + 1.0) / numData / correctionFactor)
+        {
+            threshold = sortedPValues[i];
+            break;
+        }
+    }
+
+    std::vector <bool> rejected(numData,false);
+    for (unsigned int i = 0;i < numData;++i)
+        rejected[i] = (pvalues[i] <= threshold);
+
+    return rejected;
+}
+
+//! Selection based rejection, with p-values split in chunks handled by separate merged computers
+std::vector <bool> SelectionFDRRejection(const std::vector <double> &pvalues, double qValue, bool byCorrection, unsigned int numChunks)
+{
+    unsigned int numData = pvalues.size();
+    std::vector <anima::FDRThresholdComputer> computers(numChunks);
+    for (unsigned int i = 0;i < numChunks;++i)
+        computers[i].Initialize(qValue,byCorrection);
+
+    for (unsigned int i = 0;i < numData;++i)
+        computers[i % numChunks].AddPValue(pvalues[i]);
+
+    for (unsigned int i = 1;i < numChunks;++i)
+        computers[0].Merge(computers[i]);
+
+    if (computers[0].PrepareRefinement())
+    {
+        // Chunk computers need the merged first pass to know which buckets are refined
+        for (unsigned int i = 1;i < numChunks;++i)
+        {
+            computers[i] = computers[0];
+            computers[i].PrepareRefinement();
+        }
+
+        for (unsigned int i = 0;i < numData;++i)
+            computers[i % numChunks].RefinePValue(pvalues[i]);
+
+        for (unsigned int i = 1;i < numChunks;++i)
+            computers[0].MergeRefinement(computers[i]);
+    }
+
+    double threshold = computers[0].ComputeThreshold();
+    std::vector <bool> rejected(numData,false);
+    for (unsigned int i = 0;i < numData;++i)
+        rejected[i] = (pvalues[i] <= threshold);
+
+    return rejected;
+}
+
+//! Compares selection based rejection (in one and several chunks), in place corrections and adjusted p-values to the reference
+bool TestPValues(const std::string &testName, const std::vector <double> &pvalues, double qValue)
+{
+    bool success = true;
+    unsigned int numRejected[2] = {0, 0};
+    for (unsigned int k = 0;k < 2;++k)
+    {
+        bool byCorrection = (k == 1);
+        std::vector <bool> referenceRejection = SortedFDRRejection(pvalues,qValue,byCorrection);
+        numRejected[k] = std::count(referenceRejection.begin(),referenceRejection.end(),true);
+
+        success &= (SelectionFDRRejection(pvalues,qValue,byCorrection,1) == referenceRejection);
+        success &= (SelectionFDRRejection(pvalues,qValue,byCorrection,7) == referenceRejection);
+
+        std::vector <double> correctedValues = pvalues;
+        if (byCorrection)
+            anima::BYCorrection(correctedValues,qValue);
+        else
+            anima::BHCorrection(correctedValues,qValue);
+
+        std::vector <double> adjustedPValues;
+        anima::ComputeFDRAdjustedPValues(pvalues,adjustedPValues,byCorrection);
+
+        for (unsigned int i = 0;i < pvalues.size();++i)
+        {
+            success &= ((correctedValues[i] != 0) == referenceRejection[i]);
+            // Adjusted values are products of p-values, compare with a relative tolerance around q
+            if (std::abs(adjustedPValues[i] - qValue) > 1.0e-12 * qValue)
+                success &= ((adjustedPValues[i] <= qValue) == referenceRejection[i]);
+        }
+    }
+
+    std::cout << testName << ": " << numRejected[0] << " (BH) and " << numRejected[1] << " (BY) rejected out of "
+              << pvalues.size() << (success ? " -> OK" : " -> FAILED") << std::endl;
+
+    return success;
+}
+
+int main()
+{
+    std::mt19937 generator(0);
+    std::uniform_real_distribution <double> uniformDistribution(0.0,1.0);
+    double qValue = 0.05;
+    bool success = true;
+
+    // Null p-values mixed with small p-values, large enough for ambiguous histogram buckets
+    unsigned int numData = 200000;
+    std::vector <double> pvalues(numData);
+    for (unsigned int i = 0;i < numData;++i)
+    {
+        pvalues[i] = uniformDistribution(generator);
+        if (i % 5 == 0)
+            pvalues[i] *= 1.0e-3;
+    }
+
+    success &= TestPValues("Mixed p-values",pvalues,qValue);
+
+    // Many ties: quantized p-values, and values on the histogram bucket edges
+    for (unsigned int i = 0;i < numData;++i)
+        pvalues[i] = std::floor(pvalues[i] * 1.0e4) / 1.0e4;
+
+    success &= TestPValues("Quantized p-values",pvalues,qValue);
+
+    double bucketWidth = qValue / anima::FDRThresholdComputer::GetNumberOfBuckets();
+    for (unsigned int i = 0;i < numData;++i)
+    {
+        if (i % 2 == 0)
+            pvalues[i] = bucketWidth * std::floor(uniformDistribution(generator) * anima::FDRThresholdComputer::GetNumberOfBuckets() / 4.0);
+        else
+            pvalues[i] = uniformDistribution(generator);
+    }
+
+    success &= TestPValues("Bucket edge p-values",pvalues,qValue);
+
+    // Ties exactly on the rejection line: n values equal to q n / N are all rejected
+    numData = 1000;
+    pvalues.resize(numData);
+    for (unsigned int i = 0;i < numData;++i)
+        pvalues[i] = (i < 100) ? qValue * 100.0 / numData : 0.5 + 0.5 * uniformDistribution(generator);
+
+    success &= TestPValues("Ties on the rejection line",pvalues,qValue);
+
+    // Step-up: p-values above the line for low ranks and below it for higher ranks are all rejected
+    for (unsigned int i = 0;i < numData;++i)
+        pvalues[i] = (i < 300) ? qValue * 290.0 / numData : uniformDistribution(generator);
+
+    success &= TestPValues("Step-up over the line",pvalues,qValue);
+
+    // All and none rejected
+    for (unsigned int i = 0;i < numData;++i)
+        pvalues[i] = qValue * uniformDistribution(generator) * 1.0e-3;
+
+    success &= TestPValues("All rejected",pvalues,qValue);
+
+    for (unsigned int i = 0;i < numData;++i)
+        pvalues[i] = qValue / numData * (1.0 + 1.0e-9) + (1.0 - qValue / numData) * uniformDistribution(generator) * 0.99;
+
+    success &= TestPValues("None rejected",pvalues,qValue);
+
+    // Undefined p-values are never rejected but count in the number of tests
+    for (unsigned int i = 0;i < numData;++i)
+        pvalues[i] = (i % 3 == 0) ? std::numeric_limits <double>::quiet_NaN() : 1.0e-3 * uniformDistribution(generator);
+
+    success &= TestPValues("Undefined p-values",pvalues,qValue);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
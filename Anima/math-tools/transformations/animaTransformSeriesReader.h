@@ -1,6 +1,8 @@
 #pragma once
 
 #include <itkCompositeTransform.h>
+#include <itkImage.h>
+#include <itkMatrixOffsetTransformBase.h>
 
 namespace anima
 {
@@ -26,6 +28,12 @@ public:
     typedef itk::CompositeTransform <TScalarType,NDimensions> OutputTransformType;
     typedef typename OutputTransformType::Pointer OutputTransformPointer;
 
+    typedef itk::MatrixOffsetTransformBase <TScalarType,NDimensions> MatrixTransformType;
+    typedef typename MatrixTransformType::Pointer MatrixTransformPointer;
+
+    typedef itk::ImageBase <NDimensions> GeometryImageType;
+    typedef typename GeometryImageType::ConstPointer GeometryImageConstPointer;
+
     TransformSeriesReader();
     ~TransformSeriesReader();
 
@@ -34,6 +42,18 @@ public:
     void SetNumberOfWorkUnits(unsigned int num) {m_NumberOfThreads = num;}
     void SetExponentiationOrder(unsigned int val) {m_ExponentiationOrder = val;}
 
+    //! Compose consecutive linear transforms of the series into a single matrix transform
+    void SetFuseLinearTransforms(bool val) {m_FuseLinearTransforms = val;}
+
+    /**
+     * If set, the non linear series is flattened on this geometry into a single displacement field,
+     * the output transform then holds only that field
+     */
+    void SetBakingGeometry(const GeometryImageType *geom) {m_BakingGeometry = geom;}
+
+    //! Directory where baked fields are stored and looked up, keyed by a hash of the series (empty: no cache)
+    void SetCacheDirectory(std::string const& dirName) {m_CacheDirectory = dirName;}
+
     void Update();
 
     OutputTransformType *GetOutputTransform() {return m_OutputTransform;}
@@ -43,10 +63,23 @@ protected:
     void addSVFTransformation(std::string &fileName, bool invert);
     void addDenseTransformation(std::string &fileName, bool invert);
 
+    //! Replaces the output transform by its displacement field sampled on the baking geometry
+    void bakeOutputTransform(std::vector <TransformInformation> &transformationList);
+
+    //! Hash of the transform list, its files, reading options and baking geometry, used as cache key
+    std::string computeCacheKey(std::vector <TransformInformation> &transformationList);
+
 private:
     OutputTransformPointer m_OutputTransform;
     bool m_InvertTransform;
 
+    bool m_FuseLinearTransforms;
+    //! Last linear transform added, composed with the next ones when fusing is on
+    MatrixTransformPointer m_LastLinearTransform;
+
+    GeometryImageConstPointer m_BakingGeometry;
+    std::string m_CacheDirectory;
+
     unsigned int m_NumberOfThreads;
     unsigned int m_ExponentiationOrder;
 
@@ -5,6 +5,14 @@
 
 #include <itkTransformFileReader.h>
 #include <itkImageFileReader.h>
+#include <itkImageFileWriter.h>
+#include <itkTransformToDisplacementFieldFilter.h>
+#include <itksys/SystemTools.hxx>
+
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
 
 #include <itkMatrixOffsetTransformBase.h>
 #include <itkStationaryVelocityFieldTransform.h>
@@ -20,6 +28,11 @@ TransformSeriesReader<TScalarType,NDimensions>
 {
     m_OutputTransform = NULL;
     m_InvertTransform = false;
+    m_FuseLinearTransforms = false;
+
+    m_LastLinearTransform = nullptr;
+    m_BakingGeometry = nullptr;
+    m_CacheDirectory = "";
 
     m_ExponentiationOrder = 1;
     m_NumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
@@ -38,6 +51,7 @@ TransformSeriesReader<TScalarType,NDimensions>
 ::Update()
 {
     m_OutputTransform = OutputTransformType::New();
+    m_LastLinearTransform = nullptr;
     std::vector <TransformInformation> transformationList;
 
     tinyxml2::XMLDocument doc;
@@ -156,6 +170,10 @@ TransformSeriesReader<TScalarType,NDimensions>
     }
 
     std::cout << "Loaded " << m_OutputTransform->GetNumberOfTransforms() << " transformations from transform list file: " << m_Input << std::endl;
+
+    // A purely linear serie is cheaper to evaluate than any field, only bake non linear ones
+    if (m_BakingGeometry && !m_OutputTransform->IsLinear())
+        this->bakeOutputTransform(transformationList);
 }
 
 template <class TScalarType, unsigned int NDimensions>
@@ -163,9 +181,6 @@ void
 TransformSeriesReader<TScalarType,NDimensions>
 ::addLinearTransformation(std::string &fileName,bool invert)
 {
-    typedef itk::MatrixOffsetTransformBase <TScalarType,NDimensions> MatrixTransformType;
-    typedef typename MatrixTransformType::Pointer MatrixTransformPointer;
-
     itk::TransformFileReader::Pointer reader = itk::TransformFileReader::New();
     reader->SetFileName(fileName);
     reader->Update();
@@ -183,6 +198,25 @@ TransformSeriesReader<TScalarType,NDimensions>
         trsf = tmpInvert;
     }
 
+    if (m_FuseLinearTransforms)
+    {
+        unsigned int numTransforms = m_OutputTransform->GetNumberOfTransforms();
+        if (m_LastLinearTransform && (numTransforms > 0) &&
+                (m_OutputTransform->GetNthTransform(numTransforms - 1).GetPointer() == m_LastLinearTransform.GetPointer()))
+        {
+            // The composite transform applies the last added transform first, hence the pre-composition
+            m_LastLinearTransform->Compose(trsf,true);
+            return;
+        }
+
+        MatrixTransformPointer fusedTrsf = MatrixTransformType::New();
+        fusedTrsf->SetIdentity();
+        fusedTrsf->Compose(trsf);
+
+        m_LastLinearTransform = fusedTrsf;
+        trsf = fusedTrsf;
+    }
+
     m_OutputTransform->AddTransform(trsf);
 }
 
@@ -240,4 +274,149 @@ TransformSeriesReader<TScalarType,NDimensions>
     m_OutputTransform->AddTransform(dispTrsf);
 }
 
+template <class TScalarType, unsigned int NDimensions>
+void
+TransformSeriesReader<TScalarType,NDimensions>
+::bakeOutputTransform(std::vector <TransformInformation> &transformationList)
+{
+    typedef rpi::DisplacementFieldTransform <TScalarType,NDimensions> DenseTransformType;
+    typedef typename DenseTransformType::Pointer DenseTransformPointer;
+    typedef typename DenseTransformType::VectorFieldType DisplacementFieldType;
+    typedef typename DisplacementFieldType::Pointer DisplacementFieldPointer;
+
+    DisplacementFieldPointer bakedField;
+    std::string cacheFileName = "";
+
+    if (m_CacheDirectory != "")
+    {
+        itksys::SystemTools::MakeDirectory(m_CacheDirectory);
+        cacheFileName = m_CacheDirectory + "/animaBakedTransform_" + this->computeCacheKey(transformationList) + ".nrrd";
+
+        if (itksys::SystemTools::FileExists(cacheFileName,true))
+        {
+            typedef itk::ImageFileReader <DisplacementFieldType> DispReaderType;
+            typename DispReaderType::Pointer fieldReader = DispReaderType::New();
+            fieldReader->SetFileName(cacheFileName);
+            fieldReader->Update();
+
+            bakedField = fieldReader->GetOutput();
+            bakedField->DisconnectPipeline();
+
+            std::cout << "Loaded baked transformation from cache: " << cacheFileName << std::endl;
+        }
+    }
+
+    if (!bakedField)
+    {
+        typedef itk::TransformToDisplacementFieldFilter <DisplacementFieldType, TScalarType> DisplacementFieldGeneratorType;
+        typename DisplacementFieldGeneratorType::Pointer fieldGenerator = DisplacementFieldGeneratorType::New();
+
+        fieldGenerator->SetReferenceImage(m_BakingGeometry);
+        fieldGenerator->UseReferenceImageOn();
+        fieldGenerator->SetTransform(m_OutputTransform);
+        fieldGenerator->SetNumberOfWorkUnits(m_NumberOfThreads);
+        fieldGenerator->Update();
+
+        bakedField = fieldGenerator->GetOutput();
+        bakedField->DisconnectPipeline();
+
+        if (cacheFileName != "")
+        {
+            // Write to a temporary file first so that concurrent runs never read a partial field
+            std::random_device randomDevice;
+            std::ostringstream tmpFileName;
+            tmpFileName << m_CacheDirectory << "/tmp_" << std::hex << randomDevice() << randomDevice() << ".nrrd";
+
+            typedef itk::ImageFileWriter <DisplacementFieldType> DispWriterType;
+            typename DispWriterType::Pointer fieldWriter = DispWriterType::New();
+            fieldWriter->SetUseCompression(false);
+            fieldWriter->SetFileName(tmpFileName.str());
+            fieldWriter->SetInput(bakedField);
+            fieldWriter->Update();
+
+            if (std::rename(tmpFileName.str().c_str(),cacheFileName.c_str()) != 0)
+                itksys::SystemTools::RemoveFile(tmpFileName.str());
+        }
+    }
+
+    DenseTransformPointer bakedTrsf = DenseTransformType::New();
+    bakedTrsf->SetParametersAsVectorField(bakedField.GetPointer());
+
+    m_OutputTransform = OutputTransformType::New();
+    m_OutputTransform->AddTransform(bakedTrsf);
+    m_LastLinearTransform = nullptr;
+
+    std::cout << "Transformation serie baked into a single displacement field" << std::endl;
+}
+
+template <class TScalarType, unsigned int NDimensions>
+std::string
+TransformSeriesReader<TScalarType,NDimensions>
+::computeCacheKey(std::vector <TransformInformation> &transformationList)
+{
+    // 64 bits FNV-1a hash, enough to tell apart transform series in a cache directory
+    uint64_t hashValue = 14695981039346656037ULL;
+    auto hashBytes = [&hashValue] (const char *data, std::size_t size)
+    {
+        for (std::size_t i = 0;i < size;++i)
+        {
+            hashValue ^= static_cast <unsigned char> (data[i]);
+            hashValue *= 1099511628211ULL;
+        }
+    };
+
+    auto hashFile = [&hashBytes] (const std::string &fileName)
+    {
+        std::ifstream fileIn(fileName.c_str(), std::ios::binary);
+        if (!fileIn.is_open())
+        {
+            std::string error("Unable to read file for cache key computation: ");
+            error += fileName;
+            throw itk::ExceptionObject(__FILE__, __LINE__,error,ITK_LOCATION);
+        }
+
+        std::vector <char> buffer(1 << 20);
+        while (fileIn)
+        {
+            fileIn.read(buffer.data(),buffer.size());
+            hashBytes(buffer.data(),fileIn.gcount());
+        }
+    };
+
+    hashFile(m_Input);
+    for (unsigned int i = 0;i < transformationList.size();++i)
+    {
+        hashFile(transformationList[i].fileName);
+        hashBytes(reinterpret_cast <const char *> (&transformationList[i].trType),sizeof(TransformationType));
+        hashBytes(reinterpret_cast <const char *> (&transformationList[i].invert),sizeof(bool));
+    }
+
+    hashBytes(reinterpret_cast <const char *> (&m_InvertTransform),sizeof(bool));
+    hashBytes(reinterpret_cast <const char *> (&m_ExponentiationOrder),sizeof(unsigned int));
+
+    for (unsigned int i = 0;i < NDimensions;++i)
+    {
+        double origin = m_BakingGeometry->GetOrigin()[i];
+        double spacing = m_BakingGeometry->GetSpacing()[i];
+        long index = m_BakingGeometry->GetLargestPossibleRegion().GetIndex()[i];
+        unsigned long size = m_BakingGeometry->GetLargestPossibleRegion().GetSize()[i];
+
+        hashBytes(reinterpret_cast <const char *> (&origin),sizeof(double));
+        hashBytes(reinterpret_cast <const char *> (&spacing),sizeof(double));
+        hashBytes(reinterpret_cast <const char *> (&index),sizeof(long));
+        hashBytes(reinterpret_cast <const char *> (&size),sizeof(unsigned long));
+
+        for (unsigned int j = 0;j < NDimensions;++j)
+        {
+            double directionValue = m_BakingGeometry->GetDirection()(i,j);
+            hashBytes(reinterpret_cast <const char *> (&directionValue),sizeof(double));
+        }
+    }
+
+    std::ostringstream keyStream;
+    keyStream << std::hex << std::setw(16) << std::setfill('0') << hashValue;
+
+    return keyStream.str();
+}
+
 } // end of namespace anima
@@ -0,0 +1,319 @@
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "animaEPGSignalTable.h"
+
+namespace anima
+{
+
+EPGSignalTable::EPGSignalTable()
+{
+    m_NumberOfEchoes = 1;
+    m_EchoSpacing = 10;
+    m_ExcitationFlipAngle = M_PI / 2.0;
+
+    m_MinimalT1 = m_MaximalT1 = 1000;
+    m_MinimalT2 = 1;
+    m_MaximalT2 = 1000;
+    m_MinimalFlipAngle = m_MaximalFlipAngle = M_PI;
+
+    m_MaximalError = 1.0e-4;
+    m_MaximalTableSize = 1 << 24;
+    m_EstimatedError = 0;
+
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        m_AxisMinimum[i] = m_AxisMaximum[i] = 0;
+        m_AxisSize[i] = 1;
+    }
+}
+
+double EPGSignalTable::GetDecayValue(double relaxationTime) const
+{
+    return std::exp(- m_EchoSpacing / (2.0 * relaxationTime));
+}
+
+double EPGSignalTable::GetRelaxationTime(double decayValue) const
+{
+    return - m_EchoSpacing / (2.0 * std::log(decayValue));
+}
+
+bool EPGSignalTable::Build()
+{
+    m_AxisMinimum[0] = this->GetDecayValue(m_MinimalT1);
+    m_AxisMaximum[0] = this->GetDecayValue(m_MaximalT1);
+    m_AxisMinimum[1] = this->GetDecayValue(m_MinimalT2);
+    m_AxisMaximum[1] = this->GetDecayValue(m_MaximalT2);
+    m_AxisMinimum[2] = m_MinimalFlipAngle;
+    m_AxisMaximum[2] = m_MaximalFlipAngle;
+
+    // Signals depend weakly on T1, start coarser on that axis
+    unsigned int initialSizes[3] = {3, 5, 5};
+    for (unsigned int i = 0;i < 3;++i)
+        m_AxisSize[i] = (m_AxisMaximum[i] > m_AxisMinimum[i]) ? initialSizes[i] : 1;
+
+    anima::EPGSignalSimulator simulator;
+    simulator.SetNumberOfEchoes(m_NumberOfEchoes);
+    simulator.SetEchoSpacing(m_EchoSpacing);
+    simulator.SetExcitationFlipAngle(m_ExcitationFlipAngle);
+
+    // Errors of each axis add up in the interpolation
+    double axisMaximalError = m_MaximalError / 3.0;
+    double axisErrors[3] = {0, 0, 0};
+
+    while (true)
+    {
+        // Simulated signals out of double range: no valid table for these parameter ranges
+        if (!this->FillTable(simulator))
+        {
+            m_EstimatedError = std::numeric_limits <double>::infinity();
+            return false;
+        }
+
+        bool refineAxis[3];
+        bool anyRefinement = false;
+        unsigned int newTableSize = m_NumberOfEchoes;
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            axisErrors[i] = 0;
+            if (m_AxisSize[i] > 1)
+            {
+                bool useAxis[3] = {false, false, false};
+                useAxis[i] = true;
+                axisErrors[i] = this->ComputeMidpointsError(simulator,useAxis);
+            }
+
+            refineAxis[i] = (axisErrors[i] > axisMaximalError);
+            anyRefinement = anyRefinement || refineAxis[i];
+            newTableSize *= refineAxis[i] ? 2 * m_AxisSize[i] - 1 : m_AxisSize[i];
+        }
+
+        if ((!anyRefinement) || (newTableSize > m_MaximalTableSize))
+            break;
+
+        for (unsigned int i = 0;i < 3;++i)
+        {
+            if (refineAxis[i])
+                m_AxisSize[i] = 2 * m_AxisSize[i] - 1;
+        }
+    }
+
+    bool useAllAxes[3];
+    for (unsigned int i = 0;i < 3;++i)
+        useAllAxes[i] = (m_AxisSize[i] > 1);
+
+    m_EstimatedError = std::max(axisErrors[0],std::max(axisErrors[1],axisErrors[2]));
+    m_EstimatedError = std::max(m_EstimatedError,this->ComputeMidpointsError(simulator,useAllAxes));
+
+    return (m_EstimatedError <= m_MaximalError);
+}
+
+double EPGSignalTable::GetNextDecayFactor(double decayFactor, double squaredDecay) const
+{
+    // Bounded below so that factored values stay finite for short T2 and long echo trains
+    const double minimalDecayFactor = 1.0e-30;
+    return std::max(decayFactor * squaredDecay,minimalDecayFactor);
+}
+
+bool EPGSignalTable::FillTable(EPGSignalSimulator &simulator)
+{
+    m_Values.resize(m_AxisSize[0] * m_AxisSize[1] * m_AxisSize[2] * m_NumberOfEchoes);
+
+    double axisSteps[3];
+    for (unsigned int i = 0;i < 3;++i)
+        axisSteps[i] = (m_AxisSize[i] > 1) ? (m_AxisMaximum[i] - m_AxisMinimum[i]) / (m_AxisSize[i] - 1.0) : 0.0;
+
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < m_AxisSize[0];++i)
+    {
+        double t1Value = this->GetRelaxationTime(m_AxisMinimum[0] + i * axisSteps[0]);
+        for (unsigned int j = 0;j < m_AxisSize[1];++j)
+        {
+            double decayValue = m_AxisMinimum[1] + j * axisSteps[1];
+            double t2Value = this->GetRelaxationTime(decayValue);
+            double squaredDecay = decayValue * decayValue;
+            for (unsigned int k = 0;k < m_AxisSize[2];++k)
+            {
+                RealVectorType &signal = simulator.GetValue(t1Value,t2Value,m_AxisMinimum[2] + k * axisSteps[2],1.0);
+
+                // Pure T2 decay of each echo is factored out
+                double decayFactor = 1.0;
+                for (unsigned int e = 0;e < m_NumberOfEchoes;++e)
+                {
+                    decayFactor = this->GetNextDecayFactor(decayFactor,squaredDecay);
+                    m_Values[pos] = signal[e] / decayFactor;
+                    if (!std::isfinite(m_Values[pos]))
+                        return false;
+
+                    ++pos;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+double EPGSignalTable::ComputeMidpointsError(EPGSignalSimulator &simulator, const bool *useAxis)
+{
+    unsigned int numPositions[3];
+    double axisSteps[3], axisOffsets[3];
+    for (unsigned int i = 0;i < 3;++i)
+    {
+        bool midpoints = useAxis[i] && (m_AxisSize[i] > 1);
+        numPositions[i] = midpoints ? m_AxisSize[i] - 1 : m_AxisSize[i];
+        axisSteps[i] = (m_AxisSize[i] > 1) ? (m_AxisMaximum[i] - m_AxisMinimum[i]) / (m_AxisSize[i] - 1.0) : 0.0;
+        axisOffsets[i] = midpoints ? axisSteps[i] / 2.0 : 0.0;
+    }
+
+    std::vector <double> interpolatedSignal(m_NumberOfEchoes);
+    double decayValues[3];
+    double maximalError = 0;
+
+    for (unsigned int i = 0;i < numPositions[0];++i)
+    {
+        decayValues[0] = m_AxisMinimum[0] + axisOffsets[0] + i * axisSteps[0];
+        double t1Value = this->GetRelaxationTime(decayValues[0]);
+        for (unsigned int j = 0;j < numPositions[1];++j)
+        {
+            decayValues[1] = m_AxisMinimum[1] + axisOffsets[1] + j * axisSteps[1];
+            double t2Value = this->GetRelaxationTime(decayValues[1]);
+            for (unsigned int k = 0;k < numPositions[2];++k)
+            {
+                decayValues[2] = m_AxisMinimum[2] + axisOffsets[2] + k * axisSteps[2];
+
+                RealVectorType &signal = simulator.GetValue(t1Value,t2Value,decayValues[2],1.0);
+                this->Interpolate(decayValues,1.0,interpolatedSignal.data());
+
+                for (unsigned int e = 0;e < m_NumberOfEchoes;++e)
+                {
+                    // std::max would drop NaN errors
+                    double error = std::abs(signal[e] - interpolatedSignal[e]);
+                    if (!std::isfinite(error))
+                        return std::numeric_limits <double>::infinity();
+
+                    maximalError = std::max(maximalError,error);
+                }
+            }
+        }
+    }
+
+    return maximalError;
+}
+
+bool EPGSignalTable::IsInside(double t1Value, double t2Value, double flipAngle) const
+{
+    const double tolerance = 1.0e-12;
+
+    if ((t1Value < m_MinimalT1 * (1.0 - tolerance)) || (t1Value > m_MaximalT1 * (1.0 + tolerance)))
+        return false;
+
+    if ((t2Value < m_MinimalT2 * (1.0 - tolerance)) || (t2Value > m_MaximalT2 * (1.0 + tolerance)))
+        return false;
+
+    double flipAngleTolerance = tolerance * std::max(1.0,std::abs(m_MaximalFlipAngle));
+    if ((flipAngle < m_MinimalFlipAngle - flipAngleTolerance) || (flipAngle > m_MaximalFlipAngle + flipAngleTolerance))
+        return false;
+
+    return true;
+}
+
+void EPGSignalTable::GetAxisWeights(unsigned int axis, double value, unsigned int &startIndex,
+                                    unsigned int &numberOfNodes, double *weights) const
+{
+    startIndex = 0;
+    numberOfNodes = std::min(m_AxisSize[axis],4U);
+
+    double position = 0;
+    if (m_AxisSize[axis] > 1)
+    {
+        position = (value - m_AxisMinimum[axis]) * (m_AxisSize[axis] - 1.0) / (m_AxisMaximum[axis] - m_AxisMinimum[axis]);
+        position = std::max(0.0,std::min(position,m_AxisSize[axis] - 1.0));
+
+        // Nodes around the cell, shifted inside the grid on borders
+        int cellIndex = std::floor(position);
+        int maxStartIndex = m_AxisSize[axis] - numberOfNodes;
+        startIndex = std::max(0,std::min(cellIndex - 1,maxStartIndex));
+    }
+
+    double x = position - startIndex;
+    switch (numberOfNodes)
+    {
+        case 4:
+        {
+            double xm1 = x - 1.0;
+            double xm2 = x - 2.0;
+            double xm3 = x - 3.0;
+            weights[0] = - xm1 * xm2 * xm3 / 6.0;
+            weights[1] = x * xm2 * xm3 / 2.0;
+            weights[2] = - x * xm1 * xm3 / 2.0;
+            weights[3] = x * xm1 * xm2 / 6.0;
+            break;
+        }
+
+        case 3:
+            weights[0] = (x - 1.0) * (x - 2.0) / 2.0;
+            weights[1] = - x * (x - 2.0);
+            weights[2] = x * (x - 1.0) / 2.0;
+            break;
+
+        case 2:
+            weights[0] = 1.0 - x;
+            weights[1] = x;
+            break;
+
+        case 1:
+        default:
+            weights[0] = 1.0;
+            break;
+    }
+}
+
+void EPGSignalTable::GetValue(double t1Value, double t2Value, double flipAngle, double m0Value, double *output) const
+{
+    double decayValues[3];
+    decayValues[0] = this->GetDecayValue(t1Value);
+    decayValues[1] = this->GetDecayValue(t2Value);
+    decayValues[2] = flipAngle;
+
+    this->Interpolate(decayValues,m0Value,output);
+}
+
+void EPGSignalTable::Interpolate(const double *decayValues, double m0Value, double *output) const
+{
+    unsigned int startIndexes[3], numberOfNodes[3];
+    double weights[3][4];
+    for (unsigned int i = 0;i < 3;++i)
+        this->GetAxisWeights(i,decayValues[i],startIndexes[i],numberOfNodes[i],weights[i]);
+
+    for (unsigned int e = 0;e < m_NumberOfEchoes;++e)
+        output[e] = 0;
+
+    for (unsigned int i = 0;i < numberOfNodes[0];++i)
+    {
+        unsigned int firstIndex = (startIndexes[0] + i) * m_AxisSize[1];
+        for (unsigned int j = 0;j < numberOfNodes[1];++j)
+        {
+            double firstWeight = weights[0][i] * weights[1][j];
+            unsigned int secondIndex = (firstIndex + startIndexes[1] + j) * m_AxisSize[2];
+            for (unsigned int k = 0;k < numberOfNodes[2];++k)
+            {
+                double nodeWeight = firstWeight * weights[2][k];
+                const double *nodeValues = m_Values.data() + (secondIndex + startIndexes[2] + k) * m_NumberOfEchoes;
+                for (unsigned int e = 0;e < m_NumberOfEchoes;++e)
+                    output[e] += nodeWeight * nodeValues[e];
+            }
+        }
+    }
+
+    double squaredDecay = decayValues[1] * decayValues[1];
+    double decayFactor = 1.0;
+    for (unsigned int e = 0;e < m_NumberOfEchoes;++e)
+    {
+        decayFactor = this->GetNextDecayFactor(decayFactor,squaredDecay);
+        output[e] *= m0Value * decayFactor;
+    }
+}
+
+} // end namespace anima
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <animaEPGSignalSimulator.h>
+
+#include "AnimaSignalSimulationExport.h"
+
+namespace anima
+{
+
+/**
+ * @brief Quantized table of EPG echo train signals (for M0 = 1), interpolated with cubic Lagrange polynomials
+ * along each axis. Nodes are regularly spaced on exp(-ESP / (2 T1)), exp(-ESP / (2 T2)) and on the refocusing
+ * flip angle (B1 times nominal flip angle), and the pure T2 decay of each echo (bounded below to keep values finite)
+ * is factored out of stored values.
+ * The grid is refined axis per axis until the interpolation error, measured against exact simulations at cell
+ * midpoints, is below the requested bound or the table reaches its maximal size. Once built, GetValue is thread safe.
+ */
+class ANIMASIGNALSIMULATION_EXPORT EPGSignalTable
+{
+public:
+    EPGSignalTable();
+    virtual ~EPGSignalTable() {}
+
+    typedef EPGSignalSimulator::RealVectorType RealVectorType;
+
+    void SetEchoSpacing(double val) {m_EchoSpacing = val;}
+    void SetExcitationFlipAngle(double val) {m_ExcitationFlipAngle = val;}
+    void SetNumberOfEchoes(unsigned int val) {m_NumberOfEchoes = val;}
+
+    void SetT1Range(double minValue, double maxValue) {m_MinimalT1 = minValue; m_MaximalT1 = maxValue;}
+    void SetT2Range(double minValue, double maxValue) {m_MinimalT2 = minValue; m_MaximalT2 = maxValue;}
+    void SetFlipAngleRange(double minValue, double maxValue) {m_MinimalFlipAngle = minValue; m_MaximalFlipAngle = maxValue;}
+
+    //! Maximal absolute interpolation error on echoes, for M0 = 1
+    void SetMaximalError(double val) {m_MaximalError = val;}
+    //! Maximal number of stored values (nodes times echoes)
+    void SetMaximalTableSize(unsigned int val) {m_MaximalTableSize = val;}
+
+    //! Builds the table, returns true if the error bound was reached, false if it was not or if signals were not finite
+    bool Build();
+
+    //! Interpolation error estimated on cell midpoints when building
+    double GetEstimatedError() const {return m_EstimatedError;}
+    unsigned int GetTableSize() const {return m_Values.size();}
+
+    bool IsInside(double t1Value, double t2Value, double flipAngle) const;
+
+    //! Interpolated echoes in output (of size number of echoes), parameters should be inside the table ranges
+    void GetValue(double t1Value, double t2Value, double flipAngle, double m0Value, double *output) const;
+
+protected:
+    double GetDecayValue(double relaxationTime) const;
+    double GetRelaxationTime(double decayValue) const;
+
+    //! Lagrange interpolation weights on the (up to) four nodes around value on an axis
+    void GetAxisWeights(unsigned int axis, double value, unsigned int &startIndex,
+                        unsigned int &numberOfNodes, double *weights) const;
+
+    //! Pure T2 decay factor of an echo from the one of the previous echo, bounded below
+    double GetNextDecayFactor(double decayFactor, double squaredDecay) const;
+
+    void Interpolate(const double *decayValues, double m0Value, double *output) const;
+    //! Fills node values, returns false if a factored value is not finite
+    bool FillTable(EPGSignalSimulator &simulator);
+
+    //! Maximal error at cell midpoints, midpoints are taken on axes where useAxis is true, other coordinates on nodes
+    double ComputeMidpointsError(EPGSignalSimulator &simulator, const bool *useAxis);
+
+private:
+    double m_EchoSpacing;
+    double m_ExcitationFlipAngle;
+    unsigned int m_NumberOfEchoes;
+
+    double m_MinimalT1, m_MaximalT1;
+    double m_MinimalT2, m_MaximalT2;
+    double m_MinimalFlipAngle, m_MaximalFlipAngle;
+
+    double m_MaximalError;
+    unsigned int m_MaximalTableSize;
+    double m_EstimatedError;
+
+    //! Axes are E1, E2 and flip angle
+    double m_AxisMinimum[3], m_AxisMaximum[3];
+    unsigned int m_AxisSize[3];
+
+    //! Echo e of node (i,j,k) is at ((i * m_AxisSize[1] + j) * m_AxisSize[2] + k) * m_NumberOfEchoes + e
+    std::vector <double> m_Values;
+};
+
+} // end namespace anima
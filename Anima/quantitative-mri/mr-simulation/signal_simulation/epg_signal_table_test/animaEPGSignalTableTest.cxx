@@ -0,0 +1,89 @@
+#include <animaEPGSignalTable.h>
+#include <animaEPGSignalSimulator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//! Builds a table on the given ranges, compares its interpolated echoes to direct simulations at random parameters
+bool TestSignalTable(const std::string &testName, unsigned int numEchoes, double echoSpacing,
+                     double minT1, double maxT1, double minT2, double maxT2, double minFlipAngle, double maxFlipAngle)
+{
+    double maximalError = 1.0e-4;
+
+    anima::EPGSignalTable signalTable;
+    signalTable.SetNumberOfEchoes(numEchoes);
+    signalTable.SetEchoSpacing(echoSpacing);
+    signalTable.SetExcitationFlipAngle(M_PI / 2.0);
+    signalTable.SetT1Range(minT1,maxT1);
+    signalTable.SetT2Range(minT2,maxT2);
+    signalTable.SetFlipAngleRange(minFlipAngle,maxFlipAngle);
+    signalTable.SetMaximalError(maximalError);
+
+    bool built = signalTable.Build();
+    if (!built)
+    {
+        std::cout << testName << ": table not built (estimated error " << signalTable.GetEstimatedError()
+                  << ", size " << signalTable.GetTableSize() << ") -> FAILED" << std::endl;
+        return false;
+    }
+
+    anima::EPGSignalSimulator simulator;
+    simulator.SetNumberOfEchoes(numEchoes);
+    simulator.SetEchoSpacing(echoSpacing);
+    simulator.SetExcitationFlipAngle(M_PI / 2.0);
+
+    std::mt19937 generator(0);
+    std::uniform_real_distribution <double> uniformDistribution(0.0,1.0);
+    std::vector <double> tableSignal(numEchoes);
+
+    // The error bound is estimated on cell midpoints only, leave some margin elsewhere
+    unsigned int numTests = 2000;
+    unsigned int numFailures = 0;
+    double maxError = 0;
+    for (unsigned int i = 0;i < numTests;++i)
+    {
+        double t1Value = minT1 + (maxT1 - minT1) * uniformDistribution(generator);
+        double t2Value = minT2 * std::pow(maxT2 / minT2,uniformDistribution(generator));
+        double flipAngle = minFlipAngle + (maxFlipAngle - minFlipAngle) * uniformDistribution(generator);
+        double m0Value = 100.0 + 900.0 * uniformDistribution(generator);
+
+        std::vector <double> &signal = simulator.GetValue(t1Value,t2Value,flipAngle,m0Value);
+        signalTable.GetValue(t1Value,t2Value,flipAngle,m0Value,tableSignal.data());
+
+        double error = 0;
+        bool finiteValues = true;
+        for (unsigned int e = 0;e < numEchoes;++e)
+        {
+            finiteValues = finiteValues && std::isfinite(tableSignal[e]);
+            error = std::max(error,std::abs(tableSignal[e] - signal[e]) / m0Value);
+        }
+
+        maxError = std::max(maxError,error);
+        if ((!finiteValues) || (error > 2.0 * maximalError))
+            ++numFailures;
+    }
+
+    bool success = (numFailures == 0);
+    std::cout << testName << ": " << numFailures << " failures out of " << numTests << ", max error "
+              << maxError << ", table size " << signalTable.GetTableSize() << (success ? " -> OK" : " -> FAILED") << std::endl;
+
+    return success;
+}
+
+int main()
+{
+    bool success = true;
+
+    success &= TestSignalTable("Brain T2 ranges",32,10.0,500.0,2500.0,5.0,300.0,M_PI / 2.0,M_PI);
+
+    // Short T2 and long echo trains: pure T2 decay of late echoes is below double precision
+    success &= TestSignalTable("Short T2",50,10.0,300.0,3000.0,0.5,20.0,2.0 * M_PI / 3.0,M_PI);
+    success &= TestSignalTable("Short T2, fixed T1 and flip angle",64,15.0,1000.0,1000.0,0.3,10.0,M_PI,M_PI);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,133 @@
+#include <tclap/CmdLine.h>
+
+#include <itkImage.h>
+#include <itkVectorImage.h>
+
+#include <animaSimuBlochProtocolSweepImageFilter.h>
+#include <animaReadWriteFunctions.h>
+
+#include <fstream>
+#include <sstream>
+
+int main(int argc, char *argv[])
+{
+    TCLAP::CmdLine cmd("Simulates a list of MR protocols in one pass, outputs a vector image with one component per protocol\n"
+                       "INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
+
+    TCLAP::ValueArg<std::string> t1MapArg("","t1","Input T1 map",true,"","T1 map",cmd);
+    TCLAP::ValueArg<std::string> m0ImageArg("","m0","Input M0 image",true,"","M0 image",cmd);
+    TCLAP::ValueArg<std::string> t2MapArg("","t2","Input T2 map (required for SE, IR-SE and Coherent-GRE protocols)",false,"","T2 map",cmd);
+    TCLAP::ValueArg<std::string> t2sMapArg("","t2s","Input T2* map (required for gradient echo protocols)",false,"","T2* map",cmd);
+    TCLAP::ValueArg<std::string> b1ImageArg("","b1","Input B1 image (used by SP-GRE protocols)",false,"","B1 image",cmd);
+
+    TCLAP::ValueArg<std::string> protocolsArg("p","protocols","Protocols text file, one protocol per line: "
+                                              "sequence (SE, GRE, IR-SE, IR-GRE, SP-GRE or Coherent-GRE) TR TE TI FA "
+                                              "(times in ms, flip angle in degrees, unused values set to 0)",true,"","protocols file",cmd);
+    TCLAP::ValueArg<std::string> resArg("o","output","Output simulated vector image",true,"","output simulated image",cmd);
+
+    TCLAP::ValueArg<unsigned int> nbpArg("T","numberofthreads","Number of threads to run on (default : all cores)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
+
+    try
+    {
+        cmd.parse(argc,argv);
+    }
+    catch (TCLAP::ArgException& e)
+    {
+        std::cerr << "Error: " << e.error() << "for argument " << e.argId() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    typedef itk::Image <double, 3> ImageType;
+    typedef itk::VectorImage <double, 3> OutputImageType;
+    typedef anima::SimuBlochProtocolSweepImageFilter <ImageType, OutputImageType> FilterType;
+
+    FilterType::Pointer filter = FilterType::New();
+
+    std::ifstream protocolsFile(protocolsArg.getValue().c_str());
+    if (!protocolsFile.is_open())
+    {
+        std::cerr << "Protocols file not readable " << protocolsArg.getValue() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    unsigned int lineNumber = 0;
+    while (!protocolsFile.eof())
+    {
+        char tmpStr[8192];
+        protocolsFile.getline(tmpStr,8192);
+        ++lineNumber;
+
+        std::string workStr(tmpStr);
+        workStr.erase(workStr.find_last_not_of(" \n\r\t")+1);
+        if ((workStr == "") || (workStr[0] == '#'))
+            continue;
+
+        std::istringstream iss(workStr);
+        std::string sequenceName;
+        FilterType::ProtocolType protocol;
+        iss >> sequenceName >> protocol.repetitionTime >> protocol.echoTime >> protocol.inversionTime >> protocol.flipAngle;
+
+        if (iss.fail())
+        {
+            std::cerr << "Error line " << lineNumber << ": expected sequence TR TE TI FA" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (sequenceName == "SE")
+            protocol.sequence = FilterType::SpinEcho;
+        else if (sequenceName == "GRE")
+            protocol.sequence = FilterType::GradientEcho;
+        else if (sequenceName == "IR-SE")
+            protocol.sequence = FilterType::InversionRecoverySpinEcho;
+        else if (sequenceName == "IR-GRE")
+            protocol.sequence = FilterType::InversionRecoveryGradientEcho;
+        else if (sequenceName == "SP-GRE")
+            protocol.sequence = FilterType::SpoiledGradientEcho;
+        else if (sequenceName == "Coherent-GRE")
+            protocol.sequence = FilterType::CoherentGradientEcho;
+        else
+        {
+            std::cerr << "Error line " << lineNumber << ": unknown sequence " << sequenceName << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        try
+        {
+            filter->AddProtocol(protocol);
+        }
+        catch (itk::ExceptionObject &e)
+        {
+            std::cerr << "Error line " << lineNumber << ": " << e.GetDescription() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    filter->SetInputT1(anima::readImage <ImageType> (t1MapArg.getValue()));
+    filter->SetInputM0(anima::readImage <ImageType> (m0ImageArg.getValue()));
+
+    if (t2MapArg.getValue() != "")
+        filter->SetInputT2(anima::readImage <ImageType> (t2MapArg.getValue()));
+
+    if (t2sMapArg.getValue() != "")
+        filter->SetInputT2s(anima::readImage <ImageType> (t2sMapArg.getValue()));
+
+    if (b1ImageArg.getValue() != "")
+        filter->SetInputB1(anima::readImage <ImageType> (b1ImageArg.getValue()));
+
+    filter->SetNumberOfWorkUnits(nbpArg.getValue());
+
+    try
+    {
+        filter->Update();
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        std::cerr << e << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Writing " << filter->GetNumberOfProtocols() << " simulated contrasts to : " << resArg.getValue() << std::endl;
+    anima::writeImage <OutputImageType> (resArg.getValue(), filter->GetOutput());
+
+    return EXIT_SUCCESS;
+}
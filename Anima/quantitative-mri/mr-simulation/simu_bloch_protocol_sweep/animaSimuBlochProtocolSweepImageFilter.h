@@ -0,0 +1,91 @@
+#pragma once
+
+#include <itkImageToImageFilter.h>
+#include <vector>
+
+namespace anima
+{
+
+/**
+ * @brief Simulates a list of protocols (SE, GRE, IR-SE, IR-GRE, SP-GRE, coherent GRE, same signal equations as the
+ * single protocol SimuBloch filters) in one pass, each protocol being one component of the output vector image.
+ * Voxels are processed by image lines, exponentials being computed once per line for each distinct TR, TE and TI.
+ * Inputs: T1 (0), M0 (1), T2 (2, for spin echoes and coherent GRE), T2* (3, for gradient echoes), B1 (4, optional).
+ */
+template <class TImage, class TOutputImage>
+class SimuBlochProtocolSweepImageFilter : public itk::ImageToImageFilter <TImage, TOutputImage>
+{
+public:
+    /** Standard class typedefs. */
+    typedef SimuBlochProtocolSweepImageFilter Self;
+    typedef itk::ImageToImageFilter <TImage, TOutputImage> Superclass;
+    typedef itk::SmartPointer <Self> Pointer;
+
+    typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro(Self)
+
+    /** Run-time type information (and related methods). */
+    itkTypeMacro(SimuBlochProtocolSweepImageFilter, itk::ImageToImageFilter)
+
+    enum SequenceType
+    {
+        SpinEcho = 0,
+        GradientEcho,
+        InversionRecoverySpinEcho,
+        InversionRecoveryGradientEcho,
+        SpoiledGradientEcho,
+        CoherentGradientEcho
+    };
+
+    //! Times in ms, flip angle in degrees
+    struct ProtocolType
+    {
+        SequenceType sequence;
+        double repetitionTime;
+        double echoTime;
+        double inversionTime;
+        double flipAngle;
+    };
+
+    void AddProtocol(const ProtocolType &protocol);
+    void ClearProtocols() {m_Protocols.clear();}
+    unsigned int GetNumberOfProtocols() {return m_Protocols.size();}
+
+    void SetInputT1(const TImage *T1);
+    void SetInputM0(const TImage *M0);
+    void SetInputT2(const TImage *T2);
+    void SetInputT2s(const TImage *T2s);
+    void SetInputB1(const TImage *B1);
+
+protected:
+    SimuBlochProtocolSweepImageFilter();
+    virtual ~SimuBlochProtocolSweepImageFilter() {}
+
+    void GenerateOutputInformation() ITK_OVERRIDE;
+    void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+    /** Does the real work. */
+    virtual void DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread) ITK_OVERRIDE;
+
+    static bool UsesT2(SequenceType sequence);
+    static bool UsesT2s(SequenceType sequence);
+
+    //! Index of value in values, added if not present
+    static unsigned int GetUniqueValueIndex(std::vector <double> &values, double value);
+
+private:
+    ITK_DISALLOW_COPY_AND_ASSIGN(SimuBlochProtocolSweepImageFilter);
+
+    std::vector <ProtocolType> m_Protocols;
+
+    // Distinct times over all protocols, and index of each protocol time in them
+    std::vector <double> m_RepetitionTimes, m_InversionTimes;
+    std::vector <double> m_SpinEchoTimes, m_GradientEchoTimes;
+    std::vector <unsigned int> m_RepetitionTimeIndexes, m_InversionTimeIndexes, m_EchoTimeIndexes;
+};
+
+} // end of namespace anima
+
+#include "animaSimuBlochProtocolSweepImageFilter.hxx"
@@ -0,0 +1,315 @@
+#pragma once
+#include "animaSimuBlochProtocolSweepImageFilter.h"
+
+#include <itkImageScanlineConstIterator.h>
+#include <cmath>
+
+namespace anima
+{
+
+template <class TImage, class TOutputImage>
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::SimuBlochProtocolSweepImageFilter()
+{
+    this->SetNumberOfRequiredInputs(2);
+}
+
+template <class TImage, class TOutputImage>
+void
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::SetInputT1(const TImage *T1)
+{
+    this->SetInput(0, const_cast <TImage *> (T1));
+}
+
+template <class TImage, class TOutputImage>
+void
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::SetInputM0(const TImage *M0)
+{
+    this->SetInput(1, const_cast <TImage *> (M0));
+}
+
+template <class TImage, class TOutputImage>
+void
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::SetInputT2(const TImage *T2)
+{
+    this->SetInput(2, const_cast <TImage *> (T2));
+}
+
+template <class TImage, class TOutputImage>
+void
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::SetInputT2s(const TImage *T2s)
+{
+    this->SetInput(3, const_cast <TImage *> (T2s));
+}
+
+template <class TImage, class TOutputImage>
+void
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::SetInputB1(const TImage *B1)
+{
+    this->SetInput(4, const_cast <TImage *> (B1));
+}
+
+template <class TImage, class TOutputImage>
+void
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::AddProtocol(const ProtocolType &protocol)
+{
+    if ((protocol.repetitionTime < 0) || (protocol.echoTime < 0) || (protocol.inversionTime < 0))
+        itkExceptionMacro("Protocol times should be positive");
+
+    if (protocol.echoTime >= protocol.repetitionTime)
+        itkExceptionMacro("Protocol TE should be lower than TR");
+
+    m_Protocols.push_back(protocol);
+    this->Modified();
+}
+
+template <class TImage, class TOutputImage>
+bool
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::UsesT2(SequenceType sequence)
+{
+    return (sequence == SpinEcho) || (sequence == InversionRecoverySpinEcho) || (sequence == CoherentGradientEcho);
+}
+
+template <class TImage, class TOutputImage>
+bool
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::UsesT2s(SequenceType sequence)
+{
+    return (sequence != SpinEcho) && (sequence != InversionRecoverySpinEcho);
+}
+
+template <class TImage, class TOutputImage>
+unsigned int
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::GetUniqueValueIndex(std::vector <double> &values, double value)
+{
+    for (unsigned int i = 0;i < values.size();++i)
+    {
+        if (values[i] == value)
+            return i;
+    }
+
+    values.push_back(value);
+    return values.size() - 1;
+}
+
+template <class TImage, class TOutputImage>
+void
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::GenerateOutputInformation()
+{
+    this->Superclass::GenerateOutputInformation();
+
+    this->GetOutput()->SetVectorLength(m_Protocols.size());
+}
+
+template <class TImage, class TOutputImage>
+void
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::BeforeThreadedGenerateData()
+{
+    this->Superclass::BeforeThreadedGenerateData();
+
+    if (m_Protocols.size() == 0)
+        itkExceptionMacro("No protocol to simulate");
+
+    unsigned int numInputs = this->GetNumberOfIndexedInputs();
+    bool t2Present = (numInputs > 2) && (this->GetInput(2) != NULL);
+    bool t2sPresent = (numInputs > 3) && (this->GetInput(3) != NULL);
+
+    m_RepetitionTimes.clear();
+    m_InversionTimes.clear();
+    m_SpinEchoTimes.clear();
+    m_GradientEchoTimes.clear();
+
+    unsigned int numProtocols = m_Protocols.size();
+    m_RepetitionTimeIndexes.resize(numProtocols);
+    m_InversionTimeIndexes.resize(numProtocols);
+    m_EchoTimeIndexes.resize(numProtocols);
+
+    for (unsigned int i = 0;i < numProtocols;++i)
+    {
+        SequenceType sequence = m_Protocols[i].sequence;
+        if (UsesT2(sequence) && !t2Present)
+            itkExceptionMacro("T2 map required for protocol " << i);
+
+        if (UsesT2s(sequence) && !t2sPresent)
+            itkExceptionMacro("T2* map required for protocol " << i);
+
+        m_RepetitionTimeIndexes[i] = GetUniqueValueIndex(m_RepetitionTimes,m_Protocols[i].repetitionTime);
+
+        m_InversionTimeIndexes[i] = 0;
+        if ((sequence == InversionRecoverySpinEcho) || (sequence == InversionRecoveryGradientEcho))
+            m_InversionTimeIndexes[i] = GetUniqueValueIndex(m_InversionTimes,m_Protocols[i].inversionTime);
+
+        // Coherent GRE echo decays with T2*
+        if ((sequence == SpinEcho) || (sequence == InversionRecoverySpinEcho))
+            m_EchoTimeIndexes[i] = GetUniqueValueIndex(m_SpinEchoTimes,m_Protocols[i].echoTime);
+        else
+            m_EchoTimeIndexes[i] = GetUniqueValueIndex(m_GradientEchoTimes,m_Protocols[i].echoTime);
+    }
+}
+
+template <class TImage, class TOutputImage>
+void
+SimuBlochProtocolSweepImageFilter <TImage,TOutputImage>
+::DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread)
+{
+    typedef typename TImage::PixelType InputPixelType;
+    typedef typename TOutputImage::InternalPixelType OutputPixelType;
+
+    unsigned int numInputs = this->GetNumberOfIndexedInputs();
+    const TImage *t1Image = this->GetInput(0);
+    const TImage *m0Image = this->GetInput(1);
+    const TImage *t2Image = (numInputs > 2) ? this->GetInput(2) : NULL;
+    const TImage *t2sImage = (numInputs > 3) ? this->GetInput(3) : NULL;
+    const TImage *b1Image = (numInputs > 4) ? this->GetInput(4) : NULL;
+    TOutputImage *output = this->GetOutput();
+
+    unsigned int numProtocols = m_Protocols.size();
+    unsigned int lineLength = outputRegionForThread.GetSize()[0];
+
+    // Line buffers: relaxation rates (zero on invalid voxels) and exponentials for each distinct time
+    std::vector <double> r1Values(lineLength), r2Values(lineLength), r2sValues(lineLength);
+    std::vector <unsigned char> t1Valid(lineLength), t2Valid(lineLength), t2sValid(lineLength);
+    std::vector <double> repetitionExps(m_RepetitionTimes.size() * lineLength);
+    std::vector <double> inversionExps(m_InversionTimes.size() * lineLength);
+    std::vector <double> spinEchoExps(m_SpinEchoTimes.size() * lineLength);
+    std::vector <double> gradientEchoExps(m_GradientEchoTimes.size() * lineLength);
+
+    itk::ImageScanlineConstIterator <TImage> lineIterator(t1Image, outputRegionForThread);
+    while (!lineIterator.IsAtEnd())
+    {
+        typename TImage::IndexType lineIndex = lineIterator.GetIndex();
+        const InputPixelType *t1Line = t1Image->GetBufferPointer() + t1Image->ComputeOffset(lineIndex);
+        const InputPixelType *m0Line = m0Image->GetBufferPointer() + m0Image->ComputeOffset(lineIndex);
+        OutputPixelType *outputLine = output->GetBufferPointer() + output->ComputeOffset(lineIndex) * numProtocols;
+
+        const InputPixelType *t2Line = NULL;
+        if (t2Image)
+            t2Line = t2Image->GetBufferPointer() + t2Image->ComputeOffset(lineIndex);
+
+        const InputPixelType *t2sLine = NULL;
+        if (t2sImage)
+            t2sLine = t2sImage->GetBufferPointer() + t2sImage->ComputeOffset(lineIndex);
+
+        const InputPixelType *b1Line = NULL;
+        if (b1Image)
+            b1Line = b1Image->GetBufferPointer() + b1Image->ComputeOffset(lineIndex);
+
+        for (unsigned int x = 0;x < lineLength;++x)
+        {
+            t1Valid[x] = (t1Line[x] > 0);
+            r1Values[x] = t1Valid[x] ? 1.0 / t1Line[x] : 0.0;
+
+            t2Valid[x] = t2Line ? (t2Line[x] > 0) : 0;
+            r2Values[x] = t2Valid[x] ? 1.0 / t2Line[x] : 0.0;
+
+            t2sValid[x] = t2sLine ? (t2sLine[x] > 0) : 0;
+            r2sValues[x] = t2sValid[x] ? 1.0 / t2sLine[x] : 0.0;
+        }
+
+        for (unsigned int i = 0;i < m_RepetitionTimes.size();++i)
+        {
+            double *expValues = repetitionExps.data() + i * lineLength;
+            for (unsigned int x = 0;x < lineLength;++x)
+                expValues[x] = std::exp(- m_RepetitionTimes[i] * r1Values[x]);
+        }
+
+        for (unsigned int i = 0;i < m_InversionTimes.size();++i)
+        {
+            double *expValues = inversionExps.data() + i * lineLength;
+            for (unsigned int x = 0;x < lineLength;++x)
+                expValues[x] = std::exp(- m_InversionTimes[i] * r1Values[x]);
+        }
+
+        for (unsigned int i = 0;i < m_SpinEchoTimes.size();++i)
+        {
+            double *expValues = spinEchoExps.data() + i * lineLength;
+            for (unsigned int x = 0;x < lineLength;++x)
+                expValues[x] = std::exp(- m_SpinEchoTimes[i] * r2Values[x]);
+        }
+
+        for (unsigned int i = 0;i < m_GradientEchoTimes.size();++i)
+        {
+            double *expValues = gradientEchoExps.data() + i * lineLength;
+            for (unsigned int x = 0;x < lineLength;++x)
+                expValues[x] = std::exp(- m_GradientEchoTimes[i] * r2sValues[x]);
+        }
+
+        for (unsigned int p = 0;p < numProtocols;++p)
+        {
+            const ProtocolType &protocol = m_Protocols[p];
+            const double *trExps = repetitionExps.data() + m_RepetitionTimeIndexes[p] * lineLength;
+            const double *tiExps = inversionExps.data() + m_InversionTimeIndexes[p] * lineLength;
+
+            bool spinEcho = (protocol.sequence == SpinEcho) || (protocol.sequence == InversionRecoverySpinEcho);
+            const double *teExps = spinEcho ? spinEchoExps.data() : gradientEchoExps.data();
+            teExps += m_EchoTimeIndexes[p] * lineLength;
+
+            double flipAngle = M_PI * protocol.flipAngle / 180.0;
+            double sinFA = std::sin(flipAngle);
+            double cosFA = std::cos(flipAngle);
+
+            for (unsigned int x = 0;x < lineLength;++x)
+            {
+                bool valid = t1Valid[x] && (!UsesT2(protocol.sequence) || t2Valid[x]) &&
+                        (!UsesT2s(protocol.sequence) || t2sValid[x]);
+
+                double signal = 0;
+                if (valid)
+                {
+                    switch (protocol.sequence)
+                    {
+                        case SpinEcho:
+                        case GradientEcho:
+                            signal = (1.0 - trExps[x]) * teExps[x];
+                            break;
+
+                        case InversionRecoverySpinEcho:
+                        case InversionRecoveryGradientEcho:
+                            signal = std::abs(1.0 - 2.0 * tiExps[x] + trExps[x]) * teExps[x];
+                            break;
+
+                        case SpoiledGradientEcho:
+                        {
+                            double voxelSinFA = sinFA;
+                            double voxelCosFA = cosFA;
+                            if (b1Line)
+                            {
+                                voxelSinFA = std::sin(b1Line[x] * flipAngle);
+                                voxelCosFA = std::cos(b1Line[x] * flipAngle);
+                            }
+
+                            signal = (1.0 - trExps[x]) * voxelSinFA / (1.0 - trExps[x] * voxelCosFA) * teExps[x];
+                            break;
+                        }
+
+                        case CoherentGradientEcho:
+                        default:
+                        {
+                            double t1t2Ratio = t1Line[x] * r2Values[x];
+                            signal = sinFA / (1.0 + t1t2Ratio - cosFA * (t1t2Ratio - 1.0)) * teExps[x];
+                            break;
+                        }
+                    }
+
+                    signal *= m0Line[x];
+                }
+
+                outputLine[x * numProtocols + p] = signal;
+            }
+        }
+
+        lineIterator.NextLine();
+    }
+}
+
+} // end of namespace anima
@@ -4,6 +4,8 @@
 #include <complex>
 #include <vector>
 
+#include <animaEPGSignalTable.h>
+
 namespace anima
 {
     
@@ -41,6 +43,14 @@ public:
     itkSetMacro(ExcitationFlipAngle, double)
     itkGetMacro(ExcitationFlipAngle, double)
 
+    //! Interpolates signals in a table built on the input parameters ranges instead of simulating each voxel
+    itkSetMacro(UseSignalTable, bool)
+    itkGetMacro(UseSignalTable, bool)
+
+    //! Maximal absolute error of table interpolated signals, relative to M0
+    itkSetMacro(SignalTableMaximalError, double)
+    itkGetMacro(SignalTableMaximalError, double)
+
     /** T1 map */
     void SetInputT1(const TImage* T1);
 
@@ -63,6 +73,10 @@ protected:
     virtual void DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread) ITK_OVERRIDE;
 
     void GenerateOutputInformation() ITK_OVERRIDE;
+    void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+    //! Builds the signal table on the ranges of valid input voxels, returns false if the error bound is not reached
+    bool BuildSignalTable();
 
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(StimulatedSpinEchoImageFilter);
@@ -72,6 +86,12 @@ private:
     double m_FlipAngle;
     unsigned int m_NumberOfEchoes;
 
+    bool m_UseSignalTable;
+    double m_SignalTableMaximalError;
+    //! True if the table was built and reached the error bound
+    bool m_SignalTableReady;
+    anima::EPGSignalTable m_SignalTable;
+
     Image4DPointer m_Output4D;
 };
     
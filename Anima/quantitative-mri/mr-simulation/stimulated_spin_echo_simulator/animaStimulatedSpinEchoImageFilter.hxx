@@ -30,6 +30,94 @@ StimulatedSpinEchoImageFilter <TImage,TOutputImage>
     m_EchoSpacing = 10;
     m_ExcitationFlipAngle = M_PI / 2.0;
     m_FlipAngle = M_PI;
+
+    m_UseSignalTable = false;
+    m_SignalTableMaximalError = 1.0e-4;
+    m_SignalTableReady = false;
+}
+
+template <class TImage, class TOutputImage>
+void
+StimulatedSpinEchoImageFilter <TImage,TOutputImage>
+::BeforeThreadedGenerateData()
+{
+    this->Superclass::BeforeThreadedGenerateData();
+
+    m_SignalTableReady = false;
+    if (m_UseSignalTable)
+    {
+        m_SignalTableReady = this->BuildSignalTable();
+        if (!m_SignalTableReady)
+            std::cerr << "Signal table error bound not reached (" << m_SignalTable.GetEstimatedError()
+                      << "), signals will be simulated voxel-wise" << std::endl;
+    }
+}
+
+template <class TImage, class TOutputImage>
+bool
+StimulatedSpinEchoImageFilter <TImage,TOutputImage>
+::BuildSignalTable()
+{
+    const TImage *t1Image = this->GetInput(0);
+    const TImage *t2Image = this->GetInput(1);
+    const TImage *b1Image = NULL;
+    if (this->GetNumberOfIndexedInputs() == 4)
+        b1Image = this->GetInput(3);
+
+    typename TImage::RegionType region = this->GetOutput()->GetRequestedRegion();
+    itk::ImageRegionConstIterator <TImage> t1Iterator(t1Image, region);
+    itk::ImageRegionConstIterator <TImage> t2Iterator(t2Image, region);
+    itk::ImageRegionConstIterator <TImage> b1Iterator;
+    if (b1Image)
+        b1Iterator = itk::ImageRegionConstIterator <TImage> (b1Image, region);
+
+    double minT1 = 0, maxT1 = 0, minT2 = 0, maxT2 = 0, minB1 = 1, maxB1 = 1;
+    bool firstValue = true;
+    while (!t1Iterator.IsAtEnd())
+    {
+        double t1Value = t1Iterator.Get();
+        double t2Value = t2Iterator.Get();
+        double b1Value = b1Image ? b1Iterator.Get() : 1.0;
+
+        ++t1Iterator;
+        ++t2Iterator;
+        if (b1Image)
+            ++b1Iterator;
+
+        if ((t1Value <= 0) || (t2Value <= 0))
+            continue;
+
+        if (firstValue)
+        {
+            minT1 = maxT1 = t1Value;
+            minT2 = maxT2 = t2Value;
+            minB1 = maxB1 = b1Value;
+            firstValue = false;
+            continue;
+        }
+
+        minT1 = std::min(minT1,t1Value);
+        maxT1 = std::max(maxT1,t1Value);
+        minT2 = std::min(minT2,t2Value);
+        maxT2 = std::max(maxT2,t2Value);
+        minB1 = std::min(minB1,b1Value);
+        maxB1 = std::max(maxB1,b1Value);
+    }
+
+    if (firstValue)
+        return false;
+
+    m_SignalTable.SetNumberOfEchoes(m_NumberOfEchoes);
+    m_SignalTable.SetEchoSpacing(m_EchoSpacing);
+    m_SignalTable.SetExcitationFlipAngle(m_ExcitationFlipAngle);
+    m_SignalTable.SetMaximalError(m_SignalTableMaximalError);
+
+    m_SignalTable.SetT1Range(minT1,maxT1);
+    m_SignalTable.SetT2Range(minT2,maxT2);
+    m_SignalTable.SetFlipAngleRange(std::min(minB1 * m_FlipAngle,maxB1 * m_FlipAngle),
+                                    std::max(minB1 * m_FlipAngle,maxB1 * m_FlipAngle));
+
+    return m_SignalTable.Build();
 }
 
 template <class TImage, class TOutputImage>
@@ -185,7 +273,14 @@ void StimulatedSpinEchoImageFilter <TImage,TOutputImage>
         double t2Value = inputIteratorT2.Get();
         double m0Value = inputIteratorM0.Get();
 
-        tmpOutputVector = t2SignalSimulator.GetValue(t1Value,t2Value,b1Value * m_FlipAngle,m0Value);
+        double flipAngle = b1Value * m_FlipAngle;
+        if (m_SignalTableReady && m_SignalTable.IsInside(t1Value,t2Value,flipAngle))
+        {
+            tmpOutputVector.resize(m_NumberOfEchoes);
+            m_SignalTable.GetValue(t1Value,t2Value,flipAngle,m0Value,tmpOutputVector.data());
+        }
+        else
+            tmpOutputVector = t2SignalSimulator.GetValue(t1Value,t2Value,flipAngle,m0Value);
 
         for (unsigned int i = 0;i < m_NumberOfEchoes;++i)
             outputVector[i] = tmpOutputVector[i];
@@ -23,6 +23,9 @@ int main(int argc, char *argv[] )
     TCLAP::ValueArg<double> xfaArg("x","excite-fa","Excitation flip angle (degrees), default: 90 degrees", false, 90,"excitation flip angle value",cmd);
     TCLAP::ValueArg<double> faArg("f","fa","Flip angle (degrees), default: 180 degrees", false, 180,"flip angle value",cmd);
 
+    TCLAP::SwitchArg tableArg("L","use-table","Interpolate signals in a table of simulated signals (faster for long echo trains)",cmd,false);
+    TCLAP::ValueArg<double> tableErrorArg("","table-error","Maximal signal error of the table relative to M0 (default: 1e-4)",false,1.0e-4,"table error",cmd);
+
     TCLAP::ValueArg<unsigned int> nbpArg("T","numberofthreads","Number of threads to run on (default : all cores)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
 
     try
@@ -82,6 +85,8 @@ int main(int argc, char *argv[] )
     filter->SetFlipAngle(faArg.getValue() * M_PI / 180.0);
     filter->SetNumberOfEchoes(neArg.getValue());
     filter->SetExcitationFlipAngle(xfaArg.getValue() * M_PI / 180.0);
+    filter->SetUseSignalTable(tableArg.isSet());
+    filter->SetSignalTableMaximalError(tableErrorArg.getValue());
     
     filter->Update();
     
@@ -1,5 +1,7 @@
 #pragma once
 #include <animaBaseAffineBlockMatcher.h>
+#include <animaFixedRegionValues.h>
+#include <memory>
 
 namespace anima
 {
@@ -25,12 +27,45 @@ public:
     typedef typename Superclass::MetricPointer MetricPointer;
     typedef typename Superclass::BaseInputTransformPointer BaseInputTransformPointer;
     typedef typename Superclass::OptimizerPointer OptimizerPointer;
+    typedef typename Superclass::ImageRegionType ImageRegionType;
+
+    typedef anima::FixedRegionValues <InputImageType::ImageDimension> FixedRegionValuesType;
+
+    /**
+     * Fixed block points, values and statistics, the same for all iterations as long as the reference pixel buffer
+     * is unchanged. Only computed for reference data shared read-only by matchers whose reference images share the
+     * pixel container and blocks (group registration), single matchers compute them block by block in their metrics.
+     */
+    struct FixedBlockValuesType
+    {
+        const typename InputImageType::PixelContainer *ReferencePixels;
+        itk::ModifiedTimeType ReferenceTime;
+        std::vector <FixedRegionValuesType> Values;
+    };
+
+    typedef std::shared_ptr <FixedBlockValuesType> FixedBlockValuesPointer;
 
     bool GetMaximizedMetric();
     void SetSimilarityType(SimilarityDefinition val) {m_SimilarityType = val;}
     void SetDefaultBackgroundValue(double val) {m_DefaultBackgroundValue = val;}
 
+    //! Computes fixed values of the current blocks, to be shared with other matchers through SetFixedBlockValues
+    void ComputeFixedBlockValues();
+
+    void SetFixedBlockValues(const FixedBlockValuesPointer &val) {m_FixedBlockValues = val;}
+    const FixedBlockValuesPointer &GetFixedBlockValues() {return m_FixedBlockValues;}
+
 protected:
+    struct ThreadedFixedValuesData
+    {
+        AnatomicalBlockMatcher *BlockMatch;
+        FixedBlockValuesType *FixedValues;
+    };
+
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedFixedValuesComputation(void *arg);
+
+    bool HasValidFixedBlockValues();
+
     virtual MetricPointer SetupMetric();
     virtual double ComputeBlockWeight(double val, unsigned int block);
 
@@ -39,6 +74,8 @@ protected:
 private:
     SimilarityDefinition m_SimilarityType;
     double m_DefaultBackgroundValue;
+
+    FixedBlockValuesPointer m_FixedBlockValues;
 };
 
 } // end namespace anima
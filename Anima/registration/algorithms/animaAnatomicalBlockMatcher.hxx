@@ -7,6 +7,7 @@
 #include <itkImageToImageMetric.h>
 
 #include <itkLinearInterpolateImageFunction.h>
+#include <itkPoolMultiThreader.h>
 
 namespace anima
 {
@@ -17,6 +18,71 @@ AnatomicalBlockMatcher<TInputImageType>
 {
     m_SimilarityType = SquaredCorrelation;
     m_DefaultBackgroundValue = 0.0;
+    m_FixedBlockValues = nullptr;
+}
+
+template <typename TInputImageType>
+bool
+AnatomicalBlockMatcher<TInputImageType>
+::HasValidFixedBlockValues()
+{
+    if (!m_FixedBlockValues)
+        return false;
+
+    const typename InputImageType::PixelContainer *refPixels = this->GetReferenceImage()->GetPixelContainer();
+    if ((m_FixedBlockValues->ReferencePixels != refPixels) || (m_FixedBlockValues->ReferenceTime != refPixels->GetMTime()))
+        return false;
+
+    return (m_FixedBlockValues->Values.size() == this->GetBlockRegions().size());
+}
+
+template <typename TInputImageType>
+void
+AnatomicalBlockMatcher<TInputImageType>
+::ComputeFixedBlockValues()
+{
+    // New values are allocated, values possibly shared with other matchers are left untouched
+    FixedBlockValuesPointer fixedValues(new FixedBlockValuesType);
+    fixedValues->ReferencePixels = this->GetReferenceImage()->GetPixelContainer();
+    fixedValues->ReferenceTime = fixedValues->ReferencePixels->GetMTime();
+    fixedValues->Values.resize(this->GetBlockRegions().size());
+
+    itk::PoolMultiThreader::Pointer threadWorker = itk::PoolMultiThreader::New();
+    ThreadedFixedValuesData *tmpStr = new ThreadedFixedValuesData;
+    tmpStr->BlockMatch = this;
+    tmpStr->FixedValues = fixedValues.get();
+
+    threadWorker->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    threadWorker->SetSingleMethod(this->ThreadedFixedValuesComputation,tmpStr);
+    threadWorker->SingleMethodExecute();
+
+    delete tmpStr;
+
+    m_FixedBlockValues = fixedValues;
+}
+
+template <typename TInputImageType>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+AnatomicalBlockMatcher<TInputImageType>
+::ThreadedFixedValuesComputation(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+    ThreadedFixedValuesData *data = (ThreadedFixedValuesData *)threadArgs->UserData;
+
+    unsigned int nbThreads = threadArgs->NumberOfWorkUnits;
+    unsigned int threadId = threadArgs->WorkUnitID;
+
+    const InputImageType *refImage = data->BlockMatch->GetReferenceImage().GetPointer();
+    unsigned int nbBlocks = data->FixedValues->Values.size();
+    unsigned int step = nbBlocks / nbThreads;
+    unsigned int startBlock = threadId * step;
+    unsigned int endBlock = (threadId == nbThreads - 1) ? nbBlocks : (threadId + 1) * step;
+
+    for (unsigned int block = startBlock;block < endBlock;++block)
+        anima::ComputeFixedRegionValues <InputImageType> (refImage,data->BlockMatch->GetBlockRegion(block),
+                                                          data->FixedValues->Values[block]);
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
 
 template <typename TInputImageType>
@@ -113,10 +179,26 @@ AnatomicalBlockMatcher<TInputImageType>
     tmpMetric->SetFixedImageRegion(this->GetBlockRegion(block));
     tmpMetric->SetTransform(this->GetBlockTransformPointer(block));
     tmpMetric->Initialize();
+
+    bool useFixedBlockValues = this->HasValidFixedBlockValues();
     if (m_SimilarityType != MeanSquares)
-        ((anima::FastCorrelationImageToImageMetric<InputImageType, InputImageType> *)metric.GetPointer())->PreComputeFixedValues();
+    {
+        typedef anima::FastCorrelationImageToImageMetric<InputImageType, InputImageType> CorrelationMetricType;
+        CorrelationMetricType *corrMetric = (CorrelationMetricType *)metric.GetPointer();
+        if (useFixedBlockValues)
+            corrMetric->SetPreComputedFixedValues(&m_FixedBlockValues->Values[block]);
+        else
+            corrMetric->PreComputeFixedValues();
+    }
     else
-        ((anima::FastMeanSquaresImageToImageMetric<InputImageType, InputImageType> *)metric.GetPointer())->PreComputeFixedValues();
+    {
+        typedef anima::FastMeanSquaresImageToImageMetric<InputImageType, InputImageType> MeanSquaresMetricType;
+        MeanSquaresMetricType *msMetric = (MeanSquaresMetricType *)metric.GetPointer();
+        if (useFixedBlockValues)
+            msMetric->SetPreComputedFixedValues(&m_FixedBlockValues->Values[block]);
+        else
+            msMetric->PreComputeFixedValues();
+    }
 }
 
 } // end namespace anima
@@ -134,6 +134,12 @@ protected:
     virtual void ResampleImages(TransformType *currentTransform, InputImagePointer &refImage, InputImagePointer &movingImage);
     virtual bool ComposeAddOnWithTransform(TransformPointer &computedTransform, TransformType *addOn);
 
+    /**
+     * Symmetric add-on from forward and reverse ones, computed in place in forwardAddOn:
+     * (S_f - S_r) / divider for SVFs, exp((log(T_f) - log(T_r)) / divider) for linear transforms
+     */
+    void ComputeSymmetricAddOn(TransformType *forwardAddOn, TransformType *reverseAddOn, double divider);
+
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(BaseBMRegistrationMethod);
 
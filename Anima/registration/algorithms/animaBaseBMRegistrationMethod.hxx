@@ -6,6 +6,8 @@
 #include <animaSmoothingRecursiveYvvGaussianImageFilter.h>
 
 #include <animaVelocityUtils.h>
+#include <animaMatrixLogExp.h>
+#include <animaInstrumentation.h>
 #include <itkImageRegionIterator.h>
 
 namespace anima
@@ -98,8 +100,13 @@ BaseBMRegistrationMethod <TInputImageType>
     InputImagePointer fixedResampled, movingResampled;
     for (unsigned int iterations = 0; iterations < m_MaximumIterations && !m_Abort; ++iterations)
     {
+        ANIMA_INSTRUMENT_SCOPE("bm_iteration");
+
         // Resample fixed and moving image here
-        this->ResampleImages(computedTransform, fixedResampled, movingResampled);
+        {
+            ANIMA_INSTRUMENT_SCOPE("resampling");
+            this->ResampleImages(computedTransform, fixedResampled, movingResampled);
+        }
 
         // Perform one iteration of registration between the images
         // Calls pure virtual method that can use the block matching class available here
@@ -107,7 +114,11 @@ BaseBMRegistrationMethod <TInputImageType>
         TransformPointer addOn;
         this->PerformOneIteration(fixedResampled, movingResampled, addOn);
 
-        bool continueLoop = this->ComposeAddOnWithTransform(computedTransform,addOn);
+        bool continueLoop = true;
+        {
+            ANIMA_INSTRUMENT_SCOPE("composition");
+            continueLoop = this->ComposeAddOnWithTransform(computedTransform,addOn);
+        }
 
         if (m_VerboseProgression)
             std::cout << "Iteration " << iterations << " done..." << std::endl;
@@ -369,4 +380,85 @@ BaseBMRegistrationMethod <TInputImageType>
     os << indent << "Maximum Iterations: " << m_MaximumIterations << std::endl;
 }
 
+template <typename TInputImageType>
+void
+BaseBMRegistrationMethod <TInputImageType>
+::ComputeSymmetricAddOn(TransformType *forwardAddOn, TransformType *reverseAddOn, double divider)
+{
+    if (m_Agregator->GetOutputTransformType() == AgregatorType::SVF)
+    {
+        // Threaded in place pass on the forward field, no filter pipeline
+        typedef typename SVFTransformType::VectorFieldType VelocityFieldType;
+        typedef typename VelocityFieldType::RegionType VelocityRegionType;
+
+        SVFTransformType *forwardAddOnCast = dynamic_cast <SVFTransformType *> (forwardAddOn);
+        SVFTransformType *reverseAddOnCast = dynamic_cast <SVFTransformType *> (reverseAddOn);
+
+        VelocityFieldType *forwardField = const_cast <VelocityFieldType *> (forwardAddOnCast->GetParametersAsVectorField());
+        const VelocityFieldType *reverseField = reverseAddOnCast->GetParametersAsVectorField();
+        double factor = 1.0 / divider;
+
+        this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+        this->GetMultiThreader()->template ParallelizeImageRegion<TInputImageType::ImageDimension>(
+                    forwardField->GetLargestPossibleRegion(),
+                    [forwardField,reverseField,factor](const VelocityRegionType &region)
+        {
+            itk::ImageRegionIterator <VelocityFieldType> forwardItr(forwardField,region);
+            itk::ImageRegionConstIterator <VelocityFieldType> reverseItr(reverseField,region);
+
+            while (!forwardItr.IsAtEnd())
+            {
+                forwardItr.Set(factor * (forwardItr.Get() - reverseItr.Get()));
+
+                ++forwardItr;
+                ++reverseItr;
+            }
+        }, ITK_NULLPTR);
+
+        return;
+    }
+
+    AffineTransformType *forwardAddOnCast = dynamic_cast <AffineTransformType *> (forwardAddOn);
+    AffineTransformType *reverseAddOnCast = dynamic_cast <AffineTransformType *> (reverseAddOn);
+
+    unsigned int NDimensions = InputImageType::ImageDimension;
+    vnl_matrix <double> forwardAddOnMatrix(NDimensions+1,NDimensions+1,0);
+    vnl_matrix <double> reverseAddOnMatrix(NDimensions+1,NDimensions+1,0);
+    forwardAddOnMatrix.set_identity();
+    reverseAddOnMatrix.set_identity();
+
+    for (unsigned int i = 0;i < NDimensions;++i)
+    {
+        for (unsigned int j = 0;j < NDimensions;++j)
+        {
+            forwardAddOnMatrix(i,j) = forwardAddOnCast->GetMatrix()(i,j);
+            reverseAddOnMatrix(i,j) = reverseAddOnCast->GetMatrix()(i,j);
+        }
+
+        forwardAddOnMatrix(i,NDimensions) = forwardAddOnCast->GetOffset()[i];
+        reverseAddOnMatrix(i,NDimensions) = reverseAddOnCast->GetOffset()[i];
+    }
+
+    forwardAddOnMatrix = anima::GetLogarithm(forwardAddOnMatrix);
+    reverseAddOnMatrix = anima::GetLogarithm(reverseAddOnMatrix);
+
+    forwardAddOnMatrix -= reverseAddOnMatrix;
+    forwardAddOnMatrix /= divider;
+
+    forwardAddOnMatrix = anima::GetExponential(forwardAddOnMatrix);
+
+    typename AffineTransformType::MatrixType trsfMatrix;
+    typename AffineTransformType::OffsetType trsfOffset;
+    for (unsigned int i = 0;i < NDimensions;++i)
+    {
+        for (unsigned int j = 0;j < NDimensions;++j)
+            trsfMatrix(i,j) = forwardAddOnMatrix(i,j);
+
+        trsfOffset[i] = forwardAddOnMatrix(i,NDimensions);
+    }
+
+    forwardAddOnCast->SetMatrix(trsfMatrix);
+    forwardAddOnCast->SetOffset(trsfOffset);
+}
+
 } // end namespace anima
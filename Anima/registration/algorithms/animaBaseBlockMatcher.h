@@ -74,6 +74,19 @@ public:
 
     void Update();
 
+    /**
+     * Matches the blocks of this matcher and of another one (e.g. reverse matcher of symmetric registration) in a single
+     * threaded job: threads start on either matcher and move on to the other one when its blocks are all processed.
+     */
+    void UpdateJointly(Self *otherMatcher);
+
+    //! Generates blocks on the reference image (or uses the given block layout) and resets block transforms
+    virtual void InitializeBlocks();
+
+    //! Blocks computed beforehand (e.g. shared by registrations to the same reference), used instead of generating them
+    void SetBlockLayout(const std::vector <ImageRegionType> &regions, const std::vector <PointType> &positions);
+    bool GetUseGivenBlockLayout() {return m_UseGivenBlockLayout;}
+
     std::vector <PointType> &GetBlockPositions() {return m_BlockPositions;}
     std::vector <ImageRegionType> &GetBlockRegions() {return m_BlockRegions;}
     ImageRegionType &GetBlockRegion(unsigned int i) {return m_BlockRegions[i];}
@@ -99,16 +112,16 @@ protected:
     struct ThreadedMatchData
     {
         Self *BlockMatch;
+        Self *OtherBlockMatch;
     };
 
     /** Do the matching for a batch of regions (split according to the thread id + nb threads) */
     static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedMatching(void *arg);
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedJointMatching(void *arg);
 
     void ProcessBlockMatch();
     void BlockMatch(unsigned int startIndex, unsigned int endIndex);
 
-    virtual void InitializeBlocks();
-
     virtual MetricPointer SetupMetric() = 0;
     virtual double ComputeBlockWeight(double val, unsigned int block) = 0;
     virtual BaseInputTransformPointer GetNewBlockTransform(PointType &blockCenter) = 0;
@@ -130,6 +143,7 @@ private:
     MaskImagePointer m_BlockGenerationMask;
 
     bool m_ForceComputeBlocks;
+    bool m_UseGivenBlockLayout;
     unsigned int m_NumberOfThreads;
 
     // The origins of the blocks
@@ -4,6 +4,7 @@
 #include <animaBobyqaOptimizer.h>
 #include <animaVoxelExhaustiveOptimizer.h>
 #include <animaBlockMatchInitializer.h>
+#include <animaInstrumentation.h>
 #include <itkPoolMultiThreader.h>
 
 namespace anima
@@ -14,6 +15,7 @@ BaseBlockMatcher <TInputImageType>
 ::BaseBlockMatcher()
 {
     m_ForceComputeBlocks = false;
+    m_UseGivenBlockLayout = false;
     m_NumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
 
     m_BlockPercentageKept = 0.8;
@@ -38,31 +40,34 @@ void
 BaseBlockMatcher <TInputImageType>
 ::InitializeBlocks()
 {
-    // Init blocks on reference image
-    typedef typename TInputImageType::IOPixelType InputPixelType;
-    typedef typename anima::BlockMatchingInitializer<InputPixelType,TInputImageType::ImageDimension> InitializerType;
-    typedef typename InitializerType::Pointer InitializerPointer;
+    if (!m_UseGivenBlockLayout)
+    {
+        // Init blocks on reference image
+        typedef typename TInputImageType::IOPixelType InputPixelType;
+        typedef typename anima::BlockMatchingInitializer<InputPixelType,TInputImageType::ImageDimension> InitializerType;
+        typedef typename InitializerType::Pointer InitializerPointer;
 
-    InitializerPointer initPtr = InitializerType::New();
-    initPtr->AddReferenceImage(m_ReferenceImage);
+        InitializerPointer initPtr = InitializerType::New();
+        initPtr->AddReferenceImage(m_ReferenceImage);
 
-    if (m_NumberOfThreads != 0)
-        initPtr->SetNumberOfThreads(m_NumberOfThreads);
+        if (m_NumberOfThreads != 0)
+            initPtr->SetNumberOfThreads(m_NumberOfThreads);
 
-    initPtr->SetPercentageKept(m_BlockPercentageKept);
-    initPtr->SetBlockSize(m_BlockSize);
-    initPtr->SetBlockSpacing(m_BlockSpacing);
-    initPtr->SetScalarVarianceThreshold(m_BlockVarianceThreshold);
-    initPtr->SetOrientedModelVarianceThreshold(m_BlockVarianceThreshold);
-    initPtr->AddGenerationMask(m_BlockGenerationMask);
+        initPtr->SetPercentageKept(m_BlockPercentageKept);
+        initPtr->SetBlockSize(m_BlockSize);
+        initPtr->SetBlockSpacing(m_BlockSpacing);
+        initPtr->SetScalarVarianceThreshold(m_BlockVarianceThreshold);
+        initPtr->SetOrientedModelVarianceThreshold(m_BlockVarianceThreshold);
+        initPtr->AddGenerationMask(m_BlockGenerationMask);
 
-    initPtr->SetRequestedRegion(m_ReferenceImage->GetLargestPossibleRegion());
+        initPtr->SetRequestedRegion(m_ReferenceImage->GetLargestPossibleRegion());
 
-    m_BlockRegions = initPtr->GetOutput();
-    m_BlockPositions = initPtr->GetOutputPositions();
+        m_BlockRegions = initPtr->GetOutput();
+        m_BlockPositions = initPtr->GetOutputPositions();
 
-    if (m_Verbose)
-        std::cout << "Generated " << m_BlockRegions.size() << " blocks..." << std::endl;
+        if (m_Verbose)
+            std::cout << "Generated " << m_BlockRegions.size() << " blocks..." << std::endl;
+    }
 
     m_BlockTransformPointers.resize(m_BlockRegions.size());
     m_BlockWeights.resize(m_BlockRegions.size());
@@ -70,6 +75,19 @@ BaseBlockMatcher <TInputImageType>
         m_BlockTransformPointers[i] = this->GetNewBlockTransform(m_BlockPositions[i]);
 }
 
+template <typename TInputImageType>
+void
+BaseBlockMatcher <TInputImageType>
+::SetBlockLayout(const std::vector <ImageRegionType> &regions, const std::vector <PointType> &positions)
+{
+    m_BlockRegions = regions;
+    m_BlockPositions = positions;
+    m_UseGivenBlockLayout = true;
+
+    // Block transforms are rebuilt on the given blocks at next update
+    m_BlockTransformPointers.clear();
+}
+
 template <typename TInputImageType>
 typename BaseBlockMatcher <TInputImageType>::OptimizerPointer
 BaseBlockMatcher <TInputImageType>
@@ -145,10 +163,13 @@ BaseBlockMatcher <TInputImageType>
     if ((m_ForceComputeBlocks) || (m_BlockTransformPointers.size() == 0))
         this->InitializeBlocks();
 
+    ANIMA_INSTRUMENT_SCOPE("block_matching");
+
     m_HighestProcessedBlock = 0;
     itk::PoolMultiThreader::Pointer threadWorker = itk::PoolMultiThreader::New();
     ThreadedMatchData *tmpStr = new ThreadedMatchData;
     tmpStr->BlockMatch = this;
+    tmpStr->OtherBlockMatch = 0;
 
     threadWorker->SetNumberOfWorkUnits(m_NumberOfThreads);
     threadWorker->SetSingleMethod(this->ThreadedMatching,tmpStr);
@@ -157,6 +178,34 @@ BaseBlockMatcher <TInputImageType>
     delete tmpStr;
 }
 
+template <typename TInputImageType>
+void
+BaseBlockMatcher <TInputImageType>
+::UpdateJointly(Self *otherMatcher)
+{
+    if ((m_ForceComputeBlocks) || (m_BlockTransformPointers.size() == 0))
+        this->InitializeBlocks();
+
+    if ((otherMatcher->m_ForceComputeBlocks) || (otherMatcher->m_BlockTransformPointers.size() == 0))
+        otherMatcher->InitializeBlocks();
+
+    ANIMA_INSTRUMENT_SCOPE("block_matching");
+
+    m_HighestProcessedBlock = 0;
+    otherMatcher->m_HighestProcessedBlock = 0;
+
+    itk::PoolMultiThreader::Pointer threadWorker = itk::PoolMultiThreader::New();
+    ThreadedMatchData *tmpStr = new ThreadedMatchData;
+    tmpStr->BlockMatch = this;
+    tmpStr->OtherBlockMatch = otherMatcher;
+
+    threadWorker->SetNumberOfWorkUnits(m_NumberOfThreads);
+    threadWorker->SetSingleMethod(this->ThreadedJointMatching,tmpStr);
+    threadWorker->SingleMethodExecute();
+
+    delete tmpStr;
+}
+
 template <typename TInputImageType>
 ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
 BaseBlockMatcher <TInputImageType>
@@ -169,6 +218,29 @@ BaseBlockMatcher <TInputImageType>
     return ITK_THREAD_RETURN_DEFAULT_VALUE;
 }
 
+template <typename TInputImageType>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+BaseBlockMatcher <TInputImageType>
+::ThreadedJointMatching(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+    ThreadedMatchData* data = (ThreadedMatchData *)threadArgs->UserData;
+
+    // Half of the threads start with the other matcher, limiting contention on block counters
+    if (threadArgs->WorkUnitID % 2 == 0)
+    {
+        data->BlockMatch->ProcessBlockMatch();
+        data->OtherBlockMatch->ProcessBlockMatch();
+    }
+    else
+    {
+        data->OtherBlockMatch->ProcessBlockMatch();
+        data->BlockMatch->ProcessBlockMatch();
+    }
+
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
 template <typename TInputImageType>
 void
 BaseBlockMatcher <TInputImageType>
@@ -216,6 +288,7 @@ BaseBlockMatcher <TInputImageType>
     // Loop over the desired blocks
     for (unsigned int block = startIndex;block < endIndex;++block)
     {
+        ANIMA_INSTRUMENT_SCOPE("block_optimization");
         this->BlockMatchingSetup(metric, block);
         optimizer->SetCostFunction(metric);
         optimizer->SetInitialPosition(m_BlockTransformPointers[block]->GetParameters());
@@ -226,6 +299,7 @@ BaseBlockMatcher <TInputImageType>
         }
         catch (itk::ExceptionObject & err)
         {
+            ANIMA_INSTRUMENT_COUNT("blocks_failed",1);
             m_BlockWeights[block] = 0;
             continue;
         }
@@ -234,6 +308,7 @@ BaseBlockMatcher <TInputImageType>
 
         double val = optimizer->GetValue(optimizer->GetCurrentPosition());
         m_BlockWeights[block] = this->ComputeBlockWeight(val,block);
+        ANIMA_INSTRUMENT_COUNT("blocks_matched",1);
     }
 }
 
@@ -31,25 +31,31 @@ public:
     itkSetMacro(ReferenceBackgroundValue, double)
     itkSetMacro(FloatingBackgroundValue, double)
 
+    //! Optional matcher for reverse blocks: if set, both directions are matched in a single threaded job
+    void SetReverseBlockMatcher(BlockMatcherType *matcher) {m_ReverseBlockMatcher = matcher;}
+
 protected:
     KissingSymmetricBMRegistrationMethod()
     {
         m_ReferenceBackgroundValue = 0;
         m_FloatingBackgroundValue = 0;
+        m_ReverseBlockMatcher = 0;
     }
 
     virtual ~KissingSymmetricBMRegistrationMethod() {}
 
     virtual void PerformOneIteration(InputImageType *refImage, InputImageType *movingImage, TransformPointer &addOn) ITK_OVERRIDE;
 
-    template <class ScalarPixelType> void ChangeDefaultBackgroundValue(itk::Image <ScalarPixelType, InputImageType::ImageDimension> *itkNotUsed(image), double backgroundValue)
+    template <class ScalarPixelType> void ChangeDefaultBackgroundValue(itk::Image <ScalarPixelType, InputImageType::ImageDimension> *itkNotUsed(image),
+                                                                       BlockMatcherType *matcher, double backgroundValue)
     {
         using BMType = anima::AnatomicalBlockMatcher <InputImageType>;
-        BMType *tmpBM = dynamic_cast <BMType *> (this->GetBlockMatcher());
+        BMType *tmpBM = dynamic_cast <BMType *> (matcher);
         tmpBM->SetDefaultBackgroundValue(backgroundValue);
     }
 
-    template <class ScalarPixelType> void ChangeDefaultBackgroundValue(itk::VectorImage <ScalarPixelType, InputImageType::ImageDimension> *itkNotUsed(image), double itkNotUsed(backgroundValue))
+    template <class ScalarPixelType> void ChangeDefaultBackgroundValue(itk::VectorImage <ScalarPixelType, InputImageType::ImageDimension> *itkNotUsed(image),
+                                                                       BlockMatcherType *itkNotUsed(matcher), double itkNotUsed(backgroundValue))
     {
         // Vector image : do nothing
     }
@@ -59,6 +65,8 @@ private:
 
     double m_ReferenceBackgroundValue;
     double m_FloatingBackgroundValue;
+
+    BlockMatcherType *m_ReverseBlockMatcher;
 };
 
 } // end namespace anima
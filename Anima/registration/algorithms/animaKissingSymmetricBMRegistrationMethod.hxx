@@ -4,9 +4,6 @@
 #include <animaBalooSVFTransformAgregator.h>
 #include <animaDenseSVFTransformAgregator.h>
 
-#include <itkMultiplyImageFilter.h>
-#include <itkSubtractImageFilter.h>
-
 namespace anima
 {
 
@@ -21,15 +18,23 @@ KissingSymmetricBMRegistrationMethod <TInputImageType>
     this->GetBlockMatcher()->SetForceComputeBlocks(true);
     this->GetBlockMatcher()->SetReferenceImage(refImage);
     this->GetBlockMatcher()->SetMovingImage(movingImage);
-
-    this->ChangeDefaultBackgroundValue(refImage, m_FloatingBackgroundValue);
     this->GetBlockMatcher()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
-    this->GetBlockMatcher()->Update();
-
-    tmpTime.Stop();
+    this->ChangeDefaultBackgroundValue(refImage, this->GetBlockMatcher(), m_FloatingBackgroundValue);
 
-    if (this->GetVerboseProgression())
-        std::cout << "Matching performed in " << tmpTime.GetTotal() << std::endl;
+    BlockMatcherType *reverseMatcher = m_ReverseBlockMatcher;
+    if (reverseMatcher)
+    {
+        // Both halfway images are ready: forward and reverse blocks are matched in a single threaded job
+        reverseMatcher->SetForceComputeBlocks(true);
+        reverseMatcher->SetReferenceImage(movingImage);
+        reverseMatcher->SetMovingImage(refImage);
+        reverseMatcher->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+        this->ChangeDefaultBackgroundValue(refImage, reverseMatcher, m_ReferenceBackgroundValue);
+
+        this->GetBlockMatcher()->UpdateJointly(reverseMatcher);
+    }
+    else
+        this->GetBlockMatcher()->Update();
 
     this->GetAgregator()->SetInputRegions(this->GetBlockMatcher()->GetBlockRegions());
     this->GetAgregator()->SetInputOrigins(this->GetBlockMatcher()->GetBlockPositions());
@@ -38,106 +43,31 @@ KissingSymmetricBMRegistrationMethod <TInputImageType>
 
     TransformPointer usualAddOn = this->GetAgregator()->GetOutput();
 
-    itk::TimeProbe tmpTimeReverse;
-    tmpTimeReverse.Start();
-
-    this->GetBlockMatcher()->SetReferenceImage(movingImage);
-    this->GetBlockMatcher()->SetMovingImage(refImage);
-
-    this->ChangeDefaultBackgroundValue(refImage, m_ReferenceBackgroundValue);
-    this->GetBlockMatcher()->Update();
-
-    tmpTimeReverse.Stop();
-
-    if (this->GetVerboseProgression())
-        std::cout << "Matching performed in " << tmpTimeReverse.GetTotal() << std::endl;
-
-    this->GetAgregator()->SetInputRegions(this->GetBlockMatcher()->GetBlockRegions());
-    this->GetAgregator()->SetInputOrigins(this->GetBlockMatcher()->GetBlockPositions());
-    this->GetAgregator()->SetInputWeights(this->GetBlockMatcher()->GetBlockWeights());
-    this->GetAgregator()->SetInputTransforms(this->GetBlockMatcher()->GetBlockTransformPointers());
-
-    TransformPointer reverseAddOn = this->GetAgregator()->GetOutput();
-
-    if (this->GetAgregator()->GetOutputTransformType() == AgregatorType::SVF)
+    if (!reverseMatcher)
     {
-        // Add update to current velocity field (cf. Vercauteren et al, 2008)
-        // First compute the SVF from two asymmetric ones: S = 0.25 * (S_0 - S_1)
-        // It's only a quarter since we are computing the half power of the transform between the two images
-        typedef typename SVFTransformType::VectorFieldType VelocityFieldType;
-
-        typedef itk::MultiplyImageFilter <VelocityFieldType,itk::Image <double,InputImageType::ImageDimension>,VelocityFieldType> MultiplyFilterType;
-        typedef itk::SubtractImageFilter <VelocityFieldType,VelocityFieldType,VelocityFieldType> SubtractFilterType;
-
-        SVFTransformType *usualAddOnCast = dynamic_cast <SVFTransformType *> (usualAddOn.GetPointer());
-        SVFTransformType *reverseAddOnCast = dynamic_cast <SVFTransformType *> (reverseAddOn.GetPointer());
-
-        typename SubtractFilterType::Pointer subFilter = SubtractFilterType::New();
-        subFilter->SetInput1(usualAddOnCast->GetParametersAsVectorField());
-        subFilter->SetInput2(reverseAddOnCast->GetParametersAsVectorField());
-        subFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
-        subFilter->InPlaceOn();
-
-        subFilter->Update();
-
-        typename MultiplyFilterType::Pointer multiplyFilter = MultiplyFilterType::New();
-        multiplyFilter->SetInput(subFilter->GetOutput());
-        multiplyFilter->SetConstant(0.25);
-        multiplyFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
-        multiplyFilter->InPlaceOn();
+        // Single matcher: reverse blocks are matched by a second update
+        reverseMatcher = this->GetBlockMatcher();
+        reverseMatcher->SetReferenceImage(movingImage);
+        reverseMatcher->SetMovingImage(refImage);
+        this->ChangeDefaultBackgroundValue(refImage, reverseMatcher, m_ReferenceBackgroundValue);
 
-        multiplyFilter->Update();
-
-        typename VelocityFieldType::Pointer addonSVF = multiplyFilter->GetOutput();
-        addonSVF->DisconnectPipeline();
-
-        usualAddOnCast->SetParametersAsVectorField(addonSVF);
+        reverseMatcher->Update();
     }
-    else
-    {
-        AffineTransformType *usualAddOnCast = dynamic_cast <AffineTransformType *> (usualAddOn.GetPointer());
-        AffineTransformType *reverseAddOnCast = dynamic_cast <AffineTransformType *> (reverseAddOn.GetPointer());
-
-        unsigned int NDimensions = InputImageType::ImageDimension;
-        vnl_matrix <double> usualAddOnMatrix(NDimensions+1,NDimensions+1,0);
-        vnl_matrix <double> reverseAddOnMatrix(NDimensions+1,NDimensions+1,0);
-        usualAddOnMatrix.set_identity();
-        reverseAddOnMatrix.set_identity();
 
-        for (unsigned int i = 0;i < NDimensions;++i)
-        {
-            for (unsigned int j = 0;j < NDimensions;++j)
-            {
-                usualAddOnMatrix(i,j) = usualAddOnCast->GetMatrix()(i,j);
-                reverseAddOnMatrix(i,j) = reverseAddOnCast->GetMatrix()(i,j);
-            }
-
-            usualAddOnMatrix(i,NDimensions) = usualAddOnCast->GetOffset()[i];
-            reverseAddOnMatrix(i,NDimensions) = reverseAddOnCast->GetOffset()[i];
-        }
-
-        usualAddOnMatrix = anima::GetLogarithm(usualAddOnMatrix);
-        reverseAddOnMatrix = anima::GetLogarithm(reverseAddOnMatrix);
-
-        usualAddOnMatrix -= reverseAddOnMatrix;
-        usualAddOnMatrix /= 4.0;
-
-        usualAddOnMatrix = anima::GetExponential(usualAddOnMatrix);
-
-        typename AffineTransformType::MatrixType trsfMatrix;
+    tmpTime.Stop();
 
-        for (unsigned int i = 0;i < NDimensions;++i)
-            for (unsigned int j = 0;j < NDimensions;++j)
-                trsfMatrix(i,j) = usualAddOnMatrix(i,j);
+    if (this->GetVerboseProgression())
+        std::cout << "Matching performed in " << tmpTime.GetTotal() << std::endl;
 
-        usualAddOnCast->SetMatrix(trsfMatrix);
+    this->GetAgregator()->SetInputRegions(reverseMatcher->GetBlockRegions());
+    this->GetAgregator()->SetInputOrigins(reverseMatcher->GetBlockPositions());
+    this->GetAgregator()->SetInputWeights(reverseMatcher->GetBlockWeights());
+    this->GetAgregator()->SetInputTransforms(reverseMatcher->GetBlockTransformPointers());
 
-        typename AffineTransformType::OffsetType trsfOffset;
-        for (unsigned int i = 0;i < NDimensions;++i)
-            trsfOffset[i] = usualAddOnMatrix(i,NDimensions);
+    TransformPointer reverseAddOn = this->GetAgregator()->GetOutput();
 
-        usualAddOnCast->SetOffset(trsfOffset);
-    }
+    // Half power of the transform between the two images: S = 0.25 * (S_0 - S_1) (cf. Vercauteren et al, 2008)
+    this->ComputeSymmetricAddOn(usualAddOn, reverseAddOn, 4.0);
 
     addOn = usualAddOn;
 }
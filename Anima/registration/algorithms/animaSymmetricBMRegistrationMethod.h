@@ -29,7 +29,7 @@ public:
     void SetReverseBlockMatcher(BlockMatcherType *matcher) {m_ReverseBlockMatcher = matcher;}
 
 protected:
-    SymmetricBMRegistrationMethod() {}
+    SymmetricBMRegistrationMethod() {m_ReverseBlockMatcher = 0;}
     virtual ~SymmetricBMRegistrationMethod() {}
 
     virtual void PerformOneIteration(InputImageType *refImage, InputImageType *movingImage, TransformPointer &addOn) ITK_OVERRIDE;
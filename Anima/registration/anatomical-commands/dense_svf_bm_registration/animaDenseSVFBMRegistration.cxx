@@ -1,6 +1,7 @@
 #include <animaPyramidalDenseSVFMatchingBridge.h>
 
 #include <tclap/CmdLine.h>
+#include <animaInstrumentationArguments.h>
 
 #include <itkTimeProbe.h>
 
@@ -59,6 +60,10 @@ int main(int argc, const char** argv)
     TCLAP::ValueArg<unsigned int> numPyramidLevelsArg("p","pyr","Number of pyramid levels (default: 3)",false,3,"number of pyramid levels",cmd);
     TCLAP::ValueArg<unsigned int> lastPyramidLevelArg("l","last-level","Index of the last pyramid level explored (default: 0)",false,0,"last pyramid level",cmd);
     TCLAP::ValueArg<unsigned int> numThreadsArg("T","threads","Number of execution threads (default: 0 = all cores)",false,0,"number of threads",cmd);
+    TCLAP::ValueArg<std::string> cacheDirArg("","cache-dir","Directory where reference pyramids are cached",false,"","cache directory",cmd);
+    TCLAP::ValueArg<unsigned long> cacheSizeArg("","cache-size","Maximum cache directory size in MB, least recently used entries are removed (default: 0 = no limit)",false,0,"maximum cache size",cmd);
+
+    anima::InstrumentationArguments instrumentationArgs(cmd);
 
     try
     {
@@ -70,6 +75,8 @@ int main(int argc, const char** argv)
         return EXIT_FAILURE;
     }
 
+    instrumentationArgs.Setup();
+
     PyramidBMType::Pointer matcher = PyramidBMType::New();
 
     ReaderType::Pointer tmpRead = ReaderType::New();
@@ -114,6 +121,8 @@ int main(int argc, const char** argv)
     matcher->SetExponentiationOrder(expOrderArg.getValue());
     matcher->SetNumberOfPyramidLevels( numPyramidLevelsArg.getValue() );
     matcher->SetLastPyramidLevel( lastPyramidLevelArg.getValue() );
+    matcher->SetCacheDirectory(cacheDirArg.getValue());
+    matcher->SetCacheMaximumSize(cacheSizeArg.getValue());
 
     if (blockMaskArg.getValue() != "")
         matcher->SetBlockGenerationMask(anima::readImage<PyramidBMType::MaskImageType>(blockMaskArg.getValue()));
@@ -15,6 +15,9 @@
 
 #include <animaAnatomicalBlockMatcher.h>
 
+#include <iomanip>
+#include <limits>
+
 namespace anima
 {
 
@@ -65,6 +68,9 @@ PyramidalDenseSVFMatchingBridge<ImageDimension>::PyramidalDenseSVFMatchingBridge
     m_ExponentiationOrder = 1;
     m_NumberOfPyramidLevels = 3;
     m_LastPyramidLevel = 0;
+
+    m_CacheDirectory = "";
+    m_CacheMaximumSize = 0;
     m_PercentageKept = 0.8;
     this->SetNumberOfWorkUnits(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads());
 
@@ -274,6 +280,17 @@ PyramidalDenseSVFMatchingBridge<ImageDimension>::Update()
                 tmpReg->SetReferenceBackgroundValue(m_ReferenceMinimalValue);
                 tmpReg->SetFloatingBackgroundValue(m_FloatingMinimalValue);
 
+                // Reverse matcher: both directions are matched in a single threaded pass
+                reverseMatcher = new BlockMatcherType;
+                reverseMatcher->SetBlockPercentageKept(GetPercentageKept());
+                reverseMatcher->SetBlockSize(GetBlockSize());
+                reverseMatcher->SetBlockSpacing(GetBlockSpacing());
+                reverseMatcher->SetBlockVarianceThreshold(GetStDevThreshold() * GetStDevThreshold());
+                reverseMatcher->SetVerbose(m_Verbose);
+                reverseMatcher->SetBlockGenerationMask(maskGenerationImage);
+                reverseMatcher->SetDefaultBackgroundValue(m_ReferenceMinimalValue);
+
+                tmpReg->SetReverseBlockMatcher(reverseMatcher);
                 m_bmreg = tmpReg;
                 break;
             }
@@ -566,6 +583,12 @@ PyramidalDenseSVFMatchingBridge<ImageDimension>::SetupPyramids()
     refResampler->SetDefaultPixelValue(m_ReferenceMinimalValue);
     m_ReferencePyramid->SetImageResampler(refResampler);
 
+    std::ostringstream cacheTag;
+    cacheTag << "default " << std::setprecision(std::numeric_limits <double>::max_digits10) << m_ReferenceMinimalValue;
+    m_ReferencePyramid->SetCacheDirectory(m_CacheDirectory);
+    m_ReferencePyramid->SetCacheMaximumSize(m_CacheMaximumSize);
+    m_ReferencePyramid->SetCacheTag(cacheTag.str());
+
     m_ReferencePyramid->Update();
 
     // Create pyramid for Floating image
@@ -596,6 +619,8 @@ PyramidalDenseSVFMatchingBridge<ImageDimension>::SetupPyramids()
         m_BlockGenerationPyramid->SetInput(m_BlockGenerationMask);
         m_BlockGenerationPyramid->SetNumberOfLevels(GetNumberOfPyramidLevels());
         m_BlockGenerationPyramid->SetNumberOfWorkUnits(GetNumberOfWorkUnits());
+        m_BlockGenerationPyramid->SetCacheDirectory(m_CacheDirectory);
+        m_BlockGenerationPyramid->SetCacheMaximumSize(m_CacheMaximumSize);
         m_BlockGenerationPyramid->Update();
     }
 }
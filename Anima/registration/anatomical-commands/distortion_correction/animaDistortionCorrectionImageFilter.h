@@ -8,6 +8,13 @@
 namespace anima
 {
 
+/**
+ * @brief Initial distortion field from a pair of EPI images with reversed phase encoding. Along each phase encoding
+ * line, cumulated intensities of both images are inverted (cubic interpolation) and the halfway displacement is
+ * resampled on the line voxels.
+ * Lines are processed by batches in preallocated buffers, cumulated lines of a batch being interleaved so that prefix
+ * sums and normalization run on all lines at once. The field is then optionally smoothed in place.
+ */
 template< typename TInputImage >
 class DistortionCorrectionImageFilter :
         public itk::ImageToImageFilter <TInputImage,itk::VectorImage< typename TInputImage::InternalPixelType,
@@ -35,6 +42,7 @@ public:
 
     itkSetMacro(Direction, unsigned int)
     itkSetMacro(FieldSmoothingSigma, double)
+    itkGetMacro(FieldSmoothingSigma, double)
 
 protected:
     DistortionCorrectionImageFilter();
@@ -48,6 +56,17 @@ protected:
     void DynamicThreadedGenerateData(const OutputImageRegionType& outputRegionForThread) ITK_OVERRIDE;
     void AfterThreadedGenerateData() ITK_OVERRIDE;
 
+    //! Number of lines processed together
+    static const unsigned int LineBatchSize = 8;
+
+    //! Inverts a cumulated line (read with stride) at regularly spaced values, scale has numInterior + 2 values
+    static void InvertCumulatedLine(const double *cumulatedLine, unsigned int stride, unsigned int lineLength,
+                                    double step, unsigned int numInterior, double *scale);
+
+    //! Resamples the halfway displacement (given on middle scale) at line voxels
+    static void ResampleDisplacementLine(const double *displacement, const double *middleScale, unsigned int scaleLength,
+                                         unsigned int lineLength, double *outputLine);
+
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(DistortionCorrectionImageFilter);
 
@@ -1,18 +1,12 @@
 #pragma once
 #include "animaDistortionCorrectionImageFilter.h"
 
-#include <itkVariableLengthVector.h>
-#include <itkImageRegionIterator.h>
-#include <itkImageRegionConstIterator.h>
-#include <itkImageLinearIteratorWithIndex.h>
+#include <itkImageRegionConstIteratorWithIndex.h>
 
 #include <animaSmoothingRecursiveYvvGaussianImageFilter.h>
 #include <animaCubicInterpolation.h>
 
 #include <vector>
-#include <cstddef>
-#include <iterator>
-#include <iostream>
 
 namespace anima
 {
@@ -22,6 +16,7 @@ DistortionCorrectionImageFilter < TInputImage >
 ::DistortionCorrectionImageFilter()
 {
     m_Direction = 0;
+    m_FieldSmoothingSigma = 0;
     this->SetNumberOfRequiredInputs( 2 );
 }
 
@@ -79,125 +74,242 @@ template< typename TInputImage >
 void DistortionCorrectionImageFilter < TInputImage >
 ::DynamicThreadedGenerateData(const OutputImageRegionType& outputRegionForThread)
 {
-    InputImagePointer  forwardImage = this->GetInput(0);
-    InputImagePointer  backwardImage = this->GetInput(1);
+    const TInputImage *forwardImage = this->GetInput(0);
+    const TInputImage *backwardImage = this->GetInput(1);
+    OutputImageType *outputImage = this->GetOutput();
 
-    typedef itk::ImageLinearConstIteratorWithIndex< TInputImage > ConstIteratorType;
-    typedef itk::ImageLinearIteratorWithIndex< OutputImageType > IteratorType;
+    unsigned int lineLength = outputRegionForThread.GetSize()[m_Direction];
+    unsigned int vectorSize = outputImage->GetNumberOfComponentsPerPixel();
+    double epsilon = 0.0001;
 
-    ConstIteratorType forwardIt (forwardImage, outputRegionForThread);
-    ConstIteratorType backwardIt (backwardImage, outputRegionForThread);
-    IteratorType outputIt (this->GetOutput(), outputRegionForThread);
+    // Line starts: region reduced to one voxel along the phase encoding direction
+    OutputImageRegionType linesRegion = outputRegionForThread;
+    linesRegion.SetSize(m_Direction,1);
 
-    forwardIt.SetDirection(m_Direction);
-    backwardIt.SetDirection(m_Direction);
-    outputIt.SetDirection(m_Direction);
+    long forwardStride = forwardImage->GetOffsetTable()[m_Direction];
+    long backwardStride = backwardImage->GetOffsetTable()[m_Direction];
+    long outputStride = outputImage->GetOffsetTable()[m_Direction] * vectorSize;
 
-    unsigned int lengthLine = outputRegionForThread.GetSize()[ this->m_Direction ];
+    // Buffers allocated once for all lines, cumulated lines of a batch are interleaved (batch index fastest)
+    unsigned int scaleMaxLength = 10 * lineLength + 1;
+    std::vector <double> forwardCumulatedLines(LineBatchSize * lineLength);
+    std::vector <double> backwardCumulatedLines(LineBatchSize * lineLength);
+    std::vector <double> forwardScale(scaleMaxLength), backwardScale(scaleMaxLength);
+    std::vector <double> differenceScale(scaleMaxLength), middleScale(scaleMaxLength);
+    std::vector <double> displacementLine(lineLength);
+    std::vector <double> normalizationFactors(LineBatchSize), forwardMinimums(LineBatchSize), backwardMinimums(LineBatchSize);
 
-    double step = 0;
-    double epsilon = 0.0001;
-    itk::VariableLengthVector< PixelType > fillVectorField(3);
-    itk::VariableLengthVector< PixelType > fillScaledVectorField(3);
-    fillVectorField.Fill(0);
-    fillScaledVectorField.Fill(0);
-
-    std::vector<double> forwardScale;
-    std::vector<double> backwardScale;
-    std::vector<double> middleScale;
-    std::vector<double> differenceForwardBackward;
-    std::vector<double> differenceForwardBackwardResampled;
-
-    while (!forwardIt.IsAtEnd())
+    std::vector <const PixelType *> forwardLines(LineBatchSize), backwardLines(LineBatchSize);
+    std::vector <PixelType *> outputLines(LineBatchSize);
+
+    typedef itk::ImageRegionConstIteratorWithIndex <TInputImage> LineStartIteratorType;
+    LineStartIteratorType lineStartItr(forwardImage,linesRegion);
+
+    while (!lineStartItr.IsAtEnd())
     {
-        // Compute Cumulative sum
-        std::vector<double> forwardCumulatedLine;
-        std::vector<double> backwardCumulatedLine;
+        unsigned int batchSize = 0;
+        while ((batchSize < LineBatchSize) && (!lineStartItr.IsAtEnd()))
+        {
+            typename TInputImage::IndexType lineIndex = lineStartItr.GetIndex();
+            forwardLines[batchSize] = forwardImage->GetBufferPointer() + forwardImage->ComputeOffset(lineIndex);
+            backwardLines[batchSize] = backwardImage->GetBufferPointer() + backwardImage->ComputeOffset(lineIndex);
+            outputLines[batchSize] = outputImage->GetBufferPointer() + outputImage->ComputeOffset(lineIndex) * vectorSize;
 
-        forwardCumulatedLine.push_back(forwardIt.Get());
-        backwardCumulatedLine.push_back(backwardIt.Get());
+            ++batchSize;
+            ++lineStartItr;
+        }
 
-        ++forwardIt;
-        ++backwardIt;
+        if (lineLength < 2)
+        {
+            for (unsigned int j = 0;j < batchSize;++j)
+            {
+                for (unsigned int k = 0;k < vectorSize;++k)
+                    outputLines[j][k] = 0;
+            }
+
+            continue;
+        }
 
-        while (!forwardIt.IsAtEndOfLine())
+        // Gather lines, then fused prefix sums on all lines of the batch
+        for (unsigned int j = 0;j < batchSize;++j)
         {
+            for (unsigned int i = 0;i < lineLength;++i)
+            {
+                forwardCumulatedLines[i * batchSize + j] = forwardLines[j][i * forwardStride];
+                backwardCumulatedLines[i * batchSize + j] = backwardLines[j][i * backwardStride];
+            }
+        }
 
-            forwardCumulatedLine.push_back(forwardCumulatedLine.back() + forwardIt.Get() + epsilon);
-            backwardCumulatedLine.push_back(backwardCumulatedLine.back() + backwardIt.Get() + epsilon);
+        for (unsigned int i = 1;i < lineLength;++i)
+        {
+            double *forwardPtr = forwardCumulatedLines.data() + i * batchSize;
+            double *backwardPtr = backwardCumulatedLines.data() + i * batchSize;
+            const double *forwardPreviousPtr = forwardPtr - batchSize;
+            const double *backwardPreviousPtr = backwardPtr - batchSize;
+            for (unsigned int j = 0;j < batchSize;++j)
+            {
+                forwardPtr[j] += forwardPreviousPtr[j] + epsilon;
+                backwardPtr[j] += backwardPreviousPtr[j] + epsilon;
+            }
+        }
 
-            ++forwardIt;
-            ++backwardIt;
+        // Backward cumulated lines are mapped on the range of the forward ones
+        double *forwardLast = forwardCumulatedLines.data() + (lineLength - 1) * batchSize;
+        double *backwardLast = backwardCumulatedLines.data() + (lineLength - 1) * batchSize;
+        for (unsigned int j = 0;j < batchSize;++j)
+        {
+            forwardMinimums[j] = forwardCumulatedLines[j];
+            backwardMinimums[j] = backwardCumulatedLines[j];
+            normalizationFactors[j] = (forwardLast[j] - forwardMinimums[j]) / (backwardLast[j] - backwardMinimums[j]);
+        }
 
+        for (unsigned int i = 0;i < lineLength - 1;++i)
+        {
+            double *backwardPtr = backwardCumulatedLines.data() + i * batchSize;
+            for (unsigned int j = 0;j < batchSize;++j)
+                backwardPtr[j] = (backwardPtr[j] - backwardMinimums[j]) * normalizationFactors[j] + forwardMinimums[j];
         }
 
-        double forwMax = forwardCumulatedLine.back();
-        double forwMin = forwardCumulatedLine.front();
-        double backMax = backwardCumulatedLine.back();
-        double backMin = backwardCumulatedLine.front();
+        // Exact end point: both lines are then inverted at the same values
+        for (unsigned int j = 0;j < batchSize;++j)
+            backwardLast[j] = forwardLast[j];
+
+        for (unsigned int j = 0;j < batchSize;++j)
+        {
+            double firstValue = forwardCumulatedLines[j];
+            double lastValue = forwardLast[j];
+            double step = (lastValue - firstValue) / (10.0 * lineLength);
 
-        for (int i=0; i<lengthLine; i++)
-            backwardCumulatedLine[i]-= backMin;
-        for (int i=0; i<lengthLine; i++)
-            backwardCumulatedLine[i]*= (forwMax - forwMin)/(backMax - backMin);
-        for (int i=0; i<lengthLine; i++)
-            backwardCumulatedLine[i]+= forwMin;
+            unsigned int numInterior = 10 * lineLength - 1;
+            while ((numInterior > 0) && (firstValue + numInterior * step >= lastValue))
+                --numInterior;
 
-        step = (forwMax - forwMin)/(10*forwardCumulatedLine.size());
+            InvertCumulatedLine(forwardCumulatedLines.data() + j, batchSize, lineLength, step, numInterior, forwardScale.data());
+            InvertCumulatedLine(backwardCumulatedLines.data() + j, batchSize, lineLength, step, numInterior, backwardScale.data());
 
-        InverseCubicInterpolator(forwardCumulatedLine, forwardScale, step);
-        InverseCubicInterpolator(backwardCumulatedLine, backwardScale, step);
+            unsigned int scaleLength = numInterior + 2;
+            for (unsigned int i = 0;i < scaleLength;++i)
+            {
+                differenceScale[i] = (forwardScale[i] - backwardScale[i]) / 2.0;
+                middleScale[i] = (forwardScale[i] + backwardScale[i]) / 2.0;
+            }
 
-        differenceForwardBackward.resize(forwardScale.size());
-        middleScale.resize(forwardScale.size());
+            ResampleDisplacementLine(differenceScale.data(), middleScale.data(), scaleLength, lineLength, displacementLine.data());
 
-        for (int i=0; i< differenceForwardBackward.size(); i++)
-        {
-            differenceForwardBackward[i] = (forwardScale[i] - backwardScale[i])/2;
-            middleScale[i] = (forwardScale[i] + backwardScale[i])/2;
+            PixelType *outputPtr = outputLines[j];
+            for (unsigned int i = 0;i < lineLength;++i)
+            {
+                for (unsigned int k = 0;k < vectorSize;++k)
+                    outputPtr[k] = m_ReferenceGeometry(k,m_Direction) * displacementLine[i];
+
+                outputPtr += outputStride;
+            }
         }
+    }
+}
 
-        CubicInterpolator<double>(differenceForwardBackward, middleScale, differenceForwardBackwardResampled, lengthLine);
+template< typename TInputImage >
+void DistortionCorrectionImageFilter < TInputImage >
+::InvertCumulatedLine(const double *cumulatedLine, unsigned int stride, unsigned int lineLength,
+                      double step, unsigned int numInterior, double *scale)
+{
+    // Cumulated values are increasing: one pass with two pointers, cubic refinement in each interval
+    double firstValue = cumulatedLine[0];
+    unsigned int lastPos = lineLength - 1;
+    unsigned int pos = 1;
 
-        unsigned int pos = 0;
+    scale[0] = 0;
+    for (unsigned int k = 1;k <= numInterior;++k)
+    {
+        double value = firstValue + k * step;
+        while ((pos < lastPos) && (cumulatedLine[pos * stride] <= value))
+            ++pos;
+
+        double x1 = pos - 1;
+        double x2 = pos;
+        double y1 = cumulatedLine[(pos - 1) * stride];
+        double y2 = cumulatedLine[pos * stride];
+
+        double x0 = x1;
+        double y0 = y1;
+        if (pos > 1)
+        {
+            x0 = pos - 2;
+            y0 = cumulatedLine[(pos - 2) * stride];
+        }
 
-        while (!outputIt.IsAtEndOfLine())
+        double x3 = x2;
+        double y3 = y2;
+        if (pos < lastPos)
         {
-            fillVectorField[m_Direction] = differenceForwardBackwardResampled[pos];
+            x3 = pos + 1;
+            y3 = cumulatedLine[(pos + 1) * stride];
+        }
 
-            for (unsigned int i = 0;i < 3;++i)
-            {
-                fillScaledVectorField[i] = m_ReferenceGeometry(i,m_Direction) * fillVectorField[m_Direction];
-            }
+        scale[k] = anima::Cubic <double> (-y3, -y2, -y1, -y0, x3, x2, x1, x0, -value);
+    }
 
-            outputIt.Set(fillScaledVectorField);
-            ++outputIt;
-            pos++;
+    scale[numInterior + 1] = lastPos;
+}
+
+template< typename TInputImage >
+void DistortionCorrectionImageFilter < TInputImage >
+::ResampleDisplacementLine(const double *displacement, const double *middleScale, unsigned int scaleLength,
+                           unsigned int lineLength, double *outputLine)
+{
+    unsigned int lastScalePos = scaleLength - 1;
+    unsigned int pos = 1;
+
+    outputLine[0] = displacement[0];
+    for (unsigned int i = 1;i < lineLength - 1;++i)
+    {
+        while ((pos < lastScalePos) && (middleScale[pos] < i))
+            ++pos;
+
+        double x0 = middleScale[pos - 1];
+        double y0 = displacement[pos - 1];
+        if (pos > 1)
+        {
+            x0 = middleScale[pos - 2];
+            y0 = displacement[pos - 2];
+        }
+
+        double x3 = middleScale[pos];
+        double y3 = displacement[pos];
+        if (pos < lastScalePos)
+        {
+            x3 = middleScale[pos + 1];
+            y3 = displacement[pos + 1];
         }
 
-        forwardIt.NextLine();
-        backwardIt.NextLine();
-        outputIt.NextLine();
+        outputLine[i] = anima::Cubic <double> (x0, middleScale[pos - 1], middleScale[pos], x3,
+                                               y0, displacement[pos - 1], displacement[pos], y3, i);
     }
+
+    outputLine[lineLength - 1] = displacement[lastScalePos];
 }
 
 template< typename TInputImage >
 void DistortionCorrectionImageFilter < TInputImage >
 ::AfterThreadedGenerateData()
 {
-    // Final step to smooth the obtained vector field
+    // Final step to smooth the obtained vector field, in place on a disconnected view of the output buffer
     if (m_FieldSmoothingSigma > 0)
     {
         typedef anima::SmoothingRecursiveYvvGaussianImageFilter <OutputImageType,OutputImageType> SmoothingFilterType;
-        
+
+        typename OutputImageType::Pointer rawField = OutputImageType::New();
+        rawField->Graft(this->GetOutput());
+
         typename SmoothingFilterType::Pointer fieldSmoother = SmoothingFilterType::New();
-        fieldSmoother->SetInput(this->GetOutput());
+        fieldSmoother->SetInput(rawField);
         fieldSmoother->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
         fieldSmoother->SetSigma(m_FieldSmoothingSigma);
-        
+        fieldSmoother->InPlaceOn();
+
         fieldSmoother->Update();
-        
-        this->SetNthOutput(0,fieldSmoother->GetOutput());
+
+        this->GraftOutput(fieldSmoother->GetOutput());
     }
 
     Superclass::AfterThreadedGenerateData();
@@ -0,0 +1,182 @@
+#include <animaDistortionCorrectionImageFilter.h>
+#include <animaCubicInterpolation.h>
+
+#include <itkImageLinearConstIteratorWithIndex.h>
+#include <itkImageRegionIterator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef itk::Image <double,3> ImageType;
+typedef anima::DistortionCorrectionImageFilter <ImageType> DistortionFilterType;
+typedef DistortionFilterType::OutputImageType FieldType;
+
+//! Previous line by line implementation: displacement along a phase encoding line, false if it was undefined
+bool ComputeReferenceLine(std::vector <double> &forwardCumulatedLine, std::vector <double> &backwardCumulatedLine,
+                          std::vector <double> &displacementLine)
+{
+    unsigned int lineLength = forwardCumulatedLine.size();
+    double forwardMax = forwardCumulatedLine.back();
+    double forwardMin = forwardCumulatedLine.front();
+    double backwardMax = backwardCumulatedLine.back();
+    double backwardMin = backwardCumulatedLine.front();
+
+    for (unsigned int i = 0;i < lineLength;++i)
+        backwardCumulatedLine[i] -= backwardMin;
+    for (unsigned int i = 0;i < lineLength;++i)
+        backwardCumulatedLine[i] *= (forwardMax - forwardMin) / (backwardMax - backwardMin);
+    for (unsigned int i = 0;i < lineLength;++i)
+        backwardCumulatedLine[i] += forwardMin;
+
+    double step = (forwardMax - forwardMin) / (10 * lineLength);
+
+    std::vector <double> forwardScale, backwardScale;
+    anima::InverseCubicInterpolator(forwardCumulatedLine,forwardScale,step);
+    anima::InverseCubicInterpolator(backwardCumulatedLine,backwardScale,step);
+
+    // Inverses of different lengths were read out of bounds
+    if (forwardScale.size() != backwardScale.size())
+        return false;
+
+    std::vector <double> difference(forwardScale.size()), middleScale(forwardScale.size());
+    for (unsigned int i = 0;i < difference.size();++i)
+    {
+        difference[i] = (forwardScale[i] - backwardScale[i]) / 2;
+        middleScale[i] = (forwardScale[i] + backwardScale[i]) / 2;
+    }
+
+    anima::CubicInterpolator <double> (difference,middleScale,displacementLine,lineLength);
+    return true;
+}
+
+ImageType::Pointer CreateImage(const ImageType::SizeType &size, std::mt19937 &generator)
+{
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    region.SetSize(size);
+    image->SetRegions(region);
+
+    ImageType::SpacingType spacing;
+    spacing[0] = 1.2;
+    spacing[1] = 2.0;
+    spacing[2] = 2.5;
+    image->SetSpacing(spacing);
+
+    ImageType::DirectionType direction;
+    double angle = 0.3;
+    direction.SetIdentity();
+    direction(0,0) = std::cos(angle);
+    direction(0,1) = - std::sin(angle);
+    direction(1,0) = std::sin(angle);
+    direction(1,1) = std::cos(angle);
+    image->SetDirection(direction);
+    image->Allocate();
+
+    // Intensities with background (null) voxels
+    std::uniform_real_distribution <double> uniformDistribution(0.0,1.0);
+    itk::ImageRegionIterator <ImageType> imageItr(image,region);
+    while (!imageItr.IsAtEnd())
+    {
+        imageItr.Set((uniformDistribution(generator) < 0.2) ? 0.0 : 100.0 * uniformDistribution(generator));
+        ++imageItr;
+    }
+
+    return image;
+}
+
+//! Compares the filter field along one direction to the previous implementation, on lines where it was defined
+bool TestDirection(ImageType *forwardImage, ImageType *backwardImage, unsigned int direction, unsigned int numThreads,
+                   double &maxError, unsigned int &numSkippedLines)
+{
+    DistortionFilterType::Pointer distortionFilter = DistortionFilterType::New();
+    distortionFilter->SetInput(0,forwardImage);
+    distortionFilter->SetInput(1,backwardImage);
+    distortionFilter->SetDirection(direction);
+    distortionFilter->SetNumberOfWorkUnits(numThreads);
+    distortionFilter->Update();
+
+    FieldType *field = distortionFilter->GetOutput();
+    double epsilon = 0.0001;
+
+    typedef itk::ImageLinearConstIteratorWithIndex <ImageType> LineIteratorType;
+    LineIteratorType forwardItr(forwardImage,forwardImage->GetLargestPossibleRegion());
+    LineIteratorType backwardItr(backwardImage,backwardImage->GetLargestPossibleRegion());
+    forwardItr.SetDirection(direction);
+    backwardItr.SetDirection(direction);
+
+    std::vector <double> forwardCumulatedLine, backwardCumulatedLine, displacementLine;
+    while (!forwardItr.IsAtEnd())
+    {
+        ImageType::IndexType lineStart = forwardItr.GetIndex();
+        forwardCumulatedLine.assign(1,forwardItr.Get());
+        backwardCumulatedLine.assign(1,backwardItr.Get());
+        ++forwardItr;
+        ++backwardItr;
+
+        while (!forwardItr.IsAtEndOfLine())
+        {
+            forwardCumulatedLine.push_back(forwardCumulatedLine.back() + forwardItr.Get() + epsilon);
+            backwardCumulatedLine.push_back(backwardCumulatedLine.back() + backwardItr.Get() + epsilon);
+            ++forwardItr;
+            ++backwardItr;
+        }
+
+        if (ComputeReferenceLine(forwardCumulatedLine,backwardCumulatedLine,displacementLine))
+        {
+            ImageType::IndexType index = lineStart;
+            for (unsigned int i = 0;i < displacementLine.size();++i)
+            {
+                index[direction] = lineStart[direction] + i;
+                FieldType::PixelType fieldValue = field->GetPixel(index);
+
+                // Displacement in voxels along the line, to physical coordinates
+                for (unsigned int j = 0;j < 3;++j)
+                {
+                    double expectedValue = forwardImage->GetDirection()(j,direction) * forwardImage->GetSpacing()[direction] * displacementLine[i];
+                    maxError = std::max(maxError,std::abs(fieldValue[j] - expectedValue) / forwardImage->GetSpacing()[direction]);
+                }
+            }
+        }
+        else
+            ++numSkippedLines;
+
+        forwardItr.NextLine();
+        backwardItr.NextLine();
+    }
+
+    // Up to sampling positions of inverted lines (multiples of the step instead of a running sum), fields are equal
+    return (maxError < 1.0e-6);
+}
+
+int main()
+{
+    std::mt19937 generator(0);
+    ImageType::SizeType size = {{13, 37, 9}};
+    ImageType::Pointer forwardImage = CreateImage(size,generator);
+    ImageType::Pointer backwardImage = CreateImage(size,generator);
+
+    bool success = true;
+    unsigned int numThreads[2] = {1, 4};
+    for (unsigned int direction = 0;direction < 3;++direction)
+    {
+        for (unsigned int i = 0;i < 2;++i)
+        {
+            double maxError = 0;
+            unsigned int numSkippedLines = 0;
+            bool testSuccess = TestDirection(forwardImage,backwardImage,direction,numThreads[i],maxError,numSkippedLines);
+
+            std::cout << "Direction " << direction << ", " << numThreads[i] << " threads: max error " << maxError
+                      << " voxels (" << numSkippedLines << " undefined reference lines)"
+                      << (testSuccess ? " -> OK" : " -> FAILED") << std::endl;
+
+            success &= testSuccess;
+        }
+    }
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -3,6 +3,7 @@
 #include <animaPyramidalBlockMatchingBridge.h>
 #include <animaPyramidalDenseSVFMatchingBridge.h>
 #include <animaReadWriteFunctions.h>
+#include <animaImageWriteArguments.h>
 #include <itkExtractImageFilter.h>
 
 #include <itkImageRegionIterator.h>
@@ -12,21 +13,289 @@
 #include <animaVelocityUtils.h>
 #include <animaResampleImageFilter.h>
 #include <animaGradientFileReader.h>
+#include <itkPlatformMultiThreader.h>
 
-int main(int argc, const char** argv)
+#include <algorithm>
+#include <mutex>
+
+const unsigned int Dimension = 3;
+
+typedef itk::Image <double,Dimension+1> InputImageType;
+typedef itk::Image <double,Dimension> InputSubImageType;
+typedef itk::ImageRegionIterator <InputImageType> InputImageIteratorType;
+typedef itk::ImageRegionIterator <InputSubImageType> InputSubImageIteratorType;
+typedef itk::ExtractImageFilter <InputImageType, InputSubImageType> ExtractFilterType;
+
+typedef anima::PyramidalBlockMatchingBridge <Dimension> PyramidBMType;
+typedef anima::BaseTransformAgregator <Dimension> AgregatorType;
+typedef itk::AffineTransform<AgregatorType::ScalarType,Dimension> AffineTransformType;
+typedef AffineTransformType::Pointer AffineTransformPointer;
+
+typedef anima::GradientFileReader < vnl_vector_fixed <double,3>, double > GFReaderType;
+
+struct arguments
+{
+    unsigned int direction, b0;
+    unsigned int blockSize, blockSpacing, nlBlockSpacing;
+    double stdevThreshold, percentageKept;
+    unsigned int blockMetric, optimizer, maxIterations;
+    double minError;
+    unsigned int optimizerMaxIterations;
+    double searchRadius, finalRadius, searchStep, translateUpperBound;
+    unsigned int symmetry, agregator;
+    double agregThreshold, extrapolationSigma, elasticSigma, outlierSigma, seStoppingThreshold;
+    unsigned int numPyramidLevels, lastPyramidLevel;
+};
+
+//! Data shared by threads correcting volumes concurrently, the input image is read and written under the lock
+struct ThreadedCorrectionData
+{
+    const arguments *args;
+    InputImageType::Pointer inputImage;
+    InputSubImageType::Pointer referenceImage;
+    GFReaderType::GradientVectorType *directions;
+
+    unsigned int numberOfThreadsPerVolume;
+    unsigned int nextVolume, numberOfProcessedVolumes;
+    bool failed;
+    std::mutex lock;
+};
+
+//! Registers one volume to the B0 image (rigid, directional affine then non linear) and replaces it by its corrected version
+void correctVolume(unsigned int volumeIndex, ThreadedCorrectionData *data)
+{
+    const arguments &args = *data->args;
+    InputImageType::Pointer inputImage = data->inputImage;
+    GFReaderType::GradientVectorType &directions = *data->directions;
+    unsigned int numThreads = data->numberOfThreadsPerVolume;
+
+    ExtractFilterType::Pointer extractFilter = ExtractFilterType::New();
+    InputSubImageType::Pointer volumeImage;
+    {
+        std::lock_guard <std::mutex> lock(data->lock);
+        extractFilter->SetInput(inputImage);
+        InputImageType::RegionType extractRegion = inputImage->GetLargestPossibleRegion();
+        extractRegion.SetIndex(Dimension,volumeIndex);
+        extractRegion.SetSize(Dimension,0);
+        extractFilter->SetExtractionRegion(extractRegion);
+        extractFilter->SetDirectionCollapseToGuess();
+        extractFilter->Update();
+
+        volumeImage = extractFilter->GetOutput();
+        volumeImage->DisconnectPipeline();
+    }
+
+    // First perform rigid registration to correct for movement
+    PyramidBMType::Pointer matcher = PyramidBMType::New();
+
+    matcher->SetBlockSize(args.blockSize);
+    matcher->SetBlockSpacing(args.blockSpacing);
+    matcher->SetStDevThreshold(args.stdevThreshold);
+    matcher->SetMetric((PyramidBMType::Metric) args.blockMetric);
+    matcher->SetOptimizer((PyramidBMType::Optimizer) args.optimizer);
+    matcher->SetMaximumIterations(args.maxIterations);
+    matcher->SetMinimalTransformError(args.minError);
+    matcher->SetFinalRadius(args.finalRadius);
+    matcher->SetOptimizerMaximumIterations(args.optimizerMaxIterations);
+    matcher->SetSearchRadius(args.searchRadius);
+    matcher->SetStepSize(args.searchStep);
+    matcher->SetTranslateUpperBound(args.translateUpperBound);
+    matcher->SetSymmetryType((PyramidBMType::SymmetryType) args.symmetry);
+    matcher->SetAgregator((PyramidBMType::Agregator) args.agregator);
+    matcher->SetOutputTransformType(PyramidBMType::outRigid);
+    matcher->SetAgregThreshold(args.agregThreshold);
+    matcher->SetSeStoppingThreshold(args.seStoppingThreshold);
+    matcher->SetNumberOfPyramidLevels(args.numPyramidLevels);
+    matcher->SetLastPyramidLevel(args.lastPyramidLevel);
+    matcher->SetVerbose(false);
+
+    matcher->SetNumberOfWorkUnits(numThreads);
+
+    matcher->SetPercentageKept( args.percentageKept );
+    matcher->SetTransformInitializationType(PyramidBMType::GravityCenters);
+
+    matcher->SetFloatingImage(data->referenceImage);
+    matcher->SetReferenceImage(volumeImage);
+
+    AffineTransformPointer rigidTrsf = AffineTransformType::New();
+    rigidTrsf->SetIdentity();
+    matcher->SetOutputTransform(rigidTrsf.GetPointer());
+
+    matcher->Update();
+
+    rigidTrsf = dynamic_cast <AffineTransformType *> (matcher->GetOutputTransform().GetPointer());
+
+    InputSubImageType::Pointer rigidReference = matcher->GetOutputImage();
+
+    // Then perform directional affine registration
+    matcher->SetReferenceImage(rigidReference);
+    matcher->SetFloatingImage(volumeImage);
+    matcher->SetTransform(PyramidBMType::Directional_Affine);
+    matcher->SetOutputTransformType(PyramidBMType::outAffine);
+    matcher->SetAffineDirection(args.direction);
+    matcher->SetTransformInitializationType(PyramidBMType::Identity);
+
+    AffineTransformPointer initTrsf = AffineTransformType::New();
+    initTrsf->SetIdentity();
+    matcher->SetInitialTransform(initTrsf);
+
+    AffineTransformPointer tmpTrsfDirectional = AffineTransformType::New();
+    tmpTrsfDirectional->SetIdentity();
+    matcher->SetOutputTransform(tmpTrsfDirectional.GetPointer());
+
+    matcher->Update();
+
+    // Finally, perform non linear registration to get rid of non linear distortions
+    typedef anima::PyramidalDenseSVFMatchingBridge <Dimension> NonLinearPyramidBMType;
+    NonLinearPyramidBMType::Pointer nonLinearMatcher = NonLinearPyramidBMType::New();
+
+    nonLinearMatcher->SetReferenceImage(rigidReference);
+    nonLinearMatcher->SetFloatingImage(matcher->GetOutputImage());
+
+    // Setting matcher arguments
+    nonLinearMatcher->SetBlockSize(args.blockSize);
+    nonLinearMatcher->SetBlockSpacing(args.nlBlockSpacing);
+    nonLinearMatcher->SetStDevThreshold(args.stdevThreshold);
+    nonLinearMatcher->SetTransform(NonLinearPyramidBMType::Directional_Affine);
+    nonLinearMatcher->SetAffineDirection(args.direction);
+    nonLinearMatcher->SetMetric((NonLinearPyramidBMType::Metric) args.blockMetric);
+    nonLinearMatcher->SetOptimizer((NonLinearPyramidBMType::Optimizer) args.optimizer);
+    nonLinearMatcher->SetMaximumIterations(args.maxIterations);
+    nonLinearMatcher->SetMinimalTransformError(args.minError);
+    nonLinearMatcher->SetFinalRadius(args.finalRadius);
+    nonLinearMatcher->SetOptimizerMaximumIterations(args.optimizerMaxIterations);
+    nonLinearMatcher->SetSearchRadius(args.searchRadius);
+    nonLinearMatcher->SetStepSize(args.searchStep);
+    nonLinearMatcher->SetTranslateUpperBound(args.translateUpperBound);
+    nonLinearMatcher->SetSymmetryType((NonLinearPyramidBMType::SymmetryType) args.symmetry);
+    nonLinearMatcher->SetAgregator(NonLinearPyramidBMType::Baloo);
+    nonLinearMatcher->SetBCHCompositionOrder(1);
+    nonLinearMatcher->SetExponentiationOrder(0);
+    nonLinearMatcher->SetExtrapolationSigma(args.extrapolationSigma);
+    nonLinearMatcher->SetElasticSigma(args.elasticSigma);
+    nonLinearMatcher->SetOutlierSigma(args.outlierSigma);
+    nonLinearMatcher->SetNumberOfPyramidLevels(args.numPyramidLevels);
+    nonLinearMatcher->SetLastPyramidLevel(args.lastPyramidLevel);
+    nonLinearMatcher->SetVerbose(false);
+
+    nonLinearMatcher->SetNumberOfWorkUnits(numThreads);
+
+    nonLinearMatcher->SetPercentageKept(args.percentageKept);
+
+    nonLinearMatcher->Update();
+
+    // Finally, apply transform serie to image
+    typedef itk::CompositeTransform <AgregatorType::ScalarType,Dimension> GeneralTransformType;
+    GeneralTransformType::Pointer transformSerie = GeneralTransformType::New();
+    transformSerie->AddTransform(tmpTrsfDirectional);
+
+    typedef itk::StationaryVelocityFieldTransform <AgregatorType::ScalarType,Dimension> SVFTransformType;
+    typedef SVFTransformType::Pointer SVFTransformPointer;
+
+    typedef rpi::DisplacementFieldTransform <AgregatorType::ScalarType,Dimension> DenseTransformType;
+    typedef DenseTransformType::Pointer DenseTransformPointer;
+
+    SVFTransformPointer svfPointer = nonLinearMatcher->GetOutputTransform();
+
+    DenseTransformPointer dispTrsf = DenseTransformType::New();
+    anima::GetSVFExponential(svfPointer.GetPointer(),dispTrsf.GetPointer(),0,numThreads,false);
+
+    transformSerie->AddTransform(dispTrsf.GetPointer());
+
+    // Apply rigid matrix to gradient vectors
+    AffineTransformType::MatrixType rigidMatrix = rigidTrsf->GetMatrix();
+    vnl_vector_fixed <double,3> tmpDir(0.0);
+    for (unsigned int j = 0;j < 3;++j)
+    {
+        for (unsigned int k = 0;k < 3;++k)
+            tmpDir[j] += rigidMatrix(j,k) * directions[volumeIndex][k];
+    }
+
+    directions[volumeIndex] = tmpDir;
+
+    AffineTransformPointer rigidTrsfInverse = AffineTransformType::New();
+    rigidTrsf->GetInverse(rigidTrsfInverse);
+    transformSerie->AddTransform(rigidTrsfInverse.GetPointer());
+
+    typedef anima::ResampleImageFilter<InputSubImageType, InputSubImageType> ResampleFilterType;
+    ResampleFilterType::Pointer scalarResampler = ResampleFilterType::New();
+
+    InputSubImageType::SizeType size = data->referenceImage->GetLargestPossibleRegion().GetSize();
+    InputSubImageType::PointType origin = data->referenceImage->GetOrigin();
+    InputSubImageType::SpacingType spacing = data->referenceImage->GetSpacing();
+    InputSubImageType::DirectionType direction = data->referenceImage->GetDirection();
+
+    scalarResampler->SetTransform(transformSerie);
+    scalarResampler->SetSize(size);
+    scalarResampler->SetOutputOrigin(origin);
+    scalarResampler->SetOutputSpacing(spacing);
+    scalarResampler->SetOutputDirection(direction);
+
+    scalarResampler->SetInput(volumeImage);
+    scalarResampler->SetNumberOfWorkUnits(numThreads);
+    scalarResampler->Update();
+
+    // Corrected volume replaces the input one
+    std::lock_guard <std::mutex> lock(data->lock);
+    InputSubImageType::RegionType regionSubImage = scalarResampler->GetOutput()->GetLargestPossibleRegion();
+    InputImageType::RegionType regionImage = inputImage->GetLargestPossibleRegion();
+    regionImage.SetIndex(Dimension,volumeIndex);
+    regionImage.SetSize(Dimension,1);
+
+    InputImageIteratorType outIterator(inputImage,regionImage);
+    InputSubImageIteratorType inIterator(scalarResampler->GetOutput(),regionSubImage);
+
+    while (!inIterator.IsAtEnd())
+    {
+        outIterator.Set(inIterator.Get());
+
+        ++inIterator;
+        ++outIterator;
+    }
+
+    ++data->numberOfProcessedVolumes;
+    std::cout << "\033[K\rProcessed image " << data->numberOfProcessedVolumes << " out of "
+              << inputImage->GetLargestPossibleRegion().GetSize()[Dimension] - 1 << std::flush;
+}
+
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION threadedCorrection(void *arg)
 {
-    const unsigned int Dimension = 3;
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+    ThreadedCorrectionData *data = (ThreadedCorrectionData *)threadArgs->UserData;
+    unsigned int numberOfImages = data->inputImage->GetLargestPossibleRegion().GetSize()[Dimension];
 
-    typedef itk::Image <double,Dimension+1> InputImageType;
-    typedef itk::Image <double,Dimension> InputSubImageType;
-    typedef itk::ImageRegionIterator <InputImageType> InputImageIteratorType;
-    typedef itk::ImageRegionIterator <InputSubImageType> InputSubImageIteratorType;
+    while (true)
+    {
+        unsigned int volumeIndex;
+        {
+            std::lock_guard <std::mutex> lock(data->lock);
+            if (data->nextVolume == data->args->b0)
+                ++data->nextVolume;
+
+            if ((data->nextVolume >= numberOfImages) || data->failed)
+                break;
+
+            volumeIndex = data->nextVolume;
+            ++data->nextVolume;
+        }
+
+        try
+        {
+            correctVolume(volumeIndex,data);
+        }
+        catch (itk::ExceptionObject &e)
+        {
+            std::lock_guard <std::mutex> lock(data->lock);
+            std::cerr << e << std::endl;
+            data->failed = true;
+        }
+    }
 
-    typedef anima::PyramidalBlockMatchingBridge <Dimension> PyramidBMType;
-    typedef anima::BaseTransformAgregator <Dimension> AgregatorType;
-    typedef itk::AffineTransform<AgregatorType::ScalarType,Dimension> AffineTransformType;
-    typedef AffineTransformType::Pointer AffineTransformPointer;
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
 
+int main(int argc, const char** argv)
+{
     // Parsing arguments
     TCLAP::CmdLine  cmd("INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
 
@@ -69,6 +338,9 @@ int main(int argc, const char** argv)
     TCLAP::ValueArg<unsigned int> numPyramidLevelsArg("p","pyr","Number of pyramid levels (default: 3)",false,3,"number of pyramid levels",cmd);
     TCLAP::ValueArg<unsigned int> lastPyramidLevelArg("l","last-level","Index of the last pyramid level explored (default: 0)",false,0,"last pyramid level",cmd);
     TCLAP::ValueArg<unsigned int> numThreadsArg("T","threads","Number of execution threads (default: 0 = all cores)",false,0,"number of threads",cmd);
+    TCLAP::ValueArg<unsigned int> concurrentArg("","concurrent","Number of volumes corrected concurrently, threads being split between them (default: 0 = automatic)",false,0,"number of concurrent volumes",cmd);
+
+    anima::ImageWriteArguments imageWriteArgs(cmd);
 
     try
     {
@@ -80,9 +352,37 @@ int main(int argc, const char** argv)
         return EXIT_FAILURE;
     }
 
+    imageWriteArgs.Setup();
+
+    arguments args;
+    args.direction = directionArg.getValue();
+    args.b0 = b0Arg.getValue();
+    args.blockSize = blockSizeArg.getValue();
+    args.blockSpacing = blockSpacingArg.getValue();
+    args.nlBlockSpacing = nlBlockSpacingArg.getValue();
+    args.stdevThreshold = stdevThresholdArg.getValue();
+    args.percentageKept = percentageKeptArg.getValue();
+    args.blockMetric = blockMetricArg.getValue();
+    args.optimizer = optimizerArg.getValue();
+    args.maxIterations = maxIterationsArg.getValue();
+    args.minError = minErrorArg.getValue();
+    args.optimizerMaxIterations = optimizerMaxIterationsArg.getValue();
+    args.searchRadius = searchRadiusArg.getValue();
+    args.finalRadius = finalRadiusArg.getValue();
+    args.searchStep = searchStepArg.getValue();
+    args.translateUpperBound = translateUpperBoundArg.getValue();
+    args.symmetry = symmetryArg.getValue();
+    args.agregator = agregatorArg.getValue();
+    args.agregThreshold = agregThresholdArg.getValue();
+    args.extrapolationSigma = extrapolationSigmaArg.getValue();
+    args.elasticSigma = elasticSigmaArg.getValue();
+    args.outlierSigma = outlierSigmaArg.getValue();
+    args.seStoppingThreshold = seStoppingThresholdArg.getValue();
+    args.numPyramidLevels = numPyramidLevelsArg.getValue();
+    args.lastPyramidLevel = lastPyramidLevelArg.getValue();
+
     InputImageType::Pointer inputImage = anima::readImage <InputImageType> (inputArg.getValue());
     unsigned int numberOfImages = inputImage->GetLargestPossibleRegion().GetSize()[Dimension];
-    typedef itk::ExtractImageFilter <InputImageType, InputSubImageType> ExtractFilterType;
 
     ExtractFilterType::Pointer referenceExtractFilter = ExtractFilterType::New();
     referenceExtractFilter->SetInput(inputImage);
@@ -93,7 +393,9 @@ int main(int argc, const char** argv)
     referenceExtractFilter->SetDirectionCollapseToGuess();
     referenceExtractFilter->Update();
 
-    typedef anima::GradientFileReader < vnl_vector_fixed <double,3>, double > GFReaderType;
+    InputSubImageType::Pointer referenceImage = referenceExtractFilter->GetOutput();
+    referenceImage->DisconnectPipeline();
+
     GFReaderType gfReader;
     gfReader.SetGradientFileName(inBVecArg.getValue());
     gfReader.SetGradientIndependentNormalization(false);
@@ -101,215 +403,39 @@ int main(int argc, const char** argv)
 
     GFReaderType::GradientVectorType directions = gfReader.GetGradients();
 
-    for (unsigned int i = 0;i < numberOfImages;++i)
-    {
-        if (i == b0Arg.getValue())
-            continue;
-
-        std::cout << "\033[K\rProcessing image " << i+1 << " out of " << numberOfImages << std::flush;
-
-        ExtractFilterType::Pointer extractFilter = ExtractFilterType::New();
-        extractFilter->SetInput(inputImage);
-        InputImageType::RegionType extractRegion = inputImage->GetLargestPossibleRegion();
-        extractRegion.SetIndex(Dimension,i);
-        extractRegion.SetSize(Dimension,0);
-        extractFilter->SetExtractionRegion(extractRegion);
-        extractFilter->SetDirectionCollapseToGuess();
-        extractFilter->Update();
-
-        // First perform rigid registration to correct for movement
-        PyramidBMType::Pointer matcher = PyramidBMType::New();
-
-        matcher->SetBlockSize(blockSizeArg.getValue());
-        matcher->SetBlockSpacing(blockSpacingArg.getValue());
-        matcher->SetStDevThreshold(stdevThresholdArg.getValue());
-        matcher->SetMetric((PyramidBMType::Metric) blockMetricArg.getValue());
-        matcher->SetOptimizer((PyramidBMType::Optimizer) optimizerArg.getValue());
-        matcher->SetMaximumIterations(maxIterationsArg.getValue());
-        matcher->SetMinimalTransformError(minErrorArg.getValue());
-        matcher->SetFinalRadius(finalRadiusArg.getValue());
-        matcher->SetOptimizerMaximumIterations(optimizerMaxIterationsArg.getValue());
-        matcher->SetSearchRadius(searchRadiusArg.getValue());
-        matcher->SetStepSize(searchStepArg.getValue());
-        matcher->SetTranslateUpperBound(translateUpperBoundArg.getValue());
-        matcher->SetSymmetryType((PyramidBMType::SymmetryType) symmetryArg.getValue());
-        matcher->SetAgregator((PyramidBMType::Agregator) agregatorArg.getValue());
-        matcher->SetOutputTransformType(PyramidBMType::outRigid);
-        matcher->SetAgregThreshold(agregThresholdArg.getValue());
-        matcher->SetSeStoppingThreshold(seStoppingThresholdArg.getValue());
-        matcher->SetNumberOfPyramidLevels(numPyramidLevelsArg.getValue());
-        matcher->SetLastPyramidLevel(lastPyramidLevelArg.getValue());
-        matcher->SetVerbose(false);
-
-        if (numThreadsArg.getValue() != 0)
-            matcher->SetNumberOfWorkUnits( numThreadsArg.getValue() );
-
-        matcher->SetPercentageKept( percentageKeptArg.getValue() );
-        matcher->SetTransformInitializationType(PyramidBMType::GravityCenters);
-
-        matcher->SetFloatingImage(referenceExtractFilter->GetOutput());
-        matcher->SetReferenceImage(extractFilter->GetOutput());
-
-        AffineTransformPointer rigidTrsf = AffineTransformType::New();
-        rigidTrsf->SetIdentity();
-        matcher->SetOutputTransform(rigidTrsf.GetPointer());
-
-        try
-        {
-            matcher->Update();
-        }
-        catch (itk::ExceptionObject &e)
-        {
-            std::cerr << e << std::endl;
-            return EXIT_FAILURE;
-        }
-
-        rigidTrsf = dynamic_cast <AffineTransformType *> (matcher->GetOutputTransform().GetPointer());
-
-        InputSubImageType::Pointer rigidReference = matcher->GetOutputImage();
-
-        // Then perform directional affine registration
-        matcher->SetReferenceImage(rigidReference);
-        matcher->SetFloatingImage(extractFilter->GetOutput());
-        matcher->SetTransform(PyramidBMType::Directional_Affine);
-        matcher->SetOutputTransformType(PyramidBMType::outAffine);
-        matcher->SetAffineDirection(directionArg.getValue());
-        matcher->SetTransformInitializationType(PyramidBMType::Identity);
-
-        AffineTransformPointer initTrsf = AffineTransformType::New();
-        initTrsf->SetIdentity();
-        matcher->SetInitialTransform(initTrsf);
-
-        AffineTransformPointer tmpTrsfDirectional = AffineTransformType::New();
-        tmpTrsfDirectional->SetIdentity();
-        matcher->SetOutputTransform(tmpTrsfDirectional.GetPointer());
-
-        try
-        {
-            matcher->Update();
-        }
-        catch (itk::ExceptionObject &e)
-        {
-            std::cerr << e << std::endl;
-            return EXIT_FAILURE;
-        }
-
-        // Finally, perform non linear registration to get rid of non linear distortions
-        typedef anima::PyramidalDenseSVFMatchingBridge <Dimension> NonLinearPyramidBMType;
-        NonLinearPyramidBMType::Pointer nonLinearMatcher = NonLinearPyramidBMType::New();
-
-        nonLinearMatcher->SetReferenceImage(rigidReference);
-        nonLinearMatcher->SetFloatingImage(matcher->GetOutputImage());
-
-        // Setting matcher arguments
-        nonLinearMatcher->SetBlockSize(blockSizeArg.getValue());
-        nonLinearMatcher->SetBlockSpacing(nlBlockSpacingArg.getValue());
-        nonLinearMatcher->SetStDevThreshold(stdevThresholdArg.getValue());
-        nonLinearMatcher->SetTransform(NonLinearPyramidBMType::Directional_Affine);
-        nonLinearMatcher->SetAffineDirection(directionArg.getValue());
-        nonLinearMatcher->SetMetric((NonLinearPyramidBMType::Metric) blockMetricArg.getValue());
-        nonLinearMatcher->SetOptimizer((NonLinearPyramidBMType::Optimizer) optimizerArg.getValue());
-        nonLinearMatcher->SetMaximumIterations(maxIterationsArg.getValue());
-        nonLinearMatcher->SetMinimalTransformError(minErrorArg.getValue());
-        nonLinearMatcher->SetFinalRadius(finalRadiusArg.getValue());
-        nonLinearMatcher->SetOptimizerMaximumIterations(optimizerMaxIterationsArg.getValue());
-        nonLinearMatcher->SetSearchRadius(searchRadiusArg.getValue());
-        nonLinearMatcher->SetStepSize(searchStepArg.getValue());
-        nonLinearMatcher->SetTranslateUpperBound(translateUpperBoundArg.getValue());
-        nonLinearMatcher->SetSymmetryType((NonLinearPyramidBMType::SymmetryType) symmetryArg.getValue());
-        nonLinearMatcher->SetAgregator(NonLinearPyramidBMType::Baloo);
-        nonLinearMatcher->SetBCHCompositionOrder(1);
-        nonLinearMatcher->SetExponentiationOrder(0);
-        nonLinearMatcher->SetExtrapolationSigma(extrapolationSigmaArg.getValue());
-        nonLinearMatcher->SetElasticSigma(elasticSigmaArg.getValue());
-        nonLinearMatcher->SetOutlierSigma(outlierSigmaArg.getValue());
-        nonLinearMatcher->SetNumberOfPyramidLevels(numPyramidLevelsArg.getValue());
-        nonLinearMatcher->SetLastPyramidLevel(lastPyramidLevelArg.getValue());
-        nonLinearMatcher->SetVerbose(false);
-
-        if (numThreadsArg.getValue() != 0)
-            nonLinearMatcher->SetNumberOfWorkUnits(numThreadsArg.getValue());
-
-        nonLinearMatcher->SetPercentageKept(percentageKeptArg.getValue());
-
-        try
-        {
-            nonLinearMatcher->Update();
-        }
-        catch (itk::ExceptionObject &e)
-        {
-            std::cerr << e << std::endl;
-            return EXIT_FAILURE;
-        }
-
-        // Finally, apply transform serie to image
-        typedef itk::CompositeTransform <AgregatorType::ScalarType,Dimension> GeneralTransformType;
-        GeneralTransformType::Pointer transformSerie = GeneralTransformType::New();
-        transformSerie->AddTransform(tmpTrsfDirectional);
-
-        typedef itk::StationaryVelocityFieldTransform <AgregatorType::ScalarType,Dimension> SVFTransformType;
-        typedef SVFTransformType::Pointer SVFTransformPointer;
-
-        typedef rpi::DisplacementFieldTransform <AgregatorType::ScalarType,Dimension> DenseTransformType;
-        typedef DenseTransformType::Pointer DenseTransformPointer;
-
-        SVFTransformPointer svfPointer = nonLinearMatcher->GetOutputTransform();
-
-        DenseTransformPointer dispTrsf = DenseTransformType::New();
-        anima::GetSVFExponential(svfPointer.GetPointer(),dispTrsf.GetPointer(),0,numThreadsArg.getValue(),false);
-
-        transformSerie->AddTransform(dispTrsf.GetPointer());
-
-        // Apply rigid matrix to gradient vectors
-        AffineTransformType::MatrixType rigidMatrix = rigidTrsf->GetMatrix();
-        vnl_vector_fixed <double,3> tmpDir(0.0);
-        for (unsigned int j = 0;j < 3;++j)
-        {
-            for (unsigned int k = 0;k < 3;++k)
-                tmpDir[j] += rigidMatrix(j,k) * directions[i][k];
-        }
-
-        directions[i] = tmpDir;
-
-        AffineTransformPointer rigidTrsfInverse = AffineTransformType::New();
-        rigidTrsf->GetInverse(rigidTrsfInverse);
-        transformSerie->AddTransform(rigidTrsfInverse.GetPointer());
-
-        typedef anima::ResampleImageFilter<InputSubImageType, InputSubImageType> ResampleFilterType;
-        ResampleFilterType::Pointer scalarResampler = ResampleFilterType::New();
-
-        InputSubImageType::SizeType size = referenceExtractFilter->GetOutput()->GetLargestPossibleRegion().GetSize();
-        InputSubImageType::PointType origin = referenceExtractFilter->GetOutput()->GetOrigin();
-        InputSubImageType::SpacingType spacing = referenceExtractFilter->GetOutput()->GetSpacing();
-        InputSubImageType::DirectionType direction = referenceExtractFilter->GetOutput()->GetDirection();
-
-        scalarResampler->SetTransform(transformSerie);
-        scalarResampler->SetSize(size);
-        scalarResampler->SetOutputOrigin(origin);
-        scalarResampler->SetOutputSpacing(spacing);
-        scalarResampler->SetOutputDirection(direction);
-
-        scalarResampler->SetInput(extractFilter->GetOutput());
-        if (numThreadsArg.getValue() != 0)
-            scalarResampler->SetNumberOfWorkUnits(numThreadsArg.getValue());
-        scalarResampler->Update();
-
-        InputSubImageType::RegionType regionSubImage = scalarResampler->GetOutput()->GetLargestPossibleRegion();
-        InputImageType::RegionType regionImage = inputImage->GetLargestPossibleRegion();
-        regionImage.SetIndex(Dimension,i);
-        regionImage.SetSize(Dimension,1);
-
-        InputImageIteratorType outIterator(inputImage,regionImage);
-        InputSubImageIteratorType inIterator(scalarResampler->GetOutput(),regionSubImage);
-
-        while (!inIterator.IsAtEnd())
-        {
-            outIterator.Set(inIterator.Get());
-
-            ++inIterator;
-            ++outIterator;
-        }
-    }
+    // Volumes are corrected concurrently, the number of threads being split between them
+    unsigned int numberOfThreads = numThreadsArg.getValue();
+    if (numberOfThreads == 0)
+        numberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+
+    unsigned int numberOfConcurrentVolumes = concurrentArg.getValue();
+    if (numberOfConcurrentVolumes == 0)
+        numberOfConcurrentVolumes = std::max(1U, numberOfThreads / 2);
+
+    numberOfConcurrentVolumes = std::min(numberOfConcurrentVolumes, std::max(1U, numberOfImages - 1));
+    numberOfConcurrentVolumes = std::min(numberOfConcurrentVolumes, numberOfThreads);
+
+    ThreadedCorrectionData *correctionData = new ThreadedCorrectionData;
+    correctionData->args = &args;
+    correctionData->inputImage = inputImage;
+    correctionData->referenceImage = referenceImage;
+    correctionData->directions = &directions;
+    correctionData->numberOfThreadsPerVolume = std::max(1U, numberOfThreads / numberOfConcurrentVolumes);
+    correctionData->nextVolume = 0;
+    correctionData->numberOfProcessedVolumes = 0;
+    correctionData->failed = false;
+
+    // Platform threads: each volume runs its own pool threaded filters, pool threads would be exhausted
+    itk::PlatformMultiThreader::Pointer threadWorker = itk::PlatformMultiThreader::New();
+    threadWorker->SetNumberOfWorkUnits(numberOfConcurrentVolumes);
+    threadWorker->SetSingleMethod(threadedCorrection,correctionData);
+    threadWorker->SingleMethodExecute();
+
+    bool correctionFailed = correctionData->failed;
+    delete correctionData;
+
+    if (correctionFailed)
+        return EXIT_FAILURE;
 
     std::cout << std::endl;
 
@@ -1,4 +1,5 @@
 #include <tclap/CmdLine.h>
+#include <animaInstrumentationArguments.h>
 
 #include <animaPyramidalBlockMatchingBridge.h>
 #include <animaReadWriteFunctions.h>
@@ -6,6 +7,19 @@
 #include <itkTimeProbe.h>
 #include <itkTransformFileReader.h>
 
+//! Optional list of file names: one per floating image, or empty names if no list is given
+std::vector <std::string> readOptionalFileList(const std::string &fileName, unsigned int numberOfFiles)
+{
+    if (fileName == "")
+        return std::vector <std::string> (numberOfFiles,"");
+
+    std::vector <std::string> fileList = anima::readFileList(fileName);
+    if (fileList.size() != numberOfFiles)
+        throw itk::ExceptionObject(__FILE__, __LINE__, "Number of files in " + fileName + " does not match the number of moving images", ITK_LOCATION);
+
+    return fileList;
+}
+
 int main(int argc, const char** argv)
 {
     const unsigned int Dimension = 3;
@@ -23,7 +37,8 @@ int main(int argc, const char** argv)
 
     // Setting up parameters
     TCLAP::ValueArg<std::string> fixedArg("r","refimage","Fixed image",true,"","fixed image",cmd);
-    TCLAP::ValueArg<std::string> movingArg("m","movingimage","Moving image",true,"","moving image",cmd);
+    TCLAP::ValueArg<std::string> movingArg("m","movingimage","Moving image (required unless --moving-list is given)",false,"","moving image",cmd);
+    TCLAP::ValueArg<std::string> movingListArg("","moving-list","Text file listing moving images for group registration: -o, -O, -i, --out-rigid and --out-sim are then lists as well",false,"","moving images list",cmd);
     TCLAP::ValueArg<std::string> outArg("o","outputimage","Output (registered) image",true,"","output image",cmd);
     TCLAP::ValueArg<unsigned int> outTrTypeArg("","ot","Output transformation type (0: rigid, 1: translation, 2: affine, 3: anisotropic_sim, default: 0)",false,0,"output transformation type",cmd);
 
@@ -70,6 +85,11 @@ int main(int argc, const char** argv)
     TCLAP::ValueArg<unsigned int> numPyramidLevelsArg("p","pyr","Number of pyramid levels (default: 3)",false,3,"number of pyramid levels",cmd);
     TCLAP::ValueArg<unsigned int> lastPyramidLevelArg("l","last-level","Index of the last pyramid level explored (default: 0)",false,0,"last pyramid level",cmd);
     TCLAP::ValueArg<unsigned int> numThreadsArg("T","threads","Number of execution threads (default: 0 = all cores)",false,0,"number of threads",cmd);
+    TCLAP::ValueArg<unsigned int> concurrentArg("","concurrent","Group registration: number of registrations run concurrently, threads being split between them (default: 0 = automatic)",false,0,"number of concurrent registrations",cmd);
+    TCLAP::ValueArg<std::string> cacheDirArg("","cache-dir","Directory where reference pyramids and block layouts are cached",false,"","cache directory",cmd);
+    TCLAP::ValueArg<unsigned long> cacheSizeArg("","cache-size","Maximum cache directory size in MB, least recently used entries are removed (default: 0 = no limit)",false,0,"maximum cache size",cmd);
+
+    anima::InstrumentationArguments instrumentationArgs(cmd);
 
     try
     {
@@ -81,6 +101,14 @@ int main(int argc, const char** argv)
         return EXIT_FAILURE;
     }
 
+    instrumentationArgs.Setup();
+
+    if ((movingArg.getValue() == "") == (movingListArg.getValue() == ""))
+    {
+        std::cerr << "Error: exactly one of a moving image (-m) or a moving images list (--moving-list) is required" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     // Setting matcher arguments
     matcher->SetBlockSize( blockSizeArg.getValue() );
     matcher->SetBlockSpacing( blockSpacingArg.getValue() );
@@ -117,25 +145,57 @@ int main(int argc, const char** argv)
     matcher->SetPercentageKept( percentageKeptArg.getValue() );
 
     matcher->SetTransformInitializationType((PyramidBMType::InitializationType)initTypeArg.getValue());
+    matcher->SetCacheDirectory(cacheDirArg.getValue());
+    matcher->SetCacheMaximumSize(cacheSizeArg.getValue());
+
+    bool groupRegistration = (movingListArg.getValue() != "");
 
-    matcher->SetResultFile(outArg.getValue());
-    matcher->SetOutputTransformFile(outputTransformArg.getValue());
-    matcher->SetOutputNearestRigidTransformFile(outputNRTransformArg.getValue());
-    matcher->SetOutputNearestSimilarityTransformFile(outputNSTransformArg.getValue());
+    try
+    {
+        matcher->SetReferenceImage(anima::readImage <InputImageType> (fixedArg.getValue()));
+
+        if (directionTransformArg.getValue() != "")
+            matcher->SetDirectionTransform(directionTransformArg.getValue());
+
+        if (groupRegistration)
+        {
+            std::vector <std::string> movingNames = anima::readFileList(movingListArg.getValue());
+            unsigned int numMovingImages = movingNames.size();
+
+            std::vector <std::string> outNames = readOptionalFileList(outArg.getValue(),numMovingImages);
+            std::vector <std::string> outTrsfNames = readOptionalFileList(outputTransformArg.getValue(),numMovingImages);
+            std::vector <std::string> initTrsfNames = readOptionalFileList(initialTransformArg.getValue(),numMovingImages);
+            std::vector <std::string> outNRNames = readOptionalFileList(outputNRTransformArg.getValue(),numMovingImages);
+            std::vector <std::string> outNSNames = readOptionalFileList(outputNSTransformArg.getValue(),numMovingImages);
+
+            for (unsigned int i = 0;i < numMovingImages;++i)
+                matcher->AddGroupFloatingImage(movingNames[i],outNames[i],outTrsfNames[i],initTrsfNames[i],outNRNames[i],outNSNames[i]);
 
-    matcher->SetReferenceImage(anima::readImage <InputImageType> (fixedArg.getValue()));
-    matcher->SetFloatingImage(anima::readImage <InputImageType> (movingArg.getValue()));
+            matcher->SetNumberOfConcurrentRegistrations(concurrentArg.getValue());
+        }
+        else
+        {
+            matcher->SetResultFile(outArg.getValue());
+            matcher->SetOutputTransformFile(outputTransformArg.getValue());
+            matcher->SetOutputNearestRigidTransformFile(outputNRTransformArg.getValue());
+            matcher->SetOutputNearestSimilarityTransformFile(outputNSTransformArg.getValue());
 
-    if (initialTransformArg.getValue() != "")
-        matcher->SetInitialTransform(initialTransformArg.getValue());
+            matcher->SetFloatingImage(anima::readImage <InputImageType> (movingArg.getValue()));
 
-    if (directionTransformArg.getValue() != "")
-        matcher->SetDirectionTransform(directionTransformArg.getValue());
+            if (initialTransformArg.getValue() != "")
+                matcher->SetInitialTransform(initialTransformArg.getValue());
 
-    AffineTransformPointer tmpTrsf = AffineTransformType::New();
-    tmpTrsf->SetIdentity();
+            AffineTransformPointer tmpTrsf = AffineTransformType::New();
+            tmpTrsf->SetIdentity();
 
-    matcher->SetOutputTransform(tmpTrsf.GetPointer());
+            matcher->SetOutputTransform(tmpTrsf.GetPointer());
+        }
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        std::cerr << e << std::endl;
+        return EXIT_FAILURE;
+    }
 
     // Process
     itk::TimeProbe timer;
@@ -143,8 +203,13 @@ int main(int argc, const char** argv)
 
     try
     {
-        matcher->Update();
-        matcher->WriteOutputs();
+        if (groupRegistration)
+            matcher->UpdateGroup();
+        else
+        {
+            matcher->Update();
+            matcher->WriteOutputs();
+        }
     }
     catch (itk::ExceptionObject &e)
     {
@@ -5,8 +5,13 @@
 #include <itkImage.h>
 #include <itkCommand.h>
 #include <itkAffineTransform.h>
+#include <itkImageMomentsCalculator.h>
 #include <animaPyramidImageFilter.h>
 #include <animaBaseBMRegistrationMethod.h>
+#include <animaAnatomicalBlockMatcher.h>
+
+#include <memory>
+#include <mutex>
 
 namespace anima
 {
@@ -40,6 +45,13 @@ public:
     typedef typename anima::BaseBMRegistrationMethod<InputImageType> BaseBlockMatchRegistrationType;
     typedef typename BaseBlockMatchRegistrationType::Pointer BaseBlockMatchRegistrationPointer;
 
+    typedef anima::AnatomicalBlockMatcher <InputImageType> BlockMatcherType;
+    typedef typename BlockMatcherType::ImageRegionType ImageRegionType;
+    typedef typename BlockMatcherType::FixedBlockValuesPointer FixedBlockValuesPointer;
+
+    typedef itk::ImageMomentsCalculator <InputImageType> ImageMomentsCalculatorType;
+    typedef typename ImageMomentsCalculatorType::VectorType MomentsVectorType;
+
     /** SmartPointer typedef support  */
     typedef PyramidalBlockMatchingBridge Self;
     typedef itk::ProcessObject Superclass;
@@ -100,10 +112,56 @@ public:
         outAnisotropic_Sim
     };
 
+    /**
+     * Reference side data: reference pyramid, mask pyramid, reference moments and, for each level, the blocks and
+     * their fixed values. It only depends on the reference image and block parameters and may therefore be computed
+     * once and shared (read-only) by registrations of several floating images to the same reference.
+     */
+    struct ReferenceDataType
+    {
+        double ReferenceMinimalValue;
+
+        MomentsVectorType ReferenceGravityCenter;
+        MomentsVectorType ReferencePrincipalMoments;
+        double ReferenceMass;
+
+        std::vector <InputImagePointer> ReferenceLevels;
+        std::vector <MaskImagePointer> BlockGenerationLevels;
+
+        // Blocks are shared by main block matchers only, empty for kissing registration
+        std::vector < std::vector <ImageRegionType> > BlockRegions;
+        std::vector < std::vector <PointType> > BlockPositions;
+        std::vector <FixedBlockValuesPointer> FixedBlockValues;
+    };
+
+    typedef std::shared_ptr <ReferenceDataType> ReferenceDataPointer;
+
     void Update() ITK_OVERRIDE;
     void Abort();
     void WriteOutputs();
 
+    //! Computes reference side data from the reference image, block generation mask and current parameters
+    ReferenceDataPointer ComputeReferenceData();
+    void SetReferenceData(const ReferenceDataPointer &data) {m_ReferenceData = data;}
+
+    /**
+    * Group-wise registration: each added floating image is registered to the reference image by UpdateGroup.
+    * Reference data is computed once, registrations are run concurrently, the number of threads being split between them.
+    * Empty file names are not written.
+    * */
+    void AddGroupFloatingImage(std::string floatingImageFile, std::string resultFile, std::string outputTransformFile,
+                               std::string initialTransformFile = "", std::string outputNRTransformFile = "",
+                               std::string outputNSTransformFile = "");
+
+    unsigned int GetNumberOfGroupFloatingImages() {return m_GroupEntries.size();}
+
+    //! Number of registrations run at the same time in UpdateGroup (0: automatic, at least two threads per registration)
+    void SetNumberOfConcurrentRegistrations(unsigned int val) {m_NumberOfConcurrentRegistrations = val;}
+    unsigned int GetNumberOfConcurrentRegistrations() {return m_NumberOfConcurrentRegistrations;}
+
+    void UpdateGroup();
+    BaseTransformPointer GetGroupOutputTransform(unsigned int i) {return m_GroupEntries[i].OutputTransform;}
+
     /**
     * Setter for images
     * */
@@ -225,15 +283,64 @@ public:
 
     void SetBlockGenerationMask(MaskImageType *mask) {m_BlockGenerationMask = mask;}
 
+    /**
+     * Cache directory for reference side data: reference and mask pyramid levels, block layouts of each level.
+     * When set, reference data are loaded from the cache if present, computed and stored otherwise.
+     */
+    std::string GetCacheDirectory() {return m_CacheDirectory;}
+    void SetCacheDirectory(std::string const& dirName) {m_CacheDirectory = dirName;}
+
+    //! Maximum cache size in megabytes (0: no limit)
+    unsigned long GetCacheMaximumSize() {return m_CacheMaximumSize;}
+    void SetCacheMaximumSize(unsigned long val) {m_CacheMaximumSize = val;}
+
     void SetVerbose(bool value) {m_Verbose = value;}
 
 protected:
     PyramidalBlockMatchingBridge();
     virtual ~PyramidalBlockMatchingBridge();
 
+    struct GroupEntryType
+    {
+        std::string FloatingImageFile, ResultFile, OutputTransformFile;
+        std::string InitialTransformFile, OutputNRTransformFile, OutputNSTransformFile;
+        BaseTransformPointer OutputTransform;
+    };
+
+    struct ThreadedGroupData
+    {
+        Self *Bridge;
+        unsigned int NumberOfThreadsPerRegistration;
+    };
+
     void SetupPyramids();
+    void SetupReferencePyramids(PyramidPointer &referencePyramid, MaskPyramidPointer &maskPyramid);
+    void ComputeReferenceMoments(MomentsVectorType &gravityCenter, MomentsVectorType &principalMoments, double &mass);
     void EmitProgress(int prog);
 
+    //! New image sharing the pixel buffer of a shared image, pipeline information then being specific to each registration
+    template <class ImageType> static typename ImageType::Pointer ShareImageBuffer(ImageType *image)
+    {
+        typename ImageType::Pointer sharedImage = ImageType::New();
+        sharedImage->CopyInformation(image);
+        sharedImage->SetRegions(image->GetLargestPossibleRegion());
+        sharedImage->SetPixelContainer(image->GetPixelContainer());
+        return sharedImage;
+    }
+
+    //! Block layout file name in the cache, for the given level of the reference pyramids
+    std::string GetBlockLayoutCacheFileName(PyramidType *referencePyramid, MaskPyramidType *maskPyramid, unsigned int level);
+    bool ReadCachedBlockLayout(const std::string &fileName, std::vector <ImageRegionType> &regions,
+                               std::vector <PointType> &positions);
+    void WriteCachedBlockLayout(const std::string &fileName, const std::vector <ImageRegionType> &regions,
+                                const std::vector <PointType> &positions);
+
+    //! Copies registration parameters to a bridge registering one group floating image
+    void CopyParametersTo(Self *bridge);
+
+    static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreadedGroupRegistration(void *arg);
+    void ProcessGroupRegistrations(unsigned int numberOfThreadsPerRegistration);
+
     static void ManageProgress( itk::Object* caller, const itk::EventObject& event, void* clientData );
 
 private:
@@ -297,6 +404,18 @@ private:
     itk::CStyleCommand::Pointer m_callback;
 
     BaseBlockMatchRegistrationPointer m_bmreg;
+
+    ReferenceDataPointer m_ReferenceData;
+
+    std::string m_CacheDirectory;
+    unsigned long m_CacheMaximumSize;
+
+    std::vector <GroupEntryType> m_GroupEntries;
+    unsigned int m_NumberOfConcurrentRegistrations;
+
+    std::mutex m_GroupLock;
+    unsigned int m_NextGroupEntry;
+    std::vector <std::string> m_GroupErrors;
 };
 
 } // end of namespace anima
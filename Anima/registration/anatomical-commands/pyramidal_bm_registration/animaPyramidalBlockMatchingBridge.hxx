@@ -6,13 +6,18 @@
 #include <itkTransformFileWriter.h>
 #include <itkCenteredTransformInitializer.h>
 #include <itkMinimumMaximumImageFilter.h>
+#include <itkPlatformMultiThreader.h>
+
+#include <animaCacheDirectoryFunctions.h>
+#include <animaInstrumentation.h>
+#include <fstream>
+#include <iomanip>
+#include <limits>
 
 #include <animaAsymmetricBMRegistrationMethod.h>
 #include <animaSymmetricBMRegistrationMethod.h>
 #include <animaKissingSymmetricBMRegistrationMethod.h>
 
-#include <animaAnatomicalBlockMatcher.h>
-
 #include <animaLSWTransformAgregator.h>
 #include <animaLTSWTransformAgregator.h>
 #include <animaMEstTransformAgregator.h>
@@ -73,6 +78,13 @@ PyramidalBlockMatchingBridge<ImageDimension>::PyramidalBlockMatchingBridge()
     m_Abort = false;
     m_Verbose = true;
 
+    m_ReferenceData = nullptr;
+    m_NumberOfConcurrentRegistrations = 0;
+    m_NextGroupEntry = 0;
+
+    m_CacheDirectory = "";
+    m_CacheMaximumSize = 0;
+
     m_callback = itk::CStyleCommand::New();
     m_callback->SetClientData ((void *) this);
     m_callback->SetCallback (ManageProgress);
@@ -155,15 +167,28 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
 
     this->InvokeEvent(itk::StartEvent());
 
+    // Reference pyramids and block layouts are then read from (or stored in) the cache
+    if (!m_ReferenceData && (m_CacheDirectory != ""))
+        m_ReferenceData = this->ComputeReferenceData();
+
     // Compute minimal value of reference and Floating images
     using MinMaxFilterType = itk::MinimumMaximumImageFilter <InputImageType>;
-    typename MinMaxFilterType::Pointer minMaxFilter = MinMaxFilterType::New();
-    minMaxFilter->SetInput(m_ReferenceImage);
-    if (this->GetNumberOfWorkUnits() != 0)
-        minMaxFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
-    minMaxFilter->Update();
+    typename MinMaxFilterType::Pointer minMaxFilter;
+    if (m_ReferenceData)
+        m_ReferenceMinimalValue = m_ReferenceData->ReferenceMinimalValue;
+    else
+    {
+        minMaxFilter = MinMaxFilterType::New();
+        minMaxFilter->SetInput(m_ReferenceImage);
+        if (this->GetNumberOfWorkUnits() != 0)
+            minMaxFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+        minMaxFilter->Update();
 
-    m_ReferenceMinimalValue = minMaxFilter->GetMinimum();
+        // Only CT images are below zero, little hack to set minimal values to either -1024 or 0
+        m_ReferenceMinimalValue = 0.0;
+        if (minMaxFilter->GetMinimum() < 0.0)
+            m_ReferenceMinimalValue = -1024;
+    }
 
     minMaxFilter = MinMaxFilterType::New();
     minMaxFilter->SetInput(m_FloatingImage);
@@ -173,12 +198,6 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
 
     m_FloatingMinimalValue = minMaxFilter->GetMinimum();
 
-    // Only CT images are below zero, little hack to set minimal values to either -1024 or 0
-    if (m_ReferenceMinimalValue < 0.0)
-        m_ReferenceMinimalValue = -1024;
-    else
-        m_ReferenceMinimalValue = 0.0;
-
     if (m_FloatingMinimalValue < 0.0)
         m_FloatingMinimalValue = -1024;
     else
@@ -187,26 +206,41 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
     // Set up pyramids of images and masks
     this->SetupPyramids();
 
-    typedef anima::AnatomicalBlockMatcher <InputImageType> BlockMatcherType;
+    unsigned int numberOfReferenceLevels = 0;
+    if (m_ReferenceData)
+        numberOfReferenceLevels = m_ReferenceData->ReferenceLevels.size();
+    else
+        numberOfReferenceLevels = m_ReferencePyramid->GetNumberOfLevels();
 
     // Iterate over pyramid levels
     for (unsigned int i = 0;i < GetNumberOfPyramidLevels() && !m_Abort; ++i)
     {
-        if (i + GetLastPyramidLevel() >= m_ReferencePyramid->GetNumberOfLevels())
+        if (i + GetLastPyramidLevel() >= numberOfReferenceLevels)
             continue;
 
-        typename InputImageType::Pointer refImage = m_ReferencePyramid->GetOutput(i);
-        refImage->DisconnectPipeline();
-
-        typename InputImageType::Pointer floImage = m_FloatingPyramid->GetOutput(i);
-        floImage->DisconnectPipeline();
-
+        typename InputImageType::Pointer refImage;
         typename MaskImageType::Pointer maskGenerationImage = ITK_NULLPTR;
-        if (m_BlockGenerationPyramid)
+        if (m_ReferenceData)
         {
-            maskGenerationImage = m_BlockGenerationPyramid->GetOutput(i);
-            maskGenerationImage->DisconnectPipeline();
+            // Pixels are shared, images are not: they are used as inputs of this registration resamplers
+            refImage = ShareImageBuffer <InputImageType> (m_ReferenceData->ReferenceLevels[i]);
+            if (m_ReferenceData->BlockGenerationLevels.size() != 0)
+                maskGenerationImage = ShareImageBuffer <MaskImageType> (m_ReferenceData->BlockGenerationLevels[i]);
         }
+        else
+        {
+            refImage = m_ReferencePyramid->GetOutput(i);
+            refImage->DisconnectPipeline();
+
+            if (m_BlockGenerationPyramid)
+            {
+                maskGenerationImage = m_BlockGenerationPyramid->GetOutput(i);
+                maskGenerationImage->DisconnectPipeline();
+            }
+        }
+
+        typename InputImageType::Pointer floImage = m_FloatingPyramid->GetOutput(i);
+        floImage->DisconnectPipeline();
 
         BlockMatcherType *mainMatcher = new BlockMatcherType;
         BlockMatcherType *reverseMatcher = 0;
@@ -217,6 +251,14 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
         mainMatcher->SetBlockGenerationMask(maskGenerationImage);
         mainMatcher->SetDefaultBackgroundValue(m_FloatingMinimalValue);
 
+        // Kissing registration blocks are generated on the moving halfway reference, they cannot be shared
+        if (m_ReferenceData && (m_SymmetryType != Kissing) && (i < m_ReferenceData->FixedBlockValues.size()) &&
+                m_ReferenceData->FixedBlockValues[i])
+        {
+            mainMatcher->SetBlockLayout(m_ReferenceData->BlockRegions[i], m_ReferenceData->BlockPositions[i]);
+            mainMatcher->SetFixedBlockValues(m_ReferenceData->FixedBlockValues[i]);
+        }
+
         if (m_Verbose)
         {
             std::cout << "Processing pyramid level " << i << std::endl;
@@ -260,6 +302,17 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
                 tmpReg->SetReferenceBackgroundValue(m_ReferenceMinimalValue);
                 tmpReg->SetFloatingBackgroundValue(m_FloatingMinimalValue);
 
+                // Reverse matcher: both directions are matched in a single threaded pass
+                reverseMatcher = new BlockMatcherType;
+                reverseMatcher->SetBlockPercentageKept(GetPercentageKept());
+                reverseMatcher->SetBlockSize(GetBlockSize());
+                reverseMatcher->SetBlockSpacing(GetBlockSpacing());
+                reverseMatcher->SetBlockVarianceThreshold(GetStDevThreshold() * GetStDevThreshold());
+                reverseMatcher->SetVerbose(m_Verbose);
+                reverseMatcher->SetBlockGenerationMask(maskGenerationImage);
+                reverseMatcher->SetDefaultBackgroundValue(m_ReferenceMinimalValue);
+
+                tmpReg->SetReverseBlockMatcher(reverseMatcher);
                 m_bmreg = tmpReg;
                 break;
             }
@@ -481,8 +534,14 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
         }
         catch( itk::ExceptionObject & err )
         {
-            std::cerr << "ExceptionObject caught in bmreg startregistration ! " << err << std::endl;
-            exit(-1);
+            // Thrown rather than exiting: in group registration, other registrations go on
+            delete mainMatcher;
+            if (reverseMatcher)
+                delete reverseMatcher;
+            if (agreg)
+                delete agreg;
+
+            itkExceptionMacro("Block matching registration failed: " << err.GetDescription());
         }
 
         if ((GetOutputTransformType() == outAnisotropic_Sim)||(GetOutputTransformType() == outAffine))
@@ -535,6 +594,382 @@ void PyramidalBlockMatchingBridge<ImageDimension>::Update()
     m_OutputImage->DisconnectPipeline();
 }
 
+template <unsigned int ImageDimension>
+typename PyramidalBlockMatchingBridge<ImageDimension>::ReferenceDataPointer
+PyramidalBlockMatchingBridge<ImageDimension>::ComputeReferenceData()
+{
+    if (!m_ReferenceImage)
+        itkExceptionMacro("Reference image has to be set to compute reference data");
+
+    ReferenceDataPointer referenceData(new ReferenceDataType);
+
+    using MinMaxFilterType = itk::MinimumMaximumImageFilter <InputImageType>;
+    typename MinMaxFilterType::Pointer minMaxFilter = MinMaxFilterType::New();
+    minMaxFilter->SetInput(m_ReferenceImage);
+    if (this->GetNumberOfWorkUnits() != 0)
+        minMaxFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    minMaxFilter->Update();
+
+    // Same CT hack as in Update
+    m_ReferenceMinimalValue = 0.0;
+    if (minMaxFilter->GetMinimum() < 0.0)
+        m_ReferenceMinimalValue = -1024;
+
+    referenceData->ReferenceMinimalValue = m_ReferenceMinimalValue;
+
+    // Computed here, m_ReferenceData is not set yet
+    m_ReferenceData = nullptr;
+    this->ComputeReferenceMoments(referenceData->ReferenceGravityCenter, referenceData->ReferencePrincipalMoments,
+                                  referenceData->ReferenceMass);
+
+    PyramidPointer referencePyramid;
+    MaskPyramidPointer maskPyramid;
+    this->SetupReferencePyramids(referencePyramid, maskPyramid);
+
+    unsigned int numberOfLevels = referencePyramid->GetNumberOfLevels();
+    referenceData->ReferenceLevels.resize(numberOfLevels);
+    if (maskPyramid)
+        referenceData->BlockGenerationLevels.resize(numberOfLevels);
+
+    for (unsigned int i = 0;i < numberOfLevels;++i)
+    {
+        referenceData->ReferenceLevels[i] = referencePyramid->GetOutput(i);
+        referenceData->ReferenceLevels[i]->DisconnectPipeline();
+
+        if (maskPyramid)
+        {
+            referenceData->BlockGenerationLevels[i] = maskPyramid->GetOutput(i);
+            referenceData->BlockGenerationLevels[i]->DisconnectPipeline();
+        }
+    }
+
+    if (m_SymmetryType == Kissing)
+        return referenceData;
+
+    // Blocks and fixed block values of main block matchers, on the levels explored by Update
+    referenceData->BlockRegions.resize(numberOfLevels);
+    referenceData->BlockPositions.resize(numberOfLevels);
+    referenceData->FixedBlockValues.resize(numberOfLevels);
+    for (unsigned int i = 0;i < GetNumberOfPyramidLevels();++i)
+    {
+        if (i + GetLastPyramidLevel() >= numberOfLevels)
+            continue;
+
+        BlockMatcherType blockMatcher;
+        blockMatcher.SetBlockPercentageKept(GetPercentageKept());
+        blockMatcher.SetBlockSize(GetBlockSize());
+        blockMatcher.SetBlockSpacing(GetBlockSpacing());
+        blockMatcher.SetBlockVarianceThreshold(GetStDevThreshold() * GetStDevThreshold());
+        blockMatcher.SetVerbose(m_Verbose);
+        blockMatcher.SetNumberOfWorkUnits(GetNumberOfWorkUnits());
+        blockMatcher.SetReferenceImage(referenceData->ReferenceLevels[i]);
+        if (maskPyramid)
+            blockMatcher.SetBlockGenerationMask(referenceData->BlockGenerationLevels[i]);
+
+        // Block selection from the cache, fixed block values are computed on the given blocks
+        std::string layoutFileName = this->GetBlockLayoutCacheFileName(referencePyramid, maskPyramid, i);
+        bool cachedLayout = false;
+        if (layoutFileName != "")
+        {
+            std::vector <ImageRegionType> blockRegions;
+            std::vector <PointType> blockPositions;
+            cachedLayout = this->ReadCachedBlockLayout(layoutFileName, blockRegions, blockPositions);
+            if (cachedLayout)
+                blockMatcher.SetBlockLayout(blockRegions, blockPositions);
+        }
+
+        blockMatcher.InitializeBlocks();
+        blockMatcher.ComputeFixedBlockValues();
+
+        if ((layoutFileName != "") && (!cachedLayout))
+            this->WriteCachedBlockLayout(layoutFileName, blockMatcher.GetBlockRegions(), blockMatcher.GetBlockPositions());
+
+        referenceData->BlockRegions[i] = blockMatcher.GetBlockRegions();
+        referenceData->BlockPositions[i] = blockMatcher.GetBlockPositions();
+        referenceData->FixedBlockValues[i] = blockMatcher.GetFixedBlockValues();
+    }
+
+    anima::pruneCacheDirectory(m_CacheDirectory, m_CacheMaximumSize);
+
+    return referenceData;
+}
+
+template <unsigned int ImageDimension>
+std::string PyramidalBlockMatchingBridge<ImageDimension>::GetBlockLayoutCacheFileName(PyramidType *referencePyramid,
+                                                                                      MaskPyramidType *maskPyramid,
+                                                                                      unsigned int level)
+{
+    if (referencePyramid->GetCacheKey() == "")
+        return "";
+
+    uint64_t hashValue = anima::initialCacheHash();
+    anima::hashCacheString(hashValue, referencePyramid->GetCacheKey());
+    if (maskPyramid)
+        anima::hashCacheString(hashValue, maskPyramid->GetCacheKey());
+
+    double varianceThreshold = m_StDevThreshold * m_StDevThreshold;
+    anima::hashCacheBytes(hashValue, &level, sizeof(unsigned int));
+    anima::hashCacheBytes(hashValue, &m_BlockSize, sizeof(unsigned int));
+    anima::hashCacheBytes(hashValue, &m_BlockSpacing, sizeof(unsigned int));
+    anima::hashCacheBytes(hashValue, &varianceThreshold, sizeof(double));
+    anima::hashCacheBytes(hashValue, &m_PercentageKept, sizeof(double));
+
+    return m_CacheDirectory + "/animaBlockLayout_" + anima::cacheKeyToString(hashValue) + ".txt";
+}
+
+template <unsigned int ImageDimension>
+bool PyramidalBlockMatchingBridge<ImageDimension>::ReadCachedBlockLayout(const std::string &fileName,
+                                                                        std::vector <ImageRegionType> &regions,
+                                                                        std::vector <PointType> &positions)
+{
+    std::ifstream layoutFile(fileName.c_str());
+    if (!layoutFile.is_open())
+        return false;
+
+    // One block per line: region index, region size, block position
+    unsigned int numBlocks = 0;
+    layoutFile >> numBlocks;
+    regions.resize(numBlocks);
+    positions.resize(numBlocks);
+
+    for (unsigned int i = 0;i < numBlocks;++i)
+    {
+        for (unsigned int j = 0;j < ImageDimension;++j)
+            layoutFile >> regions[i].GetModifiableIndex()[j];
+
+        for (unsigned int j = 0;j < ImageDimension;++j)
+            layoutFile >> regions[i].GetModifiableSize()[j];
+
+        for (unsigned int j = 0;j < ImageDimension;++j)
+            layoutFile >> positions[i][j];
+    }
+
+    if (layoutFile.fail())
+    {
+        layoutFile.close();
+        itksys::SystemTools::RemoveFile(fileName);
+        return false;
+    }
+
+    anima::touchCacheFile(fileName);
+    if (m_Verbose)
+        std::cout << "Loaded " << numBlocks << " blocks from cache..." << std::endl;
+
+    return true;
+}
+
+template <unsigned int ImageDimension>
+void PyramidalBlockMatchingBridge<ImageDimension>::WriteCachedBlockLayout(const std::string &fileName,
+                                                                         const std::vector <ImageRegionType> &regions,
+                                                                         const std::vector <PointType> &positions)
+{
+    std::string tmpFileName = anima::temporaryCacheFileName(m_CacheDirectory, ".txt");
+    std::ofstream layoutFile(tmpFileName.c_str());
+    if (!layoutFile.is_open())
+        return;
+
+    layoutFile.precision(std::numeric_limits <double>::max_digits10);
+    layoutFile << regions.size() << std::endl;
+    for (unsigned int i = 0;i < regions.size();++i)
+    {
+        for (unsigned int j = 0;j < ImageDimension;++j)
+            layoutFile << regions[i].GetIndex()[j] << " ";
+
+        for (unsigned int j = 0;j < ImageDimension;++j)
+            layoutFile << regions[i].GetSize()[j] << " ";
+
+        for (unsigned int j = 0;j < ImageDimension;++j)
+            layoutFile << positions[i][j] << " ";
+
+        layoutFile << std::endl;
+    }
+
+    layoutFile.close();
+    anima::commitCacheFile(tmpFileName, fileName);
+}
+
+template <unsigned int ImageDimension>
+void PyramidalBlockMatchingBridge<ImageDimension>::AddGroupFloatingImage(std::string floatingImageFile, std::string resultFile,
+                                                                        std::string outputTransformFile,
+                                                                        std::string initialTransformFile,
+                                                                        std::string outputNRTransformFile,
+                                                                        std::string outputNSTransformFile)
+{
+    GroupEntryType entry;
+    entry.FloatingImageFile = floatingImageFile;
+    entry.ResultFile = resultFile;
+    entry.OutputTransformFile = outputTransformFile;
+    entry.InitialTransformFile = initialTransformFile;
+    entry.OutputNRTransformFile = outputNRTransformFile;
+    entry.OutputNSTransformFile = outputNSTransformFile;
+    entry.OutputTransform = nullptr;
+
+    m_GroupEntries.push_back(entry);
+}
+
+template <unsigned int ImageDimension>
+void PyramidalBlockMatchingBridge<ImageDimension>::CopyParametersTo(Self *bridge)
+{
+    bridge->m_BlockSize = m_BlockSize;
+    bridge->m_BlockSpacing = m_BlockSpacing;
+    bridge->m_StDevThreshold = m_StDevThreshold;
+    bridge->m_SymmetryType = m_SymmetryType;
+    bridge->m_Transform = m_Transform;
+    bridge->m_AffineDirection = m_AffineDirection;
+    bridge->m_Metric = m_Metric;
+    bridge->m_Optimizer = m_Optimizer;
+    bridge->m_MaximumIterations = m_MaximumIterations;
+    bridge->m_MinimalTransformError = m_MinimalTransformError;
+    bridge->m_OptimizerMaximumIterations = m_OptimizerMaximumIterations;
+    bridge->m_SearchRadius = m_SearchRadius;
+    bridge->m_SearchAngleRadius = m_SearchAngleRadius;
+    bridge->m_SearchScaleRadius = m_SearchScaleRadius;
+    bridge->m_FinalRadius = m_FinalRadius;
+    bridge->m_StepSize = m_StepSize;
+    bridge->m_TranslateUpperBound = m_TranslateUpperBound;
+    bridge->m_AngleUpperBound = m_AngleUpperBound;
+    bridge->m_ScaleUpperBound = m_ScaleUpperBound;
+    bridge->m_Agregator = m_Agregator;
+    bridge->m_OutputTransformType = m_OutputTransformType;
+    bridge->m_AgregThreshold = m_AgregThreshold;
+    bridge->m_SeStoppingThreshold = m_SeStoppingThreshold;
+    bridge->m_NumberOfPyramidLevels = m_NumberOfPyramidLevels;
+    bridge->m_LastPyramidLevel = m_LastPyramidLevel;
+    bridge->m_PercentageKept = m_PercentageKept;
+    bridge->m_TransformInitializationType = m_TransformInitializationType;
+    bridge->m_DirectionTransform = m_DirectionTransform;
+
+    bridge->m_ReferenceImage = m_ReferenceImage;
+    bridge->m_BlockGenerationMask = m_BlockGenerationMask;
+    bridge->m_ReferenceData = m_ReferenceData;
+    bridge->m_CacheDirectory = m_CacheDirectory;
+    bridge->m_CacheMaximumSize = m_CacheMaximumSize;
+}
+
+template <unsigned int ImageDimension>
+void PyramidalBlockMatchingBridge<ImageDimension>::UpdateGroup()
+{
+    if (m_GroupEntries.size() == 0)
+        itkExceptionMacro("No floating image to register to the reference");
+
+    m_ReferenceData = this->ComputeReferenceData();
+
+    unsigned int numberOfThreads = this->GetNumberOfWorkUnits();
+    if (numberOfThreads == 0)
+        numberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+
+    unsigned int numberOfRegistrations = m_NumberOfConcurrentRegistrations;
+    if (numberOfRegistrations == 0)
+        numberOfRegistrations = std::max(1U, numberOfThreads / 2);
+
+    numberOfRegistrations = std::min(numberOfRegistrations, (unsigned int)m_GroupEntries.size());
+    numberOfRegistrations = std::min(numberOfRegistrations, numberOfThreads);
+    unsigned int numberOfThreadsPerRegistration = std::max(1U, numberOfThreads / numberOfRegistrations);
+
+    if (m_Verbose)
+        std::cout << "Registering " << m_GroupEntries.size() << " images, " << numberOfRegistrations
+                  << " at a time with " << numberOfThreadsPerRegistration << " threads each" << std::endl;
+
+    m_NextGroupEntry = 0;
+    m_GroupErrors.clear();
+
+    if (numberOfRegistrations == 1)
+        this->ProcessGroupRegistrations(numberOfThreadsPerRegistration);
+    else
+    {
+        // Platform threads: registrations run their own pool threaded filters, pool threads would be exhausted
+        itk::PlatformMultiThreader::Pointer threadWorker = itk::PlatformMultiThreader::New();
+        ThreadedGroupData *tmpStr = new ThreadedGroupData;
+        tmpStr->Bridge = this;
+        tmpStr->NumberOfThreadsPerRegistration = numberOfThreadsPerRegistration;
+
+        threadWorker->SetNumberOfWorkUnits(numberOfRegistrations);
+        threadWorker->SetSingleMethod(this->ThreadedGroupRegistration,tmpStr);
+        threadWorker->SingleMethodExecute();
+
+        delete tmpStr;
+    }
+
+    // Registrations share the instrumentation thread data, merged only once all of them are done
+    ANIMA_INSTRUMENT_MERGE();
+
+    if (m_GroupErrors.size() != 0)
+    {
+        std::string errorString = "Group registration failed for:";
+        for (unsigned int i = 0;i < m_GroupErrors.size();++i)
+            errorString += " " + m_GroupErrors[i];
+
+        itkExceptionMacro(<< errorString);
+    }
+}
+
+template <unsigned int ImageDimension>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+PyramidalBlockMatchingBridge<ImageDimension>::ThreadedGroupRegistration(void *arg)
+{
+    itk::MultiThreaderBase::WorkUnitInfo *threadArgs = (itk::MultiThreaderBase::WorkUnitInfo *)arg;
+    ThreadedGroupData *data = (ThreadedGroupData *)threadArgs->UserData;
+
+    data->Bridge->ProcessGroupRegistrations(data->NumberOfThreadsPerRegistration);
+    return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <unsigned int ImageDimension>
+void PyramidalBlockMatchingBridge<ImageDimension>::ProcessGroupRegistrations(unsigned int numberOfThreadsPerRegistration)
+{
+    while (true)
+    {
+        m_GroupLock.lock();
+        if (m_NextGroupEntry >= m_GroupEntries.size() || m_Abort)
+        {
+            m_GroupLock.unlock();
+            break;
+        }
+
+        GroupEntryType &entry = m_GroupEntries[m_NextGroupEntry];
+        ++m_NextGroupEntry;
+        m_GroupLock.unlock();
+
+        try
+        {
+            Pointer bridge = Self::New();
+            this->CopyParametersTo(bridge);
+            bridge->SetNumberOfWorkUnits(numberOfThreadsPerRegistration);
+            bridge->SetVerbose(false);
+
+            bridge->SetFloatingImage(anima::readImage <InputImageType> (entry.FloatingImageFile));
+            if (entry.InitialTransformFile != "")
+                bridge->SetInitialTransform(entry.InitialTransformFile);
+
+            AffineTransformPointer tmpTrsf = AffineTransformType::New();
+            tmpTrsf->SetIdentity();
+            bridge->SetOutputTransform(tmpTrsf.GetPointer());
+
+            bridge->SetResultFile(entry.ResultFile);
+            bridge->SetOutputTransformFile(entry.OutputTransformFile);
+            bridge->SetOutputNearestRigidTransformFile(entry.OutputNRTransformFile);
+            bridge->SetOutputNearestSimilarityTransformFile(entry.OutputNSTransformFile);
+
+            bridge->Update();
+            bridge->WriteOutputs();
+
+            entry.OutputTransform = bridge->GetOutputTransform();
+
+            if (m_Verbose)
+            {
+                std::lock_guard <std::mutex> lock(m_GroupLock);
+                std::cout << "Registered " << entry.FloatingImageFile << std::endl;
+            }
+        }
+        catch (itk::ExceptionObject &e)
+        {
+            std::lock_guard <std::mutex> lock(m_GroupLock);
+            std::cerr << "Registration of " << entry.FloatingImageFile << " failed: " << e.GetDescription() << std::endl;
+            m_GroupErrors.push_back(entry.FloatingImageFile);
+        }
+    }
+}
+
 template <unsigned int ImageDimension>
 void PyramidalBlockMatchingBridge<ImageDimension>::EmitProgress(int prog)
 {
@@ -555,8 +990,11 @@ void PyramidalBlockMatchingBridge<ImageDimension>::ManageProgress (itk::Object*
 template <unsigned int ImageDimension>
 void PyramidalBlockMatchingBridge<ImageDimension>::WriteOutputs()
 {
-    std::cout << "Writing output image to: " << GetResultFile() << std::endl;
-    anima::writeImage <InputImageType> (GetResultFile(),m_OutputImage);
+    if (GetResultFile() != "")
+    {
+        std::cout << "Writing output image to: " << GetResultFile() << std::endl;
+        anima::writeImage <InputImageType> (GetResultFile(),m_OutputImage);
+    }
 
     if (GetOutputTransformFile() != "")
     {
@@ -648,16 +1086,10 @@ void PyramidalBlockMatchingBridge<ImageDimension>::SetupPyramids()
     typedef anima::ResampleImageFilter<InputImageType, InputImageType,
             typename AgregatorType::ScalarType> ResampleFilterType;
 
-    m_ReferencePyramid = PyramidType::New();
-
-    m_ReferencePyramid->SetInput(m_ReferenceImage);
-    m_ReferencePyramid->SetNumberOfLevels(GetNumberOfPyramidLevels());
-    m_ReferencePyramid->SetNumberOfWorkUnits(GetNumberOfWorkUnits());
-
-    typename ResampleFilterType::Pointer refResampler = ResampleFilterType::New();
-    refResampler->SetDefaultPixelValue(m_ReferenceMinimalValue);
-    m_ReferencePyramid->SetImageResampler(refResampler);
-    m_ReferencePyramid->Update();
+    m_ReferencePyramid = 0;
+    m_BlockGenerationPyramid = 0;
+    if (!m_ReferenceData)
+        this->SetupReferencePyramids(m_ReferencePyramid, m_BlockGenerationPyramid);
 
     InputImagePointer initialFloatingImage = const_cast <InputImageType *> (m_FloatingImage.GetPointer());
 
@@ -685,29 +1117,23 @@ void PyramidalBlockMatchingBridge<ImageDimension>::SetupPyramids()
         m_InitialTransform = AffineTransformType::New();
         m_InitialTransform->SetIdentity();
 
-        typedef itk::ImageMomentsCalculator <InputImageType> ImageCalculatorType;
-
         if (m_TransformInitializationType != Identity)
         {
-            typename ImageCalculatorType::Pointer fixedCalculator = ImageCalculatorType::New();
-            fixedCalculator->SetImage(m_ReferenceImage);
-            fixedCalculator->Compute();
-            typename ImageCalculatorType::VectorType fixedBar = fixedCalculator->GetCenterOfGravity();
+            MomentsVectorType fixedBar, fixedPrincipalMom;
+            double fixedMass;
+            this->ComputeReferenceMoments(fixedBar, fixedPrincipalMom, fixedMass);
 
-            typename ImageCalculatorType::Pointer movingCalculator = ImageCalculatorType::New();
+            typename ImageMomentsCalculatorType::Pointer movingCalculator = ImageMomentsCalculatorType::New();
             movingCalculator->SetImage(m_FloatingImage);
             movingCalculator->Compute();
-            typename ImageCalculatorType::VectorType movingBar = movingCalculator->GetCenterOfGravity();
+            typename ImageMomentsCalculatorType::VectorType movingBar = movingCalculator->GetCenterOfGravity();
 
             m_InitialTransform->SetOffset(movingBar - fixedBar);
 
             if ((m_TransformInitializationType == ClosestTransform)&&(m_OutputTransformType != outTranslation))
             {
-                typename ImageCalculatorType::VectorType fixedPrincipalMom = fixedCalculator->GetPrincipalMoments();
-                typename ImageCalculatorType::ScalarType fixedMass = fixedCalculator->GetTotalMass();
-
-                typename ImageCalculatorType::VectorType movingPrincipalMom = movingCalculator->GetPrincipalMoments();
-                typename ImageCalculatorType::ScalarType movingMass = movingCalculator->GetTotalMass();
+                typename ImageMomentsCalculatorType::VectorType movingPrincipalMom = movingCalculator->GetPrincipalMoments();
+                typename ImageMomentsCalculatorType::ScalarType movingMass = movingCalculator->GetTotalMass();
 
                 vnl_matrix<double> scalMatrix(ImageDimension, ImageDimension, 0);
                 itk::Vector<double, ImageDimension> scalOffset;
@@ -759,15 +1185,14 @@ void PyramidalBlockMatchingBridge<ImageDimension>::SetupPyramids()
             std::cout << "Identity initialization outputs an empty image, initializing with centers of mass" << std::endl;
             m_TransformInitializationType = GravityCenters;
 
-            typename ImageCalculatorType::Pointer fixedCalculator = ImageCalculatorType::New();
-            fixedCalculator->SetImage(m_ReferenceImage);
-            fixedCalculator->Compute();
-            typename ImageCalculatorType::VectorType fixedBar = fixedCalculator->GetCenterOfGravity();
+            MomentsVectorType fixedBar, fixedPrincipalMom;
+            double fixedMass;
+            this->ComputeReferenceMoments(fixedBar, fixedPrincipalMom, fixedMass);
 
-            typename ImageCalculatorType::Pointer movingCalculator = ImageCalculatorType::New();
+            typename ImageMomentsCalculatorType::Pointer movingCalculator = ImageMomentsCalculatorType::New();
             movingCalculator->SetImage(m_FloatingImage);
             movingCalculator->Compute();
-            typename ImageCalculatorType::VectorType movingBar = movingCalculator->GetCenterOfGravity();
+            typename ImageMomentsCalculatorType::VectorType movingBar = movingCalculator->GetCenterOfGravity();
 
             m_InitialTransform->SetOffset(movingBar - fixedBar);
 
@@ -799,8 +1224,34 @@ void PyramidalBlockMatchingBridge<ImageDimension>::SetupPyramids()
     m_FloatingPyramid->SetImageResampler(floResampler);
 
     m_FloatingPyramid->Update();
+}
 
-    m_BlockGenerationPyramid = 0;
+template <unsigned int ImageDimension>
+void PyramidalBlockMatchingBridge<ImageDimension>::SetupReferencePyramids(PyramidPointer &referencePyramid,
+                                                                         MaskPyramidPointer &maskPyramid)
+{
+    typedef anima::ResampleImageFilter<InputImageType, InputImageType,
+            typename AgregatorType::ScalarType> ResampleFilterType;
+
+    referencePyramid = PyramidType::New();
+
+    referencePyramid->SetInput(m_ReferenceImage);
+    referencePyramid->SetNumberOfLevels(GetNumberOfPyramidLevels());
+    referencePyramid->SetNumberOfWorkUnits(GetNumberOfWorkUnits());
+
+    typename ResampleFilterType::Pointer refResampler = ResampleFilterType::New();
+    refResampler->SetDefaultPixelValue(m_ReferenceMinimalValue);
+    referencePyramid->SetImageResampler(refResampler);
+
+    // Full double precision: default values differing beyond six digits give different pyramids
+    std::ostringstream cacheTag;
+    cacheTag << "default " << std::setprecision(std::numeric_limits <double>::max_digits10) << m_ReferenceMinimalValue;
+    referencePyramid->SetCacheDirectory(m_CacheDirectory);
+    referencePyramid->SetCacheMaximumSize(m_CacheMaximumSize);
+    referencePyramid->SetCacheTag(cacheTag.str());
+    referencePyramid->Update();
+
+    maskPyramid = 0;
     if (m_BlockGenerationMask)
     {
         typedef anima::ResampleImageFilter<MaskImageType, MaskImageType,
@@ -808,13 +1259,37 @@ void PyramidalBlockMatchingBridge<ImageDimension>::SetupPyramids()
 
         typename MaskResampleFilterType::Pointer maskResampler = MaskResampleFilterType::New();
 
-        m_BlockGenerationPyramid = MaskPyramidType::New();
-        m_BlockGenerationPyramid->SetImageResampler(maskResampler);
-        m_BlockGenerationPyramid->SetInput(m_BlockGenerationMask);
-        m_BlockGenerationPyramid->SetNumberOfLevels(GetNumberOfPyramidLevels());
-        m_BlockGenerationPyramid->SetNumberOfWorkUnits(GetNumberOfWorkUnits());
-        m_BlockGenerationPyramid->Update();
+        maskPyramid = MaskPyramidType::New();
+        maskPyramid->SetImageResampler(maskResampler);
+        maskPyramid->SetInput(m_BlockGenerationMask);
+        maskPyramid->SetNumberOfLevels(GetNumberOfPyramidLevels());
+        maskPyramid->SetNumberOfWorkUnits(GetNumberOfWorkUnits());
+        maskPyramid->SetCacheDirectory(m_CacheDirectory);
+        maskPyramid->SetCacheMaximumSize(m_CacheMaximumSize);
+        maskPyramid->Update();
     }
 }
 
+template <unsigned int ImageDimension>
+void PyramidalBlockMatchingBridge<ImageDimension>::ComputeReferenceMoments(MomentsVectorType &gravityCenter,
+                                                                          MomentsVectorType &principalMoments,
+                                                                          double &mass)
+{
+    if (m_ReferenceData)
+    {
+        gravityCenter = m_ReferenceData->ReferenceGravityCenter;
+        principalMoments = m_ReferenceData->ReferencePrincipalMoments;
+        mass = m_ReferenceData->ReferenceMass;
+        return;
+    }
+
+    typename ImageMomentsCalculatorType::Pointer fixedCalculator = ImageMomentsCalculatorType::New();
+    fixedCalculator->SetImage(m_ReferenceImage);
+    fixedCalculator->Compute();
+
+    gravityCenter = fixedCalculator->GetCenterOfGravity();
+    principalMoments = fixedCalculator->GetPrincipalMoments();
+    mass = fixedCalculator->GetTotalMass();
+}
+
 } // end of namespace anima
@@ -12,6 +12,9 @@ namespace anima
  * Computes a pyramid of images, taking into account voxel anisotropy when dividing dimensions.
  * Requires an external image resampler provided by the user to resample images
  *
+ * If a cache directory is set, levels are stored there under a key hashing input pixels and geometry, number of levels,
+ * resampler type and cache tag. Later runs on the same input load them instead of resampling.
+ *
  */
 template <class TInputImage, class TOutputImage>
 class PyramidImageFilter :
@@ -57,6 +60,20 @@ public:
 
     itkSetObjectMacro(ImageResampler, BaseResamplerType)
 
+    //! Directory where levels are cached (no cache if empty)
+    void SetCacheDirectory(std::string const& dirName) {m_CacheDirectory = dirName;}
+    std::string GetCacheDirectory() {return m_CacheDirectory;}
+
+    //! Maximum cache directory size in megabytes, least recently used entries are removed first (0: no limit)
+    itkSetMacro(CacheMaximumSize, unsigned long)
+    itkGetConstMacro(CacheMaximumSize, unsigned long)
+
+    //! Resampler parameters not described by its type (e.g. default pixel value), added to the cache key
+    void SetCacheTag(std::string const& tag) {m_CacheTag = tag;}
+
+    //! Cache key of the last generated pyramid, empty if no cache directory is set
+    std::string GetCacheKey() {return m_CacheKey;}
+
 protected:
     PyramidImageFilter();
     virtual ~PyramidImageFilter() {}
@@ -69,6 +86,15 @@ protected:
     void CreateLevelVectorImage(unsigned int level);
     void CreateLevelImage(unsigned int level);
 
+    std::string ComputeCacheKey();
+    std::string GetLevelCacheFileName(unsigned int level);
+
+    //! Loads all levels from the cache, false if one is missing or unreadable
+    bool ReadCachedLevels(bool vectorImages);
+    template <class TCachedImageType> void ReadCachedLevel(unsigned int level);
+    void WriteCachedLevels(bool vectorImages);
+    template <class TCachedImageType> void WriteCachedLevel(unsigned int level);
+
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(PyramidImageFilter);
 
@@ -80,6 +106,9 @@ private:
     // Internal variables to compute images
     std::vector <RegionType> m_LevelRegions;
     std::vector <SpacingType> m_LevelSpacings;
+
+    std::string m_CacheDirectory, m_CacheTag, m_CacheKey;
+    unsigned long m_CacheMaximumSize;
 };
 
 } //end of namespace anima
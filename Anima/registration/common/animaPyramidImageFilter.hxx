@@ -1,8 +1,12 @@
 #pragma once
 
 #include "animaPyramidImageFilter.h"
+#include <itkImageFileReader.h>
 #include <itkImageFileWriter.h>
 
+#include <animaCacheDirectoryFunctions.h>
+#include <typeinfo>
+
 #include <animaResampleImageFilter.h>
 #include <animaOrientedModelBaseResampleImageFilter.h>
 
@@ -17,6 +21,7 @@ PyramidImageFilter()
 {
     m_NumberOfLevels = 1;
     m_ImageResampler = 0;
+    m_CacheMaximumSize = 0;
 }
 
 template <class TInputImage, class TOutputImage>
@@ -195,6 +200,16 @@ GenerateData()
 
     bool vectorInputImages = (dynamic_cast<VectorInputImageType *> (this->GetOutput(0)) != NULL);
 
+    m_CacheKey = "";
+    if (m_CacheDirectory != "")
+    {
+        itksys::SystemTools::MakeDirectory(m_CacheDirectory);
+        m_CacheKey = this->ComputeCacheKey();
+
+        if (this->ReadCachedLevels(vectorInputImages))
+            return;
+    }
+
     for (unsigned int i = m_NumberOfLevels;i > 0;--i)
     {
         if (vectorInputImages)
@@ -202,6 +217,182 @@ GenerateData()
         else
             this->CreateLevelImage(i-1);
     }
+
+    if (m_CacheKey != "")
+    {
+        this->WriteCachedLevels(vectorInputImages);
+        anima::pruneCacheDirectory(m_CacheDirectory,m_CacheMaximumSize);
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+std::string
+PyramidImageFilter<TInputImage,TOutputImage>::
+ComputeCacheKey()
+{
+    const InputImageType *input = this->GetInput();
+
+    uint64_t hashValue = anima::initialCacheHash();
+
+    // Pixels in the buffered region, read once: cheaper than resampling them
+    std::size_t bufferSize = input->GetBufferedRegion().GetNumberOfPixels() * input->GetNumberOfComponentsPerPixel();
+    anima::hashCacheBytes(hashValue, input->GetBufferPointer(), bufferSize * sizeof(InputInternalScalarType));
+
+    unsigned int numComponents = input->GetNumberOfComponentsPerPixel();
+    anima::hashCacheBytes(hashValue, &numComponents, sizeof(unsigned int));
+    anima::hashCacheBytes(hashValue, &m_NumberOfLevels, sizeof(unsigned int));
+
+    for (unsigned int i = 0;i < InputImageType::ImageDimension;++i)
+    {
+        double origin = input->GetOrigin()[i];
+        double spacing = input->GetSpacing()[i];
+        long index = input->GetLargestPossibleRegion().GetIndex()[i];
+        unsigned long size = input->GetLargestPossibleRegion().GetSize()[i];
+
+        anima::hashCacheBytes(hashValue, &origin, sizeof(double));
+        anima::hashCacheBytes(hashValue, &spacing, sizeof(double));
+        anima::hashCacheBytes(hashValue, &index, sizeof(long));
+        anima::hashCacheBytes(hashValue, &size, sizeof(unsigned long));
+
+        for (unsigned int j = 0;j < InputImageType::ImageDimension;++j)
+        {
+            double directionValue = input->GetDirection()(i,j);
+            anima::hashCacheBytes(hashValue, &directionValue, sizeof(double));
+        }
+    }
+
+    // Type names include template parameters: interpolation, precision and image types
+    anima::hashCacheString(hashValue, typeid(*m_ImageResampler.GetPointer()).name());
+    anima::hashCacheString(hashValue, typeid(*input).name());
+    anima::hashCacheString(hashValue, m_CacheTag);
+
+    return anima::cacheKeyToString(hashValue);
+}
+
+template <class TInputImage, class TOutputImage>
+std::string
+PyramidImageFilter<TInputImage,TOutputImage>::
+GetLevelCacheFileName(unsigned int level)
+{
+    std::ostringstream fileName;
+    fileName << m_CacheDirectory << "/animaPyramid_" << m_CacheKey << "_" << level << ".nrrd";
+
+    return fileName.str();
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+PyramidImageFilter<TInputImage,TOutputImage>::
+ReadCachedLevels(bool vectorImages)
+{
+    for (unsigned int i = 0;i < m_NumberOfLevels;++i)
+    {
+        if (!itksys::SystemTools::FileExists(this->GetLevelCacheFileName(i),true))
+            return false;
+    }
+
+    try
+    {
+        for (unsigned int i = 0;i < m_NumberOfLevels;++i)
+        {
+            if (vectorImages)
+                this->ReadCachedLevel <VectorOutputImageType> (i);
+            else
+                this->ReadCachedLevel <ScalarOutputImageType> (i);
+
+            anima::touchCacheFile(this->GetLevelCacheFileName(i));
+        }
+    }
+    catch (itk::ExceptionObject &)
+    {
+        // Unreadable entry: dropped and recomputed
+        for (unsigned int i = 0;i < m_NumberOfLevels;++i)
+            itksys::SystemTools::RemoveFile(this->GetLevelCacheFileName(i));
+
+        return false;
+    }
+
+    return true;
+}
+
+template <class TInputImage, class TOutputImage>
+template <class TCachedImageType>
+void
+PyramidImageFilter<TInputImage,TOutputImage>::
+ReadCachedLevel(unsigned int level)
+{
+    typedef itk::ImageFileReader <TCachedImageType> ReaderType;
+    typename ReaderType::Pointer levelReader = ReaderType::New();
+    levelReader->SetFileName(this->GetLevelCacheFileName(level));
+    levelReader->Update();
+
+    typename TCachedImageType::Pointer cachedImage = levelReader->GetOutput();
+    cachedImage->DisconnectPipeline();
+
+    if ((cachedImage->GetLargestPossibleRegion().GetSize() != m_LevelRegions[level].GetSize()) ||
+            (cachedImage->GetNumberOfComponentsPerPixel() != this->GetInput()->GetNumberOfComponentsPerPixel()))
+        itkExceptionMacro("Cached pyramid level does not match the expected geometry");
+
+    // Output type image holding the cached buffer. Grafting the input first keeps its meta data (e.g. MCM description)
+    OutputImagePointer levelImage = OutputImageType::New();
+    const OutputImageType *inputAsOutput = dynamic_cast <const OutputImageType *> (this->GetInput());
+    if (inputAsOutput)
+        levelImage->Graft(inputAsOutput);
+
+    levelImage->CopyInformation(cachedImage);
+    levelImage->SetNumberOfComponentsPerPixel(cachedImage->GetNumberOfComponentsPerPixel());
+    levelImage->SetRegions(cachedImage->GetLargestPossibleRegion());
+    levelImage->SetPixelContainer(cachedImage->GetPixelContainer());
+
+    this->SetNthOutput(level, levelImage);
+}
+
+template <class TInputImage, class TOutputImage>
+void
+PyramidImageFilter<TInputImage,TOutputImage>::
+WriteCachedLevels(bool vectorImages)
+{
+    for (unsigned int i = 0;i < m_NumberOfLevels;++i)
+    {
+        if (vectorImages)
+            this->WriteCachedLevel <VectorOutputImageType> (i);
+        else
+            this->WriteCachedLevel <ScalarOutputImageType> (i);
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+template <class TCachedImageType>
+void
+PyramidImageFilter<TInputImage,TOutputImage>::
+WriteCachedLevel(unsigned int level)
+{
+    // Plain output type view of the level: no pipeline connection to this filter
+    typename TCachedImageType::Pointer levelImage = TCachedImageType::New();
+    levelImage->Graft(dynamic_cast <TCachedImageType *> (this->GetOutput(level)));
+
+    // Uncompressed: loading a level is a plain read
+    std::string tmpFileName = anima::temporaryCacheFileName(m_CacheDirectory,".nrrd");
+
+    typedef itk::ImageFileWriter <TCachedImageType> WriterType;
+    typename WriterType::Pointer levelWriter = WriterType::New();
+    levelWriter->SetUseCompression(false);
+    levelWriter->SetFileName(tmpFileName);
+    levelWriter->SetInput(levelImage);
+
+    try
+    {
+        levelWriter->Update();
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        // A cache that cannot be written does not stop the registration
+        std::cerr << "Unable to write pyramid level to cache: " << e.GetDescription() << std::endl;
+        itksys::SystemTools::RemoveFile(tmpFileName);
+        return;
+    }
+
+    anima::commitCacheFile(tmpFileName,this->GetLevelCacheFileName(level));
 }
 
 template <class TInputImage, class TOutputImage>
@@ -66,6 +66,8 @@ int main(int ac, const char** av)
     TCLAP::ValueArg<unsigned int> numPyramidLevelsArg("p","pyr","Number of pyramid levels (default: 3)",false,3,"number of pyramid levels",cmd);
     TCLAP::ValueArg<unsigned int> lastPyramidLevelArg("l","last-level","Index of the last pyramid level explored (default: 0)",false,0,"last pyramid level",cmd);
     TCLAP::ValueArg<unsigned int> numThreadsArg("T","threads","Number of execution threads (default: 0 = all cores)",false,0,"number of threads",cmd);
+    TCLAP::ValueArg<std::string> cacheDirArg("","cache-dir","Directory where reference pyramids are cached",false,"","cache directory",cmd);
+    TCLAP::ValueArg<unsigned long> cacheSizeArg("","cache-size","Maximum cache directory size in MB, least recently used entries are removed (default: 0 = no limit)",false,0,"maximum cache size",cmd);
 
     try
     {
@@ -140,6 +142,8 @@ int main(int ac, const char** av)
     matcher->SetExponentiationOrder(expOrderArg.getValue());
     matcher->SetNumberOfPyramidLevels( numPyramidLevelsArg.getValue() );
     matcher->SetLastPyramidLevel( lastPyramidLevelArg.getValue() );
+    matcher->SetCacheDirectory(cacheDirArg.getValue());
+    matcher->SetCacheMaximumSize(cacheSizeArg.getValue());
 
     if (numThreadsArg.getValue() != 0)
         matcher->SetNumberOfWorkUnits( numThreadsArg.getValue() );
@@ -222,6 +222,14 @@ public:
     unsigned int GetLastPyramidLevel() {return m_LastPyramidLevel;}
     void SetLastPyramidLevel(unsigned int LastPyramidLevel) {m_LastPyramidLevel=LastPyramidLevel;}
 
+    //! Directory where reference pyramid levels are cached (no cache if empty)
+    std::string GetCacheDirectory() {return m_CacheDirectory;}
+    void SetCacheDirectory(std::string const& dirName) {m_CacheDirectory = dirName;}
+
+    //! Maximum cache size in megabytes (0: no limit)
+    unsigned long GetCacheMaximumSize() {return m_CacheMaximumSize;}
+    void SetCacheMaximumSize(unsigned long val) {m_CacheMaximumSize = val;}
+
     double GetPercentageKept() {return m_PercentageKept;}
     void SetPercentageKept(double PercentageKept) {m_PercentageKept=PercentageKept;}
 
@@ -285,6 +293,9 @@ private:
 
     unsigned int m_NumberOfPyramidLevels;
     unsigned int m_LastPyramidLevel;
+
+    std::string m_CacheDirectory;
+    unsigned long m_CacheMaximumSize;
     double m_PercentageKept;
 
     // Variables for metric approximation
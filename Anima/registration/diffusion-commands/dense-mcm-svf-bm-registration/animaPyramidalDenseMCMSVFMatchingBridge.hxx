@@ -14,6 +14,8 @@
 #include <animaMCMResampleImageFilter.h>
 #include <animaMCMConstants.h>
 
+#include <typeinfo>
+
 namespace anima
 {
 
@@ -65,6 +67,9 @@ PyramidalDenseMCMSVFMatchingBridge<ImageDimension>::PyramidalDenseMCMSVFMatching
     m_ExponentiationOrder = 1;
     m_NumberOfPyramidLevels = 3;
     m_LastPyramidLevel = 0;
+
+    m_CacheDirectory = "";
+    m_CacheMaximumSize = 0;
     m_PercentageKept = 0.8;
     this->SetNumberOfWorkUnits(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads());
 }
@@ -511,6 +516,13 @@ PyramidalDenseMCMSVFMatchingBridge<ImageDimension>::SetupPyramids()
     refResampler->SetInterpolator(interpolator.GetPointer());
     m_ReferencePyramid->SetImageResampler(refResampler);
 
+    // Interpolator type depends on the reference model, it is part of the cache key
+    std::ostringstream cacheTag;
+    cacheTag << "finite strain " << this->GetFiniteStrainImageReorientation() << " " << typeid(*interpolator.GetPointer()).name();
+    m_ReferencePyramid->SetCacheDirectory(m_CacheDirectory);
+    m_ReferencePyramid->SetCacheMaximumSize(m_CacheMaximumSize);
+    m_ReferencePyramid->SetCacheTag(cacheTag.str());
+
     m_ReferencePyramid->Update();
 
     // Create pyramid for Floating image
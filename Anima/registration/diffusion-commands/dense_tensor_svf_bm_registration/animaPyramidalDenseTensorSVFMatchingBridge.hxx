@@ -63,6 +63,9 @@ PyramidalDenseTensorSVFMatchingBridge<ImageDimension>::PyramidalDenseTensorSVFMa
     m_ExponentiationOrder = 1;
     m_NumberOfPyramidLevels = 3;
     m_LastPyramidLevel = 0;
+
+    m_CacheDirectory = "";
+    m_CacheMaximumSize = 0;
     m_PercentageKept = 0.8;
     this->SetNumberOfWorkUnits(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads());
 }
@@ -480,6 +483,12 @@ PyramidalDenseTensorSVFMatchingBridge<ImageDimension>::SetupPyramids()
     refResampler->SetFiniteStrainReorientation(this->GetFiniteStrainImageReorientation());
     m_ReferencePyramid->SetImageResampler(refResampler);
 
+    std::ostringstream cacheTag;
+    cacheTag << "finite strain " << this->GetFiniteStrainImageReorientation();
+    m_ReferencePyramid->SetCacheDirectory(m_CacheDirectory);
+    m_ReferencePyramid->SetCacheMaximumSize(m_CacheMaximumSize);
+    m_ReferencePyramid->SetCacheTag(cacheTag.str());
+
     m_ReferencePyramid->Update();
 
     // Create pyramid for Floating image
@@ -510,6 +519,8 @@ PyramidalDenseTensorSVFMatchingBridge<ImageDimension>::SetupPyramids()
         m_BlockGenerationPyramid->SetInput(m_BlockGenerationMask);
         m_BlockGenerationPyramid->SetNumberOfLevels(GetNumberOfPyramidLevels());
         m_BlockGenerationPyramid->SetNumberOfWorkUnits(GetNumberOfWorkUnits());
+        m_BlockGenerationPyramid->SetCacheDirectory(m_CacheDirectory);
+        m_BlockGenerationPyramid->SetCacheMaximumSize(m_CacheMaximumSize);
         m_BlockGenerationPyramid->Update();
     }
 }
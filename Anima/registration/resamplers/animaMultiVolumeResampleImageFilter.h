@@ -0,0 +1,149 @@
+#pragma once
+
+#include <itkImageToImageFilter.h>
+#include <itkImage.h>
+#include <itkVectorImage.h>
+#include <itkTransform.h>
+#include <itkImageRegionSplitterDirection.h>
+
+namespace anima
+{
+
+/**
+ * @brief Resamples a series of volumes (e.g. a 4D DWI) sharing the same geometry in a single pass.
+ * The input is a volume-interleaved vector image (one component per volume), the output
+ * a scalar image with one more dimension. The mapped continuous index and the interpolation
+ * weights are computed once per output voxel and applied to all volumes. Threads never split
+ * along the volume dimension, output requested regions may be any slab so that the output can be streamed.
+ */
+template <typename TInputPixelType, typename TOutputPixelType, unsigned int NDimensions = 3>
+class MultiVolumeResampleImageFilter :
+        public itk::ImageToImageFilter < itk::VectorImage <TInputPixelType, NDimensions>,
+                                         itk::Image <TOutputPixelType, NDimensions + 1> >
+{
+public:
+    /** Standard class typedefs. */
+    typedef MultiVolumeResampleImageFilter Self;
+    typedef itk::VectorImage <TInputPixelType, NDimensions> InputImageType;
+    typedef itk::Image <TOutputPixelType, NDimensions + 1> OutputImageType;
+    typedef itk::ImageToImageFilter <InputImageType, OutputImageType> Superclass;
+    typedef itk::SmartPointer<Self> Pointer;
+    typedef itk::SmartPointer<const Self>  ConstPointer;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro(Self)
+
+    /** Run-time type information (and related methods) */
+    itkTypeMacro(MultiVolumeResampleImageFilter, itk::ImageToImageFilter)
+
+    typedef typename InputImageType::Pointer InputImagePointer;
+    typedef typename InputImageType::IndexType InputIndexType;
+    typedef typename InputImageType::PointType InputPointType;
+
+    typedef typename OutputImageType::Pointer OutputImagePointer;
+    typedef typename OutputImageType::RegionType OutputImageRegionType;
+    typedef typename OutputImageType::IndexType OutputIndexType;
+    typedef typename OutputImageType::SpacingType SpacingType;
+    typedef typename OutputImageType::PointType OriginPointType;
+    typedef typename OutputImageType::DirectionType DirectionType;
+
+    typedef itk::ContinuousIndex <double, NDimensions> ContinuousIndexType;
+
+    //! Image holding the B-spline coefficients of all volumes, interleaved as the input
+    typedef itk::VectorImage <double, NDimensions> CoefficientImageType;
+    typedef typename CoefficientImageType::Pointer CoefficientImagePointer;
+
+    //! Image used only to carry the geometry of one output volume
+    typedef itk::ImageBase <NDimensions> VolumeGeometryType;
+    typedef typename VolumeGeometryType::Pointer VolumeGeometryPointer;
+
+    typedef itk::Transform <double, NDimensions, NDimensions> TransformType;
+    typedef typename TransformType::Pointer TransformPointer;
+
+    enum InterpolationMode
+    {
+        Nearest = 0,
+        Linear,
+        BSpline
+    };
+
+    itkSetObjectMacro(Transform, TransformType)
+    itkGetObjectMacro(Transform, TransformType)
+
+    itkSetMacro(InterpolationMode, InterpolationMode)
+    itkGetConstMacro(InterpolationMode, InterpolationMode)
+
+    itkSetMacro(DefaultPixelValue, TOutputPixelType)
+    itkGetConstMacro(DefaultPixelValue, TOutputPixelType)
+
+    //! Output geometry, including the volume dimension whose size has to match the input number of components
+    itkSetMacro(OutputSpacing, SpacingType)
+    itkGetConstReferenceMacro(OutputSpacing, SpacingType)
+
+    itkSetMacro(OutputOrigin, OriginPointType)
+    itkGetConstReferenceMacro(OutputOrigin, OriginPointType)
+
+    itkSetMacro(OutputDirection, DirectionType)
+    itkGetConstReferenceMacro(OutputDirection, DirectionType)
+
+    itkSetMacro(OutputLargestPossibleRegion, OutputImageRegionType)
+    itkGetConstReferenceMacro(OutputLargestPossibleRegion, OutputImageRegionType)
+
+    //! Splitter keeping all volumes of a voxel in the same work unit (classic threading, dynamic threading ignores it)
+    const itk::ImageRegionSplitterBase *GetImageRegionSplitter() const ITK_OVERRIDE {return m_RegionSplitter;}
+
+protected:
+    MultiVolumeResampleImageFilter();
+    virtual ~MultiVolumeResampleImageFilter() {}
+
+    void GenerateOutputInformation() ITK_OVERRIDE;
+    void GenerateInputRequestedRegion() ITK_OVERRIDE;
+
+    void BeforeThreadedGenerateData() ITK_OVERRIDE;
+    void ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType threadId) ITK_OVERRIDE;
+    void AfterThreadedGenerateData() ITK_OVERRIDE;
+
+    //! Computes interleaved cubic B-spline coefficients, volume by volume
+    void ComputeBSplineCoefficients();
+
+    //! Mirror boundary conditions for B-spline support indexes
+    inline long MirrorIndex(long index, long startIndex, long size)
+    {
+        if (size == 1)
+            return startIndex;
+
+        long relativeIndex = index - startIndex;
+        long dataLength2 = 2 * (size - 1);
+
+        if (relativeIndex < 0)
+            relativeIndex = - relativeIndex - dataLength2 * ((- relativeIndex) / dataLength2);
+        else
+            relativeIndex = relativeIndex - dataLength2 * (relativeIndex / dataLength2);
+
+        if (relativeIndex >= size)
+            relativeIndex = dataLength2 - relativeIndex;
+
+        return startIndex + relativeIndex;
+    }
+
+private:
+    ITK_DISALLOW_COPY_AND_ASSIGN(MultiVolumeResampleImageFilter);
+
+    TransformPointer m_Transform;
+    InterpolationMode m_InterpolationMode;
+    TOutputPixelType m_DefaultPixelValue;
+
+    SpacingType m_OutputSpacing;
+    OriginPointType m_OutputOrigin;
+    DirectionType m_OutputDirection;
+    OutputImageRegionType m_OutputLargestPossibleRegion;
+
+    itk::ImageRegionSplitterDirection::Pointer m_RegionSplitter;
+
+    VolumeGeometryPointer m_VolumeGeometry;
+    CoefficientImagePointer m_CoefficientImage;
+};
+
+} // end namespace anima
+
+#include "animaMultiVolumeResampleImageFilter.hxx"
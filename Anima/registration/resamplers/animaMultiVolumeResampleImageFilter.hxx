@@ -0,0 +1,389 @@
+#pragma once
+#include "animaMultiVolumeResampleImageFilter.h"
+
+#include <itkBSplineDecompositionImageFilter.h>
+#include <itkVectorIndexSelectionCastImageFilter.h>
+#include <itkImageRegionConstIterator.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace anima
+{
+
+template <typename TInputPixelType, typename TOutputPixelType, unsigned int NDimensions>
+MultiVolumeResampleImageFilter<TInputPixelType, TOutputPixelType, NDimensions>
+::MultiVolumeResampleImageFilter()
+{
+    m_Transform = nullptr;
+    m_InterpolationMode = Linear;
+    m_DefaultPixelValue = 0;
+
+    m_OutputSpacing.Fill(1.0);
+    m_OutputOrigin.Fill(0.0);
+    m_OutputDirection.SetIdentity();
+
+    m_RegionSplitter = itk::ImageRegionSplitterDirection::New();
+    m_RegionSplitter->SetDirection(NDimensions);
+    this->DynamicMultiThreadingOff();
+
+    m_VolumeGeometry = nullptr;
+    m_CoefficientImage = nullptr;
+}
+
+template <typename TInputPixelType, typename TOutputPixelType, unsigned int NDimensions>
+void
+MultiVolumeResampleImageFilter<TInputPixelType, TOutputPixelType, NDimensions>
+::GenerateOutputInformation()
+{
+    Superclass::GenerateOutputInformation();
+
+    OutputImagePointer output = this->GetOutput();
+    output->SetSpacing(m_OutputSpacing);
+    output->SetOrigin(m_OutputOrigin);
+    output->SetDirection(m_OutputDirection);
+    output->SetLargestPossibleRegion(m_OutputLargestPossibleRegion);
+}
+
+template <typename TInputPixelType, typename TOutputPixelType, unsigned int NDimensions>
+void
+MultiVolumeResampleImageFilter<TInputPixelType, TOutputPixelType, NDimensions>
+::GenerateInputRequestedRegion()
+{
+    Superclass::GenerateInputRequestedRegion();
+    if (!this->GetInput())
+        return;
+
+    // No assumption can be made on the transform, the whole input is needed for any output slab
+    InputImagePointer inputPtr = const_cast <InputImageType *> (this->GetInput());
+    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <typename TInputPixelType, typename TOutputPixelType, unsigned int NDimensions>
+void
+MultiVolumeResampleImageFilter<TInputPixelType, TOutputPixelType, NDimensions>
+::BeforeThreadedGenerateData()
+{
+    Superclass::BeforeThreadedGenerateData();
+
+    if (m_Transform.IsNull())
+        itkExceptionMacro("No valid transformation...");
+
+    if (m_OutputLargestPossibleRegion.GetSize()[NDimensions] != this->GetInput()->GetNumberOfComponentsPerPixel())
+        itkExceptionMacro("Output number of volumes does not match the input number of components");
+
+    m_VolumeGeometry = VolumeGeometryType::New();
+    typename VolumeGeometryType::RegionType volumeRegion;
+    typename VolumeGeometryType::PointType volumeOrigin;
+    typename VolumeGeometryType::SpacingType volumeSpacing;
+    typename VolumeGeometryType::DirectionType volumeDirection;
+
+    for (unsigned int i = 0;i < NDimensions;++i)
+    {
+        volumeRegion.SetIndex(i,m_OutputLargestPossibleRegion.GetIndex()[i]);
+        volumeRegion.SetSize(i,m_OutputLargestPossibleRegion.GetSize()[i]);
+        volumeOrigin[i] = m_OutputOrigin[i];
+        volumeSpacing[i] = m_OutputSpacing[i];
+
+        for (unsigned int j = 0;j < NDimensions;++j)
+            volumeDirection(i,j) = m_OutputDirection(i,j);
+    }
+
+    m_VolumeGeometry->SetRegions(volumeRegion);
+    m_VolumeGeometry->SetOrigin(volumeOrigin);
+    m_VolumeGeometry->SetSpacing(volumeSpacing);
+    m_VolumeGeometry->SetDirection(volumeDirection);
+
+    if ((m_InterpolationMode == BSpline) && m_CoefficientImage.IsNull())
+        this->ComputeBSplineCoefficients();
+}
+
+template <typename TInputPixelType, typename TOutputPixelType, unsigned int NDimensions>
+void
+MultiVolumeResampleImageFilter<TInputPixelType, TOutputPixelType, NDimensions>
+::ComputeBSplineCoefficients()
+{
+    typedef itk::Image <double, NDimensions> VolumeImageType;
+    typedef itk::VectorIndexSelectionCastImageFilter <InputImageType, VolumeImageType> SelectionFilterType;
+    typedef itk::BSplineDecompositionImageFilter <VolumeImageType, VolumeImageType> DecompositionFilterType;
+
+    const InputImageType *input = this->GetInput();
+    unsigned int numVolumes = input->GetNumberOfComponentsPerPixel();
+
+    m_CoefficientImage = CoefficientImageType::New();
+    m_CoefficientImage->Initialize();
+    m_CoefficientImage->SetRegions(input->GetLargestPossibleRegion());
+    m_CoefficientImage->SetOrigin(input->GetOrigin());
+    m_CoefficientImage->SetSpacing(input->GetSpacing());
+    m_CoefficientImage->SetDirection(input->GetDirection());
+    m_CoefficientImage->SetVectorLength(numVolumes);
+    m_CoefficientImage->Allocate();
+
+    double *coefficientBuffer = m_CoefficientImage->GetBufferPointer();
+
+    // Prefiltering is intrinsically per volume, weights will then be shared
+    for (unsigned int i = 0;i < numVolumes;++i)
+    {
+        typename SelectionFilterType::Pointer selectionFilter = SelectionFilterType::New();
+        selectionFilter->SetInput(input);
+        selectionFilter->SetIndex(i);
+        selectionFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+
+        typename DecompositionFilterType::Pointer decompositionFilter = DecompositionFilterType::New();
+        decompositionFilter->SetInput(selectionFilter->GetOutput());
+        decompositionFilter->SetSplineOrder(3);
+        decompositionFilter->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+        decompositionFilter->Update();
+
+        itk::ImageRegionConstIterator <VolumeImageType> coefItr(decompositionFilter->GetOutput(),
+                                                               decompositionFilter->GetOutput()->GetLargestPossibleRegion());
+
+        unsigned int pos = i;
+        while (!coefItr.IsAtEnd())
+        {
+            coefficientBuffer[pos] = coefItr.Get();
+            pos += numVolumes;
+            ++coefItr;
+        }
+    }
+}
+
+template <typename TInputPixelType, typename TOutputPixelType, unsigned int NDimensions>
+void
+MultiVolumeResampleImageFilter<TInputPixelType, TOutputPixelType, NDimensions>
+::ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType itkNotUsed(threadId))
+{
+    const InputImageType *input = this->GetInput();
+    OutputImageType *output = this->GetOutput();
+
+    const unsigned int numInputVolumes = input->GetNumberOfComponentsPerPixel();
+    const unsigned int firstVolume = outputRegionForThread.GetIndex()[NDimensions] - m_OutputLargestPossibleRegion.GetIndex()[NDimensions];
+    const unsigned int numVolumes = outputRegionForThread.GetSize()[NDimensions];
+
+    const TInputPixelType *inputBuffer = input->GetBufferPointer();
+    const double *coefficientBuffer = (m_InterpolationMode == BSpline) ? m_CoefficientImage->GetBufferPointer() : nullptr;
+    TOutputPixelType *outputBuffer = output->GetBufferPointer();
+    const typename OutputImageType::OffsetValueType volumeStride = output->GetOffsetTable()[NDimensions];
+
+    const InputIndexType inputStart = input->GetBufferedRegion().GetIndex();
+    const typename InputImageType::SizeType inputSize = input->GetBufferedRegion().GetSize();
+    const typename InputImageType::OffsetValueType *inputOffsetTable = input->GetOffsetTable();
+
+    // Accumulators for all volumes of the current voxel, reused for the whole region
+    std::vector <double> voxelValues(numVolumes);
+
+    const unsigned int numLinearNeighbors = 1 << NDimensions;
+    const unsigned int numBSplineNeighbors = 1 << (2 * NDimensions);
+    std::vector <double> neighborWeights(std::max(numLinearNeighbors,numBSplineNeighbors));
+    std::vector <typename InputImageType::OffsetValueType> neighborOffsets(neighborWeights.size());
+
+    double splineWeights[NDimensions][4];
+    long splineIndexes[NDimensions][4];
+
+    typename VolumeGeometryType::IndexType volumeIndex;
+    OutputIndexType outputIndex = outputRegionForThread.GetIndex();
+    InputPointType outputPoint, inputPoint;
+    ContinuousIndexType inputContinuousIndex;
+
+    unsigned int numVoxels = 1;
+    for (unsigned int i = 0;i < NDimensions;++i)
+        numVoxels *= outputRegionForThread.GetSize()[i];
+
+    for (unsigned int voxel = 0;voxel < numVoxels;++voxel)
+    {
+        for (unsigned int i = 0;i < NDimensions;++i)
+            volumeIndex[i] = outputIndex[i];
+
+        m_VolumeGeometry->TransformIndexToPhysicalPoint(volumeIndex,outputPoint);
+        inputPoint = m_Transform->TransformPoint(outputPoint);
+        input->TransformPhysicalPointToContinuousIndex(inputPoint,inputContinuousIndex);
+
+        bool insideBuffer = true;
+        for (unsigned int i = 0;i < NDimensions;++i)
+        {
+            if ((inputContinuousIndex[i] < inputStart[i] - 0.5) || (inputContinuousIndex[i] >= inputStart[i] + inputSize[i] - 0.5))
+            {
+                insideBuffer = false;
+                break;
+            }
+        }
+
+        // Compute once the neighbors and weights, shared by all volumes
+        unsigned int numNeighbors = 0;
+        if (insideBuffer)
+        {
+            switch (m_InterpolationMode)
+            {
+                case Nearest:
+                {
+                    typename InputImageType::OffsetValueType offset = 0;
+                    for (unsigned int i = 0;i < NDimensions;++i)
+                    {
+                        long index = std::floor(inputContinuousIndex[i] + 0.5);
+                        index = std::min(std::max(index,(long)inputStart[i]),(long)(inputStart[i] + inputSize[i] - 1));
+                        offset += (index - inputStart[i]) * inputOffsetTable[i];
+                    }
+
+                    neighborOffsets[0] = offset;
+                    neighborWeights[0] = 1.0;
+                    numNeighbors = 1;
+                    break;
+                }
+
+                case Linear:
+                {
+                    long baseIndex[NDimensions];
+                    double distance[NDimensions];
+                    for (unsigned int i = 0;i < NDimensions;++i)
+                    {
+                        baseIndex[i] = std::floor(inputContinuousIndex[i]);
+                        distance[i] = inputContinuousIndex[i] - baseIndex[i];
+                    }
+
+                    for (unsigned int n = 0;n < numLinearNeighbors;++n)
+                    {
+                        double weight = 1.0;
+                        typename InputImageType::OffsetValueType offset = 0;
+                        for (unsigned int i = 0;i < NDimensions;++i)
+                        {
+                            long index = baseIndex[i];
+                            if (n & (1 << i))
+                            {
+                                ++index;
+                                weight *= distance[i];
+                            }
+                            else
+                                weight *= 1.0 - distance[i];
+
+                            index = std::min(std::max(index,(long)inputStart[i]),(long)(inputStart[i] + inputSize[i] - 1));
+                            offset += (index - inputStart[i]) * inputOffsetTable[i];
+                        }
+
+                        if (weight == 0.0)
+                            continue;
+
+                        neighborOffsets[numNeighbors] = offset;
+                        neighborWeights[numNeighbors] = weight;
+                        ++numNeighbors;
+                    }
+
+                    break;
+                }
+
+                case BSpline:
+                default:
+                {
+                    for (unsigned int i = 0;i < NDimensions;++i)
+                    {
+                        long baseIndex = std::floor(inputContinuousIndex[i]);
+                        double t = inputContinuousIndex[i] - baseIndex;
+                        double oneMinusT = 1.0 - t;
+                        double tSquare = t * t;
+                        double tCube = tSquare * t;
+
+                        splineWeights[i][0] = oneMinusT * oneMinusT * oneMinusT / 6.0;
+                        splineWeights[i][1] = (3.0 * tCube - 6.0 * tSquare + 4.0) / 6.0;
+                        splineWeights[i][2] = (- 3.0 * tCube + 3.0 * tSquare + 3.0 * t + 1.0) / 6.0;
+                        splineWeights[i][3] = tCube / 6.0;
+
+                        for (unsigned int k = 0;k < 4;++k)
+                            splineIndexes[i][k] = this->MirrorIndex(baseIndex - 1 + k,inputStart[i],inputSize[i]) - inputStart[i];
+                    }
+
+                    for (unsigned int n = 0;n < numBSplineNeighbors;++n)
+                    {
+                        double weight = 1.0;
+                        typename InputImageType::OffsetValueType offset = 0;
+                        unsigned int code = n;
+                        for (unsigned int i = 0;i < NDimensions;++i)
+                        {
+                            unsigned int k = code & 3;
+                            code >>= 2;
+
+                            weight *= splineWeights[i][k];
+                            offset += splineIndexes[i][k] * inputOffsetTable[i];
+                        }
+
+                        neighborOffsets[numNeighbors] = offset;
+                        neighborWeights[numNeighbors] = weight;
+                        ++numNeighbors;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        typename OutputImageType::OffsetValueType outputOffset = output->ComputeOffset(outputIndex);
+
+        if (!insideBuffer)
+        {
+            for (unsigned int j = 0;j < numVolumes;++j)
+                outputBuffer[outputOffset + j * volumeStride] = m_DefaultPixelValue;
+        }
+        else
+        {
+            std::fill(voxelValues.begin(),voxelValues.end(),0.0);
+
+            // Volumes of a neighbor are contiguous in the interleaved buffer
+            for (unsigned int n = 0;n < numNeighbors;++n)
+            {
+                double weight = neighborWeights[n];
+                typename InputImageType::OffsetValueType neighborPosition = neighborOffsets[n] * numInputVolumes + firstVolume;
+
+                if (coefficientBuffer)
+                {
+                    const double *neighborValues = coefficientBuffer + neighborPosition;
+                    for (unsigned int j = 0;j < numVolumes;++j)
+                        voxelValues[j] += weight * neighborValues[j];
+                }
+                else
+                {
+                    const TInputPixelType *neighborValues = inputBuffer + neighborPosition;
+                    for (unsigned int j = 0;j < numVolumes;++j)
+                        voxelValues[j] += weight * neighborValues[j];
+                }
+            }
+
+            for (unsigned int j = 0;j < numVolumes;++j)
+                outputBuffer[outputOffset + j * volumeStride] = static_cast <TOutputPixelType> (voxelValues[j]);
+        }
+
+        // Move to next voxel of the output volume region
+        for (unsigned int i = 0;i < NDimensions;++i)
+        {
+            ++outputIndex[i];
+            if (outputIndex[i] < (long)(outputRegionForThread.GetIndex()[i] + outputRegionForThread.GetSize()[i]))
+                break;
+
+            outputIndex[i] = outputRegionForThread.GetIndex()[i];
+        }
+    }
+}
+
+template <typename TInputPixelType, typename TOutputPixelType, unsigned int NDimensions>
+void
+MultiVolumeResampleImageFilter<TInputPixelType, TOutputPixelType, NDimensions>
+::AfterThreadedGenerateData()
+{
+    Superclass::AfterThreadedGenerateData();
+
+    // Coefficients are kept while streaming slabs, they are released once the last slab is done
+    typename OutputImageType::RegionType requestedRegion = this->GetOutput()->GetRequestedRegion();
+    unsigned int lastVolume = requestedRegion.GetIndex()[NDimensions] + requestedRegion.GetSize()[NDimensions];
+    unsigned int endVolume = m_OutputLargestPossibleRegion.GetIndex()[NDimensions] + m_OutputLargestPossibleRegion.GetSize()[NDimensions];
+
+    bool lastSlab = (lastVolume == endVolume);
+    for (unsigned int i = 0;i < NDimensions;++i)
+    {
+        if (requestedRegion.GetIndex()[i] + requestedRegion.GetSize()[i] !=
+                m_OutputLargestPossibleRegion.GetIndex()[i] + m_OutputLargestPossibleRegion.GetSize()[i])
+            lastSlab = false;
+    }
+
+    if (lastSlab)
+        m_CoefficientImage = nullptr;
+}
+
+} // end namespace anima
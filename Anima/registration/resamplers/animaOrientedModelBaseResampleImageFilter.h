@@ -3,6 +3,9 @@
 #include <iostream>
 #include <animaMaskedImageToImageFilter.h>
 #include <itkVectorImage.h>
+#include <itkVector.h>
+#include <itkNumericTraitsVariableLengthVectorPixel.h>
+#include <itkNumericTraitsVectorPixel.h>
 #include <itkInterpolateImageFunction.h>
 
 #include <itkMatrixOffsetTransformBase.h>
@@ -111,6 +114,19 @@ protected:
         return true;
     }
 
+    //! Fixed length vector pixels (e.g. itk::Vector <float,6> for tensors)
+    template <class T, unsigned int NVectorDimension>
+    inline bool isZero(itk::Vector <T,NVectorDimension> &dataVec)
+    {
+        for (unsigned int i = 0;i < NVectorDimension;++i)
+        {
+            if (dataVec[i] != 0)
+                return false;
+        }
+
+        return true;
+    }
+
     // Fake method for compilation purposes, should never go in there
     template <class T> inline bool isZero(T &data)
     {
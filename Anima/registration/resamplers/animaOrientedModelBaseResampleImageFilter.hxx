@@ -113,9 +113,15 @@ OrientedModelBaseResampleImageFilter<TImageType, TInterpolatorPrecisionType>
     InputIndexType tmpInd;
     PointType tmpPoint;
     unsigned int vectorSize = this->GetOutputVectorLength();
-    InputPixelType tmpRes(vectorSize), resRotated(vectorSize);
+    InputPixelType tmpRes, resRotated;
+    itk::NumericTraits <InputPixelType>::SetLength(tmpRes,vectorSize);
+    itk::NumericTraits <InputPixelType>::SetLength(resRotated,vectorSize);
     ContinuousIndexType index;
 
+    // Vector model interpolation writes directly in tmpRes, other interpolators (e.g. MCM) return a new pixel
+    typedef anima::VectorModelLinearInterpolateImageFunction <InputImageType,TInterpolatorPrecisionType> VectorModelInterpolatorType;
+    const VectorModelInterpolatorType *vectorModelInterpolator = dynamic_cast <const VectorModelInterpolatorType *> (m_Interpolator.GetPointer());
+
     vnl_matrix <double> orientationMatrix = this->ComputeLinearJacobianMatrix();
     vnl_matrix <double> parametersRotationMatrix;
     this->ComputeRotationParametersFromReorientationMatrix(orientationMatrix,parametersRotationMatrix);
@@ -136,7 +142,12 @@ OrientedModelBaseResampleImageFilter<TImageType, TInterpolatorPrecisionType>
             index[ImageDimension - 1] = 0;
 
         if (m_Interpolator->IsInsideBuffer(index))
-            tmpRes = m_Interpolator->EvaluateAtContinuousIndex(index);
+        {
+            if (vectorModelInterpolator)
+                vectorModelInterpolator->EvaluateAtContinuousIndexInBuffer(index,tmpRes.GetDataPointer());
+            else
+                tmpRes = m_Interpolator->EvaluateAtContinuousIndex(index);
+        }
         else
             this->InitializeZeroPixel(tmpRes);
 
@@ -165,9 +176,15 @@ OrientedModelBaseResampleImageFilter<TImageType, TInterpolatorPrecisionType>
     InputIndexType tmpInd;
     PointType tmpPoint;
     unsigned int vectorSize = this->GetOutputVectorLength();
-    InputPixelType tmpRes(vectorSize), resRotated(vectorSize);
+    InputPixelType tmpRes, resRotated;
+    itk::NumericTraits <InputPixelType>::SetLength(tmpRes,vectorSize);
+    itk::NumericTraits <InputPixelType>::SetLength(resRotated,vectorSize);
     ContinuousIndexType index;
 
+    // Vector model interpolation writes directly in tmpRes, other interpolators (e.g. MCM) return a new pixel
+    typedef anima::VectorModelLinearInterpolateImageFunction <InputImageType,TInterpolatorPrecisionType> VectorModelInterpolatorType;
+    const VectorModelInterpolatorType *vectorModelInterpolator = dynamic_cast <const VectorModelInterpolatorType *> (m_Interpolator.GetPointer());
+
     vnl_matrix <double> orientationMatrix(ImageDimension,ImageDimension);
     vnl_matrix <double> parametersRotationMatrix;
 
@@ -181,7 +198,12 @@ OrientedModelBaseResampleImageFilter<TImageType, TInterpolatorPrecisionType>
         this->GetInput(0)->TransformPhysicalPointToContinuousIndex(tmpPoint,index);
 
         if (m_Interpolator->IsInsideBuffer(index))
-            tmpRes = m_Interpolator->EvaluateAtContinuousIndex(index);
+        {
+            if (vectorModelInterpolator)
+                vectorModelInterpolator->EvaluateAtContinuousIndexInBuffer(index,tmpRes.GetDataPointer());
+            else
+                tmpRes = m_Interpolator->EvaluateAtContinuousIndex(index);
+        }
         else
             this->InitializeZeroPixel(tmpRes);
 
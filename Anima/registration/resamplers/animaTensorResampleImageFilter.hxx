@@ -2,6 +2,7 @@
 #include <animaTensorResampleImageFilter.h>
 
 #include <animaBaseTensorTools.h>
+#include <animaSymmetricEigen3D.h>
 
 namespace anima
 {
@@ -42,11 +43,8 @@ TensorResampleImageFilter<TImageType, TInterpolatorPrecisionType>
         anima::RotateSymmetricMatrix(m_WorkMats[threadId],modelOrientationMatrix,m_TmpTensors[threadId]);
     else
     {
-        typedef itk::Matrix <double,3,3> MatrixType;
-        typedef vnl_vector_fixed <double,3> VectorType;
-        itk::SymmetricEigenAnalysis < MatrixType, VectorType, MatrixType> eigenComputer(3);
-        eigenComputer.ComputeEigenValuesAndVectors(m_WorkMats[threadId],m_WorkEigenValues[threadId],
-                                                   m_WorkEigenVectors[threadId]);
+        anima::ComputeSymmetricEigenSystem3D(m_WorkMats[threadId],m_WorkEigenValues[threadId],
+                                             m_WorkEigenVectors[threadId]);
 
         anima::ExtractPPDRotationFromJacobianMatrix(modelOrientationMatrix,m_WorkPPDOrientationMatrices[threadId],m_WorkEigenVectors[threadId]);
         anima::RotateSymmetricMatrix(m_WorkMats[threadId],m_WorkPPDOrientationMatrices[threadId],m_TmpTensors[threadId]);
@@ -12,22 +12,80 @@
 
 #include <itkExtractImageFilter.h>
 #include <animaResampleImageFilter.h>
+#include <animaMultiVolumeResampleImageFilter.h>
 #include <animaTransformSeriesReader.h>
 #include <animaReadWriteFunctions.h>
+#include <animaImageWriteArguments.h>
 #include <animaRetrieveImageTypeMacros.h>
 
 #include <animaGradientFileReader.h>
 #include <itkTransformToDisplacementFieldFilter.h>
+#include <itksys/SystemTools.hxx>
 
 struct arguments
 {
-    bool invert;
+    bool invert, bake, multiVolume;
     unsigned int exponentiationOrder;
     unsigned int pthread;
-    std::string input, output, geometry, transfo, interpolation;
+    unsigned int numberOfSlabs;
+    std::string input, output, geometry, transfo, interpolation, cacheDir;
 
 };
 
+//! Builds an empty image holding the geometry information, used to bake the transformation serie
+template <unsigned int Dimension>
+typename itk::ImageBase <Dimension>::Pointer
+createGeometryImage(itk::ImageIOBase::Pointer geometryImageIO)
+{
+    typedef itk::ImageBase <Dimension> GeometryImageType;
+    typename GeometryImageType::Pointer geometryImage = GeometryImageType::New();
+
+    typename GeometryImageType::RegionType region;
+    typename GeometryImageType::PointType origin;
+    typename GeometryImageType::SpacingType spacing;
+    typename GeometryImageType::DirectionType direction;
+    direction.SetIdentity();
+    unsigned int imageIODimension = std::min(geometryImageIO->GetNumberOfDimensions(),Dimension);
+
+    for (unsigned int i = 0;i < imageIODimension;++i)
+    {
+        region.SetIndex(i,0);
+        region.SetSize(i,geometryImageIO->GetDimensions(i));
+        origin[i] = geometryImageIO->GetOrigin(i);
+        spacing[i] = geometryImageIO->GetSpacing(i);
+        for (unsigned int j = 0;j < imageIODimension;++j)
+            direction(i,j) = geometryImageIO->GetDirection(j)[i];
+    }
+
+    for (unsigned int i = imageIODimension;i < Dimension;++i)
+    {
+        region.SetIndex(i,0);
+        region.SetSize(i,1);
+        origin[i] = 0;
+        spacing[i] = 1;
+    }
+
+    geometryImage->SetRegions(region);
+    geometryImage->SetOrigin(origin);
+    geometryImage->SetSpacing(spacing);
+    geometryImage->SetDirection(direction);
+
+    return geometryImage;
+}
+
+template <unsigned int Dimension>
+void
+setTransformSerieOptions(anima::TransformSeriesReader <double, Dimension> *trReader, itk::ImageIOBase::Pointer geometryImageIO,
+                         const arguments &args)
+{
+    trReader->SetFuseLinearTransforms(true);
+    if (args.bake)
+    {
+        trReader->SetBakingGeometry(createGeometryImage <Dimension> (geometryImageIO));
+        trReader->SetCacheDirectory(args.cacheDir);
+    }
+}
+
 void applyTransformationToGradients(std::string &inputGradientsFileName, std::string &outputGradientsFileName, const arguments &args)
 {
     typedef anima::TransformSeriesReader <double, 3> TransformSeriesReaderType;
@@ -108,6 +166,7 @@ applyVectorTransfo(itk::ImageIOBase::Pointer geometryImageIO, const arguments &a
     trReader->SetInvertTransform(args.invert);
     trReader->SetExponentiationOrder(args.exponentiationOrder);
     trReader->SetNumberOfWorkUnits(args.pthread);
+    setTransformSerieOptions(trReader,geometryImageIO,args);
     trReader->Update();
     typename TransformType::Pointer transfo = trReader->GetOutputTransform();
 
@@ -169,6 +228,115 @@ applyVectorTransfo(itk::ImageIOBase::Pointer geometryImageIO, const arguments &a
     anima::writeImage<OutputType>(args.output, vectorResampler->GetOutput());
 }
 
+//! Transposes in place a row-major numRows x numColumns buffer by following permutation cycles
+template <class ValueType>
+void
+transposeInPlace(ValueType *buffer, std::size_t numRows, std::size_t numColumns)
+{
+    if ((numRows < 2) || (numColumns < 2))
+        return;
+
+    // Element at position p goes to (p * numRows) mod (size - 1), first and last elements stay in place
+    std::size_t size = numRows * numColumns;
+    std::vector <bool> moved(size,false);
+    for (std::size_t start = 1;start < size - 1;++start)
+    {
+        if (moved[start])
+            continue;
+
+        ValueType value = buffer[start];
+        std::size_t pos = start;
+        do
+        {
+            pos = (pos * numRows) % (size - 1);
+            std::swap(buffer[pos],value);
+            moved[pos] = true;
+        }
+        while (pos != start);
+    }
+}
+
+//! Resamples all volumes of a 4D image at once, sharing transformed coordinates and interpolation weights
+template <class ImageType, class TransformType, class OutputType>
+void
+applyMultiVolumeTransfo(typename ImageType::Pointer &inputImage, TransformType *transfo, const typename OutputType::RegionType &outputRegion,
+                        const typename OutputType::PointType &origin, const typename OutputType::SpacingType &spacing,
+                        const typename OutputType::DirectionType &direction, double defaultValue, const arguments &args)
+{
+    const unsigned int InternalImageDimension = 3;
+    typedef typename ImageType::PixelType InputPixelType;
+    typedef anima::MultiVolumeResampleImageFilter <InputPixelType, double, InternalImageDimension> ResampleFilterType;
+    typedef typename ResampleFilterType::InputImageType InterleavedImageType;
+
+    // Reorganize input into a volume-interleaved image, in place: the interleaved image takes over the 4D image buffer
+    typename InterleavedImageType::Pointer interleavedImage = InterleavedImageType::New();
+    typename InterleavedImageType::RegionType interleavedRegion;
+    typename InterleavedImageType::PointType interleavedOrigin;
+    typename InterleavedImageType::SpacingType interleavedSpacing;
+    typename InterleavedImageType::DirectionType interleavedDirection;
+
+    for (unsigned int i = 0;i < InternalImageDimension;++i)
+    {
+        interleavedRegion.SetIndex(i,inputImage->GetLargestPossibleRegion().GetIndex()[i]);
+        interleavedRegion.SetSize(i,inputImage->GetLargestPossibleRegion().GetSize()[i]);
+        interleavedOrigin[i] = inputImage->GetOrigin()[i];
+        interleavedSpacing[i] = inputImage->GetSpacing()[i];
+        for (unsigned int j = 0;j < InternalImageDimension;++j)
+            interleavedDirection(i,j) = inputImage->GetDirection()(i,j);
+    }
+
+    itk::SizeValueType numVolumes = inputImage->GetLargestPossibleRegion().GetSize()[InternalImageDimension];
+    itk::SizeValueType numVoxels = interleavedRegion.GetNumberOfPixels();
+
+    interleavedImage->Initialize();
+    interleavedImage->SetRegions(interleavedRegion);
+    interleavedImage->SetOrigin(interleavedOrigin);
+    interleavedImage->SetSpacing(interleavedSpacing);
+    interleavedImage->SetDirection(interleavedDirection);
+    interleavedImage->SetVectorLength(numVolumes);
+
+    transposeInPlace(inputImage->GetBufferPointer(),numVolumes,numVoxels);
+    interleavedImage->SetPixelContainer(inputImage->GetPixelContainer());
+    inputImage = nullptr;
+
+    std::cout << "Resampling " << numVolumes << " sub-images in a single pass..." << std::endl;
+
+    typename ResampleFilterType::Pointer multiVolumeResampler = ResampleFilterType::New();
+    multiVolumeResampler->SetInput(interleavedImage);
+    multiVolumeResampler->SetTransform(transfo);
+    multiVolumeResampler->SetOutputLargestPossibleRegion(outputRegion);
+    multiVolumeResampler->SetOutputOrigin(origin);
+    multiVolumeResampler->SetOutputSpacing(spacing);
+    multiVolumeResampler->SetOutputDirection(direction);
+    multiVolumeResampler->SetDefaultPixelValue(defaultValue);
+    multiVolumeResampler->SetNumberOfWorkUnits(args.pthread);
+
+    if (args.interpolation == "nearest")
+        multiVolumeResampler->SetInterpolationMode(ResampleFilterType::Nearest);
+    else if (args.interpolation == "bspline")
+        multiVolumeResampler->SetInterpolationMode(ResampleFilterType::BSpline);
+    else
+        multiVolumeResampler->SetInterpolationMode(ResampleFilterType::Linear);
+
+    if (args.numberOfSlabs > 1)
+    {
+        // Streamed output, only effective if the output image format supports streamed writing (uncompressed)
+        typedef itk::ImageFileWriter <OutputType> WriterType;
+        typename WriterType::Pointer writer = WriterType::New();
+        writer->SetUseCompression(false);
+        writer->SetNumberOfStreamDivisions(args.numberOfSlabs);
+        writer->SetFileName(args.output);
+        writer->SetInput(multiVolumeResampler->GetOutput());
+
+        writer->Update();
+    }
+    else
+    {
+        multiVolumeResampler->Update();
+        anima::writeImage<OutputType>(args.output, multiVolumeResampler->GetOutput());
+    }
+}
+
 template <class ImageType>
 void
 applyScalarTransfo4D(itk::ImageIOBase::Pointer geometryImageIO, const arguments &args)
@@ -184,6 +352,7 @@ applyScalarTransfo4D(itk::ImageIOBase::Pointer geometryImageIO, const arguments
     trReader->SetInvertTransform(args.invert);
     trReader->SetExponentiationOrder(args.exponentiationOrder);
     trReader->SetNumberOfWorkUnits(args.pthread);
+    setTransformSerieOptions(trReader,geometryImageIO,args);
     trReader->Update();
     typename TransformType::Pointer transfo = trReader->GetOutputTransform();
 
@@ -231,14 +400,6 @@ applyScalarTransfo4D(itk::ImageIOBase::Pointer geometryImageIO, const arguments
         direction(i,i) = inputImage->GetDirection()(i,i);
     }
 
-    typename OutputType::Pointer outputImage = OutputType::New();
-    outputImage->Initialize();
-    outputImage->SetRegions(outputRegion);
-    outputImage->SetOrigin(origin);
-    outputImage->SetSpacing(spacing);
-    outputImage->SetDirection(direction);
-    outputImage->Allocate();
-
     typedef itk::MinimumMaximumImageFilter <ImageType> MinMaxFilterType;
     typename MinMaxFilterType::Pointer minMaxFilter = MinMaxFilterType::New();
     minMaxFilter->SetInput(inputImage);
@@ -251,6 +412,23 @@ applyScalarTransfo4D(itk::ImageIOBase::Pointer geometryImageIO, const arguments
     else
         minImageValue = 0;
 
+    // Optional single pass resampling, sinc interpolation is always done volume by volume
+    if (args.multiVolume && (args.interpolation != "sinc"))
+    {
+        minMaxFilter = nullptr;
+        applyMultiVolumeTransfo <ImageType, TransformType, OutputType> (inputImage,transfo.GetPointer(),outputRegion,origin,
+                                                                         spacing,direction,minImageValue,args);
+        return;
+    }
+
+    typename OutputType::Pointer outputImage = OutputType::New();
+    outputImage->Initialize();
+    outputImage->SetRegions(outputRegion);
+    outputImage->SetOrigin(origin);
+    outputImage->SetSpacing(spacing);
+    outputImage->SetDirection(direction);
+    outputImage->Allocate();
+
     unsigned int numImages = inputImage->GetLargestPossibleRegion().GetSize()[InternalImageDimension];
 
     for (unsigned int i = 0;i < numImages;++i)
@@ -344,6 +522,7 @@ applyScalarTransfo(itk::ImageIOBase::Pointer geometryImageIO, const arguments &a
     trReader->SetInvertTransform(args.invert);
     trReader->SetExponentiationOrder(args.exponentiationOrder);
     trReader->SetNumberOfWorkUnits(args.pthread);
+    setTransformSerieOptions(trReader,geometryImageIO,args);
     trReader->Update();
     typename TransformType::Pointer transfo = trReader->GetOutputTransform();
 
@@ -486,6 +665,10 @@ int main(int ac, const char** av)
 
     TCLAP::ValueArg<unsigned int> expOrderArg("e","exp-order","Order of field exponentiation approximation (in between 0 and 1, default: 0)",false,0,"exponentiation order",cmd);
     TCLAP::SwitchArg invertArg("I","invert","Invert the transformation series",cmd,false);
+    TCLAP::SwitchArg bakeArg("b","bake","Bake the transformation series into a single displacement field on the geometry before resampling",cmd,false);
+    TCLAP::ValueArg<std::string> cacheDirArg("","cache-dir","Directory where baked transformations are cached (requires --bake)",false,"","cache directory",cmd);
+    TCLAP::SwitchArg multiVolumeArg("","multi-volume","Resample all volumes of 4D scalar images in a single pass, sharing transformed coordinates (not for sinc interpolation)",cmd,false);
+    TCLAP::ValueArg<unsigned int> slabsArg("","slabs","Number of slabs to stream 4D outputs (requires --multi-volume, uncompressed outputs only, default: 1)",false,1,"number of slabs",cmd);
     TCLAP::ValueArg<std::string> interpolationArg("n",
                                                   "interpolation",
                                                   "interpolation method to use [nearest, linear, bspline, sinc]",
@@ -497,6 +680,8 @@ int main(int ac, const char** av)
     TCLAP::ValueArg<unsigned int> nbpArg("p","numberofthreads","Number of threads to run on (default : all cores)",
                                          false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
 
+    anima::ImageWriteArguments imageWriteArgs(cmd);
+
     try
     {
         cmd.parse(ac,av);
@@ -507,6 +692,8 @@ int main(int ac, const char** av)
         return EXIT_FAILURE;
     }
 
+    imageWriteArgs.Setup();
+
     // Find out the type of the image in file
     itk::ImageIOBase::Pointer inputImageIO = itk::ImageIOFactory::CreateImageIO(inArg.getValue().c_str(),
                                                                                 itk::IOFileModeEnum::ReadMode);
@@ -540,10 +727,28 @@ int main(int ac, const char** av)
     args.geometry = geomArg.getValue();
     args.transfo = trArg.getValue();
     args.invert = invertArg.getValue();
+    args.bake = bakeArg.isSet();
+    args.cacheDir = cacheDirArg.getValue();
+    args.multiVolume = multiVolumeArg.isSet();
+    args.numberOfSlabs = slabsArg.getValue();
     args.pthread = nbpArg.getValue();
     args.exponentiationOrder = expOrderArg.getValue();
     args.interpolation = interpolationArg.getValue();
 
+    if ((args.numberOfSlabs > 1) && !args.multiVolume)
+    {
+        std::cerr << "Error: --slabs requires --multi-volume" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Compressed outputs cannot be written slab by slab: the whole output would be held in memory anyway
+    std::string outputExtension = itksys::SystemTools::GetFilenameLastExtension(args.output);
+    if ((args.numberOfSlabs > 1) && ((outputExtension == ".gz") || (outputExtension == ".gzip") || (outputExtension == ".zip")))
+    {
+        std::cerr << "Error: --slabs requires an uncompressed output (e.g. .nii), got " << args.output << std::endl;
+        return EXIT_FAILURE;
+    }
+
     bool badInterpolation = true;
     std::string interpolations[4] = {"nearest", "linear", "bspline", "sinc"};
     for(int i = 0; i < 4; ++i)
@@ -2,6 +2,7 @@
 #include <animaTransformSeriesReader.h>
 #include <animaShapesReader.h>
 #include <animaShapesWriter.h>
+#include <itkImageFileReader.h>
 
 #include <vtkPolyData.h>
 
@@ -32,6 +33,8 @@ int main(int ac, const char** av)
     TCLAP::ValueArg<std::string> inArg("i","input","input tracks file",true,"","input tracks",cmd);
     TCLAP::ValueArg<std::string> outArg("o","output","output tracks name",true,"","output tracks",cmd);
     TCLAP::ValueArg<std::string> trArg("t","trsf","Transformations XML list",true,"","transformations list",cmd);
+    TCLAP::ValueArg<std::string> geomArg("g","geometry","Geometry image covering the tracks, if set the transformation series is baked on it into a single displacement field",false,"","geometry image",cmd);
+    TCLAP::ValueArg<std::string> cacheDirArg("","cache-dir","Directory where baked transformations are cached (requires a geometry)",false,"","cache directory",cmd);
 
     TCLAP::ValueArg<unsigned int> expOrderArg("e","exp-order","Order of field exponentiation approximation (in between 0 and 1, default: 0)",false,0,"exponentiation order",cmd);
     TCLAP::SwitchArg invertArg("I","invert","Invert the transformation series",cmd,false);
@@ -53,6 +56,20 @@ int main(int ac, const char** av)
     trsfReader.SetInvertTransform(!invertArg.isSet());
     trsfReader.SetExponentiationOrder(expOrderArg.getValue());
     trsfReader.SetNumberOfWorkUnits(nbpArg.getValue());
+    trsfReader.SetFuseLinearTransforms(true);
+
+    if (geomArg.getValue() != "")
+    {
+        typedef itk::Image <unsigned char, 3> GeometryImageType;
+        itk::ImageFileReader <GeometryImageType>::Pointer geometryReader = itk::ImageFileReader <GeometryImageType>::New();
+        geometryReader->SetFileName(geomArg.getValue());
+        geometryReader->UpdateOutputInformation();
+
+        GeometryImageType::Pointer geometryImage = geometryReader->GetOutput();
+        trsfReader.SetBakingGeometry(geometryImage);
+        trsfReader.SetCacheDirectory(cacheDirArg.getValue());
+    }
+
     trsfReader.Update();
 
     anima::ShapesReader trackReader;
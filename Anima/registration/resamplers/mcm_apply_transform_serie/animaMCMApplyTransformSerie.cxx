@@ -40,6 +40,8 @@ int main(int ac, const char** av)
     TCLAP::SwitchArg ppdArg("P","ppd","Use PPD re-orientation scheme (default: no)",cmd,false);
     TCLAP::SwitchArg invertArg("I","invert","Invert the transformation series",cmd,false);
     TCLAP::SwitchArg nearestArg("N","nearest","Use nearest neighbor interpolation",cmd,false);
+    TCLAP::SwitchArg bakeArg("b","bake","Bake the transformation series into a single displacement field on the geometry before resampling",cmd,false);
+    TCLAP::ValueArg<std::string> cacheDirArg("","cache-dir","Directory where baked transformations are cached (requires --bake)",false,"","cache directory",cmd);
     
     TCLAP::ValueArg<unsigned int> nbpArg("p","numberofthreads","Number of threads to run on (default: all cores)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
     
@@ -81,11 +83,41 @@ int main(int ac, const char** av)
     imageIO->SetFileName(geomArg.getValue());
     imageIO->ReadImageInformation();
 
+    ImageType::DirectionType directionMatrix;
+    ImageType::PointType origin;
+    ImageType::SpacingType spacing;
+    ImageType::RegionType largestRegion;
+
+    for (unsigned int i = 0;i < Dimension;++i)
+    {
+        origin[i] = imageIO->GetOrigin(i);
+        spacing[i] = imageIO->GetSpacing(i);
+        largestRegion.SetIndex(i,0);
+        largestRegion.SetSize(i,imageIO->GetDimensions(i));
+
+        for (unsigned int j = 0;j < Dimension;++j)
+            directionMatrix(i,j) = imageIO->GetDirection(j)[i];
+    }
+
     TransformSeriesReaderType *trReader = new TransformSeriesReaderType;
     trReader->SetInput(trArg.getValue());
     trReader->SetExponentiationOrder(expOrderArg.getValue());
     trReader->SetNumberOfWorkUnits(nbpArg.getValue());
     trReader->SetInvertTransform(invertArg.isSet());
+    trReader->SetFuseLinearTransforms(true);
+
+    if (bakeArg.isSet())
+    {
+        typedef TransformSeriesReaderType::GeometryImageType GeometryImageType;
+        GeometryImageType::Pointer geometryImage = GeometryImageType::New();
+        geometryImage->SetRegions(largestRegion);
+        geometryImage->SetOrigin(origin);
+        geometryImage->SetSpacing(spacing);
+        geometryImage->SetDirection(directionMatrix);
+
+        trReader->SetBakingGeometry(geometryImage);
+        trReader->SetCacheDirectory(cacheDirArg.getValue());
+    }
     
     try
     {
@@ -165,22 +197,6 @@ int main(int ac, const char** av)
     resample->SetInterpolator(interpolator.GetPointer());
     resample->SetNumberOfWorkUnits(nbpArg.getValue());
 
-    ImageType::DirectionType directionMatrix;
-    ImageType::PointType origin;
-    ImageType::SpacingType spacing;
-    ImageType::RegionType largestRegion;
-
-    for (unsigned int i = 0;i < Dimension;++i)
-    {
-        origin[i] = imageIO->GetOrigin(i);
-        spacing[i] = imageIO->GetSpacing(i);
-        largestRegion.SetIndex(i,0);
-        largestRegion.SetSize(i,imageIO->GetDimensions(i));
-
-        for (unsigned int j = 0;j < Dimension;++j)
-            directionMatrix(i,j) = imageIO->GetDirection(j)[i];
-    }
-
     resample->SetOutputLargestPossibleRegion(largestRegion);
     resample->SetOutputOrigin(origin);
     resample->SetOutputSpacing(spacing);
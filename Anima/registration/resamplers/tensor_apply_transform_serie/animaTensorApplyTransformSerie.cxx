@@ -11,6 +11,118 @@
 #include <animaLogTensorImageFilter.h>
 #include <animaExpTensorImageFilter.h>
 
+struct arguments
+{
+    bool ppd, nearest;
+    unsigned int pthread;
+    std::string input, output;
+};
+
+const unsigned int Dimension = 3;
+typedef double PixelType;
+typedef anima::TransformSeriesReader <double, Dimension> TransformSeriesReaderType;
+typedef TransformSeriesReaderType::OutputTransformType TransformType;
+
+/**
+ * Log, resample and exp pipeline. ImageType is an image of fixed length vectors for 3D tensors, so that pixels are
+ * never allocated, or a vector image for other component numbers.
+ */
+template <class ImageType>
+void
+applyTensorTransformSerie(const arguments &args, TransformType *trsf, itk::ImageIOBase::Pointer geometryIO)
+{
+    typedef itk::ImageFileReader <ImageType> ReaderType;
+    typedef itk::ImageFileWriter <ImageType> WriterType;
+
+    typename ReaderType::Pointer reader = ReaderType::New();
+    reader->SetFileName(args.input);
+    reader->Update();
+
+    typename itk::InterpolateImageFunction <ImageType>::Pointer interpolator;
+
+    if (args.nearest)
+        interpolator = itk::NearestNeighborInterpolateImageFunction<ImageType>::New();
+    else
+        interpolator = anima::VectorModelLinearInterpolateImageFunction<ImageType>::New();
+
+    typedef anima::TensorResampleImageFilter <ImageType, double> ResampleFilterType;
+
+    typename ResampleFilterType::Pointer resample = ResampleFilterType::New();
+
+    resample->SetTransform(trsf);
+    resample->SetFiniteStrainReorientation(!args.ppd);
+    resample->SetInterpolator(interpolator.GetPointer());
+    resample->SetNumberOfWorkUnits(args.pthread);
+
+    typename ImageType::DirectionType directionMatrix;
+    typename ImageType::PointType origin;
+    typename ImageType::SpacingType spacing;
+    typename ImageType::RegionType largestRegion;
+
+    for (unsigned int i = 0;i < Dimension;++i)
+    {
+        origin[i] = geometryIO->GetOrigin(i);
+        spacing[i] = geometryIO->GetSpacing(i);
+        largestRegion.SetIndex(i,0);
+        largestRegion.SetSize(i,geometryIO->GetDimensions(i));
+
+        for (unsigned int j = 0;j < Dimension;++j)
+            directionMatrix(i,j) = geometryIO->GetDirection(j)[i];
+    }
+
+    resample->SetOutputLargestPossibleRegion(largestRegion);
+    resample->SetOutputOrigin(origin);
+    resample->SetOutputSpacing(spacing);
+    resample->SetOutputDirection(directionMatrix);
+
+    typedef anima::LogTensorImageFilter <PixelType,Dimension,ImageType> LogTensorFilterType;
+    typename LogTensorFilterType::Pointer tensorLogger = LogTensorFilterType::New();
+
+    tensorLogger->SetInput(reader->GetOutput());
+    tensorLogger->SetScaleNonDiagonal(true);
+    tensorLogger->SetNumberOfWorkUnits(args.pthread);
+
+    std::cout << "Logging input... " << std::flush;
+    tensorLogger->Update();
+    std::cout << "Done..." << std::endl;
+
+    typename ImageType::Pointer tmpImage = tensorLogger->GetOutput();
+    tmpImage->DisconnectPipeline();
+
+    resample->SetInput(tmpImage);
+
+    std::cout << "Applying transform... " << std::flush;
+    resample->Update();
+    std::cout << "Done..." << std::endl;
+
+    tmpImage = resample->GetOutput();
+    tmpImage->DisconnectPipeline();
+
+    typedef anima::ExpTensorImageFilter <PixelType,Dimension,ImageType> ExpTensorFilterType;
+    typename ExpTensorFilterType::Pointer tensorExper = ExpTensorFilterType::New();
+
+    tensorExper->SetInput(tmpImage);
+    tensorExper->SetScaleNonDiagonal(true);
+    tensorExper->SetNumberOfWorkUnits(args.pthread);
+
+    std::cout << "Exping output... " << std::flush;
+    tensorExper->Update();
+    std::cout << "Done..." << std::endl;
+
+    typename WriterType::Pointer writer = WriterType::New();
+
+    writer->SetUseCompression(true);
+
+    tmpImage = tensorExper->GetOutput();
+    tmpImage->DisconnectPipeline();
+
+    writer->SetInput(tmpImage);
+
+    writer->SetFileName(args.output);
+
+    writer->Update();
+}
+
 int main(int ac, const char** av)
 {
     std::string descriptionMessage;
@@ -51,19 +163,12 @@ int main(int ac, const char** av)
         return EXIT_FAILURE;
     }
 
-    const    unsigned int    Dimension = 3;
-    typedef  double           PixelType;
-
-    typedef itk::VectorImage< PixelType, Dimension >  ImageType;
-    typedef anima::TransformSeriesReader <double, Dimension> TransformSeriesReaderType;
-    typedef TransformSeriesReaderType::OutputTransformType TransformType;
-
-    typedef itk::ImageFileReader <ImageType> ReaderType;
-    typedef itk::ImageFileWriter <ImageType> WriterType;
-
-    ReaderType::Pointer reader = ReaderType::New();
-    reader->SetFileName(inArg.getValue());
-    reader->Update();
+    arguments args;
+    args.ppd = ppdArg.isSet();
+    args.nearest = nearestArg.isSet();
+    args.pthread = nbpArg.getValue();
+    args.input = inArg.getValue();
+    args.output = outArg.getValue();
 
     itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(geomArg.getValue().c_str(),
                                                                            itk::IOFileModeEnum::ReadMode);
@@ -78,6 +183,19 @@ int main(int ac, const char** av)
     imageIO->SetFileName(geomArg.getValue());
     imageIO->ReadImageInformation();
 
+    // Number of components of the input selects the fixed length pixel path (3D tensors) or the vector image one
+    itk::ImageIOBase::Pointer inputIO = itk::ImageIOFactory::CreateImageIO(args.input.c_str(),
+                                                                           itk::IOFileModeEnum::ReadMode);
+
+    if( !inputIO )
+    {
+        std::cerr << "Itk could not find suitable IO factory for the input" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    inputIO->SetFileName(args.input);
+    inputIO->ReadImageInformation();
+
     TransformSeriesReaderType *trReader = new TransformSeriesReaderType;
     trReader->SetInput(trArg.getValue());
     trReader->SetInvertTransform(invertArg.isSet());
@@ -96,89 +214,19 @@ int main(int ac, const char** av)
 
     TransformType::Pointer trsf = trReader->GetOutputTransform();
 
-    itk::InterpolateImageFunction <ImageType>::Pointer interpolator;
-
-    if (nearestArg.isSet())
-        interpolator = itk::NearestNeighborInterpolateImageFunction<ImageType>::New();
-    else
-        interpolator = anima::VectorModelLinearInterpolateImageFunction<ImageType>::New();
-
-    typedef anima::TensorResampleImageFilter <ImageType, double> ResampleFilterType;
-
-    ResampleFilterType::Pointer resample = ResampleFilterType::New();
-
-    resample->SetTransform(trsf);
-    resample->SetFiniteStrainReorientation(!ppdArg.isSet());
-    resample->SetInterpolator(interpolator.GetPointer());
-    resample->SetNumberOfWorkUnits(nbpArg.getValue());
-
-    ImageType::DirectionType directionMatrix;
-    ImageType::PointType origin;
-    ImageType::SpacingType spacing;
-    ImageType::RegionType largestRegion;
-
-    for (unsigned int i = 0;i < Dimension;++i)
+    try
     {
-        origin[i] = imageIO->GetOrigin(i);
-        spacing[i] = imageIO->GetSpacing(i);
-        largestRegion.SetIndex(i,0);
-        largestRegion.SetSize(i,imageIO->GetDimensions(i));
-
-        for (unsigned int j = 0;j < Dimension;++j)
-            directionMatrix(i,j) = imageIO->GetDirection(j)[i];
+        const unsigned int tensorVectorSize = Dimension * (Dimension + 1) / 2;
+        if (inputIO->GetNumberOfComponents() == tensorVectorSize)
+            applyTensorTransformSerie < itk::Image < itk::Vector <PixelType,tensorVectorSize>, Dimension> > (args,trsf,imageIO);
+        else
+            applyTensorTransformSerie < itk::VectorImage <PixelType,Dimension> > (args,trsf,imageIO);
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        std::cerr << e << std::endl;
+        return EXIT_FAILURE;
     }
-
-    resample->SetOutputLargestPossibleRegion(largestRegion);
-    resample->SetOutputOrigin(origin);
-    resample->SetOutputSpacing(spacing);
-    resample->SetOutputDirection(directionMatrix);
-
-    typedef anima::LogTensorImageFilter <PixelType,Dimension> LogTensorFilterType;
-    LogTensorFilterType::Pointer tensorLogger = LogTensorFilterType::New();
-
-    tensorLogger->SetInput(reader->GetOutput());
-    tensorLogger->SetScaleNonDiagonal(true);
-    tensorLogger->SetNumberOfWorkUnits(nbpArg.getValue());
-
-    std::cout << "Logging input... " << std::flush;
-    tensorLogger->Update();
-    std::cout << "Done..." << std::endl;
-
-    ImageType::Pointer tmpImage = tensorLogger->GetOutput();
-    tmpImage->DisconnectPipeline();
-
-    resample->SetInput(tmpImage);
-
-    std::cout << "Applying transform... " << std::flush;
-    resample->Update();
-    std::cout << "Done..." << std::endl;
-
-    tmpImage = resample->GetOutput();
-    tmpImage->DisconnectPipeline();
-
-    typedef anima::ExpTensorImageFilter <PixelType,Dimension> ExpTensorFilterType;
-    ExpTensorFilterType::Pointer tensorExper = ExpTensorFilterType::New();
-
-    tensorExper->SetInput(tmpImage);
-    tensorExper->SetScaleNonDiagonal(true);
-    tensorExper->SetNumberOfWorkUnits(nbpArg.getValue());
-
-    std::cout << "Exping output... " << std::flush;
-    tensorExper->Update();
-    std::cout << "Done..." << std::endl;
-
-    WriterType::Pointer writer = WriterType::New();
-
-    writer->SetUseCompression(true);
-
-    tmpImage = tensorExper->GetOutput();
-    tmpImage->DisconnectPipeline();
-
-    writer->SetInput(tmpImage);
-
-    writer->SetFileName(outArg.getValue());
-
-    writer->Update();
 
     return EXIT_SUCCESS;
 }
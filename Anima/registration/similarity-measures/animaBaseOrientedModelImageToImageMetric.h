@@ -7,6 +7,8 @@
 #include <itkMacro.h>
 #include <itkSpatialObject.h>
 
+#include <animaVectorModelLinearInterpolateImageFunction.h>
+
 namespace anima
 {
 template <class TFixedImage,  class TMovingImage>
@@ -57,6 +59,9 @@ public:
     CoordinateRepresentationType > InterpolatorType;
 
     typedef typename InterpolatorType::Pointer         InterpolatorPointer;
+    typedef typename InterpolatorType::ContinuousIndexType InterpolatorContinuousIndexType;
+
+    typedef anima::VectorModelLinearInterpolateImageFunction <MovingImageType, CoordinateRepresentationType> VectorModelInterpolatorType;
 
     /**  Type for the mask of the fixed image. Only pixels that are "inside"
      this mask will be considered for the computation of the metric */
@@ -102,8 +107,16 @@ public:
     /** Get a pointer to the Transform.  */
     itkGetConstObjectMacro( Transform, TransformType )
 
-    /** Connect the Interpolator. */
-    itkSetObjectMacro( Interpolator, InterpolatorType )
+    /** Connect the Interpolator. Vector model interpolators are also kept with their type for allocation free evaluation */
+    virtual void SetInterpolator(InterpolatorType *interpolator)
+    {
+        if (m_Interpolator == interpolator)
+            return;
+
+        m_Interpolator = interpolator;
+        m_VectorModelInterpolator = dynamic_cast <VectorModelInterpolatorType *> (interpolator);
+        this->Modified();
+    }
 
     /** Get a pointer to the Interpolator.  */
     itkGetConstObjectMacro( Interpolator, InterpolatorType )
@@ -166,6 +179,9 @@ protected:
     virtual ~BaseOrientedModelImageToImageMetric();
     void PrintSelf(std::ostream& os, itk::Indent indent) const ITK_OVERRIDE;
 
+    //! Interpolates the moving image at index in value, sized to the moving image number of components only if needed
+    void InterpolateMovingValue(const InterpolatorContinuousIndexType &index, MovingImagePixelType &value) const;
+
     mutable unsigned long       m_NumberOfPixelsCounted;
 
     FixedImageConstPointer      m_FixedImage;
@@ -174,6 +190,8 @@ protected:
     mutable TransformPointer    m_Transform;
     mutable vnl_matrix <double> m_OrientationMatrix;
     InterpolatorPointer         m_Interpolator;
+    //! Typed pointer to m_Interpolator when it is a vector model interpolator, null otherwise
+    VectorModelInterpolatorType *m_VectorModelInterpolator;
 
     FixedImageMaskConstPointer  m_FixedImageMask;
     MovingImageMaskConstPointer m_MovingImageMask;
@@ -17,6 +17,7 @@ BaseOrientedModelImageToImageMetric<TFixedImage,TMovingImage>
     m_MovingImage   = 0; // has to be provided by the user.
     m_Transform     = 0; // has to be provided by the user.
     m_Interpolator  = 0; // has to be provided by the user.
+    m_VectorModelInterpolator = 0;
     m_NumberOfPixelsCounted = 0; // initialize to zero
 
     m_ModelRotation = FINITE_STRAIN;
@@ -126,6 +127,24 @@ BaseOrientedModelImageToImageMetric<TFixedImage,TMovingImage>
 }
 
 
+template <class TFixedImage, class TMovingImage>
+void
+BaseOrientedModelImageToImageMetric<TFixedImage,TMovingImage>
+::InterpolateMovingValue(const InterpolatorContinuousIndexType &index, MovingImagePixelType &value) const
+{
+    if (!m_VectorModelInterpolator)
+    {
+        value = m_Interpolator->EvaluateAtContinuousIndex(index);
+        return;
+    }
+
+    unsigned int vectorSize = m_Interpolator->GetInputImage()->GetNumberOfComponentsPerPixel();
+    if (value.GetSize() != vectorSize)
+        value.SetSize(vectorSize);
+
+    m_VectorModelInterpolator->EvaluateAtContinuousIndexInBuffer(index,value.GetDataPointer());
+}
+
 /**
  * PrintSelf
  */
@@ -3,6 +3,7 @@
 #include <itkImageToImageMetric.h>
 #include <itkCovariantVector.h>
 #include <itkPoint.h>
+#include <animaFixedRegionValues.h>
 
 
 namespace anima
@@ -36,6 +37,7 @@ public:
     typedef typename Superclass::OutputPointType          OutputPointType;
     typedef typename Superclass::InputPointType           InputPointType;
     typedef typename itk::ContinuousIndex <double,TFixedImage::ImageDimension> ContinuousIndexType;
+    typedef anima::FixedRegionValues <TFixedImage::ImageDimension> FixedRegionValuesType;
 
     typedef typename Superclass::MeasureType              MeasureType;
     typedef typename Superclass::DerivativeType           DerivativeType;
@@ -57,6 +59,10 @@ public:
                                MeasureType& Value, DerivativeType& Derivative) const ITK_OVERRIDE;
 
     void PreComputeFixedValues();
+
+    //! Uses fixed values computed beforehand on the fixed image region, not copied: they must outlive the metric evaluations
+    void SetPreComputedFixedValues(const FixedRegionValuesType *values);
+
     itkSetMacro(SquaredCorrelation, bool)
     itkSetMacro(ScaleIntensities, bool)
     itkSetMacro(DefaultBackgroundValue, double)
@@ -69,15 +75,12 @@ protected:
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(FastCorrelationImageToImageMetric);
 
-    RealType m_SumFixed;
-    RealType m_VarFixed;
-
     bool m_SquaredCorrelation;
     bool m_ScaleIntensities;
     double m_DefaultBackgroundValue;
 
-    std::vector <InputPointType> m_FixedImagePoints;
-    std::vector <RealType> m_FixedImageValues;
+    FixedRegionValuesType m_FixedValues;
+    const FixedRegionValuesType *m_UsedFixedValues;
 };
 
 } // end of namespace anima
@@ -1,8 +1,6 @@
 #pragma once
 #include "animaFastCorrelationImageToImageMetric.h"
 
-#include <itkImageRegionConstIteratorWithIndex.h>
-
 namespace anima
 {
 
@@ -10,13 +8,12 @@ template <class TFixedImage, class TMovingImage>
 FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
 ::FastCorrelationImageToImageMetric()
 {
-    m_SumFixed = 0;
-    m_VarFixed = 0;
     m_DefaultBackgroundValue = 0.0;
     m_SquaredCorrelation = true;
     m_ScaleIntensities = false;
-    m_FixedImagePoints.clear();
-    m_FixedImageValues.clear();
+    m_FixedValues.Sum = 0;
+    m_FixedValues.Variance = 0;
+    m_UsedFixedValues = &m_FixedValues;
 }
 
 template <class TFixedImage, class TMovingImage>
@@ -44,10 +41,11 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
     RealType movingValue;
+    const FixedRegionValuesType &fixedValues = *m_UsedFixedValues;
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
-        transformedPoint = this->m_Transform->TransformPoint(m_FixedImagePoints[i]);
+        transformedPoint = this->m_Transform->TransformPoint(fixedValues.Points[i]);
         this->m_Interpolator->GetInputImage()->TransformPhysicalPointToContinuousIndex(transformedPoint,transformedIndex);
 
         movingValue = m_DefaultBackgroundValue;
@@ -67,7 +65,7 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
             }
 
             smm += movingValue * movingValue;
-            sfm += m_FixedImageValues[i] * movingValue;
+            sfm += fixedValues.Values[i] * movingValue;
             sm += movingValue;
         }
     }
@@ -76,8 +74,8 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
     if (movingVariance <= 0)
         return 0;
 
-    RealType covData = sfm - m_SumFixed * sm / this->m_NumberOfPixelsCounted;
-    RealType multVars = m_VarFixed * movingVariance;
+    RealType covData = sfm - fixedValues.Sum * sm / this->m_NumberOfPixelsCounted;
+    RealType multVars = fixedValues.Variance * movingVariance;
 
     if (this->m_NumberOfPixelsCounted > 1 && multVars > 0)
     {
@@ -106,41 +104,21 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
         itkExceptionMacro( << "Fixed image has not been assigned" );
     }
 
-    m_SumFixed = 0;
-    m_VarFixed = 0;
-    RealType sumSquared = 0;
-
-    typedef itk::ImageRegionConstIteratorWithIndex<FixedImageType> FixedIteratorType;
-
-    FixedIteratorType ti( fixedImage, this->GetFixedImageRegion() );
-    typename FixedImageType::IndexType index;
-
-    this->m_NumberOfPixelsCounted = this->GetFixedImageRegion().GetNumberOfPixels();
-
-    m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
-
-    InputPointType inputPoint;
-
-    unsigned int pos = 0;
-    RealType fixedValue;
-    while(!ti.IsAtEnd())
-    {
-        index = ti.GetIndex();
-        fixedImage->TransformIndexToPhysicalPoint( index, inputPoint );
-
-        m_FixedImagePoints[pos] = inputPoint;
-        fixedValue = ti.Value();
-        m_FixedImageValues[pos] = fixedValue;
-
-        sumSquared += fixedValue * fixedValue;
-        m_SumFixed += fixedValue;
+    anima::ComputeFixedRegionValues <FixedImageType> (fixedImage.GetPointer(),this->GetFixedImageRegion(),m_FixedValues);
+    m_UsedFixedValues = &m_FixedValues;
+    this->m_NumberOfPixelsCounted = m_FixedValues.Values.size();
+}
 
-        ++ti;
-        ++pos;
-    }
+template < class TFixedImage, class TMovingImage>
+void
+FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
+::SetPreComputedFixedValues(const FixedRegionValuesType *values)
+{
+    if (values->Values.size() != this->GetFixedImageRegion().GetNumberOfPixels())
+        itkExceptionMacro("Number of precomputed fixed values does not match the fixed image region");
 
-    m_VarFixed = sumSquared - m_SumFixed * m_SumFixed / this->m_NumberOfPixelsCounted;
+    m_UsedFixedValues = values;
+    this->m_NumberOfPixelsCounted = values->Values.size();
 }
 
 template < class TFixedImage, class TMovingImage>
@@ -167,7 +145,7 @@ FastCorrelationImageToImageMetric<TFixedImage,TMovingImage>
 ::PrintSelf(std::ostream& os, itk::Indent indent) const
 {
     Superclass::PrintSelf(os, indent);
-    os << indent << m_SumFixed << " " << m_VarFixed << std::endl;
+    os << indent << m_UsedFixedValues->Sum << " " << m_UsedFixedValues->Variance << std::endl;
 }
 
 } // end of namespace anima
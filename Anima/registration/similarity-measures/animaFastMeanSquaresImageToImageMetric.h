@@ -3,6 +3,7 @@
 #include "itkImageToImageMetric.h"
 #include "itkCovariantVector.h"
 #include "itkPoint.h"
+#include <animaFixedRegionValues.h>
 
 namespace anima
 {
@@ -35,6 +36,7 @@ public:
     typedef typename Superclass::OutputPointType          OutputPointType;
     typedef typename Superclass::InputPointType           InputPointType;
     typedef typename itk::ContinuousIndex <double,TFixedImage::ImageDimension> ContinuousIndexType;
+    typedef anima::FixedRegionValues <TFixedImage::ImageDimension> FixedRegionValuesType;
 
     typedef typename Superclass::MeasureType              MeasureType;
     typedef typename Superclass::DerivativeType           DerivativeType;
@@ -60,6 +62,9 @@ public:
 
     void PreComputeFixedValues();
 
+    //! Uses fixed values computed beforehand on the fixed image region, not copied: they must outlive the metric evaluations
+    void SetPreComputedFixedValues(const FixedRegionValuesType *values);
+
 protected:
     FastMeanSquaresImageToImageMetric();
     virtual ~FastMeanSquaresImageToImageMetric() {}
@@ -71,8 +76,8 @@ private:
     bool m_ScaleIntensities;
     double m_DefaultBackgroundValue;
 
-    std::vector <InputPointType> m_FixedImagePoints;
-    std::vector <RealType> m_FixedImageValues;
+    FixedRegionValuesType m_FixedValues;
+    const FixedRegionValuesType *m_UsedFixedValues;
 };
 
 } // end namespace anima
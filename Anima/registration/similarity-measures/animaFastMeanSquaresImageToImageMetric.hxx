@@ -1,8 +1,6 @@
 #pragma once
 #include "animaFastMeanSquaresImageToImageMetric.h"
 
-#include <itkImageRegionConstIteratorWithIndex.h>
-
 namespace anima
 {
 
@@ -12,6 +10,7 @@ FastMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
 {
     m_ScaleIntensities = false;
     m_DefaultBackgroundValue = 0.0;
+    m_UsedFixedValues = &m_FixedValues;
 }
 
 template <class TFixedImage, class TMovingImage>
@@ -35,10 +34,11 @@ FastMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
     RealType movingValue;
+    const FixedRegionValuesType &fixedValues = *m_UsedFixedValues;
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
-        transformedPoint = this->m_Transform->TransformPoint( m_FixedImagePoints[i] );
+        transformedPoint = this->m_Transform->TransformPoint( fixedValues.Points[i] );
         this->m_Interpolator->GetInputImage()->TransformPhysicalPointToContinuousIndex(transformedPoint,transformedIndex);
 
         movingValue = m_DefaultBackgroundValue;
@@ -58,7 +58,7 @@ FastMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
             }
         }
 
-        measure += (movingValue - m_FixedImageValues[i]) * (movingValue - m_FixedImageValues[i]);
+        measure += (movingValue - fixedValues.Values[i]) * (movingValue - fixedValues.Values[i]);
     }
 
     measure /= this->m_NumberOfPixelsCounted;
@@ -96,35 +96,21 @@ FastMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
         itkExceptionMacro( << "Fixed image has not been assigned" );
     }
 
-    typedef itk::ImageRegionConstIteratorWithIndex<FixedImageType> FixedIteratorType;
-
-    FixedIteratorType ti( fixedImage, this->GetFixedImageRegion() );
-    typename FixedImageType::IndexType index;
-
-    this->m_NumberOfPixelsCounted = this->GetFixedImageRegion().GetSize()[0];
-    for (unsigned int i = 1;i < TFixedImage::GetImageDimension();++i)
-        this->m_NumberOfPixelsCounted *= this->GetFixedImageRegion().GetSize()[i];
-
-    m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
-
-    InputPointType inputPoint;
-
-    unsigned int pos = 0;
-    RealType fixedValue;
-
-    while(!ti.IsAtEnd())
-    {
-        index = ti.GetIndex();
-        fixedImage->TransformIndexToPhysicalPoint( index, inputPoint );
+    anima::ComputeFixedRegionValues <FixedImageType> (fixedImage.GetPointer(),this->GetFixedImageRegion(),m_FixedValues);
+    m_UsedFixedValues = &m_FixedValues;
+    this->m_NumberOfPixelsCounted = m_FixedValues.Values.size();
+}
 
-        m_FixedImagePoints[pos] = inputPoint;
-        fixedValue = ti.Value();
-        m_FixedImageValues[pos] = fixedValue;
+template <class TFixedImage, class TMovingImage>
+void
+FastMeanSquaresImageToImageMetric<TFixedImage,TMovingImage>
+::SetPreComputedFixedValues(const FixedRegionValuesType *values)
+{
+    if (values->Values.size() != this->GetFixedImageRegion().GetNumberOfPixels())
+        itkExceptionMacro("Number of precomputed fixed values does not match the fixed image region");
 
-        ++ti;
-        ++pos;
-    }
+    m_UsedFixedValues = values;
+    this->m_NumberOfPixelsCounted = values->Values.size();
 }
 
 } // end namespace anima
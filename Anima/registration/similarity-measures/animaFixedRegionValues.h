@@ -0,0 +1,57 @@
+#pragma once
+
+#include <itkImageRegionConstIteratorWithIndex.h>
+#include <itkPoint.h>
+
+#include <vector>
+
+namespace anima
+{
+
+/**
+ * Physical points and values of a fixed image region, with the sum and centered sum of squares of its values.
+ * Computed once, they may be shared read-only by metrics working on the same fixed region (see SetPreComputedFixedValues).
+ */
+template <unsigned int ImageDimension>
+struct FixedRegionValues
+{
+    std::vector < itk::Point <double, ImageDimension> > Points;
+    std::vector <double> Values;
+    double Sum;
+    double Variance;
+};
+
+//! Computes fixed region values, in the region iteration order
+template <class ImageType>
+void
+ComputeFixedRegionValues(const ImageType *fixedImage, const typename ImageType::RegionType &region,
+                         FixedRegionValues <ImageType::ImageDimension> &fixedValues)
+{
+    unsigned int numPixels = region.GetNumberOfPixels();
+    fixedValues.Points.resize(numPixels);
+    fixedValues.Values.resize(numPixels);
+    fixedValues.Sum = 0;
+    fixedValues.Variance = 0;
+
+    double sumSquared = 0;
+    typedef itk::ImageRegionConstIteratorWithIndex <ImageType> FixedIteratorType;
+    FixedIteratorType fixedItr(fixedImage, region);
+    unsigned int pos = 0;
+    while (!fixedItr.IsAtEnd())
+    {
+        fixedImage->TransformIndexToPhysicalPoint(fixedItr.GetIndex(), fixedValues.Points[pos]);
+        double fixedValue = fixedItr.Get();
+        fixedValues.Values[pos] = fixedValue;
+
+        sumSquared += fixedValue * fixedValue;
+        fixedValues.Sum += fixedValue;
+
+        ++fixedItr;
+        ++pos;
+    }
+
+    if (numPixels > 0)
+        fixedValues.Variance = sumSquared - fixedValues.Sum * fixedValues.Sum / numPixels;
+}
+
+} // end namespace anima
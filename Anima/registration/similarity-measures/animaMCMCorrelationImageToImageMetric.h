@@ -96,6 +96,12 @@ private:
     PixelType m_ZeroDiffusionVector;
 
     bool m_ForceApproximation;
+    bool m_TensorCompatibility;
+
+    // Moving models pool, created once per block in PreComputeFixedValues and reused by GetValue
+    mutable std::vector <MCModelPointer> m_MovingWorkModels;
+    mutable std::vector <MCModelPointer> m_MovingValues;
+    const MovingImageType *m_MovingWorkModelsImage;
 
     // Lower and upper bounds of Gaussian sigma for smoothing
     double m_LowerBoundGaussianSigma;
@@ -35,6 +35,8 @@ MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
     m_GradientDirections.clear();
 
     m_ForceApproximation = false;
+    m_TensorCompatibility = true;
+    m_MovingWorkModelsImage = nullptr;
 
     m_LowerBoundGaussianSigma = 0;
     m_UpperBoundGaussianSigma = 25;
@@ -87,10 +89,6 @@ MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
 
-    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
-    bool tensorCompatibilityCondition = this->CheckTensorCompatibility();
-
-    std::vector <MCModelPointer> movingValues(this->m_NumberOfPixelsCounted);
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
@@ -103,25 +101,24 @@ MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
 
             if (!isZero(movingValue))
             {
-                MCModelPointer currentMovingValue = movingImage->GetDescriptionModel()->Clone();
-                currentMovingValue->SetModelVector(movingValue);
+                m_MovingWorkModels[i]->SetModelVector(movingValue);
 
                 if (this->GetModelRotation() != Superclass::NONE)
-                    currentMovingValue->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
+                    m_MovingWorkModels[i]->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
 
-                movingValues[i] = currentMovingValue;
+                m_MovingValues[i] = m_MovingWorkModels[i];
             }
             else
-                movingValues[i] = m_ZeroDiffusionModel;
+                m_MovingValues[i] = m_ZeroDiffusionModel;
         }
         else
-            movingValues[i] = m_ZeroDiffusionModel;
+            m_MovingValues[i] = m_ZeroDiffusionModel;
     }
 
-    if (tensorCompatibilityCondition)
-        return this->ComputeTensorBasedMetric(movingValues);
+    if (m_TensorCompatibility)
+        return this->ComputeTensorBasedMetric(m_MovingValues);
 
-    return this->ComputeNonTensorBasedMetric(movingValues);
+    return this->ComputeNonTensorBasedMetric(m_MovingValues);
 }
 
 template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
@@ -363,6 +360,22 @@ MCMCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
     m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
     m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
 
+    m_TensorCompatibility = this->CheckTensorCompatibility();
+
+    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
+    if (m_MovingWorkModelsImage != movingImage)
+        m_MovingWorkModels.clear();
+    m_MovingWorkModelsImage = movingImage;
+
+    unsigned int previousPoolSize = m_MovingWorkModels.size();
+    m_MovingWorkModels.resize(this->m_NumberOfPixelsCounted);
+    m_MovingValues.resize(this->m_NumberOfPixelsCounted);
+    for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
+    {
+        if ((i >= previousPoolSize)||(!m_MovingWorkModels[i]))
+            m_MovingWorkModels[i] = movingImage->GetDescriptionModel()->Clone();
+    }
+
     InputPointType inputPoint;
 
     unsigned int pos = 0;
@@ -81,6 +81,9 @@ private:
     MCML2DistanceComputerPointer m_L2DistanceComputer;
 
     MCModelPointer m_ZeroDiffusionModel;
+
+    //! Work model for moving values, created once per block in PreComputeFixedValues
+    mutable MCModelPointer m_MovingWorkModel;
     PixelType m_ZeroDiffusionVector;
 };
 
@@ -47,9 +47,6 @@ MCMMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
 
-    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
-    MCModelPointer currentMovingValue = movingImage->GetDescriptionModel()->Clone();
-
     double measure = 0;
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
@@ -63,13 +60,13 @@ MCMMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
 
             if (!isZero(movingValue))
             {
-                currentMovingValue->SetModelVector(movingValue);
+                m_MovingWorkModel->SetModelVector(movingValue);
 
                 if (this->GetModelRotation() != Superclass::NONE)
-                    currentMovingValue->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
+                    m_MovingWorkModel->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
 
                 // Now compute actual measure, depends on model compartment types
-                measure += m_L2DistanceComputer->ComputeDistance(m_FixedImageValues[i],currentMovingValue);
+                measure += m_L2DistanceComputer->ComputeDistance(m_FixedImageValues[i],m_MovingWorkModel);
             }
             else
                 measure += m_L2DistanceComputer->ComputeDistance(m_FixedImageValues[i],m_ZeroDiffusionModel);
@@ -115,6 +112,9 @@ MCMMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
     m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
     m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
 
+    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
+    m_MovingWorkModel = movingImage->GetDescriptionModel()->Clone();
+
     InputPointType inputPoint;
 
     unsigned int pos = 0;
@@ -133,10 +133,7 @@ MCMMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,Imag
             m_FixedImageValues[pos]->SetModelVector(fixedValue);
         }
         else
-        {
-            m_FixedImageValues[pos] = m_ZeroDiffusionModel->Clone();
-            m_FixedImageValues[pos]->SetModelVector(m_ZeroDiffusionVector);
-        }
+            m_FixedImageValues[pos] = m_ZeroDiffusionModel;
 
         ++ti;
         ++pos;
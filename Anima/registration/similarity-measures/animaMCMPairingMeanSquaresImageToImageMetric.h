@@ -65,7 +65,15 @@ protected:
     virtual ~MCMPairingMeanSquaresImageToImageMetric() {}
 
     bool CheckTensorCompatibility() const;
-    double ComputeTensorBasedMetricPart(unsigned int index, const MCModelPointer &movingValue) const;
+
+    //! Fills log-tensor vectors and weights of non null compartments of a model into flat arrays, returns their number
+    unsigned int ComputeLogTensorsAndWeights(const MCModelPointer &model, double *logVectors, double *weights) const;
+
+    //! Builds, for every couple (min, max) of compartment numbers, the possible numbers of pairings of each compartment
+    void PreComputePairingPatterns(unsigned int maxNumCompartments);
+
+    double ComputeTensorBasedMetricPart(unsigned int index, const double *movingLogVectors, const double *movingWeights,
+                                        unsigned int movingNumCompartments) const;
     double ComputeNonTensorBasedMetricPart(unsigned int index, const MCModelPointer &movingValue) const;
 
     bool isZero(PixelType &vector) const;
@@ -81,6 +89,30 @@ private:
     std::vector <MCModelPointer> m_FixedImageValues;
 
     bool m_OneToOneMapping;
+    bool m_TensorCompatibility;
+
+    //! Size of log-tensor vector representation
+    static const unsigned int LogVectorSize = 6;
+
+    //! Fixed log-tensors and weights of non null compartments, stored flat, voxel i starting at m_FixedCompartmentStarts[i]
+    std::vector <double> m_FixedLogVectors;
+    std::vector <double> m_FixedWeights;
+    std::vector <unsigned int> m_FixedCompartmentStarts;
+
+    std::vector <double> m_ZeroLogVectors;
+    std::vector <double> m_ZeroWeights;
+    unsigned int m_ZeroNumCompartments;
+
+    //! Pairing patterns indexed by minimal then maximal number of compartments
+    std::vector < std::vector < std::vector < std::vector <unsigned int> > > > m_PairingPatterns;
+    bool m_PairingPatternsOneToOne;
+
+    // Work variables for GetValue, allocated once in PreComputeFixedValues
+    mutable MCModelPointer m_MovingWorkModel;
+    mutable std::vector <double> m_MovingLogVectors;
+    mutable std::vector <double> m_MovingWeights;
+    mutable std::vector <unsigned int> m_CurrentPermutation;
+    mutable vnl_matrix <double> m_WorkLogMatrix;
 
     LECalculatorPointer m_leCalculator;
 };
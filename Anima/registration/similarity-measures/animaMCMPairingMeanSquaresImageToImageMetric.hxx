@@ -5,8 +5,6 @@
 #include <animaMultiCompartmentModelCreator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
 
-#include <boost/math/special_functions/factorials.hpp>
-
 namespace anima
 {
 
@@ -26,7 +24,11 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
     m_ZeroDiffusionVector = m_ZeroDiffusionModel->GetModelVector();
 
     m_OneToOneMapping = false;
+    m_TensorCompatibility = true;
+    m_ZeroNumCompartments = 0;
+    m_PairingPatternsOneToOne = false;
 
+    m_WorkLogMatrix.set_size(3,3);
     m_leCalculator = LECalculatorType::New();
 }
 
@@ -74,50 +76,48 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
 
-    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
-    MCModelPointer currentMovingValue = movingImage->GetDescriptionModel()->Clone();
-
     double measure = 0;
-    bool tensorCompatibilityCondition = this->CheckTensorCompatibility();
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
         transformedPoint = this->m_Transform->TransformPoint( m_FixedImagePoints[i] );
         this->m_Interpolator->GetInputImage()->TransformPhysicalPointToContinuousIndex(transformedPoint,transformedIndex);
 
+        bool zeroMovingValue = true;
         if( this->m_Interpolator->IsInsideBuffer( transformedIndex ) )
         {
             movingValue = this->m_Interpolator->EvaluateAtContinuousIndex( transformedIndex );
 
             if (!isZero(movingValue))
             {
-                currentMovingValue->SetModelVector(movingValue);
+                m_MovingWorkModel->SetModelVector(movingValue);
 
                 if (this->GetModelRotation() != Superclass::NONE)
-                    currentMovingValue->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
+                    m_MovingWorkModel->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
 
-                // Now compute actual measure, depends on model compartment types
-                if (tensorCompatibilityCondition)
-                    measure += this->ComputeTensorBasedMetricPart(i,currentMovingValue);
-                else
-                    measure += this->ComputeNonTensorBasedMetricPart(i,currentMovingValue);
-            }
-            else
-            {
-                if (tensorCompatibilityCondition)
-                    measure += this->ComputeTensorBasedMetricPart(i,m_ZeroDiffusionModel);
-                else
-                    measure += this->ComputeNonTensorBasedMetricPart(i,m_ZeroDiffusionModel);
+                zeroMovingValue = false;
             }
         }
-        else
+
+        // Now compute actual measure, depends on model compartment types
+        if (!m_TensorCompatibility)
         {
-            if (tensorCompatibilityCondition)
-                measure += this->ComputeTensorBasedMetricPart(i,m_ZeroDiffusionModel);
-            else
+            if (zeroMovingValue)
                 measure += this->ComputeNonTensorBasedMetricPart(i,m_ZeroDiffusionModel);
+            else
+                measure += this->ComputeNonTensorBasedMetricPart(i,m_MovingWorkModel);
+
+            continue;
         }
 
+        if (zeroMovingValue)
+            measure += this->ComputeTensorBasedMetricPart(i,m_ZeroLogVectors.data(),m_ZeroWeights.data(),m_ZeroNumCompartments);
+        else
+        {
+            unsigned int movingNumCompartments = this->ComputeLogTensorsAndWeights(m_MovingWorkModel,m_MovingLogVectors.data(),
+                                                                                   m_MovingWeights.data());
+            measure += this->ComputeTensorBasedMetricPart(i,m_MovingLogVectors.data(),m_MovingWeights.data(),movingNumCompartments);
+        }
     }
 
     if (measure <= 0)
@@ -128,61 +128,114 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
 }
 
 template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
-double
+unsigned int
 MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
-::ComputeTensorBasedMetricPart(unsigned int index, const MCModelPointer &movingValue) const
+::ComputeLogTensorsAndWeights(const MCModelPointer &model, double *logVectors, double *weights) const
 {
-    unsigned int fixedNumCompartments = m_FixedImageValues[index]->GetNumberOfCompartments();
-    unsigned int movingNumCompartments = movingValue->GetNumberOfCompartments();
-
-    typedef itk::VariableLengthVector <double> LogVectorType;
-    std::vector <LogVectorType> fixedLogVectors(fixedNumCompartments);
-    std::vector <LogVectorType> movingLogVectors(movingNumCompartments);
-    std::vector <double> fixedWeights(fixedNumCompartments);
-    std::vector <double> movingWeights(movingNumCompartments);
-    vnl_matrix <double> workLogMatrix(3,3);
+    unsigned int numCompartments = model->GetNumberOfCompartments();
+    double sqrt2 = std::sqrt(2.0);
 
     unsigned int pos = 0;
-    for (unsigned int i = 0;i < fixedNumCompartments;++i)
+    for (unsigned int i = 0;i < numCompartments;++i)
     {
-        if (m_FixedImageValues[index]->GetCompartmentWeight(i) == 0)
+        double weight = model->GetCompartmentWeight(i);
+        if (weight == 0)
             continue;
 
-        m_leCalculator->GetTensorLogarithm(m_FixedImageValues[index]->GetCompartment(i)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),
-                                           workLogMatrix);
-        anima::GetVectorRepresentation(workLogMatrix,fixedLogVectors[pos],6,true);
+        m_leCalculator->GetTensorLogarithm(model->GetCompartment(i)->GetDiffusionTensor().GetVnlMatrix().as_ref(),m_WorkLogMatrix);
+
+        double *logVector = logVectors + pos * LogVectorSize;
+        unsigned int k = 0;
+        for (unsigned int j = 0;j < 3;++j)
+        {
+            for (unsigned int l = 0;l <= j;++l)
+            {
+                logVector[k] = m_WorkLogMatrix(j,l);
+                if (j != l)
+                    logVector[k] *= sqrt2;
+                ++k;
+            }
+        }
 
-        fixedWeights[pos] = m_FixedImageValues[index]->GetCompartmentWeight(i);
+        weights[pos] = weight;
         ++pos;
     }
 
-    fixedNumCompartments = pos;
+    return pos;
+}
 
-    if (fixedNumCompartments == 0)
-        return 0;
-    fixedLogVectors.resize(fixedNumCompartments);
-    fixedWeights.resize(fixedNumCompartments);
+template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
+void
+MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
+::PreComputePairingPatterns(unsigned int maxNumCompartments)
+{
+    if ((m_PairingPatterns.size() > maxNumCompartments)&&(m_PairingPatternsOneToOne == m_OneToOneMapping))
+        return;
 
-    pos = 0;
-    for (unsigned int i = 0;i < movingNumCompartments;++i)
+    m_PairingPatternsOneToOne = m_OneToOneMapping;
+    m_PairingPatterns.resize(maxNumCompartments + 1);
+    for (unsigned int minCompartmentsNumber = 1;minCompartmentsNumber <= maxNumCompartments;++minCompartmentsNumber)
     {
-        if (movingValue->GetCompartmentWeight(i) == 0)
-            continue;
+        m_PairingPatterns[minCompartmentsNumber].resize(maxNumCompartments + 1);
+        for (unsigned int maxCompartmentsNumber = minCompartmentsNumber;maxCompartmentsNumber <= maxNumCompartments;++maxCompartmentsNumber)
+        {
+            std::vector < std::vector <unsigned int> > &numPairingsVectors = m_PairingPatterns[minCompartmentsNumber][maxCompartmentsNumber];
+            numPairingsVectors.clear();
+            unsigned int rest = maxCompartmentsNumber - minCompartmentsNumber;
 
-        m_leCalculator->GetTensorLogarithm(movingValue->GetCompartment(i)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),
-                                           workLogMatrix);
-        anima::GetVectorRepresentation(workLogMatrix,movingLogVectors[pos],6,true);
+            if (!m_OneToOneMapping)
+            {
+                std::vector <unsigned int> initialPairingsNumber(maxCompartmentsNumber-1,0);
+                std::vector <unsigned int> pairing(minCompartmentsNumber,1);
+                for (unsigned int i = minCompartmentsNumber-1;i < maxCompartmentsNumber-1;++i)
+                    initialPairingsNumber[i] = 1;
 
-        movingWeights[pos] = movingValue->GetCompartmentWeight(i);
-        ++pos;
+                do
+                {
+                    unsigned int pos = 0;
+                    std::fill(pairing.begin(),pairing.end(),1);
+                    for (unsigned int i = 0;i < maxCompartmentsNumber-1;++i)
+                    {
+                        if (initialPairingsNumber[i] == 0)
+                        {
+                            ++pos;
+                            continue;
+                        }
+
+                        ++pairing[pos];
+                    }
+
+                    numPairingsVectors.push_back(pairing);
+                } while (std::next_permutation(initialPairingsNumber.begin(),initialPairingsNumber.end()));
+            }
+            else
+            {
+                unsigned int numCompartmentUsed = minCompartmentsNumber;
+                if (rest > 0)
+                    ++numCompartmentUsed;
+                std::vector <unsigned int> initialPairingsNumber(numCompartmentUsed,1);
+                if (rest > 0)
+                    initialPairingsNumber[minCompartmentsNumber] = rest;
+                numPairingsVectors.push_back(initialPairingsNumber);
+            }
+        }
     }
+}
 
-    movingNumCompartments = pos;
+template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
+double
+MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
+::ComputeTensorBasedMetricPart(unsigned int index, const double *movingLogVectors, const double *movingWeights,
+                               unsigned int movingNumCompartments) const
+{
+    unsigned int fixedStart = m_FixedCompartmentStarts[index];
+    unsigned int fixedNumCompartments = m_FixedCompartmentStarts[index + 1] - fixedStart;
 
-    if (movingNumCompartments == 0)
+    if ((fixedNumCompartments == 0)||(movingNumCompartments == 0))
         return 0;
-    movingLogVectors.resize(movingNumCompartments);
-    movingWeights.resize(movingNumCompartments);
+
+    const double *fixedLogVectors = m_FixedLogVectors.data() + fixedStart * LogVectorSize;
+    const double *fixedWeights = m_FixedWeights.data() + fixedStart;
 
     double bestMetricValue = -1;
 
@@ -197,64 +250,19 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
     }
 
     unsigned int maxCompartmentsNumber = minCompartmentsNumber + rest;
-    unsigned int totalNumPairingVectors = 1;
-    if (!m_OneToOneMapping)
-        totalNumPairingVectors = boost::math::factorial<double>(maxCompartmentsNumber-1)
-                / (boost::math::factorial<double>(minCompartmentsNumber-1)
-                   * boost::math::factorial<double>(maxCompartmentsNumber - minCompartmentsNumber));
-
-    std::vector < std::vector <unsigned int> > numPairingsVectors(totalNumPairingVectors);
-
-    if (!m_OneToOneMapping)
-    {
-        std::vector <unsigned int> initialPairingsNumber(maxCompartmentsNumber-1,0);
-        std::vector <unsigned int> pairing(minCompartmentsNumber,1);
-        for (unsigned int i = minCompartmentsNumber-1;i < maxCompartmentsNumber-1;++i)
-            initialPairingsNumber[i] = 1;
-
-        unsigned int countVector = 0;
-        do
-        {
-            unsigned int pos = 0;
-            std::fill(pairing.begin(),pairing.end(),1);
-            for (unsigned int i = 0;i < maxCompartmentsNumber-1;++i)
-            {
-                if (initialPairingsNumber[i] == 0)
-                {
-                    ++pos;
-                    continue;
-                }
-
-                ++pairing[pos];
-            }
-
-            numPairingsVectors[countVector] = pairing;
-            ++countVector;
-        } while (std::next_permutation(initialPairingsNumber.begin(),initialPairingsNumber.end()));
-    }
-    else
-    {
-        unsigned int numCompartmentUsed = minCompartmentsNumber;
-        if (rest > 0)
-            ++numCompartmentUsed;
-        std::vector <unsigned int> initialPairingsNumber(numCompartmentUsed,1);
-        if (rest > 0)
-            initialPairingsNumber[minCompartmentsNumber] = rest;
-        numPairingsVectors[0] = initialPairingsNumber;
-    }
+    const std::vector < std::vector <unsigned int> > &numPairingsVectors = m_PairingPatterns[minCompartmentsNumber][maxCompartmentsNumber];
+    unsigned int totalNumPairingVectors = numPairingsVectors.size();
 
     // Loop on all possible numbers of pairings
-    std::vector <unsigned int> currentPermutation(maxCompartmentsNumber);
-
     for (unsigned int l = 0;l < totalNumPairingVectors;++l)
     {
-        currentPermutation.resize(maxCompartmentsNumber);
+        m_CurrentPermutation.resize(maxCompartmentsNumber);
 
-        pos = 0;
+        unsigned int pos = 0;
         for (unsigned int i = 0;i < numPairingsVectors[l].size();++i)
             for (unsigned int j = 0;j < numPairingsVectors[l][i];++j)
             {
-                currentPermutation[pos] = i;
+                m_CurrentPermutation[pos] = i;
                 ++pos;
             }
 
@@ -269,31 +277,34 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
 
                 if (fixedMin)
                 {
-                    firstIndex = currentPermutation[j];
+                    firstIndex = m_CurrentPermutation[j];
                     secondIndex = j;
                 }
                 else
                 {
                     firstIndex = j;
-                    secondIndex = currentPermutation[j];
+                    secondIndex = m_CurrentPermutation[j];
                 }
 
-                if ((firstIndex >= fixedLogVectors.size())||(secondIndex >= movingLogVectors.size()))
+                if ((firstIndex >= fixedNumCompartments)||(secondIndex >= movingNumCompartments))
                     continue;
 
+                const double *fixedLogVector = fixedLogVectors + firstIndex * LogVectorSize;
+                const double *movingLogVector = movingLogVectors + secondIndex * LogVectorSize;
+
                 double dist = 0;
-                for (unsigned int k = 0;k < fixedLogVectors[firstIndex].GetSize();++k)
-                    dist += (fixedLogVectors[firstIndex][k] - movingLogVectors[secondIndex][k]) * (fixedLogVectors[firstIndex][k] - movingLogVectors[secondIndex][k]);
+                for (unsigned int k = 0;k < LogVectorSize;++k)
+                    dist += (fixedLogVector[k] - movingLogVector[k]) * (fixedLogVector[k] - movingLogVector[k]);
 
                 if (!m_OneToOneMapping)
-                    dist /= numPairingsVectors[l][currentPermutation[j]];
+                    dist /= numPairingsVectors[l][m_CurrentPermutation[j]];
 
                 metricValue += fixedWeights[firstIndex] * movingWeights[secondIndex] * dist;
             }
 
             if ((metricValue < bestMetricValue)||(bestMetricValue < 0))
                 bestMetricValue = metricValue;
-        } while(std::next_permutation(currentPermutation.begin(),currentPermutation.end()));
+        } while(std::next_permutation(m_CurrentPermutation.begin(),m_CurrentPermutation.end()));
     }
 
     return bestMetricValue;
@@ -340,11 +351,41 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
     typename FixedImageType::IndexType index;
 
     m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
+    m_TensorCompatibility = this->CheckTensorCompatibility();
+
+    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
+    m_MovingWorkModel = movingImage->GetDescriptionModel()->Clone();
+    unsigned int movingMaxCompartments = m_MovingWorkModel->GetNumberOfCompartments();
+    unsigned int fixedMaxCompartments = fixedImage->GetDescriptionModel()->GetNumberOfCompartments();
+
+    m_MovingLogVectors.resize(movingMaxCompartments * LogVectorSize);
+    m_MovingWeights.resize(movingMaxCompartments);
+
+    unsigned int zeroMaxCompartments = m_ZeroDiffusionModel->GetNumberOfCompartments();
+    m_ZeroLogVectors.resize(zeroMaxCompartments * LogVectorSize);
+    m_ZeroWeights.resize(zeroMaxCompartments);
+    if (m_TensorCompatibility)
+        m_ZeroNumCompartments = this->ComputeLogTensorsAndWeights(m_ZeroDiffusionModel,m_ZeroLogVectors.data(),m_ZeroWeights.data());
+
+    unsigned int maxNumCompartments = std::max(std::max(movingMaxCompartments,fixedMaxCompartments),zeroMaxCompartments);
+    this->PreComputePairingPatterns(maxNumCompartments);
+    m_CurrentPermutation.reserve(maxNumCompartments);
+
+    if (m_TensorCompatibility)
+    {
+        m_FixedImageValues.clear();
+        m_FixedCompartmentStarts.resize(this->m_NumberOfPixelsCounted + 1);
+        m_FixedLogVectors.resize(this->m_NumberOfPixelsCounted * fixedMaxCompartments * LogVectorSize);
+        m_FixedWeights.resize(this->m_NumberOfPixelsCounted * fixedMaxCompartments);
+    }
+    else
+        m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
 
+    MCModelPointer fixedWorkModel = fixedImage->GetDescriptionModel()->Clone();
     InputPointType inputPoint;
 
     unsigned int pos = 0;
+    unsigned int compartmentPos = 0;
     PixelType fixedValue;
     while(!ti.IsAtEnd())
     {
@@ -354,20 +395,41 @@ MCMPairingMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTy
         m_FixedImagePoints[pos] = inputPoint;
         fixedValue = ti.Get();
 
-        if (!isZero(fixedValue))
+        if (m_TensorCompatibility)
         {
-            m_FixedImageValues[pos] = fixedImage->GetDescriptionModel()->Clone();
-            m_FixedImageValues[pos]->SetModelVector(fixedValue);
+            m_FixedCompartmentStarts[pos] = compartmentPos;
+            double *logVectors = m_FixedLogVectors.data() + compartmentPos * LogVectorSize;
+            double *weights = m_FixedWeights.data() + compartmentPos;
+
+            if (!isZero(fixedValue))
+            {
+                fixedWorkModel->SetModelVector(fixedValue);
+                compartmentPos += this->ComputeLogTensorsAndWeights(fixedWorkModel,logVectors,weights);
+            }
+            else
+            {
+                std::copy(m_ZeroLogVectors.begin(),m_ZeroLogVectors.begin() + m_ZeroNumCompartments * LogVectorSize,logVectors);
+                std::copy(m_ZeroWeights.begin(),m_ZeroWeights.begin() + m_ZeroNumCompartments,weights);
+                compartmentPos += m_ZeroNumCompartments;
+            }
         }
         else
         {
-            m_FixedImageValues[pos] = m_ZeroDiffusionModel->Clone();
-            m_FixedImageValues[pos]->SetModelVector(m_ZeroDiffusionVector);
+            if (!isZero(fixedValue))
+            {
+                m_FixedImageValues[pos] = fixedImage->GetDescriptionModel()->Clone();
+                m_FixedImageValues[pos]->SetModelVector(fixedValue);
+            }
+            else
+                m_FixedImageValues[pos] = m_ZeroDiffusionModel;
         }
 
         ++ti;
         ++pos;
     }
+
+    if (m_TensorCompatibility)
+        m_FixedCompartmentStarts[this->m_NumberOfPixelsCounted] = compartmentPos;
 }
 
 } // end namespace anima
@@ -70,8 +70,17 @@ protected:
     virtual ~MTPairingCorrelationImageToImageMetric() {}
 
     bool CheckTensorCompatibility() const;
-    double ComputeMapping(const std::vector < std::vector <double> > &refImageCompartmentWeights, const std::vector < std::vector <PixelType> > &refImageLogTensors,
-                          const std::vector < std::vector <double> > &movingImageCompartmentWeights, const std::vector < std::vector <PixelType> > &movingImageLogTensors) const;
+
+    //! Appends log-tensor vectors and weights of positive weight compartments of a model to flat arrays, returns their number
+    unsigned int ComputeLogTensorsAndWeights(const MCModelPointer &model, double *logVectors, double *weights) const;
+
+    double ComputeMapping(const std::vector <unsigned int> &refCompartmentStarts, const std::vector <double> &refWeights,
+                          const std::vector <double> &refLogVectors, const std::vector <unsigned int> &movingCompartmentStarts,
+                          const std::vector <double> &movingWeights, const std::vector <double> &movingLogVectors) const;
+
+    //! Weighted sum of log-tensor traces over a block
+    double ComputeTraceSum(const std::vector <unsigned int> &compartmentStarts, const std::vector <double> &weights,
+                           const std::vector <double> &logVectors) const;
 
     bool isZero(PixelType &vector) const;
 
@@ -82,9 +91,31 @@ private:
     MCModelPointer m_ZeroDiffusionModel;
 
     std::vector <InputPointType> m_FixedImagePoints;
-    std::vector < std::vector <double> > m_FixedImageCompartmentWeights;
-    std::vector < std::vector <PixelType> > m_FixedImageLogTensors;
     unsigned int m_NumberOfFixedCompartments;
+    bool m_TensorCompatibility;
+
+    //! Size of log-tensor vector representation
+    static const unsigned int LogVectorSize = 6;
+
+    //! Fixed log-tensors and weights stored flat, voxel i compartments starting at m_FixedCompartmentStarts[i]
+    std::vector <unsigned int> m_FixedCompartmentStarts;
+    std::vector <double> m_FixedWeights;
+    std::vector <double> m_FixedLogVectors;
+
+    //! Fixed only parts of the measure, constant over a block
+    double m_FixedMappingValue;
+    double m_FixedTraceSum;
+
+    //! Vector representation used for null voxels
+    double m_ZeroLogVector[LogVectorSize];
+
+    // Work variables for GetValue, allocated once in PreComputeFixedValues
+    mutable MCModelPointer m_MovingWorkModel;
+    mutable std::vector <unsigned int> m_MovingCompartmentStarts;
+    mutable std::vector <double> m_MovingWeights;
+    mutable std::vector <double> m_MovingLogVectors;
+    mutable std::vector <unsigned int> m_CurrentPermutation;
+    mutable vnl_matrix <double> m_WorkLogMatrix;
 
     LECalculatorPointer m_leCalculator;
 };
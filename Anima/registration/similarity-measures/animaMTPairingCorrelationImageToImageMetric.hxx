@@ -5,8 +5,6 @@
 #include <animaMultiCompartmentModelCreator.h>
 #include <itkImageRegionConstIteratorWithIndex.h>
 
-#include <boost/math/special_functions/factorials.hpp>
-
 namespace anima
 {
 
@@ -15,9 +13,10 @@ MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTyp
 ::MTPairingCorrelationImageToImageMetric()
 {
     m_FixedImagePoints.clear();
-    m_FixedImageCompartmentWeights.clear();
-    m_FixedImageLogTensors.clear();
     m_NumberOfFixedCompartments = 1;
+    m_TensorCompatibility = true;
+    m_FixedMappingValue = 0;
+    m_FixedTraceSum = 0;
 
     anima::MultiCompartmentModelCreator mcmCreator;
     mcmCreator.SetNumberOfCompartments(0);
@@ -26,6 +25,12 @@ MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTyp
 
     m_ZeroDiffusionModel = mcmCreator.GetNewMultiCompartmentModel();
 
+    itk::VariableLengthVector <double> zeroVector;
+    anima::GetVectorRepresentation(m_ZeroDiffusionModel->GetCompartment(0)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),zeroVector,LogVectorSize,true);
+    for (unsigned int i = 0;i < LogVectorSize;++i)
+        m_ZeroLogVector[i] = zeroVector[i];
+
+    m_WorkLogMatrix.set_size(3,3);
     m_leCalculator = LECalculatorType::New();
 }
 
@@ -63,8 +68,7 @@ MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTyp
     if( !fixedImage )
         itkExceptionMacro("Fixed image has not been assigned");
 
-    bool tensorCompatibilityCondition = this->CheckTensorCompatibility();
-    if (!tensorCompatibilityCondition)
+    if (!m_TensorCompatibility)
         itkExceptionMacro("Only tensor compatible models handled")
 
     if (this->m_NumberOfPixelsCounted == 0)
@@ -72,106 +76,59 @@ MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTyp
 
     this->SetTransformParameters( parameters );
 
-    PixelType movingValue, workValue;
+    PixelType movingValue;
 
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
 
-    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
-    MCModelPointer currentMovingValue = movingImage->GetDescriptionModel()->Clone();
-
-    std::vector < std::vector <double> > movingImageCompartmentWeights(this->m_NumberOfPixelsCounted);
-    std::vector < std::vector <PixelType> > movingImageLogTensors(this->m_NumberOfPixelsCounted);
-    std::vector <double> tmpWeights;
-    vnl_matrix <double> workLogMatrix(3,3);
-
     // Getting moving values
+    unsigned int compartmentPos = 0;
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
+        m_MovingCompartmentStarts[i] = compartmentPos;
+        double *logVectors = m_MovingLogVectors.data() + compartmentPos * LogVectorSize;
+        double *weights = m_MovingWeights.data() + compartmentPos;
+
         transformedPoint = this->m_Transform->TransformPoint( m_FixedImagePoints[i] );
         this->m_Interpolator->GetInputImage()->TransformPhysicalPointToContinuousIndex(transformedPoint,transformedIndex);
 
+        bool zeroMovingValue = true;
         if( this->m_Interpolator->IsInsideBuffer( transformedIndex ) )
         {
             movingValue = this->m_Interpolator->EvaluateAtContinuousIndex( transformedIndex );
 
             if (!isZero(movingValue))
             {
-                currentMovingValue->SetModelVector(movingValue);
+                m_MovingWorkModel->SetModelVector(movingValue);
                 if (this->GetModelRotation() != Superclass::NONE)
-                    currentMovingValue->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
-
-                tmpWeights = currentMovingValue->GetCompartmentWeights();
-                unsigned int internalCounter = 0;
-                for (unsigned int j = 0;j < currentMovingValue->GetNumberOfCompartments();++j)
-                {
-                    if (tmpWeights[internalCounter] <= 0)
-                        tmpWeights.erase(tmpWeights.begin() + internalCounter);
-                    else
-                    {
-                        ++internalCounter;
-                        m_leCalculator->GetTensorLogarithm(currentMovingValue->GetCompartment(j)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),workLogMatrix);
-                        anima::GetVectorRepresentation(workLogMatrix,workValue,6,true);
-                        movingImageLogTensors[i].push_back(workValue);
-                    }
-                }
+                    m_MovingWorkModel->Reorient(this->m_OrientationMatrix, (this->GetModelRotation() == Superclass::PPD));
 
-                movingImageCompartmentWeights[i] = tmpWeights;
-            }
-            else
-            {
-                movingImageLogTensors[i].resize(1);
-                anima::GetVectorRepresentation(m_ZeroDiffusionModel->GetCompartment(0)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),movingImageLogTensors[i][0],6,true);
-                movingImageCompartmentWeights[i].resize(1);
-                movingImageCompartmentWeights[i][0] = 1.0;
+                compartmentPos += this->ComputeLogTensorsAndWeights(m_MovingWorkModel,logVectors,weights);
+                zeroMovingValue = false;
             }
         }
-        else
+
+        if (zeroMovingValue)
         {
-            movingImageLogTensors[i].resize(1);
-            anima::GetVectorRepresentation(m_ZeroDiffusionModel->GetCompartment(0)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),movingImageLogTensors[i][0],6,true);
-            movingImageCompartmentWeights[i].resize(1);
-            movingImageCompartmentWeights[i][0] = 1.0;
+            std::copy(m_ZeroLogVector,m_ZeroLogVector + LogVectorSize,logVectors);
+            weights[0] = 1.0;
+            ++compartmentPos;
         }
     }
 
-    double mRS = this->ComputeMapping(m_FixedImageCompartmentWeights,m_FixedImageLogTensors,movingImageCompartmentWeights,movingImageLogTensors);
-    double mRR = this->ComputeMapping(m_FixedImageCompartmentWeights,m_FixedImageLogTensors,m_FixedImageCompartmentWeights,m_FixedImageLogTensors);
-    double mSS = this->ComputeMapping(movingImageCompartmentWeights,movingImageLogTensors,movingImageCompartmentWeights,movingImageLogTensors);
-    double mRT = 0;
-    double mST = 0;
-    double numMaxCompartments = std::max(movingImage->GetDescriptionModel()->GetNumberOfCompartments(),m_NumberOfFixedCompartments);
-    double epsilon = std::sqrt(numMaxCompartments / (3.0 * this->m_NumberOfPixelsCounted)) / numMaxCompartments;
-
-    for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
-    {
-        for (unsigned int k = 0;k < m_FixedImageCompartmentWeights[i].size();++k)
-        {
-            double dotProd = 0;
-            for (unsigned int l = 0;l < 3;++l)
-            {
-                unsigned int index = l * (l + 1) / 2 - 1;
-                dotProd += m_FixedImageLogTensors[i][k][index];
-            }
-
-            mRT += m_FixedImageCompartmentWeights[i][k] * dotProd;
-        }
+    m_MovingCompartmentStarts[this->m_NumberOfPixelsCounted] = compartmentPos;
 
-        for (unsigned int k = 0;k < movingImageCompartmentWeights[i].size();++k)
-        {
-            double dotProd = 0;
-            for (unsigned int l = 0;l < 3;++l)
-            {
-                unsigned int index = l * (l + 1) / 2 - 1;
-                dotProd += movingImageLogTensors[i][k][index];
-            }
+    double mRS = this->ComputeMapping(m_FixedCompartmentStarts,m_FixedWeights,m_FixedLogVectors,
+                                      m_MovingCompartmentStarts,m_MovingWeights,m_MovingLogVectors);
+    double mRR = m_FixedMappingValue;
+    double mSS = this->ComputeMapping(m_MovingCompartmentStarts,m_MovingWeights,m_MovingLogVectors,
+                                      m_MovingCompartmentStarts,m_MovingWeights,m_MovingLogVectors);
 
-            mST += movingImageCompartmentWeights[i][k] * dotProd;
-        }
-    }
+    double numMaxCompartments = std::max(m_MovingWorkModel->GetNumberOfCompartments(),m_NumberOfFixedCompartments);
+    double epsilon = std::sqrt(numMaxCompartments / (3.0 * this->m_NumberOfPixelsCounted)) / numMaxCompartments;
 
-    mRT *= epsilon;
-    mST *= epsilon;
+    double mRT = m_FixedTraceSum * epsilon;
+    double mST = this->ComputeTraceSum(m_MovingCompartmentStarts,m_MovingWeights,m_MovingLogVectors) * epsilon;
 
     // Now computing the measure itself, going for some one to one pairing
     double measure = (mRS - mRT * mST) * (mRS - mRT * mST);
@@ -185,19 +142,85 @@ MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTyp
     return measure;
 }
 
+template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
+unsigned int
+MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
+::ComputeLogTensorsAndWeights(const MCModelPointer &model, double *logVectors, double *weights) const
+{
+    unsigned int numCompartments = model->GetNumberOfCompartments();
+    double sqrt2 = std::sqrt(2.0);
+
+    unsigned int pos = 0;
+    for (unsigned int i = 0;i < numCompartments;++i)
+    {
+        double weight = model->GetCompartmentWeight(i);
+        if (weight <= 0)
+            continue;
+
+        m_leCalculator->GetTensorLogarithm(model->GetCompartment(i)->GetDiffusionTensor().GetVnlMatrix().as_ref(),m_WorkLogMatrix);
+
+        double *logVector = logVectors + pos * LogVectorSize;
+        unsigned int k = 0;
+        for (unsigned int j = 0;j < 3;++j)
+        {
+            for (unsigned int l = 0;l <= j;++l)
+            {
+                logVector[k] = m_WorkLogMatrix(j,l);
+                if (j != l)
+                    logVector[k] *= sqrt2;
+                ++k;
+            }
+        }
+
+        weights[pos] = weight;
+        ++pos;
+    }
+
+    return pos;
+}
+
+template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
+double
+MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
+::ComputeTraceSum(const std::vector <unsigned int> &compartmentStarts, const std::vector <double> &weights,
+                  const std::vector <double> &logVectors) const
+{
+    double traceSum = 0;
+    unsigned int numCompartments = compartmentStarts[this->m_NumberOfPixelsCounted];
+
+    for (unsigned int k = 0;k < numCompartments;++k)
+    {
+        // Diagonal terms of the vector representation are at positions 0, 2 and 5
+        double dotProd = 0;
+        for (unsigned int l = 0;l < 3;++l)
+            dotProd += logVectors[k * LogVectorSize + l * (l + 3) / 2];
+
+        traceSum += weights[k] * dotProd;
+    }
+
+    return traceSum;
+}
+
 template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int ImageDimension >
 double
 MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
-::ComputeMapping(const std::vector < std::vector <double> > &refImageCompartmentWeights, const std::vector < std::vector <PixelType> > &refImageLogTensors,
-                 const std::vector < std::vector <double> > &movingImageCompartmentWeights, const std::vector < std::vector <PixelType> > &movingImageLogTensors) const
+::ComputeMapping(const std::vector <unsigned int> &refCompartmentStarts, const std::vector <double> &refWeights,
+                 const std::vector <double> &refLogVectors, const std::vector <unsigned int> &movingCompartmentStarts,
+                 const std::vector <double> &movingWeights, const std::vector <double> &movingLogVectors) const
 {
-    std::vector <unsigned int> currentPermutation;
     double mappingDistanceValue = 0;
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
         double bestValue = 0.0;
-        unsigned int fixedNumCompartments = refImageCompartmentWeights[i].size();
-        unsigned int movingNumCompartments = movingImageCompartmentWeights[i].size();
+        unsigned int fixedStart = refCompartmentStarts[i];
+        unsigned int movingStart = movingCompartmentStarts[i];
+        unsigned int fixedNumCompartments = refCompartmentStarts[i + 1] - fixedStart;
+        unsigned int movingNumCompartments = movingCompartmentStarts[i + 1] - movingStart;
+
+        const double *fixedLogVectors = refLogVectors.data() + fixedStart * LogVectorSize;
+        const double *fixedWeights = refWeights.data() + fixedStart;
+        const double *currentMovingLogVectors = movingLogVectors.data() + movingStart * LogVectorSize;
+        const double *currentMovingWeights = movingWeights.data() + movingStart;
 
         unsigned int minCompartmentsNumber = fixedNumCompartments;
         int rest = movingNumCompartments - minCompartmentsNumber;
@@ -211,9 +234,9 @@ MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTyp
 
         unsigned int maxCompartmentsNumber = minCompartmentsNumber + rest;
 
-        currentPermutation.resize(maxCompartmentsNumber);
+        m_CurrentPermutation.resize(maxCompartmentsNumber);
         for (unsigned int j = 0;j < maxCompartmentsNumber;++j)
-            currentPermutation[j] = j;
+            m_CurrentPermutation[j] = j;
 
         // Test all permutations
         do
@@ -227,29 +250,32 @@ MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTyp
 
                 if (fixedMin)
                 {
-                    firstIndex = currentPermutation[j];
+                    firstIndex = m_CurrentPermutation[j];
                     secondIndex = j;
                 }
                 else
                 {
                     firstIndex = j;
-                    secondIndex = currentPermutation[j];
+                    secondIndex = m_CurrentPermutation[j];
                 }
 
-                if ((firstIndex >= refImageCompartmentWeights[i].size())||(secondIndex >= movingImageCompartmentWeights[i].size()))
+                if ((firstIndex >= fixedNumCompartments)||(secondIndex >= movingNumCompartments))
                     continue;
 
+                const double *fixedLogVector = fixedLogVectors + firstIndex * LogVectorSize;
+                const double *movingLogVector = currentMovingLogVectors + secondIndex * LogVectorSize;
+
                 double dist = 0;
-                for (unsigned int k = 0;k < refImageLogTensors[i][firstIndex].GetSize();++k)
-                    dist += refImageLogTensors[i][firstIndex][k] * movingImageLogTensors[i][secondIndex][k];
+                for (unsigned int k = 0;k < LogVectorSize;++k)
+                    dist += fixedLogVector[k] * movingLogVector[k];
 
-                distValue += refImageCompartmentWeights[i][firstIndex] * movingImageCompartmentWeights[i][secondIndex] * dist;
+                distValue += fixedWeights[firstIndex] * currentMovingWeights[secondIndex] * dist;
             }
 
             if (std::abs(distValue) > std::abs(bestValue))
                 bestValue = distValue;
 
-        } while(std::next_permutation(currentPermutation.begin(),currentPermutation.end()));
+        } while(std::next_permutation(m_CurrentPermutation.begin(),m_CurrentPermutation.end()));
 
         mappingDistanceValue += bestValue;
     }
@@ -289,17 +315,29 @@ MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTyp
     typename FixedImageType::IndexType index;
 
     m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageCompartmentWeights.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageLogTensors.resize(this->m_NumberOfPixelsCounted);
+    m_TensorCompatibility = this->CheckTensorCompatibility();
 
     InputPointType inputPoint;
     MCModelPointer fixedMCM = fixedImage->GetDescriptionModel()->Clone();
     m_NumberOfFixedCompartments = fixedMCM->GetNumberOfCompartments();
 
+    MovingImageType *movingImage = const_cast <MovingImageType *> (this->GetMovingImage());
+    m_MovingWorkModel = movingImage->GetDescriptionModel()->Clone();
+    unsigned int numberOfMovingCompartments = std::max(m_MovingWorkModel->GetNumberOfCompartments(),1U);
+    unsigned int numberOfFixedCompartments = std::max(m_NumberOfFixedCompartments,1U);
+
+    m_FixedCompartmentStarts.resize(this->m_NumberOfPixelsCounted + 1);
+    m_FixedWeights.resize(this->m_NumberOfPixelsCounted * numberOfFixedCompartments);
+    m_FixedLogVectors.resize(this->m_NumberOfPixelsCounted * numberOfFixedCompartments * LogVectorSize);
+
+    m_MovingCompartmentStarts.resize(this->m_NumberOfPixelsCounted + 1);
+    m_MovingWeights.resize(this->m_NumberOfPixelsCounted * numberOfMovingCompartments);
+    m_MovingLogVectors.resize(this->m_NumberOfPixelsCounted * numberOfMovingCompartments * LogVectorSize);
+    m_CurrentPermutation.reserve(std::max(numberOfMovingCompartments,numberOfFixedCompartments));
+
     unsigned int pos = 0;
-    PixelType fixedValue, workValue;
-    std::vector <double> tmpWeights;
-    vnl_matrix <double> workLogMatrix(3,3);
+    unsigned int compartmentPos = 0;
+    PixelType fixedValue;
 
     while(!ti.IsAtEnd())
     {
@@ -309,37 +347,31 @@ MTPairingCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelTyp
         m_FixedImagePoints[pos] = inputPoint;
         fixedValue = ti.Get();
 
-        if (!isZero(fixedValue))
+        m_FixedCompartmentStarts[pos] = compartmentPos;
+        double *logVectors = m_FixedLogVectors.data() + compartmentPos * LogVectorSize;
+        double *weights = m_FixedWeights.data() + compartmentPos;
+
+        if ((!isZero(fixedValue))&&(m_TensorCompatibility))
         {
             fixedMCM->SetModelVector(fixedValue);
-            tmpWeights = fixedMCM->GetCompartmentWeights();
-            unsigned int internalCounter = 0;
-            for (unsigned int i = 0;i < fixedMCM->GetNumberOfCompartments();++i)
-            {
-                if (tmpWeights[internalCounter] <= 0)
-                    tmpWeights.erase(tmpWeights.begin() + internalCounter);
-                else
-                {
-                    ++internalCounter;
-                    m_leCalculator->GetTensorLogarithm(fixedMCM->GetCompartment(i)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),workLogMatrix);
-                    anima::GetVectorRepresentation(workLogMatrix,workValue,6,true);
-                    m_FixedImageLogTensors[pos].push_back(workValue);
-                }
-            }
-
-            m_FixedImageCompartmentWeights[pos] = tmpWeights;
+            compartmentPos += this->ComputeLogTensorsAndWeights(fixedMCM,logVectors,weights);
         }
         else
         {
-            m_FixedImageLogTensors[pos].resize(1);
-            anima::GetVectorRepresentation(m_ZeroDiffusionModel->GetCompartment(0)->GetDiffusionTensor().GetVnlMatrix().as_matrix(),m_FixedImageLogTensors[pos][0],6,true);
-            m_FixedImageCompartmentWeights[pos].resize(1);
-            m_FixedImageCompartmentWeights[pos][0] = 1.0;
+            std::copy(m_ZeroLogVector,m_ZeroLogVector + LogVectorSize,logVectors);
+            weights[0] = 1.0;
+            ++compartmentPos;
         }
 
         ++ti;
         ++pos;
     }
+
+    m_FixedCompartmentStarts[this->m_NumberOfPixelsCounted] = compartmentPos;
+
+    m_FixedMappingValue = this->ComputeMapping(m_FixedCompartmentStarts,m_FixedWeights,m_FixedLogVectors,
+                                               m_FixedCompartmentStarts,m_FixedWeights,m_FixedLogVectors);
+    m_FixedTraceSum = this->ComputeTraceSum(m_FixedCompartmentStarts,m_FixedWeights,m_FixedLogVectors);
 }
 
 } // end namespace anima
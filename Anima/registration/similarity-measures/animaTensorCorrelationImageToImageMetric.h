@@ -70,7 +70,15 @@ private:
     double m_LogEpsilon;
 
     std::vector <InputPointType> m_FixedImagePoints;
-    std::vector <PixelType> m_FixedImageValues;
+
+    //! Fixed tensor values, stored flat (vector size values per voxel)
+    std::vector <double> m_FixedImageValues;
+    unsigned int m_VectorSize;
+
+    // Work matrices for tensor reorientation, allocated once
+    mutable vnl_matrix <double> m_WorkTensor;
+    mutable vnl_matrix <double> m_RotatedTensor;
+    mutable vnl_matrix <double> m_PPDOrientationMatrix;
 };
 
 } // end namespace anima
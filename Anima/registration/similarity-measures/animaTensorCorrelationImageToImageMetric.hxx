@@ -4,6 +4,7 @@
 #include <itkImageRegionConstIteratorWithIndex.h>
 
 #include <animaBaseTensorTools.h>
+#include <animaSymmetricEigen3D.h>
 
 namespace anima
 {
@@ -22,6 +23,11 @@ TensorCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,I
     m_FixedDenominator = 0;
 
     m_LogEpsilon = 0;
+    m_VectorSize = 0;
+
+    m_WorkTensor.set_size(3,3);
+    m_RotatedTensor.set_size(3,3);
+    m_PPDOrientationMatrix.set_size(3,3);
 }
 
 /**
@@ -44,7 +50,7 @@ TensorCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,I
 
     this->SetTransformParameters(parameters);
 
-    unsigned int vectorSize = m_FixedImageValues[0].GetSize();
+    unsigned int vectorSize = m_VectorSize;
     PixelType movingValue;
 
     OutputPointType transformedPoint;
@@ -52,15 +58,11 @@ TensorCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,I
 
     unsigned int tensorDimension = floor((std::sqrt((double)(8 * vectorSize + 1)) - 1) / 2.0);
 
-    vnl_matrix <double> tmpMat(tensorDimension, tensorDimension);
-    vnl_matrix <double> ppdOrientationMatrix(tensorDimension, tensorDimension);
     typedef itk::Matrix <double, 3, 3> EigVecMatrixType;
     typedef vnl_vector_fixed <double,3> EigValVectorType;
-    itk::SymmetricEigenAnalysis < EigVecMatrixType, EigValVectorType, EigVecMatrixType> eigenComputer(3);
     EigVecMatrixType eigVecs;
     EigValVectorType eigVals;
 
-    vnl_matrix <double> currentTensor(tensorDimension, tensorDimension);
     double mST = 0, mRS = 0, mSS = 0;
 
     double movingDenominator = 0;
@@ -74,25 +76,26 @@ TensorCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,I
 
         if( this->m_Interpolator->IsInsideBuffer(transformedIndex))
         {
-            movingValue = this->m_Interpolator->EvaluateAtContinuousIndex(transformedIndex);
+            this->InterpolateMovingValue(transformedIndex,movingValue);
 
             if (this->GetModelRotation() != Superclass::NONE)
             {
                 // Rotating tensor
-                anima::GetTensorFromVectorRepresentation(movingValue,tmpMat,tensorDimension,true);
+                anima::GetTensorFromVectorRepresentation(movingValue,m_WorkTensor,tensorDimension,true);
 
                 if (this->GetModelRotation() == Superclass::FINITE_STRAIN)
-                    anima::RotateSymmetricMatrix(tmpMat,this->m_OrientationMatrix,currentTensor);
+                    anima::RotateSymmetricMatrix(m_WorkTensor,this->m_OrientationMatrix,m_RotatedTensor);
                 else
                 {
-                    eigenComputer.ComputeEigenValuesAndVectors(tmpMat,eigVals,eigVecs);
-                    anima::ExtractPPDRotationFromJacobianMatrix(this->m_OrientationMatrix,ppdOrientationMatrix,eigVecs);
-                    anima::RotateSymmetricMatrix(tmpMat,ppdOrientationMatrix,currentTensor);
+                    anima::ComputeSymmetricEigenSystem3D(m_WorkTensor,eigVals,eigVecs);
+                    anima::ExtractPPDRotationFromJacobianMatrix(this->m_OrientationMatrix,m_PPDOrientationMatrix,eigVecs);
+                    anima::RotateSymmetricMatrix(m_WorkTensor,m_PPDOrientationMatrix,m_RotatedTensor);
                 }
 
-                anima::GetVectorRepresentation(currentTensor,movingValue,vectorSize,true);
+                anima::GetVectorRepresentation(m_RotatedTensor,movingValue,vectorSize,true);
             }
 
+            const double *fixedValues = m_FixedImageValues.data() + i * vectorSize;
             unsigned int pos_internal = 0;
             for (unsigned int j = 0;j < tensorDimension;++j)
                 for (unsigned int k = 0;k <= j;++k)
@@ -100,7 +103,7 @@ TensorCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,I
                     if (i == j)
                         mST += movingValue[pos_internal] * m_LogEpsilon;
 
-                    mRS += m_FixedImageValues[i][pos_internal] * movingValue[pos_internal];
+                    mRS += fixedValues[pos_internal] * movingValue[pos_internal];
                     mSS += movingValue[pos_internal] * movingValue[pos_internal];
 
                     ++pos_internal;
@@ -158,8 +161,9 @@ TensorCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,I
     FixedIteratorType ti(fixedImage, this->GetFixedImageRegion());
     typename FixedImageType::IndexType index;
 
+    m_VectorSize = vectorSize;
     m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
+    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted * vectorSize);
 
     InputPointType inputPoint;
 
@@ -172,7 +176,8 @@ TensorCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,I
 
         m_FixedImagePoints[pos] = inputPoint;
         fixedValue = ti.Get();
-        m_FixedImageValues[pos] = fixedValue;
+        for (unsigned int i = 0;i < vectorSize;++i)
+            m_FixedImageValues[pos * vectorSize + i] = fixedValue[i];
 
         unsigned int pos_internal = 0;
         for (unsigned int i = 0;i < tensorDimension;++i)
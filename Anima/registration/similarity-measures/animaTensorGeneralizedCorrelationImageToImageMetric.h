@@ -77,7 +77,16 @@ private:
     CovarianceType m_FixedHalfInvCovarianceMatrix;
 
     std::vector <InputPointType> m_FixedImagePoints;
-    std::vector <PixelType> m_FixedImageValues;
+
+    //! Fixed values minus their mean, stored flat (vector size values per voxel)
+    std::vector <double> m_CenteredFixedValues;
+
+    // Work variables for GetValue, allocated once in PreComputeFixedValues
+    mutable std::vector <double> m_MovingValues;
+    mutable PixelType m_MovingValue;
+    mutable PixelType m_MovingMean;
+    mutable vnl_matrix <double> m_SigmaXY, m_SigmaYY, m_WorkProduct, m_WorkMatrix;
+    mutable vnl_matrix <double> m_WorkTensor, m_RotatedTensor, m_PPDOrientationMatrix;
 
     LECalculatorPointer m_leCalculator;
 };
@@ -2,7 +2,7 @@
 #include "animaTensorGeneralizedCorrelationImageToImageMetric.h"
 
 #include <itkImageRegionConstIteratorWithIndex.h>
-#include <itkSymmetricEigenAnalysis.h>
+#include <animaSymmetricEigen3D.h>
 
 namespace anima
 {
@@ -18,7 +18,11 @@ TensorGeneralizedCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImage
     m_VarianceThreshold = 0.000001;
 
     m_FixedImagePoints.clear();
-    m_FixedImageValues.clear();
+    m_CenteredFixedValues.clear();
+
+    m_WorkTensor.set_size(3,3);
+    m_RotatedTensor.set_size(3,3);
+    m_PPDOrientationMatrix.set_size(3,3);
 
     m_leCalculator = LECalculatorType::New();
 }
@@ -44,66 +48,64 @@ TensorGeneralizedCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImage
 
     unsigned int vectorSize = m_FixedMean.GetSize();
 
-    vnl_matrix <double> Sigma_YY(vectorSize,vectorSize);
+    vnl_matrix <double> &Sigma_YY = m_SigmaYY;
     Sigma_YY.fill(0);
 
-    vnl_matrix <double> Sigma_XY(vectorSize,vectorSize);
+    vnl_matrix <double> &Sigma_XY = m_SigmaXY;
     Sigma_XY.fill(0);
 
-    PixelType movingMean(vectorSize);
+    PixelType &movingMean = m_MovingMean;
     movingMean.Fill(0);
 
     OutputPointType transformedPoint;
     ContinuousIndexType transformedIndex;
 
     unsigned int tensorDimension = 3;
-    vnl_matrix <double> tmpMat(tensorDimension, tensorDimension);
-    vnl_matrix <double> currentTensor(tensorDimension, tensorDimension);
-    vnl_matrix <double> ppdOrientationMatrix(tensorDimension, tensorDimension);
     typedef itk::Matrix <double, 3, 3> EigVecMatrixType;
     typedef vnl_vector_fixed <double,3> EigValVectorType;
-    itk::SymmetricEigenAnalysis < EigVecMatrixType, EigValVectorType, EigVecMatrixType> eigenComputer(3);
     EigVecMatrixType eigVecs;
     EigValVectorType eigVals;
 
-    std::vector <PixelType> movingValues(this->m_NumberOfPixelsCounted);
     unsigned int numOutside = 0;
-    PixelType zeroVector(vectorSize);
-    zeroVector.Fill(0.0);
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
         transformedPoint = this->m_Transform->TransformPoint(m_FixedImagePoints[i]);
         movingImage->TransformPhysicalPointToContinuousIndex(transformedPoint,transformedIndex);
 
+        double *movingValues = m_MovingValues.data() + i * vectorSize;
+
         if (this->m_Interpolator->IsInsideBuffer(transformedIndex))
         {
-            movingValues[i] = this->m_Interpolator->EvaluateAtContinuousIndex(transformedIndex);
+            this->InterpolateMovingValue(transformedIndex,m_MovingValue);
 
             if (this->GetModelRotation() != Superclass::NONE)
             {
                 // Rotating tensor
-                anima::GetTensorFromVectorRepresentation(movingValues[i],tmpMat,tensorDimension,true);
+                anima::GetTensorFromVectorRepresentation(m_MovingValue,m_WorkTensor,tensorDimension,true);
 
                 if (this->GetModelRotation() == Superclass::FINITE_STRAIN)
-                    anima::RotateSymmetricMatrix(tmpMat,this->m_OrientationMatrix,currentTensor);
+                    anima::RotateSymmetricMatrix(m_WorkTensor,this->m_OrientationMatrix,m_RotatedTensor);
                 else
                 {
-                    eigenComputer.ComputeEigenValuesAndVectors(tmpMat,eigVals,eigVecs);
-                    anima::ExtractPPDRotationFromJacobianMatrix(this->m_OrientationMatrix,ppdOrientationMatrix,eigVecs);
-                    anima::RotateSymmetricMatrix(tmpMat,ppdOrientationMatrix,currentTensor);
+                    anima::ComputeSymmetricEigenSystem3D(m_WorkTensor,eigVals,eigVecs);
+                    anima::ExtractPPDRotationFromJacobianMatrix(this->m_OrientationMatrix,m_PPDOrientationMatrix,eigVecs);
+                    anima::RotateSymmetricMatrix(m_WorkTensor,m_PPDOrientationMatrix,m_RotatedTensor);
                 }
 
-                anima::GetVectorRepresentation(currentTensor,movingValues[i],vectorSize,true);
+                anima::GetVectorRepresentation(m_RotatedTensor,m_MovingValue,vectorSize,true);
             }
 
             for (unsigned int j = 0;j < vectorSize;++j)
-                movingMean[j] += movingValues[i][j];
+            {
+                movingValues[j] = m_MovingValue[j];
+                movingMean[j] += movingValues[j];
+            }
         }
         else
         {
             ++numOutside;
-            movingValues[i] = zeroVector;
+            std::fill(movingValues,movingValues + vectorSize,0.0);
         }
     }
 
@@ -114,13 +116,19 @@ TensorGeneralizedCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImage
 
     for (unsigned int i = 0;i < this->m_NumberOfPixelsCounted;++i)
     {
+        const double *fixedValues = m_CenteredFixedValues.data() + i * vectorSize;
+        double *movingValues = m_MovingValues.data() + i * vectorSize;
+
+        for (unsigned int j = 0;j < vectorSize;++j)
+            movingValues[j] -= movingMean[j];
+
         for (unsigned int j = 0;j < vectorSize;++j)
         {
             for (unsigned int k = 0;k < vectorSize;++k)
-                Sigma_XY(j,k) += (m_FixedImageValues[i][j] - m_FixedMean[j]) * (movingValues[i][k] - movingMean[k]);
+                Sigma_XY(j,k) += fixedValues[j] * movingValues[k];
 
             for (unsigned int k = j;k < vectorSize;++k)
-                Sigma_YY(j,k) += (movingValues[i][j] - movingMean[j]) * (movingValues[i][k] - movingMean[k]);
+                Sigma_YY(j,k) += movingValues[j] * movingValues[k];
         }
     }
 
@@ -174,13 +182,11 @@ TensorGeneralizedCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImage
         for (unsigned int i = 0;i < vectorSize;++i)
             movingMean[i] /= this->m_NumberOfPixelsCounted;
 
-        itk::SymmetricEigenAnalysis < vnl_matrix <double>, vnl_diag_matrix<double>, vnl_matrix <double> > eigenComputer(tensorDimension);
+        anima::GetTensorFromVectorRepresentation(m_FixedMean,m_WorkMatrix,tensorDimension,true);
+        anima::ComputeSymmetricEigenSystem3D(m_WorkMatrix, tmpEigX, tmpXEVecs);
 
-        anima::GetTensorFromVectorRepresentation(m_FixedMean,tmpMat,tensorDimension,true);
-        eigenComputer.ComputeEigenValuesAndVectors(tmpMat, tmpEigX, tmpXEVecs);
-
-        anima::GetTensorFromVectorRepresentation(movingMean,tmpMat,tensorDimension,true);
-        eigenComputer.ComputeEigenValuesAndVectors(tmpMat, tmpEigY, tmpYEVecs);
+        anima::GetTensorFromVectorRepresentation(movingMean,m_WorkMatrix,tensorDimension,true);
+        anima::ComputeSymmetricEigenSystem3D(m_WorkMatrix, tmpEigY, tmpYEVecs);
 
         for (unsigned int a = 0;a < tensorDimension;++a)
         {
@@ -193,13 +199,30 @@ TensorGeneralizedCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImage
 
     m_leCalculator->GetTensorPower(Sigma_YY,Sigma_YY,-0.5);
 
-    tmpMat = m_FixedHalfInvCovarianceMatrix * Sigma_XY * Sigma_YY;
+    // Product of fixed half inverse covariance, cross-covariance and moving half inverse covariance
+    for (unsigned int i = 0;i < vectorSize;++i)
+    {
+        for (unsigned int j = 0;j < vectorSize;++j)
+        {
+            double sumValue = 0;
+            for (unsigned int k = 0;k < vectorSize;++k)
+                sumValue += m_FixedHalfInvCovarianceMatrix(i,k) * Sigma_XY(k,j);
+
+            m_WorkProduct(i,j) = sumValue;
+        }
+    }
 
     double measure = 0;
 
     for (unsigned int i = 0;i < vectorSize;++i)
         for (unsigned int j = 0;j < vectorSize;++j)
-            measure += tmpMat(i,j)*tmpMat(i,j);
+        {
+            double sumValue = 0;
+            for (unsigned int k = 0;k < vectorSize;++k)
+                sumValue += m_WorkProduct(i,k) * Sigma_YY(k,j);
+
+            measure += sumValue * sumValue;
+        }
 
     double tentativeMeasure = ovlWeight * measure / vectorSize;
     measure = std::min(1.0,std::max(tentativeMeasure,0.0));
@@ -231,7 +254,14 @@ TensorGeneralizedCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImage
     this->m_NumberOfPixelsCounted = this->GetFixedImageRegion().GetNumberOfPixels();
 
     m_FixedImagePoints.resize(this->m_NumberOfPixelsCounted);
-    m_FixedImageValues.resize(this->m_NumberOfPixelsCounted);
+    m_CenteredFixedValues.resize(this->m_NumberOfPixelsCounted * vectorSize);
+
+    m_MovingValues.resize(this->m_NumberOfPixelsCounted * vectorSize);
+    m_MovingValue.SetSize(vectorSize);
+    m_MovingMean.SetSize(vectorSize);
+    m_SigmaXY.set_size(vectorSize,vectorSize);
+    m_SigmaYY.set_size(vectorSize,vectorSize);
+    m_WorkProduct.set_size(vectorSize,vectorSize);
 
     InputPointType inputPoint;
 
@@ -241,10 +271,13 @@ TensorGeneralizedCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImage
         fixedImage->TransformIndexToPhysicalPoint( ti.GetIndex(), inputPoint );
 
         m_FixedImagePoints[pos] = inputPoint;
-        m_FixedImageValues[pos] = ti.Get();
+        const PixelType &fixedValue = ti.Get();
 
         for (unsigned int i = 0;i < vectorSize;++i)
-            m_FixedMean[i] += m_FixedImageValues[pos][i];
+        {
+            m_CenteredFixedValues[pos * vectorSize + i] = fixedValue[i];
+            m_FixedMean[i] += fixedValue[i];
+        }
 
         ++ti;
         ++pos;
@@ -253,10 +286,14 @@ TensorGeneralizedCorrelationImageToImageMetric<TFixedImagePixelType,TMovingImage
     m_FixedMean /= this->m_NumberOfPixelsCounted;
     for (unsigned int k = 0;k < this->m_NumberOfPixelsCounted;++k)
     {
+        double *fixedValues = m_CenteredFixedValues.data() + k * vectorSize;
+        for (unsigned int i = 0;i < vectorSize;++i)
+            fixedValues[i] -= m_FixedMean[i];
+
         for (unsigned int i = 0;i < vectorSize;++i)
         {
             for (unsigned int j = i;j < vectorSize;++j)
-                covarianceMatrix(i,j) += (m_FixedImageValues[k][i] - m_FixedMean[i]) * (m_FixedImageValues[k][j] - m_FixedMean[j]);
+                covarianceMatrix(i,j) += fixedValues[i] * fixedValues[j];
         }
     }
 
@@ -56,6 +56,11 @@ protected:
 private:
     TensorMeanSquaresImageToImageMetric(const Self&); //purposely not implemented
     void operator=(const Self&); //purposely not implemented
+
+    // Work matrices for tensor reorientation, allocated once
+    mutable vnl_matrix <double> m_WorkTensor;
+    mutable vnl_matrix <double> m_RotatedTensor;
+    mutable vnl_matrix <double> m_PPDOrientationMatrix;
 };
 
 } // end namespace anima
@@ -3,6 +3,7 @@
 
 #include <itkImageRegionConstIteratorWithIndex.h>
 #include <animaBaseTensorTools.h>
+#include <animaSymmetricEigen3D.h>
 
 namespace anima
 {
@@ -11,6 +12,9 @@ template < class TFixedImagePixelType, class TMovingImagePixelType, unsigned int
 TensorMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,ImageDimension>
 ::TensorMeanSquaresImageToImageMetric()
 {
+    m_WorkTensor.set_size(3,3);
+    m_RotatedTensor.set_size(3,3);
+    m_PPDOrientationMatrix.set_size(3,3);
 }
 
 /**
@@ -47,12 +51,8 @@ TensorMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,I
     OutputPointType transformedPoint, inputPoint;
 
     unsigned int tensorDimension = 3;
-    vnl_matrix <double> tmpMat(tensorDimension, tensorDimension);
-    vnl_matrix <double> currentTensor(tensorDimension, tensorDimension);
-    vnl_matrix <double> ppdOrientationMatrix(tensorDimension, tensorDimension);
     typedef itk::Matrix <double, 3, 3> EigVecMatrixType;
     typedef vnl_vector_fixed <double,3> EigValVectorType;
-    itk::SymmetricEigenAnalysis < EigVecMatrixType, EigValVectorType, EigVecMatrixType> eigenComputer(3);
     EigVecMatrixType eigVecs;
     EigValVectorType eigVals;
     PixelType movingValue;
@@ -67,23 +67,23 @@ TensorMeanSquaresImageToImageMetric<TFixedImagePixelType,TMovingImagePixelType,I
 
         if( this->m_Interpolator->IsInsideBuffer( transformedIndex ) )
         {
-            movingValue = this->m_Interpolator->EvaluateAtContinuousIndex(transformedIndex);
+            this->InterpolateMovingValue(transformedIndex,movingValue);
 
             if (this->GetModelRotation() != Superclass::NONE)
             {
                 // Rotating tensor
-                anima::GetTensorFromVectorRepresentation(movingValue,tmpMat,tensorDimension,true);
+                anima::GetTensorFromVectorRepresentation(movingValue,m_WorkTensor,tensorDimension,true);
 
                 if (this->GetModelRotation() == Superclass::FINITE_STRAIN)
-                    anima::RotateSymmetricMatrix(tmpMat,this->m_OrientationMatrix,currentTensor);
+                    anima::RotateSymmetricMatrix(m_WorkTensor,this->m_OrientationMatrix,m_RotatedTensor);
                 else
                 {
-                    eigenComputer.ComputeEigenValuesAndVectors(tmpMat,eigVals,eigVecs);
-                    anima::ExtractPPDRotationFromJacobianMatrix(this->m_OrientationMatrix,ppdOrientationMatrix,eigVecs);
-                    anima::RotateSymmetricMatrix(tmpMat,ppdOrientationMatrix,currentTensor);
+                    anima::ComputeSymmetricEigenSystem3D(m_WorkTensor,eigVals,eigVecs);
+                    anima::ExtractPPDRotationFromJacobianMatrix(this->m_OrientationMatrix,m_PPDOrientationMatrix,eigVecs);
+                    anima::RotateSymmetricMatrix(m_WorkTensor,m_PPDOrientationMatrix,m_RotatedTensor);
                 }
 
-                anima::GetVectorRepresentation(currentTensor,movingValue,vectorSize,true);
+                anima::GetVectorRepresentation(m_RotatedTensor,movingValue,vectorSize,true);
             }
         }
         else
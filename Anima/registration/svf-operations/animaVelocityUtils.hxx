@@ -8,6 +8,7 @@
 #include <itkVectorLinearInterpolateNearestNeighborExtrapolateImageFunction.h>
 #include <animaSVFLieBracketImageFilter.h>
 #include <animaSVFExponentialImageFilter.h>
+#include <animaInstrumentation.h>
 
 namespace anima
 {
@@ -212,6 +213,8 @@ void GetSVFExponential(itk::StationaryVelocityFieldTransform <ScalarType,NDimens
     if (baseTrsf->GetParametersAsVectorField() == NULL)
         return;
 
+    ANIMA_INSTRUMENT_SCOPE("svf_exponential");
+
     typedef itk::StationaryVelocityFieldTransform <ScalarType,NDimensions> SVFType;
     typedef typename SVFType::VectorFieldType FieldType;
     typedef typename FieldType::Pointer FieldPointer;
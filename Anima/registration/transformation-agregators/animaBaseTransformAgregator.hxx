@@ -1,6 +1,8 @@
 #pragma once
 #include "animaBaseTransformAgregator.h"
 
+#include <animaInstrumentation.h>
+
 namespace anima
 {
 
@@ -68,7 +70,10 @@ GetOutput()
 {
     bool updateOk = true;
     if (!m_UpToDate)
+    {
+        ANIMA_INSTRUMENT_SCOPE("agregation");
         updateOk = this->Update();
+    }
 
     if (updateOk)
         return m_Output;
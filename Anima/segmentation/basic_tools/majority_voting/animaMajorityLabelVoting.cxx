@@ -1,15 +1,115 @@
 #include <animaMajorityLabelVotingImageFilter.h>
 #include <animaReadWriteFunctions.h>
 
+#include <itkImageFileReader.h>
+#include <itkStreamingImageFilter.h>
+
 #include <tclap/CmdLine.h>
 
+#include <stdexcept>
+
+struct arguments
+{
+    std::string inputName, outputName;
+    std::string weightsName, targetIntensityName, atlasIntensitiesName;
+    double sigma;
+    unsigned int numberOfSlabs, numberOfThreads;
+};
+
+template <class PixelType>
+void
+fuseLabels(const arguments &args, bool listInput)
+{
+    typedef itk::Image <PixelType, 3> ImageType;
+    typedef anima::MajorityLabelVotingImageFilter <PixelType> VotingFilterType;
+    typedef typename VotingFilterType::IntensityImageType IntensityImageType;
+
+    typename VotingFilterType::Pointer votingFilter = VotingFilterType::New();
+    votingFilter->SetNumberOfWorkUnits(args.numberOfThreads);
+
+    if (listInput)
+    {
+        // Readers are not updated: only the slab being fused is loaded for each atlas
+        typedef itk::ImageFileReader <ImageType> ReaderType;
+        std::vector <std::string> inputNames = anima::readFileList(args.inputName);
+        for (unsigned int i = 0;i < inputNames.size();++i)
+        {
+            typename ReaderType::Pointer reader = ReaderType::New();
+            reader->SetFileName(inputNames[i]);
+            votingFilter->SetInput(i,reader->GetOutput());
+        }
+    }
+    else
+    {
+        std::string inputName = args.inputName;
+        anima::setMultipleImageFilterInputsFromFileName <ImageType,VotingFilterType> (inputName,votingFilter);
+    }
+
+    if (args.weightsName != "")
+    {
+        std::vector <std::string> weightStrings = anima::readFileList(args.weightsName);
+        std::vector <double> weights(weightStrings.size());
+        for (unsigned int i = 0;i < weightStrings.size();++i)
+        {
+            try
+            {
+                weights[i] = std::stod(weightStrings[i]);
+            }
+            catch (std::logic_error &)
+            {
+                std::string error("Invalid atlas weight in " + args.weightsName + ": " + weightStrings[i]);
+                throw itk::ExceptionObject(__FILE__,__LINE__,error,ITK_LOCATION);
+            }
+        }
+
+        votingFilter->SetAtlasWeights(weights);
+        votingFilter->SetVotingMode(VotingFilterType::GlobalWeighted);
+    }
+
+    if (args.targetIntensityName != "")
+    {
+        typedef itk::ImageFileReader <IntensityImageType> IntensityReaderType;
+        typename IntensityReaderType::Pointer targetReader = IntensityReaderType::New();
+        targetReader->SetFileName(args.targetIntensityName);
+        votingFilter->SetTargetIntensityImage(targetReader->GetOutput());
+
+        std::vector <std::string> atlasIntensityNames = anima::readFileList(args.atlasIntensitiesName);
+        for (unsigned int i = 0;i < atlasIntensityNames.size();++i)
+        {
+            typename IntensityReaderType::Pointer reader = IntensityReaderType::New();
+            reader->SetFileName(atlasIntensityNames[i]);
+            votingFilter->AddAtlasIntensityImage(reader->GetOutput());
+        }
+
+        votingFilter->SetLocalWeightingSigma(args.sigma);
+        votingFilter->SetVotingMode(VotingFilterType::LocalWeighted);
+    }
+
+    typedef itk::StreamingImageFilter <ImageType, ImageType> StreamingFilterType;
+    typename StreamingFilterType::Pointer streamingFilter = StreamingFilterType::New();
+    streamingFilter->SetInput(votingFilter->GetOutput());
+    streamingFilter->SetNumberOfStreamDivisions(args.numberOfSlabs);
+
+    streamingFilter->Update();
+
+    anima::writeImage <ImageType> (args.outputName, streamingFilter->GetOutput());
+}
+
 int main(int argc, char **argv)
 {
     TCLAP::CmdLine cmd("INRIA / IRISA - VisAGeS/Empenn Team", ' ',ANIMA_VERSION);
-    
+
     TCLAP::ValueArg<std::string> inputArg("i","input-images","Input images",true,"","Label input images (list or 4D image)",cmd);
     TCLAP::ValueArg<std::string> consensusImageArg("o","consensus-image","consensus label image",true,"","consensus image",cmd);
 
+    TCLAP::ValueArg<std::string> weightsArg("w","weights","Text file of atlas weights, one per line (global weighted voting)",false,"","atlas weights",cmd);
+    TCLAP::ValueArg<std::string> targetIntensityArg("t","target-intensity","Target intensity image (local weighted voting, requires -I)",false,"","target intensity image",cmd);
+    TCLAP::ValueArg<std::string> atlasIntensitiesArg("I","atlas-intensities","List of registered atlas intensity images, in the same order as label images (local weighted voting, requires -t)",false,"","atlas intensity images",cmd);
+    TCLAP::ValueArg<double> sigmaArg("s","sigma","Standard deviation of intensity differences for local weights (default: 1)",false,1.0,"local weights sigma",cmd);
+
+    TCLAP::ValueArg<unsigned int> slabsArg("S","slabs","Number of slabs the fusion is streamed on, for list inputs (default: 8)",false,8,"number of slabs",cmd);
+    TCLAP::ValueArg<unsigned int> nbpArg("T","numberofthreads","Number of threads to run on (default : all cores)",false,itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(),"number of threads",cmd);
+
     try
     {
         cmd.parse(argc,argv);
@@ -20,15 +120,82 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
-    typedef itk::Image <unsigned int, 3> ImageType;
-    typedef anima::MajorityLabelVotingImageFilter <unsigned int> VotingFilterType;
+    arguments args;
+    args.inputName = inputArg.getValue();
+    args.outputName = consensusImageArg.getValue();
+    args.weightsName = weightsArg.getValue();
+    args.targetIntensityName = targetIntensityArg.getValue();
+    args.atlasIntensitiesName = atlasIntensitiesArg.getValue();
+    args.sigma = sigmaArg.getValue();
+    args.numberOfSlabs = std::max(slabsArg.getValue(),1U);
+    args.numberOfThreads = nbpArg.getValue();
+
+    if ((args.targetIntensityName != "") != (args.atlasIntensitiesName != ""))
+    {
+        std::cerr << "Error: local weighted voting requires both the target intensity image (-t) and atlas intensity images (-I)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Label type from label images headers: 8 and 16 bits labels are fused with direct counter tables
+    itk::ImageIOBase::Pointer imageIO = itk::ImageIOFactory::CreateImageIO(args.inputName.c_str(),
+                                                                           itk::IOFileModeEnum::ReadMode);
+    bool listInput = !imageIO;
 
-    VotingFilterType::Pointer votingFilter = VotingFilterType::New();
-    anima::setMultipleImageFilterInputsFromFileName <ImageType,VotingFilterType> (inputArg.getValue(),votingFilter);
+    try
+    {
+        std::vector <std::string> inputNames;
+        if (listInput)
+            inputNames = anima::readFileList(args.inputName);
+        else
+            inputNames.push_back(args.inputName);
+
+        if (inputNames.size() == 0)
+        {
+            std::cerr << "Error: no input label image" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // 0: unsigned char, 1: unsigned short, 2: unsigned int
+        unsigned int labelTypeIndex = 0;
+        for (unsigned int i = 0;i < inputNames.size();++i)
+        {
+            itk::ImageIOBase::Pointer labelIO = itk::ImageIOFactory::CreateImageIO(inputNames[i].c_str(),
+                                                                                   itk::IOFileModeEnum::ReadMode);
+            if (!labelIO)
+            {
+                std::cerr << "Error: unable to read " << inputNames[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            labelIO->SetFileName(inputNames[i]);
+            labelIO->ReadImageInformation();
+
+            if (labelIO->GetComponentType() == itk::IOComponentEnum::USHORT)
+                labelTypeIndex = std::max(labelTypeIndex,1U);
+            else if (labelIO->GetComponentType() != itk::IOComponentEnum::UCHAR)
+                labelTypeIndex = 2;
+        }
 
-    votingFilter->Update();
+        switch (labelTypeIndex)
+        {
+            case 0:
+                fuseLabels <unsigned char> (args,listInput);
+                break;
 
-    anima::writeImage <ImageType> (consensusImageArg.getValue(), votingFilter->GetOutput());
+            case 1:
+                fuseLabels <unsigned short> (args,listInput);
+                break;
+
+            default:
+                fuseLabels <unsigned int> (args,listInput);
+                break;
+        }
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        std::cerr << e << std::endl;
+        return EXIT_FAILURE;
+    }
 
     return EXIT_SUCCESS;
 }
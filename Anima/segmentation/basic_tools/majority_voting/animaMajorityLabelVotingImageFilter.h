@@ -1,10 +1,20 @@
 #pragma once
 
 #include <itkImageToImageFilter.h>
+#include <limits>
+#include <vector>
 
 namespace anima
 {
 
+/**
+ * @brief Label fusion by voting. Label images are the first indexed inputs. Votes are counted per voxel in flat
+ * counter arrays: labels are used directly as counter indexes for 8 and 16 bits integer labels, other label types
+ * use a compact list of the labels seen at the voxel. Ties go to the smallest label. Weighted modes use one global
+ * weight per atlas, possibly multiplied by a local weight exp(-(I - J_i)^2 / (2 sigma^2)) computed from the target
+ * intensity image I and the registered atlas intensity images J_i.
+ * Only the requested region of inputs is used, the filter can therefore be streamed by slabs.
+ */
 template <class TPixelType>
 class MajorityLabelVotingImageFilter :
 public itk::ImageToImageFilter< itk::Image <TPixelType, 3>, itk::Image<TPixelType, 3> >
@@ -26,18 +36,67 @@ public:
     itkTypeMacro(MajorityLabelVotingImageFilter, ImageToImageFilter)
 
     using InputRegionType = typename InputImageType::RegionType;
+    using IntensityImageType = itk::Image <float, 3>;
+
+    enum VotingModeType
+    {
+        Majority = 0,
+        GlobalWeighted,
+        LocalWeighted
+    };
+
+    itkSetMacro(VotingMode, VotingModeType)
+    itkGetMacro(VotingMode, VotingModeType)
+
+    //! One weight per atlas for weighted modes (default: all atlases have weight 1)
+    void SetAtlasWeights(const std::vector <double> &weights)
+    {
+        m_AtlasWeights = weights;
+        this->Modified();
+    }
+
+    //! Standard deviation of intensity differences in local weights
+    itkSetMacro(LocalWeightingSigma, double)
+    itkGetMacro(LocalWeightingSigma, double)
+
+    //! Intensity images for local weights, to be set after all label images (atlas images in the same order)
+    void SetTargetIntensityImage(const IntensityImageType *image);
+    void AddAtlasIntensityImage(const IntensityImageType *image);
+
+    unsigned int GetNumberOfAtlases() {return m_NumberOfAtlases;}
 
 protected:
     MajorityLabelVotingImageFilter ()
     {
+        m_VotingMode = Majority;
+        m_LocalWeightingSigma = 1.0;
+        m_NumberOfAtlases = 0;
+        m_TargetIntensityIndex = -1;
     }
 
     virtual ~MajorityLabelVotingImageFilter () {}
 
+    void BeforeThreadedGenerateData() ITK_OVERRIDE;
     void DynamicThreadedGenerateData(const InputRegionType &region) ITK_OVERRIDE;
 
+    //! Labels small enough to index counters directly
+    static bool UseCounterTable()
+    {
+        return std::numeric_limits <TPixelType>::is_integer && (sizeof(TPixelType) <= 2);
+    }
+
+    template <class CounterType> void VoteOnRegion(const InputRegionType &region);
+
 private:
     ITK_DISALLOW_COPY_AND_ASSIGN(MajorityLabelVotingImageFilter);
+
+    VotingModeType m_VotingMode;
+    std::vector <double> m_AtlasWeights;
+    double m_LocalWeightingSigma;
+
+    unsigned int m_NumberOfAtlases;
+    int m_TargetIntensityIndex;
+    std::vector <unsigned int> m_AtlasIntensityIndexes;
 };
 
 } // end namespace anima
@@ -1,61 +1,245 @@
 #pragma once
 #include "animaMajorityLabelVotingImageFilter.h"
 
-#include <itkImageRegionConstIterator.h>
-#include <itkImageRegionIterator.h>
-#include <map>
+#include <itkImageScanlineIterator.h>
+#include <cmath>
 
 namespace anima
 {
 
+template <class TPixelType>
+void
+MajorityLabelVotingImageFilter <TPixelType>
+::SetTargetIntensityImage(const IntensityImageType *image)
+{
+    m_TargetIntensityIndex = this->GetNumberOfIndexedInputs();
+    this->SetNthInput(m_TargetIntensityIndex, const_cast <IntensityImageType *> (image));
+}
+
+template <class TPixelType>
+void
+MajorityLabelVotingImageFilter <TPixelType>
+::AddAtlasIntensityImage(const IntensityImageType *image)
+{
+    unsigned int index = this->GetNumberOfIndexedInputs();
+    this->SetNthInput(index, const_cast <IntensityImageType *> (image));
+    m_AtlasIntensityIndexes.push_back(index);
+}
+
+template <class TPixelType>
+void
+MajorityLabelVotingImageFilter <TPixelType>
+::BeforeThreadedGenerateData()
+{
+    this->Superclass::BeforeThreadedGenerateData();
+
+    unsigned int numIntensityImages = m_AtlasIntensityIndexes.size();
+    if (m_TargetIntensityIndex >= 0)
+        ++numIntensityImages;
+
+    m_NumberOfAtlases = this->GetNumberOfIndexedInputs() - numIntensityImages;
+    if (m_NumberOfAtlases == 0)
+        itkExceptionMacro("No label image to fuse");
+
+    if ((m_TargetIntensityIndex >= 0) && ((unsigned int)m_TargetIntensityIndex < m_NumberOfAtlases))
+        itkExceptionMacro("Intensity images should be set after label images");
+
+    for (unsigned int i = 0;i < m_AtlasIntensityIndexes.size();++i)
+    {
+        if (m_AtlasIntensityIndexes[i] < m_NumberOfAtlases)
+            itkExceptionMacro("Intensity images should be set after label images");
+    }
+
+    if (m_VotingMode == Majority)
+        return;
+
+    if (m_AtlasWeights.size() == 0)
+        m_AtlasWeights.resize(m_NumberOfAtlases,1.0);
+
+    if (m_AtlasWeights.size() != m_NumberOfAtlases)
+        itkExceptionMacro("Number of atlas weights (" << m_AtlasWeights.size() << ") should match the number of atlases (" << m_NumberOfAtlases << ")");
+
+    if (m_VotingMode == LocalWeighted)
+    {
+        if ((m_TargetIntensityIndex < 0) || (m_AtlasIntensityIndexes.size() != m_NumberOfAtlases))
+            itkExceptionMacro("Local weighting requires a target intensity image and one intensity image per atlas");
+
+        if (m_LocalWeightingSigma <= 0)
+            itkExceptionMacro("Local weighting sigma should be positive");
+    }
+}
+
 template <class TPixelType>
 void
 MajorityLabelVotingImageFilter <TPixelType>
 ::DynamicThreadedGenerateData(const InputRegionType &region)
 {
-    unsigned int numInputs = this->GetNumberOfIndexedInputs();
+    // Integer counters keep unweighted votes exact
+    if (m_VotingMode == Majority)
+        this->VoteOnRegion <unsigned int> (region);
+    else
+        this->VoteOnRegion <double> (region);
+}
 
-    typedef itk::ImageRegionConstIterator <InputImageType> InputIteratorType;
-    typedef itk::ImageRegionIterator <OutputImageType> OutputIteratorType;
+template <class TPixelType>
+template <class CounterType>
+void
+MajorityLabelVotingImageFilter <TPixelType>
+::VoteOnRegion(const InputRegionType &region)
+{
+    typedef itk::ImageScanlineIterator <OutputImageType> OutputLineIteratorType;
+
+    OutputImageType *output = this->GetOutput();
+    unsigned int lineLength = region.GetSize()[0];
+
+    std::vector <const InputImageType *> labelImages(m_NumberOfAtlases);
+    std::vector <const TPixelType *> labelLines(m_NumberOfAtlases);
+    for (unsigned int i = 0;i < m_NumberOfAtlases;++i)
+        labelImages[i] = this->GetInput(i);
+
+    bool localWeights = (m_VotingMode == LocalWeighted);
+    const IntensityImageType *targetIntensityImage = NULL;
+    std::vector <const IntensityImageType *> atlasIntensityImages;
+    std::vector <CounterType> lineWeights;
+    if (localWeights)
+    {
+        targetIntensityImage = static_cast <const IntensityImageType *> (this->itk::ProcessObject::GetInput(m_TargetIntensityIndex));
+        atlasIntensityImages.resize(m_NumberOfAtlases);
+        for (unsigned int i = 0;i < m_NumberOfAtlases;++i)
+            atlasIntensityImages[i] = static_cast <const IntensityImageType *> (this->itk::ProcessObject::GetInput(m_AtlasIntensityIndexes[i]));
+
+        lineWeights.resize(m_NumberOfAtlases * lineLength);
+    }
+
+    std::vector <CounterType> atlasWeights(m_NumberOfAtlases,1);
+    if (m_VotingMode != Majority)
+    {
+        for (unsigned int i = 0;i < m_NumberOfAtlases;++i)
+            atlasWeights[i] = m_AtlasWeights[i];
+    }
 
-    std::vector<InputIteratorType> inputIterators (numInputs);
+    // Counter table indexed by label (minus the type minimum) or compact list of labels seen at the voxel
+    bool useCounterTable = UseCounterTable();
+    long minimalLabel = 0;
+    std::vector <CounterType> counterTable;
+    std::vector <unsigned char> touchedTable;
+    if (useCounterTable)
+    {
+        minimalLabel = (long)std::numeric_limits <TPixelType>::min();
+        unsigned int tableSize = 1 << (8 * sizeof(TPixelType));
+        counterTable.resize(tableSize,0);
+        touchedTable.resize(tableSize,0);
+    }
 
-    for (unsigned int i = 0; i < numInputs; ++i)
-        inputIterators[i] = InputIteratorType (this->GetInput(i), region);
+    std::vector <unsigned int> touchedIndexes;
+    touchedIndexes.reserve(m_NumberOfAtlases);
+    std::vector <TPixelType> voxelLabels;
+    voxelLabels.reserve(m_NumberOfAtlases);
+    std::vector <CounterType> voxelCounts;
+    voxelCounts.reserve(m_NumberOfAtlases);
 
-    OutputIteratorType outputIterator (this->GetOutput(), region);
+    double weightFactor = 1.0 / (2.0 * m_LocalWeightingSigma * m_LocalWeightingSigma);
 
-    std::map <TPixelType,unsigned int> vecCount;
-    using MapIterator = typename std::map <TPixelType,unsigned int>::iterator;
-    while (!inputIterators[0].IsAtEnd())
+    OutputLineIteratorType outputIterator(output, region);
+    while (!outputIterator.IsAtEnd())
     {
-        vecCount.clear();
+        typename OutputImageType::IndexType lineIndex = outputIterator.GetIndex();
+        TPixelType *outputLine = output->GetBufferPointer() + output->ComputeOffset(lineIndex);
+        for (unsigned int i = 0;i < m_NumberOfAtlases;++i)
+            labelLines[i] = labelImages[i]->GetBufferPointer() + labelImages[i]->ComputeOffset(lineIndex);
 
-        for (unsigned int i = 0;i < numInputs;++i)
+        if (localWeights)
         {
-            TPixelType value = inputIterators[i].Get();
-            if (vecCount.count(value) == 0)
-                vecCount[value] = 1;
-            else
-                ++vecCount[value];
+            const float *targetLine = targetIntensityImage->GetBufferPointer() + targetIntensityImage->ComputeOffset(lineIndex);
+            for (unsigned int i = 0;i < m_NumberOfAtlases;++i)
+            {
+                const float *atlasLine = atlasIntensityImages[i]->GetBufferPointer() + atlasIntensityImages[i]->ComputeOffset(lineIndex);
+                CounterType *weightsLine = lineWeights.data() + i * lineLength;
+                for (unsigned int x = 0;x < lineLength;++x)
+                {
+                    double diff = targetLine[x] - atlasLine[x];
+                    weightsLine[x] = atlasWeights[i] * std::exp(- diff * diff * weightFactor);
+                }
+            }
         }
 
-        TPixelType outValue = 0;
-        unsigned int maxCount = 0;
-        for (MapIterator it = vecCount.begin();it != vecCount.end();++it)
+        for (unsigned int x = 0;x < lineLength;++x)
         {
-            if (it->second > maxCount)
+            TPixelType outValue = 0;
+
+            if (useCounterTable)
+            {
+                for (unsigned int i = 0;i < m_NumberOfAtlases;++i)
+                {
+                    unsigned int index = (long)labelLines[i][x] - minimalLabel;
+                    if (!touchedTable[index])
+                    {
+                        touchedTable[index] = 1;
+                        touchedIndexes.push_back(index);
+                    }
+
+                    counterTable[index] += localWeights ? lineWeights[i * lineLength + x] : atlasWeights[i];
+                }
+
+                // Labels are ordered as indexes: ties go to the smallest index
+                unsigned int bestIndex = touchedIndexes[0];
+                for (unsigned int j = 1;j < touchedIndexes.size();++j)
+                {
+                    unsigned int index = touchedIndexes[j];
+                    if ((counterTable[index] > counterTable[bestIndex]) ||
+                            ((counterTable[index] == counterTable[bestIndex]) && (index < bestIndex)))
+                        bestIndex = index;
+                }
+
+                outValue = (TPixelType)(bestIndex + minimalLabel);
+
+                for (unsigned int j = 0;j < touchedIndexes.size();++j)
+                {
+                    counterTable[touchedIndexes[j]] = 0;
+                    touchedTable[touchedIndexes[j]] = 0;
+                }
+
+                touchedIndexes.clear();
+            }
+            else
             {
-                outValue = it->first;
-                maxCount = it->second;
+                voxelLabels.clear();
+                voxelCounts.clear();
+
+                for (unsigned int i = 0;i < m_NumberOfAtlases;++i)
+                {
+                    TPixelType value = labelLines[i][x];
+                    CounterType weight = localWeights ? lineWeights[i * lineLength + x] : atlasWeights[i];
+
+                    // Few distinct labels per voxel, linear search is enough
+                    unsigned int pos = 0;
+                    while ((pos < voxelLabels.size()) && (voxelLabels[pos] != value))
+                        ++pos;
+
+                    if (pos == voxelLabels.size())
+                    {
+                        voxelLabels.push_back(value);
+                        voxelCounts.push_back(weight);
+                    }
+                    else
+                        voxelCounts[pos] += weight;
+                }
+
+                unsigned int bestPos = 0;
+                for (unsigned int j = 1;j < voxelLabels.size();++j)
+                {
+                    if ((voxelCounts[j] > voxelCounts[bestPos]) ||
+                            ((voxelCounts[j] == voxelCounts[bestPos]) && (voxelLabels[j] < voxelLabels[bestPos])))
+                        bestPos = j;
+                }
+
+                outValue = voxelLabels[bestPos];
             }
+
+            outputLine[x] = outValue;
         }
 
-        //Set output value then move iterators
-        outputIterator.Set(outValue);
-        for (unsigned int i = 0;i < numInputs;++i)
-            ++inputIterators[i];
-        ++outputIterator;
+        outputIterator.NextLine();
     }
 }
 
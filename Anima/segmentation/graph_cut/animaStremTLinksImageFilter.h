@@ -0,0 +1,212 @@
+#pragma once
+
+#include <itkImageToImageFilter.h>
+#include <itkGaussianMembershipFunction.h>
+#include <itkVariableLengthVector.h>
+
+#include <vnl/vnl_matrix.h>
+
+namespace anima
+{
+/**
+ * @brief Fused per-voxel kernel of the STREM lesion pipeline. From the rescaled images and the NABT model, computes in
+ * a single threaded pass the Mahalanobis images of each class (1 - chi2 CDF of the distance), their minimum and maximum,
+ * the fuzzy rule image and the sources and sinks probabilities used as graph cut t-links.
+ * Class distances use whitening factors W = D^{-1/2} L^{-1} from the L D L^T decomposition of each covariance, computed
+ * once before the threaded pass. Optional manual seeds are mixed in as single gaussian t-links (scaled by alpha) computed
+ * on the original modality images.
+ * Only the outputs switched on by the Compute flags are allocated and written.
+ */
+template <typename TInputImage>
+class StremTLinksImageFilter :
+        public itk::ImageToImageFilter< itk::Image <unsigned char,3>, itk::Image <double,3> >
+{
+public:
+    /** Standard class typedefs. */
+    typedef StremTLinksImageFilter Self;
+    typedef itk::Image <unsigned char,3> ImageTypeUC;
+    typedef itk::Image <double,3> ImageTypeD;
+    typedef itk::ImageToImageFilter< ImageTypeUC, ImageTypeD > Superclass;
+    typedef itk::SmartPointer<Self> Pointer;
+    typedef itk::SmartPointer<const Self>  ConstPointer;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro(Self)
+
+    /** Run-time type information (and related methods) */
+    itkTypeMacro(StremTLinksImageFilter, ImageToImageFilter)
+
+    typedef TInputImage InputImageType;
+    typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
+
+    typedef itk::VariableLengthVector<double> MeasurementVectorType;
+    typedef itk::Statistics::GaussianMembershipFunction< MeasurementVectorType > GaussianFunctionType;
+
+    //! Output indexes
+    enum OutputIndexType
+    {
+        MahaCSF = 0,
+        MahaGM,
+        MahaWM,
+        MahaMinimum,
+        MahaMaximum,
+        FuzzyObject,
+        SourcesProbability,
+        SinksProbability
+    };
+
+    /** Mask in which the Mahalanobis and fuzzy images are computed (first input) */
+    void SetMask(const ImageTypeUC* mask) {this->SetNthInput(0, const_cast<ImageTypeUC*>(mask));}
+
+    /** Images rescaled to [0,255] the NABT model was estimated on (T1 and the two other modalities) */
+    void SetInputImage1(const ImageTypeUC* image);
+    void SetInputImage2(const ImageTypeUC* image);
+    void SetInputImage3(const ImageTypeUC* image);
+
+    void SetInputLesionPrior(const ImageTypeD* image);
+
+    /** Manual seeds: single gaussian t-links are computed on the original images added with AddSeedModalityImage */
+    void SetInputSeedSourcesMask(const ImageTypeUC* mask);
+    void SetInputSeedSinksMask(const ImageTypeUC* mask);
+    void AddSeedModalityImage(const InputImageType* image);
+
+    void SetGaussianModel(std::vector<GaussianFunctionType::Pointer> solution) {m_GaussianModel = solution;}
+
+    ImageTypeD* GetOutputMahaCSF() {return this->GetOutput(MahaCSF);}
+    ImageTypeD* GetOutputMahaGM() {return this->GetOutput(MahaGM);}
+    ImageTypeD* GetOutputMahaWM() {return this->GetOutput(MahaWM);}
+    ImageTypeD* GetOutputMahaMinimum() {return this->GetOutput(MahaMinimum);}
+    ImageTypeD* GetOutputMahaMaximum() {return this->GetOutput(MahaMaximum);}
+    ImageTypeD* GetOutputFuzzyObject() {return this->GetOutput(FuzzyObject);}
+    ImageTypeD* GetOutputSources() {return this->GetOutput(SourcesProbability);}
+    ImageTypeD* GetOutputSinks() {return this->GetOutput(SinksProbability);}
+
+    //! Is output idx allocated and computed with the current flags
+    bool IsOutputComputed(unsigned int idx) const;
+
+    void SetTol(const double tol)
+    {
+        this->SetCoordinateTolerance(tol);
+        this->SetDirectionTolerance(tol);
+    }
+
+    itkSetMacro(ComputeMahalanobisImages, bool)
+    itkGetMacro(ComputeMahalanobisImages, bool)
+
+    itkSetMacro(ComputeMahalanobisExtrema, bool)
+    itkGetMacro(ComputeMahalanobisExtrema, bool)
+
+    itkSetMacro(ComputeFuzzyObject, bool)
+    itkGetMacro(ComputeFuzzyObject, bool)
+
+    itkSetMacro(ComputeTLinks, bool)
+    itkGetMacro(ComputeTLinks, bool)
+
+    itkSetMacro(FuzzyRuleMin, double)
+    itkGetMacro(FuzzyRuleMin, double)
+
+    itkSetMacro(FuzzyRuleMax, double)
+    itkGetMacro(FuzzyRuleMax, double)
+
+    itkSetMacro(LesionPriorProportion, double)
+    itkGetMacro(LesionPriorProportion, double)
+
+    itkSetMacro(Alpha, double)
+    itkGetMacro(Alpha, double)
+
+    itkSetMacro(MultiVarSources, double)
+    itkGetMacro(MultiVarSources, double)
+
+    itkSetMacro(MultiVarSinks, double)
+    itkGetMacro(MultiVarSinks, double)
+
+    itkSetMacro(Verbose, bool)
+    itkGetMacro(Verbose, bool)
+
+protected:
+    StremTLinksImageFilter()
+    {
+        this->SetNumberOfRequiredInputs(4);
+        this->SetNumberOfRequiredOutputs(8);
+
+        for (unsigned int i = 0;i < 8;++i)
+            this->SetNthOutput(i, this->MakeOutput(i));
+
+        m_ComputeMahalanobisImages = true;
+        m_ComputeMahalanobisExtrema = false;
+        m_ComputeFuzzyObject = false;
+        m_ComputeTLinks = true;
+
+        m_FuzzyRuleMin = 1;
+        m_FuzzyRuleMax = 2;
+        m_LesionPriorProportion = 0.23;
+        m_Alpha = 10;
+        m_MultiVarSources = 1;
+        m_MultiVarSinks = 1;
+        m_Verbose = false;
+
+        // Index 0 is the mask: marks optional inputs not set
+        m_NbInputs = 4;
+        m_IndexLesionPrior = 0;
+        m_IndexSourcesMask = 0;
+        m_IndexSinksMask = 0;
+
+        m_NbTissues = 3;
+        m_IndexWM = 2;
+        m_DegreesOfFreedom = 3;
+
+        this->SetNumberOfWorkUnits(itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads());
+    }
+
+    virtual ~StremTLinksImageFilter() {}
+
+    //! Whitened quadratic form: squared distance is |W (x - mean)|^2, or (x - mean)^T M (x - mean) when not positive definite
+    struct QuadraticFormType
+    {
+        std::vector <double> mean;
+        vnl_matrix <double> factor;
+        bool triangular;
+    };
+
+    void AllocateOutputs() ITK_OVERRIDE;
+    void BeforeThreadedGenerateData() ITK_OVERRIDE;
+    void DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread) ITK_OVERRIDE;
+
+    //! Builds quadratic form from mean and covariance (whitening factor when positive definite, inverse otherwise)
+    static void ComputeQuadraticForm(const std::vector <double> &mean, const vnl_matrix <double> &covariance,
+                                     QuadraticFormType &form);
+    static double EvaluateQuadraticForm(const QuadraticFormType &form, const double *value, double *work);
+
+    //! Single gaussian estimated on manual seeds, as in TLinksFilter
+    void ComputeSeedQuadraticForm(const ImageTypeUC *seedMask, double multiVar, QuadraticFormType &form);
+
+    bool NeedsSecondaryMaps() const {return m_ComputeFuzzyObject || m_ComputeTLinks;}
+
+private:
+    ITK_DISALLOW_COPY_AND_ASSIGN(StremTLinksImageFilter);
+
+    bool m_ComputeMahalanobisImages, m_ComputeMahalanobisExtrema;
+    bool m_ComputeFuzzyObject, m_ComputeTLinks;
+
+    double m_FuzzyRuleMin, m_FuzzyRuleMax;
+    double m_LesionPriorProportion;
+    double m_Alpha, m_MultiVarSources, m_MultiVarSinks;
+    bool m_Verbose;
+
+    unsigned int m_NbInputs;
+    unsigned int m_IndexLesionPrior, m_IndexSourcesMask, m_IndexSinksMask;
+    std::vector <unsigned int> m_SeedModalityIndexes;
+
+    std::vector<GaussianFunctionType::Pointer> m_GaussianModel;
+    unsigned int m_NbTissues, m_IndexWM, m_DegreesOfFreedom;
+
+    std::vector <QuadraticFormType> m_TissueForms;
+    QuadraticFormType m_SourcesForm, m_SinksForm;
+
+    //! Fuzzy rule windowing of the two non T1 images, tabulated on [0,255]
+    std::vector <double> m_FuzzyWindow1, m_FuzzyWindow2;
+};
+
+} // end of namespace anima
+
+#include "animaStremTLinksImageFilter.hxx"
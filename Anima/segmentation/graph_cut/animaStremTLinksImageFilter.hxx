@@ -0,0 +1,521 @@
+#pragma once
+
+#include "animaStremTLinksImageFilter.h"
+
+#include <itkImageRegionConstIterator.h>
+#include <itkImageScanlineConstIterator.h>
+#include <itkChiSquareDistribution.h>
+
+#include <vnl/algo/vnl_matrix_inverse.h>
+#include <animaCholeskyDecomposition.h>
+
+#include <algorithm>
+
+namespace anima
+{
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::SetInputImage1(const ImageTypeUC* image)
+{
+    this->SetNthInput(1, const_cast<ImageTypeUC*>(image));
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::SetInputImage2(const ImageTypeUC* image)
+{
+    this->SetNthInput(2, const_cast<ImageTypeUC*>(image));
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::SetInputImage3(const ImageTypeUC* image)
+{
+    this->SetNthInput(3, const_cast<ImageTypeUC*>(image));
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::SetInputLesionPrior(const ImageTypeD* image)
+{
+    this->SetNthInput(m_NbInputs, const_cast<ImageTypeD*>(image));
+    m_IndexLesionPrior = m_NbInputs;
+    m_NbInputs++;
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::SetInputSeedSourcesMask(const ImageTypeUC* mask)
+{
+    this->SetNthInput(m_NbInputs, const_cast<ImageTypeUC*>(mask));
+    m_IndexSourcesMask = m_NbInputs;
+    m_NbInputs++;
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::SetInputSeedSinksMask(const ImageTypeUC* mask)
+{
+    this->SetNthInput(m_NbInputs, const_cast<ImageTypeUC*>(mask));
+    m_IndexSinksMask = m_NbInputs;
+    m_NbInputs++;
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::AddSeedModalityImage(const InputImageType* image)
+{
+    this->SetNthInput(m_NbInputs, const_cast<InputImageType*>(image));
+    m_SeedModalityIndexes.push_back(m_NbInputs);
+    m_NbInputs++;
+}
+
+template <typename TInputImage>
+bool StremTLinksImageFilter <TInputImage>::IsOutputComputed(unsigned int idx) const
+{
+    switch (idx)
+    {
+        case MahaCSF:
+        case MahaGM:
+        case MahaWM:
+            return m_ComputeMahalanobisImages;
+
+        case MahaMinimum:
+        case MahaMaximum:
+            return m_ComputeMahalanobisExtrema;
+
+        case FuzzyObject:
+            return m_ComputeFuzzyObject;
+
+        case SourcesProbability:
+        case SinksProbability:
+            return m_ComputeTLinks;
+
+        default:
+            return false;
+    }
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::AllocateOutputs()
+{
+    // Outputs not requested are left empty
+    for (unsigned int i = 0;i < this->GetNumberOfIndexedOutputs();++i)
+    {
+        if (!this->IsOutputComputed(i))
+            continue;
+
+        ImageTypeD *output = this->GetOutput(i);
+        output->SetBufferedRegion(output->GetRequestedRegion());
+        output->Allocate();
+    }
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::ComputeQuadraticForm(const std::vector <double> &mean,
+                                                                const vnl_matrix <double> &covariance,
+                                                                QuadraticFormType &form)
+{
+    unsigned int dimension = mean.size();
+    form.mean = mean;
+
+    anima::CholeskyDecomposition cholSolver(covariance);
+    cholSolver.PerformDecomposition();
+
+    bool positiveDefinite = true;
+    for (unsigned int i = 0;i < dimension;++i)
+    {
+        if (!(cholSolver.GetDMatrix()[i] > 0))
+        {
+            positiveDefinite = false;
+            break;
+        }
+    }
+
+    if (!positiveDefinite)
+    {
+        form.factor = vnl_matrix_inverse <double> (covariance).inverse();
+        form.triangular = false;
+        return;
+    }
+
+    // Inverse of the unit lower triangular factor, then W = D^{-1/2} L^{-1}
+    const vnl_matrix <double> &lMatrix = cholSolver.GetLMatrix();
+    form.factor.set_size(dimension,dimension);
+    form.factor.fill(0.0);
+    for (unsigned int i = 0;i < dimension;++i)
+    {
+        form.factor(i,i) = 1.0;
+        for (unsigned int j = 0;j < i;++j)
+        {
+            double value = 0;
+            for (unsigned int k = j;k < i;++k)
+                value -= lMatrix(i,k) * form.factor(k,j);
+
+            form.factor(i,j) = value;
+        }
+    }
+
+    for (unsigned int i = 0;i < dimension;++i)
+    {
+        double scale = 1.0 / std::sqrt(cholSolver.GetDMatrix()[i]);
+        for (unsigned int j = 0;j <= i;++j)
+            form.factor(i,j) *= scale;
+    }
+
+    form.triangular = true;
+}
+
+template <typename TInputImage>
+double StremTLinksImageFilter <TInputImage>::EvaluateQuadraticForm(const QuadraticFormType &form, const double *value,
+                                                                   double *work)
+{
+    unsigned int dimension = form.mean.size();
+    for (unsigned int i = 0;i < dimension;++i)
+        work[i] = value[i] - form.mean[i];
+
+    double resVal = 0;
+    if (form.triangular)
+    {
+        for (unsigned int i = 0;i < dimension;++i)
+        {
+            double whitenedValue = 0;
+            for (unsigned int j = 0;j <= i;++j)
+                whitenedValue += form.factor(i,j) * work[j];
+
+            resVal += whitenedValue * whitenedValue;
+        }
+
+        return resVal;
+    }
+
+    for (unsigned int i = 0;i < dimension;++i)
+    {
+        double rowValue = 0;
+        for (unsigned int j = 0;j < dimension;++j)
+            rowValue += form.factor(i,j) * work[j];
+
+        resVal += work[i] * rowValue;
+    }
+
+    return resVal;
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::ComputeSeedQuadraticForm(const ImageTypeUC *seedMask, double multiVar,
+                                                                    QuadraticFormType &form)
+{
+    const double epsilon = 1e-37;
+    unsigned int nbModalities = m_SeedModalityIndexes.size();
+
+    typedef itk::ImageRegionConstIterator <ImageTypeUC> SeedIteratorType;
+    typedef itk::ImageRegionConstIterator <InputImageType> InputIteratorType;
+
+    SeedIteratorType seedIterator(seedMask, seedMask->GetLargestPossibleRegion());
+    std::vector <InputIteratorType> modalityIterators(nbModalities);
+    for (unsigned int m = 0;m < nbModalities;++m)
+    {
+        const InputImageType *image = static_cast <const InputImageType *> (this->itk::ProcessObject::GetInput(m_SeedModalityIndexes[m]));
+        modalityIterators[m] = InputIteratorType(image, seedMask->GetLargestPossibleRegion());
+    }
+
+    // Seed values are gathered once, seeds are sparse
+    std::vector <double> seedValues;
+    std::vector <double> mean(nbModalities,0.0), squaredSum(nbModalities,0.0);
+    while (!seedIterator.IsAtEnd())
+    {
+        if (seedIterator.Get() != 0)
+        {
+            for (unsigned int m = 0;m < nbModalities;++m)
+            {
+                double value = static_cast <double> (modalityIterators[m].Get());
+                seedValues.push_back(value);
+                mean[m] += value;
+                squaredSum[m] += value * value;
+            }
+        }
+
+        ++seedIterator;
+        for (unsigned int m = 0;m < nbModalities;++m)
+            ++modalityIterators[m];
+    }
+
+    unsigned int nbSeeds = seedValues.size() / nbModalities;
+    if (nbSeeds == 0)
+        itkExceptionMacro("Empty seed mask, single gaussian t-links can not be computed");
+
+    vnl_matrix <double> covariance(nbModalities,nbModalities,0.0);
+    for (unsigned int m = 0;m < nbModalities;++m)
+    {
+        mean[m] /= nbSeeds;
+        covariance(m,m) = (squaredSum[m] / nbSeeds - mean[m] * mean[m]) * multiVar;
+        if (covariance(m,m) == 0)
+            covariance(m,m) = epsilon;
+
+        if (m_Verbose)
+        {
+            std::cout << "mean of modality " << m << ": " << mean[m] << std::endl;
+            std::cout << "variance of modality " << m << ": " << covariance(m,m) << std::endl;
+            std::cout << std::endl;
+        }
+    }
+
+    for (unsigned int m = 0;m < nbModalities;++m)
+    {
+        for (unsigned int n = m + 1;n < nbModalities;++n)
+        {
+            double covValue = 0;
+            for (unsigned int s = 0;s < nbSeeds;++s)
+                covValue += (seedValues[s * nbModalities + m] - mean[m]) * (seedValues[s * nbModalities + n] - mean[n]);
+
+            covValue /= (nbSeeds - 1.0);
+            if (covValue == 0)
+                covValue = epsilon;
+
+            covariance(m,n) = covValue;
+            covariance(n,m) = covValue;
+        }
+    }
+
+    this->ComputeQuadraticForm(mean,covariance,form);
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::BeforeThreadedGenerateData()
+{
+    Superclass::BeforeThreadedGenerateData();
+
+    if (m_GaussianModel.size() != m_NbTissues)
+        itkExceptionMacro("NABT model should have " << m_NbTissues << " classes");
+
+    m_DegreesOfFreedom = m_GaussianModel[0]->GetMean().Size();
+    if (m_DegreesOfFreedom != 3)
+        itkExceptionMacro("NABT model should be estimated on 3 images");
+
+    m_TissueForms.resize(m_NbTissues);
+    for (unsigned int i = 0;i < m_NbTissues;++i)
+    {
+        GaussianFunctionType::MeanVectorType mean = m_GaussianModel[i]->GetMean();
+        std::vector <double> meanVector(m_DegreesOfFreedom);
+        for (unsigned int j = 0;j < m_DegreesOfFreedom;++j)
+            meanVector[j] = mean[j];
+
+        this->ComputeQuadraticForm(meanVector, m_GaussianModel[i]->GetCovariance().GetVnlMatrix(), m_TissueForms[i]);
+    }
+
+    if (this->NeedsSecondaryMaps())
+    {
+        // Intensity windowing of images 2 and 3 between mean + min * sigma and mean + max * sigma of white matter
+        GaussianFunctionType::MeanVectorType mean = m_GaussianModel[m_IndexWM]->GetMean();
+        GaussianFunctionType::CovarianceMatrixType covar = m_GaussianModel[m_IndexWM]->GetCovariance();
+
+        for (unsigned int k = 1;k < 3;++k)
+        {
+            std::vector <double> &window = (k == 1) ? m_FuzzyWindow1 : m_FuzzyWindow2;
+            window.resize(256);
+
+            unsigned char lowerValue = static_cast <unsigned char> (mean[k] + m_FuzzyRuleMin * std::sqrt(covar[k][k]));
+            unsigned char upperValue = static_cast <unsigned char> (mean[k] + m_FuzzyRuleMax * std::sqrt(covar[k][k]));
+
+            double scale = 1.0 / (static_cast <double> (upperValue) - static_cast <double> (lowerValue));
+            double shift = - static_cast <double> (lowerValue) * scale;
+
+            for (unsigned int v = 0;v < 256;++v)
+            {
+                if (v < lowerValue)
+                    window[v] = 0.0;
+                else if (v > upperValue)
+                    window[v] = 1.0;
+                else
+                    window[v] = v * scale + shift;
+            }
+        }
+    }
+
+    if (m_ComputeTLinks && ((m_IndexSourcesMask != 0) || (m_IndexSinksMask != 0)))
+    {
+        if (m_SeedModalityIndexes.size() == 0)
+            itkExceptionMacro("Manual seeds require modality images to compute single gaussian t-links");
+
+        if (m_IndexSourcesMask != 0)
+        {
+            std::cout << "Computing single gaussian for sources..." << std::endl;
+            this->ComputeSeedQuadraticForm(static_cast <const ImageTypeUC *> (this->itk::ProcessObject::GetInput(m_IndexSourcesMask)),
+                                           m_MultiVarSources, m_SourcesForm);
+        }
+
+        if (m_IndexSinksMask != 0)
+        {
+            std::cout << "Computing single gaussian for sinks..." << std::endl;
+            this->ComputeSeedQuadraticForm(static_cast <const ImageTypeUC *> (this->itk::ProcessObject::GetInput(m_IndexSinksMask)),
+                                           m_MultiVarSinks, m_SinksForm);
+        }
+    }
+}
+
+template <typename TInputImage>
+void StremTLinksImageFilter <TInputImage>::DynamicThreadedGenerateData(const OutputImageRegionType &outputRegionForThread)
+{
+    typedef itk::ImageScanlineConstIterator <ImageTypeUC> MaskLineIteratorType;
+
+    const ImageTypeUC *mask = this->GetInput(0);
+    const ImageTypeUC *images[3];
+    for (unsigned int i = 0;i < 3;++i)
+        images[i] = this->GetInput(i + 1);
+
+    const ImageTypeD *lesionPrior = NULL;
+    if (m_IndexLesionPrior != 0)
+        lesionPrior = static_cast <const ImageTypeD *> (this->itk::ProcessObject::GetInput(m_IndexLesionPrior));
+
+    bool computeSecondaryMaps = this->NeedsSecondaryMaps();
+    const ImageTypeUC *sourcesMask = NULL;
+    const ImageTypeUC *sinksMask = NULL;
+    std::vector <const InputImageType *> seedModalities;
+    if (m_ComputeTLinks)
+    {
+        if (m_IndexSourcesMask != 0)
+            sourcesMask = static_cast <const ImageTypeUC *> (this->itk::ProcessObject::GetInput(m_IndexSourcesMask));
+        if (m_IndexSinksMask != 0)
+            sinksMask = static_cast <const ImageTypeUC *> (this->itk::ProcessObject::GetInput(m_IndexSinksMask));
+
+        if (sourcesMask || sinksMask)
+        {
+            for (unsigned int m = 0;m < m_SeedModalityIndexes.size();++m)
+                seedModalities.push_back(static_cast <const InputImageType *> (this->itk::ProcessObject::GetInput(m_SeedModalityIndexes[m])));
+        }
+    }
+
+    // Only computed outputs are written
+    const unsigned int nbOutputs = 8;
+    ImageTypeD *outputs[nbOutputs];
+    double *outputLines[nbOutputs];
+    for (unsigned int i = 0;i < nbOutputs;++i)
+        outputs[i] = this->IsOutputComputed(i) ? this->GetOutput(i) : NULL;
+
+    unsigned int nbSeedModalities = seedModalities.size();
+    std::vector <const typename InputImageType::PixelType *> seedModalityLines(nbSeedModalities);
+    std::vector <double> seedValue(nbSeedModalities);
+    std::vector <double> workVector(std::max(nbSeedModalities,m_DegreesOfFreedom));
+
+    const double priorProportion = m_LesionPriorProportion;
+    double tissueValue[3];
+    double mahaValues[3];
+
+    MaskLineIteratorType maskIterator(mask, outputRegionForThread);
+    unsigned int lineLength = outputRegionForThread.GetSize()[0];
+    while (!maskIterator.IsAtEnd())
+    {
+        typename ImageTypeUC::IndexType lineIndex = maskIterator.GetIndex();
+        const unsigned char *maskLine = mask->GetBufferPointer() + mask->ComputeOffset(lineIndex);
+        const unsigned char *imageLines[3];
+        for (unsigned int i = 0;i < 3;++i)
+            imageLines[i] = images[i]->GetBufferPointer() + images[i]->ComputeOffset(lineIndex);
+
+        for (unsigned int i = 0;i < nbOutputs;++i)
+            outputLines[i] = outputs[i] ? outputs[i]->GetBufferPointer() + outputs[i]->ComputeOffset(lineIndex) : NULL;
+
+        const double *priorLine = lesionPrior ? lesionPrior->GetBufferPointer() + lesionPrior->ComputeOffset(lineIndex) : NULL;
+        const unsigned char *sourcesLine = sourcesMask ? sourcesMask->GetBufferPointer() + sourcesMask->ComputeOffset(lineIndex) : NULL;
+        const unsigned char *sinksLine = sinksMask ? sinksMask->GetBufferPointer() + sinksMask->ComputeOffset(lineIndex) : NULL;
+        for (unsigned int m = 0;m < nbSeedModalities;++m)
+            seedModalityLines[m] = seedModalities[m]->GetBufferPointer() + seedModalities[m]->ComputeOffset(lineIndex);
+
+        for (unsigned int x = 0;x < lineLength;++x)
+        {
+            bool insideMask = (maskLine[x] != 0);
+            double mahaMaximum = 0;
+            double mahaMinimum = 0;
+
+            for (unsigned int i = 0;i < m_NbTissues;++i)
+                mahaValues[i] = 0;
+
+            if (insideMask)
+            {
+                for (unsigned int i = 0;i < 3;++i)
+                    tissueValue[i] = imageLines[i][x];
+
+                for (unsigned int i = 0;i < m_NbTissues;++i)
+                {
+                    double squaredDistance = this->EvaluateQuadraticForm(m_TissueForms[i], tissueValue, workVector.data());
+                    if (squaredDistance < 0)
+                        squaredDistance = 0;
+
+                    mahaValues[i] = 1.0 - itk::Statistics::ChiSquareDistribution::CDF(std::sqrt(squaredDistance), m_DegreesOfFreedom);
+                    if (mahaValues[i] > mahaMaximum)
+                        mahaMaximum = mahaValues[i];
+                }
+
+                mahaMinimum = 1.0 - mahaMaximum;
+            }
+
+            if (m_ComputeMahalanobisImages)
+            {
+                outputLines[MahaCSF][x] = mahaValues[0];
+                outputLines[MahaGM][x] = mahaValues[1];
+                outputLines[MahaWM][x] = mahaValues[2];
+            }
+
+            if (m_ComputeMahalanobisExtrema)
+            {
+                outputLines[MahaMinimum][x] = mahaMinimum;
+                outputLines[MahaMaximum][x] = mahaMaximum;
+            }
+
+            if (!computeSecondaryMaps)
+                continue;
+
+            double objectValue = mahaMinimum;
+            if (priorLine)
+                objectValue = mahaMinimum * (1.0 - priorProportion) + priorLine[x] * priorProportion;
+
+            // Fuzzy rule: minimum of the two hyper-intensity windows and of the (prior weighted) minimum mahalanobis map
+            double fuzzyValue = 0;
+            if (insideMask)
+            {
+                double window1 = m_FuzzyWindow1[imageLines[1][x]];
+                double window2 = m_FuzzyWindow2[imageLines[2][x]];
+                fuzzyValue = (window1 < window2) ? window1 : window2;
+                fuzzyValue = (fuzzyValue < objectValue) ? fuzzyValue : objectValue;
+            }
+
+            if (m_ComputeFuzzyObject)
+                outputLines[FuzzyObject][x] = fuzzyValue;
+
+            if (!m_ComputeTLinks)
+                continue;
+
+            double sourcesValue = fuzzyValue;
+            double sinksValue = mahaMaximum;
+
+            for (unsigned int m = 0;m < nbSeedModalities;++m)
+                seedValue[m] = static_cast <double> (seedModalityLines[m][x]);
+
+            if (sourcesLine)
+            {
+                double seedProba = std::exp(-0.5 * this->EvaluateQuadraticForm(m_SourcesForm, seedValue.data(), workVector.data()));
+                if (sourcesLine[x] != 0)
+                    seedProba = 1.0;
+                if (sinksLine && (sinksLine[x] != 0))
+                    seedProba = 0.0;
+
+                seedProba *= m_Alpha;
+                sourcesValue = (sourcesValue > seedProba) ? sourcesValue : seedProba;
+            }
+
+            if (sinksLine)
+            {
+                double seedProba = std::exp(-0.5 * this->EvaluateQuadraticForm(m_SinksForm, seedValue.data(), workVector.data()));
+                if (sinksLine[x] != 0)
+                    seedProba = 1.0;
+                if (sourcesLine && (sourcesLine[x] != 0))
+                    seedProba = 0.0;
+
+                seedProba *= m_Alpha;
+                sinksValue = (sinksValue > seedProba) ? sinksValue : seedProba;
+            }
+            else if (priorLine)
+                sinksValue = mahaMaximum * (1.0 - priorProportion) + (1.0 - priorLine[x]) * priorProportion;
+
+            outputLines[SourcesProbability][x] = sourcesValue;
+            outputLines[SinksProbability][x] = sinksValue;
+        }
+
+        maskIterator.NextLine();
+    }
+}
+
+} // end of namespace anima
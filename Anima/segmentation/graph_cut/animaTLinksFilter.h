@@ -136,6 +136,7 @@ protected:
     void computeSingleGaussian();
     void computeSingleGaussianSeeds(TSeedMask::ConstPointer seedMask, OutputImagePointer output, double multiVar, TSeedMask::ConstPointer seedMaskOpp = ITK_NULLPTR);
     void computeStrem();
+    void computeStremOutput(TSeedProba::ConstPointer proba, OutputImagePointer output);
 
     /**  Create the Output */
     itk::DataObject::Pointer MakeOutput(unsigned int idx);
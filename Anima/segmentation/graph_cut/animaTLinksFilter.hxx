@@ -128,13 +128,11 @@ TLinksFilter<TInput, TOutput>
     output1->SetRegions(this->GetInput(0)->GetLargestPossibleRegion());
     output1->CopyInformation(this->GetInput(0));
     output1->Allocate();
-    output1->FillBuffer(0);
 
     typename TOutput::Pointer output2 = this->GetOutputSinks();
     output2->SetRegions(this->GetInput(0)->GetLargestPossibleRegion());
     output2->CopyInformation(this->GetInput(0));
     output2->Allocate();
-    output2->FillBuffer(0);
 
     if(this->m_TLinkMode==singleGaussianTLink && (this->GetInputSeedSourcesMask().IsNull() && this->GetInputSeedSinksMask().IsNull()))
     {
@@ -149,6 +147,7 @@ TLinksFilter<TInput, TOutput>
 
     m_NbModalities = m_imagesVectorIt.size();
 
+    // Alpha scaling is done while computing the maps, outputs are filled only when not computed
     switch(m_TLinkMode)
     {
     case singleGaussianTLink:
@@ -160,21 +159,6 @@ TLinksFilter<TInput, TOutput>
     default:
         return;
     }
-
-    OutRegionIteratorType outIterator1(output1, output1->GetLargestPossibleRegion());
-    OutRegionIteratorType outIterator2(output2, output2->GetLargestPossibleRegion());
-
-    while (!outIterator1.IsAtEnd())
-    {
-        double val1 = m_Alpha * outIterator1.Get();
-        outIterator1.Set(val1);
-
-        double val2 = m_Alpha * outIterator2.Get();
-        outIterator2.Set(val2);
-
-        ++outIterator1;
-        ++outIterator2;
-    }
 }
 
 template <typename TInput, typename TOutput>
@@ -182,24 +166,42 @@ void
 TLinksFilter<TInput, TOutput>
 ::computeStrem()
 {
-    // Just copy proba
+    // Just copy proba and scale by alpha
     std::cout << "Use of strem method..." << std::endl;
-    OutRegionIteratorType outIterator1(this->GetOutputSources(), this->GetOutputSources()->GetLargestPossibleRegion());
-    OutRegionIteratorType outIterator2(this->GetOutputSinks(), this->GetOutputSinks()->GetLargestPossibleRegion());
+    this->computeStremOutput(this->GetInputSeedSourcesProba(), this->GetOutputSources());
+    this->computeStremOutput(this->GetInputSeedSinksProba(), this->GetOutputSinks());
+}
 
-    SeedProbaRegionConstIteratorType sourcesIterator(this->GetInputSeedSourcesProba(), this->GetInputSeedSourcesProba()->GetLargestPossibleRegion());
-    SeedProbaRegionConstIteratorType sinksIterator(this->GetInputSeedSinksProba(), this->GetInputSeedSinksProba()->GetLargestPossibleRegion());
+template <typename TInput, typename TOutput>
+void
+TLinksFilter<TInput, TOutput>
+::computeStremOutput(TSeedProba::ConstPointer proba, OutputImagePointer output)
+{
+    if (proba.IsNull())
+    {
+        output->FillBuffer(0);
+        return;
+    }
 
-    while(!sourcesIterator.IsAtEnd())
+    typedef itk::ImageRegion <TOutput::ImageDimension> RegionType;
+    const TSeedProba *probaImage = proba.GetPointer();
+    TOutput *outputImage = output.GetPointer();
+    double alpha = m_Alpha;
+
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    this->GetMultiThreader()->template ParallelizeImageRegion<TOutput::ImageDimension>(
+                output->GetLargestPossibleRegion(), [probaImage, outputImage, alpha](const RegionType & lambdaRegion)
     {
-        outIterator1.Set(static_cast<OutputPixelType>(sourcesIterator.Get()));
-        outIterator2.Set(static_cast<OutputPixelType>(sinksIterator.Get()));
+        OutRegionIteratorType outIterator(outputImage, lambdaRegion);
+        SeedProbaRegionConstIteratorType probaIterator(probaImage, lambdaRegion);
 
-        ++outIterator1;
-        ++outIterator2;
-        ++sourcesIterator;
-        ++sinksIterator;
-    }
+        while(!probaIterator.IsAtEnd())
+        {
+            outIterator.Set(static_cast<OutputPixelType>(alpha * probaIterator.Get()));
+            ++outIterator;
+            ++probaIterator;
+        }
+    }, this);
 }
 
 template <typename TInput, typename TOutput>
@@ -212,11 +214,16 @@ TLinksFilter<TInput, TOutput>
         std::cout << "Computing single gaussian for sources..." << std::endl;
         computeSingleGaussianSeeds(this->GetInputSeedSourcesMask(), this->GetOutputSources(), m_MultiVarSources, this->GetInputSeedSinksMask());
     }
+    else
+        this->GetOutputSources()->FillBuffer(0);
+
     if(this->GetInputSeedSinksMask().IsNotNull())
     {
         std::cout << "Computing single gaussian for sinks..." << std::endl;
         computeSingleGaussianSeeds(this->GetInputSeedSinksMask(), this->GetOutputSinks(), m_MultiVarSinks, this->GetInputSeedSourcesMask());
     }
+    else
+        this->GetOutputSinks()->FillBuffer(0);
 }
 
 template <typename TInput, typename TOutput>
@@ -360,68 +367,63 @@ TLinksFilter<TInput, TOutput>
     //invert covariance matrix
     covarMatrix=covarMatrix.GetInverse();
 
-    // Compute the proba maps
-    MatrixTypeRes prob;
-    DoubleVariableSizeMatrixType d;
-    d.SetSize(1,m_NbModalities);
-
-    seedIterator.GoToBegin();
-    for ( unsigned int i = 0; i < m_NbModalities; i++ )
+    // Compute the proba maps, scaled by alpha, seeds are read directly from the masks
+    typedef itk::ImageRegion <TOutput::ImageDimension> RegionType;
+    const TSeedMask *seedMaskImage = seedMask.GetPointer();
+    const TSeedMask *seedMaskOppImage = seedMaskOpp.GetPointer();
+    TOutput *outputImage = output.GetPointer();
+    unsigned int nbModalities = m_NbModalities;
+    double alpha = m_Alpha;
+
+    this->GetMultiThreader()->SetNumberOfWorkUnits(this->GetNumberOfWorkUnits());
+    this->GetMultiThreader()->template ParallelizeImageRegion<TOutput::ImageDimension>(
+                output->GetLargestPossibleRegion(), [&](const RegionType & lambdaRegion)
     {
-        m_imagesVectorIt[i].GoToBegin();
-    }
+        OutRegionIteratorType outIterator(outputImage, lambdaRegion);
+        SeedMaskRegionConstIteratorType seedIterator(seedMaskImage, lambdaRegion);
+        SeedMaskRegionConstIteratorType seedOppIterator;
+        if (seedMaskOppImage)
+            seedOppIterator = SeedMaskRegionConstIteratorType(seedMaskOppImage, lambdaRegion);
 
-    TSeedMask::Pointer seedMaskOpp2 = TSeedMask::New();
-    seedMaskOpp2->SetRegions(seedMask->GetLargestPossibleRegion());
-    seedMaskOpp2->CopyInformation(seedMask);
-    seedMaskOpp2->Allocate();
+        std::vector <InConstIteratorType> imagesIterators(nbModalities);
+        for (unsigned int m = 0; m < nbModalities; m++)
+            imagesIterators[m] = InConstIteratorType(m_imagesVector[m], lambdaRegion);
 
-    SeedMaskRegionIteratorType seedOppIterator2(seedMaskOpp2, seedMaskOpp2->GetLargestPossibleRegion());
-    if(seedMaskOpp.IsNull())
-    {
-        seedMaskOpp2->FillBuffer(0);
-    }
-    else
-    {
-        SeedMaskRegionConstIteratorType seedOppIterator(seedMaskOpp, seedMaskOpp->GetLargestPossibleRegion());
-        while(!seedOppIterator.IsAtEnd())
+        std::vector <double> d(nbModalities);
+        while(!seedIterator.IsAtEnd())
         {
-            seedOppIterator2.Set(seedOppIterator.Get());
-            ++seedOppIterator2;
-            ++seedOppIterator;
-        }
-    }
+            for (unsigned int m = 0; m < nbModalities; m++)
+                d[m] = imagesIterators[m].Get() - moy[m];
 
-    seedIterator.GoToBegin();
-    seedOppIterator2.GoToBegin();
-    while(!seedIterator.IsAtEnd())
-    {
-        for (unsigned int m = 0; m < m_NbModalities; m++)
-        {
-            d(0,m) = m_imagesVectorIt[m].Get() - moy[m];
-        }
+            double prob = 0;
+            for (unsigned int m = 0; m < nbModalities; m++)
+            {
+                double rowValue = 0;
+                for (unsigned int n = 0; n < nbModalities; n++)
+                    rowValue += covarMatrix(m,n) * d[n];
 
-        prob = d.GetVnlMatrix()*covarMatrix.GetVnlMatrix()*d.GetTranspose();
+                prob += d[m] * rowValue;
+            }
 
-        outIterator.Set( std::exp(-0.5*prob(0,0)) );
+            double outValue = std::exp(-0.5*prob);
+            if(seedIterator.Get()!=0)
+                outValue = 1.0;
 
-        if(seedIterator.Get()!=0)
-        {
-            outIterator.Set(1.0);
-        }
-        if(seedOppIterator2.Get()!=0)
-        {
-            outIterator.Set(0.0);
-        }
-        ++seedOppIterator2;
-        ++outIterator;
-        ++seedIterator;
-        for ( unsigned int k = 0; k < m_NbModalities; k++ )
-        {
-            ++m_imagesVectorIt[k];
-        }
-    }
+            if (seedMaskOppImage)
+            {
+                if(seedOppIterator.Get()!=0)
+                    outValue = 0.0;
+                ++seedOppIterator;
+            }
 
+            outIterator.Set(alpha * outValue);
+
+            ++outIterator;
+            ++seedIterator;
+            for (unsigned int k = 0; k < nbModalities; k++)
+                ++imagesIterators[k];
+        }
+    }, this);
 }
 
 
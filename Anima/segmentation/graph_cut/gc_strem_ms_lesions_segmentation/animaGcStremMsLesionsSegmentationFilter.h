@@ -1,19 +1,16 @@
 #pragma once
 
-#include "animaTLinksFilter.h"
 #include "animaGraphCutFilter.h"
 #include "animaCheckStructureNeighborFilter.h"
 #include "animaRemoveTouchingBorderFilter.h"
-#include "animaComputeMahalanobisImagesFilter.h"
+#include "animaStremTLinksImageFilter.h"
 #include "animaComputeSolution.h"
 
-#include <itkMaximumImageFilter.h>
 #include <itkMinimumImageFilter.h>
 #include <itkRelabelComponentImageFilter.h>
 #include <itkRescaleIntensityImageFilter.h>
 #include <itkImageToImageFilter.h>
 #include <itkBinaryThresholdImageFilter.h>
-#include <itkIntensityWindowingImageFilter.h>
 #include <itkMaskImageFilter.h>
 
 enum LesionSegmentationType
@@ -48,6 +45,7 @@ namespace anima
  *  - applying a graph cut segmentation. (LesionSegmentationType == gcem)
  *    The automatic graph cut segmentation requires a sources and a sink probabilities maps that are computed from the mahalanobis images.
  *    The sources map is computed using also fuzzy weights between 0 and 1, based on T2-w, DP and FLAIR hyper-intensities.
+ *    Mahalanobis images, fuzzy weights and sources and sinks probabilities are computed in a single threaded pass (StremTLinksImageFilter).
  *    Additionally, binary sources and sinks masks can be added as entries of the graph cut.(LesionSegmentationType == gcemAndManualGC)
  *    Their information will be mixed with the automatic sources and sinks probabilities map.
  *    This option simulates the lesion segmentation correction done by a user that adds/removes seeds for the graph cut computation.
@@ -115,19 +113,14 @@ public:
     typedef anima::GraphCutFilter< TInputImage, ImageTypeUC > GraphCutFilterType;
     typedef anima::CheckStructureNeighborFilter< ImageTypeUC,ImageTypeUC > CheckStructureNeighborFilterFilterType;
     typedef anima::RemoveTouchingBorderFilter<ImageTypeUC,ImageTypeUC,ImageTypeUC> RemoveTouchingBorderFilterType;
-    typedef anima::TLinksFilter<TInputImage,ImageTypeD> TLinksFilterType;
-    typedef anima::ComputeMahalanobisImagesFilter<ImageTypeUC,ImageTypeUC,ImageTypeD> ComputeMahalanobisImagesFilterType;
+    typedef anima::StremTLinksImageFilter<TInputImage> StremTLinksFilterType;
     typedef anima::ComputeSolution<ImageTypeUC,ImageTypeUC, ImageTypeD> ComputeSolutionType;
 
     typedef itk::RescaleIntensityImageFilter<TInputImage,ImageTypeUC> RescaleFilterType;
-    typedef itk::MaximumImageFilter<ImageTypeD,ImageTypeD,ImageTypeD> MaximumFilterType;
-    typedef itk::MinimumImageFilter<ImageTypeD,ImageTypeD,ImageTypeD> MinimumFilterTypeF;
     typedef itk::MinimumImageFilter<ImageTypeUC,ImageTypeUC,ImageTypeUC> MinimumFilterTypeUC;
     typedef itk::BinaryThresholdImageFilter <ImageTypeD, ImageTypeUC> BinaryThresholdImageFilterType_F_UC;
     typedef itk::BinaryThresholdImageFilter <ImageTypeUC, ImageTypeUC> BinaryThresholdImageFilterType_UC_UC;
-    typedef itk::IntensityWindowingImageFilter <ImageTypeUC, ImageTypeD> IntensityWindowingImageFilterType;
     typedef itk::MaskImageFilter< ImageTypeUC, ImageTypeUC > MaskFilterType_UC_UC;
-    typedef itk::MaskImageFilter< ImageTypeD, ImageTypeUC > MaskFilterType_F_UC;
     typedef itk::ConnectedComponentImageFilter <ImageTypeUC,ImageTypeInt> ConnectedComponentType;
     typedef itk::RelabelComponentImageFilter< ImageTypeInt, ImageTypeInt > RelabelComponentType;
 
@@ -138,7 +131,7 @@ public:
     void RescaleImages();
     void ComputeAutomaticInitialization();
     void StremThreshold();
-    void CreateFuzzyRuleImage();
+    void ComputeStremMaps();
     void GraphCut();
     void ApplyHeuristicRules();
     void ComputeNABT();
@@ -346,10 +339,7 @@ public:
 
 protected:
     typename GraphCutFilterType::Pointer m_GraphCutFilter;
-    typename TLinksFilterType::Pointer m_TLinksFilter;
-    MaximumFilterType::Pointer m_FilterMaxSources;
-    MaximumFilterType::Pointer m_FilterMaxSinks;
-    ComputeMahalanobisImagesFilterType::Pointer m_MahalanobisFilter;
+    typename StremTLinksFilterType::Pointer m_StremTLinksFilter;
 
     GcStremMsLesionsSegmentationFilter()
     {
@@ -379,10 +369,7 @@ protected:
         this->SetNthOutput( 17, this->MakeOutput(17) );
 
         m_GraphCutFilter = GraphCutFilterType::New();
-        m_TLinksFilter = TLinksFilterType::New();
-        m_FilterMaxSources = MaximumFilterType::New();
-        m_FilterMaxSinks = MaximumFilterType::New();
-        m_MahalanobisFilter = ComputeMahalanobisImagesFilterType::New();
+        m_StremTLinksFilter = StremTLinksFilterType::New();
 
         m_InitMethodType = 1;
         m_RejRatioHierar = 0.01;
@@ -596,7 +583,6 @@ private:
     ImageTypeUC::Pointer m_MaskUC;
     ImageTypeUC::Pointer m_LesionsDetectionImage;
     ImageTypeInt::Pointer m_LabeledLesions;
-    ImageTypeD::Pointer m_FuzzyObject;
 };
 
 }
@@ -314,7 +314,31 @@ GcStremMsLesionsSegmentationFilter <TInputImage>::WriteOutputs()
 
     if( m_LesionSegmentationType!=manualGC )
     {
-        m_MahalanobisFilter->WriteOutputs();
+        if( m_OutputMahaCSFFilename != "" )
+        {
+            std::cout << "Writing mahalanobis CSF image to: " << m_OutputMahaCSFFilename << std::endl;
+            anima::writeImage<ImageTypeD>(m_OutputMahaCSFFilename, this->GetOutputMahaCSFImage());
+        }
+        if( m_OutputMahaGMFilename != "" )
+        {
+            std::cout << "Writing mahalanobis GM image to: " << m_OutputMahaGMFilename << std::endl;
+            anima::writeImage<ImageTypeD>(m_OutputMahaGMFilename, this->GetOutputMahaGMImage());
+        }
+        if( m_OutputMahaWMFilename != "" )
+        {
+            std::cout << "Writing mahalanobis WM image to: " << m_OutputMahaWMFilename << std::endl;
+            anima::writeImage<ImageTypeD>(m_OutputMahaWMFilename, this->GetOutputMahaWMImage());
+        }
+        if( m_OutputMahaMinimumFilename != "" )
+        {
+            std::cout << "Writing minimum mahalanobis image to: " << m_OutputMahaMinimumFilename << std::endl;
+            anima::writeImage<ImageTypeD>(m_OutputMahaMinimumFilename, this->GetOutputMahaMinimumImage());
+        }
+        if( m_OutputMahaMaximumFilename != "" )
+        {
+            std::cout << "Writing maximum mahalanobis image to: " << m_OutputMahaMaximumFilename << std::endl;
+            anima::writeImage<ImageTypeD>(m_OutputMahaMaximumFilename, this->GetOutputMahaMaximumImage());
+        }
         if( m_OutputIntensityImage1Filename != "" )
         {
             std::cout << "Writing intensity output image 1 to: " << m_OutputIntensityImage1Filename << std::endl;
@@ -575,34 +599,85 @@ GcStremMsLesionsSegmentationFilter <TInputImage>::ComputeAutomaticInitialization
 
     m_GaussianModel = ComputeSolutionProcess->GetGaussianModel();
 
-    std::cout << "Computing mahalanobis images..." << std::endl;
-
-    m_MahalanobisFilter->SetGaussianModel( ComputeSolutionProcess->GetGaussianModel() );
-    m_MahalanobisFilter->SetMask( m_MaskUC );
-    m_MahalanobisFilter->SetInputImage1( m_InputImage_T1_UC );
-    m_MahalanobisFilter->SetInputImage2( m_InputImage_1_UC );
-    m_MahalanobisFilter->SetInputImage3( m_InputImage_2_UC );
-    m_MahalanobisFilter->SetTol( m_Tol );
-    m_MahalanobisFilter->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
-
-    m_MahalanobisFilter->SetOutputMahaCSFFilename( m_OutputMahaCSFFilename );
-    m_MahalanobisFilter->SetOutputMahaGMFilename( m_OutputMahaGMFilename );
-    m_MahalanobisFilter->SetOutputMahaWMFilename( m_OutputMahaWMFilename );
-    m_MahalanobisFilter->SetOutputMahaMaximumFilename( m_OutputMahaMaximumFilename );
-    m_MahalanobisFilter->SetOutputMahaMinimumFilename ( m_OutputMahaMinimumFilename );
-
-    m_MahalanobisFilter->GraftNthOutput( 0, this->GetOutputMahaCSFImage() );
-    m_MahalanobisFilter->GraftNthOutput( 1, this->GetOutputMahaGMImage() );
-    m_MahalanobisFilter->GraftNthOutput( 2, this->GetOutputMahaWMImage() );
-    m_MahalanobisFilter->GraftNthOutput( 3, this->GetOutputMahaMinimumImage() );
-    m_MahalanobisFilter->GraftNthOutput( 4, this->GetOutputMahaMaximumImage() );
-    m_MahalanobisFilter->Update();
-    this->GraftNthOutput( 12 , m_MahalanobisFilter->GetOutputMahaCSF() );
-    this->GraftNthOutput( 13 , m_MahalanobisFilter->GetOutputMahaGM() );
-    this->GraftNthOutput( 14 , m_MahalanobisFilter->GetOutputMahaWM() );
-    this->GraftNthOutput( 15 , m_MahalanobisFilter->GetOutputMahaMinimum() );
-    this->GraftNthOutput( 16 , m_MahalanobisFilter->GetOutputMahaMaximum() );
+    this->ComputeStremMaps();
+}
+
+template <typename TInputImage>
+void
+GcStremMsLesionsSegmentationFilter <TInputImage>::ComputeStremMaps()
+{
+    bool useGraphCut = (m_LesionSegmentationType == gcem) || (m_LesionSegmentationType == gcemAndManualGC);
+    if (useGraphCut)
+        std::cout << "Computing mahalanobis images, fuzzy rules and t-links..." << std::endl;
+    else
+        std::cout << "Computing mahalanobis images..." << std::endl;
+
+    // Mahalanobis, fuzzy rule and t-links maps in one pass, intermediate maps only computed if written
+    m_StremTLinksFilter = StremTLinksFilterType::New();
+    m_StremTLinksFilter->SetGaussianModel( m_GaussianModel );
+    m_StremTLinksFilter->SetMask( m_MaskUC );
+    m_StremTLinksFilter->SetInputImage1( m_InputImage_T1_UC );
+    m_StremTLinksFilter->SetInputImage2( m_InputImage_1_UC );
+    m_StremTLinksFilter->SetInputImage3( m_InputImage_2_UC );
+    m_StremTLinksFilter->SetTol( m_Tol );
+    m_StremTLinksFilter->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+    m_StremTLinksFilter->SetVerbose( m_Verbose );
+
+    m_StremTLinksFilter->SetComputeMahalanobisImages( true );
+    m_StremTLinksFilter->SetComputeMahalanobisExtrema( (m_OutputMahaMinimumFilename != "") || (m_OutputMahaMaximumFilename != "") );
+    m_StremTLinksFilter->SetComputeFuzzyObject( useGraphCut && (m_OutputFuzzyObjectFilename != "") );
+    m_StremTLinksFilter->SetComputeTLinks( useGraphCut );
+
+    if (useGraphCut)
+    {
+        m_StremTLinksFilter->SetFuzzyRuleMin( m_FuzzyRuleMin );
+        m_StremTLinksFilter->SetFuzzyRuleMax( m_FuzzyRuleMax );
+        m_StremTLinksFilter->SetAlpha( m_Alpha );
+        m_StremTLinksFilter->SetMultiVarSources( m_MultiVarSources );
+        m_StremTLinksFilter->SetMultiVarSinks( m_MultiVarSinks );
+        m_StremTLinksFilter->SetLesionPriorProportion( m_LesionPriorProportion );
+
+        if (this->GetInputLesionPrior().IsNotNull())
+            m_StremTLinksFilter->SetInputLesionPrior( this->GetInputLesionPrior() );
+
+        if ((m_LesionSegmentationType == gcemAndManualGC) && (this->GetSourcesMask().IsNotNull() || this->GetSinksMask().IsNotNull()))
+        {
+            if(this->GetInputImageT1().IsNotNull()){m_StremTLinksFilter->AddSeedModalityImage( this->GetInputImageT1() );}
+            if(this->GetInputImageT2().IsNotNull()){m_StremTLinksFilter->AddSeedModalityImage( this->GetInputImageT2() );}
+            if(this->GetInputImageDP().IsNotNull()){m_StremTLinksFilter->AddSeedModalityImage( this->GetInputImageDP() );}
+            if(this->GetInputImageFLAIR().IsNotNull()){m_StremTLinksFilter->AddSeedModalityImage( this->GetInputImageFLAIR() );}
+            if(this->GetInputImageT1Gd().IsNotNull()){m_StremTLinksFilter->AddSeedModalityImage( this->GetInputImageT1Gd() );}
+
+            if (this->GetSourcesMask().IsNotNull())
+                m_StremTLinksFilter->SetInputSeedSourcesMask( this->GetSourcesMask() );
+            if (this->GetSinksMask().IsNotNull())
+                m_StremTLinksFilter->SetInputSeedSinksMask( this->GetSinksMask() );
+        }
+    }
 
+    m_StremTLinksFilter->GraftNthOutput( StremTLinksFilterType::MahaCSF, this->GetOutputMahaCSFImage() );
+    m_StremTLinksFilter->GraftNthOutput( StremTLinksFilterType::MahaGM, this->GetOutputMahaGMImage() );
+    m_StremTLinksFilter->GraftNthOutput( StremTLinksFilterType::MahaWM, this->GetOutputMahaWMImage() );
+    m_StremTLinksFilter->GraftNthOutput( StremTLinksFilterType::MahaMinimum, this->GetOutputMahaMinimumImage() );
+    m_StremTLinksFilter->GraftNthOutput( StremTLinksFilterType::MahaMaximum, this->GetOutputMahaMaximumImage() );
+    m_StremTLinksFilter->GraftNthOutput( StremTLinksFilterType::FuzzyObject, this->GetOutputFuzzyObjectImage() );
+
+    try
+    {
+        m_StremTLinksFilter->Update();
+    }
+    catch (itk::ExceptionObject &e)
+    {
+        std::cerr << e << std::endl;
+        exit(-1);
+    }
+
+    this->GraftNthOutput( 11 , m_StremTLinksFilter->GetOutputFuzzyObject() );
+    this->GraftNthOutput( 12 , m_StremTLinksFilter->GetOutputMahaCSF() );
+    this->GraftNthOutput( 13 , m_StremTLinksFilter->GetOutputMahaGM() );
+    this->GraftNthOutput( 14 , m_StremTLinksFilter->GetOutputMahaWM() );
+    this->GraftNthOutput( 15 , m_StremTLinksFilter->GetOutputMahaMinimum() );
+    this->GraftNthOutput( 16 , m_StremTLinksFilter->GetOutputMahaMaximum() );
 }
 
 template <typename TInputImage>
@@ -615,7 +690,7 @@ GcStremMsLesionsSegmentationFilter <TInputImage>::StremThreshold()
     const unsigned char outsideValue = 0;
 
     BinaryThresholdImageFilterType_F_UC::Pointer thresholdFilterCSF  = BinaryThresholdImageFilterType_F_UC::New();
-    thresholdFilterCSF->SetInput( m_MahalanobisFilter->GetOutputMahaCSF() );
+    thresholdFilterCSF->SetInput( m_StremTLinksFilter->GetOutputMahaCSF() );
     thresholdFilterCSF->SetUpperThreshold( m_MahalanobisThCSF );
     thresholdFilterCSF->SetInsideValue( insideValue );
     thresholdFilterCSF->SetOutsideValue( outsideValue );
@@ -634,7 +709,7 @@ GcStremMsLesionsSegmentationFilter <TInputImage>::StremThreshold()
     this->GraftNthOutput( 6 , maskFilterCSF->GetOutput() );
 
     BinaryThresholdImageFilterType_F_UC::Pointer thresholdFilterGM  = BinaryThresholdImageFilterType_F_UC::New();
-    thresholdFilterGM->SetInput( m_MahalanobisFilter->GetOutputMahaGM() );
+    thresholdFilterGM->SetInput( m_StremTLinksFilter->GetOutputMahaGM() );
     thresholdFilterGM->SetUpperThreshold( m_MahalanobisThGM );
     thresholdFilterGM->SetInsideValue( insideValue );
     thresholdFilterGM->SetOutsideValue( outsideValue );
@@ -653,7 +728,7 @@ GcStremMsLesionsSegmentationFilter <TInputImage>::StremThreshold()
     this->GraftNthOutput( 7 , maskFilterGM->GetOutput() );
 
     BinaryThresholdImageFilterType_F_UC::Pointer thresholdFilterWM  = BinaryThresholdImageFilterType_F_UC::New();
-    thresholdFilterWM->SetInput( m_MahalanobisFilter->GetOutputMahaWM() );
+    thresholdFilterWM->SetInput( m_StremTLinksFilter->GetOutputMahaWM() );
     thresholdFilterWM->SetUpperThreshold( m_MahalanobisThWM );
     thresholdFilterWM->SetInsideValue( insideValue );
     thresholdFilterWM->SetOutsideValue( outsideValue );
@@ -690,95 +765,6 @@ GcStremMsLesionsSegmentationFilter <TInputImage>::StremThreshold()
     this->GraftNthOutput( 5 , filtermin2->GetOutput() );
 }
 
-template <typename TInputImage>
-void
-GcStremMsLesionsSegmentationFilter <TInputImage>::CreateFuzzyRuleImage()
-{
-    std::cout << "Computing fuzzy rules..." << std::endl;
-
-    MinimumFilterTypeF::Pointer filtermin1 = MinimumFilterTypeF::New();
-    MinimumFilterTypeF::Pointer filtermin2 = MinimumFilterTypeF::New();
-
-    const double minimumOutputValue = 0;
-    const double maximumOutputValue = 1;
-
-    const unsigned int indexWM = 2;
-    GaussianFunctionType::MeanVectorType mean = (m_GaussianModel[indexWM])->GetMean();
-    GaussianFunctionType::CovarianceMatrixType covar = (m_GaussianModel[indexWM])->GetCovariance();
-
-    const unsigned int indexImage1 = 1;
-    unsigned char intensityWindowLowerInputValue1 = static_cast<unsigned char>( mean[indexImage1] + m_FuzzyRuleMin * std::sqrt(covar[indexImage1][indexImage1]) );
-    unsigned char intensityWindowUpperInputValue1 = static_cast<unsigned char>( mean[indexImage1] + m_FuzzyRuleMax * std::sqrt(covar[indexImage1][indexImage1]) );
-
-    IntensityWindowingImageFilterType::Pointer intensityWindowFilter1 = IntensityWindowingImageFilterType::New();
-    intensityWindowFilter1->SetInput( m_InputImage_1_UC );
-    intensityWindowFilter1->SetWindowMinimum( intensityWindowLowerInputValue1 );
-    intensityWindowFilter1->SetWindowMaximum( intensityWindowUpperInputValue1 );
-    intensityWindowFilter1->SetOutputMinimum( minimumOutputValue );
-    intensityWindowFilter1->SetOutputMaximum( maximumOutputValue );
-    intensityWindowFilter1->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
-    intensityWindowFilter1->SetCoordinateTolerance( m_Tol );
-    intensityWindowFilter1->SetDirectionTolerance( m_Tol );
-
-    const unsigned int indexImage2 = 2;
-    unsigned char intensityWindowLowerInputValue2 = static_cast<unsigned char>( mean[indexImage2] + m_FuzzyRuleMin * std::sqrt(covar[indexImage2][indexImage2]) );
-    unsigned char intensityWindowUpperInputValue2 = static_cast<unsigned char>( mean[indexImage2] + m_FuzzyRuleMax * std::sqrt(covar[indexImage2][indexImage2]) );
-
-    IntensityWindowingImageFilterType::Pointer intensityWindowFilter2 = IntensityWindowingImageFilterType::New();
-    intensityWindowFilter2->SetInput( m_InputImage_2_UC );
-    intensityWindowFilter2->SetWindowMinimum( intensityWindowLowerInputValue2 );
-    intensityWindowFilter2->SetWindowMaximum( intensityWindowUpperInputValue2 );
-    intensityWindowFilter2->SetOutputMinimum( minimumOutputValue );
-    intensityWindowFilter2->SetOutputMaximum( maximumOutputValue );
-    intensityWindowFilter2->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
-    intensityWindowFilter2->SetCoordinateTolerance( m_Tol );
-    intensityWindowFilter2->SetDirectionTolerance( m_Tol );
-
-    filtermin1->SetInput1( intensityWindowFilter1->GetOutput() );
-    filtermin1->SetInput2( intensityWindowFilter2->GetOutput() );
-    filtermin1->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
-    filtermin1->SetCoordinateTolerance( m_Tol );
-    filtermin1->SetDirectionTolerance( m_Tol );
-
-    if (this->GetInputLesionPrior().IsNotNull())
-    {
-        typedef itk::ImageRegionIterator <ImageTypeD> IteratorType;
-        IteratorType mahaMinimumIterator(m_MahalanobisFilter->GetOutputMahaMinimum(),m_MahalanobisFilter->GetOutputMahaMinimum()->GetLargestPossibleRegion());
-        typedef itk::ImageRegionConstIterator <ImageTypeD> ConstIteratorType;
-        ConstIteratorType lesionPriorIterator(this->GetInputLesionPrior(),m_MahalanobisFilter->GetOutputMahaMinimum()->GetLargestPossibleRegion());
-
-        while (!lesionPriorIterator.IsAtEnd())
-        {
-            double mahaValue = mahaMinimumIterator.Get();
-            double lesionPriorValue = lesionPriorIterator.Get();
-
-            mahaMinimumIterator.Set(mahaValue * (1.0 - m_LesionPriorProportion) + lesionPriorValue * m_LesionPriorProportion);
-
-            ++mahaMinimumIterator;
-            ++lesionPriorIterator;
-        }
-    }
-
-    filtermin2->SetInput1( filtermin1->GetOutput() );
-    filtermin2->SetInput2(m_MahalanobisFilter->GetOutputMahaMinimum());
-    filtermin2->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
-    filtermin2->SetCoordinateTolerance( m_Tol );
-    filtermin2->SetDirectionTolerance( m_Tol );
-
-    MaskFilterType_F_UC::Pointer maskFilter = MaskFilterType_F_UC::New();
-    maskFilter->SetInput( filtermin2->GetOutput() ) ;
-    maskFilter->SetMaskImage( m_MaskUC );
-    maskFilter->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
-    maskFilter->SetCoordinateTolerance( m_Tol );
-    maskFilter->SetDirectionTolerance( m_Tol );
-    maskFilter->GraftOutput( this->GetOutputFuzzyObjectImage() );
-    maskFilter->Update();
-    this->GraftNthOutput( 11 , maskFilter->GetOutput() );
-
-    m_FuzzyObject = ImageTypeD::New();
-    m_FuzzyObject->Graft(maskFilter->GetOutput());
-}
-
 template <typename TInputImage>
 void
 GcStremMsLesionsSegmentationFilter <TInputImage>::GraphCut()
@@ -811,81 +797,10 @@ GcStremMsLesionsSegmentationFilter <TInputImage>::GraphCut()
     }
     else
     {
-        this->CreateFuzzyRuleImage();
-
-        // Compute TLinks if necessary
-        m_TLinksFilter->SetAlpha( m_Alpha );
-        m_TLinksFilter->SetMultiVarSources( m_MultiVarSources );
-        m_TLinksFilter->SetMultiVarSinks( m_MultiVarSinks );
-        m_TLinksFilter->SetTLinkMode( singleGaussianTLink );
-        m_TLinksFilter->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
-        m_TLinksFilter->SetTol( m_Tol );
-
-        index = 0;
-        if(this->GetInputImageT1().IsNotNull()){m_TLinksFilter->SetInputImage(index, this->GetInputImageT1() ); ++index;}
-        if(this->GetInputImageT2().IsNotNull()){m_TLinksFilter->SetInputImage(index, this->GetInputImageT2() ); ++index;}
-        if(this->GetInputImageDP().IsNotNull()){m_TLinksFilter->SetInputImage(index, this->GetInputImageDP() ); ++index;}
-        if(this->GetInputImageFLAIR().IsNotNull()){m_TLinksFilter->SetInputImage(index, this->GetInputImageFLAIR() ); ++index;}
-        if(this->GetInputImageT1Gd().IsNotNull()){m_TLinksFilter->SetInputImage(index, this->GetInputImageT1Gd() ); ++index;}
-
-        m_TLinksFilter->SetInputSeedSourcesMask( this->GetSourcesMask() );
-        m_TLinksFilter->SetInputSeedSinksMask( this->GetSinksMask() );
-
-        if(this->GetSourcesMask().IsNotNull() && m_LesionSegmentationType==gcemAndManualGC)
-        {
-            m_FilterMaxSources->SetInput1( m_FuzzyObject );
-            m_FilterMaxSources->SetInput2( m_TLinksFilter->GetOutputSources() );
-            m_FilterMaxSources->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
-            m_FilterMaxSources->SetCoordinateTolerance( m_Tol );
-            m_FilterMaxSources->SetDirectionTolerance( m_Tol );
-        }
-        if(this->GetSinksMask().IsNotNull() && m_LesionSegmentationType==gcemAndManualGC)
-        {
-            m_FilterMaxSinks->SetInput1( m_MahalanobisFilter->GetOutputMahaMaximum() );
-            m_FilterMaxSinks->SetInput2( m_TLinksFilter->GetOutputSinks() );
-            m_FilterMaxSinks->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
-            m_FilterMaxSinks->SetCoordinateTolerance( m_Tol );
-            m_FilterMaxSinks->SetDirectionTolerance( m_Tol );
-        }
-
+        // Sources and sinks probabilities already mix fuzzy rules, lesion prior and manual seeds
         m_GraphCutFilter->SetTLinkMode( stremTLink );
-        if(this->GetSourcesMask().IsNotNull() && m_LesionSegmentationType==gcemAndManualGC)
-        {
-            m_GraphCutFilter->SetInputSeedSourcesProba( m_FilterMaxSources->GetOutput() );
-        }
-        else
-        {
-            m_GraphCutFilter->SetInputSeedSourcesProba( m_FuzzyObject );
-        }
-
-        if(this->GetSinksMask().IsNotNull() && m_LesionSegmentationType==gcemAndManualGC)
-        {
-            m_GraphCutFilter->SetInputSeedSinksProba( m_FilterMaxSinks->GetOutput() );
-        }
-        else if (this->GetInputLesionPrior().IsNotNull())
-        {
-            typedef itk::ImageRegionIterator <ImageTypeD> IteratorType;
-            IteratorType sinkProbasIterator(m_MahalanobisFilter->GetOutputMahaMaximum(),m_MahalanobisFilter->GetOutputMahaMaximum()->GetLargestPossibleRegion());
-            typedef itk::ImageRegionConstIterator <ImageTypeD> ConstIteratorType;
-            ConstIteratorType lesionPriorIterator(this->GetInputLesionPrior(),m_MahalanobisFilter->GetOutputMahaMaximum()->GetLargestPossibleRegion());
-
-            while (!lesionPriorIterator.IsAtEnd())
-            {
-                double mahaValue = sinkProbasIterator.Get();
-                double lesionPriorValue = lesionPriorIterator.Get();
-
-                sinkProbasIterator.Set(mahaValue * (1.0 - m_LesionPriorProportion) + (1.0 - lesionPriorValue) * m_LesionPriorProportion);
-
-                ++sinkProbasIterator;
-                ++lesionPriorIterator;
-            }
-
-            m_GraphCutFilter->SetInputSeedSinksProba(m_MahalanobisFilter->GetOutputMahaMaximum());
-        }
-        else
-        {
-            m_GraphCutFilter->SetInputSeedSinksProba(m_MahalanobisFilter->GetOutputMahaMaximum());
-        }
+        m_GraphCutFilter->SetInputSeedSourcesProba( m_StremTLinksFilter->GetOutputSources() );
+        m_GraphCutFilter->SetInputSeedSinksProba( m_StremTLinksFilter->GetOutputSinks() );
     }
     m_GraphCutFilter->GraftOutput( this->GetOutputGraphCut() );
     m_GraphCutFilter->Update();
@@ -1043,7 +958,7 @@ GcStremMsLesionsSegmentationFilter <TInputImage>::ApplyHeuristicRules()
     {
         std::cout << "Computing white matter ratio..." << std::endl;
         BinaryThresholdImageFilterType_F_UC::Pointer thresholdFilterMapWM  = BinaryThresholdImageFilterType_F_UC::New();
-        thresholdFilterMapWM->SetInput( m_MahalanobisFilter->GetOutputMahaWM() );
+        thresholdFilterMapWM->SetInput( m_StremTLinksFilter->GetOutputMahaWM() );
         thresholdFilterMapWM->SetLowerThreshold( m_ThresoldWMmap );
         thresholdFilterMapWM->SetInsideValue( insideValue );
         thresholdFilterMapWM->SetOutsideValue( outsideValue );
@@ -1183,9 +1098,9 @@ GcStremMsLesionsSegmentationFilter <TInputImage>::ComputeNABT()
     {
         double minimumThWM = 0.3; // set a minimum proba value to avoid classifying grey matter as white matter
 
-        ImageIteratorTypeD itmahaWM(m_MahalanobisFilter->GetOutputMahaWM(),m_MahalanobisFilter->GetOutputMahaWM()->GetLargestPossibleRegion());
-        ImageIteratorTypeD itmahaGM(m_MahalanobisFilter->GetOutputMahaGM(),m_MahalanobisFilter->GetOutputMahaGM()->GetLargestPossibleRegion());
-        ImageIteratorTypeD itmahaCSF(m_MahalanobisFilter->GetOutputMahaCSF(),m_MahalanobisFilter->GetOutputMahaCSF()->GetLargestPossibleRegion());
+        ImageIteratorTypeD itmahaWM(m_StremTLinksFilter->GetOutputMahaWM(),m_StremTLinksFilter->GetOutputMahaWM()->GetLargestPossibleRegion());
+        ImageIteratorTypeD itmahaGM(m_StremTLinksFilter->GetOutputMahaGM(),m_StremTLinksFilter->GetOutputMahaGM()->GetLargestPossibleRegion());
+        ImageIteratorTypeD itmahaCSF(m_StremTLinksFilter->GetOutputMahaCSF(),m_StremTLinksFilter->GetOutputMahaCSF()->GetLargestPossibleRegion());
 
         itMask.GoToBegin();
         itImageLesions.GoToBegin();
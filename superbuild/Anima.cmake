@@ -6,6 +6,8 @@ set (cmake_args
   -DLIBRARY_OUTPUT_PATH=${CMAKE_BINARY_DIR}/lib
   -DBUILD_TOOLS:BOOL=${BUILD_ANIMA_TOOLS}
   -DBUILD_TESTING:BOOL=${BUILD_ANIMA_TESTING}
+  -DBUILD_BENCHMARKS:BOOL=${BUILD_ANIMA_BENCHMARKS}
+  -DUSE_INSTRUMENTATION:BOOL=${USE_ANIMA_INSTRUMENTATION}
   -DBUILD_DOCUMENTATION:BOOL=${BUILD_ANIMA_DOCUMENTATION}
   -DBUILD_ALL_MODULES:BOOL=ON
   -DBUILD_MODULE_MATHS:BOOL=ON